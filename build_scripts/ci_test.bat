@@ -1,3 +1,3 @@
 cd binaries
-spartan_%1.exe -ci_test
+spartan_%1.exe -ci_test -test_all
 timeout /t 10
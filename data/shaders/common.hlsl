@@ -236,12 +236,24 @@ float3 get_normal_view_space(float2 uv)
     return normalize(mul(float4(get_normal(uv), 0.0f), buffer_frame.view).xyz);
 }
 
-float3x3 make_tangent_to_world_matrix(float3 n, float3 t)
+// -1 where the uvs are mirrored relative to the surface, the bitangent sign of mikktspace, the importer splits vertices
+// so that all triangles of a vertex agree, which makes this match geometry_processing::get_uv_orientation() on the cpu
+float get_uv_handedness(float3 position, float2 uv, float3 n)
+{
+    float3 dp_dx  = ddx(position);
+    float3 dp_dy  = ddy(position);
+    float2 duv_dx = ddx(uv);
+    float2 duv_dy = ddy(uv);
+
+    return dot(cross(dp_dx, dp_dy), n) * (duv_dx.x * duv_dy.y - duv_dx.y * duv_dy.x) < 0.0f ? -1.0f : 1.0f;
+}
+
+float3x3 make_tangent_to_world_matrix(float3 n, float3 t, float handedness = 1.0f)
 {
     // re-orthogonalize T with respect to N
     t = normalize(t - dot(t, n) * n);
     // compute bitangent
-    float3 b = cross(n, t);
+    float3 b = cross(n, t) * handedness;
     // create matrix
     return float3x3(t, b, n); 
 }
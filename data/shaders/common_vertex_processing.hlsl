@@ -31,8 +31,7 @@ struct Vertex_PosUvNorTan
 {
     float4 position                : POSITION;
     float2 uv                      : TEXCOORD;
-    float3 normal                  : NORMAL;
-    float3 tangent                 : TANGENT;
+    float4 normal_tangent          : NORMAL; // octahedral, normal in xy, tangent in zw
     min16float instance_position_x : INSTANCE_POSITION_X;
     min16float instance_position_y : INSTANCE_POSITION_Y;
     min16float instance_position_z : INSTANCE_POSITION_Z;
@@ -52,6 +51,15 @@ struct gbuffer_vertex
     float width_percent      : TEXCOORD2; // temp, will remove
 };
 
+// inverse of geometry_processing::encode_octahedral() on the cpu side
+float3 decode_octahedral(float2 encoded)
+{
+    float3 v = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t  = saturate(-v.z);
+    v.xy    += t * (1.0f - 2.0f * step(0.0f, v.xy));
+    return normalize(v);
+}
+
 float4x4 compose_instance_transform(min16float instance_position_x, min16float instance_position_y, min16float instance_position_z, uint instance_normal_oct, uint instance_yaw, uint instance_scale)
 {
     // compose position
@@ -301,8 +309,8 @@ gbuffer_vertex transform_to_world_space(Vertex_PosUvNorTan input, uint instance_
     float3 position_previous = mul(input.position, transform_previous).xyz;
     
     // transform normal and tangent to world space (extract 3x3 rotation/scale matrix)
-    vertex.normal  = normalize(mul(input.normal, (float3x3)transform));
-    vertex.tangent = normalize(mul(input.tangent, (float3x3)transform));
+    vertex.normal  = normalize(mul(decode_octahedral(input.normal_tangent.xy), (float3x3)transform));
+    vertex.tangent = normalize(mul(decode_octahedral(input.normal_tangent.zw), (float3x3)transform));
 
     // apply wind animation and other world-space effects
     vertex_processing::process_world_space(surface, position, vertex, input.position.xyz, transform, instance_id, 0.0f);
@@ -133,6 +133,9 @@ gbuffer main_ps(gbuffer_vertex vertex, bool is_front_face : SV_IsFrontFace)
     
     // world position
     float3 position_world = get_position(vertex.position.z, ndc_to_uv(position_ndc));
+
+    // bitangent sign, the derivatives are taken here since the normal mapping below is in a branch
+    float handedness = get_uv_handedness(position_world, vertex.uv_misc.xy, vertex.normal);
     
     // cache distance to camera (used multiple times)
     float3 camera_to_pixel = position_world - buffer_frame.camera_position;
@@ -304,7 +307,7 @@ gbuffer main_ps(gbuffer_vertex vertex, bool is_front_face : SV_IsFrontFace)
 
         float normal_intensity = saturate(max(0.01f, material.normal)) * distance_fade;
         tangent_normal.xy         *= normal_intensity;
-        float3x3 tangent_to_world  = make_tangent_to_world_matrix(vertex.normal, vertex.tangent);
+        float3x3 tangent_to_world  = make_tangent_to_world_matrix(vertex.normal, vertex.tangent, handedness);
         normal                     = normalize(mul(tangent_normal, tangent_to_world).xyz);
     }
 
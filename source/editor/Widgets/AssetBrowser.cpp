@@ -85,7 +85,7 @@ namespace
     
                 mesh_import_dialog_checkbox(MeshFlags::ImportCombineMeshes,
                     "Combine meshes",
-                    "Join some meshes, remove some nodes and pre-transform vertices."
+                    "Join some meshes and remove some nodes, meshes used by multiple nodes stay shared."
                 );
     
                 mesh_import_dialog_checkbox(MeshFlags::ImportLights,
@@ -98,6 +98,16 @@ namespace
                     "Performs a variety of optimizations aimed at reduce cache misses, overdraw and so on..."
                 );
 
+                mesh_import_dialog_checkbox(MeshFlags::PostProcessQuantizeVertices,
+                    "Quantize vertices",
+                    "Store vertices on disk in a compact 20 byte layout (quantized positions, half uvs, octahedral normals). Reduces file size, the GPU always uses a 24 byte layout (float positions, half uvs, octahedral normals)."
+                );
+
+                mesh_import_dialog_checkbox(MeshFlags::PostProcessBuildClusters,
+                    "Build clusters",
+                    "Split large meshes into clusters of triangles, so that only the visible ones are drawn."
+                );
+
                 // Ok button
                 if (ImGuiSp::button_centered_on_line("Ok", 0.5f))
                 {
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "World/Components/AudioSource.h"
 #include "World/Components/Terrain.h"
 #include "World/Components/Camera.h"
+#include "World/TerrainQuadtree.h"
 //=======================================
 
 //= NAMESPACES =========
@@ -214,6 +215,12 @@ void Properties::OnTickVisible()
                 ShowPhysics(entity->GetComponent<Physics>());
 
                 ShowAddComponentButton();
+
+                // component setters don't mark the entity dirty, so any edit made here does
+                if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) && ImGui::IsAnyItemActive())
+                {
+                    entity->MarkDirty();
+                }
             }
             else if (!m_inspected_material.expired())
             {
@@ -693,7 +700,7 @@ void Properties::ShowPhysics(Physics* body) const
                 "Capsule",
                 "Mesh",
                 "Controller",
-                "Water"
+                "Height Field"
             };
 
             ImGui::Text("Body Type");
@@ -1050,6 +1057,7 @@ void Properties::ShowTerrain(Terrain* terrain) const
         //= REFLECT =====================
         float min_y = terrain->GetMinY();
         float max_y = terrain->GetMaxY();
+        int seed    = static_cast<int>(terrain->GetSeed());
         //===============================
 
         const float cursor_y = ImGui::GetCursorPosY();
@@ -1082,6 +1090,7 @@ void Properties::ShowTerrain(Terrain* terrain) const
         {
             ImGui::InputFloat("Min Y", &min_y);
             ImGui::InputFloat("Max Y", &max_y);
+            ImGui::InputInt("Seed", &seed);
         }
         ImGui::EndGroup();
 
@@ -1092,12 +1101,18 @@ void Properties::ShowTerrain(Terrain* terrain) const
             ImGui::Text("Height samples: %d", terrain->GetHeightSampleCount());
             ImGui::Text("Vertices: %d",       terrain->GetVertexCount());
             ImGui::Text("Indices: %d ",       terrain->GetIndexCount());
+
+            const spartan::TerrainQuadtree* quadtree = terrain->GetQuadtree();
+            ImGui::Text("Chunks: %u resident, %u drawn, %u pending", quadtree->GetResidentChunkCount(), quadtree->GetSelectedChunkCount(), quadtree->GetPendingChunkCount());
+            ImGui::Text("Chunk memory: %.1f MB",                     static_cast<float>(quadtree->GetResidentMemory()) / (1024.0f * 1024.0f));
+            ImGui::Text("Chunk latency: %.2f ms (max %.2f ms)",      quadtree->GetLatencyMsAverage(), quadtree->GetLatencyMsMax());
         }
         ImGui::EndGroup();
 
         //= MAP =================================================
         if (min_y != terrain->GetMinY()) terrain->SetMinY(min_y);
         if (max_y != terrain->GetMaxY()) terrain->SetMaxY(max_y);
+        if (static_cast<uint32_t>(seed) != terrain->GetSeed()) terrain->SetSeed(static_cast<uint32_t>(seed));
         //=======================================================
     }
     component_end();
@@ -1118,6 +1133,7 @@ void Properties::ShowAudioSource(spartan::AudioSource* audio_source) const
         bool is_3d             = audio_source->GetIs3d();
         float volume           = audio_source->GetVolume();
         float pitch            = audio_source->GetPitch();
+        float priority         = audio_source->GetPriority();
         //========================================================
 
         // audio clip
@@ -1153,6 +1169,11 @@ void Properties::ShowAudioSource(spartan::AudioSource* audio_source) const
         ImGui::Text("Volume");
         ImGui::SameLine(column_pos_x); ImGui::SliderFloat("##audioSourceVolume", &volume, 0.0f, 1.0f);
 
+        // priority
+        ImGui::Text("Priority");
+        ImGui::SameLine(column_pos_x); ImGui::SliderFloat("##audioSourcePriority", &priority, 0.0f, 10.0f);
+        ImGuiSp::tooltip("When more sounds play than the mixer can afford, the ones with the lowest priority (relative to their loudness) go silent");
+
         ImGui::Separator();
         ImGui::Text("Progress");
         ImGui::SameLine(column_pos_x); ImGui::ProgressBar(audio_source->GetProgress());
@@ -1164,6 +1185,7 @@ void Properties::ShowAudioSource(spartan::AudioSource* audio_source) const
         if (is_3d != audio_source->GetIs3d())                audio_source->SetIs3d(is_3d);
         if (volume != audio_source->GetVolume())             audio_source->SetVolume(volume);
         if (pitch != audio_source->GetPitch())               audio_source->SetPitch(pitch);
+        if (priority != audio_source->GetPriority())         audio_source->SetPriority(priority);
         //===============================================================================================
     }
     component_end();
@@ -0,0 +1,387 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ============
+#include "pch.h"
+#include "AudioDecoder.h"
+SP_WARNINGS_OFF
+#include <SDL3/SDL_audio.h>
+SP_WARNINGS_ON
+//=======================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace spartan
+{
+    namespace
+    {
+        enum class WavFormat : uint16_t
+        {
+            Pcm        = 0x0001,
+            Float      = 0x0003,
+            ImaAdpcm   = 0x0011,
+            Extensible = 0xFFFE
+        };
+
+        const int32_t ima_index_table[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+        const int32_t ima_step_table[89]  =
+        {
+            7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+            157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552,
+            1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+            12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+        };
+
+        template<typename T>
+        bool read(ifstream& file, T& value)
+        {
+            return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+        }
+
+        // riff/wave, reads the data chunk in place so that only a block at a time is ever in memory
+        class AudioDecoderWav : public AudioDecoder
+        {
+        public:
+            bool Open(const string& file_path) override
+            {
+                m_file.open(file_path, ios::binary);
+                if (!m_file)
+                    return false;
+
+                char riff[4]       = {};
+                char wave[4]       = {};
+                uint32_t riff_size = 0;
+                if (!m_file.read(riff, 4) || !read(m_file, riff_size) || !m_file.read(wave, 4) || memcmp(riff, "RIFF", 4) != 0 || memcmp(wave, "WAVE", 4) != 0)
+                    return false;
+
+                uint32_t fact_frames = 0;
+                bool has_format      = false;
+                char chunk_id[4]     = {};
+                uint32_t chunk_size  = 0;
+                while (m_file.read(chunk_id, 4) && read(m_file, chunk_size))
+                {
+                    const streamoff chunk_end = static_cast<streamoff>(m_file.tellg()) + chunk_size + (chunk_size & 1);
+
+                    if (memcmp(chunk_id, "fmt ", 4) == 0)
+                    {
+                        uint16_t format = 0, channels = 0, block_align = 0, bits = 0;
+                        uint32_t sample_rate = 0, byte_rate = 0;
+                        read(m_file, format);
+                        read(m_file, channels);
+                        read(m_file, sample_rate);
+                        read(m_file, byte_rate);
+                        read(m_file, block_align);
+                        read(m_file, bits);
+
+                        // extensible formats carry the actual format in the first two bytes of their sub-format guid
+                        if (static_cast<WavFormat>(format) == WavFormat::Extensible && chunk_size >= 26)
+                        {
+                            uint16_t extension_size = 0, valid_bits = 0;
+                            uint32_t channel_mask   = 0;
+                            read(m_file, extension_size);
+                            read(m_file, valid_bits);
+                            read(m_file, channel_mask);
+                            read(m_file, format);
+                        }
+
+                        m_format        = static_cast<WavFormat>(format);
+                        m_channel_count = channels;
+                        m_sample_rate   = sample_rate;
+                        m_block_align   = block_align;
+                        m_bits          = bits;
+                        has_format      = true;
+                    }
+                    else if (memcmp(chunk_id, "fact", 4) == 0)
+                    {
+                        read(m_file, fact_frames);
+                    }
+                    else if (memcmp(chunk_id, "data", 4) == 0)
+                    {
+                        m_data_offset = m_file.tellg();
+                        m_data_size   = chunk_size;
+                        break;
+                    }
+
+                    m_file.seekg(chunk_end);
+                }
+
+                if (!has_format || m_data_size == 0 || m_channel_count == 0 || m_sample_rate == 0 || m_block_align == 0)
+                    return false;
+
+                if (m_format == WavFormat::Pcm && (m_bits == 8 || m_bits == 16 || m_bits == 24 || m_bits == 32))
+                {
+                    m_frame_count = m_data_size / m_block_align;
+                }
+                else if (m_format == WavFormat::Float && m_bits == 32)
+                {
+                    m_frame_count = m_data_size / m_block_align;
+                }
+                else if (m_format == WavFormat::ImaAdpcm && m_bits == 4 && m_block_align > 4 * m_channel_count)
+                {
+                    // every block starts with a sample per channel, followed by 4-bit deltas
+                    m_frames_per_block         = (m_block_align - 4 * m_channel_count) * 2 / m_channel_count + 1;
+                    const uint64_t block_count = (m_data_size + m_block_align - 1) / m_block_align;
+                    m_frame_count              = fact_frames != 0 ? fact_frames : block_count * m_frames_per_block;
+                }
+                else
+                {
+                    // ms adpcm, a-law, mu-law and the like are left to the sdl decoder
+                    return false;
+                }
+
+                m_file.seekg(m_data_offset);
+                return m_frame_count != 0;
+            }
+
+            uint32_t Read(float* output, const uint32_t frame_count) override
+            {
+                const uint32_t count = static_cast<uint32_t>(min<uint64_t>(frame_count, m_frame_count - m_frame));
+                if (count == 0)
+                    return 0;
+
+                if (m_format == WavFormat::ImaAdpcm)
+                {
+                    uint32_t decoded = 0;
+                    while (decoded < count)
+                    {
+                        if (m_block_position == m_block.size() && !DecodeAdpcmBlock())
+                            break;
+
+                        const uint32_t available = min(count - decoded, static_cast<uint32_t>(m_block.size() - m_block_position));
+                        memcpy(output + decoded, m_block.data() + m_block_position, available * sizeof(float));
+                        m_block_position += available;
+                        decoded          += available;
+                    }
+
+                    m_frame += decoded;
+                    return decoded;
+                }
+
+                m_raw.resize(static_cast<size_t>(count) * m_block_align);
+                m_file.read(reinterpret_cast<char*>(m_raw.data()), m_raw.size());
+                const uint32_t read_count = static_cast<uint32_t>(m_file.gcount() / m_block_align);
+                const float channel_scale = 1.0f / m_channel_count;
+                const uint8_t* raw        = m_raw.data();
+                for (uint32_t i = 0; i < read_count; i++)
+                {
+                    float sum = 0.0f;
+                    for (uint32_t channel = 0; channel < m_channel_count; channel++)
+                    {
+                        sum += DecodeSample(raw);
+                        raw += m_bits / 8;
+                    }
+                    output[i] = sum * channel_scale;
+                }
+
+                m_frame += read_count;
+                return read_count;
+            }
+
+            void Rewind() override
+            {
+                m_file.clear();
+                m_file.seekg(m_data_offset);
+                m_frame          = 0;
+                m_block_position = 0;
+                m_block.clear();
+            }
+
+        private:
+            float DecodeSample(const uint8_t* data) const
+            {
+                switch (m_bits)
+                {
+                    case 8:  return (static_cast<float>(data[0]) - 128.0f) / 128.0f;
+                    case 16: return static_cast<float>(static_cast<int16_t>(data[0] | (data[1] << 8))) / 32768.0f;
+                    case 24: return static_cast<float>(static_cast<int32_t>((data[0] << 8) | (data[1] << 16) | (data[2] << 24)) >> 8) / 8388608.0f;
+                    default:
+                    {
+                        if (m_format == WavFormat::Float)
+                        {
+                            float value = 0.0f;
+                            memcpy(&value, data, sizeof(float));
+                            return value;
+                        }
+
+                        int32_t value = 0;
+                        memcpy(&value, data, sizeof(int32_t));
+                        return static_cast<float>(value) / 2147483648.0f;
+                    }
+                }
+            }
+
+            bool DecodeAdpcmBlock()
+            {
+                m_raw.resize(m_block_align);
+                m_file.read(reinterpret_cast<char*>(m_raw.data()), m_block_align);
+                const uint32_t size = static_cast<uint32_t>(m_file.gcount());
+                if (size <= 4 * m_channel_count)
+                    return false;
+
+                const uint32_t frames = min(m_frames_per_block, (size - 4 * m_channel_count) * 2 / m_channel_count + 1);
+                m_block.assign(frames, 0.0f);
+                m_block_position = 0;
+
+                for (uint32_t channel = 0; channel < m_channel_count; channel++)
+                {
+                    // header
+                    const uint8_t* header = m_raw.data() + channel * 4;
+                    int32_t predictor     = static_cast<int16_t>(header[0] | (header[1] << 8));
+                    int32_t index         = clamp<int32_t>(header[2], 0, 88);
+                    m_block[0]           += predictor / 32768.0f;
+
+                    // deltas, channels are interleaved in groups of 4 bytes (8 frames), low nibble first
+                    for (uint32_t frame = 1; frame < frames; frame++)
+                    {
+                        const uint32_t delta_index = frame - 1;
+                        const uint32_t group       = delta_index / 8;
+                        const uint32_t byte        = 4 * m_channel_count + (group * m_channel_count + channel) * 4 + (delta_index % 8) / 2;
+                        const uint8_t nibble       = (delta_index & 1) ? (m_raw[byte] >> 4) : (m_raw[byte] & 0x0F);
+
+                        const int32_t step = ima_step_table[index];
+                        int32_t difference = step >> 3;
+                        if (nibble & 1) difference += step >> 2;
+                        if (nibble & 2) difference += step >> 1;
+                        if (nibble & 4) difference += step;
+                        predictor          = clamp<int32_t>((nibble & 8) ? predictor - difference : predictor + difference, -32768, 32767);
+                        index              = clamp<int32_t>(index + ima_index_table[nibble], 0, 88);
+
+                        m_block[frame] += predictor / 32768.0f;
+                    }
+                }
+
+                const float channel_scale = 1.0f / m_channel_count;
+                for (float& sample : m_block)
+                {
+                    sample *= channel_scale;
+                }
+
+                return true;
+            }
+
+            ifstream m_file;
+            WavFormat m_format          = WavFormat::Pcm;
+            uint16_t m_bits             = 0;
+            uint32_t m_block_align      = 0;
+            streampos m_data_offset     = 0;
+            uint32_t m_data_size        = 0;
+            uint64_t m_frame            = 0;
+            vector<uint8_t> m_raw;
+
+            // ima adpcm
+            uint32_t m_frames_per_block = 0;
+            vector<float> m_block;
+            size_t m_block_position     = 0;
+        };
+
+        // wav formats which the streaming decoder doesn't handle (ms adpcm, a-law, mu-law), sdl decodes and converts
+        // the whole file up front, so the samples are resident but every format that sdl knows about still plays
+        class AudioDecoderSdl : public AudioDecoder
+        {
+        public:
+            bool Open(const string& file_path) override
+            {
+                SDL_AudioSpec spec_source = {};
+                uint8_t* data_source      = nullptr;
+                uint32_t size_source      = 0;
+                if (!SDL_LoadWAV(file_path.c_str(), &spec_source, &data_source, &size_source))
+                    return false;
+
+                // mono float at the source rate, the mixer resamples
+                SDL_AudioSpec spec_mono = {};
+                spec_mono.format        = SDL_AUDIO_F32;
+                spec_mono.channels      = 1;
+                spec_mono.freq          = spec_source.freq;
+                uint8_t* data_mono      = nullptr;
+                int size_mono           = 0;
+                const bool converted    = SDL_ConvertAudioSamples(&spec_source, data_source, static_cast<int>(size_source), &spec_mono, &data_mono, &size_mono);
+                SDL_free(data_source);
+                if (!converted)
+                {
+                    SP_LOG_ERROR("%s", SDL_GetError());
+                    return false;
+                }
+
+                m_samples.resize(static_cast<size_t>(size_mono) / sizeof(float));
+                memcpy(m_samples.data(), data_mono, m_samples.size() * sizeof(float));
+                SDL_free(data_mono);
+
+                m_sample_rate   = static_cast<uint32_t>(spec_source.freq);
+                m_channel_count = static_cast<uint32_t>(spec_source.channels);
+                m_frame_count   = m_samples.size();
+                return m_frame_count != 0;
+            }
+
+            uint32_t Read(float* output, const uint32_t frame_count) override
+            {
+                const uint32_t count = static_cast<uint32_t>(min<uint64_t>(frame_count, m_frame_count - m_frame));
+                memcpy(output, m_samples.data() + m_frame, count * sizeof(float));
+                m_frame += count;
+                return count;
+            }
+
+            void Rewind() override
+            {
+                m_frame = 0;
+            }
+
+            bool IsResident() const override { return true; }
+
+        private:
+            vector<float> m_samples;
+            uint64_t m_frame = 0;
+        };
+
+        mutex mutex_decoders;
+        vector<function<unique_ptr<AudioDecoder>()>> decoders =
+        {
+            []() { return unique_ptr<AudioDecoder>(make_unique<AudioDecoderSdl>()); },
+            []() { return unique_ptr<AudioDecoder>(make_unique<AudioDecoderWav>()); }
+        };
+    }
+
+    void AudioDecoder::Register(function<unique_ptr<AudioDecoder>()>&& factory)
+    {
+        lock_guard lock(mutex_decoders);
+        decoders.emplace_back(move(factory));
+    }
+
+    unique_ptr<AudioDecoder> AudioDecoder::Create(const string& file_path)
+    {
+        vector<function<unique_ptr<AudioDecoder>()>> factories;
+        {
+            lock_guard lock(mutex_decoders);
+            factories = decoders;
+        }
+
+        for (auto it = factories.rbegin(); it != factories.rend(); it++)
+        {
+            unique_ptr<AudioDecoder> decoder = (*it)();
+            if (decoder && decoder->Open(file_path))
+                return decoder;
+        }
+
+        return nullptr;
+    }
+}
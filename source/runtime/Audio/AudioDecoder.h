@@ -0,0 +1,66 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =====
+#include <functional>
+#include <memory>
+#include <string>
+//================
+
+namespace spartan
+{
+    // decodes an audio file into mono 32-bit float samples, a block at a time
+    // - wav (pcm, float and ima adpcm) is built in and streams, other wav formats fall back to sdl, which decodes them whole
+    // - other formats can be added by registering a decoder
+    class AudioDecoder
+    {
+    public:
+        virtual ~AudioDecoder() = default;
+
+        // parses the header, returns false if the file isn't in a format the decoder understands
+        virtual bool Open(const std::string& file_path) = 0;
+
+        // decodes up to frame_count frames (channels are averaged), returns the frames decoded, 0 at the end of the file
+        virtual uint32_t Read(float* output, const uint32_t frame_count) = 0;
+
+        // goes back to the first frame
+        virtual void Rewind() = 0;
+
+        // decoders that decode the whole file when they open it, streaming their clips would only duplicate the samples
+        virtual bool IsResident() const { return false; }
+
+        uint32_t GetSampleRate() const   { return m_sample_rate; }
+        uint32_t GetChannelCount() const { return m_channel_count; }
+        uint64_t GetFrameCount() const   { return m_frame_count; }
+
+        // decoders are tried in the reverse order of their registration, so a registered decoder takes precedence over the built-in ones
+        static void Register(std::function<std::unique_ptr<AudioDecoder>()>&& factory);
+        static std::unique_ptr<AudioDecoder> Create(const std::string& file_path);
+
+    protected:
+        uint32_t m_sample_rate   = 0;
+        uint32_t m_channel_count = 0;
+        uint64_t m_frame_count   = 0;
+    };
+}
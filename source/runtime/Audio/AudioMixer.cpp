@@ -0,0 +1,1359 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES =====================
+#include "pch.h"
+#include "AudioMixer.h"
+#include "AudioDecoder.h"
+#include "../Core/Engine.h"
+#include "../Profiling/Profiler.h"
+#include "../Core/Stopwatch.h"
+SP_WARNINGS_OFF
+#include <SDL3/SDL_audio.h>
+#include <SDL3/SDL_thread.h>
+SP_WARNINGS_ON
+//================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace spartan
+{
+    namespace
+    {
+        constexpr uint32_t block_frames   = 512;   // frames that are mixed at a time
+        constexpr uint32_t latency_frames = 2048;  // frames that are kept queued ahead of the device
+        constexpr float audible_gain      = 1e-4f; // voices quieter than this are always virtual
+        constexpr uint32_t stream_block   = 4096;  // frames that a stream decodes at a time
+        constexpr uint32_t stream_size    = 16384; // frames that a stream buffers ahead of its voice
+        constexpr uint32_t voice_capacity = 1024;  // voice slots, they never move so the mixer thread can read them without a lock
+
+        class ClipStream;
+
+        // streams are refilled by a thread of their own, so a refill never waits behind long jobs on the thread pool
+        thread refill_thread;
+        mutex mutex_refill;
+        condition_variable condition_refill;
+        deque<shared_ptr<ClipStream>> refill_queue;
+        bool refill_running = false;
+
+        // decodes a streamed clip ahead of a voice, on the refill thread, into a ring buffer
+        // - single producer (the refill thread) and single consumer (the mixer), the indices are the only shared state
+        // - looping is handled here, by rewinding the decoder, so that the voice sees an endless stream
+        class ClipStream
+        {
+        public:
+            ClipStream(const string& file_path, const bool loop) : m_file_path(file_path), m_loop(loop)
+            {
+                m_ring.resize(stream_size);
+            }
+
+            // consumer
+            uint32_t Read(float* output, const uint32_t count)
+            {
+                const uint64_t read      = m_read.load(memory_order_relaxed);
+                const uint32_t available = static_cast<uint32_t>(min<uint64_t>(count, m_write.load(memory_order_acquire) - read));
+                for (uint32_t i = 0; i < available; )
+                {
+                    const uint32_t offset = static_cast<uint32_t>((read + i) % stream_size);
+                    const uint32_t length = min(available - i, stream_size - offset);
+                    memcpy(output + i, m_ring.data() + offset, length * sizeof(float));
+                    i += length;
+                }
+
+                m_read.store(read + available, memory_order_release);
+                return available;
+            }
+
+            // no more samples will arrive
+            bool IsFinished() const
+            {
+                return m_finished.load(memory_order_acquire) && m_read.load(memory_order_relaxed) == m_write.load(memory_order_acquire);
+            }
+
+            void SetLoop(const bool loop) { m_loop.store(loop, memory_order_relaxed); }
+
+            // schedules a refill once half of the buffer has been consumed
+            static void RequestRefill(const shared_ptr<ClipStream>& stream)
+            {
+                const uint64_t buffered = stream->m_write.load(memory_order_acquire) - stream->m_read.load(memory_order_relaxed);
+                if (stream->m_finished.load(memory_order_acquire) || buffered > stream_size / 2 || stream->m_refilling.exchange(true))
+                    return;
+
+                {
+                    lock_guard lock(mutex_refill);
+                    refill_queue.emplace_back(stream);
+                }
+                condition_refill.notify_one();
+            }
+
+            static void RefillLoop()
+            {
+                SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+                while (true)
+                {
+                    shared_ptr<ClipStream> stream;
+                    {
+                        unique_lock lock(mutex_refill);
+                        condition_refill.wait(lock, []() { return !refill_running || !refill_queue.empty(); });
+                        if (!refill_running)
+                            break;
+
+                        stream = move(refill_queue.front());
+                        refill_queue.pop_front();
+                    }
+
+                    // a block takes a fraction of a millisecond to decode, so streams are served in the order they asked
+                    stream->Refill();
+                    stream->m_refilling.store(false, memory_order_release);
+                }
+            }
+
+        private:
+            // producer
+            void Refill()
+            {
+                if (!m_decoder)
+                {
+                    m_decoder = AudioDecoder::Create(m_file_path);
+                    if (!m_decoder)
+                    {
+                        SP_LOG_ERROR("Failed to open \"%s\" for streaming", m_file_path.c_str());
+                        m_finished.store(true, memory_order_release);
+                        return;
+                    }
+                }
+
+                m_decoded.resize(stream_block);
+                while (stream_size - (m_write.load(memory_order_relaxed) - m_read.load(memory_order_acquire)) >= stream_block)
+                {
+                    uint32_t count = m_decoder->Read(m_decoded.data(), stream_block);
+                    if (count == 0 && m_loop.load(memory_order_relaxed))
+                    {
+                        m_decoder->Rewind();
+                        count = m_decoder->Read(m_decoded.data(), stream_block);
+                    }
+
+                    if (count == 0)
+                    {
+                        m_finished.store(true, memory_order_release);
+                        return;
+                    }
+
+                    const uint64_t write = m_write.load(memory_order_relaxed);
+                    for (uint32_t i = 0; i < count; )
+                    {
+                        const uint32_t offset = static_cast<uint32_t>((write + i) % stream_size);
+                        const uint32_t length = min(count - i, stream_size - offset);
+                        memcpy(m_ring.data() + offset, m_decoded.data() + i, length * sizeof(float));
+                        i += length;
+                    }
+                    m_write.store(write + count, memory_order_release);
+                }
+            }
+
+            string m_file_path;
+            unique_ptr<AudioDecoder> m_decoder;
+            vector<float> m_ring;
+            vector<float> m_decoded;
+            atomic<uint64_t> m_read  = 0;
+            atomic<uint64_t> m_write = 0;
+            atomic<bool> m_loop      = false;
+            atomic<bool> m_finished  = false;
+            atomic<bool> m_refilling = false;
+        };
+
+        enum class VoiceState : uint8_t
+        {
+            Free,    // available to CreateVoice()
+            Alive,   // handed over to the mixer
+            Released // destroyed, the mixer reclaims the slot before its next block
+        };
+
+        struct Voice
+        {
+            // game -> mixer, the mixer takes a snapshot of these at the start of every block
+            atomic<float> gain       = 1.0f;
+            atomic<float> pan        = 0.0f;
+            atomic<float> pitch      = 1.0f;
+            atomic<float> priority   = 1.0f;
+            atomic<bool> loop        = true;
+            atomic<VoiceState> state = VoiceState::Free;
+
+            // mixer -> game
+            atomic<bool> stopped   = false;
+            atomic<float> progress = 0.0f;
+
+            // mixer only, CreateVoice() fills these in while the slot is still free
+            shared_ptr<AudioClip> clip;
+            AudioVoiceParameters parameters;
+            double position  = 0.0;   // in clip samples (for streamed clips, samples since the voice started)
+            float gain_left  = 0.0f;  // gains of the last mixed frame, they ramp towards their targets to avoid clicks
+            float gain_right = 0.0f;
+            bool playing     = false;
+            bool audible     = false; // selected by the last mix
+            bool mixed       = false; // mixed (rather than virtualized) by the last mix
+
+            // streamed clips, the decoded samples around the position
+            shared_ptr<ClipStream> clip_stream;
+            vector<float> window;
+            uint64_t window_start = 0;
+        };
+
+        array<Voice, voice_capacity> voices;
+        atomic<uint32_t> voice_slot_count = 0; // slots that have ever been used, the mixer only looks at these
+        mutex mutex_voices_free;               // only guards the free list, never held while mixing
+        vector<uint32_t> voices_free;
+        vector<pair<float, uint32_t>> voices_ranked;
+        atomic<uint32_t> voice_count       = 0;
+        atomic<uint32_t> voice_budget      = 64;
+        atomic<uint32_t> mixed_voice_count = 0;
+        atomic<uint32_t> underrun_count    = 0;
+        atomic<uint64_t> stream_memory     = 0;
+        uint64_t stream_threshold          = 1024 * 1024; // decoded size above which clips are streamed
+
+        uint32_t sample_rate          = 48000;
+        SDL_AudioDeviceID device      = 0;
+        SDL_AudioStream* stream       = nullptr;
+        vector<float> buffer;         // one block of interleaved stereo frames
+
+        // the mixer runs on its own thread, so that frame hitches on the game thread don't starve the device
+        thread mixer_thread;
+        mutex mutex_mixer_thread;
+        condition_variable condition_mixer_thread;
+        bool mixer_running = false;
+
+        mutex mutex_clips;
+        unordered_map<string, weak_ptr<AudioClip>> clips;
+
+        // scalar version of mix_frames() for frames [first, count), it mixes the frames that don't fill a simd register
+        void mix_frames_scalar(const float* samples, const uint32_t last_index, const double position, const double step, const uint32_t first, const uint32_t count, float* output,
+            const float gain_left, const float gain_right, const float ramp_left, const float ramp_right)
+        {
+            for (uint32_t i = first; i < count; i++)
+            {
+                const double p       = position + i * step;
+                const uint32_t index = min(static_cast<uint32_t>(p), last_index - 1);
+                const float fraction = static_cast<float>(p - index);
+                const float mono     = samples[index] + (samples[index + 1] - samples[index]) * fraction;
+
+                output[i * 2 + 0] += mono * (gain_left  + i * ramp_left);
+                output[i * 2 + 1] += mono * (gain_right + i * ramp_right);
+            }
+        }
+
+        // adds resampled (linearly interpolated) frames of a clip to interleaved stereo output, every index + 1 must be within the clip
+        void mix_frames(const float* samples, const uint32_t last_index, const double position, const double step, const uint32_t count, float* output,
+            const float gain_left, const float gain_right, const float ramp_left, const float ramp_right)
+        {
+            uint32_t i = 0;
+
+        #if defined(__AVX2__)
+            const __m256 lane            = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+            const __m256 step_v          = _mm256_set1_ps(static_cast<float>(step));
+            const __m256i index_max      = _mm256_set1_epi32(static_cast<int32_t>(last_index) - 1);
+            const bool is_unit_step      = step == 1.0 && position == floor(position);
+            for (; i + 8 <= count; i += 8)
+            {
+                // the integer part stays in double precision, only the offsets within the 8 frames are floats
+                const double p             = position + i * step;
+                const double base          = floor(p);
+                const int32_t base_index   = static_cast<int32_t>(base);
+
+                __m256 mono;
+                if (is_unit_step)
+                {
+                    mono = _mm256_loadu_ps(samples + base_index);
+                }
+                else
+                {
+                    const __m256 offset       = _mm256_fmadd_ps(lane, step_v, _mm256_set1_ps(static_cast<float>(p - base)));
+                    const __m256 offset_floor = _mm256_floor_ps(offset);
+                    const __m256 fraction     = _mm256_sub_ps(offset, offset_floor);
+                    __m256i index             = _mm256_add_epi32(_mm256_set1_epi32(base_index), _mm256_cvtps_epi32(offset_floor));
+                    index                     = _mm256_min_epi32(index, index_max);
+                    const __m256 s0           = _mm256_i32gather_ps(samples, index, 4);
+                    const __m256 s1           = _mm256_i32gather_ps(samples + 1, index, 4);
+                    mono                      = _mm256_fmadd_ps(_mm256_sub_ps(s1, s0), fraction, s0);
+                }
+
+                // gain and pan, ramped per frame
+                const __m256 frame = _mm256_add_ps(lane, _mm256_set1_ps(static_cast<float>(i)));
+                const __m256 left  = _mm256_mul_ps(mono, _mm256_fmadd_ps(frame, _mm256_set1_ps(ramp_left),  _mm256_set1_ps(gain_left)));
+                const __m256 right = _mm256_mul_ps(mono, _mm256_fmadd_ps(frame, _mm256_set1_ps(ramp_right), _mm256_set1_ps(gain_right)));
+
+                // interleave into l0 r0 l1 r1 ... and accumulate
+                const __m256 lo = _mm256_unpacklo_ps(left, right);
+                const __m256 hi = _mm256_unpackhi_ps(left, right);
+                float* out      = output + i * 2;
+                _mm256_storeu_ps(out,     _mm256_add_ps(_mm256_loadu_ps(out),     _mm256_permute2f128_ps(lo, hi, 0x20)));
+                _mm256_storeu_ps(out + 8, _mm256_add_ps(_mm256_loadu_ps(out + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+            }
+        #endif
+
+            mix_frames_scalar(samples, last_index, position, step, i, count, output, gain_left, gain_right, ramp_left, ramp_right);
+        }
+
+        double get_step(const Voice& voice)
+        {
+            return static_cast<double>(voice.clip->sample_rate) / sample_rate * voice.parameters.pitch;
+        }
+
+        // wraps or stops a voice that went past the end of its clip
+        void handle_clip_end(Voice& voice)
+        {
+            const double sample_count = static_cast<double>(voice.clip->samples.size());
+            if (voice.position < sample_count)
+                return;
+
+            if (voice.parameters.loop)
+            {
+                voice.position = fmod(voice.position, sample_count);
+            }
+            else
+            {
+                voice.playing = false;
+            }
+        }
+
+        // adds a voice to the output, the gains ramp from where the previous block left them to the targets
+        void mix_voice(Voice& voice, float* output, const uint32_t frame_count, const float target_left, const float target_right)
+        {
+            const vector<float>& samples = voice.clip->samples;
+            const uint32_t last_index    = static_cast<uint32_t>(samples.size()) - 1;
+            const double step            = get_step(voice);
+            const float ramp_left        = (target_left  - voice.gain_left)  / frame_count;
+            const float ramp_right       = (target_right - voice.gain_right) / frame_count;
+            const float gain_left        = voice.gain_left  + ramp_left;
+            const float gain_right       = voice.gain_right + ramp_right;
+
+            uint32_t frame = 0;
+            while (frame < frame_count && voice.playing)
+            {
+                // bulk, frames that interpolate between two samples of the clip
+                const double remaining = static_cast<double>(last_index) - voice.position;
+                const uint32_t count   = remaining > 0.0 ? static_cast<uint32_t>(min(ceil(remaining / step), static_cast<double>(frame_count - frame))) : 0;
+                if (count > 0)
+                {
+                    mix_frames(samples.data(), last_index, voice.position, step, count, output + frame * 2,
+                        gain_left + frame * ramp_left, gain_right + frame * ramp_right, ramp_left, ramp_right);
+
+                    voice.position += count * step;
+                    frame          += count;
+                }
+
+                // tail, the last sample interpolates towards the start of the clip when looping, or towards silence
+                while (frame < frame_count && voice.playing && voice.position >= last_index)
+                {
+                    handle_clip_end(voice);
+                    if (!voice.playing || voice.position < last_index)
+                        break;
+
+                    const float fraction = static_cast<float>(voice.position - last_index);
+                    const float next     = voice.parameters.loop ? samples[0] : 0.0f;
+                    const float mono     = samples[last_index] + (next - samples[last_index]) * fraction;
+                    output[frame * 2 + 0] += mono * (gain_left  + frame * ramp_left);
+                    output[frame * 2 + 1] += mono * (gain_right + frame * ramp_right);
+
+                    voice.position += step;
+                    frame++;
+                }
+
+                handle_clip_end(voice);
+            }
+
+            voice.gain_left  = target_left;
+            voice.gain_right = target_right;
+        }
+
+        // advances a voice without mixing it
+        void advance_voice(Voice& voice, const uint32_t frame_count)
+        {
+            voice.position += frame_count * get_step(voice);
+            handle_clip_end(voice);
+        }
+
+        // tops up the window of a streamed voice with the samples that a block of frames needs
+        void fill_window(Voice& voice, const uint32_t frame_count)
+        {
+            // drop the samples behind the voice, except the one it interpolates from
+            const uint64_t first    = static_cast<uint64_t>(voice.position);
+            const size_t consumed   = static_cast<size_t>(min<uint64_t>(first - voice.window_start, voice.window.size()));
+            voice.window.erase(voice.window.begin(), voice.window.begin() + consumed);
+            voice.window_start     += consumed;
+
+            // the samples of the block, plus one to interpolate towards
+            const uint64_t end    = static_cast<uint64_t>(voice.position + frame_count * get_step(voice)) + 2;
+            const size_t size     = voice.window.size();
+            const size_t required = static_cast<size_t>(end - voice.window_start);
+            if (size < required)
+            {
+                voice.window.resize(required);
+                voice.window.resize(size + voice.clip_stream->Read(voice.window.data() + size, static_cast<uint32_t>(required - size)));
+            }
+
+            ClipStream::RequestRefill(voice.clip_stream);
+        }
+
+        // mixes (or, with a null output, only advances) a streamed voice, if the stream can't keep up the voice stalls
+        void mix_voice_streamed(Voice& voice, float* output, const uint32_t frame_count, const float target_left, const float target_right)
+        {
+            fill_window(voice, frame_count);
+
+            const double step      = get_step(voice);
+            const float ramp_left  = (target_left  - voice.gain_left)  / frame_count;
+            const float ramp_right = (target_right - voice.gain_right) / frame_count;
+            const float gain_left  = voice.gain_left  + ramp_left;
+            const float gain_right = voice.gain_right + ramp_right;
+            const bool finished    = voice.clip_stream->IsFinished();
+
+            uint32_t frame = 0;
+            if (!voice.window.empty())
+            {
+                const uint32_t last_index = static_cast<uint32_t>(voice.window.size()) - 1;
+                const double position     = voice.position - voice.window_start;
+                const double remaining    = last_index - position;
+                const uint32_t count      = remaining > 0.0 ? static_cast<uint32_t>(min(ceil(remaining / step), static_cast<double>(frame_count))) : 0;
+                if (count > 0)
+                {
+                    if (output)
+                    {
+                        mix_frames(voice.window.data(), last_index, position, step, count, output, gain_left, gain_right, ramp_left, ramp_right);
+                    }
+
+                    voice.position += count * step;
+                    frame           = count;
+                }
+
+                // the last sample of a clip that has ended interpolates towards silence
+                while (finished && frame < frame_count && voice.position - voice.window_start < last_index + 1)
+                {
+                    if (output)
+                    {
+                        const float fraction   = static_cast<float>(voice.position - voice.window_start - last_index);
+                        const float mono       = voice.window[last_index] * (1.0f - fraction);
+                        output[frame * 2 + 0] += mono * (gain_left  + frame * ramp_left);
+                        output[frame * 2 + 1] += mono * (gain_right + frame * ramp_right);
+                    }
+
+                    voice.position += step;
+                    frame++;
+                }
+            }
+
+            if (frame < frame_count)
+            {
+                if (finished)
+                {
+                    voice.playing = false;
+                }
+                else
+                {
+                    // the gain only ramps over the frames that were mixed, so a stalled voice still fades in, a voice whose
+                    // stream hasn't delivered its first block yet hasn't started, so that's not counted as an underrun
+                    underrun_count   += voice.position > 0.0 ? 1 : 0;
+                    voice.gain_left  += ramp_left  * frame;
+                    voice.gain_right += ramp_right * frame;
+                    return;
+                }
+            }
+
+            voice.gain_left  = target_left;
+            voice.gain_right = target_right;
+        }
+
+        void clamp_output(float* output, const uint32_t sample_count)
+        {
+            uint32_t i = 0;
+
+        #if defined(__AVX2__)
+            const __m256 one       = _mm256_set1_ps(1.0f);
+            const __m256 minus_one = _mm256_set1_ps(-1.0f);
+            for (; i + 8 <= sample_count; i += 8)
+            {
+                _mm256_storeu_ps(output + i, _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(output + i), one), minus_one));
+            }
+        #endif
+
+            for (; i < sample_count; i++)
+            {
+                output[i] = clamp(output[i], -1.0f, 1.0f);
+            }
+        }
+
+        // game side lookup, only voices that are handed over to the mixer are valid
+        Voice* get_voice(const uint32_t id)
+        {
+            if (id == 0 || id > voice_slot_count.load(memory_order_acquire))
+                return nullptr;
+
+            Voice& voice = voices[id - 1];
+            return voice.state.load(memory_order_acquire) == VoiceState::Alive ? &voice : nullptr;
+        }
+
+        void reset_voice(Voice& voice)
+        {
+            voice.clip         = nullptr;
+            voice.parameters   = AudioVoiceParameters();
+            voice.position     = 0.0;
+            voice.gain_left    = 0.0f;
+            voice.gain_right   = 0.0f;
+            voice.playing      = false;
+            voice.audible      = false;
+            voice.mixed        = false;
+            voice.clip_stream  = nullptr;
+            voice.window_start = 0;
+            voice.window.clear();
+            voice.stopped.store(false, memory_order_relaxed);
+            voice.progress.store(0.0f, memory_order_relaxed);
+        }
+
+        void mixer_loop()
+        {
+            SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
+
+            const int block_size                 = static_cast<int>(block_frames * 2 * sizeof(float));
+            const int queue_size                 = static_cast<int>(latency_frames * 2 * sizeof(float));
+            const chrono::microseconds wait_time = chrono::microseconds(static_cast<int64_t>(block_frames * 1'000'000.0 / sample_rate / 2));
+            chrono::steady_clock::time_point time_previous = chrono::steady_clock::now();
+            double null_device_frames                      = 0.0;
+
+            while (true)
+            {
+                if (stream)
+                {
+                    // keep the device's queue topped up
+                    int queued = SDL_GetAudioStreamQueued(stream);
+                    while (queued >= 0 && queued < queue_size)
+                    {
+                        AudioMixer::Mix(buffer.data(), block_frames);
+                        if (!SDL_PutAudioStreamData(stream, buffer.data(), block_size))
+                        {
+                            SP_LOG_ERROR("%s", SDL_GetError());
+                            break;
+                        }
+
+                        queued += block_size;
+                    }
+                }
+                else
+                {
+                    // null device, mix as many frames as the elapsed time amounts to
+                    const chrono::steady_clock::time_point time_now = chrono::steady_clock::now();
+                    null_device_frames += chrono::duration<double>(time_now - time_previous).count() * sample_rate;
+                    time_previous       = time_now;
+                    while (null_device_frames >= block_frames)
+                    {
+                        AudioMixer::Mix(buffer.data(), block_frames);
+                        null_device_frames -= block_frames;
+                    }
+                }
+
+                // wake up twice per block, the queue holds several blocks so the device never waits on this
+                unique_lock lock(mutex_mixer_thread);
+                if (condition_mixer_thread.wait_for(lock, wait_time, []() { return !mixer_running; }))
+                    break;
+            }
+        }
+
+        void start_mixer_thread()
+        {
+            mixer_running = true;
+            mixer_thread  = thread(&mixer_loop);
+        }
+
+        void stop_mixer_thread()
+        {
+            if (!mixer_thread.joinable())
+                return;
+
+            {
+                lock_guard lock(mutex_mixer_thread);
+                mixer_running = false;
+            }
+            condition_mixer_thread.notify_one();
+            mixer_thread.join();
+        }
+
+        // a second of a 440 Hz sine, at a rate other than the usual device rates so that voices resample
+        shared_ptr<AudioClip> create_test_clip()
+        {
+            shared_ptr<AudioClip> clip = make_shared<AudioClip>();
+            clip->sample_rate          = 44100;
+            clip->samples.resize(clip->sample_rate);
+            for (size_t i = 0; i < clip->samples.size(); i++)
+            {
+                clip->samples[i] = 0.5f * sin(2.0f * 3.14159265f * 440.0f * static_cast<float>(i) / static_cast<float>(clip->sample_rate));
+            }
+            clip->frame_count = clip->samples.size();
+
+            return clip;
+        }
+    }
+
+    void AudioMixer::Initialize()
+    {
+        buffer.assign(block_frames * 2, 0.0f);
+
+        if (!Engine::HasArgument("-audio_null"))
+        {
+            device = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, nullptr);
+            if (device != 0)
+            {
+                // mix at the rate of the device so that the stream only has to convert the format
+                SDL_AudioSpec spec = {};
+                if (SDL_GetAudioDeviceFormat(device, &spec, nullptr))
+                {
+                    sample_rate = static_cast<uint32_t>(spec.freq);
+                }
+
+                spec.freq     = static_cast<int>(sample_rate);
+                spec.format   = SDL_AUDIO_F32;
+                spec.channels = 2;
+                stream        = SDL_CreateAudioStream(&spec, &spec);
+                if (!stream || !SDL_BindAudioStream(device, stream) || !SDL_ResumeAudioDevice(device))
+                {
+                    SP_LOG_ERROR("%s", SDL_GetError());
+                    Shutdown();
+                    buffer.assign(block_frames * 2, 0.0f);
+                }
+            }
+            else
+            {
+                SP_LOG_WARNING("Failed to open an audio device, falling back to a null device: %s", SDL_GetError());
+            }
+        }
+
+        SP_LOG_INFO("Mixing at %u Hz, %s output", sample_rate, stream ? "device" : "null");
+
+        refill_running = true;
+        refill_thread  = thread(&ClipStream::RefillLoop);
+        start_mixer_thread();
+    }
+
+    void AudioMixer::Shutdown()
+    {
+        stop_mixer_thread();
+
+        if (refill_thread.joinable())
+        {
+            {
+                lock_guard lock(mutex_refill);
+                refill_running = false;
+                refill_queue.clear();
+            }
+            condition_refill.notify_one();
+            refill_thread.join();
+        }
+
+        if (stream)
+        {
+            SDL_DestroyAudioStream(stream);
+            stream = nullptr;
+        }
+
+        if (device != 0)
+        {
+            SDL_CloseAudioDevice(device);
+            device = 0;
+        }
+
+        // the mixer is gone, so the voices can be reset from here
+        for (uint32_t i = 0; i < voice_slot_count.load(memory_order_acquire); i++)
+        {
+            reset_voice(voices[i]);
+            voices[i].state.store(VoiceState::Free, memory_order_release);
+        }
+
+        {
+            lock_guard lock(mutex_voices_free);
+            voices_free.clear();
+            voice_slot_count = 0;
+            voice_count      = 0;
+        }
+
+        {
+            lock_guard lock(mutex_clips);
+            clips.clear();
+        }
+
+        buffer.clear();
+    }
+
+    shared_ptr<AudioClip> AudioMixer::LoadClip(const string& file_path)
+    {
+        lock_guard lock(mutex_clips);
+
+        auto it = clips.find(file_path);
+        if (it != clips.end())
+        {
+            if (shared_ptr<AudioClip> clip = it->second.lock())
+                return clip;
+        }
+
+        unique_ptr<AudioDecoder> decoder = AudioDecoder::Create(file_path);
+        if (!decoder)
+        {
+            SP_LOG_ERROR("Failed to decode \"%s\"", file_path.c_str());
+            return nullptr;
+        }
+
+        shared_ptr<AudioClip> clip = make_shared<AudioClip>();
+        clip->file_path            = file_path;
+        clip->frame_count          = decoder->GetFrameCount();
+        clip->sample_rate          = decoder->GetSampleRate();
+        clip->streamed             = !decoder->IsResident() && clip->frame_count * sizeof(float) > stream_threshold;
+
+        // short clips are decoded now, long ones when (and as) they play
+        if (!clip->streamed)
+        {
+            clip->samples.resize(static_cast<size_t>(clip->frame_count));
+            uint64_t decoded = 0;
+            while (decoded < clip->frame_count)
+            {
+                const uint32_t count = decoder->Read(clip->samples.data() + decoded, static_cast<uint32_t>(min<uint64_t>(clip->frame_count - decoded, stream_block)));
+                if (count == 0)
+                    break;
+
+                decoded += count;
+            }
+
+            clip->samples.resize(static_cast<size_t>(decoded));
+            clip->frame_count = decoded;
+        }
+
+        clips[file_path] = clip;
+        return clip;
+    }
+
+    uint64_t AudioMixer::GetStreamingThreshold()
+    {
+        return stream_threshold;
+    }
+
+    void AudioMixer::SetStreamingThreshold(const uint64_t bytes)
+    {
+        lock_guard lock(mutex_clips);
+        stream_threshold = bytes;
+    }
+
+    uint32_t AudioMixer::CreateVoice(const shared_ptr<AudioClip>& clip, const AudioVoiceParameters& parameters)
+    {
+        if (!clip || clip->frame_count == 0 || clip->sample_rate == 0)
+            return 0;
+
+        uint32_t index = 0;
+        {
+            lock_guard lock(mutex_voices_free);
+
+            if (!voices_free.empty())
+            {
+                index = voices_free.back();
+                voices_free.pop_back();
+            }
+            else if (voice_slot_count.load(memory_order_relaxed) < voice_capacity)
+            {
+                index = voice_slot_count.fetch_add(1, memory_order_acq_rel);
+            }
+            else
+            {
+                SP_LOG_WARNING("All %u voices are in use", voice_capacity);
+                return 0;
+            }
+        }
+
+        // the slot is free, so the mixer doesn't look at it until it's handed over
+        Voice& voice     = voices[index];
+        voice.clip       = clip;
+        voice.parameters = parameters;
+        voice.playing    = true;
+        voice.gain.store(parameters.gain, memory_order_relaxed);
+        voice.pan.store(parameters.pan, memory_order_relaxed);
+        voice.pitch.store(parameters.pitch, memory_order_relaxed);
+        voice.priority.store(parameters.priority, memory_order_relaxed);
+        voice.loop.store(parameters.loop, memory_order_relaxed);
+
+        // streamed clips start decoding right away, the voice is silent until the first block arrives
+        if (clip->streamed)
+        {
+            voice.clip_stream = make_shared<ClipStream>(clip->file_path, parameters.loop);
+            ClipStream::RequestRefill(voice.clip_stream);
+        }
+
+        voice.state.store(VoiceState::Alive, memory_order_release);
+        voice_count++;
+
+        return index + 1;
+    }
+
+    void AudioMixer::DestroyVoice(const uint32_t id)
+    {
+        // the mixer reclaims the slot, as it may be mixing it right now
+        VoiceState state = VoiceState::Alive;
+        Voice* voice     = get_voice(id);
+        if (voice && voice->state.compare_exchange_strong(state, VoiceState::Released, memory_order_acq_rel))
+        {
+            voice_count--;
+        }
+    }
+
+    void AudioMixer::SetVoiceParameters(const uint32_t id, const AudioVoiceParameters& parameters)
+    {
+        if (Voice* voice = get_voice(id))
+        {
+            voice->gain.store(parameters.gain, memory_order_relaxed);
+            voice->pan.store(parameters.pan, memory_order_relaxed);
+            voice->pitch.store(parameters.pitch, memory_order_relaxed);
+            voice->priority.store(parameters.priority, memory_order_relaxed);
+            voice->loop.store(parameters.loop, memory_order_relaxed);
+        }
+    }
+
+    bool AudioMixer::IsVoicePlaying(const uint32_t id)
+    {
+        Voice* voice = get_voice(id);
+        return voice && !voice->stopped.load(memory_order_relaxed);
+    }
+
+    float AudioMixer::GetVoiceProgress(const uint32_t id)
+    {
+        Voice* voice = get_voice(id);
+        return voice ? voice->progress.load(memory_order_relaxed) : 0.0f;
+    }
+
+    void AudioMixer::Mix(float* output, const uint32_t frame_count)
+    {
+        memset(output, 0, frame_count * 2 * sizeof(float));
+
+        // reclaim released voices and snapshot the parameters of the live ones
+        const uint32_t slot_count = voice_slot_count.load(memory_order_acquire);
+        for (uint32_t i = 0; i < slot_count; i++)
+        {
+            Voice& voice           = voices[i];
+            const VoiceState state = voice.state.load(memory_order_acquire);
+            if (state == VoiceState::Released)
+            {
+                reset_voice(voice);
+                voice.state.store(VoiceState::Free, memory_order_release);
+
+                lock_guard lock(mutex_voices_free);
+                voices_free.emplace_back(i);
+            }
+            else if (state == VoiceState::Alive)
+            {
+                voice.parameters.gain     = voice.gain.load(memory_order_relaxed);
+                voice.parameters.pan      = voice.pan.load(memory_order_relaxed);
+                voice.parameters.pitch    = voice.pitch.load(memory_order_relaxed);
+                voice.parameters.priority = voice.priority.load(memory_order_relaxed);
+                voice.parameters.loop     = voice.loop.load(memory_order_relaxed);
+                if (voice.clip_stream)
+                {
+                    voice.clip_stream->SetLoop(voice.parameters.loop);
+                }
+            }
+        }
+
+        // rank the audible voices, the budget goes to the loudest ones (weighted by their priority)
+        const uint32_t budget = voice_budget.load(memory_order_relaxed);
+        voices_ranked.clear();
+        for (uint32_t i = 0; i < slot_count; i++)
+        {
+            Voice& voice  = voices[i];
+            voice.audible = false;
+            if (voice.state.load(memory_order_relaxed) == VoiceState::Alive && voice.playing && voice.parameters.gain > audible_gain)
+            {
+                voices_ranked.emplace_back(voice.parameters.gain * voice.parameters.priority, i);
+            }
+        }
+
+        if (voices_ranked.size() > budget)
+        {
+            nth_element(voices_ranked.begin(), voices_ranked.begin() + budget, voices_ranked.end(), greater<pair<float, uint32_t>>());
+            voices_ranked.resize(budget);
+        }
+
+        for (const pair<float, uint32_t>& ranked : voices_ranked)
+        {
+            voices[ranked.second].audible = true;
+        }
+
+        // mix
+        uint32_t mixed  = 0;
+        uint64_t memory = 0;
+        for (uint32_t i = 0; i < slot_count; i++)
+        {
+            Voice& voice = voices[i];
+            if (voice.state.load(memory_order_relaxed) != VoiceState::Alive)
+                continue;
+
+            if (voice.clip_stream)
+            {
+                memory += (stream_size + stream_block + voice.window.capacity()) * sizeof(float);
+            }
+
+            if (!voice.playing)
+                continue;
+
+            if (voice.audible)
+            {
+                // voices that become audible fade in
+                if (!voice.mixed)
+                {
+                    voice.gain_left  = 0.0f;
+                    voice.gain_right = 0.0f;
+                }
+
+                // constant power panning
+                const float pan   = clamp(voice.parameters.pan, -1.0f, 1.0f);
+                const float left  = voice.parameters.gain * sqrt(0.5f * (1.0f - pan));
+                const float right = voice.parameters.gain * sqrt(0.5f * (1.0f + pan));
+                if (voice.clip_stream)
+                {
+                    mix_voice_streamed(voice, output, frame_count, left, right);
+                }
+                else
+                {
+                    mix_voice(voice, output, frame_count, left, right);
+                }
+                voice.mixed = true;
+                mixed++;
+            }
+            else if (voice.mixed)
+            {
+                // voices that become virtual fade out over one more block
+                if (voice.clip_stream)
+                {
+                    mix_voice_streamed(voice, output, frame_count, 0.0f, 0.0f);
+                }
+                else
+                {
+                    mix_voice(voice, output, frame_count, 0.0f, 0.0f);
+                }
+                voice.mixed = false;
+                mixed++;
+            }
+            else if (voice.clip_stream)
+            {
+                // virtual streamed voices keep consuming their stream
+                mix_voice_streamed(voice, nullptr, frame_count, 0.0f, 0.0f);
+            }
+            else
+            {
+                advance_voice(voice, frame_count);
+            }
+
+            // publish what the game can query
+            const double clip_frames = static_cast<double>(voice.clip->frame_count);
+            voice.progress.store(static_cast<float>(fmod(voice.position, clip_frames) / clip_frames), memory_order_relaxed);
+            voice.stopped.store(!voice.playing, memory_order_relaxed);
+        }
+        mixed_voice_count.store(mixed, memory_order_relaxed);
+        stream_memory.store(memory, memory_order_relaxed);
+
+        clamp_output(output, frame_count * 2);
+    }
+
+    uint32_t AudioMixer::GetSampleRate()
+    {
+        return sample_rate;
+    }
+
+    bool AudioMixer::IsNullDevice()
+    {
+        return stream == nullptr;
+    }
+
+    uint32_t AudioMixer::GetVoiceBudget()
+    {
+        return voice_budget;
+    }
+
+    void AudioMixer::SetVoiceBudget(const uint32_t budget)
+    {
+        voice_budget = budget;
+    }
+
+    uint32_t AudioMixer::GetVoiceCount()
+    {
+        return voice_count;
+    }
+
+    uint32_t AudioMixer::GetMixedVoiceCount()
+    {
+        return mixed_voice_count;
+    }
+
+    uint32_t AudioMixer::GetUnderrunCount()
+    {
+        return underrun_count;
+    }
+
+    uint64_t AudioMixer::GetMemoryUsage()
+    {
+        uint64_t size = stream_memory.load(memory_order_relaxed);
+
+        lock_guard lock(mutex_clips);
+        for (const auto& [file_path, clip_weak] : clips)
+        {
+            if (shared_ptr<AudioClip> clip = clip_weak.lock())
+            {
+                size += clip->samples.capacity() * sizeof(float);
+            }
+        }
+
+        return size;
+    }
+
+    bool AudioMixer::Test()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Audio mixer %s failed", name);
+                passed = false;
+            }
+        };
+
+        stop_mixer_thread();
+        const uint32_t budget_previous = voice_budget;
+        shared_ptr<AudioClip> clip     = create_test_clip();
+        vector<float> output(block_frames * 2);
+
+        // simd against scalar, unit steps (on and off a sample), resampling and pitch, with gain ramps and a scalar tail
+        {
+            const uint32_t last_index = static_cast<uint32_t>(clip->samples.size()) - 1;
+            const uint32_t count      = block_frames - 3;
+            const double steps[]      = { 1.0, 44100.0 / 48000.0, 1.37, 0.5 };
+            const double positions[]  = { 0.0, 100.0, 100.25 };
+            float error_max           = 0.0f;
+            for (const double step : steps)
+            {
+                for (const double position : positions)
+                {
+                    vector<float> simd(block_frames * 2, 0.1f); // not silent, the frames are added to what's there
+                    vector<float> scalar(block_frames * 2, 0.1f);
+                    mix_frames(clip->samples.data(), last_index, position, step, count, simd.data(), 0.3f, 0.7f, 1e-4f, -2e-4f);
+                    mix_frames_scalar(clip->samples.data(), last_index, position, step, 0, count, scalar.data(), 0.3f, 0.7f, 1e-4f, -2e-4f);
+                    for (size_t i = 0; i < simd.size(); i++)
+                    {
+                        error_max = max(error_max, abs(simd[i] - scalar[i]));
+                    }
+                }
+            }
+            expect("simd matches scalar", error_max < 1e-4f);
+        }
+
+        // 32 voices over a budget of 8, the loudest are mixed and the rest are virtual
+        {
+            voice_budget = 8;
+            vector<uint32_t> ids;
+            for (uint32_t i = 0; i < 32; i++)
+            {
+                AudioVoiceParameters parameters;
+                parameters.gain = static_cast<float>(i + 1) / 32.0f;
+                parameters.pan  = -1.0f + 2.0f * static_cast<float>(i) / 31.0f;
+                ids.emplace_back(CreateVoice(clip, parameters));
+            }
+            expect("voices created", GetVoiceCount() == 32 && find(ids.begin(), ids.end(), 0u) == ids.end());
+
+            Mix(output.data(), block_frames);
+            bool loudest_mixed = true;
+            for (uint32_t i = 0; i < 32; i++)
+            {
+                loudest_mixed = loudest_mixed && get_voice(ids[i])->mixed == (i >= 24);
+            }
+            expect("budget", GetMixedVoiceCount() == 8);
+            expect("loudest mixed", loudest_mixed);
+
+            // the quietest voice becomes the loudest, the voice it displaces fades out over one more block
+            AudioVoiceParameters parameters;
+            parameters.gain = 2.0f;
+            SetVoiceParameters(ids[0], parameters);
+            Mix(output.data(), block_frames);
+            expect("displaced voice fades out", GetMixedVoiceCount() == 9 && get_voice(ids[0])->mixed && !get_voice(ids[24])->audible);
+            Mix(output.data(), block_frames);
+            expect("budget after the fade", GetMixedVoiceCount() == 8 && !get_voice(ids[24])->mixed);
+
+            bool clamped = true;
+            for (const float sample : output)
+            {
+                clamped = clamped && sample >= -1.0f && sample <= 1.0f;
+            }
+            expect("output clamped", clamped);
+
+            // same clip, same pitch and started together, so mixed and virtual voices must be at the same point
+            float progress_min = 1.0f;
+            float progress_max = 0.0f;
+            for (uint32_t id : ids)
+            {
+                progress_min = min(progress_min, GetVoiceProgress(id));
+                progress_max = max(progress_max, GetVoiceProgress(id));
+            }
+            expect("virtual voices keep time", progress_max > 0.0f && progress_max - progress_min < 1e-6f);
+
+            for (uint32_t id : ids)
+            {
+                DestroyVoice(id);
+            }
+            expect("voices destroyed", GetVoiceCount() == 0);
+            Mix(output.data(), block_frames);
+            expect("slots reclaimed", GetMixedVoiceCount() == 0 && voices_free.size() >= ids.size());
+        }
+
+        // voices that don't loop stop at the end of the clip, whether they are mixed or virtual
+        {
+            voice_budget = 1;
+            AudioVoiceParameters parameters;
+            parameters.loop           = false;
+            const uint32_t id_mixed   = CreateVoice(clip, parameters);
+            parameters.gain           = 0.5f;
+            const uint32_t id_virtual = CreateVoice(clip, parameters);
+
+            const double frames_to_end = static_cast<double>(clip->frame_count) * sample_rate / clip->sample_rate;
+            const uint32_t block_count = static_cast<uint32_t>(ceil(frames_to_end / block_frames));
+            for (uint32_t i = 0; i + 1 < block_count; i++)
+            {
+                Mix(output.data(), block_frames);
+            }
+            expect("playing before the end", IsVoicePlaying(id_mixed) && IsVoicePlaying(id_virtual));
+
+            Mix(output.data(), block_frames);
+            Mix(output.data(), block_frames);
+            expect("stopped at the end", !IsVoicePlaying(id_mixed) && !IsVoicePlaying(id_virtual));
+
+            DestroyVoice(id_mixed);
+            DestroyVoice(id_virtual);
+            Mix(output.data(), block_frames);
+        }
+
+        voice_budget = budget_previous;
+        start_mixer_thread();
+
+        return passed;
+    }
+
+    void AudioMixer::Benchmark(const uint32_t voice_count)
+    {
+        stop_mixer_thread();
+        const uint32_t budget_previous = voice_budget;
+        shared_ptr<AudioClip> clip     = create_test_clip();
+        vector<float> output(block_frames * 2);
+
+        // simd against scalar, resampling from 44.1 KHz
+        const uint32_t last_index = static_cast<uint32_t>(clip->samples.size()) - 1;
+        const double step         = 44100.0 / 48000.0;
+        const uint32_t run_count  = 20000;
+        double simd_ms            = 0.0;
+        double scalar_ms          = 0.0;
+        {
+            Stopwatch timer;
+            for (uint32_t i = 0; i < run_count; i++)
+            {
+                mix_frames(clip->samples.data(), last_index, static_cast<double>(i % 1000) * 10.25, step, block_frames, output.data(), 0.5f, 0.5f, 0.0f, 0.0f);
+            }
+            simd_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+
+            timer.Start();
+            for (uint32_t i = 0; i < run_count; i++)
+            {
+                mix_frames_scalar(clip->samples.data(), last_index, static_cast<double>(i % 1000) * 10.25, step, 0, block_frames, output.data(), 0.5f, 0.5f, 0.0f, 0.0f);
+            }
+            scalar_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+        }
+
+        // looping voices at random gains and pitches, every one of them mixed and then only the budget
+        mt19937 generator(0); // fixed seed, so runs are comparable
+        uniform_real_distribution<float> gain(0.01f, 1.0f);
+        uniform_real_distribution<float> pitch(0.5f, 2.0f);
+        vector<uint32_t> ids;
+        for (uint32_t i = 0; i < voice_count; i++)
+        {
+            AudioVoiceParameters parameters;
+            parameters.gain  = gain(generator);
+            parameters.pitch = pitch(generator);
+            ids.emplace_back(CreateVoice(clip, parameters));
+        }
+
+        const uint32_t block_count = 200;
+        auto time_blocks = [&output, block_count]()
+        {
+            Mix(output.data(), block_frames); // settles the fades
+            Mix(output.data(), block_frames);
+            const Stopwatch timer;
+            for (uint32_t i = 0; i < block_count; i++)
+            {
+                Mix(output.data(), block_frames);
+            }
+            return max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6) * 1000.0 / block_count;
+        };
+        voice_budget                = voice_count;
+        const double all_us         = time_blocks();
+        const uint32_t all_mixed    = GetMixedVoiceCount();
+        voice_budget                = budget_previous;
+        const double budget_us      = time_blocks();
+        const uint32_t budget_mixed = GetMixedVoiceCount();
+
+        for (uint32_t id : ids)
+        {
+            DestroyVoice(id);
+        }
+        Mix(output.data(), block_frames);
+        start_mixer_thread();
+
+        const double block_us = block_frames * 1'000'000.0 / sample_rate;
+        SP_LOG_INFO("Audio mixer, %u voices: all mixed %.1f us per block (%u mixed, %.1f%% of real time), within the budget %.1f us per block (%u mixed, %.1f%% of real time), simd %.1f M frames/sec, scalar %.1f M frames/sec, %.1fx",
+            voice_count,
+            all_us,
+            all_mixed,
+            all_us / block_us * 100.0,
+            budget_us,
+            budget_mixed,
+            budget_us / block_us * 100.0,
+            static_cast<double>(run_count) * block_frames / simd_ms / 1e3,
+            static_cast<double>(run_count) * block_frames / scalar_ms / 1e3,
+            scalar_ms / simd_ms);
+    }
+
+    bool AudioMixer::TestStreaming()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Audio streaming %s failed", name);
+                passed = false;
+            }
+        };
+
+        // a 16-bit mono wav of 20 seconds, 3.4 MB once decoded, so above the default streaming threshold
+        const string file_path     = FileSystem::GetWorkingDirectory() + "/test_audio_streaming.wav";
+        const uint32_t clip_rate   = 44100;
+        const uint32_t clip_frames = clip_rate * 20;
+        {
+            ofstream file(file_path, ios::binary);
+            auto write = [&file](const auto value) { file.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+            file.write("RIFF", 4);
+            write(static_cast<uint32_t>(36 + clip_frames * 2));
+            file.write("WAVEfmt ", 8);
+            write(uint32_t(16));
+            write(uint16_t(1)); // pcm
+            write(uint16_t(1)); // mono
+            write(clip_rate);
+            write(clip_rate * 2);
+            write(uint16_t(2));
+            write(uint16_t(16));
+            file.write("data", 4);
+            write(clip_frames * 2);
+
+            vector<int16_t> samples(clip_frames);
+            for (uint32_t i = 0; i < clip_frames; i++)
+            {
+                samples[i] = static_cast<int16_t>(16000.0f * sin(2.0f * 3.14159265f * 440.0f * static_cast<float>(i) / static_cast<float>(clip_rate)));
+            }
+            file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(int16_t));
+        }
+
+        stop_mixer_thread();
+        const uint32_t budget_previous    = voice_budget;
+        const uint64_t threshold_previous = GetStreamingThreshold();
+        SetStreamingThreshold(1024 * 1024);
+
+        shared_ptr<AudioClip> clip = LoadClip(file_path);
+        expect("load", clip != nullptr);
+        if (clip)
+        {
+            expect("streamed above the threshold", clip->streamed && clip->samples.empty() && clip->frame_count == clip_frames);
+
+            // 16 voices over a budget of 8, the virtual ones consume their streams too, some play faster than real time
+            voice_budget = 8;
+            vector<uint32_t> ids;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                AudioVoiceParameters parameters;
+                parameters.gain  = static_cast<float>(i + 1) / 16.0f;
+                parameters.pitch = i % 4 == 0 ? 1.5f : 1.0f;
+                ids.emplace_back(CreateVoice(clip, parameters));
+            }
+
+            // three seconds of audio, a block at a time, at the pace of a device
+            const uint32_t underruns_previous = GetUnderrunCount();
+            const uint32_t block_count        = static_cast<uint32_t>(3.0 * sample_rate / block_frames);
+            const auto block_duration         = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(static_cast<double>(block_frames) / sample_rate));
+            auto deadline                     = chrono::steady_clock::now();
+            uint64_t memory_max               = 0;
+            vector<float> output(block_frames * 2);
+            for (uint32_t i = 0; i < block_count; i++)
+            {
+                Mix(output.data(), block_frames);
+                memory_max = max(memory_max, stream_memory.load(memory_order_relaxed));
+
+                deadline += block_duration;
+                this_thread::sleep_until(deadline);
+            }
+            expect("no underruns", GetUnderrunCount() == underruns_previous);
+
+            bool all_playing = true;
+            for (uint32_t id : ids)
+            {
+                all_playing = all_playing && IsVoicePlaying(id) && GetVoiceProgress(id) > 0.0f;
+            }
+            expect("voices playing", all_playing);
+
+            // a ring buffer, a decode block and a block's window per voice, instead of the decoded clip
+            const uint64_t memory_per_voice = (stream_size + stream_block + 2 * block_frames + 2) * sizeof(float);
+            expect("memory bounded by the stream buffers", memory_max > 0 && memory_max <= ids.size() * memory_per_voice);
+            expect("memory below a resident clip", memory_max < clip_frames * sizeof(float));
+            if (memory_max > ids.size() * memory_per_voice)
+            {
+                SP_LOG_ERROR("Audio streaming used %.1f KB, the bound is %.1f KB", memory_max / 1024.0, ids.size() * memory_per_voice / 1024.0);
+            }
+
+            // destroyed voices give their stream buffers back
+            for (uint32_t id : ids)
+            {
+                DestroyVoice(id);
+            }
+            Mix(output.data(), block_frames);
+            Mix(output.data(), block_frames);
+            expect("memory released", stream_memory.load(memory_order_relaxed) == 0);
+        }
+
+        // below the threshold, the same clip is resident
+        clip = nullptr;
+        SetStreamingThreshold(clip_frames * sizeof(float) + 1);
+        clip = LoadClip(file_path);
+        expect("resident below the threshold", clip && !clip->streamed && clip->samples.size() == clip_frames && GetMemoryUsage() >= clip_frames * sizeof(float));
+        clip = nullptr;
+
+        SetStreamingThreshold(threshold_previous);
+        voice_budget = budget_previous;
+        start_mixer_thread();
+        FileSystem::Delete(file_path);
+
+        return passed;
+    }
+}
@@ -0,0 +1,96 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =====
+#include <memory>
+#include <string>
+#include <vector>
+//================
+
+namespace spartan
+{
+    // mono 32-bit float samples, shared by every voice that plays them
+    // - short clips are decoded once and stay resident
+    // - long clips are streamed, every voice decodes them a block at a time on the refill thread
+    struct AudioClip
+    {
+        std::vector<float> samples; // resident clips only
+        std::string file_path;
+        uint64_t frame_count = 0;
+        uint32_t sample_rate = 0;
+        bool streamed        = false;
+    };
+
+    struct AudioVoiceParameters
+    {
+        float gain     = 1.0f;
+        float pan      = 0.0f; // -1.0 (left) to 1.0 (right)
+        float pitch    = 1.0f;
+        float priority = 1.0f; // when over budget, the voices with the lowest priority * gain are virtualized
+        bool loop      = true;
+    };
+
+    // mixes every voice into a single stereo stream which feeds the output device
+    // - mixing happens on a dedicated thread, voice parameters are handed to it without locks and picked up once per block
+    // - the loudest voices within the voice budget are mixed, the rest are virtual, they keep time but cost nothing
+    // - with a null device (-audio_null, or when no device can be opened) voices are mixed and discarded, useful for headless runs
+    class AudioMixer
+    {
+    public:
+        static void Initialize();
+        static void Shutdown();
+
+        // clips, the ones that decode to more than the streaming threshold are streamed
+        static std::shared_ptr<AudioClip> LoadClip(const std::string& file_path);
+        static uint64_t GetStreamingThreshold();
+        static void SetStreamingThreshold(const uint64_t bytes);
+
+        // voices, a voice that reaches the end of a clip which doesn't loop stops but stays valid until it's destroyed
+        static uint32_t CreateVoice(const std::shared_ptr<AudioClip>& clip, const AudioVoiceParameters& parameters);
+        static void DestroyVoice(const uint32_t id);
+        static void SetVoiceParameters(const uint32_t id, const AudioVoiceParameters& parameters);
+        static bool IsVoicePlaying(const uint32_t id);
+        static float GetVoiceProgress(const uint32_t id);
+
+        // mixes interleaved stereo frames at the mixer's sample rate, called by the mixer thread
+        static void Mix(float* output, const uint32_t frame_count);
+
+        // properties
+        static uint32_t GetSampleRate();
+        static bool IsNullDevice();
+        static uint32_t GetVoiceBudget();
+        static void SetVoiceBudget(const uint32_t budget);
+
+        // stats
+        static uint32_t GetVoiceCount();
+        static uint32_t GetMixedVoiceCount(); // voices that were mixed by the last Mix()
+        static uint32_t GetUnderrunCount();   // blocks in which a streamed voice ran out of decoded samples
+        static uint64_t GetMemoryUsage();     // resident clips and stream buffers, in bytes
+
+        // tests and benchmarks, they pause the mixer thread and drive Mix() by hand, like a null device, so they need no audio hardware
+        static bool Test();                                      // voice budget, virtualization, clip ends and simd against scalar mixing
+        static bool TestStreaming();                             // streamed voices at the pace of a device, no underruns and bounded memory
+        static void Benchmark(const uint32_t voice_count = 512); // cost of a block, within and over the voice budget, and of simd mixing
+    };
+}
@@ -25,9 +25,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "ThreadPool.h"
 #include "../Input/Input.h"
 #include "../World/World.h"
+#include "../World/WorldCommandBuffer.h"
+#include "../World/TerrainQuadtree.h"
+#include "../World/Prefab.h"
 #include "../Physics/PhysicsWorld.h"
+#include "../Audio/AudioMixer.h"
 #include "../Profiling/Profiler.h"
 #include "../Rendering/Renderer.h"
+#include "../Rendering/TextureStreaming.h"
+#include "../Rendering/GeometryPool.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/Import/FontImporter.h"
 #include "../Resource/Import/ModelImporter.h"
@@ -35,6 +41,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../Display/Display.h"
 #include "../Game/Game.h"
 #include "../Memory/Allocator.h"
+#include "../Memory/RangeAllocator.h"
+#include "../Math/Noise.h"
+#include "../Geometry/Mesh.h"
+#include "../Geometry/MeshBvh.h"
+#include "../World/Components/Terrain.h"
+#include "../World/Components/Physics.h"
+#include "../World/Components/Animator.h"
 //===========================================
 
 //= NAMESPACES ===============
@@ -61,6 +74,61 @@ namespace spartan
                 }
             }
         }
+
+        // small deterministic checks which run headless, -test_<name> runs one of them, -test_all runs all of them
+        struct Test
+        {
+            const char* name;
+            bool (*run)();
+        };
+
+        const Test tests[] =
+        {
+            { "erosion",             &Terrain::TestErosion },
+            { "prop_placement",      &Terrain::TestPropPlacement },
+            { "terrain_cache",       &Terrain::TestCache },
+            { "terrain_quadtree",    &TerrainQuadtree::Test },
+            { "height_field",        &Physics::TestHeightField },
+            { "noise",               &Noise::Test },
+            { "mips",                &RHI_Texture::TestMips },
+            { "texture_cache",       &RHI_Texture::TestTextureCache },
+            { "texture_streaming",   &TextureStreaming::Test },
+            { "native_format",       &RHI_Texture::TestNativeFormat },
+            { "incremental_save",    &World::TestIncrementalSave },
+            { "world_streaming",     &World::TestStreaming },
+            { "command_buffer",      &WorldCommandBuffer::Test },
+            { "vertex_quantization", &Mesh::TestVertexQuantization },
+            { "cluster_culling",     &Mesh::TestClusterCulling },
+            { "shared_sub_meshes",   &ModelImporter::TestSharedSubMeshes },
+            { "mesh_bvh",            &MeshBvh::Test },
+            { "range_allocator",     &RangeAllocator::Test },
+            { "geometry_pool",       &GeometryPool::Test },
+            { "audio_mixer",         &AudioMixer::Test },
+            { "audio_streaming",     &AudioMixer::TestStreaming }
+        };
+
+        uint32_t test_failures = 0;
+
+        void run_tests()
+        {
+            const bool run_all = Engine::HasArgument("-test_all");
+            for (const Test& test : tests)
+            {
+                if (!run_all && !Engine::HasArgument(string("-test_") + test.name))
+                    continue;
+
+                Stopwatch timer;
+                if (test.run())
+                {
+                    SP_LOG_INFO("Test \"%s\" passed (%.1f ms)", test.name, timer.GetElapsedTimeMs());
+                }
+                else
+                {
+                    SP_LOG_ERROR("Test \"%s\" failed (%.1f ms)", test.name, timer.GetElapsedTimeMs());
+                    test_failures++;
+                }
+            }
+        }
     }
 
     void Engine::Initialize(const vector<string>& args)
@@ -85,6 +153,7 @@ namespace spartan
             ResourceCache::Initialize();
             Profiler::Initialize();
             PhysicsWorld::Initialize();
+            AudioMixer::Initialize(); // after the window, which initializes sdl's audio subsystem
             Renderer::Initialize();
             World::Initialize();
             Settings::Initialize();
@@ -95,8 +164,61 @@ namespace spartan
             ResourceCache::LoadDefaultResources(); // requires rhi to be initialized so they can be uploaded to the gpu
         }
 
+        if (HasArgument("-benchmark_noise"))
+        {
+            Noise::Benchmark();
+        }
+
+        if (HasArgument("-benchmark_texture_compression"))
+        {
+            RHI_Texture::BenchmarkCompression();
+        }
+
+        if (HasArgument("-benchmark_tangents"))
+        {
+            Terrain::BenchmarkNormals();
+            ModelImporter::BenchmarkTangents();
+        }
+
+        if (HasArgument("-benchmark_mesh_load"))
+        {
+            Mesh::BenchmarkLoad();
+        }
+
+        if (HasArgument("-benchmark_component_iteration"))
+        {
+            World::BenchmarkForEach();
+        }
+
+        if (HasArgument("-benchmark_prefab"))
+        {
+            Prefab::Benchmark();
+        }
+
+        if (HasArgument("-benchmark_mesh_bvh"))
+        {
+            MeshBvh::Benchmark();
+        }
+
+        if (HasArgument("-benchmark_animator"))
+        {
+            Animator::Benchmark();
+        }
+
+        if (HasArgument("-benchmark_audio_mixer"))
+        {
+            AudioMixer::Benchmark();
+        }
+
+        if (HasArgument("-benchmark_terrain_collision"))
+        {
+            Physics::BenchmarkTerrainCollision();
+        }
+
+        run_tests();
+
         SP_LOG_INFO("%s has been initialized. Duration %.1f sec", version::c_str(), timer_initialize.GetElapsedTimeSec());
-        SP_SUBSCRIBE_TO_EVENT(EventType::RendererOnFirstFrameCompleted, SP_EVENT_HANDLER_EXPRESSION_STATIC(write_ci_test_file(0);));
+        SP_SUBSCRIBE_TO_EVENT(EventType::RendererOnFirstFrameCompleted, SP_EVENT_HANDLER_EXPRESSION_STATIC(write_ci_test_file(test_failures == 0 ? 0 : 1);));
     }
 
     void Engine::Shutdown()
@@ -111,6 +233,7 @@ namespace spartan
         ResourceCache::UnloadDefaultResources();
 
         World::Shutdown();
+        AudioMixer::Shutdown();
         PhysicsWorld::Shutdown();
         Renderer::Shutdown();
    
@@ -161,21 +161,21 @@ namespace spartan
         return fut;
     }
 
-    void ThreadPool::ParallelLoop(function<void(uint32_t, uint32_t)>&& function, const uint32_t work_total)
+    void ThreadPool::ParallelLoop(function<void(uint32_t, uint32_t)>&& function, const uint32_t work_total, const uint32_t worker_count)
     {
         // ensure there is at least one unit of work
         SP_ASSERT_MSG(work_total > 0, "a parallel loop must have a work_total of at least 1");
 
         // if all worker threads are busy or there are no threads,
         // run the work serially on the calling thread to avoid deadlock
-        if (GetWorkingThreadCount() == thread_count || threads.empty())
+        if (GetWorkingThreadCount() == thread_count || threads.empty() || worker_count == 1)
         {
             function(0, work_total);
             return;
         }
 
-        // decide how many workers will be used (at least 1)
-        uint32_t workers = max(1u, thread_count);
+        // decide how many workers will be used (at least 1), more workers than threads just queue up
+        uint32_t workers = max(1u, worker_count != 0 ? worker_count : thread_count);
 
         // divide the work as evenly as possible among workers
         uint32_t base_work = work_total / workers; // minimum amount of work per worker
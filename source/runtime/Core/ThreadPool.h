@@ -39,8 +39,8 @@ namespace spartan
         // add a task
         static std::future<void> AddTask(Task&& task);
 
-        // spread execution of a given function across all available threads
-        static void ParallelLoop(std::function<void(uint32_t work_index_start, uint32_t work_index_end)>&& function, const uint32_t work_total);
+        // spread execution of a given function across all available threads, or across a given number of work ranges
+        static void ParallelLoop(std::function<void(uint32_t work_index_start, uint32_t work_index_end)>&& function, const uint32_t work_total, const uint32_t worker_count = 0);
 
         // wait for all threads to finish work
         static void Flush(bool remove_queued = false);
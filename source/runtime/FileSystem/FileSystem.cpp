@@ -548,6 +548,21 @@ namespace spartan
         return components;
     }
 
+    uint64_t FileSystem::GetFileStamp(const string& path)
+    {
+        error_code ec;
+        const uintmax_t size = filesystem::file_size(path, ec);
+        if (ec)
+            return 0;
+
+        const filesystem::file_time_type time = filesystem::last_write_time(path, ec);
+        if (ec)
+            return 0;
+
+        const uint64_t stamp = math::hash_combine(static_cast<uint64_t>(size), static_cast<uint64_t>(time.time_since_epoch().count()));
+        return stamp != 0 ? stamp : 1;
+    }
+
     string FileSystem::GetLastWriteTime(const string& path)
     {
         try
@@ -570,16 +585,19 @@ namespace spartan
         }
     }
 
-    void FileSystem::Rename(const std::string& old_name, const std::string& new_name)
+    bool FileSystem::Rename(const std::string& old_name, const std::string& new_name)
     {
         try
         {
             filesystem::rename(old_name, new_name);
+            return true;
         }
         catch (const filesystem::filesystem_error& e)
         {
             SP_LOG_ERROR("Failed to rename %s to %s: %s", old_name.c_str(), new_name.c_str(), e.what());
         }
+
+        return false;
     }
 
     bool FileSystem::IsSupportedAudioFile(const string& path)
@@ -687,17 +705,23 @@ namespace spartan
         return GetExtensionFromFilePath(path) == EXTENSION_WORLD;
     }
 
+    bool FileSystem::IsEngineAnimationFile(const string& path)
+    {
+        return GetExtensionFromFilePath(path) == EXTENSION_ANIMATION;
+    }
+
     bool FileSystem::IsEngineFile(const string& path)
     {
         return
-                IsEnginePrefabFile(path)   ||
-                IsEngineMeshFile(path)     ||
-                IsEngineMaterialFile(path) ||
-                IsEngineMeshFile(path)     ||
-                IsEngineSceneFile(path)    ||
-                IsEngineAudioFile(path)    ||
-                IsEngineShaderFile(path)   ||
-                IsEngineTextureFile(path)  ||
+                IsEnginePrefabFile(path)    ||
+                IsEngineMeshFile(path)      ||
+                IsEngineMaterialFile(path)  ||
+                IsEngineMeshFile(path)      ||
+                IsEngineSceneFile(path)     ||
+                IsEngineAudioFile(path)     ||
+                IsEngineShaderFile(path)    ||
+                IsEngineTextureFile(path)   ||
+                IsEngineAnimationFile(path) ||
                 IsEngineWorldFile(path);
     }
 
@@ -57,6 +57,7 @@ namespace spartan
         static bool IsEngineShaderFile(const std::string& path);
         static bool IsEngineTextureFile(const std::string& path);
         static bool IsEngineWorldFile(const std::string& path);
+        static bool IsEngineAnimationFile(const std::string& path);
         static bool IsEngineFile(const std::string& path);
         static const std::vector<std::string>& GetSupportedImageFormats();
 
@@ -83,7 +84,8 @@ namespace spartan
         static std::vector<std::string> GetFilesInDirectory(const std::string& path);
         static std::vector<std::string> SplitPath(const std::string& path);
         static std::string GetLastWriteTime(const std::string& path);
-        static void Rename(const std::string& old_name, const std::string& new_name);
+        static uint64_t GetFileStamp(const std::string& path); // changes whenever the file's size or last write time does, 0 if it doesn't exist
+        static bool Rename(const std::string& old_name, const std::string& new_name);
         static bool Exists(const std::string& path);
         static bool IsDirectoryEmpty(const std::string& path);
         static bool IsDirectory(const std::string& path);
@@ -99,12 +101,13 @@ namespace spartan
         static bool IsExecutableInPath(const std::string& executable);
     };
 
-    static const char* EXTENSION_WORLD    = ".world";
-    static const char* EXTENSION_MATERIAL = ".xml";
-    static const char* EXTENSION_MESH     = ".mesh";
-    static const char* EXTENSION_PREFAB   = ".prefab";
-    static const char* EXTENSION_SHADER   = ".shader";
-    static const char* EXTENSION_FONT     = ".font";
-    static const char* EXTENSION_AUDIO    = ".audio";
-    static const char* EXTENSION_TEXTURE  = ".texture";
+    static const char* EXTENSION_WORLD     = ".world";
+    static const char* EXTENSION_MATERIAL  = ".xml";
+    static const char* EXTENSION_MESH      = ".mesh";
+    static const char* EXTENSION_PREFAB    = ".prefab";
+    static const char* EXTENSION_SHADER    = ".shader";
+    static const char* EXTENSION_FONT      = ".font";
+    static const char* EXTENSION_AUDIO     = ".audio";
+    static const char* EXTENSION_TEXTURE   = ".texture";
+    static const char* EXTENSION_ANIMATION = ".animation";
 }
@@ -0,0 +1,132 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ================
+#include "pch.h"
+#include "MappedFile.h"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+//===========================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace spartan
+{
+    bool MappedFile::Open(const string& path, const bool prefetch)
+    {
+        Close();
+
+    #if defined(_WIN32)
+        const DWORD access_hint = prefetch ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+        HANDLE file             = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | access_hint, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            SP_LOG_ERROR("Failed to open %s", path.c_str());
+            return false;
+        }
+
+        LARGE_INTEGER size = {};
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            SP_LOG_ERROR("Failed to get the size of %s", path.c_str());
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* view     = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!view)
+        {
+            if (mapping)
+            {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            SP_LOG_ERROR("Failed to map %s", path.c_str());
+            return false;
+        }
+
+        m_file    = file;
+        m_mapping = mapping;
+        m_data    = static_cast<const uint8_t*>(view);
+        m_size    = static_cast<uint64_t>(size.QuadPart);
+    #else
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            SP_LOG_ERROR("Failed to open %s", path.c_str());
+            return false;
+        }
+
+        struct stat info = {};
+        if (fstat(file, &info) != 0 || info.st_size == 0)
+        {
+            close(file);
+            SP_LOG_ERROR("Failed to get the size of %s", path.c_str());
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file); // the mapping keeps its own reference to the file
+        if (view == MAP_FAILED)
+        {
+            SP_LOG_ERROR("Failed to map %s", path.c_str());
+            return false;
+        }
+        madvise(view, static_cast<size_t>(info.st_size), prefetch ? MADV_WILLNEED : MADV_RANDOM);
+
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = static_cast<uint64_t>(info.st_size);
+    #endif
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (!m_data)
+            return;
+
+    #if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+        CloseHandle(static_cast<HANDLE>(m_mapping));
+        CloseHandle(static_cast<HANDLE>(m_file));
+    #else
+        munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size));
+    #endif
+
+        m_data    = nullptr;
+        m_size    = 0;
+        m_file    = nullptr;
+        m_mapping = nullptr;
+    }
+}
@@ -0,0 +1,57 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ======
+#include <string>
+#include <cstdint>
+//=================
+
+namespace spartan
+{
+    // read-only view of a whole file, backed by the os page cache instead of a copy in process memory
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const std::string& path, const bool prefetch = true) { Open(path, prefetch); }
+        ~MappedFile() { Close(); }
+
+        MappedFile(const MappedFile&)            = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // prefetch reads the whole file ahead, leave it off for files that are only partially accessed (streaming)
+        bool Open(const std::string& path, const bool prefetch = true);
+        void Close();
+
+        bool IsOpen() const            { return m_data != nullptr; }
+        const uint8_t* GetData() const { return m_data; }
+        uint64_t GetSize() const       { return m_size; }
+
+    private:
+        const uint8_t* m_data = nullptr;
+        uint64_t m_size       = 0;
+        void* m_file          = nullptr;
+        void* m_mapping       = nullptr;
+    };
+}
@@ -24,6 +24,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Game.h"
 #include "../World/World.h"
 #include "../World/Entity.h"
+#include "../World/Prefab.h"
+#include "../World/WorldCommandBuffer.h"
 #include "../World/Components/Camera.h"
 #include "../World/Components/Light.h"
 #include "../World/Components/Physics.h"
@@ -847,13 +849,14 @@ namespace spartan
                     // generate a terrain from a height map
                     shared_ptr<RHI_Texture> height_map = ResourceCache::Load<RHI_Texture>("project\\height_maps\\height_map.png");
                     terrain->SetHeightMapSeed(height_map.get());
+                    terrain->SetCollisionSurfaces(true);
                     terrain->Generate();
 
                     // add physics so we can walk on it
                     for (Entity* terrain_tile : terrain->GetEntity()->GetChildren())
                     {
                         Physics* physics_body = terrain_tile->AddComponent<Physics>();
-                        physics_body->SetBodyType(BodyType::Mesh);
+                        physics_body->SetBodyType(BodyType::HeightField);
                     }
                 }
 
@@ -994,10 +997,15 @@ namespace spartan
 
                     // place props on each terrain tile
                     vector<Entity*> children = terrain->GetEntity()->GetChildren();
+
+                    // compile the models once, every tile instantiates them
+                    Prefab prefab_tree(mesh_tree->GetRootEntity());
+                    Prefab prefab_rock(mesh_rock->GetRootEntity());
+
                     auto place_props_on_tiles = [
                         &children,
-                        &mesh_rock,
-                        &mesh_tree,
+                        &prefab_tree,
+                        &prefab_rock,
                         &mesh_grass_blade,
                         &mesh_flower,
                         &terrain,
@@ -1015,15 +1023,19 @@ namespace spartan
                         material_flower
                     ](uint32_t start_index, uint32_t end_index)
                     {
+                        // the hierarchy is main thread only, so parenting is recorded and played back by the world, in tile order
+                        WorldCommandBuffer& commands = WorldCommandBuffer::Get();
+
                         for (uint32_t tile_index = start_index; tile_index < end_index; tile_index++)
                         {
                             Entity* terrain_tile = children[tile_index];
+                            WorldCommandBuffer::Scope scope(tile_index);
 
                             // tree
                             {
-                                Entity* entity = mesh_tree->GetRootEntity()->Clone();
+                                Entity* entity = prefab_tree.Instantiate();
                                 entity->SetObjectName("tree");
-                                entity->SetParent(terrain_tile);
+                                commands.SetParent(entity, terrain_tile);
 
                                 // generate instances
                                 vector<Matrix> transforms;
@@ -1056,9 +1068,9 @@ namespace spartan
 
                             // rock
                             {
-                                Entity* entity = mesh_rock->GetRootEntity()->Clone();
+                                Entity* entity = prefab_rock.Instantiate();
                                 entity->SetObjectName("rock");
-                                entity->SetParent(terrain_tile);
+                                commands.SetParent(entity, terrain_tile);
 
                                 // generate instances
                                 {
@@ -1098,7 +1110,7 @@ namespace spartan
                                         {
                                             Entity* entity = World::CreateEntity();
                                             entity->SetObjectName("grass_layer_detail_low");
-                                            entity->SetParent(terrain_tile);
+                                            commands.SetParent(entity, terrain_tile);
 
                                             // copy the first 10% of transforms
                                             vector<Matrix> far_transforms(all_transforms.begin(), all_transforms.begin() + split_1);
@@ -1115,7 +1127,7 @@ namespace spartan
                                         {
                                             Entity* entity = World::CreateEntity();
                                             entity->SetObjectName("grass_layer_detail_mid");
-                                            entity->SetParent(terrain_tile);
+                                            commands.SetParent(entity, terrain_tile);
 
                                             // copy the next 20% of transforms
                                             vector<Matrix> mid_transforms(all_transforms.begin() + split_1, all_transforms.begin() + split_2);
@@ -1132,7 +1144,7 @@ namespace spartan
                                         {
                                             Entity* entity = World::CreateEntity();
                                             entity->SetObjectName("grass_layer_detail_high");
-                                            entity->SetParent(terrain_tile);
+                                            commands.SetParent(entity, terrain_tile);
 
                                             // copy the remaining 70% of transforms
                                             vector<Matrix> near_transforms(all_transforms.begin() + split_2, all_transforms.end());
@@ -1152,7 +1164,7 @@ namespace spartan
                                     // create entity
                                     Entity* entity = World::CreateEntity();
                                     entity->SetObjectName("flower");
-                                    entity->SetParent(terrain_tile);
+                                    commands.SetParent(entity, terrain_tile);
                                     
                                     // generate instances
                                     vector<Matrix> transforms;
@@ -23,8 +23,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES ===========================
 #include <vector>
+#include "Mesh.h"
 #include "../RHI/RHI_Vertex.h"
 #include "../Core/ThreadPool.h"
+#include "../Math/BoundingBox.h"
+#include "../Math/Frustum.h"
 SP_WARNINGS_OFF
 #include "meshoptimizer/meshoptimizer.h"
 SP_WARNINGS_ON
@@ -58,7 +61,6 @@ namespace spartan::geometry_processing
         register_meshoptimizer();
     
         // starting parameters
-        float  error                  = 0.01f;
         size_t index_count            = indices.size();
         size_t current_triangle_count = index_count / 3;
     
@@ -134,14 +136,12 @@ namespace spartan::geometry_processing
         // get locks or nullptr
         const unsigned char* locks = preserve_edges && !vertex_locks.empty() ? vertex_locks.data() : nullptr;
     
-        // simplification loop up to error = 1.0
+        // single pass towards the target, collapses happen in order of increasing error so allowing up to
+        // the full extent of the mesh (1.0) stops at the target count rather than re-simplifying the result
         float lod_error = 0.0f;
-        while (current_triangle_count > (target_index_count / 3) && error <= 1.0f)
+        if (target_index_count >= 3)
         {
-            if (target_index_count < 3)
-                break;
-    
-            size_t index_count_new = meshopt_simplifyWithAttributes(
+            index_count = meshopt_simplifyWithAttributes(
                 indices_simplified.data(),       // destination for simplified indices
                 indices.data(),                  // source indices
                 index_count,                     // current index count
@@ -154,18 +154,13 @@ namespace spartan::geometry_processing
                 attr_count,                      // total components
                 locks,                           // vertex lock array or nullptr
                 target_index_count,              // desired index count
-                error,                           // error tolerance
+                1.0f,                            // error tolerance, relative to the mesh extents
                 0,                               // options (default)
                 &lod_error                       // output error
             );
-    
-            // update indices and triangle count
-            index_count = index_count_new;
+
             indices.assign(indices_simplified.begin(), indices_simplified.begin() + index_count);
             current_triangle_count = index_count / 3;
-    
-            // increase error linearly
-            error += 0.1f;
         }
     
         // second attempt: use meshopt_simplifySloppy if needed, it doesn't respect topology or attributes, it just reduces indices aggressively
@@ -300,6 +295,323 @@ namespace spartan::geometry_processing
         meshopt_optimizeVertexFetch(vertices.data(), indices.data(), index_count, vertices.data(), vertex_count, sizeof(RHI_Vertex_PosTexNorTan));
     }
 
+    // splits the triangles into clusters and rewrites the indices so that every cluster is a contiguous range
+    static void build_clusters(const std::vector<RHI_Vertex_PosTexNorTan>& vertices, std::vector<uint32_t>& indices, std::vector<MeshCluster>& clusters)
+    {
+        register_meshoptimizer();
+
+        const size_t max_vertices  = 64;
+        const size_t max_triangles = 124;
+        const float cone_weight    = 0.25f; // trade some cluster compactness for tighter normal cones
+
+        const size_t max_meshlets = meshopt_buildMeshletsBound(indices.size(), max_vertices, max_triangles);
+        std::vector<meshopt_Meshlet> meshlets(max_meshlets);
+        std::vector<unsigned int> meshlet_vertices(max_meshlets * max_vertices);
+        std::vector<unsigned char> meshlet_triangles(max_meshlets * max_triangles * 3);
+
+        const size_t meshlet_count = meshopt_buildMeshlets(
+            meshlets.data(),
+            meshlet_vertices.data(),
+            meshlet_triangles.data(),
+            indices.data(),
+            indices.size(),
+            &vertices[0].pos[0],
+            vertices.size(),
+            sizeof(RHI_Vertex_PosTexNorTan),
+            max_vertices,
+            max_triangles,
+            cone_weight
+        );
+
+        std::vector<uint32_t> indices_clustered;
+        indices_clustered.reserve(indices.size());
+        clusters.clear();
+        clusters.reserve(meshlet_count);
+        for (size_t i = 0; i < meshlet_count; i++)
+        {
+            const meshopt_Meshlet& meshlet = meshlets[i];
+            unsigned int* local_vertices   = &meshlet_vertices[meshlet.vertex_offset];
+            unsigned char* local_triangles = &meshlet_triangles[meshlet.triangle_offset];
+
+            meshopt_optimizeMeshlet(local_vertices, local_triangles, meshlet.triangle_count, meshlet.vertex_count);
+            const meshopt_Bounds bounds = meshopt_computeMeshletBounds(local_vertices, local_triangles, meshlet.triangle_count, &vertices[0].pos[0], vertices.size(), sizeof(RHI_Vertex_PosTexNorTan));
+
+            MeshCluster& cluster = clusters.emplace_back();
+            cluster.index_offset = static_cast<uint32_t>(indices_clustered.size());
+            cluster.index_count  = meshlet.triangle_count * 3;
+            cluster.center       = math::Vector3(bounds.center[0], bounds.center[1], bounds.center[2]);
+            cluster.radius       = bounds.radius;
+            cluster.cone_apex    = math::Vector3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
+            cluster.cone_axis    = math::Vector3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+            cluster.cone_cutoff  = bounds.cone_cutoff;
+
+            for (uint32_t j = 0; j < cluster.index_count; j++)
+            {
+                indices_clustered.push_back(local_vertices[local_triangles[j]]);
+            }
+        }
+
+        indices = std::move(indices_clustered);
+    }
+
+    // appends the index ranges of the clusters that survive frustum and (optionally) normal cone culling, adjacent clusters
+    // are merged into a single range, returns the number of visible clusters
+    static uint32_t cull_clusters(
+        const std::vector<MeshCluster>& clusters,
+        const math::Matrix& transform,        // object to world
+        const math::Frustum& frustum,         // world space
+        const math::Vector3& camera_position, // world space
+        const bool cull_back_facing,          // only valid when the rasterizer culls back faces
+        const bool ignore_depth,              // skip the near and far planes, for directional shadow cascades
+        std::vector<MeshClusterRange>& ranges
+    )
+    {
+        // spheres scale with the largest axis, cones only survive uniform (and non-mirrored) scaling
+        // mirroring is detected with the determinant, GetScale() can't see it when the rows contain zeros
+        const math::Vector3 scale = transform.GetScale();
+        const float scale_max     = std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z) });
+        const float determinant   = transform.m00 * (transform.m11 * transform.m22 - transform.m12 * transform.m21) -
+                                    transform.m01 * (transform.m10 * transform.m22 - transform.m12 * transform.m20) +
+                                    transform.m02 * (transform.m10 * transform.m21 - transform.m11 * transform.m20);
+        const bool cones_valid    = cull_back_facing && determinant > 0.0f && std::abs(std::abs(scale.x) - std::abs(scale.y)) < 1e-3f * scale_max && std::abs(std::abs(scale.x) - std::abs(scale.z)) < 1e-3f * scale_max;
+
+        uint32_t visible_count = 0;
+        MeshClusterRange* last = nullptr;
+        for (const MeshCluster& cluster : clusters)
+        {
+            const math::Vector3 center = cluster.center * transform;
+            if (!frustum.IsVisible(center, cluster.radius * scale_max, ignore_depth))
+                continue;
+
+            if (cones_valid)
+            {
+                const math::Vector3 apex = cluster.cone_apex * transform;
+                const math::Vector3 axis = ((cluster.cone_apex + cluster.cone_axis) * transform - apex).Normalized();
+                if (math::Vector3::Dot((apex - camera_position).Normalized(), axis) >= cluster.cone_cutoff)
+                    continue;
+            }
+
+            visible_count++;
+            if (last && last->index_offset + last->index_count == cluster.index_offset)
+            {
+                last->index_count += cluster.index_count;
+            }
+            else
+            {
+                last = &ranges.emplace_back(MeshClusterRange{ cluster.index_offset, cluster.index_count });
+            }
+        }
+
+        return visible_count;
+    }
+
+    // octahedral mapping of a unit vector to two snorm16 values
+    static void encode_octahedral(const float* v, int16_t* out)
+    {
+        float x = v[0], y = v[1], z = v[2];
+        const float length = std::abs(x) + std::abs(y) + std::abs(z);
+        if (length > 0.0f)
+        {
+            x /= length;
+            y /= length;
+            z /= length;
+        }
+        else
+        {
+            z = 1.0f;
+        }
+
+        // fold the lower hemisphere over the diagonals
+        if (z < 0.0f)
+        {
+            const float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            const float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+
+        out[0] = static_cast<int16_t>(meshopt_quantizeSnorm(x, 16));
+        out[1] = static_cast<int16_t>(meshopt_quantizeSnorm(y, 16));
+    }
+
+    static void decode_octahedral(const int16_t* in, float* v)
+    {
+        float x = std::max(static_cast<float>(in[0]) / 32767.0f, -1.0f);
+        float y = std::max(static_cast<float>(in[1]) / 32767.0f, -1.0f);
+        float z = 1.0f - std::abs(x) - std::abs(y);
+
+        // unfold the lower hemisphere
+        const float t = std::max(-z, 0.0f);
+        x += x >= 0.0f ? -t : t;
+        y += y >= 0.0f ? -t : t;
+
+        const float length = std::sqrt(x * x + y * y + z * z);
+        v[0] = x / length;
+        v[1] = y / length;
+        v[2] = z / length;
+    }
+
+    // positions are quantized relative to bounds, which must enclose all the vertices (typically the bounding box of the lod)
+    static void quantize(
+        const RHI_Vertex_PosTexNorTan* vertices,
+        const uint32_t vertex_count,
+        const math::BoundingBox& bounds,
+        RHI_Vertex_PosTexNorTan_Quantized* vertices_quantized
+    )
+    {
+        const math::Vector3 min  = bounds.GetMin();
+        const math::Vector3 size = bounds.GetSize();
+        const float scale[3]     = { size.x > 0.0f ? 1.0f / size.x : 0.0f, size.y > 0.0f ? 1.0f / size.y : 0.0f, size.z > 0.0f ? 1.0f / size.z : 0.0f };
+        const float offset[3]    = { min.x, min.y, min.z };
+
+        for (uint32_t i = 0; i < vertex_count; i++)
+        {
+            const RHI_Vertex_PosTexNorTan& vertex      = vertices[i];
+            RHI_Vertex_PosTexNorTan_Quantized& encoded = vertices_quantized[i];
+
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                const float normalized = std::clamp((vertex.pos[axis] - offset[axis]) * scale[axis], 0.0f, 1.0f);
+                encoded.pos[axis]      = static_cast<uint16_t>(meshopt_quantizeUnorm(normalized, 16));
+            }
+            encoded.pos[3] = 1; // the float layout has no bitangent sign, so handedness is always positive
+
+            encoded.tex[0] = meshopt_quantizeHalf(vertex.tex[0]);
+            encoded.tex[1] = meshopt_quantizeHalf(vertex.tex[1]);
+
+            encode_octahedral(vertex.nor, encoded.nor);
+            encode_octahedral(vertex.tan, encoded.tan);
+        }
+    }
+
+    static void dequantize(
+        const RHI_Vertex_PosTexNorTan_Quantized* vertices_quantized,
+        const uint32_t vertex_count,
+        const math::BoundingBox& bounds,
+        RHI_Vertex_PosTexNorTan* vertices
+    )
+    {
+        const math::Vector3 min  = bounds.GetMin();
+        const math::Vector3 size = bounds.GetSize();
+        const float scale[3]     = { size.x / 65535.0f, size.y / 65535.0f, size.z / 65535.0f };
+        const float offset[3]    = { min.x, min.y, min.z };
+
+        for (uint32_t i = 0; i < vertex_count; i++)
+        {
+            const RHI_Vertex_PosTexNorTan_Quantized& encoded = vertices_quantized[i];
+            RHI_Vertex_PosTexNorTan& vertex                  = vertices[i];
+
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                vertex.pos[axis] = offset[axis] + static_cast<float>(encoded.pos[axis]) * scale[axis];
+            }
+
+            vertex.tex[0] = meshopt_dequantizeHalf(encoded.tex[0]);
+            vertex.tex[1] = meshopt_dequantizeHalf(encoded.tex[1]);
+
+            decode_octahedral(encoded.nor, vertex.nor);
+            decode_octahedral(encoded.tan, vertex.tan);
+        }
+    }
+
+    // packs vertices into the layout the gpu reads, see RHI_Vertex_PosTexNorTan_Gpu
+    static void pack_for_gpu(const RHI_Vertex_PosTexNorTan* vertices, const uint32_t vertex_count, RHI_Vertex_PosTexNorTan_Gpu* vertices_gpu)
+    {
+        for (uint32_t i = 0; i < vertex_count; i++)
+        {
+            const RHI_Vertex_PosTexNorTan& vertex = vertices[i];
+            RHI_Vertex_PosTexNorTan_Gpu& packed   = vertices_gpu[i];
+
+            packed.pos[0] = vertex.pos[0];
+            packed.pos[1] = vertex.pos[1];
+            packed.pos[2] = vertex.pos[2];
+
+            packed.tex[0] = meshopt_quantizeHalf(vertex.tex[0]);
+            packed.tex[1] = meshopt_quantizeHalf(vertex.tex[1]);
+
+            encode_octahedral(vertex.nor, &packed.nor_tan[0]);
+            encode_octahedral(vertex.tan, &packed.nor_tan[2]);
+        }
+    }
+
+    // what the vertex shader sees, used to measure the error of the gpu layout
+    static void unpack_from_gpu(const RHI_Vertex_PosTexNorTan_Gpu* vertices_gpu, const uint32_t vertex_count, RHI_Vertex_PosTexNorTan* vertices)
+    {
+        for (uint32_t i = 0; i < vertex_count; i++)
+        {
+            const RHI_Vertex_PosTexNorTan_Gpu& packed = vertices_gpu[i];
+            RHI_Vertex_PosTexNorTan& vertex           = vertices[i];
+
+            vertex.pos[0] = packed.pos[0];
+            vertex.pos[1] = packed.pos[1];
+            vertex.pos[2] = packed.pos[2];
+
+            vertex.tex[0] = meshopt_dequantizeHalf(packed.tex[0]);
+            vertex.tex[1] = meshopt_dequantizeHalf(packed.tex[1]);
+
+            decode_octahedral(&packed.nor_tan[0], vertex.nor);
+            decode_octahedral(&packed.nor_tan[2], vertex.tan);
+        }
+    }
+
+    struct quantization_error
+    {
+        float position = 0.0f; // max distance, in the units of the mesh
+        float uv       = 0.0f; // max absolute difference
+        float normal   = 0.0f; // max angle, in degrees
+        float tangent  = 0.0f; // max angle, in degrees
+    };
+
+    static quantization_error compare_vertices(const RHI_Vertex_PosTexNorTan* vertices, const RHI_Vertex_PosTexNorTan* decoded, const uint32_t vertex_count)
+    {
+        auto angle_degrees = [](const float* a, const float* b)
+        {
+            const float length_a = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+            if (length_a == 0.0f)
+                return 0.0f; // zero vectors (e.g. missing tangents) have no direction to preserve
+
+            const float d = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / length_a;
+            return std::acos(std::clamp(d, -1.0f, 1.0f)) * 57.29578f;
+        };
+
+        quantization_error error;
+        for (uint32_t i = 0; i < vertex_count; i++)
+        {
+            const RHI_Vertex_PosTexNorTan& a = vertices[i];
+            const RHI_Vertex_PosTexNorTan& b = decoded[i];
+
+            const float dx = a.pos[0] - b.pos[0], dy = a.pos[1] - b.pos[1], dz = a.pos[2] - b.pos[2];
+            error.position = std::max(error.position, std::sqrt(dx * dx + dy * dy + dz * dz));
+            error.uv       = std::max({ error.uv, std::abs(a.tex[0] - b.tex[0]), std::abs(a.tex[1] - b.tex[1]) });
+            error.normal   = std::max(error.normal, angle_degrees(a.nor, b.nor));
+            error.tangent  = std::max(error.tangent, angle_degrees(a.tan, b.tan));
+        }
+
+        return error;
+    }
+
+    // round trips the vertices through the quantized layout and measures the worst case error against the float layout
+    static quantization_error measure_quantization_error(const RHI_Vertex_PosTexNorTan* vertices, const uint32_t vertex_count, const math::BoundingBox& bounds)
+    {
+        std::vector<RHI_Vertex_PosTexNorTan_Quantized> encoded(vertex_count);
+        std::vector<RHI_Vertex_PosTexNorTan> decoded(vertex_count);
+        quantize(vertices, vertex_count, bounds, encoded.data());
+        dequantize(encoded.data(), vertex_count, bounds, decoded.data());
+
+        return compare_vertices(vertices, decoded.data(), vertex_count);
+    }
+
+    // same as above, for the layout the gpu reads
+    static quantization_error measure_gpu_packing_error(const RHI_Vertex_PosTexNorTan* vertices, const uint32_t vertex_count)
+    {
+        std::vector<RHI_Vertex_PosTexNorTan_Gpu> packed(vertex_count);
+        std::vector<RHI_Vertex_PosTexNorTan> decoded(vertex_count);
+        pack_for_gpu(vertices, vertex_count, packed.data());
+        unpack_from_gpu(packed.data(), vertex_count, decoded.data());
+
+        return compare_vertices(vertices, decoded.data(), vertex_count);
+    }
+
     static void split_surface_into_tiles(
         const std::vector<RHI_Vertex_PosTexNorTan>& terrain_vertices,
         const std::vector<uint32_t>& terrain_indices,
@@ -420,4 +732,442 @@ namespace spartan::geometry_processing
         // execute in parallel
         ThreadPool::ParallelLoop(process_triangles, triangle_count);
     }
+
+    // any unit vector perpendicular to the normal, for vertices whose uvs don't define a tangent
+    static math::Vector3 orthogonal_tangent(const math::Vector3& normal)
+    {
+        const math::Vector3 axis = std::abs(normal.x) < 0.9f ? math::Vector3::Right : math::Vector3::Up;
+        return (axis - normal * math::Vector3::Dot(normal, axis)).Normalized();
+    }
+
+    // projects the accumulated tangent onto the plane of the normal, this is where mikktspace ends up as well
+    static void finalize_tangent(RHI_Vertex_PosTexNorTan& vertex, const math::Vector3& tangent_accumulated)
+    {
+        const math::Vector3 normal = math::Vector3(vertex.nor[0], vertex.nor[1], vertex.nor[2]);
+        math::Vector3 tangent      = tangent_accumulated - normal * math::Vector3::Dot(normal, tangent_accumulated);
+        tangent                    = tangent.LengthSquared() > 1e-12f ? tangent.Normalized() : orthogonal_tangent(normal);
+
+        vertex.tan[0] = tangent.x;
+        vertex.tan[1] = tangent.y;
+        vertex.tan[2] = tangent.z;
+    }
+
+    // normals and tangents of a width x height grid (x varies fastest) with a gather over the neighbouring vertices, every vertex
+    // writes only itself so rows run in parallel without atomics, height_scale exaggerates vertical differences in the normals
+    static void compute_grid_normals_and_tangents(RHI_Vertex_PosTexNorTan* vertices, const uint32_t width, const uint32_t height, const float height_scale = 1.0f)
+    {
+        SP_ASSERT(vertices && width > 1 && height > 1);
+
+        auto compute_row = [&](const uint32_t z, const uint32_t z_previous, const uint32_t z_next, const uint32_t x_begin, const uint32_t x_end)
+        {
+            for (uint32_t x = x_begin; x < x_end; x++)
+            {
+                const uint32_t x_previous = x > 0 ? x - 1 : x;
+                const uint32_t x_next     = std::min(x + 1, width - 1);
+
+                const RHI_Vertex_PosTexNorTan& left  = vertices[z * width + x_previous];
+                const RHI_Vertex_PosTexNorTan& right = vertices[z * width + x_next];
+                const RHI_Vertex_PosTexNorTan& back  = vertices[z_previous * width + x];
+                const RHI_Vertex_PosTexNorTan& front = vertices[z_next * width + x];
+
+                // central differences, one sided at the borders
+                const float dx[3] = { right.pos[0] - left.pos[0], (right.pos[1] - left.pos[1]) * height_scale, right.pos[2] - left.pos[2] };
+                const float dz[3] = { front.pos[0] - back.pos[0], (front.pos[1] - back.pos[1]) * height_scale, front.pos[2] - back.pos[2] };
+
+                // normal, cross(dz, dx)
+                float normal[3]          = { dz[1] * dx[2] - dz[2] * dx[1], dz[2] * dx[0] - dz[0] * dx[2], dz[0] * dx[1] - dz[1] * dx[0] };
+                const float normal_scale = 1.0f / std::sqrt(std::max(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2], 1e-24f));
+                normal[0]               *= normal_scale;
+                normal[1]               *= normal_scale;
+                normal[2]               *= normal_scale;
+
+                // the direction in which u increases, solved from the uv differences along both grid axes, then made orthogonal to the normal
+                const float dv_x        = right.tex[1] - left.tex[1];
+                const float dv_z        = front.tex[1] - back.tex[1];
+                const float determinant = (right.tex[0] - left.tex[0]) * dv_z - (front.tex[0] - back.tex[0]) * dv_x;
+                const float sign        = determinant < 0.0f ? -1.0f : 1.0f;
+                float tangent[3]        = { (dx[0] * dv_z - dz[0] * dv_x) * sign, (dx[1] * dv_z - dz[1] * dv_x) * sign, (dx[2] * dv_z - dz[2] * dv_x) * sign };
+                const float projection  = tangent[0] * normal[0] + tangent[1] * normal[1] + tangent[2] * normal[2];
+                tangent[0]             -= normal[0] * projection;
+                tangent[1]             -= normal[1] * projection;
+                tangent[2]             -= normal[2] * projection;
+
+                RHI_Vertex_PosTexNorTan& vertex = vertices[z * width + x];
+                vertex.nor[0] = normal[0];
+                vertex.nor[1] = normal[1];
+                vertex.nor[2] = normal[2];
+
+                const float tangent_length_squared = tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2];
+                if (tangent_length_squared > 1e-24f)
+                {
+                    const float tangent_scale = 1.0f / std::sqrt(tangent_length_squared);
+                    vertex.tan[0]             = tangent[0] * tangent_scale;
+                    vertex.tan[1]             = tangent[1] * tangent_scale;
+                    vertex.tan[2]             = tangent[2] * tangent_scale;
+                }
+                else
+                {
+                    finalize_tangent(vertex, math::Vector3::Zero);
+                }
+            }
+        };
+
+        auto compute_rows = [&](uint32_t row_start, uint32_t row_end)
+        {
+            for (uint32_t z = row_start; z < row_end; z++)
+            {
+                const uint32_t z_previous = z > 0 ? z - 1 : z;
+                const uint32_t z_next     = std::min(z + 1, height - 1);
+                uint32_t x                = 0;
+
+            #if defined(__AVX2__)
+                // interior vertices, 8 at a time, gathered straight out of the vertex layout (the same math as the scalar loop below)
+                const int32_t stride = static_cast<int32_t>(sizeof(RHI_Vertex_PosTexNorTan) / sizeof(float));
+                if (static_cast<uint64_t>(width) * height * stride < static_cast<uint64_t>(INT32_MAX))
+                {
+                    const float* base         = &vertices[0].pos[0];
+                    const __m256i lane_offset = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+                    const __m256 scale_y      = _mm256_set1_ps(height_scale);
+                    const __m256 zero         = _mm256_setzero_ps();
+                    const __m256 sign_mask    = _mm256_set1_ps(-0.0f);
+                    const __m256 length_min   = _mm256_set1_ps(1e-24f);
+
+                    auto offsets = [&](const uint32_t index) { return _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(index * stride)), lane_offset); };
+                    auto load    = [&](const __m256i offset, const uint32_t component) { return _mm256_i32gather_ps(base + component, offset, 4); };
+
+                    for (x = 1; x + 8 < width; x += 8)
+                    {
+                        const __m256i left  = offsets(z * width + x - 1);
+                        const __m256i right = offsets(z * width + x + 1);
+                        const __m256i back  = offsets(z_previous * width + x);
+                        const __m256i front = offsets(z_next * width + x);
+
+                        const __m256 dx0 = _mm256_sub_ps(load(right, 0), load(left, 0));
+                        const __m256 dx1 = _mm256_mul_ps(_mm256_sub_ps(load(right, 1), load(left, 1)), scale_y);
+                        const __m256 dx2 = _mm256_sub_ps(load(right, 2), load(left, 2));
+                        const __m256 dz0 = _mm256_sub_ps(load(front, 0), load(back, 0));
+                        const __m256 dz1 = _mm256_mul_ps(_mm256_sub_ps(load(front, 1), load(back, 1)), scale_y);
+                        const __m256 dz2 = _mm256_sub_ps(load(front, 2), load(back, 2));
+
+                        __m256 n0                = _mm256_sub_ps(_mm256_mul_ps(dz1, dx2), _mm256_mul_ps(dz2, dx1));
+                        __m256 n1                = _mm256_sub_ps(_mm256_mul_ps(dz2, dx0), _mm256_mul_ps(dz0, dx2));
+                        __m256 n2                = _mm256_sub_ps(_mm256_mul_ps(dz0, dx1), _mm256_mul_ps(dz1, dx0));
+                        const __m256 n_length_sq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n0, n0), _mm256_mul_ps(n1, n1)), _mm256_mul_ps(n2, n2));
+                        const __m256 n_scale     = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(_mm256_max_ps(n_length_sq, length_min)));
+                        n0                       = _mm256_mul_ps(n0, n_scale);
+                        n1                       = _mm256_mul_ps(n1, n_scale);
+                        n2                       = _mm256_mul_ps(n2, n_scale);
+
+                        const __m256 dv_x        = _mm256_sub_ps(load(right, 4), load(left, 4));
+                        const __m256 dv_z        = _mm256_sub_ps(load(front, 4), load(back, 4));
+                        const __m256 du_x        = _mm256_sub_ps(load(right, 3), load(left, 3));
+                        const __m256 du_z        = _mm256_sub_ps(load(front, 3), load(back, 3));
+                        const __m256 determinant = _mm256_sub_ps(_mm256_mul_ps(du_x, dv_z), _mm256_mul_ps(du_z, dv_x));
+                        const __m256 sign        = _mm256_or_ps(_mm256_set1_ps(1.0f), _mm256_and_ps(_mm256_cmp_ps(determinant, zero, _CMP_LT_OQ), sign_mask));
+                        __m256 t0                = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(dx0, dv_z), _mm256_mul_ps(dz0, dv_x)), sign);
+                        __m256 t1                = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(dx1, dv_z), _mm256_mul_ps(dz1, dv_x)), sign);
+                        __m256 t2                = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(dx2, dv_z), _mm256_mul_ps(dz2, dv_x)), sign);
+                        const __m256 projection  = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(t0, n0), _mm256_mul_ps(t1, n1)), _mm256_mul_ps(t2, n2));
+                        t0                       = _mm256_sub_ps(t0, _mm256_mul_ps(n0, projection));
+                        t1                       = _mm256_sub_ps(t1, _mm256_mul_ps(n1, projection));
+                        t2                       = _mm256_sub_ps(t2, _mm256_mul_ps(n2, projection));
+                        const __m256 t_length_sq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(t0, t0), _mm256_mul_ps(t1, t1)), _mm256_mul_ps(t2, t2));
+                        const __m256 t_scale     = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(_mm256_max_ps(t_length_sq, length_min)));
+                        const int degenerate     = _mm256_movemask_ps(_mm256_cmp_ps(t_length_sq, length_min, _CMP_LE_OQ));
+
+                        alignas(32) float result[6][8];
+                        _mm256_store_ps(result[0], n0);
+                        _mm256_store_ps(result[1], n1);
+                        _mm256_store_ps(result[2], n2);
+                        _mm256_store_ps(result[3], _mm256_mul_ps(t0, t_scale));
+                        _mm256_store_ps(result[4], _mm256_mul_ps(t1, t_scale));
+                        _mm256_store_ps(result[5], _mm256_mul_ps(t2, t_scale));
+                        for (uint32_t lane = 0; lane < 8; lane++)
+                        {
+                            RHI_Vertex_PosTexNorTan& vertex = vertices[z * width + x + lane];
+                            vertex.nor[0] = result[0][lane];
+                            vertex.nor[1] = result[1][lane];
+                            vertex.nor[2] = result[2][lane];
+                            vertex.tan[0] = result[3][lane];
+                            vertex.tan[1] = result[4][lane];
+                            vertex.tan[2] = result[5][lane];
+
+                            if (degenerate & (1 << lane))
+                            {
+                                finalize_tangent(vertex, math::Vector3::Zero);
+                            }
+                        }
+                    }
+
+                    // the first column goes through the scalar path, like the remainder
+                    compute_row(z, z_previous, z_next, 0, 1);
+                }
+            #endif
+
+                compute_row(z, z_previous, z_next, x, width);
+            }
+        };
+        ThreadPool::ParallelLoop(compute_rows, height);
+    }
+
+    // which way the uvs of a triangle run relative to its surface, -1 where they are mirrored, 0 if the triangle or its uvs are degenerate,
+    // this is the bitangent sign of mikktspace (bitangent = sign * cross(normal, tangent)), the pixel shader derives the same value from
+    // screen space derivatives (get_uv_handedness() in common.hlsl) so it doesn't have to be stored in the vertex
+    static float get_uv_orientation(const RHI_Vertex_PosTexNorTan& v0, const RHI_Vertex_PosTexNorTan& v1, const RHI_Vertex_PosTexNorTan& v2)
+    {
+        const math::Vector3 p0     = math::Vector3(v0.pos[0], v0.pos[1], v0.pos[2]);
+        const math::Vector3 normal = math::Vector3(v0.nor[0] + v1.nor[0] + v2.nor[0], v0.nor[1] + v1.nor[1] + v2.nor[1], v0.nor[2] + v1.nor[2] + v2.nor[2]);
+        const math::Vector3 face   = math::Vector3::Cross(math::Vector3(v1.pos[0], v1.pos[1], v1.pos[2]) - p0, math::Vector3(v2.pos[0], v2.pos[1], v2.pos[2]) - p0);
+        const float winding        = math::Vector3::Dot(face, normal);
+        const float area_signed    = (v1.tex[0] - v0.tex[0]) * (v2.tex[1] - v0.tex[1]) - (v1.tex[1] - v0.tex[1]) * (v2.tex[0] - v0.tex[0]);
+        const float orientation    = winding * area_signed;
+
+        return orientation > 0.0f ? 1.0f : (orientation < 0.0f ? -1.0f : 0.0f);
+    }
+
+    // smooth angle weighted normals (optional) and mikktspace tangents for an arbitrary triangle list, the triangles are
+    // split into one range per thread and every range accumulates into a buffer that spans only the vertices it references,
+    // a second pass sums the buffers per vertex, so there are no atomics and the result doesn't depend on scheduling
+    // - like mikktspace, the tangent of a triangle is the direction in which u increases, projected onto each vertex normal
+    //   and weighted by the corner angle in that plane, and triangles with opposite uv orientation never share a tangent
+    // - a vertex used by triangles of both orientations (mirrored uvs) is split, the copy is appended to the vertices and used
+    //   by the mirrored triangles, split_sources receives the vertex every copy was made from so that parallel data can follow
+    static void compute_normals_and_tangents(
+        std::vector<RHI_Vertex_PosTexNorTan>& vertices,
+        std::vector<uint32_t>& indices,
+        const bool compute_normals,
+        std::vector<uint32_t>* split_sources = nullptr
+    )
+    {
+        uint32_t vertex_count         = static_cast<uint32_t>(vertices.size());
+        const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+        if (vertex_count == 0 || triangle_count == 0)
+            return;
+
+        struct Accumulator
+        {
+            uint32_t first = 0;
+            std::vector<math::Vector3> values;
+        };
+        const uint32_t range_count = std::clamp(triangle_count / 4096, 1u, std::max(ThreadPool::GetThreadCount(), 1u));
+        std::vector<Accumulator> accumulators(range_count);
+
+        auto get_position = [&vertices](const uint32_t index)
+        {
+            return math::Vector3(vertices[index].pos[0], vertices[index].pos[1], vertices[index].pos[2]);
+        };
+
+        // the angle of every corner, measured in the plane given by the normal, or in the plane of the triangle if there is none
+        auto get_corner_angle = [](math::Vector3 edge_a, math::Vector3 edge_b, const math::Vector3* normal)
+        {
+            if (normal)
+            {
+                edge_a -= *normal * math::Vector3::Dot(*normal, edge_a);
+                edge_b -= *normal * math::Vector3::Dot(*normal, edge_b);
+            }
+
+            const float length_squared = edge_a.LengthSquared() * edge_b.LengthSquared();
+            if (length_squared <= 1e-24f)
+                return 0.0f;
+
+            return std::acos(std::clamp(math::Vector3::Dot(edge_a, edge_b) / std::sqrt(length_squared), -1.0f, 1.0f));
+        };
+
+        // first pass, each range scatters the contribution of its triangles into its own accumulator
+        auto scatter = [&](auto&& contribution)
+        {
+            auto accumulate_ranges = [&](uint32_t range_start, uint32_t range_end)
+            {
+                for (uint32_t range = range_start; range < range_end; range++)
+                {
+                    const uint32_t triangle_start = static_cast<uint32_t>(static_cast<uint64_t>(triangle_count) * range / range_count);
+                    const uint32_t triangle_end   = static_cast<uint32_t>(static_cast<uint64_t>(triangle_count) * (range + 1) / range_count);
+
+                    uint32_t index_min = vertex_count;
+                    uint32_t index_max = 0;
+                    for (uint32_t i = triangle_start * 3; i < triangle_end * 3; i++)
+                    {
+                        index_min = std::min(index_min, indices[i]);
+                        index_max = std::max(index_max, indices[i]);
+                    }
+
+                    Accumulator& accumulator = accumulators[range];
+                    accumulator.first        = index_min;
+                    accumulator.values.assign(index_max >= index_min ? index_max - index_min + 1 : 0, math::Vector3::Zero);
+
+                    for (uint32_t triangle = triangle_start; triangle < triangle_end; triangle++)
+                    {
+                        const uint32_t* corner_indices = &indices[triangle * 3];
+                        math::Vector3 values[3];
+                        if (contribution(triangle, corner_indices, values))
+                        {
+                            for (uint32_t corner = 0; corner < 3; corner++)
+                            {
+                                accumulator.values[corner_indices[corner] - index_min] += values[corner];
+                            }
+                        }
+                    }
+                }
+            };
+            ThreadPool::ParallelLoop(accumulate_ranges, range_count);
+        };
+
+        // second pass, every vertex sums the accumulators that cover it, in range order
+        auto gather = [&](auto&& finalize)
+        {
+            auto sum_vertices = [&](uint32_t start, uint32_t end)
+            {
+                for (uint32_t index = start; index < end; index++)
+                {
+                    math::Vector3 sum = math::Vector3::Zero;
+                    for (const Accumulator& accumulator : accumulators)
+                    {
+                        if (index >= accumulator.first && index - accumulator.first < accumulator.values.size())
+                        {
+                            sum += accumulator.values[index - accumulator.first];
+                        }
+                    }
+                    finalize(index, sum);
+                }
+            };
+            ThreadPool::ParallelLoop(sum_vertices, vertex_count);
+        };
+
+        if (compute_normals)
+        {
+            scatter([&](const uint32_t, const uint32_t* corner_indices, math::Vector3* values)
+            {
+                const math::Vector3 p0     = get_position(corner_indices[0]);
+                const math::Vector3 p1     = get_position(corner_indices[1]);
+                const math::Vector3 p2     = get_position(corner_indices[2]);
+                const math::Vector3 normal = math::Vector3::Cross(p1 - p0, p2 - p0);
+                if (normal.LengthSquared() <= 1e-24f)
+                    return false;
+
+                const math::Vector3 normal_unit = normal.Normalized();
+                values[0] = normal_unit * get_corner_angle(p1 - p0, p2 - p0, nullptr);
+                values[1] = normal_unit * get_corner_angle(p2 - p1, p0 - p1, nullptr);
+                values[2] = normal_unit * get_corner_angle(p0 - p2, p1 - p2, nullptr);
+                return true;
+            });
+
+            gather([&vertices](const uint32_t index, const math::Vector3& sum)
+            {
+                const math::Vector3 normal = sum.LengthSquared() > 1e-24f ? sum.Normalized() : math::Vector3::Up;
+                vertices[index].nor[0] = normal.x;
+                vertices[index].nor[1] = normal.y;
+                vertices[index].nor[2] = normal.z;
+            });
+        }
+
+        // the uv orientation of every triangle, which needs the final normals
+        std::vector<float> orientations(triangle_count);
+        ThreadPool::ParallelLoop([&](uint32_t start, uint32_t end)
+        {
+            for (uint32_t triangle = start; triangle < end; triangle++)
+            {
+                const uint32_t* corner_indices = &indices[triangle * 3];
+                orientations[triangle]         = get_uv_orientation(vertices[corner_indices[0]], vertices[corner_indices[1]], vertices[corner_indices[2]]);
+            }
+        }, triangle_count);
+
+        // count the triangles of either orientation around every vertex, x = positive, y = mirrored
+        scatter([&](const uint32_t triangle, const uint32_t*, math::Vector3* values)
+        {
+            if (orientations[triangle] == 0.0f)
+                return false;
+
+            const math::Vector3 value = orientations[triangle] > 0.0f ? math::Vector3(1.0f, 0.0f, 0.0f) : math::Vector3(0.0f, 1.0f, 0.0f);
+            values[0] = values[1] = values[2] = value;
+            return true;
+        });
+
+        std::vector<uint8_t> mixed(vertex_count, 0);
+        gather([&mixed](const uint32_t index, const math::Vector3& sum)
+        {
+            mixed[index] = sum.x > 0.0f && sum.y > 0.0f;
+        });
+
+        // split the vertices that have both, in vertex order so the result is deterministic
+        constexpr uint32_t no_split = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> split_to;
+        for (uint32_t index = 0; index < vertex_count; index++)
+        {
+            if (!mixed[index])
+                continue;
+
+            if (split_to.empty())
+            {
+                split_to.assign(vertex_count, no_split);
+            }
+
+            split_to[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(vertices[index]);
+            if (split_sources)
+            {
+                split_sources->push_back(index);
+            }
+        }
+
+        if (!split_to.empty())
+        {
+            ThreadPool::ParallelLoop([&](uint32_t start, uint32_t end)
+            {
+                for (uint32_t triangle = start; triangle < end; triangle++)
+                {
+                    if (orientations[triangle] >= 0.0f)
+                        continue;
+
+                    for (uint32_t corner = 0; corner < 3; corner++)
+                    {
+                        uint32_t& index = indices[triangle * 3 + corner];
+                        if (split_to[index] != no_split)
+                        {
+                            index = split_to[index];
+                        }
+                    }
+                }
+            }, triangle_count);
+
+            vertex_count = static_cast<uint32_t>(vertices.size());
+        }
+
+        scatter([&](const uint32_t, const uint32_t* corner_indices, math::Vector3* values)
+        {
+            const RHI_Vertex_PosTexNorTan& v0 = vertices[corner_indices[0]];
+            const RHI_Vertex_PosTexNorTan& v1 = vertices[corner_indices[1]];
+            const RHI_Vertex_PosTexNorTan& v2 = vertices[corner_indices[2]];
+            const math::Vector3 p0            = get_position(corner_indices[0]);
+            const math::Vector3 d1            = get_position(corner_indices[1]) - p0;
+            const math::Vector3 d2            = get_position(corner_indices[2]) - p0;
+            const float t21_x                 = v1.tex[0] - v0.tex[0];
+            const float t21_y                 = v1.tex[1] - v0.tex[1];
+            const float t31_x                 = v2.tex[0] - v0.tex[0];
+            const float t31_y                 = v2.tex[1] - v0.tex[1];
+
+            // the direction in which u increases, the sign of the uv area keeps mirrored triangles pointing the same way (as mikktspace does)
+            const float area_signed = t21_x * t31_y - t21_y * t31_x;
+            math::Vector3 tangent   = d1 * t31_y - d2 * t21_y;
+            if (area_signed == 0.0f || tangent.LengthSquared() <= 1e-24f)
+                return false;
+            tangent = tangent.Normalized() * (area_signed < 0.0f ? -1.0f : 1.0f);
+
+            // weighted by the corner angles in the plane of each vertex normal
+            const math::Vector3 corners[3] = { p0, p0 + d1, p0 + d2 };
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                const RHI_Vertex_PosTexNorTan& vertex = vertices[corner_indices[corner]];
+                const math::Vector3 normal            = math::Vector3(vertex.nor[0], vertex.nor[1], vertex.nor[2]);
+                const math::Vector3 projected         = tangent - normal * math::Vector3::Dot(normal, tangent);
+                const float angle                     = get_corner_angle(corners[(corner + 1) % 3] - corners[corner], corners[(corner + 2) % 3] - corners[corner], &normal);
+                values[corner]                        = projected.LengthSquared() > 1e-24f ? projected.Normalized() * angle : math::Vector3::Zero;
+            }
+            return true;
+        });
+
+        gather([&vertices](const uint32_t index, const math::Vector3& sum)
+        {
+            finalize_tangent(vertices[index], sum);
+        });
+    }
 }
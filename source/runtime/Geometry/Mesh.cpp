@@ -28,6 +28,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../World/Entity.h"
 #include "../Resource/Import/ModelImporter.h"
 #include "GeometryProcessing.h"
+#include "GeometryGeneration.h"
+#include "MeshBvh.h"
+#include "../FileSystem/MappedFile.h"
+#include "../Rendering/GeometryPool.h"
 //===========================================
 
 //= NAMESPACES ================
@@ -37,6 +41,120 @@ using namespace spartan::math;
 
 namespace spartan
 {
+    namespace mesh_file
+    {
+        // version 3 layout: header, table of contents, then 64 byte aligned sections
+        // vertex and index sections are meshoptimizer encoded chunks that can be decoded independently
+        constexpr uint32_t magic              = 0x4853454D; // "MESH"
+        constexpr uint32_t version            = 3;
+        constexpr uint64_t alignment          = 64;
+        constexpr uint32_t chunk_vertex_count = 64 * 1024;
+        constexpr uint32_t chunk_index_count  = 3 * 64 * 1024;
+
+        enum class SectionType : uint32_t
+        {
+            Lods,
+            Vertices,
+            Indices,
+            Clusters, // raw MeshCluster array of the referenced lod
+            Skeleton, // Skeleton::Serialize() output
+            Weights   // meshoptimizer encoded BoneWeights of the referenced (skinned) lod
+        };
+
+        struct Header
+        {
+            uint32_t magic          = mesh_file::magic;
+            uint32_t version        = mesh_file::version;
+            uint32_t type           = 0;
+            uint32_t dropoff        = 0;
+            uint32_t flags          = 0;
+            uint32_t vertex_format  = 0; // 0 = RHI_Vertex_PosTexNorTan, 1 = RHI_Vertex_PosTexNorTan_Quantized
+            uint32_t sub_mesh_count = 0;
+            uint32_t section_count  = 0;
+            uint32_t vertex_count   = 0;
+            uint32_t index_count    = 0;
+            uint32_t reserved[6]    = {};
+        };
+        static_assert(sizeof(Header) == 64);
+
+        struct Section
+        {
+            uint32_t type           = 0;
+            uint32_t lod            = 0; // index into the lod table
+            uint32_t element_offset = 0; // first vertex or index that this section decodes to
+            uint32_t element_count  = 0;
+            uint64_t offset         = 0; // from the start of the file
+            uint64_t size           = 0;
+        };
+        static_assert(sizeof(Section) == 32);
+
+        struct Lod
+        {
+            uint32_t sub_mesh      = 0;
+            uint32_t vertex_offset = 0;
+            uint32_t vertex_count  = 0;
+            uint32_t index_offset  = 0;
+            uint32_t index_count   = 0;
+            float min[3]           = {};
+            float max[3]           = {};
+        };
+
+        static_assert(sizeof(MeshCluster) == 52);
+        static_assert(sizeof(BoneWeights) == 24);
+
+        uint64_t align(const uint64_t value)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    // lod 0 of a sub-mesh, shared by the jobs that simplify it
+    struct MeshLodSource
+    {
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        vector<uint32_t> indices;
+        bool preserve_edges = false;
+    };
+
+    struct MeshLodJob
+    {
+        static constexpr uint8_t pending = 0;
+        static constexpr uint8_t running = 1;
+        static constexpr uint8_t done    = 2;
+
+        shared_ptr<const MeshLodSource> source;
+        uint32_t sub_mesh_index   = 0;
+        size_t target_index_count = 0;
+        atomic<uint8_t> state     = pending;
+
+        // output
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        vector<uint32_t> indices;
+    };
+
+    namespace
+    {
+        // roughly 24 clusters, below that a sub-mesh is culled as a whole
+        const uint32_t mesh_cluster_min_index_count = 24 * 124 * 3;
+
+        // runs the job unless another thread already claimed it
+        void run_lod_job(MeshLodJob& job)
+        {
+            uint8_t expected = MeshLodJob::pending;
+            if (!job.state.compare_exchange_strong(expected, MeshLodJob::running, memory_order_acq_rel))
+                return;
+
+            job.vertices = job.source->vertices;
+            job.indices  = job.source->indices;
+
+            const bool preserve_uvs = true;
+            geometry_processing::simplify(job.indices, job.vertices, job.target_index_count, preserve_uvs, job.source->preserve_edges);
+
+            job.source = nullptr; // the last job to finish releases lod 0
+            job.state.store(MeshLodJob::done, memory_order_release);
+        }
+    }
+
     Mesh::Mesh() : IResource(ResourceType::Mesh)
     {
         m_flags = GetDefaultFlags();
@@ -44,8 +162,10 @@ namespace spartan
 
     Mesh::~Mesh()
     {
-        m_index_buffer  = nullptr;
-        m_vertex_buffer = nullptr;
+        GeometryPool::Free(m_index_allocation);
+        GeometryPool::Free(m_vertex_allocation);
+        m_index_allocation  = nullptr;
+        m_vertex_allocation = nullptr;
     }
 
     void Mesh::Clear()
@@ -55,62 +175,183 @@ namespace spartan
 
         m_vertices.clear();
         m_vertices.shrink_to_fit();
+
+        m_bone_weights.clear();
+        m_bone_weights.shrink_to_fit();
+
+        {
+            lock_guard lock(m_mutex_bvh);
+            m_bvhs.clear();
+        }
+
+        m_content_hash = 0;
     }
 
     void Mesh::SaveToFile(const string& file_path)
     {
-        ofstream outfile(file_path, ios::binary);
-        if (!outfile)
+        FlushLods();
+
+        const bool quantize = m_flags & static_cast<uint32_t>(MeshFlags::PostProcessQuantizeVertices);
+
+        // lod table
+        vector<mesh_file::Lod> lods;
+        for (uint32_t sub_mesh_index = 0; sub_mesh_index < static_cast<uint32_t>(m_sub_meshes.size()); sub_mesh_index++)
         {
-            SP_LOG_ERROR("Failed to open file for writing: %s", file_path.c_str());
-            return;
+            for (const MeshLod& lod : m_sub_meshes[sub_mesh_index].lods)
+            {
+                mesh_file::Lod& record = lods.emplace_back();
+                record.sub_mesh        = sub_mesh_index;
+                record.vertex_offset   = lod.vertex_offset;
+                record.vertex_count    = lod.vertex_count;
+                record.index_offset    = lod.index_offset;
+                record.index_count     = lod.index_count;
+                record.min[0]          = lod.aabb.GetMin().x;
+                record.min[1]          = lod.aabb.GetMin().y;
+                record.min[2]          = lod.aabb.GetMin().z;
+                record.max[0]          = lod.aabb.GetMax().x;
+                record.max[1]          = lod.aabb.GetMax().y;
+                record.max[2]          = lod.aabb.GetMax().z;
+            }
         }
 
-        uint32_t version = 1;
-        outfile.write(reinterpret_cast<const char*>(&version), sizeof(uint32_t));
+        // quantize, every lod against its own bounding box
+        vector<RHI_Vertex_PosTexNorTan_Quantized> vertices_quantized;
+        if (quantize)
+        {
+            vertices_quantized.resize(m_vertices.size());
+            geometry_processing::quantization_error error;
+            for (const SubMesh& sub : m_sub_meshes)
+            {
+                for (const MeshLod& lod : sub.lods)
+                {
+                    geometry_processing::quantize(&m_vertices[lod.vertex_offset], lod.vertex_count, lod.aabb, &vertices_quantized[lod.vertex_offset]);
 
-        uint32_t type = static_cast<uint32_t>(m_type);
-        outfile.write(reinterpret_cast<const char*>(&type), sizeof(uint32_t));
+                    geometry_processing::quantization_error lod_error = geometry_processing::measure_quantization_error(&m_vertices[lod.vertex_offset], lod.vertex_count, lod.aabb);
+                    error.position = max(error.position, lod_error.position);
+                    error.normal   = max(error.normal, lod_error.normal);
+                }
+            }
 
-        uint32_t dropoff = static_cast<uint32_t>(m_lod_dropoff);
-        outfile.write(reinterpret_cast<const char*>(&dropoff), sizeof(uint32_t));
+            SP_LOG_INFO("Quantized \"%s\": %.1f KB of vertices on disk instead of %.1f KB, max position error %f, max normal error %.3f degrees",
+                FileSystem::GetFileNameFromFilePath(file_path).c_str(),
+                static_cast<float>(m_vertices.size() * sizeof(RHI_Vertex_PosTexNorTan_Quantized)) / 1024.0f,
+                static_cast<float>(m_vertices.size() * sizeof(RHI_Vertex_PosTexNorTan)) / 1024.0f,
+                error.position,
+                error.normal
+            );
+        }
+        const uint8_t* vertex_data = quantize ? reinterpret_cast<const uint8_t*>(vertices_quantized.data()) : reinterpret_cast<const uint8_t*>(m_vertices.data());
+        const size_t vertex_size   = quantize ? sizeof(RHI_Vertex_PosTexNorTan_Quantized) : sizeof(RHI_Vertex_PosTexNorTan);
 
-        outfile.write(reinterpret_cast<const char*>(&m_flags), sizeof(uint32_t));
+        // encode every lod in chunks, so that loading can decode them in parallel
+        vector<mesh_file::Section> sections;
+        vector<vector<uint8_t>> blobs;
+        auto add_section = [&sections, &blobs](mesh_file::SectionType type, uint32_t lod, uint32_t element_offset, uint32_t element_count, vector<uint8_t>&& blob)
+        {
+            mesh_file::Section& section = sections.emplace_back();
+            section.type                = static_cast<uint32_t>(type);
+            section.lod                 = lod;
+            section.element_offset      = element_offset;
+            section.element_count       = element_count;
+            section.size                = blob.size();
+            blobs.emplace_back(move(blob));
+        };
 
-        uint32_t submesh_count = static_cast<uint32_t>(m_sub_meshes.size());
-        outfile.write(reinterpret_cast<const char*>(&submesh_count), sizeof(uint32_t));
+        {
+            vector<uint8_t> blob(lods.size() * sizeof(mesh_file::Lod));
+            memcpy(blob.data(), lods.data(), blob.size());
+            add_section(mesh_file::SectionType::Lods, 0, 0, static_cast<uint32_t>(lods.size()), move(blob));
+        }
 
-        for (const auto& sub : m_sub_meshes)
+        for (uint32_t lod_index = 0; lod_index < static_cast<uint32_t>(lods.size()); lod_index++)
         {
-            uint32_t lod_count = static_cast<uint32_t>(sub.lods.size());
-            outfile.write(reinterpret_cast<const char*>(&lod_count), sizeof(uint32_t));
+            const mesh_file::Lod& lod = lods[lod_index];
+
+            for (uint32_t first = 0; first < lod.vertex_count; first += mesh_file::chunk_vertex_count)
+            {
+                const uint32_t count = min(mesh_file::chunk_vertex_count, lod.vertex_count - first);
+                const uint8_t* data  = vertex_data + (lod.vertex_offset + first) * vertex_size;
+
+                vector<uint8_t> blob(meshopt_encodeVertexBufferBound(count, vertex_size));
+                blob.resize(meshopt_encodeVertexBuffer(blob.data(), blob.size(), data, count, vertex_size));
+                add_section(mesh_file::SectionType::Vertices, lod_index, lod.vertex_offset + first, count, move(blob));
+            }
 
-            for (const auto& lod : sub.lods)
+            for (uint32_t first = 0; first < lod.index_count; first += mesh_file::chunk_index_count)
             {
-                outfile.write(reinterpret_cast<const char*>(&lod.vertex_offset), sizeof(uint32_t));
-                outfile.write(reinterpret_cast<const char*>(&lod.vertex_count), sizeof(uint32_t));
-                outfile.write(reinterpret_cast<const char*>(&lod.index_offset), sizeof(uint32_t));
-                outfile.write(reinterpret_cast<const char*>(&lod.index_count), sizeof(uint32_t));
+                const uint32_t count = min(mesh_file::chunk_index_count, lod.index_count - first);
+                const uint32_t* data = &m_indices[lod.index_offset + first];
 
-                Vector3 min = lod.aabb.GetMin();
-                Vector3 max = lod.aabb.GetMax();
-                outfile.write(reinterpret_cast<const char*>(&min.x), sizeof(float));
-                outfile.write(reinterpret_cast<const char*>(&min.y), sizeof(float));
-                outfile.write(reinterpret_cast<const char*>(&min.z), sizeof(float));
-                outfile.write(reinterpret_cast<const char*>(&max.x), sizeof(float));
-                outfile.write(reinterpret_cast<const char*>(&max.y), sizeof(float));
-                outfile.write(reinterpret_cast<const char*>(&max.z), sizeof(float));
+                vector<uint8_t> blob(meshopt_encodeIndexBufferBound(count, lod.vertex_count));
+                blob.resize(meshopt_encodeIndexBuffer(blob.data(), blob.size(), data, count));
+                add_section(mesh_file::SectionType::Indices, lod_index, lod.index_offset + first, count, move(blob));
             }
         }
 
-        uint32_t vertex_count = static_cast<uint32_t>(m_vertices.size());
-        outfile.write(reinterpret_cast<const char*>(&vertex_count), sizeof(uint32_t));
-        outfile.write(reinterpret_cast<const char*>(m_vertices.data()), vertex_count * sizeof(RHI_Vertex_PosTexNorTan));
+        for (uint32_t lod_index = 0; lod_index < static_cast<uint32_t>(lods.size()); lod_index++)
+        {
+            const SubMesh& sub_mesh = m_sub_meshes[lods[lod_index].sub_mesh];
+            if (sub_mesh.clusters.empty() || lods[lod_index].index_offset != sub_mesh.lods[0].index_offset)
+                continue;
+
+            vector<uint8_t> blob(sub_mesh.clusters.size() * sizeof(MeshCluster));
+            memcpy(blob.data(), sub_mesh.clusters.data(), blob.size());
+            add_section(mesh_file::SectionType::Clusters, lod_index, 0, static_cast<uint32_t>(sub_mesh.clusters.size()), move(blob));
+        }
+
+        // skinning
+        if (!m_skeleton.IsEmpty())
+        {
+            vector<uint8_t> blob;
+            m_skeleton.Serialize(blob);
+            add_section(mesh_file::SectionType::Skeleton, 0, 0, m_skeleton.GetBoneCount(), move(blob));
+        }
+
+        for (uint32_t lod_index = 0; lod_index < static_cast<uint32_t>(lods.size()); lod_index++)
+        {
+            const mesh_file::Lod& lod = lods[lod_index];
+            if (!m_sub_meshes[lod.sub_mesh].skinned || lod.vertex_offset + lod.vertex_count > m_bone_weights.size())
+                continue;
+
+            vector<uint8_t> blob(meshopt_encodeVertexBufferBound(lod.vertex_count, sizeof(BoneWeights)));
+            blob.resize(meshopt_encodeVertexBuffer(blob.data(), blob.size(), &m_bone_weights[lod.vertex_offset], lod.vertex_count, sizeof(BoneWeights)));
+            add_section(mesh_file::SectionType::Weights, lod_index, lod.vertex_offset, lod.vertex_count, move(blob));
+        }
 
-        uint32_t index_count = static_cast<uint32_t>(m_indices.size());
-        outfile.write(reinterpret_cast<const char*>(&index_count), sizeof(uint32_t));
-        outfile.write(reinterpret_cast<const char*>(m_indices.data()), index_count * sizeof(uint32_t));
+        // header
+        mesh_file::Header header;
+        header.type           = static_cast<uint32_t>(m_type);
+        header.dropoff        = static_cast<uint32_t>(m_lod_dropoff);
+        header.flags          = m_flags;
+        header.vertex_format  = quantize ? 1 : 0;
+        header.sub_mesh_count = static_cast<uint32_t>(m_sub_meshes.size());
+        header.section_count  = static_cast<uint32_t>(sections.size());
+        header.vertex_count   = static_cast<uint32_t>(m_vertices.size());
+        header.index_count    = static_cast<uint32_t>(m_indices.size());
+
+        // lay out the file: header, table of contents, then every section on a 64 byte boundary
+        uint64_t offset = mesh_file::align(sizeof(mesh_file::Header) + sections.size() * sizeof(mesh_file::Section));
+        for (mesh_file::Section& section : sections)
+        {
+            section.offset = offset;
+            offset         = mesh_file::align(offset + section.size);
+        }
 
+        vector<uint8_t> file(offset, 0);
+        memcpy(file.data(), &header, sizeof(header));
+        memcpy(file.data() + sizeof(header), sections.data(), sections.size() * sizeof(mesh_file::Section));
+        for (uint32_t i = 0; i < static_cast<uint32_t>(sections.size()); i++)
+        {
+            memcpy(file.data() + sections[i].offset, blobs[i].data(), blobs[i].size());
+        }
+
+        ofstream outfile(file_path, ios::binary);
+        if (!outfile)
+        {
+            SP_LOG_ERROR("Failed to open file for writing: %s", file_path.c_str());
+            return;
+        }
+        outfile.write(reinterpret_cast<const char*>(file.data()), file.size());
         outfile.close();
     }
 
@@ -125,90 +366,370 @@ namespace spartan
         }
         else if (FileSystem::IsEngineMeshFile(file_path)) // native
         {
-            ifstream infile(file_path, ios::binary);
-            if (!infile)
+            Clear();
+
+            MappedFile file(file_path);
+            if (!file.IsOpen())
+                return;
+
+            // version 3 files start with a magic number, older ones with their version
+            bool is_mapped_format = false;
+            if (file.GetSize() >= sizeof(mesh_file::Header))
             {
-                SP_LOG_ERROR("Failed to open file: %s", file_path.c_str());
+                uint32_t magic = 0;
+                memcpy(&magic, file.GetData(), sizeof(magic));
+                is_mapped_format = magic == mesh_file::magic;
+            }
+
+            bool loaded = false;
+            if (is_mapped_format)
+            {
+                loaded = Deserialize(file.GetData(), file.GetSize(), file_path);
+            }
+            else
+            {
+                file.Close();
+                loaded = DeserializeLegacy(file_path);
+            }
+
+            if (!loaded)
                 return;
+
+            CreateGpuBuffers();
+        }
+        else
+        {
+            SP_LOG_ERROR("Failed to load mesh %s: format not supported", file_path.c_str());
+            return;
+        }
+
+        // compute memory usage
+        if (m_vertex_allocation && m_index_allocation)
+        {
+            m_object_size  = static_cast<uint64_t>(m_vertex_allocation->count) * m_vertex_allocation->buffer->GetStride();
+            m_object_size += static_cast<uint64_t>(m_index_allocation->count) * m_index_allocation->buffer->GetStride();
+        }
+
+        SP_LOG_INFO("Loading \"%s\" took %d ms", FileSystem::GetFileNameFromFilePath(file_path).c_str(), static_cast<int>(timer.GetElapsedTimeMs()));
+    }
+
+    bool Mesh::Deserialize(const uint8_t* data, const uint64_t size, const string& file_path)
+    {
+        mesh_file::Header header;
+        memcpy(&header, data, sizeof(header));
+        if (header.version != mesh_file::version)
+        {
+            SP_LOG_ERROR("Version mismatch for file: %s", file_path.c_str());
+            return false;
+        }
+
+        // table of contents
+        vector<mesh_file::Section> sections(header.section_count);
+        if (sizeof(header) + sections.size() * sizeof(mesh_file::Section) > size)
+        {
+            SP_LOG_ERROR("Truncated file: %s", file_path.c_str());
+            return false;
+        }
+        memcpy(sections.data(), data + sizeof(header), sections.size() * sizeof(mesh_file::Section));
+        for (const mesh_file::Section& section : sections)
+        {
+            if (section.offset + section.size > size)
+            {
+                SP_LOG_ERROR("Truncated file: %s", file_path.c_str());
+                return false;
             }
+        }
 
-            Clear();
+        m_type        = static_cast<MeshType>(header.type);
+        m_lod_dropoff = static_cast<MeshLodDropoff>(header.dropoff);
+        m_flags       = header.flags;
+
+        // lod table
+        vector<mesh_file::Lod> lods;
+        for (const mesh_file::Section& section : sections)
+        {
+            if (section.type != static_cast<uint32_t>(mesh_file::SectionType::Lods))
+                continue;
 
-            uint32_t version;
-            infile.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
-            if (version != 1)
+            if (section.size < section.element_count * sizeof(mesh_file::Lod))
             {
-                SP_LOG_ERROR("Version mismatch for file: %s", file_path.c_str());
-                return;
+                SP_LOG_ERROR("Invalid lods in file: %s", file_path.c_str());
+                return false;
             }
 
-            uint32_t type;
-            infile.read(reinterpret_cast<char*>(&type), sizeof(uint32_t));
-            m_type = static_cast<MeshType>(type);
+            lods.resize(section.element_count);
+            memcpy(lods.data(), data + section.offset, lods.size() * sizeof(mesh_file::Lod));
+        }
 
-            uint32_t dropoff;
-            infile.read(reinterpret_cast<char*>(&dropoff), sizeof(uint32_t));
-            m_lod_dropoff = static_cast<MeshLodDropoff>(dropoff);
+        m_sub_meshes.resize(header.sub_mesh_count);
+        for (const mesh_file::Lod& record : lods)
+        {
+            if (record.sub_mesh >= header.sub_mesh_count ||
+                record.vertex_offset + record.vertex_count > header.vertex_count ||
+                record.index_offset + record.index_count > header.index_count)
+            {
+                SP_LOG_ERROR("Invalid lod in file: %s", file_path.c_str());
+                return false;
+            }
 
-            infile.read(reinterpret_cast<char*>(&m_flags), sizeof(uint32_t));
+            MeshLod& lod      = m_sub_meshes[record.sub_mesh].lods.emplace_back();
+            lod.vertex_offset = record.vertex_offset;
+            lod.vertex_count  = record.vertex_count;
+            lod.index_offset  = record.index_offset;
+            lod.index_count   = record.index_count;
+            lod.aabb          = BoundingBox(Vector3(record.min[0], record.min[1], record.min[2]), Vector3(record.max[0], record.max[1], record.max[2]));
+        }
 
-            uint32_t submesh_count;
-            infile.read(reinterpret_cast<char*>(&submesh_count), sizeof(uint32_t));
-            m_sub_meshes.resize(submesh_count);
+        // clusters
+        for (const mesh_file::Section& section : sections)
+        {
+            if (section.type != static_cast<uint32_t>(mesh_file::SectionType::Clusters))
+                continue;
 
-            for (auto& sub : m_sub_meshes)
+            if (section.lod >= lods.size() || section.size < section.element_count * sizeof(MeshCluster))
             {
-                uint32_t lod_count;
-                infile.read(reinterpret_cast<char*>(&lod_count), sizeof(uint32_t));
-                sub.lods.resize(lod_count);
+                SP_LOG_ERROR("Invalid clusters in file: %s", file_path.c_str());
+                return false;
+            }
 
-                for (auto& lod : sub.lods)
+            vector<MeshCluster>& clusters = m_sub_meshes[lods[section.lod].sub_mesh].clusters;
+            clusters.resize(section.element_count);
+            memcpy(clusters.data(), data + section.offset, clusters.size() * sizeof(MeshCluster));
+        }
+
+        // skinning
+        m_skeleton.Clear();
+        m_bone_weights.clear();
+        for (const mesh_file::Section& section : sections)
+        {
+            if (section.type == static_cast<uint32_t>(mesh_file::SectionType::Skeleton))
+            {
+                if (!m_skeleton.Deserialize(data + section.offset, section.size))
                 {
-                    infile.read(reinterpret_cast<char*>(&lod.vertex_offset), sizeof(uint32_t));
-                    infile.read(reinterpret_cast<char*>(&lod.vertex_count), sizeof(uint32_t));
-                    infile.read(reinterpret_cast<char*>(&lod.index_offset), sizeof(uint32_t));
-                    infile.read(reinterpret_cast<char*>(&lod.index_count), sizeof(uint32_t));
-
-                    float min_x, min_y, min_z, max_x, max_y, max_z;
-                    infile.read(reinterpret_cast<char*>(&min_x), sizeof(float));
-                    infile.read(reinterpret_cast<char*>(&min_y), sizeof(float));
-                    infile.read(reinterpret_cast<char*>(&min_z), sizeof(float));
-                    infile.read(reinterpret_cast<char*>(&max_x), sizeof(float));
-                    infile.read(reinterpret_cast<char*>(&max_y), sizeof(float));
-                    infile.read(reinterpret_cast<char*>(&max_z), sizeof(float));
-
-                    lod.aabb = BoundingBox(Vector3(min_x, min_y, min_z), Vector3(max_x, max_y, max_z));
+                    SP_LOG_ERROR("Invalid skeleton in file: %s", file_path.c_str());
+                    return false;
                 }
             }
+            else if (section.type == static_cast<uint32_t>(mesh_file::SectionType::Weights))
+            {
+                if (section.lod >= lods.size())
+                {
+                    SP_LOG_ERROR("Invalid weights in file: %s", file_path.c_str());
+                    return false;
+                }
 
-            uint32_t vertex_count;
-            infile.read(reinterpret_cast<char*>(&vertex_count), sizeof(uint32_t));
-            m_vertices.resize(vertex_count);
-            infile.read(reinterpret_cast<char*>(m_vertices.data()), vertex_count * sizeof(RHI_Vertex_PosTexNorTan));
+                m_sub_meshes[lods[section.lod].sub_mesh].skinned = true;
+                m_bone_weights.resize(header.vertex_count);
+            }
+        }
 
-            uint32_t index_count;
-            infile.read(reinterpret_cast<char*>(&index_count), sizeof(uint32_t));
-            m_indices.resize(index_count);
-            infile.read(reinterpret_cast<char*>(m_indices.data()), index_count * sizeof(uint32_t));
+        // decode the streams in parallel, every section writes to its own range
+        m_vertices.resize(header.vertex_count);
+        m_indices.resize(header.index_count);
+        const bool quantized = header.vertex_format == 1;
+        atomic<bool> failed  = false;
+        auto decode_sections = [this, data, &sections, &lods, quantized, &header, &failed](uint32_t start, uint32_t end)
+        {
+            vector<RHI_Vertex_PosTexNorTan_Quantized> vertices_quantized;
+            for (uint32_t i = start; i < end; i++)
+            {
+                const mesh_file::Section& section = sections[i];
+                const uint8_t* source             = data + section.offset;
 
-            infile.close();
+                if (section.type == static_cast<uint32_t>(mesh_file::SectionType::Vertices))
+                {
+                    if (section.lod >= lods.size() || section.element_offset + section.element_count > header.vertex_count)
+                    {
+                        failed = true;
+                        continue;
+                    }
 
-            CreateGpuBuffers();
+                    if (quantized)
+                    {
+                        const mesh_file::Lod& lod = lods[section.lod];
+                        const BoundingBox bounds(Vector3(lod.min[0], lod.min[1], lod.min[2]), Vector3(lod.max[0], lod.max[1], lod.max[2]));
+
+                        vertices_quantized.resize(section.element_count);
+                        failed = failed || meshopt_decodeVertexBuffer(vertices_quantized.data(), section.element_count, sizeof(RHI_Vertex_PosTexNorTan_Quantized), source, section.size) != 0;
+                        geometry_processing::dequantize(vertices_quantized.data(), section.element_count, bounds, &m_vertices[section.element_offset]);
+                    }
+                    else
+                    {
+                        failed = failed || meshopt_decodeVertexBuffer(&m_vertices[section.element_offset], section.element_count, sizeof(RHI_Vertex_PosTexNorTan), source, section.size) != 0;
+                    }
+                }
+                else if (section.type == static_cast<uint32_t>(mesh_file::SectionType::Indices))
+                {
+                    if (section.element_offset + section.element_count > header.index_count)
+                    {
+                        failed = true;
+                        continue;
+                    }
+
+                    failed = failed || meshopt_decodeIndexBuffer(&m_indices[section.element_offset], section.element_count, sizeof(uint32_t), source, section.size) != 0;
+                }
+                else if (section.type == static_cast<uint32_t>(mesh_file::SectionType::Weights))
+                {
+                    if (section.element_offset + section.element_count > m_bone_weights.size())
+                    {
+                        failed = true;
+                        continue;
+                    }
+
+                    failed = failed || meshopt_decodeVertexBuffer(&m_bone_weights[section.element_offset], section.element_count, sizeof(BoneWeights), source, section.size) != 0;
+                }
+            }
+        };
+
+        if (!sections.empty())
+        {
+            ThreadPool::ParallelLoop(decode_sections, static_cast<uint32_t>(sections.size()));
+        }
+
+        if (failed)
+        {
+            SP_LOG_ERROR("Failed to decode geometry of %s", file_path.c_str());
+            Clear();
+            m_sub_meshes.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Mesh::DeserializeLegacy(const string& file_path)
+    {
+        ifstream infile(file_path, ios::binary);
+        if (!infile)
+        {
+            SP_LOG_ERROR("Failed to open file: %s", file_path.c_str());
+            return false;
+        }
+
+        uint32_t version;
+        infile.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+        if (version != 1 && version != 2)
+        {
+            SP_LOG_ERROR("Version mismatch for file: %s", file_path.c_str());
+            return false;
+        }
+
+        uint32_t type;
+        infile.read(reinterpret_cast<char*>(&type), sizeof(uint32_t));
+        m_type = static_cast<MeshType>(type);
+
+        uint32_t dropoff;
+        infile.read(reinterpret_cast<char*>(&dropoff), sizeof(uint32_t));
+        m_lod_dropoff = static_cast<MeshLodDropoff>(dropoff);
+
+        infile.read(reinterpret_cast<char*>(&m_flags), sizeof(uint32_t));
+
+        uint32_t submesh_count;
+        infile.read(reinterpret_cast<char*>(&submesh_count), sizeof(uint32_t));
+        m_sub_meshes.resize(submesh_count);
+
+        for (auto& sub : m_sub_meshes)
+        {
+            uint32_t lod_count;
+            infile.read(reinterpret_cast<char*>(&lod_count), sizeof(uint32_t));
+            sub.lods.resize(lod_count);
+
+            for (auto& lod : sub.lods)
+            {
+                infile.read(reinterpret_cast<char*>(&lod.vertex_offset), sizeof(uint32_t));
+                infile.read(reinterpret_cast<char*>(&lod.vertex_count), sizeof(uint32_t));
+                infile.read(reinterpret_cast<char*>(&lod.index_offset), sizeof(uint32_t));
+                infile.read(reinterpret_cast<char*>(&lod.index_count), sizeof(uint32_t));
+
+                float min_x, min_y, min_z, max_x, max_y, max_z;
+                infile.read(reinterpret_cast<char*>(&min_x), sizeof(float));
+                infile.read(reinterpret_cast<char*>(&min_y), sizeof(float));
+                infile.read(reinterpret_cast<char*>(&min_z), sizeof(float));
+                infile.read(reinterpret_cast<char*>(&max_x), sizeof(float));
+                infile.read(reinterpret_cast<char*>(&max_y), sizeof(float));
+                infile.read(reinterpret_cast<char*>(&max_z), sizeof(float));
+
+                lod.aabb = BoundingBox(Vector3(min_x, min_y, min_z), Vector3(max_x, max_y, max_z));
+            }
+        }
+
+        // version 1 files are always floats with 32-bit indices
+        uint32_t vertex_format = 0;
+        uint32_t index_size    = sizeof(uint32_t);
+        if (version >= 2)
+        {
+            infile.read(reinterpret_cast<char*>(&vertex_format), sizeof(uint32_t));
+            infile.read(reinterpret_cast<char*>(&index_size), sizeof(uint32_t));
+        }
+
+        uint32_t vertex_count;
+        infile.read(reinterpret_cast<char*>(&vertex_count), sizeof(uint32_t));
+        m_vertices.resize(vertex_count);
+        if (vertex_format == 1)
+        {
+            vector<RHI_Vertex_PosTexNorTan_Quantized> vertices_quantized(vertex_count);
+            infile.read(reinterpret_cast<char*>(vertices_quantized.data()), vertex_count * sizeof(RHI_Vertex_PosTexNorTan_Quantized));
+
+            for (const SubMesh& sub : m_sub_meshes)
+            {
+                for (const MeshLod& lod : sub.lods)
+                {
+                    geometry_processing::dequantize(&vertices_quantized[lod.vertex_offset], lod.vertex_count, lod.aabb, &m_vertices[lod.vertex_offset]);
+                }
+            }
         }
         else
         {
-            SP_LOG_ERROR("Failed to load mesh %s: format not supported", file_path.c_str());
-            return;
+            infile.read(reinterpret_cast<char*>(m_vertices.data()), vertex_count * sizeof(RHI_Vertex_PosTexNorTan));
         }
 
-        // compute memory usage
-        if (m_vertex_buffer && m_index_buffer)
+        uint32_t index_count;
+        infile.read(reinterpret_cast<char*>(&index_count), sizeof(uint32_t));
+        m_indices.resize(index_count);
+        if (index_size == sizeof(uint16_t))
+        {
+            vector<uint16_t> indices_16(index_count);
+            infile.read(reinterpret_cast<char*>(indices_16.data()), index_count * sizeof(uint16_t));
+            copy(indices_16.begin(), indices_16.end(), m_indices.begin());
+        }
+        else
         {
-            m_object_size = m_vertex_buffer->GetObjectSize();
-            m_object_size += m_index_buffer->GetObjectSize();
+            infile.read(reinterpret_cast<char*>(m_indices.data()), index_count * sizeof(uint32_t));
         }
 
-        SP_LOG_INFO("Loading \"%s\" took %d ms", FileSystem::GetFileNameFromFilePath(file_path).c_str(), static_cast<int>(timer.GetElapsedTimeMs()));
+        infile.close();
+
+        return true;
+    }
+
+    uint64_t Mesh::GetContentHash()
+    {
+        // lods still generating in the background are part of what gets saved
+        FlushLods();
+
+        lock_guard lock(m_mutex);
+
+        if (m_content_hash == 0)
+        {
+            uint64_t hash = hash_bytes(m_vertices.data(), m_vertices.size() * sizeof(RHI_Vertex_PosTexNorTan));
+            hash          = hash_combine(hash, hash_bytes(m_indices.data(), m_indices.size() * sizeof(uint32_t)));
+            hash          = hash_combine(hash, hash_bytes(m_bone_weights.data(), m_bone_weights.size() * sizeof(BoneWeights)));
+            hash          = hash_combine(hash, m_skeleton.GetLayoutHash());
+            for (const SubMesh& sub_mesh : m_sub_meshes)
+            {
+                for (const MeshLod& lod : sub_mesh.lods)
+                {
+                    hash = hash_combine(hash, hash_bytes(&lod, offsetof(MeshLod, aabb)));
+                }
+            }
+            hash = hash_combine(hash, static_cast<uint64_t>(m_type));
+            hash = hash_combine(hash, static_cast<uint64_t>(m_lod_dropoff));
+            hash = hash_combine(hash, static_cast<uint64_t>(m_flags));
+
+            m_content_hash = hash != 0 ? hash : 1;
+        }
+
+        return m_content_hash;
     }
 
     uint32_t Mesh::GetMemoryUsage() const
@@ -220,6 +741,21 @@ namespace spartan
         return size;
     }
 
+    bool Mesh::CanUse16BitIndices() const
+    {
+        // indices are relative to the first vertex of their lod, so it's the largest lod that matters
+        for (const SubMesh& sub : m_sub_meshes)
+        {
+            for (const MeshLod& lod : sub.lods)
+            {
+                if (lod.vertex_count > numeric_limits<uint16_t>::max() + 1u)
+                    return false;
+            }
+        }
+
+        return !m_sub_meshes.empty();
+    }
+
     void Mesh::GetGeometry(uint32_t sub_mesh_index, vector<uint32_t>* indices, vector<RHI_Vertex_PosTexNorTan>* vertices)
     {
         SP_ASSERT_MSG(indices != nullptr || vertices != nullptr, "Indices and vertices vectors can't both be null");
@@ -247,6 +783,44 @@ namespace spartan
         }
     }
 
+    bool Mesh::Raycast(const uint32_t sub_mesh_index, const Ray& ray, float& distance)
+    {
+        if (sub_mesh_index >= m_sub_meshes.size() || m_sub_meshes[sub_mesh_index].lods.empty())
+            return false;
+
+        const MeshLod& lod = m_sub_meshes[sub_mesh_index].lods[0];
+        MeshBvh* bvh       = nullptr;
+        {
+            lock_guard lock(m_mutex_bvh);
+
+            if (m_bvhs.size() <= sub_mesh_index)
+            {
+                m_bvhs.resize(m_sub_meshes.size());
+            }
+
+            if (!m_bvhs[sub_mesh_index])
+            {
+                const Stopwatch timer;
+                m_bvhs[sub_mesh_index] = make_unique<MeshBvh>();
+                m_bvhs[sub_mesh_index]->Build(&m_vertices[lod.vertex_offset], &m_indices[lod.index_offset], lod.index_count);
+
+                SP_LOG_INFO("Built bvh for \"%s\" (sub-mesh %u, %u triangles, %u nodes, %.1f KB) in %.1f ms",
+                    GetObjectName().c_str(),
+                    sub_mesh_index,
+                    lod.index_count / 3,
+                    m_bvhs[sub_mesh_index]->GetNodeCount(),
+                    static_cast<float>(m_bvhs[sub_mesh_index]->GetMemoryUsage()) / 1024.0f,
+                    static_cast<float>(timer.GetElapsedTimeMs())
+                );
+            }
+
+            bvh = m_bvhs[sub_mesh_index].get();
+        }
+
+        // once built a bvh is immutable, so queries don't need the lock
+        return bvh->Intersect(ray, &m_vertices[lod.vertex_offset], &m_indices[lod.index_offset], distance);
+    }
+
     void Mesh::AddLod(vector<RHI_Vertex_PosTexNorTan>& vertices, vector<uint32_t>& indices, const uint32_t sub_mesh_index)
     {
         // build lod
@@ -257,6 +831,21 @@ namespace spartan
         lod.index_count   = static_cast<uint32_t>(indices.size());
         lod.aabb          = BoundingBox(vertices.data(), static_cast<uint32_t>(vertices.size()));
 
+        // snap to what the quantized layout can represent, so that the geometry is the same before and after a save
+        if (m_flags & static_cast<uint32_t>(MeshFlags::PostProcessQuantizeVertices))
+        {
+            vector<RHI_Vertex_PosTexNorTan_Quantized> vertices_quantized(vertices.size());
+            geometry_processing::quantize(vertices.data(), lod.vertex_count, lod.aabb, vertices_quantized.data());
+            geometry_processing::dequantize(vertices_quantized.data(), lod.vertex_count, lod.aabb, vertices.data());
+        }
+
+        // split lod 0 of large sub-meshes into clusters, this reorders the indices but keeps the triangles
+        vector<MeshCluster> clusters;
+        if ((m_flags & static_cast<uint32_t>(MeshFlags::PostProcessBuildClusters)) && m_sub_meshes[sub_mesh_index].lods.empty() && indices.size() >= mesh_cluster_min_index_count)
+        {
+            geometry_processing::build_clusters(vertices, indices, clusters);
+        }
+
         // append geometry
         {
             lock_guard lock(m_mutex);
@@ -267,83 +856,85 @@ namespace spartan
 
             // add lod to the specified sub-mesh
             m_sub_meshes[sub_mesh_index].lods.push_back(lod);
+            if (!clusters.empty())
+            {
+                m_sub_meshes[sub_mesh_index].clusters = move(clusters);
+            }
+
+            m_content_hash = 0;
         }
     }
 
-    void Mesh::AddGeometry(vector<RHI_Vertex_PosTexNorTan>& vertices, vector<uint32_t>& indices, const bool generate_lods, uint32_t* sub_mesh_index)
+    void Mesh::AddGeometry(vector<RHI_Vertex_PosTexNorTan>& vertices, vector<uint32_t>& indices, const bool generate_lods, uint32_t* sub_mesh_index, const vector<BoneWeights>* bone_weights)
     {
+        SP_ASSERT(!bone_weights || bone_weights->size() == vertices.size());
+
         // create a sub-mesh
         SubMesh sub_mesh;
+        sub_mesh.skinned                = bone_weights != nullptr;
         uint32_t current_sub_mesh_index = static_cast<uint32_t>(m_sub_meshes.size());
         m_sub_meshes.push_back(sub_mesh); // add it to the list so AddLod() can access it
 
         // lod 0: original geometry
         {
-            // optimize original geometry if flagged
-            if (m_flags & static_cast<uint32_t>(MeshFlags::PostProcessOptimize))
+            // optimize original geometry if flagged, this remaps vertices so the weights wouldn't line up anymore
+            if ((m_flags & static_cast<uint32_t>(MeshFlags::PostProcessOptimize)) && !bone_weights)
             {
                 geometry_processing::optimize(vertices, indices);
             }
 
             // add the original geometry as lod 0
             AddLod(vertices, indices, current_sub_mesh_index);
+
+            // the weights follow the vertices that were just appended
+            if (bone_weights)
+            {
+                lock_guard lock(m_mutex);
+
+                const size_t vertex_offset = m_sub_meshes[current_sub_mesh_index].lods[0].vertex_offset;
+                m_bone_weights.resize(max(m_bone_weights.size(), vertex_offset + bone_weights->size()));
+                copy(bone_weights->begin(), bone_weights->end(), m_bone_weights.begin() + vertex_offset);
+            }
         }
 
-        // generate additional lod if requested
-        if (generate_lods && (m_flags & static_cast<uint32_t>(MeshFlags::PostProcessGenerateLods)))
+        // generate additional lods if requested, only if the geometry is complex enough
+        if (generate_lods && !bone_weights && (m_flags & static_cast<uint32_t>(MeshFlags::PostProcessGenerateLods)) && indices.size() > 64)
         {
-            // store the original index count (for reference, but we'll base targets on previous lod)
-            size_t original_index_count = indices.size();
-            
-            // start with the original geometry for lod 1 onwards
-            vector<RHI_Vertex_PosTexNorTan> prev_vertices = vertices;
-            vector<uint32_t> prev_indices                 = indices;
-            
+            // every lod is simplified from lod 0, so all of them (and those of other sub-meshes) can be generated concurrently
+            auto source = make_shared<MeshLodSource>();
+            source->vertices       = vertices;
+            source->indices        = indices;
+            source->preserve_edges = m_flags & static_cast<uint32_t>(MeshFlags::PostProcessPreserveTerrainEdges);
+
+            float retained = 1.0f;
             for (uint32_t lod_level = 1; lod_level < mesh_lod_count; lod_level++)
             {
-                // use the previous lod's geometry for simplification
-                vector<RHI_Vertex_PosTexNorTan> lod_vertices = prev_vertices;
-                vector<uint32_t> lod_indices                 = prev_indices;
-            
-                // only simplify if the geometry is complex enough
-                if (lod_indices.size() > 64)
+                // compute target fraction based on LOD level
+                float t = static_cast<float>(lod_level) / static_cast<float>(mesh_lod_count);
+                if (m_lod_dropoff == MeshLodDropoff::Exponential)
                 {
-                    // compute target fraction based on LOD level
-                    float t = static_cast<float>(lod_level) / static_cast<float>(mesh_lod_count);
-                    if (m_lod_dropoff == MeshLodDropoff::Exponential)
-                    {
-                        t = pow(t, 2.0f);
-                    }
-                    else if (m_lod_dropoff == MeshLodDropoff::Aggressive)
-                    {
-                        t = pow(t, 0.4f); // fast start, slow end - more aggressive early
-                    }
-                    float target_fraction = max(0.1f, 1.0f - t); // retain at least 10% to avoid over-reduction
-
-                    // compute target index count based on the previous lod's actual index count
-                    size_t target_index_count = max(static_cast<size_t>(64), static_cast<size_t>(prev_indices.size() * target_fraction));
-            
-                    // simplify geometry
-                    bool preserve_uvs   = true;
-                    bool preserve_edges = m_flags & static_cast<uint32_t>(MeshFlags::PostProcessPreserveTerrainEdges);
-                    geometry_processing::simplify(lod_indices, lod_vertices, target_index_count, preserve_uvs, preserve_edges);
-            
-                    // check if simplification reduced the index count; if not, stop
-                    if (lod_indices.size() >= prev_indices.size())
-                        break;
-            
-                    // add the simplified geometry as a new lod
-                    AddLod(lod_vertices, lod_indices, current_sub_mesh_index);
-            
-                    // update previous geometry for the next iteration
-                    prev_vertices = move(lod_vertices);
-                    prev_indices  = move(lod_indices);
+                    t = pow(t, 2.0f);
+                }
+                else if (m_lod_dropoff == MeshLodDropoff::Aggressive)
+                {
+                    t = pow(t, 0.4f); // fast start, slow end - more aggressive early
                 }
-                else
+                retained *= max(0.1f, 1.0f - t); // each lod retains at least 10% of the previous one, to avoid over-reduction
+
+                auto job                = make_shared<MeshLodJob>();
+                job->source             = source;
+                job->sub_mesh_index     = current_sub_mesh_index;
+                job->target_index_count = max(static_cast<size_t>(64), static_cast<size_t>(source->indices.size() * retained));
+
                 {
-                    // If too simple to simplify further, stop generating LODs
-                    break;
+                    lock_guard lock(m_mutex);
+                    m_lod_jobs.emplace_back(job);
                 }
+
+                ThreadPool::AddTask([job]()
+                {
+                    run_lod_job(*job);
+                });
             }
         }
 
@@ -354,6 +945,47 @@ namespace spartan
         }
     }
 
+    void Mesh::FlushLods()
+    {
+        vector<shared_ptr<MeshLodJob>> jobs;
+        {
+            lock_guard lock(m_mutex);
+            jobs = move(m_lod_jobs);
+            m_lod_jobs.clear();
+        }
+
+        if (jobs.empty())
+            return;
+
+        // help with jobs that no worker has picked up yet, this also avoids waiting on a saturated pool
+        for (shared_ptr<MeshLodJob>& job : jobs)
+        {
+            run_lod_job(*job);
+        }
+
+        // append in submission order (sub-mesh, then level) so the layout doesn't depend on thread timing
+        unordered_set<uint32_t> chains_ended;
+        for (shared_ptr<MeshLodJob>& job : jobs)
+        {
+            while (job->state.load(memory_order_acquire) != MeshLodJob::done)
+            {
+                this_thread::yield();
+            }
+
+            if (chains_ended.count(job->sub_mesh_index))
+                continue;
+
+            // a level that doesn't reduce the previous one ends the chain of its sub-mesh
+            if (job->indices.empty() || job->indices.size() >= m_sub_meshes[job->sub_mesh_index].lods.back().index_count)
+            {
+                chains_ended.insert(job->sub_mesh_index);
+                continue;
+            }
+
+            AddLod(job->vertices, job->indices, job->sub_mesh_index);
+        }
+    }
+
     uint32_t Mesh::GetVertexCount() const
     {
         return static_cast<uint32_t>(m_vertices.size());
@@ -370,28 +1002,32 @@ namespace spartan
             static_cast<uint32_t>(MeshFlags::ImportRemoveRedundantData) |
             static_cast<uint32_t>(MeshFlags::PostProcessNormalizeScale) |
             static_cast<uint32_t>(MeshFlags::PostProcessOptimize)       |
-            static_cast<uint32_t>(MeshFlags::PostProcessGenerateLods);
+            static_cast<uint32_t>(MeshFlags::PostProcessGenerateLods)   |
+            static_cast<uint32_t>(MeshFlags::PostProcessBuildClusters);
     }
 
     void Mesh::CreateGpuBuffers()
     {
-        // vertex buffer
-        m_vertex_buffer = make_unique<RHI_Buffer>(RHI_Buffer_Type::Vertex,
-            sizeof(m_vertices[0]),
-            static_cast<uint32_t>(m_vertices.size()),
-            static_cast<void*>(&m_vertices[0]),
-            false,
-            (string("mesh_vertex_buffer_") + m_object_name).c_str()
-        );
-
-        // index buffer
-        m_index_buffer = make_unique<RHI_Buffer>(RHI_Buffer_Type::Index,
-            sizeof(m_indices[0]),
-            static_cast<uint32_t>(m_indices.size()),
-            static_cast<void*>(&m_indices[0]),
-            false,
-            (string("mesh_index_buffer_") + m_object_name).c_str()
-        );
+        // lods that are still being generated have to be part of the buffers
+        FlushLods();
+
+        // release previous ranges, if any
+        GeometryPool::Free(m_index_allocation);
+        GeometryPool::Free(m_vertex_allocation);
+
+        // vertices
+        m_vertex_allocation = GeometryPool::Allocate(GeometryPoolType::Vertex, static_cast<uint32_t>(m_vertices.size()), m_vertices.data());
+
+        // indices, halved when every lod can be addressed with 16 bits
+        if (CanUse16BitIndices())
+        {
+            vector<uint16_t> indices_16(m_indices.begin(), m_indices.end());
+            m_index_allocation = GeometryPool::Allocate(GeometryPoolType::Index16, static_cast<uint32_t>(indices_16.size()), indices_16.data());
+        }
+        else
+        {
+            m_index_allocation = GeometryPool::Allocate(GeometryPoolType::Index32, static_cast<uint32_t>(m_indices.size()), m_indices.data());
+        }
 
         // normalize scale
         if (m_flags & static_cast<uint32_t>(MeshFlags::PostProcessNormalizeScale))
@@ -406,6 +1042,26 @@ namespace spartan
         }
     }
 
+    RHI_Buffer* Mesh::GetIndexBuffer() const
+    {
+        return m_index_allocation ? m_index_allocation->buffer : nullptr;
+    }
+
+    RHI_Buffer* Mesh::GetVertexBuffer() const
+    {
+        return m_vertex_allocation ? m_vertex_allocation->buffer : nullptr;
+    }
+
+    uint32_t Mesh::GetIndexBufferOffset() const
+    {
+        return m_index_allocation ? m_index_allocation->offset : 0;
+    }
+
+    uint32_t Mesh::GetVertexBufferOffset() const
+    {
+        return m_vertex_allocation ? m_vertex_allocation->offset : 0;
+    }
+
     void Mesh::BuildAccelerationStructure(RHI_CommandList* cmd_list)
     {
         SP_ASSERT(RHI_Device::IsSupportedRayTracing());
@@ -413,6 +1069,9 @@ namespace spartan
         if (m_blas && !m_sub_meshes.empty())
             return;
 
+        // the blas copies the geometry, so the pool is free to move it around afterwards
+        RHI_Buffer* vertex_buffer = GetVertexBuffer();
+        RHI_Buffer* index_buffer  = GetIndexBuffer();
         vector<RHI_AccelerationStructureGeometry> geometries;
         vector<uint32_t> primitive_counts;
         for (const auto& sub : m_sub_meshes)
@@ -422,11 +1081,11 @@ namespace spartan
 
             geo.transparent              = false;
             geo.vertex_format            = RHI_Format::R32G32B32_Float; // positions
-            geo.vertex_buffer_address    = RHI_Device::GetBufferDeviceAddress(m_vertex_buffer->GetRhiResource()) + lod.vertex_offset * m_vertex_buffer->GetStride();
-            geo.vertex_stride            = m_vertex_buffer->GetStride();
+            geo.vertex_buffer_address    = RHI_Device::GetBufferDeviceAddress(vertex_buffer->GetRhiResource()) + static_cast<uint64_t>(GetVertexBufferOffset() + lod.vertex_offset) * vertex_buffer->GetStride();
+            geo.vertex_stride            = vertex_buffer->GetStride();
             geo.max_vertex               = lod.vertex_count - 1;
-            geo.index_format             = RHI_Format::R32_Uint;
-            geo.index_buffer_address     = RHI_Device::GetBufferDeviceAddress(m_index_buffer->GetRhiResource()) + lod.index_offset * sizeof(uint32_t);
+            geo.index_format             = index_buffer->GetStride() == sizeof(uint16_t) ? RHI_Format::R16_Uint : RHI_Format::R32_Uint;
+            geo.index_buffer_address     = RHI_Device::GetBufferDeviceAddress(index_buffer->GetRhiResource()) + static_cast<uint64_t>(GetIndexBufferOffset() + lod.index_offset) * index_buffer->GetStride();
         
             geometries.push_back(geo);
             primitive_counts.push_back(lod.index_count / 3);
@@ -435,4 +1094,328 @@ namespace spartan
         m_blas = make_unique<RHI_AccelerationStructure>(RHI_AccelerationStructureType::Bottom, (m_object_name + "_blas").c_str());
         m_blas->BuildBottomLevel(cmd_list, geometries, primitive_counts);
     }
+
+    bool Mesh::TestVertexQuantization()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Vertex quantization %s failed", name);
+                passed = false;
+            }
+        };
+
+        // the geometry the default worlds are built from, plus random vertices that cover every direction
+        vector<pair<const char*, vector<RHI_Vertex_PosTexNorTan>>> sets;
+        vector<uint32_t> indices;
+        geometry_generation::generate_cube(&sets.emplace_back("cube", vector<RHI_Vertex_PosTexNorTan>()).second, &indices);
+        geometry_generation::generate_sphere(&sets.emplace_back("sphere", vector<RHI_Vertex_PosTexNorTan>()).second, &indices);
+        geometry_generation::generate_cylinder(&sets.emplace_back("cylinder", vector<RHI_Vertex_PosTexNorTan>()).second, &indices);
+        geometry_generation::generate_grid(&sets.emplace_back("grid", vector<RHI_Vertex_PosTexNorTan>()).second, &indices, 256, 1000.0f);
+        geometry_generation::generate_foliage_grass_blade(&sets.emplace_back("grass", vector<RHI_Vertex_PosTexNorTan>()).second, &indices, 5);
+        geometry_generation::generate_foliage_flower(&sets.emplace_back("flower", vector<RHI_Vertex_PosTexNorTan>()).second, &indices, 3, 6, 3);
+        {
+            vector<RHI_Vertex_PosTexNorTan>& vertices = sets.emplace_back("random", vector<RHI_Vertex_PosTexNorTan>()).second;
+            mt19937 generator(0); // fixed seed, so runs are comparable
+            uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+            auto random_direction = [&]()
+            {
+                Vector3 v;
+                do { v = Vector3(distribution(generator), distribution(generator), distribution(generator)); } while (v.LengthSquared() < 0.01f || v.LengthSquared() > 1.0f);
+                return v.Normalized();
+            };
+
+            vertices.resize(100000);
+            for (RHI_Vertex_PosTexNorTan& vertex : vertices)
+            {
+                const Vector3 position = Vector3(distribution(generator), distribution(generator), distribution(generator)) * 500.0f;
+                const Vector2 uv       = Vector2(distribution(generator), distribution(generator)) * 4.0f;
+                vertex                 = RHI_Vertex_PosTexNorTan(position, uv, random_direction(), random_direction());
+            }
+        }
+
+        uint32_t vertex_count = 0;
+        uint64_t pool_used    = 0;
+        for (const auto& [name, vertices] : sets)
+        {
+            const uint32_t count = static_cast<uint32_t>(vertices.size());
+            BoundingBox bounds(vertices.data(), count);
+            float uv_max = 0.0f;
+            for (const RHI_Vertex_PosTexNorTan& vertex : vertices)
+            {
+                uv_max = max({ uv_max, abs(vertex.tex[0]), abs(vertex.tex[1]) });
+            }
+
+            // the gpu layout keeps positions exact, halves have 11 bits of precision and octahedral snorm16 stays within a twentieth of a degree
+            const geometry_processing::quantization_error gpu = geometry_processing::measure_gpu_packing_error(vertices.data(), count);
+            expect("gpu position", gpu.position == 0.0f);
+            expect("gpu uv", gpu.uv <= max(uv_max, 1.0f) / 2048.0f);
+            expect("gpu normal", gpu.normal < 0.05f);
+            expect("gpu tangent", gpu.tangent < 0.05f);
+
+            // the disk layout also snaps positions to 16 bits within the bounds, so half a step per axis
+            const geometry_processing::quantization_error disk = geometry_processing::measure_quantization_error(vertices.data(), count, bounds);
+            const float position_step = bounds.GetSize().Length() / 65535.0f;
+            expect("disk position", disk.position <= position_step * 0.5f + 1e-5f);
+            expect("disk uv", disk.uv <= max(uv_max, 1.0f) / 2048.0f);
+            expect("disk normal", disk.normal < 0.05f);
+            expect("disk tangent", disk.tangent < 0.05f);
+
+            SP_LOG_INFO("Vertex quantization \"%s\": %u vertices, gpu error: uv %f, normal %.4f, tangent %.4f degrees, disk error: position %f",
+                name, count, gpu.uv, gpu.normal, gpu.tangent, disk.position);
+
+            // what the vertices actually occupy in the geometry pool
+            const uint64_t used_before     = GeometryPool::GetMemoryUsed(GeometryPoolType::Vertex);
+            GeometryAllocation* allocation = GeometryPool::Allocate(GeometryPoolType::Vertex, count, vertices.data());
+            const uint64_t used            = GeometryPool::GetMemoryUsed(GeometryPoolType::Vertex) - used_before;
+            GeometryPool::Free(allocation);
+            expect("geometry pool", allocation != nullptr);
+            expect("gpu memory", used == static_cast<uint64_t>(count) * sizeof(RHI_Vertex_PosTexNorTan_Gpu));
+
+            pool_used    += used;
+            vertex_count += count;
+        }
+
+        // the pool has to come in at the packed size, which is what the float layout would have cost before
+        const uint64_t size_float = static_cast<uint64_t>(vertex_count) * sizeof(RHI_Vertex_PosTexNorTan);
+        expect("gpu memory saving", pool_used * 44 == size_float * 24);
+        SP_LOG_INFO("Vertex quantization: %u vertices take %.1f KB in the geometry pool instead of %.1f KB",
+            vertex_count, static_cast<float>(pool_used) / 1024.0f, static_cast<float>(size_float) / 1024.0f);
+
+        return passed;
+    }
+
+    bool Mesh::TestClusterCulling()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Cluster culling %s failed", name);
+                passed = false;
+            }
+        };
+
+        // a finely tessellated sphere, made of many clusters
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        vector<uint32_t> indices;
+        geometry_generation::generate_sphere(&vertices, &indices, 1.0f, 64, 64);
+        vector<MeshCluster> clusters;
+        geometry_processing::build_clusters(vertices, indices, clusters);
+        const uint32_t cluster_count = static_cast<uint32_t>(clusters.size());
+        expect("clusters built", cluster_count > 16);
+
+        // a camera 10 units back, looking down +z at the origin
+        const Vector3 eye      = Vector3(0.0f, 0.0f, -10.0f);
+        const float far_plane  = 100.0f;
+        const Frustum frustum(Matrix::CreateLookAtLH(eye, Vector3::Zero, Vector3::Up), Matrix::CreatePerspectiveFieldOfViewLH(60.0f * deg_to_rad, 1.0f, 0.1f, far_plane));
+
+        // culls, then maps the ranges back to clusters, checking that they are ordered, disjoint and made of whole clusters
+        vector<MeshClusterRange> ranges;
+        vector<bool> visible(cluster_count);
+        auto cull = [&](const Matrix& transform, const bool cull_back_facing, const bool ignore_depth)
+        {
+            ranges.clear();
+            const uint32_t count = geometry_processing::cull_clusters(clusters, transform, frustum, eye, cull_back_facing, ignore_depth, ranges);
+
+            bool ordered         = true;
+            uint32_t end         = 0;
+            uint32_t range_total = 0;
+            for (const MeshClusterRange& range : ranges)
+            {
+                ordered      = ordered && range.index_offset >= end && range.index_count != 0;
+                end          = range.index_offset + range.index_count;
+                range_total += range.index_count;
+            }
+
+            uint32_t covered       = 0;
+            uint32_t covered_total = 0;
+            for (uint32_t i = 0; i < cluster_count; i++)
+            {
+                const MeshCluster& cluster = clusters[i];
+                visible[i]                 = any_of(ranges.begin(), ranges.end(), [&cluster](const MeshClusterRange& range)
+                {
+                    return range.index_offset <= cluster.index_offset && cluster.index_offset + cluster.index_count <= range.index_offset + range.index_count;
+                });
+                covered       += visible[i] ? 1 : 0;
+                covered_total += visible[i] ? cluster.index_count : 0;
+            }
+            expect("ranges made of whole clusters", ordered && covered == count && covered_total == range_total);
+
+            return count;
+        };
+
+        // applies a test to every triangle of every cluster, in world space
+        auto any_triangle = [&](const uint32_t cluster_index, const Matrix& transform, auto&& test)
+        {
+            const MeshCluster& cluster = clusters[cluster_index];
+            for (uint32_t i = cluster.index_offset; i < cluster.index_offset + cluster.index_count; i += 3)
+            {
+                Vector3 positions[3];
+                Vector3 normal = Vector3::Zero;
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    const RHI_Vertex_PosTexNorTan& vertex = vertices[indices[i + corner]];
+                    positions[corner]                     = Vector3(vertex.pos[0], vertex.pos[1], vertex.pos[2]) * transform;
+                    normal                               += Vector3(vertex.nor[0], vertex.nor[1], vertex.nor[2]);
+                }
+                if (test(positions, normal.Normalized()))
+                    return true;
+            }
+            return false;
+        };
+
+        // frustum, in view everything is visible as a single range, behind the camera nothing is
+        {
+            expect("frustum, in view", cull(Matrix::Identity, false, false) == cluster_count);
+            expect("frustum, single range", ranges.size() == 1 && ranges[0].index_offset == 0 && ranges[0].index_count == indices.size());
+            expect("frustum, behind", cull(Matrix::CreateTranslation(Vector3(0.0f, 0.0f, -20.0f)), false, false) == 0);
+        }
+
+        // frustum, straddling the left plane some clusters survive, and every cluster with a vertex in view does
+        {
+            const Matrix transform = Matrix::CreateTranslation(Vector3(-10.0f * tan(30.0f * deg_to_rad), 0.0f, 0.0f));
+            const uint32_t count   = cull(transform, false, false);
+            expect("frustum, partial", count > 0 && count < cluster_count);
+
+            bool conservative = true;
+            for (uint32_t i = 0; i < cluster_count; i++)
+            {
+                const bool in_view = any_triangle(i, transform, [&frustum](const Vector3* positions, const Vector3&)
+                {
+                    return frustum.IsVisible(positions[0], 0.0f) || frustum.IsVisible(positions[1], 0.0f) || frustum.IsVisible(positions[2], 0.0f);
+                });
+                conservative = conservative && (!in_view || visible[i]);
+            }
+            expect("frustum, conservative", conservative);
+        }
+
+        // normal cones, the far side of the sphere goes away, but never a cluster with a triangle facing the camera
+        {
+            const uint32_t count = cull(Matrix::Identity, true, false);
+            expect("backface, culled", count > 0 && count < cluster_count * 3 / 4);
+
+            bool conservative = true;
+            for (uint32_t i = 0; i < cluster_count; i++)
+            {
+                const bool facing = any_triangle(i, Matrix::Identity, [&eye](const Vector3* positions, const Vector3& normal)
+                {
+                    const Vector3 center = (positions[0] + positions[1] + positions[2]) / 3.0f;
+                    return Vector3::Dot(normal, eye - center) > 0.0f;
+                });
+                conservative = conservative && (!facing || visible[i]);
+            }
+            expect("backface, conservative", conservative);
+
+            // cones are only valid under uniform, non-mirrored scaling
+            expect("backface, uniform scale", cull(Matrix::CreateScale(2.0f), true, false) < cluster_count);
+            expect("backface, non-uniform scale", cull(Matrix::CreateScale(1.0f, 2.0f, 1.0f), true, false) == cluster_count);
+            expect("backface, mirrored", cull(Matrix::CreateScale(-1.0f, 1.0f, 1.0f), true, false) == cluster_count);
+        }
+
+        // ignore_depth, past the far plane only the side planes cull
+        {
+            const Matrix beyond_far = Matrix::CreateTranslation(Vector3(0.0f, 0.0f, far_plane + 10.0f));
+            expect("depth, beyond the far plane", cull(beyond_far, false, false) == 0);
+            expect("depth, ignored", cull(beyond_far, false, true) == cluster_count);
+            expect("depth, ignored but off to the side", cull(Matrix::CreateTranslation(Vector3(far_plane * 2.0f, 0.0f, far_plane + 10.0f)), false, true) == 0);
+        }
+
+        return passed;
+    }
+
+    void Mesh::BenchmarkLoad(const uint32_t grid_points)
+    {
+        Mesh mesh;
+        {
+            vector<RHI_Vertex_PosTexNorTan> vertices;
+            vector<uint32_t> indices;
+            geometry_generation::generate_grid(&vertices, &indices, grid_points, 1000.0f);
+            mesh.AddGeometry(vertices, indices, true);
+            mesh.FlushLods();
+        }
+
+        // version 1, the layout the legacy reader expects: lod table, then raw float vertices and 32-bit indices
+        const string path_v1 = FileSystem::GetWorkingDirectory() + "/benchmark_load_v1.mesh";
+        uint64_t v1_size     = 0;
+        {
+            ofstream file(path_v1, ios::binary);
+            auto write = [&file](const auto& value) { file.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+            write(uint32_t(1));
+            write(static_cast<uint32_t>(mesh.m_type));
+            write(static_cast<uint32_t>(mesh.m_lod_dropoff));
+            write(mesh.m_flags);
+            write(static_cast<uint32_t>(mesh.m_sub_meshes.size()));
+            for (const SubMesh& sub_mesh : mesh.m_sub_meshes)
+            {
+                write(static_cast<uint32_t>(sub_mesh.lods.size()));
+                for (const MeshLod& lod : sub_mesh.lods)
+                {
+                    write(lod.vertex_offset);
+                    write(lod.vertex_count);
+                    write(lod.index_offset);
+                    write(lod.index_count);
+                    for (const Vector3& corner : { lod.aabb.GetMin(), lod.aabb.GetMax() })
+                    {
+                        write(corner.x);
+                        write(corner.y);
+                        write(corner.z);
+                    }
+                }
+            }
+            write(static_cast<uint32_t>(mesh.m_vertices.size()));
+            file.write(reinterpret_cast<const char*>(mesh.m_vertices.data()), mesh.m_vertices.size() * sizeof(RHI_Vertex_PosTexNorTan));
+            write(static_cast<uint32_t>(mesh.m_indices.size()));
+            file.write(reinterpret_cast<const char*>(mesh.m_indices.data()), mesh.m_indices.size() * sizeof(uint32_t));
+            v1_size = static_cast<uint64_t>(file.tellp());
+        }
+
+        // version 3, the current format
+        const string path_v3 = FileSystem::GetWorkingDirectory() + "/benchmark_load_v3.mesh";
+        mesh.SaveToFile(path_v3);
+
+        // best of a few runs, gpu uploads are the same for both and left out
+        const uint32_t run_count = 3;
+        double v1_ms             = numeric_limits<double>::max();
+        double v3_ms             = numeric_limits<double>::max();
+        uint64_t v3_size         = 0;
+        bool v1_loaded           = true;
+        bool v3_loaded           = true;
+        for (uint32_t run = 0; run < run_count; run++)
+        {
+            {
+                Mesh loaded;
+                const Stopwatch timer;
+                v1_loaded = loaded.DeserializeLegacy(path_v1) && v1_loaded;
+                v1_ms     = min(v1_ms, max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6));
+            }
+
+            {
+                Mesh loaded;
+                const Stopwatch timer;
+                MappedFile file(path_v3);
+                v3_loaded = file.IsOpen() && loaded.Deserialize(file.GetData(), file.GetSize(), path_v3) && v3_loaded;
+                v3_ms     = min(v3_ms, max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6));
+                v3_size   = file.GetSize();
+            }
+        }
+
+        SP_LOG_INFO("Mesh load, %u triangles in %zu lods: version 1 %.1f ms (%.1f MB%s), version 3 %.1f ms (%.1f MB%s), %.1fx",
+            mesh.m_sub_meshes[0].lods[0].index_count / 3,
+            mesh.m_sub_meshes[0].lods.size(),
+            v1_ms,
+            static_cast<double>(v1_size) / (1024.0 * 1024.0),
+            v1_loaded ? "" : ", failed",
+            v3_ms,
+            static_cast<double>(v3_size) / (1024.0 * 1024.0),
+            v3_loaded ? "" : ", failed",
+            v1_ms / v3_ms);
+
+        FileSystem::Delete(path_v1);
+        FileSystem::Delete(path_v3);
+    }
 }
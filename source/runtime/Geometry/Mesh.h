@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI/RHI_Vertex.h"
 #include "../Resource/IResource.h"
 #include "../Math/BoundingBox.h"
+#include "../Rendering/Skeleton.h"
 //================================
 
 namespace spartan
@@ -34,6 +35,13 @@ namespace spartan
     class RHI_Buffer;
     class RHI_AccelerationStructure;
     class RHI_CommandList;
+    class MeshBvh;
+    struct MeshLodJob;
+    struct GeometryAllocation;
+    namespace math
+    {
+        class Ray;
+    }
 
     enum class MeshFlags : uint32_t
     {
@@ -44,6 +52,8 @@ namespace spartan
         PostProcessOptimize             = 1 << 4,
         PostProcessGenerateLods         = 1 << 5,
         PostProcessPreserveTerrainEdges = 1 << 6,
+        PostProcessQuantizeVertices     = 1 << 7, // snap to, and store on disk as, RHI_Vertex_PosTexNorTan_Quantized (the gpu always reads RHI_Vertex_PosTexNorTan_Gpu)
+        PostProcessBuildClusters        = 1 << 8, // split lod 0 of large sub-meshes into clusters that can be culled individually
     };
 
     enum class MeshLodDropoff
@@ -74,9 +84,30 @@ namespace spartan
     };
     static const uint32_t mesh_lod_count = 5;
 
+    // a group of up to 124 triangles whose indices are contiguous within lod 0
+    struct MeshCluster
+    {
+        uint32_t index_offset;   // relative to the index offset of the lod
+        uint32_t index_count;    // number of indices for this cluster
+        math::Vector3 center;    // bounding sphere
+        float radius;
+        math::Vector3 cone_apex; // normal cone, the cluster is back-facing when dot(normalize(cone_apex - eye), cone_axis) >= cone_cutoff
+        math::Vector3 cone_axis;
+        float cone_cutoff;
+    };
+
+    // a contiguous range of indices (relative to the lod) that is made of one or more visible clusters
+    struct MeshClusterRange
+    {
+        uint32_t index_offset;
+        uint32_t index_count;
+    };
+
     struct SubMesh
     {
-        std::vector<MeshLod> lods; // list of LOD levels for this sub-mesh
+        std::vector<MeshLod> lods;         // list of LOD levels for this sub-mesh
+        std::vector<MeshCluster> clusters; // clusters of lod 0, empty if the sub-mesh is too small to benefit from them
+        bool skinned = false;              // lod 0 has bone weights, it's the only lod
     };
 
     class Mesh : public IResource
@@ -88,21 +119,39 @@ namespace spartan
         // iresource
         void SaveToFile(const std::string& file_path) override;
         void LoadFromFile(const std::string& file_path) override;
+        uint64_t GetContentHash() override;
 
         // geometry
         void Clear();
         void GetGeometry(uint32_t sub_mesh_index, std::vector<uint32_t>* indices, std::vector<RHI_Vertex_PosTexNorTan>* vertices);
         uint32_t GetMemoryUsage() const;
+        bool CanUse16BitIndices() const;
         void AddLod(std::vector<RHI_Vertex_PosTexNorTan>& vertices, std::vector<uint32_t>& indices, const uint32_t sub_mesh_index);
-        void AddGeometry(std::vector<RHI_Vertex_PosTexNorTan>& vertices, std::vector<uint32_t>& indices, const bool generate_lods, uint32_t* sub_mesh_index = nullptr);
+        void AddGeometry(
+            std::vector<RHI_Vertex_PosTexNorTan>& vertices,
+            std::vector<uint32_t>& indices,
+            const bool generate_lods,
+            uint32_t* sub_mesh_index                     = nullptr,
+            const std::vector<BoneWeights>* bone_weights = nullptr // skinned geometry keeps its vertex order, so it's neither optimized nor simplified
+        );
+        void FlushLods(); // waits for lods that are generated in the background (by AddGeometry) and appends them
         std::vector<RHI_Vertex_PosTexNorTan>& GetVertices()   { return m_vertices; }
         std::vector<uint32_t>& GetIndices()                   { return m_indices; }
         const SubMesh& GetSubMesh(const uint32_t index) const { return m_sub_meshes[index]; }
+        uint32_t GetSubMeshCount() const                      { return static_cast<uint32_t>(m_sub_meshes.size()); }
 
         // lod dropoff
         MeshLodDropoff GetLodDropoff() const             { return m_lod_dropoff; }
         void SetLodDropoff(const MeshLodDropoff dropoff) { m_lod_dropoff = dropoff; }
 
+        // skinning
+        const Skeleton* GetSkeleton() const                    { return m_skeleton.IsEmpty() ? nullptr : &m_skeleton; }
+        void SetSkeleton(const Skeleton& skeleton)             { m_skeleton = skeleton; m_content_hash = 0; }
+        const std::vector<BoneWeights>& GetBoneWeights() const { return m_bone_weights; } // parallel to the vertices, covers lod 0 of skinned sub-meshes
+
+        // ray queries against lod 0, in object space, the bvh of a sub-mesh is built on first use and kept until Clear()
+        bool Raycast(const uint32_t sub_mesh_index, const math::Ray& ray, float& distance);
+
         // get counts
         uint32_t GetVertexCount() const;
         uint32_t GetIndexCount() const;
@@ -110,8 +159,10 @@ namespace spartan
         // gpu buffers
         void CreateGpuBuffers();
         void BuildAccelerationStructure(RHI_CommandList* cmd_list);
-        RHI_Buffer* GetIndexBuffer()  { return m_index_buffer.get();  }
-        RHI_Buffer* GetVertexBuffer() { return m_vertex_buffer.get(); }
+        RHI_Buffer* GetIndexBuffer() const;  // shared with other meshes, 16-bit when every lod has at most 65536 vertices
+        RHI_Buffer* GetVertexBuffer() const; // shared with other meshes
+        uint32_t GetIndexBufferOffset() const;  // where this mesh's indices start within the index buffer
+        uint32_t GetVertexBufferOffset() const; // where this mesh's vertices start within the vertex buffer
 
         // root entity
         Entity* GetRootEntity() { return m_root_entity; }
@@ -128,19 +179,39 @@ namespace spartan
         // acceleration structure
         RHI_AccelerationStructure* GetBlas() const { return m_blas.get(); }
 
+        // tests
+        static bool TestVertexQuantization();
+        static bool TestClusterCulling();
+
+        // benchmarks, loads a 2M triangle grid (plus its lods) from a version 1 file and a version 3 file
+        static void BenchmarkLoad(const uint32_t grid_points = 1001);
+
     private:
+        bool Deserialize(const uint8_t* data, uint64_t size, const std::string& file_path); // version 3, memory mapped
+        bool DeserializeLegacy(const std::string& file_path);                               // version 1 and 2
+
         // geometry
         std::vector<RHI_Vertex_PosTexNorTan> m_vertices; // all vertices of a model file
         std::vector<uint32_t> m_indices;                 // all indices of a model file
         std::vector<SubMesh> m_sub_meshes;               // tracks sub-meshes and lods within the above vectors
+        std::vector<BoneWeights> m_bone_weights;         // empty unless a sub-mesh is skinned
+        Skeleton m_skeleton;                             // shared by all skinned sub-meshes
 
-        // gpu buffers
-        std::unique_ptr<RHI_Buffer> m_vertex_buffer;
-        std::unique_ptr<RHI_Buffer> m_index_buffer;
+        // gpu buffers, sub-allocated from the geometry pool
+        GeometryAllocation* m_vertex_allocation = nullptr;
+        GeometryAllocation* m_index_allocation  = nullptr;
         std::unique_ptr<RHI_AccelerationStructure> m_blas;
 
+        // lods that are being generated on the thread pool, in submission order
+        std::vector<std::shared_ptr<MeshLodJob>> m_lod_jobs;
+
+        // ray query acceleration, one per sub-mesh
+        std::vector<std::unique_ptr<MeshBvh>> m_bvhs;
+        std::mutex m_mutex_bvh;
+
         // misc
         std::mutex m_mutex;
+        uint64_t m_content_hash      = 0; // cached, reset whenever the geometry changes
         Entity* m_root_entity        = nullptr;
         MeshType m_type              = MeshType::Max;
         MeshLodDropoff m_lod_dropoff = MeshLodDropoff::Linear;
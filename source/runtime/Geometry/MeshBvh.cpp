@@ -0,0 +1,525 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES =================
+#include "pch.h"
+#include "MeshBvh.h"
+#include "../Core/ThreadPool.h"
+//============================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace spartan::math;
+//============================
+
+namespace spartan
+{
+    namespace
+    {
+        const uint32_t bin_count     = 16;
+        const uint32_t max_leaf_size = 4;
+        const uint32_t max_depth     = 64;
+
+        struct TriangleBounds
+        {
+            Vector3 min;
+            Vector3 max;
+            Vector3 centroid;
+        };
+
+        struct Bin
+        {
+            Vector3 min    = Vector3::Infinity;
+            Vector3 max    = Vector3::InfinityNeg;
+            uint32_t count = 0;
+
+            void Grow(const Vector3& point_min, const Vector3& point_max)
+            {
+                min = Vector3::Min(min, point_min);
+                max = Vector3::Max(max, point_max);
+            }
+        };
+
+        Vector3 position(const RHI_Vertex_PosTexNorTan& vertex)
+        {
+            return Vector3(vertex.pos[0], vertex.pos[1], vertex.pos[2]);
+        }
+
+        float component(const Vector3& v, const int axis)
+        {
+            return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+        }
+
+        float half_area(const Vector3& min, const Vector3& max)
+        {
+            const Vector3 extent = max - min;
+            return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+        }
+
+        // slab test, returns the entry distance or infinity
+        float intersect_bounds(const float* min, const float* max, const Vector3& origin, const Vector3& direction_inverse, const float distance_max)
+        {
+            const float tx1 = (min[0] - origin.x) * direction_inverse.x, tx2 = (max[0] - origin.x) * direction_inverse.x;
+            const float ty1 = (min[1] - origin.y) * direction_inverse.y, ty2 = (max[1] - origin.y) * direction_inverse.y;
+            const float tz1 = (min[2] - origin.z) * direction_inverse.z, tz2 = (max[2] - origin.z) * direction_inverse.z;
+
+            const float t_enter = std::max({ std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f });
+            const float t_exit  = std::min({ std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2) });
+
+            return (t_enter <= t_exit && t_enter < distance_max) ? t_enter : numeric_limits<float>::infinity();
+        }
+
+        // closest hit over all triangles, the reference the bvh has to match
+        float intersect_brute_force(const Ray& ray, const RHI_Vertex_PosTexNorTan* vertices, const uint32_t* indices, const uint32_t index_count)
+        {
+            float distance_closest = numeric_limits<float>::infinity();
+            for (uint32_t i = 0; i < index_count; i += 3)
+            {
+                distance_closest = min(distance_closest, ray.HitDistance(position(vertices[indices[i + 0]]), position(vertices[indices[i + 1]]), position(vertices[indices[i + 2]])));
+            }
+
+            return distance_closest;
+        }
+
+        // a grid with random heights, facing up, spanning [-size/2, size/2] on x and z
+        void generate_bumpy_grid(const uint32_t points, const float size, mt19937& generator, vector<RHI_Vertex_PosTexNorTan>& vertices, vector<uint32_t>& indices)
+        {
+            uniform_real_distribution<float> height(-1.0f, 1.0f);
+            const float spacing = size / static_cast<float>(points - 1);
+            for (uint32_t z = 0; z < points; z++)
+            {
+                for (uint32_t x = 0; x < points; x++)
+                {
+                    vertices.emplace_back(Vector3(static_cast<float>(x) * spacing - size * 0.5f, height(generator), static_cast<float>(z) * spacing - size * 0.5f), Vector2::Zero, Vector3::Up, Vector3::Right);
+                }
+            }
+
+            for (uint32_t z = 0; z < points - 1; z++)
+            {
+                for (uint32_t x = 0; x < points - 1; x++)
+                {
+                    const uint32_t i = z * points + x;
+                    indices.insert(indices.end(), { i, i + points, i + 1, i + 1, i + points, i + points + 1 });
+                }
+            }
+        }
+
+        // rays from above aimed at the grid, plus axis aligned ones and ones that graze or miss it
+        Ray random_ray(mt19937& generator, const float size)
+        {
+            uniform_real_distribution<float> unit(-1.0f, 1.0f);
+            uniform_int_distribution<uint32_t> kind(0, 3);
+            const Vector3 origin = Vector3(unit(generator) * size * 0.6f, 2.0f + (unit(generator) + 1.0f) * size * 0.25f, unit(generator) * size * 0.6f);
+            switch (kind(generator))
+            {
+                case 0:  return Ray(origin, Vector3::Down);
+                case 1:  return Ray(origin, Vector3(unit(generator), -0.05f, unit(generator)));
+                case 2:  return Ray(Vector3(origin.x, unit(generator) * 1.5f, origin.z), Vector3(unit(generator), unit(generator) * 0.1f, unit(generator)));
+                default: return Ray(origin, Vector3(unit(generator) * 0.5f, -1.0f, unit(generator) * 0.5f));
+            }
+        }
+    }
+
+    void MeshBvh::Build(const RHI_Vertex_PosTexNorTan* vertices, const uint32_t* indices, const uint32_t index_count)
+    {
+        const uint32_t triangle_count = index_count / 3;
+        m_nodes.clear();
+        m_triangles.resize(triangle_count);
+        if (triangle_count == 0)
+            return;
+
+        // triangle bounds
+        vector<TriangleBounds> bounds(triangle_count);
+        auto compute_bounds = [&bounds, vertices, indices](uint32_t start, uint32_t end)
+        {
+            for (uint32_t i = start; i < end; i++)
+            {
+                const Vector3 p0 = position(vertices[indices[i * 3 + 0]]);
+                const Vector3 p1 = position(vertices[indices[i * 3 + 1]]);
+                const Vector3 p2 = position(vertices[indices[i * 3 + 2]]);
+
+                bounds[i].min      = Vector3::Min(Vector3::Min(p0, p1), p2);
+                bounds[i].max      = Vector3::Max(Vector3::Max(p0, p1), p2);
+                bounds[i].centroid = (bounds[i].min + bounds[i].max) * 0.5f;
+            }
+        };
+        ThreadPool::ParallelLoop(compute_bounds, triangle_count);
+
+        for (uint32_t i = 0; i < triangle_count; i++)
+        {
+            m_triangles[i] = i;
+        }
+
+        auto fit_node = [this, &bounds](Node& node)
+        {
+            Vector3 min = Vector3::Infinity;
+            Vector3 max = Vector3::InfinityNeg;
+            for (uint32_t i = node.first; i < node.first + node.count; i++)
+            {
+                min = Vector3::Min(min, bounds[m_triangles[i]].min);
+                max = Vector3::Max(max, bounds[m_triangles[i]].max);
+            }
+            node.min[0] = min.x; node.min[1] = min.y; node.min[2] = min.z;
+            node.max[0] = max.x; node.max[1] = max.y; node.max[2] = max.z;
+        };
+
+        m_nodes.reserve(triangle_count * 2 / max_leaf_size + 1);
+        Node& root = m_nodes.emplace_back();
+        root.first = 0;
+        root.count = triangle_count;
+        fit_node(root);
+
+        // subdivide depth first, children are always allocated in pairs
+        vector<pair<uint32_t, uint32_t>> stack; // node index, depth
+        stack.emplace_back(0, 0);
+        while (!stack.empty())
+        {
+            const auto [node_index, depth] = stack.back();
+            stack.pop_back();
+
+            const uint32_t first = m_nodes[node_index].first;
+            const uint32_t count = m_nodes[node_index].count;
+            if (count <= max_leaf_size || depth >= max_depth)
+                continue;
+
+            // bin the centroids along each axis and evaluate the split planes between the bins
+            Vector3 centroid_min = Vector3::Infinity;
+            Vector3 centroid_max = Vector3::InfinityNeg;
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                centroid_min = Vector3::Min(centroid_min, bounds[m_triangles[i]].centroid);
+                centroid_max = Vector3::Max(centroid_max, bounds[m_triangles[i]].centroid);
+            }
+
+            const Node& node    = m_nodes[node_index];
+            float best_cost     = static_cast<float>(count) * half_area(Vector3(node.min[0], node.min[1], node.min[2]), Vector3(node.max[0], node.max[1], node.max[2]));
+            int best_axis       = -1;
+            uint32_t best_split = 0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const float extent = component(centroid_max, axis) - component(centroid_min, axis);
+                if (extent <= 0.0f)
+                    continue;
+
+                const float scale = static_cast<float>(bin_count) / extent;
+                array<Bin, bin_count> bins;
+                for (uint32_t i = first; i < first + count; i++)
+                {
+                    const TriangleBounds& triangle = bounds[m_triangles[i]];
+                    const uint32_t bin_index       = min(bin_count - 1, static_cast<uint32_t>((component(triangle.centroid, axis) - component(centroid_min, axis)) * scale));
+                    bins[bin_index].Grow(triangle.min, triangle.max);
+                    bins[bin_index].count++;
+                }
+
+                // sweep from the right to get the cost of every right side, then from the left to evaluate
+                array<float, bin_count> area_right;
+                array<uint32_t, bin_count> count_right;
+                Bin accumulated;
+                for (uint32_t i = bin_count - 1; i > 0; i--)
+                {
+                    accumulated.Grow(bins[i].min, bins[i].max);
+                    accumulated.count += bins[i].count;
+                    area_right[i]      = accumulated.count ? half_area(accumulated.min, accumulated.max) : 0.0f;
+                    count_right[i]     = accumulated.count;
+                }
+
+                accumulated = Bin();
+                for (uint32_t split = 1; split < bin_count; split++)
+                {
+                    accumulated.Grow(bins[split - 1].min, bins[split - 1].max);
+                    accumulated.count += bins[split - 1].count;
+                    if (accumulated.count == 0 || count_right[split] == 0)
+                        continue;
+
+                    const float cost = static_cast<float>(accumulated.count) * half_area(accumulated.min, accumulated.max) + static_cast<float>(count_right[split]) * area_right[split];
+                    if (cost < best_cost)
+                    {
+                        best_cost  = cost;
+                        best_axis  = axis;
+                        best_split = split;
+                    }
+                }
+            }
+
+            // no split is cheaper than intersecting every triangle of the node
+            if (best_axis == -1)
+                continue;
+
+            // partition the triangles around the split plane
+            const float scale = static_cast<float>(bin_count) / (component(centroid_max, best_axis) - component(centroid_min, best_axis));
+            auto middle = partition(m_triangles.begin() + first, m_triangles.begin() + first + count, [&](uint32_t triangle)
+            {
+                return min(bin_count - 1, static_cast<uint32_t>((component(bounds[triangle].centroid, best_axis) - component(centroid_min, best_axis)) * scale)) < best_split;
+            });
+            const uint32_t count_left = static_cast<uint32_t>(middle - (m_triangles.begin() + first));
+            if (count_left == 0 || count_left == count)
+                continue;
+
+            const uint32_t left_index = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.emplace_back();
+            m_nodes.emplace_back();
+
+            Node& left  = m_nodes[left_index];
+            left.first  = first;
+            left.count  = count_left;
+            fit_node(left);
+
+            Node& right = m_nodes[left_index + 1];
+            right.first = first + count_left;
+            right.count = count - count_left;
+            fit_node(right);
+
+            m_nodes[node_index].first = left_index;
+            m_nodes[node_index].count = 0;
+
+            stack.emplace_back(left_index, depth + 1);
+            stack.emplace_back(left_index + 1, depth + 1);
+        }
+
+        m_nodes.shrink_to_fit();
+    }
+
+    bool MeshBvh::Intersect(const Ray& ray, const RHI_Vertex_PosTexNorTan* vertices, const uint32_t* indices, float& distance, uint32_t* triangle_index) const
+    {
+        if (m_nodes.empty())
+            return false;
+
+        const Vector3& origin           = ray.GetStart();
+        const Vector3& direction        = ray.GetDirection();
+        const Vector3 direction_inverse = Vector3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+        float distance_closest = numeric_limits<float>::infinity();
+        uint32_t hit_triangle  = numeric_limits<uint32_t>::max();
+
+        if (intersect_bounds(m_nodes[0].min, m_nodes[0].max, origin, direction_inverse, distance_closest) == numeric_limits<float>::infinity())
+            return false;
+
+        // front to back traversal, the nearer child is visited first so that the far one can often be skipped
+        uint32_t stack[max_depth * 2];
+        uint32_t stack_size = 0;
+        stack[stack_size++] = 0;
+        while (stack_size > 0)
+        {
+            const Node& node = m_nodes[stack[--stack_size]];
+
+            if (node.count > 0)
+            {
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    const uint32_t triangle = m_triangles[i];
+                    const float hit         = ray.HitDistance(
+                        position(vertices[indices[triangle * 3 + 0]]),
+                        position(vertices[indices[triangle * 3 + 1]]),
+                        position(vertices[indices[triangle * 3 + 2]])
+                    );
+
+                    if (hit < distance_closest)
+                    {
+                        distance_closest = hit;
+                        hit_triangle     = triangle;
+                    }
+                }
+
+                continue;
+            }
+
+            const Node& left     = m_nodes[node.first];
+            const Node& right    = m_nodes[node.first + 1];
+            const float t_left   = intersect_bounds(left.min, left.max, origin, direction_inverse, distance_closest);
+            const float t_right  = intersect_bounds(right.min, right.max, origin, direction_inverse, distance_closest);
+            const bool left_near = t_left <= t_right;
+            const float t_near   = left_near ? t_left : t_right;
+            const float t_far    = left_near ? t_right : t_left;
+
+            if (t_far != numeric_limits<float>::infinity())
+            {
+                stack[stack_size++] = left_near ? node.first + 1 : node.first;
+            }
+
+            if (t_near != numeric_limits<float>::infinity())
+            {
+                stack[stack_size++] = left_near ? node.first : node.first + 1;
+            }
+        }
+
+        if (hit_triangle == numeric_limits<uint32_t>::max())
+            return false;
+
+        distance = distance_closest;
+        if (triangle_index)
+        {
+            *triangle_index = hit_triangle;
+        }
+
+        return true;
+    }
+
+    bool MeshBvh::Test()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Mesh bvh %s failed", name);
+                passed = false;
+            }
+        };
+
+        mt19937 generator(0); // fixed seed, so runs are comparable
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        vector<uint32_t> indices;
+        generate_bumpy_grid(65, 64.0f, generator, vertices, indices);
+
+        // a soup of random triangles on top, overlapping each other and the grid
+        uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        for (uint32_t i = 0; i < 2000; i++)
+        {
+            const Vector3 center = Vector3(unit(generator) * 32.0f, unit(generator) * 4.0f, unit(generator) * 32.0f);
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                indices.emplace_back(static_cast<uint32_t>(vertices.size()));
+                vertices.emplace_back(center + Vector3(unit(generator), unit(generator), unit(generator)) * 2.0f, Vector2::Zero, Vector3::Up, Vector3::Right);
+            }
+        }
+        const uint32_t index_count = static_cast<uint32_t>(indices.size());
+
+        MeshBvh bvh;
+        bvh.Build(vertices.data(), indices.data(), index_count);
+        expect("build", bvh.IsBuilt() && bvh.GetNodeCount() > 1);
+
+        // same hits and distances as brute force, and the reported triangle is at that distance
+        uint32_t hit_count      = 0;
+        uint32_t mismatch_count = 0;
+        uint32_t wrong_triangle = 0;
+        for (uint32_t i = 0; i < 20000; i++)
+        {
+            const Ray ray           = random_ray(generator, 64.0f);
+            const float expected    = intersect_brute_force(ray, vertices.data(), indices.data(), index_count);
+            float distance          = numeric_limits<float>::infinity();
+            uint32_t triangle_index = 0;
+            const bool hit          = bvh.Intersect(ray, vertices.data(), indices.data(), distance, &triangle_index);
+
+            hit_count += hit ? 1 : 0;
+            if (hit != (expected != numeric_limits<float>::infinity()) || (hit && distance != expected))
+            {
+                mismatch_count++;
+                continue;
+            }
+
+            if (hit)
+            {
+                const float triangle_distance = ray.HitDistance(
+                    position(vertices[indices[triangle_index * 3 + 0]]),
+                    position(vertices[indices[triangle_index * 3 + 1]]),
+                    position(vertices[indices[triangle_index * 3 + 2]])
+                );
+                wrong_triangle += triangle_distance != distance ? 1 : 0;
+            }
+        }
+        expect("hits", hit_count > 10000);
+        expect("matches brute force", mismatch_count == 0);
+        expect("triangle index", wrong_triangle == 0);
+        if (mismatch_count != 0)
+        {
+            SP_LOG_ERROR("Mesh bvh disagreed with brute force on %u rays", mismatch_count);
+        }
+
+        // an empty bvh never hits
+        MeshBvh empty;
+        empty.Build(vertices.data(), indices.data(), 0);
+        float distance = 0.0f;
+        expect("empty", !empty.IsBuilt() && !empty.Intersect(Ray(Vector3::Up, Vector3::Down), vertices.data(), indices.data(), distance));
+
+        return passed;
+    }
+
+    void MeshBvh::Benchmark(const uint32_t ray_count)
+    {
+        mt19937 generator(0); // fixed seed, so runs are comparable
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        vector<uint32_t> indices;
+        generate_bumpy_grid(257, 256.0f, generator, vertices, indices);
+        const uint32_t index_count = static_cast<uint32_t>(indices.size());
+
+        vector<Ray> rays(ray_count);
+        for (Ray& ray : rays)
+        {
+            ray = random_ray(generator, 256.0f);
+        }
+
+        MeshBvh bvh;
+        double build_ms = 0.0;
+        {
+            const Stopwatch timer;
+            bvh.Build(vertices.data(), indices.data(), index_count);
+            build_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+        }
+
+        uint32_t bvh_hits = 0;
+        double bvh_ms     = 0.0;
+        {
+            const Stopwatch timer;
+            for (const Ray& ray : rays)
+            {
+                float distance = 0.0f;
+                bvh_hits += bvh.Intersect(ray, vertices.data(), indices.data(), distance) ? 1 : 0;
+            }
+            bvh_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+        }
+
+        // brute force is too slow for every ray, a subset is timed and the hits are compared on it
+        const uint32_t brute_force_count = min(ray_count, 1000u);
+        uint32_t brute_force_hits        = 0;
+        uint32_t bvh_subset_hits         = 0;
+        double brute_force_ms            = 0.0;
+        {
+            const Stopwatch timer;
+            for (uint32_t i = 0; i < brute_force_count; i++)
+            {
+                brute_force_hits += intersect_brute_force(rays[i], vertices.data(), indices.data(), index_count) != numeric_limits<float>::infinity() ? 1 : 0;
+            }
+            brute_force_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+        }
+        for (uint32_t i = 0; i < brute_force_count; i++)
+        {
+            float distance = 0.0f;
+            bvh_subset_hits += bvh.Intersect(rays[i], vertices.data(), indices.data(), distance) ? 1 : 0;
+        }
+
+        const double bvh_us         = bvh_ms * 1000.0 / static_cast<double>(ray_count);
+        const double brute_force_us = brute_force_ms * 1000.0 / static_cast<double>(brute_force_count);
+        SP_LOG_INFO("Mesh bvh, %u triangles, %u nodes (%.1f KB) built in %.1f ms: bvh %.2f us/ray (%u rays, %u hits), brute force %.1f us/ray (%u rays, %u hits%s), %.0fx",
+            index_count / 3,
+            bvh.GetNodeCount(),
+            static_cast<double>(bvh.GetMemoryUsage()) / 1024.0,
+            build_ms,
+            bvh_us,
+            ray_count,
+            bvh_hits,
+            brute_force_us,
+            brute_force_count,
+            brute_force_hits,
+            brute_force_hits == bvh_subset_hits ? "" : ", mismatch",
+            brute_force_us / bvh_us);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ==================
+#include <vector>
+#include "../RHI/RHI_Vertex.h"
+#include "../Math/Ray.h"
+//=============================
+
+namespace spartan
+{
+    // bounding volume hierarchy over the triangles of a single lod, built with a binned surface area heuristic
+    // it only stores a permutation of the triangles, queries read the vertices and indices of the mesh in place
+    class MeshBvh
+    {
+    public:
+        // indices are relative to vertices, positions are in object space
+        void Build(const RHI_Vertex_PosTexNorTan* vertices, const uint32_t* indices, const uint32_t index_count);
+
+        // returns true on a hit, distance is in units of the ray's direction (which doesn't have to be normalized)
+        bool Intersect(
+            const math::Ray& ray,
+            const RHI_Vertex_PosTexNorTan* vertices,
+            const uint32_t* indices,
+            float& distance,
+            uint32_t* triangle_index = nullptr
+        ) const;
+
+        bool IsBuilt() const            { return !m_nodes.empty(); }
+        uint32_t GetNodeCount() const   { return static_cast<uint32_t>(m_nodes.size()); }
+        uint64_t GetMemoryUsage() const { return m_nodes.size() * sizeof(Node) + m_triangles.size() * sizeof(uint32_t); }
+
+        // tests, compares every hit against a brute force walk over all triangles
+        static bool Test();
+
+        // benchmarks, rays against a bumpy 130k triangle grid, bvh versus brute force
+        static void Benchmark(const uint32_t ray_count = 100000);
+
+    private:
+        struct Node
+        {
+            float min[3];
+            uint32_t first; // first triangle when this is a leaf, left child otherwise (the right child follows it)
+            float max[3];
+            uint32_t count; // triangle count, zero for interior nodes
+        };
+        static_assert(sizeof(Node) == 32);
+
+        std::vector<Node> m_nodes;
+        std::vector<uint32_t> m_triangles;
+    };
+}
@@ -82,6 +82,11 @@ namespace spartan::math
         return CheckCube(center, extent, ignore_depth) != Intersection::Outside;
     }
 
+    bool Frustum::IsVisible(const Vector3& center, const float radius, bool ignore_depth /*= false*/) const
+    {
+        return CheckSphere(center, radius, ignore_depth) != Intersection::Outside;
+    }
+
     Intersection Frustum::CheckCube(const Vector3& center, const Vector3& extent, float ignore_depth) const
     {
         SP_ASSERT(!center.IsNaN() && !extent.IsNaN());
@@ -116,8 +121,10 @@ namespace spartan::math
        
     Intersection Frustum::CheckSphere(const Vector3& center, float radius, float ignore_depth) const
     {
-        SP_ASSERT(!center.IsNaN() && radius > 0.0f);
+        SP_ASSERT(!center.IsNaN() && radius >= 0.0f);
     
+        bool intersects = false;
+
         // skip near and far plane checks if depth is to be ignored
         const int start = ignore_depth ? 2 : 0;
     
@@ -133,12 +140,11 @@ namespace spartan::math
             if (distance < -radius)
                 return Intersection::Outside;
     
-            // else if the distance is between +- radius, then we intersect
+            // else if the distance is between +- radius, then we intersect (but the remaining planes can still reject it)
             if (distance < radius)
-                return Intersection::Intersects;
+                intersects = true;
         }
     
-        // otherwise we are fully in view
-        return Intersection::Inside;
+        return intersects ? Intersection::Intersects : Intersection::Inside;
     }
 }
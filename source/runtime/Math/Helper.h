@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ====
 #include <random>
 #include <algorithm> 
+#include <cstring>
 //===============
 
 namespace spartan::math
@@ -67,6 +68,47 @@ namespace spartan::math
         return distr(eng);
     }
 
+    // fast, non-cryptographic 64-bit hash of a byte range (used for content hashing, not security)
+    inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0x9E3779B97F4A7C15ull)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash        = seed ^ (size * 0xC6A4A7935BD1E995ull);
+
+        auto mix = [](uint64_t value)
+        {
+            value ^= value >> 33;
+            value *= 0xFF51AFD7ED558CCDull;
+            value ^= value >> 33;
+            value *= 0xC4CEB9FE1A85EC53ull;
+            value ^= value >> 33;
+            return value;
+        };
+
+        // 8 bytes at a time
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ mix(word)) * 0x9E3779B97F4A7C15ull;
+        }
+
+        // tail
+        uint64_t tail = 0;
+        for (size_t j = 0; i + j < size; j++)
+        {
+            tail |= static_cast<uint64_t>(bytes[i + j]) << (j * 8);
+        }
+        hash = (hash ^ mix(tail)) * 0x9E3779B97F4A7C15ull;
+
+        return mix(hash);
+    }
+
+    constexpr uint64_t hash_combine(uint64_t a, uint64_t b)
+    {
+        return a ^ (b + 0x9E3779B97F4A7C15ull + (a << 6) + (a >> 2));
+    }
+
     constexpr uint32_t power_of_two_previous(uint32_t x)
     {
         x = x | (x >> 1);
@@ -0,0 +1,474 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ==============
+#include "pch.h"
+#include "Noise.h"
+#include "../Core/ThreadPool.h"
+#include <immintrin.h>
+//=========================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace spartan::math
+{
+    namespace
+    {
+        // simplex skew factors, (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6
+        const float simplex_f2    = 0.36602540378f;
+        const float simplex_g2    = 0.21132486540f;
+        const float simplex_scale = 99.0f; // brings unit gradients to [-1, 1]
+
+        // the scalar and the vectorized paths below perform the same operations in the same order, so they agree to the last few bits
+
+        float fade(const float t)
+        {
+            return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); // 6t^5 - 15t^4 + 10t^3
+        }
+
+        float lerp(const float a, const float b, const float t)
+        {
+            return a + t * (b - a);
+        }
+
+    #if defined(__AVX2__)
+        __m256 fade(const __m256 t)
+        {
+            const __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+            return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+        }
+
+        __m256 lerp(const __m256 a, const __m256 b, const __m256 t)
+        {
+            return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+        }
+
+        __m256 dot(const float* gradient_x, const float* gradient_z, const __m256i index, const __m256 x, const __m256 z)
+        {
+            const __m256 gx = _mm256_i32gather_ps(gradient_x, index, 4);
+            const __m256 gz = _mm256_i32gather_ps(gradient_z, index, 4);
+            return _mm256_add_ps(_mm256_mul_ps(gx, x), _mm256_mul_ps(gz, z));
+        }
+
+        __m256i lookup(const int32_t* permutation, const __m256i index)
+        {
+            return _mm256_i32gather_epi32(permutation, index, 4);
+        }
+    #endif
+    }
+
+    Noise::Noise(const NoiseParameters& parameters) : m_parameters(parameters)
+    {
+        mt19937 gen(parameters.seed);
+        uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+        // identity permutation and normalized gradients
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            m_permutation[i] = static_cast<int32_t>(i);
+
+            Vector2 gradient = Vector2(dist(gen), dist(gen)).Normalized();
+            m_gradient_x[i]  = gradient.x;
+            m_gradient_z[i]  = gradient.y;
+        }
+
+        // shuffle
+        for (uint32_t i = 255; i > 0; i--)
+        {
+            uniform_int_distribution<uint32_t> dist_index(0, i);
+            swap(m_permutation[i], m_permutation[dist_index(gen)]);
+        }
+
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            m_permutation[256 + i] = m_permutation[i];
+            m_values[i]            = dist(gen);
+        }
+    }
+
+    float Noise::SampleOctave(float x, float z) const
+    {
+        if (m_parameters.type == NoiseType::Simplex)
+        {
+            // skew to find the simplex cell, then unskew back to get the distances to its corners
+            const float s   = (x + z) * simplex_f2;
+            const float xf  = floor(x + s);
+            const float zf  = floor(z + s);
+            const float t   = (xf + zf) * simplex_g2;
+            const float x0  = x - (xf - t);
+            const float z0  = z - (zf - t);
+            const float i1  = x0 > z0 ? 1.0f : 0.0f;
+            const float j1  = 1.0f - i1;
+            const float x1  = x0 - i1 + simplex_g2;
+            const float z1  = z0 - j1 + simplex_g2;
+            const float x2  = x0 - 1.0f + 2.0f * simplex_g2;
+            const float z2  = z0 - 1.0f + 2.0f * simplex_g2;
+            const int32_t i = static_cast<int32_t>(xf) & 255;
+            const int32_t j = static_cast<int32_t>(zf) & 255;
+
+            auto corner = [this](const int32_t index, const float x, const float z)
+            {
+                float t = max(0.5f - x * x - z * z, 0.0f);
+                t      *= t;
+                return t * t * (m_gradient_x[index] * x + m_gradient_z[index] * z);
+            };
+
+            const float n0 = corner(m_permutation[i + m_permutation[j]], x0, z0);
+            const float n1 = corner(m_permutation[i + static_cast<int32_t>(i1) + m_permutation[j + static_cast<int32_t>(j1)]], x1, z1);
+            const float n2 = corner(m_permutation[i + 1 + m_permutation[j + 1]], x2, z2);
+
+            return simplex_scale * (n0 + n1 + n2);
+        }
+
+        // gradient and value noise share the lattice
+        const float xf  = floor(x);
+        const float zf  = floor(z);
+        const int32_t i = static_cast<int32_t>(xf) & 255;
+        const int32_t j = static_cast<int32_t>(zf) & 255;
+        x              -= xf;
+        z              -= zf;
+
+        const float u = fade(x);
+        const float v = fade(z);
+
+        const int32_t aa = m_permutation[m_permutation[i] + j];
+        const int32_t ab = m_permutation[m_permutation[i] + j + 1];
+        const int32_t ba = m_permutation[m_permutation[i + 1] + j];
+        const int32_t bb = m_permutation[m_permutation[i + 1] + j + 1];
+
+        if (m_parameters.type == NoiseType::Value)
+            return lerp(lerp(m_values[aa], m_values[ba], u), lerp(m_values[ab], m_values[bb], u), v);
+
+        const float g00 = m_gradient_x[aa] * x + m_gradient_z[aa] * z;
+        const float g10 = m_gradient_x[ba] * (x - 1.0f) + m_gradient_z[ba] * z;
+        const float g01 = m_gradient_x[ab] * x + m_gradient_z[ab] * (z - 1.0f);
+        const float g11 = m_gradient_x[bb] * (x - 1.0f) + m_gradient_z[bb] * (z - 1.0f);
+
+        return lerp(lerp(g00, g10, u), lerp(g01, g11, u), v);
+    }
+
+    float Noise::Sample(float x, float z) const
+    {
+        x *= m_parameters.frequency;
+        z *= m_parameters.frequency;
+
+        const bool ridged     = m_parameters.fractal == NoiseFractal::Ridged;
+        float sum             = 0.0f;
+        float amplitude       = 1.0f;
+        float amplitude_total = 0.0f;
+        float frequency       = 1.0f;
+        for (uint32_t octave = 0; octave < m_parameters.octaves; octave++)
+        {
+            float n = SampleOctave(x * frequency, z * frequency);
+            if (ridged)
+            {
+                n  = 1.0f - abs(n);
+                n *= n;
+            }
+
+            sum             += n * amplitude;
+            amplitude_total += amplitude;
+            amplitude       *= m_parameters.persistence;
+            frequency       *= m_parameters.lacunarity;
+        }
+
+        sum /= amplitude_total;
+        return ridged ? sum * 2.0f - 1.0f : sum;
+    }
+
+    void Noise::SampleRow(float* output, const uint32_t count, const float origin_x, const float z, const float step) const
+    {
+        uint32_t i = 0;
+
+    #if defined(__AVX2__)
+        const bool ridged        = m_parameters.fractal == NoiseFractal::Ridged;
+        const int32_t* perm      = m_permutation.data();
+        const float* gradient_x  = m_gradient_x.data();
+        const float* gradient_z  = m_gradient_z.data();
+        const __m256 lane        = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        const __m256 one         = _mm256_set1_ps(1.0f);
+        const __m256i one_i      = _mm256_set1_epi32(1);
+        const __m256i mask_255   = _mm256_set1_epi32(255);
+        const __m256 sign_mask   = _mm256_set1_ps(-0.0f);
+        const __m256 z_scaled    = _mm256_set1_ps(z * m_parameters.frequency);
+
+        auto octave_gradient = [&](__m256 x, __m256 z) -> __m256
+        {
+            const __m256 xf  = _mm256_floor_ps(x);
+            const __m256 zf  = _mm256_floor_ps(z);
+            const __m256i xi = _mm256_and_si256(_mm256_cvttps_epi32(xf), mask_255);
+            const __m256i zi = _mm256_and_si256(_mm256_cvttps_epi32(zf), mask_255);
+            x                = _mm256_sub_ps(x, xf);
+            z                = _mm256_sub_ps(z, zf);
+
+            const __m256 u = fade(x);
+            const __m256 v = fade(z);
+
+            const __m256i a  = _mm256_add_epi32(lookup(perm, xi), zi);
+            const __m256i b  = _mm256_add_epi32(lookup(perm, _mm256_add_epi32(xi, one_i)), zi);
+            const __m256i aa = lookup(perm, a);
+            const __m256i ab = lookup(perm, _mm256_add_epi32(a, one_i));
+            const __m256i ba = lookup(perm, b);
+            const __m256i bb = lookup(perm, _mm256_add_epi32(b, one_i));
+
+            if (m_parameters.type == NoiseType::Value)
+            {
+                const float* values = m_values.data();
+                const __m256 x0     = lerp(_mm256_i32gather_ps(values, aa, 4), _mm256_i32gather_ps(values, ba, 4), u);
+                const __m256 x1     = lerp(_mm256_i32gather_ps(values, ab, 4), _mm256_i32gather_ps(values, bb, 4), u);
+                return lerp(x0, x1, v);
+            }
+
+            const __m256 x_minus = _mm256_sub_ps(x, one);
+            const __m256 z_minus = _mm256_sub_ps(z, one);
+            const __m256 g00     = dot(gradient_x, gradient_z, aa, x, z);
+            const __m256 g10     = dot(gradient_x, gradient_z, ba, x_minus, z);
+            const __m256 g01     = dot(gradient_x, gradient_z, ab, x, z_minus);
+            const __m256 g11     = dot(gradient_x, gradient_z, bb, x_minus, z_minus);
+
+            return lerp(lerp(g00, g10, u), lerp(g01, g11, u), v);
+        };
+
+        auto octave_simplex = [&](const __m256 x, const __m256 z) -> __m256
+        {
+            const __m256 g2   = _mm256_set1_ps(simplex_g2);
+            const __m256 s    = _mm256_mul_ps(_mm256_add_ps(x, z), _mm256_set1_ps(simplex_f2));
+            const __m256 xf   = _mm256_floor_ps(_mm256_add_ps(x, s));
+            const __m256 zf   = _mm256_floor_ps(_mm256_add_ps(z, s));
+            const __m256 t    = _mm256_mul_ps(_mm256_add_ps(xf, zf), g2);
+            const __m256 x0   = _mm256_sub_ps(x, _mm256_sub_ps(xf, t));
+            const __m256 z0   = _mm256_sub_ps(z, _mm256_sub_ps(zf, t));
+            const __m256 i1   = _mm256_and_ps(_mm256_cmp_ps(x0, z0, _CMP_GT_OQ), one);
+            const __m256 j1   = _mm256_sub_ps(one, i1);
+            const __m256 x1   = _mm256_add_ps(_mm256_sub_ps(x0, i1), g2);
+            const __m256 z1   = _mm256_add_ps(_mm256_sub_ps(z0, j1), g2);
+            const __m256 g2x2 = _mm256_set1_ps(2.0f * simplex_g2);
+            const __m256 x2   = _mm256_add_ps(_mm256_sub_ps(x0, one), g2x2);
+            const __m256 z2   = _mm256_add_ps(_mm256_sub_ps(z0, one), g2x2);
+            const __m256i i   = _mm256_and_si256(_mm256_cvttps_epi32(xf), mask_255);
+            const __m256i j   = _mm256_and_si256(_mm256_cvttps_epi32(zf), mask_255);
+
+            auto corner = [&](const __m256i index, const __m256 x, const __m256 z)
+            {
+                __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)), _mm256_mul_ps(z, z));
+                t        = _mm256_max_ps(t, _mm256_setzero_ps());
+                t        = _mm256_mul_ps(t, t);
+                return _mm256_mul_ps(_mm256_mul_ps(t, t), dot(gradient_x, gradient_z, index, x, z));
+            };
+
+            const __m256i i1_i  = _mm256_cvttps_epi32(i1);
+            const __m256i j1_i  = _mm256_cvttps_epi32(j1);
+            const __m256i gi0   = lookup(perm, _mm256_add_epi32(i, lookup(perm, j)));
+            const __m256i gi1   = lookup(perm, _mm256_add_epi32(_mm256_add_epi32(i, i1_i), lookup(perm, _mm256_add_epi32(j, j1_i))));
+            const __m256i gi2   = lookup(perm, _mm256_add_epi32(_mm256_add_epi32(i, one_i), lookup(perm, _mm256_add_epi32(j, one_i))));
+            const __m256 n      = _mm256_add_ps(_mm256_add_ps(corner(gi0, x0, z0), corner(gi1, x1, z1)), corner(gi2, x2, z2));
+
+            return _mm256_mul_ps(_mm256_set1_ps(simplex_scale), n);
+        };
+
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 index = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lane);
+            const __m256 x     = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(origin_x), _mm256_mul_ps(index, _mm256_set1_ps(step))), _mm256_set1_ps(m_parameters.frequency));
+
+            __m256 sum             = _mm256_setzero_ps();
+            float amplitude        = 1.0f;
+            float amplitude_total  = 0.0f;
+            float frequency        = 1.0f;
+            for (uint32_t octave = 0; octave < m_parameters.octaves; octave++)
+            {
+                const __m256 f  = _mm256_set1_ps(frequency);
+                const __m256 xo = _mm256_mul_ps(x, f);
+                const __m256 zo = _mm256_mul_ps(z_scaled, f);
+                __m256 n        = m_parameters.type == NoiseType::Simplex ? octave_simplex(xo, zo) : octave_gradient(xo, zo);
+                if (ridged)
+                {
+                    n = _mm256_sub_ps(one, _mm256_andnot_ps(sign_mask, n));
+                    n = _mm256_mul_ps(n, n);
+                }
+
+                sum              = _mm256_add_ps(sum, _mm256_mul_ps(n, _mm256_set1_ps(amplitude)));
+                amplitude_total += amplitude;
+                amplitude       *= m_parameters.persistence;
+                frequency       *= m_parameters.lacunarity;
+            }
+
+            sum = _mm256_div_ps(sum, _mm256_set1_ps(amplitude_total));
+            if (ridged)
+            {
+                sum = _mm256_sub_ps(_mm256_mul_ps(sum, _mm256_set1_ps(2.0f)), one);
+            }
+
+            _mm256_storeu_ps(output + i, sum);
+        }
+    #endif
+
+        for (; i < count; i++)
+        {
+            output[i] = Sample(origin_x + static_cast<float>(i) * step, z);
+        }
+    }
+
+    void Noise::SampleGrid(float* output, const uint32_t width, const uint32_t height, const float origin_x, const float origin_z, const float step) const
+    {
+        SP_ASSERT(output);
+
+        auto sample_rows = [&](uint32_t row_start, uint32_t row_end)
+        {
+            for (uint32_t row = row_start; row < row_end; row++)
+            {
+                SampleRow(output + static_cast<size_t>(row) * width, width, origin_x, origin_z + static_cast<float>(row) * step, step);
+            }
+        };
+        ThreadPool::ParallelLoop(sample_rows, height);
+    }
+
+    void Noise::Benchmark(const uint32_t size)
+    {
+        const char* type_names[]    = { "gradient", "value", "simplex" };
+        const char* fractal_names[] = { "fbm", "ridged" };
+        const double sample_count   = static_cast<double>(size) * size;
+
+        vector<float> reference(size * size);
+        vector<float> grid(size * size);
+        for (uint32_t type = 0; type < 3; type++)
+        {
+            for (uint32_t fractal = 0; fractal < 2; fractal++)
+            {
+                NoiseParameters parameters;
+                parameters.type    = static_cast<NoiseType>(type);
+                parameters.fractal = static_cast<NoiseFractal>(fractal);
+                parameters.seed    = 1;
+                Noise noise(parameters);
+
+                // scalar, one thread
+                Stopwatch timer;
+                for (uint32_t z = 0; z < size; z++)
+                {
+                    for (uint32_t x = 0; x < size; x++)
+                    {
+                        reference[z * size + x] = noise.Sample(static_cast<float>(x), static_cast<float>(z));
+                    }
+                }
+                const double scalar_sec = max(static_cast<double>(timer.GetElapsedTimeSec()), 1e-9);
+
+                // vectorized and parallel
+                timer.Start();
+                noise.SampleGrid(grid.data(), size, size);
+                const double grid_sec = max(static_cast<double>(timer.GetElapsedTimeSec()), 1e-9);
+
+                float difference_max = 0.0f;
+                for (size_t i = 0; i < grid.size(); i++)
+                {
+                    difference_max = max(difference_max, abs(grid[i] - reference[i]));
+                }
+
+                SP_LOG_INFO("Noise %s %s: scalar %.1f M samples/sec, grid %.1f M samples/sec (%.1fx), max difference %g",
+                    type_names[type],
+                    fractal_names[fractal],
+                    sample_count / scalar_sec / 1e6,
+                    sample_count / grid_sec / 1e6,
+                    scalar_sec / grid_sec,
+                    difference_max
+                );
+            }
+        }
+    }
+
+    bool Noise::Test()
+    {
+        // a width which isn't a multiple of 8 so the tail of each row is covered, with an offset origin and a fractional step
+        const uint32_t width  = 203;
+        const uint32_t height = 67;
+        const float origin_x  = -37.25f;
+        const float origin_z  = 113.5f;
+        const float step      = 0.75f;
+        const float tolerance = 1e-4f;
+
+        const char* type_names[]    = { "gradient", "value", "simplex" };
+        const char* fractal_names[] = { "fbm", "ridged" };
+
+        bool passed = true;
+        vector<float> grid(width * height);
+        vector<float> grid_again(width * height);
+        vector<float> grid_other_seed(width * height);
+        for (uint32_t type = 0; type < 3; type++)
+        {
+            for (uint32_t fractal = 0; fractal < 2; fractal++)
+            {
+                NoiseParameters parameters;
+                parameters.type      = static_cast<NoiseType>(type);
+                parameters.fractal   = static_cast<NoiseFractal>(fractal);
+                parameters.seed      = 3;
+                parameters.frequency = 0.05f;
+                Noise(parameters).SampleGrid(grid.data(), width, height, origin_x, origin_z, step);
+                Noise(parameters).SampleGrid(grid_again.data(), width, height, origin_x, origin_z, step);
+                parameters.seed = 4;
+                Noise(parameters).SampleGrid(grid_other_seed.data(), width, height, origin_x, origin_z, step);
+                parameters.seed = 3;
+
+                // the grid matches the scalar reference and stays in range
+                const Noise noise(parameters);
+                float difference_max = 0.0f;
+                bool in_range        = true;
+                for (uint32_t z = 0; z < height; z++)
+                {
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        const float value     = grid[z * width + x];
+                        const float reference = noise.Sample(origin_x + static_cast<float>(x) * step, origin_z + static_cast<float>(z) * step);
+                        difference_max        = max(difference_max, abs(value - reference));
+                        in_range              = in_range && value >= -1.0f - tolerance && value <= 1.0f + tolerance;
+                    }
+                }
+
+                const char* failure = nullptr;
+                if (difference_max > tolerance)
+                {
+                    failure = "the grid differs from the scalar reference";
+                }
+                else if (!in_range)
+                {
+                    failure = "samples are outside of [-1, 1]";
+                }
+                else if (grid != grid_again)
+                {
+                    failure = "the same seed produces different noise";
+                }
+                else if (grid == grid_other_seed)
+                {
+                    failure = "a different seed produces the same noise";
+                }
+
+                if (failure)
+                {
+                    SP_LOG_ERROR("Noise %s %s: %s (max difference %g)", type_names[type], fractal_names[fractal], failure, difference_max);
+                    passed = false;
+                }
+            }
+        }
+
+        return passed;
+    }
+}
@@ -0,0 +1,86 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =====
+#include <array>
+#include <cstdint>
+//================
+
+namespace spartan::math
+{
+    enum class NoiseType : uint8_t
+    {
+        Gradient, // perlin
+        Value,
+        Simplex
+    };
+
+    enum class NoiseFractal : uint8_t
+    {
+        Fbm,   // sum of octaves
+        Ridged // sharp crests, for mountain ranges and erosion channels
+    };
+
+    struct NoiseParameters
+    {
+        NoiseType type       = NoiseType::Gradient;
+        NoiseFractal fractal = NoiseFractal::Fbm;
+        uint32_t seed        = 0;
+        float frequency      = 0.01f;
+        uint32_t octaves     = 4;
+        float lacunarity     = 2.0f; // frequency multiplier per octave
+        float persistence    = 0.5f; // amplitude multiplier per octave
+    };
+
+    // seeded 2d fractal noise in the [-1, 1] range, the same seed always produces the same noise
+    class Noise
+    {
+    public:
+        Noise(const NoiseParameters& parameters = NoiseParameters());
+
+        // a single sample, this is also the reference the vectorized paths are checked against
+        float Sample(float x, float z) const;
+
+        // samples a width x height grid which starts at the origin, x varies fastest, rows are evaluated in parallel, 8 samples at a time
+        void SampleGrid(float* output, uint32_t width, uint32_t height, float origin_x = 0.0f, float origin_z = 0.0f, float step = 1.0f) const;
+
+        // logs samples per second of every noise type, scalar and grid, along with the largest difference between the two
+        static void Benchmark(uint32_t size = 1024);
+
+        // checks the grid against the scalar reference for every noise type, along with the range and determinism under a seed
+        static bool Test();
+
+        const NoiseParameters& GetParameters() const { return m_parameters; }
+
+    private:
+        float SampleOctave(float x, float z) const;
+        void SampleRow(float* output, uint32_t count, float origin_x, float z, float step) const;
+
+        NoiseParameters m_parameters;
+        std::array<int32_t, 512> m_permutation = {}; // doubled so that lookups never wrap
+        std::array<float, 256> m_gradient_x    = {};
+        std::array<float, 256> m_gradient_z    = {};
+        std::array<float, 256> m_values        = {};
+    };
+}
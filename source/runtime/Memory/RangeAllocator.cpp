@@ -0,0 +1,281 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ===============
+#include "pch.h"
+#include "RangeAllocator.h"
+//==========================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace spartan
+{
+    void RangeAllocator::Reset(const uint32_t capacity)
+    {
+        m_free_by_offset.clear();
+        m_free_by_count.clear();
+        m_capacity         = capacity;
+        m_used             = 0;
+        m_allocation_count = 0;
+
+        if (capacity != 0)
+        {
+            InsertFree(0, capacity);
+        }
+    }
+
+    uint32_t RangeAllocator::Allocate(const uint32_t count)
+    {
+        if (count == 0)
+            return invalid_offset;
+
+        // smallest free range that fits
+        auto it_count = m_free_by_count.lower_bound({ count, 0 });
+        if (it_count == m_free_by_count.end())
+            return invalid_offset;
+
+        const uint32_t range_count  = it_count->first;
+        const uint32_t range_offset = it_count->second;
+        EraseFree(m_free_by_offset.find(range_offset));
+
+        // return the tail
+        if (range_count > count)
+        {
+            InsertFree(range_offset + count, range_count - count);
+        }
+
+        m_used += count;
+        m_allocation_count++;
+
+        return range_offset;
+    }
+
+    void RangeAllocator::Free(const uint32_t offset, const uint32_t count)
+    {
+        SP_ASSERT(count != 0);
+        SP_ASSERT(offset + count <= m_capacity);
+        SP_ASSERT(m_used >= count && m_allocation_count != 0);
+
+        uint32_t merged_offset = offset;
+        uint32_t merged_count  = count;
+
+        // merge with the next range
+        auto it_next = m_free_by_offset.lower_bound(offset);
+        SP_ASSERT_MSG(it_next == m_free_by_offset.end() || it_next->first >= offset + count, "Range overlaps a free range, double free?");
+        if (it_next != m_free_by_offset.end() && it_next->first == offset + count)
+        {
+            merged_count += it_next->second;
+            it_next       = next(it_next);
+            EraseFree(prev(it_next));
+        }
+
+        // merge with the previous range
+        if (it_next != m_free_by_offset.begin())
+        {
+            auto it_prev = prev(it_next);
+            SP_ASSERT_MSG(it_prev->first + it_prev->second <= offset, "Range overlaps a free range, double free?");
+            if (it_prev->first + it_prev->second == offset)
+            {
+                merged_offset  = it_prev->first;
+                merged_count  += it_prev->second;
+                EraseFree(it_prev);
+            }
+        }
+
+        InsertFree(merged_offset, merged_count);
+
+        m_used -= count;
+        m_allocation_count--;
+    }
+
+    uint32_t RangeAllocator::GetLargestFreeRange() const
+    {
+        return m_free_by_count.empty() ? 0 : m_free_by_count.rbegin()->first;
+    }
+
+    float RangeAllocator::GetFragmentation() const
+    {
+        const uint32_t free = GetFree();
+        return free == 0 ? 0.0f : 1.0f - static_cast<float>(GetLargestFreeRange()) / static_cast<float>(free);
+    }
+
+    void RangeAllocator::InsertFree(const uint32_t offset, const uint32_t count)
+    {
+        m_free_by_offset.emplace(offset, count);
+        m_free_by_count.emplace(count, offset);
+    }
+
+    void RangeAllocator::EraseFree(map<uint32_t, uint32_t>::iterator it)
+    {
+        m_free_by_count.erase({ it->second, it->first });
+        m_free_by_offset.erase(it);
+    }
+
+    bool RangeAllocator::Test()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Range allocator %s failed", name);
+                passed = false;
+            }
+        };
+
+        // the free lists mirror each other, are sorted, never touch (merging is complete) and add up with the live ranges
+        auto check_free_lists = [&expect](const RangeAllocator& allocator, const map<uint32_t, uint32_t>& live)
+        {
+            bool consistent = allocator.m_free_by_offset.size() == allocator.m_free_by_count.size();
+            bool merged     = true;
+            uint32_t free   = 0;
+            uint32_t end    = 0;
+            bool first      = true;
+            for (const auto& [offset, count] : allocator.m_free_by_offset)
+            {
+                consistent = consistent && count != 0 && offset + count <= allocator.m_capacity;
+                consistent = consistent && allocator.m_free_by_count.count({ count, offset }) == 1;
+                merged     = merged && (first || offset > end);
+                free      += count;
+                end        = offset + count;
+                first      = false;
+            }
+
+            // every element is either free or part of exactly one live range
+            vector<uint8_t> owners(allocator.m_capacity, 0);
+            for (const map<uint32_t, uint32_t>* ranges : { &allocator.m_free_by_offset, &live })
+            {
+                for (const auto& [offset, count] : *ranges)
+                {
+                    for (uint32_t i = offset; i < offset + count; i++)
+                    {
+                        owners[i]++;
+                    }
+                }
+            }
+            const bool covered = all_of(owners.begin(), owners.end(), [](const uint8_t owner) { return owner == 1; });
+
+            expect("free lists consistent", consistent);
+            expect("free ranges merged", merged);
+            expect("free and used add up", free == allocator.GetFree() && allocator.GetUsed() + free == allocator.GetCapacity());
+            expect("ranges cover the capacity once", covered);
+            expect("allocation count", allocator.GetAllocationCount() == live.size());
+        };
+
+        // random allocations and frees
+        const uint32_t capacity = 1 << 16;
+        RangeAllocator allocator(capacity);
+        map<uint32_t, uint32_t> live; // offset -> count
+        mt19937 generator(0); // fixed seed, so runs are comparable
+        uniform_int_distribution<uint32_t> distribution_count(1, 512);
+        for (uint32_t step = 0; step < 4000; step++)
+        {
+            const bool allocate = live.empty() || generator() % 3 != 0;
+            if (allocate)
+            {
+                // best fit is the smallest free range that fits, the lowest one among equals
+                const uint32_t count     = distribution_count(generator);
+                uint32_t expected_offset = invalid_offset;
+                uint32_t expected_count  = UINT32_MAX;
+                for (const auto& [offset, free_count] : allocator.m_free_by_offset)
+                {
+                    if (free_count >= count && free_count < expected_count)
+                    {
+                        expected_offset = offset;
+                        expected_count  = free_count;
+                    }
+                }
+
+                const uint32_t offset = allocator.Allocate(count);
+                expect("best fit", offset == expected_offset);
+                if (offset == invalid_offset)
+                    continue;
+
+                live[offset] = count;
+            }
+            else
+            {
+                auto it = live.begin();
+                advance(it, generator() % live.size());
+                allocator.Free(it->first, it->second);
+                live.erase(it);
+            }
+
+            if (step % 100 == 0)
+            {
+                check_free_lists(allocator, live);
+            }
+        }
+        check_free_lists(allocator, live);
+
+        // fragment, equal ranges with every other one freed leave as many holes as there are live ranges
+        allocator.Reset(capacity);
+        live.clear();
+        const uint32_t range_count = 256;
+        const uint32_t range_size  = capacity / range_count;
+        for (uint32_t i = 0; i < range_count; i++)
+        {
+            const uint32_t offset = allocator.Allocate(range_size);
+            expect("fresh allocations are contiguous", offset == i * range_size);
+            live[offset] = range_size;
+        }
+        expect("full", allocator.GetFree() == 0 && allocator.Allocate(1) == invalid_offset);
+        for (uint32_t i = 0; i < range_count; i += 2)
+        {
+            allocator.Free(i * range_size, range_size);
+            live.erase(i * range_size);
+        }
+        check_free_lists(allocator, live);
+        expect("fragmented", allocator.GetFreeRangeCount() == range_count / 2 && allocator.GetFragmentation() > 0.9f);
+        expect("scattered space can't hold a bigger range", allocator.Allocate(range_size * 2) == invalid_offset);
+
+        // compact the way the geometry pool does, live ranges are re-allocated in offset order into a reset allocator
+        map<uint32_t, uint32_t> compacted;
+        allocator.Reset(capacity);
+        uint32_t expected_offset = 0;
+        bool packed              = true;
+        for (const auto& [offset, count] : live)
+        {
+            const uint32_t offset_new = allocator.Allocate(count);
+            packed                    = packed && offset_new == expected_offset;
+            expected_offset          += count;
+            compacted[offset_new]     = count;
+        }
+        check_free_lists(allocator, compacted);
+        expect("compaction packs in order", packed);
+        expect("compacted", allocator.GetFreeRangeCount() == 1 && allocator.GetFragmentation() == 0.0f);
+        expect("compacted space holds a bigger range", allocator.Allocate(range_size * 2) == expected_offset);
+
+        // freeing everything leaves a single range again
+        allocator.Free(expected_offset, range_size * 2);
+        for (const auto& [offset, count] : compacted)
+        {
+            allocator.Free(offset, count);
+        }
+        check_free_lists(allocator, {});
+        expect("empty", allocator.GetUsed() == 0 && allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == capacity);
+
+        return passed;
+    }
+}
@@ -0,0 +1,73 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =====
+#include <map>
+#include <set>
+#include <cstdint>
+//================
+
+namespace spartan
+{
+    // sub-allocates ranges of elements out of a fixed capacity, it only does the bookkeeping
+    // so that it can be used for gpu buffers (and tested) without touching any memory
+    class RangeAllocator
+    {
+    public:
+        static constexpr uint32_t invalid_offset = UINT32_MAX;
+
+        RangeAllocator(const uint32_t capacity = 0) { Reset(capacity); }
+
+        // forgets every allocation
+        void Reset(const uint32_t capacity);
+
+        // best fit, returns invalid_offset when no free range is big enough
+        uint32_t Allocate(const uint32_t count);
+
+        // returns a range, it's merged with its free neighbours
+        void Free(const uint32_t offset, const uint32_t count);
+
+        // stats
+        uint32_t GetCapacity() const        { return m_capacity; }
+        uint32_t GetUsed() const            { return m_used; }
+        uint32_t GetFree() const            { return m_capacity - m_used; }
+        uint32_t GetAllocationCount() const { return m_allocation_count; }
+        uint32_t GetFreeRangeCount() const  { return static_cast<uint32_t>(m_free_by_offset.size()); }
+        uint32_t GetLargestFreeRange() const;
+        float GetFragmentation() const; // 0 when all free space is contiguous, approaches 1 as it gets scattered
+
+        // random allocations and frees against a shadow copy, then fragmentation and compaction, checking the free lists throughout
+        static bool Test();
+
+    private:
+        void InsertFree(const uint32_t offset, const uint32_t count);
+        void EraseFree(std::map<uint32_t, uint32_t>::iterator it);
+
+        std::map<uint32_t, uint32_t> m_free_by_offset;           // offset -> count, used for merging
+        std::set<std::pair<uint32_t, uint32_t>> m_free_by_count; // (count, offset), used for best fit
+        uint32_t m_capacity         = 0;
+        uint32_t m_used             = 0;
+        uint32_t m_allocation_count = 0;
+    };
+}
@@ -30,6 +30,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../Rendering/Renderer.h"
 #include "../Display/Display.h"
 #include "../Memory/Allocator.h"
+#include "../Rendering/GeometryPool.h"
 //====================================
 
 //= NAMESPACES =====
@@ -471,6 +472,27 @@ namespace spartan
                 static_cast<uint32_t>(m_rhi_descriptor_set_count),
                 static_cast<uint32_t>(rhi_max_descriptor_set_count));
             SP_ASSERT(offset < sizeof(metrics_buffer));
+
+            // geometry pool
+            uint64_t pool_used     = 0;
+            uint64_t pool_reserved = 0;
+            uint32_t pool_pages    = 0;
+            float pool_fragmented  = 0.0f;
+            for (uint32_t i = 0; i < static_cast<uint32_t>(GeometryPoolType::Max); i++)
+            {
+                const GeometryPoolType type  = static_cast<GeometryPoolType>(i);
+                pool_used                   += GeometryPool::GetMemoryUsed(type);
+                pool_reserved               += GeometryPool::GetMemoryReserved(type);
+                pool_pages                  += GeometryPool::GetPageCount(type);
+                pool_fragmented              = max(pool_fragmented, GeometryPool::GetFragmentation(type));
+            }
+            offset += snprintf(metrics_buffer + offset, sizeof(metrics_buffer) - offset,
+                "\nGeometry pool:\t\t\t%.1f/%.1f MB in %u pages, %.0f%% fragmented",
+                static_cast<float>(pool_used) / (1024.0f * 1024.0f),
+                static_cast<float>(pool_reserved) / (1024.0f * 1024.0f),
+                pool_pages,
+                pool_fragmented * 100.0f);
+            SP_ASSERT(offset < sizeof(metrics_buffer));
         }
 
         // draw directly from the static buffer
@@ -45,6 +45,16 @@ namespace spartan
 
     }
 
+    void RHI_Buffer::Upload(const void* data, const uint64_t offset, const uint64_t size)
+    {
+
+    }
+
+    void RHI_Buffer::Copy(RHI_Buffer* source, RHI_Buffer* destination, const RHI_BufferCopyRegion* regions, const uint32_t region_count)
+    {
+
+    }
+
     void RHI_Buffer::UpdateHandles(RHI_CommandList* cmd_list)
     {
 
@@ -377,6 +377,11 @@ namespace spartan
 
     }
 
+    void RHI_CommandList::CopyBuffer(RHI_Buffer* source, RHI_Buffer* destination, const RHI_BufferCopyRegion* regions, const uint32_t region_count)
+    {
+
+    }
+
     void RHI_CommandList::InsertBarrier(
         void* image,
         const RHI_Format format,
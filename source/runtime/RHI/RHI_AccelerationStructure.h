@@ -64,7 +64,8 @@ namespace spartan
         RHI_AccelerationStructure(const RHI_AccelerationStructureType type, const char* name);
         ~RHI_AccelerationStructure();
 
-        void BuildBottomLevel(RHI_CommandList* cmd_list, const std::vector<RHI_AccelerationStructureGeometry>& geometries, const std::vector<uint32_t>& primitive_counts);
+        void BuildBottomLevel(RHI_CommandList* cmd_list, const std::vector<RHI_AccelerationStructureGeometry>& geometries, const std::vector<uint32_t>& primitive_counts, const bool allow_update = false);
+        void UpdateBottomLevel(RHI_CommandList* cmd_list, const std::vector<RHI_AccelerationStructureGeometry>& geometries, const std::vector<uint32_t>& primitive_counts); // refit for moved vertices, the topology must match the build
         void BuildTopLevel(RHI_CommandList* cmd_list, const std::vector<RHI_AccelerationStructureInstance>& instances);
 
         // misc
@@ -78,6 +79,7 @@ namespace spartan
         // misc
         RHI_AccelerationStructureType m_type = RHI_AccelerationStructureType::Max;
         uint64_t m_size                      = 0;
+        bool m_allow_update                  = false;
 
         // rhi
         void* m_rhi_resource         = nullptr;
@@ -46,6 +46,13 @@ namespace spartan
         uint32_t size           = 0;
     };
 
+    struct RHI_BufferCopyRegion
+    {
+        uint64_t offset_source      = 0; // bytes
+        uint64_t offset_destination = 0; // bytes
+        uint64_t size               = 0; // bytes
+    };
+
     class RHI_Buffer : public SpartanObject
     {
     public:
@@ -84,6 +91,10 @@ namespace spartan
         void Update(RHI_CommandList* cmd_list, void* data_cpu, const uint32_t size = 0);
         void ResetOffset() { m_offset = 0; first_update = true; }
 
+        // vertex, index and instance buffer sub-range updating, done through a staging buffer and the copy queue
+        void Upload(const void* data, const uint64_t offset, const uint64_t size);
+        static void Copy(RHI_Buffer* source, RHI_Buffer* destination, const RHI_BufferCopyRegion* regions, const uint32_t region_count);
+
         // ray tracing
         RHI_StridedDeviceAddressRegion GetRegion(const RHI_Shader_Type group_type, const uint32_t stride_extra = 0) const;
         void UpdateHandles(RHI_CommandList* cmd_list);
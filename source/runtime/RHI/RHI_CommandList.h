@@ -151,6 +151,7 @@ namespace spartan
 
         // buffer
         void UpdateBuffer(RHI_Buffer* buffer, const uint64_t offset, const uint64_t size, const void* data);
+        void CopyBuffer(RHI_Buffer* source, RHI_Buffer* destination, const RHI_BufferCopyRegion* regions, const uint32_t region_count); // all regions share one barrier pair
 
         // memory barriers
         void InsertBarrier(
@@ -51,6 +51,7 @@ namespace spartan
     class RHI_Shader;
     class RHI_SyncPrimitive;
     class RHI_AccelerationStructure;
+    struct RHI_BufferCopyRegion;
     struct RHI_Texture_Mip;
     struct RHI_Texture_Slice;
     struct RHI_Vertex_Undefined;
@@ -58,6 +59,7 @@ namespace spartan
     struct RHI_Vertex_PosCol;
     struct RHI_Vertex_PosUvCol;
     struct RHI_Vertex_PosTexNorTan;
+    struct RHI_Vertex_PosTexNorTan_Quantized;
 
     enum class RHI_PhysicalDevice_Type
     {
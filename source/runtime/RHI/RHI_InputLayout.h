@@ -110,13 +110,12 @@ namespace spartan
             {
                 m_vertex_attributes =
                 {
-                    { "POSITION", 0, binding, RHI_Format::R32G32B32_Float, offsetof(RHI_Vertex_PosTexNorTan, pos) },
-                    { "TEXCOORD", 1, binding, RHI_Format::R32G32_Float,    offsetof(RHI_Vertex_PosTexNorTan, tex) },
-                    { "NORMAL",   2, binding, RHI_Format::R32G32B32_Float, offsetof(RHI_Vertex_PosTexNorTan, nor) },
-                    { "TANGENT",  3, binding, RHI_Format::R32G32B32_Float, offsetof(RHI_Vertex_PosTexNorTan, tan) }
+                    { "POSITION", 0, binding, RHI_Format::R32G32B32_Float,    offsetof(RHI_Vertex_PosTexNorTan_Gpu, pos) },
+                    { "TEXCOORD", 1, binding, RHI_Format::R16G16_Float,       offsetof(RHI_Vertex_PosTexNorTan_Gpu, tex) },
+                    { "NORMAL",   2, binding, RHI_Format::R16G16B16A16_Snorm, offsetof(RHI_Vertex_PosTexNorTan_Gpu, nor_tan) }
                 };
 
-                m_vertex_size = sizeof(RHI_Vertex_PosTexNorTan);
+                m_vertex_size = sizeof(RHI_Vertex_PosTexNorTan_Gpu);
             }
         }
 
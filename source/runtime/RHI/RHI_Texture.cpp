@@ -26,6 +26,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "RHI_CommandList.h"
 #include "../Resource/Import/ImageImporter.h"
 #include "../Core/ProgressTracker.h"
+#include "../FileSystem/MappedFile.h"
+#include "../Rendering/TextureStreaming.h"
+#include <immintrin.h>
 SP_WARNINGS_OFF
 #include "compressonator.h"
 SP_WARNINGS_ON
@@ -62,112 +65,738 @@ namespace spartan
             return CMP_FORMAT::CMP_FORMAT_Unknown;
         }
 
-        void compress(RHI_Texture* texture, const uint32_t mip_index, const RHI_Format dest_format)
+        // texel rows per compression job, a multiple of the block size, small enough to spread a single large mip over every thread
+        const uint32_t rows_per_job = 64;
+
+        // block rows are independent, so any range of them is compressed as if it were a texture of its own
+        struct job
         {
-            // source texture
-            CMP_Texture source_texture = {};
-            source_texture.format      = to_cmp_format(texture->GetFormat());
-            source_texture.dwSize      = sizeof(CMP_Texture);
-            source_texture.dwWidth     = texture->GetWidth() >> mip_index;
-            source_texture.dwHeight    = texture->GetHeight() >> mip_index;
-            source_texture.dwPitch     = source_texture.dwWidth * texture->GetBytesPerPixel();
-            source_texture.dwDataSize  = static_cast<uint32_t>(texture->GetMip(0, mip_index).bytes.size());
-            source_texture.pData       = reinterpret_cast<uint8_t*>(texture->GetMip(0, mip_index).bytes.data());
+            const byte* source        = nullptr;
+            byte* destination         = nullptr;
+            uint32_t width            = 0;
+            uint32_t height           = 0;
+            uint32_t source_pitch     = 0;
+            uint32_t source_size      = 0;
+            uint32_t destination_size = 0;
+        };
 
-            // destination texture
-            CMP_Texture destination_texture = {};
-            destination_texture.format      = to_cmp_format(dest_format);
-            destination_texture.dwSize      = sizeof(CMP_Texture);
-            destination_texture.dwWidth     = source_texture.dwWidth;
-            destination_texture.dwHeight    = source_texture.dwHeight;
-            destination_texture.dwDataSize  = CMP_CalculateBufferSize(&destination_texture);
-            vector<byte> destination_data(destination_texture.dwDataSize);
-            destination_texture.pData       = reinterpret_cast<uint8_t*>(destination_data.data());
+        CMP_CompressOptions get_options()
+        {
+            CMP_CompressOptions options    = {};
+            options.dwSize                 = sizeof(CMP_CompressOptions);
+            options.fquality               = 0.05f;   // lower quality, faster compression
+            options.nEncodeWith            = CMP_HPC; // encoder
+            options.dwnumThreads           = 1;       // the jobs are the parallelism
+            options.bDisableMultiThreading = true;
+
+            return options;
+        }
 
-            // compress texture
-            {
-                CMP_CompressOptions options = {};
-                options.dwSize              = sizeof(CMP_CompressOptions);
-                options.fquality            = 0.05f;                                     // lower quality, faster compression
-                options.dwnumThreads        = max(1u, ThreadPool::GetIdleThreadCount()); // all free threads
-                options.nEncodeWith         = CMP_HPC;                                   // encoder
+        void compress(RHI_Texture* texture, const RHI_Format dest_format)
+        {
+            SP_ASSERT(texture != nullptr);
+
+            const uint32_t bytes_per_pixel = texture->GetBytesPerPixel();
+            const uint32_t slice_count     = texture->GetDepth();
+            const uint32_t mip_count       = texture->GetMipCount();
 
-                SP_ASSERT(CMP_ConvertTexture(&source_texture, &destination_texture, &options, nullptr) == CMP_OK);
+            // allocate the output of every mip of every slice and split it into block row ranges
+            vector<vector<byte>> destination_data(static_cast<size_t>(slice_count) * mip_count);
+            vector<job> jobs;
+            for (uint32_t array_index = 0; array_index < slice_count; array_index++)
+            {
+                for (uint32_t mip_index = 0; mip_index < mip_count; mip_index++)
+                {
+                    const uint32_t width  = max(1u, texture->GetWidth() >> mip_index);
+                    const uint32_t height = max(1u, texture->GetHeight() >> mip_index);
+                    const uint32_t pitch  = width * bytes_per_pixel;
+                    const byte* source    = texture->GetMip(array_index, mip_index).bytes.data();
+
+                    CMP_Texture destination_texture = {};
+                    destination_texture.format      = to_cmp_format(dest_format);
+                    destination_texture.dwSize      = sizeof(CMP_Texture);
+                    destination_texture.dwWidth     = width;
+                    destination_texture.dwHeight    = height;
+                    vector<byte>& destination       = destination_data[array_index * mip_count + mip_index];
+                    destination.resize(CMP_CalculateBufferSize(&destination_texture));
+
+                    size_t offset = 0;
+                    for (uint32_t row = 0; row < height; row += rows_per_job)
+                    {
+                        job& job                     = jobs.emplace_back();
+                        job.width                    = width;
+                        job.height                   = min(rows_per_job, height - row);
+                        job.source_pitch             = pitch;
+                        job.source_size              = pitch * job.height;
+                        job.source                   = source + static_cast<size_t>(row) * pitch;
+                        destination_texture.dwHeight = job.height;
+                        job.destination_size         = CMP_CalculateBufferSize(&destination_texture);
+                        job.destination              = destination.data() + offset;
+                        offset                      += job.destination_size;
+                    }
+                    SP_ASSERT(offset == destination.size());
+                }
             }
 
+            // compress
+            const CMP_CompressOptions options = get_options();
+            ThreadPool::ParallelLoop([&jobs, &options, texture, dest_format](uint32_t job_start, uint32_t job_end)
+            {
+                for (uint32_t i = job_start; i < job_end; i++)
+                {
+                    const job& job = jobs[i];
+
+                    CMP_Texture source_texture = {};
+                    source_texture.format      = to_cmp_format(texture->GetFormat());
+                    source_texture.dwSize      = sizeof(CMP_Texture);
+                    source_texture.dwWidth     = job.width;
+                    source_texture.dwHeight    = job.height;
+                    source_texture.dwPitch     = job.source_pitch;
+                    source_texture.dwDataSize  = job.source_size;
+                    source_texture.pData       = reinterpret_cast<uint8_t*>(const_cast<byte*>(job.source));
+
+                    CMP_Texture destination_texture = {};
+                    destination_texture.format      = to_cmp_format(dest_format);
+                    destination_texture.dwSize      = sizeof(CMP_Texture);
+                    destination_texture.dwWidth     = job.width;
+                    destination_texture.dwHeight    = job.height;
+                    destination_texture.dwDataSize  = job.destination_size;
+                    destination_texture.pData       = reinterpret_cast<uint8_t*>(job.destination);
+
+                    SP_ASSERT(CMP_ConvertTexture(&source_texture, &destination_texture, &options, nullptr) == CMP_OK);
+                }
+            }, static_cast<uint32_t>(jobs.size()));
+
             // update texture with compressed data
-            texture->GetMip(0, mip_index).bytes = destination_data;
+            for (uint32_t array_index = 0; array_index < slice_count; array_index++)
+            {
+                for (uint32_t mip_index = 0; mip_index < mip_count; mip_index++)
+                {
+                    texture->GetMip(array_index, mip_index).bytes = move(destination_data[array_index * mip_count + mip_index]);
+                }
+            }
+
+            texture->SetFormat(dest_format);
         }
 
         void compress(RHI_Texture* texture)
         {
-            SP_ASSERT(texture != nullptr);
+            compress(texture, destination_format);
+        }
+    }
+
+    namespace mips
+    {
+        // alpha cutoff of the depth passes, see get_alpha_threshold() in common.hlsl
+        const float alpha_test_threshold = 0.6f;
+
+        // output rows filtered per band, the band keeps the horizontally filtered source rows it needs
+        const uint32_t band_rows = 16;
+
+        enum class filter
+        {
+            box,   // 2x2 average, the cheapest option and ringing free, good for data (heights, hdr)
+            kaiser // kaiser windowed sinc, keeps minified color textures sharp without aliasing
+        };
+
+        struct options
+        {
+            filter filter_type           = filter::box;
+            bool preserve_alpha_coverage = false; // keeps alpha tested surfaces (foliage) from thinning out in the distance
+        };
+
+        struct layout
+        {
+            uint32_t channels          = 0;
+            uint32_t bytes_per_channel = 0;     // 1 and 2 are unorm, 4 is float
+            bool srgb                  = false; // rgb is srgb encoded and gets filtered in linear space, alpha is always linear
+
+            bool is_srgb_channel(const uint32_t channel) const { return srgb && channel < 3; }
+        };
 
-            for (uint32_t mip_index = 0; mip_index < texture->GetMipCount(); mip_index++)
+        bool get_layout(const RHI_Format format, const bool srgb, layout& layout)
+        {
+            switch (format)
             {
-                compress(texture, mip_index, destination_format);
+                case RHI_Format::R8_Unorm:
+                case RHI_Format::R8G8_Unorm:
+                case RHI_Format::R8G8B8A8_Unorm:
+                    layout.bytes_per_channel = 1;
+                    break;
+                case RHI_Format::R16_Unorm:
+                case RHI_Format::R16G16B16A16_Unorm:
+                    layout.bytes_per_channel = 2;
+                    break;
+                case RHI_Format::R32_Float:
+                case RHI_Format::R32G32_Float:
+                case RHI_Format::R32G32B32_Float:
+                case RHI_Format::R32G32B32A32_Float:
+                    layout.bytes_per_channel = 4;
+                    break;
+                default:
+                    return false;
             }
 
-            texture->SetFormat(destination_format);
+            layout.channels = rhi_to_format_channel_count(format);
+            layout.srgb     = srgb && layout.bytes_per_channel != 4 && layout.channels >= 3;
+
+            return true;
         }
-    }
 
-    namespace mips
-    {
-        void downsample_bilinear(const vector<byte>& input, vector<byte>& output, uint32_t width, uint32_t height)
+        float srgb_to_linear(const float value)
         {
-            constexpr uint32_t channels = 4; // RGBA32 - engine standard
-  
-            // calculate new dimensions (halving both width and height)
-            uint32_t new_width  = width  >> 1;
-            uint32_t new_height = height >> 1;
-            
-            // ensure minimum size
-            if (new_width < 1) new_width = 1;
-            if (new_height < 1) new_height = 1;
-            
-             // perform bilinear downsampling
-            for (uint32_t y = 0; y < new_height; y++)
+            return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float linear_to_srgb(const float value)
+        {
+            return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+        }
+
+        struct tables
+        {
+            // [0, 255] decode srgb bytes, [256, 511] decode unorm bytes
+            array<float, 512> decode;
+
+            // linear values quantized to 16 bits to srgb bytes, padded so that 32-bit gathers stay in bounds
+            array<uint8_t, 65536 + 3> encode;
+
+            // per element offsets into the decode table, the period (24) is a multiple of every channel count
+            array<int32_t, 32> decode_offsets;
+        };
+
+        const tables& get_tables()
+        {
+            static const tables tables = []()
             {
-                for (uint32_t x = 0; x < new_width; x++)
+                mips::tables tables = {};
+
+                for (uint32_t i = 0; i < 256; i++)
+                {
+                    tables.decode[i]       = srgb_to_linear(i / 255.0f);
+                    tables.decode[256 + i] = i / 255.0f;
+                }
+
+                for (uint32_t i = 0; i < 65536; i++)
                 {
-                    // calculate base indices for this 2x2 block
-                    uint32_t src_idx              = (y * 2 * width + x * 2) * channels;
-                    uint32_t src_idx_right        = src_idx + channels;                      // right pixel
-                    uint32_t src_idx_bottom       = src_idx + (width * channels);            // bottom pixel
-                    uint32_t src_idx_bottom_right = src_idx + (width * channels) + channels; // bottom-right pixel
-                    uint32_t dst_idx              = (y * new_width + x) * channels;
+                    tables.encode[i] = static_cast<uint8_t>(linear_to_srgb(i / 65535.0f) * 255.0f + 0.5f);
+                }
+
+                return tables;
+            }();
+
+            return tables;
+        }
+
+        // decode table offsets for a layout, see tables::decode_offsets
+        array<int32_t, 32> get_decode_offsets(const layout& layout)
+        {
+            array<int32_t, 32> offsets = {};
+            for (uint32_t i = 0; i < offsets.size(); i++)
+            {
+                offsets[i] = layout.is_srgb_channel(i % layout.channels) ? 0 : 256;
+            }
+
+            return offsets;
+        }
+
+        struct kernel
+        {
+            int32_t first = 0;     // source texel of the first tap, relative to 2 * output texel
+            vector<float> weights; // normalized
+        };
+
+        float bessel_i0(const float x)
+        {
+            // power series, converges quickly for the small arguments a kaiser window needs
+            float sum  = 1.0f;
+            float term = 1.0f;
+            for (uint32_t i = 1; i < 32; i++)
+            {
+                const float t = x / (2.0f * static_cast<float>(i));
+                term         *= t * t;
+                sum          += term;
+            }
+
+            return sum;
+        }
+
+        kernel get_kernel(const filter type)
+        {
+            kernel kernel;
+
+            if (type == filter::box)
+            {
+                kernel.first   = 0;
+                kernel.weights = { 0.5f, 0.5f };
+                return kernel;
+            }
+
+            // kaiser window (alpha 4) over a sinc, 3 output texels wide on each side
+            const float width = 3.0f;
+            const float alpha = 4.0f;
+            const int32_t taps = static_cast<int32_t>(width) * 4;
+            kernel.first       = 1 - taps / 2;
+
+            float sum = 0.0f;
+            for (int32_t tap = 0; tap < taps; tap++)
+            {
+                // distance from the output texel center in output texels
+                const float x      = (static_cast<float>(kernel.first + tap) - 0.5f) * 0.5f;
+                const float sinc   = x == 0.0f ? 1.0f : sinf(math::pi * x) / (math::pi * x);
+                const float t      = x / width;
+                const float window = bessel_i0(alpha * sqrtf(max(0.0f, 1.0f - t * t))) / bessel_i0(alpha);
+
+                kernel.weights.push_back(sinc * window);
+                sum += kernel.weights.back();
+            }
+
+            for (float& weight : kernel.weights)
+            {
+                weight /= sum;
+            }
+
+            return kernel;
+        }
 
-                    // process all 4 channels (RGBA)
-                    for (uint32_t c = 0; c < channels; c++)
+        void decode_row(const byte* source, const uint32_t count, const layout& layout, float* destination)
+        {
+            uint32_t i = 0;
+
+            if (layout.bytes_per_channel == 4)
+            {
+                memcpy(destination, source, count * sizeof(float));
+                return;
+            }
+
+            if (layout.bytes_per_channel == 1)
+            {
+                const tables& tables             = get_tables();
+                const array<int32_t, 32> offsets = get_decode_offsets(layout);
+                const uint8_t* bytes             = reinterpret_cast<const uint8_t*>(source);
+
+            #if defined(__AVX2__)
+                const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+                for (; i + 8 <= count; i += 8)
+                {
+                    const __m256i value = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes + i)));
+                    if (layout.srgb)
                     {
-                        uint32_t sum = to_integer<uint32_t>(input[src_idx + c]);
-                        uint32_t count = 1;
-            
-                        // right pixel
-                        if (x * 2 + 1 < width)
-                        {
-                            sum += to_integer<uint32_t>(input[src_idx_right + c]);
-                            count++;
-                        }
-            
-                        // bottom pixel
-                        if (y * 2 + 1 < height)
+                        const __m256i offset = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets.data() + i % 24));
+                        _mm256_storeu_ps(destination + i, _mm256_i32gather_ps(tables.decode.data(), _mm256_add_epi32(value, offset), 4));
+                    }
+                    else
+                    {
+                        _mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_cvtepi32_ps(value), scale));
+                    }
+                }
+            #endif
+
+                for (; i < count; i++)
+                {
+                    destination[i] = tables.decode[bytes[i] + offsets[i % 24]];
+                }
+
+                return;
+            }
+
+            const uint16_t* words = reinterpret_cast<const uint16_t*>(source);
+
+        #if defined(__AVX2__)
+            if (!layout.srgb)
+            {
+                const __m256 scale = _mm256_set1_ps(1.0f / 65535.0f);
+                for (; i + 8 <= count; i += 8)
+                {
+                    const __m256i value = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i)));
+                    _mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_cvtepi32_ps(value), scale));
+                }
+            }
+        #endif
+
+            for (; i < count; i++)
+            {
+                const float value = words[i] * (1.0f / 65535.0f);
+                destination[i]    = layout.is_srgb_channel(i % layout.channels) ? srgb_to_linear(value) : value;
+            }
+        }
+
+        void encode_row(const float* source, const uint32_t count, const layout& layout, byte* destination)
+        {
+            uint32_t i = 0;
+
+            if (layout.bytes_per_channel == 4)
+            {
+                memcpy(destination, source, count * sizeof(float));
+                return;
+            }
+
+            if (layout.bytes_per_channel == 1)
+            {
+                const tables& tables             = get_tables();
+                const array<int32_t, 32> offsets = get_decode_offsets(layout);
+                uint8_t* bytes                   = reinterpret_cast<uint8_t*>(destination);
+
+            #if defined(__AVX2__)
+                const __m256 zero     = _mm256_setzero_ps();
+                const __m256 one      = _mm256_set1_ps(1.0f);
+                const __m256 half     = _mm256_set1_ps(0.5f);
+                const __m256i low     = _mm256_set1_epi32(0xFF);
+                const __m256i compact = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+                for (; i + 8 <= count; i += 8)
+                {
+                    const __m256 value    = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(source + i), zero), one);
+                    const __m256i unorm   = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(255.0f)), half));
+                    __m256i packed        = unorm;
+                    if (layout.srgb)
+                    {
+                        const __m256i index   = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(65535.0f)), half));
+                        const __m256i srgb    = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(tables.encode.data()), index, 1), low);
+                        const __m256i is_srgb = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets.data() + i % 24)), _mm256_setzero_si256());
+                        packed                = _mm256_blendv_epi8(unorm, srgb, is_srgb);
+                    }
+
+                    // 8 x 32-bit to 8 x 8-bit
+                    packed = _mm256_packus_epi32(packed, packed);
+                    packed = _mm256_packus_epi16(packed, packed);
+                    packed = _mm256_permutevar8x32_epi32(packed, compact);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(bytes + i), _mm256_castsi256_si128(packed));
+                }
+            #endif
+
+                for (; i < count; i++)
+                {
+                    const float value = clamp(source[i], 0.0f, 1.0f);
+                    bytes[i]          = offsets[i % 24] == 0 ? tables.encode[static_cast<uint32_t>(value * 65535.0f + 0.5f)] : static_cast<uint8_t>(value * 255.0f + 0.5f);
+                }
+
+                return;
+            }
+
+            uint16_t* words = reinterpret_cast<uint16_t*>(destination);
+
+        #if defined(__AVX2__)
+            if (!layout.srgb)
+            {
+                const __m256 zero  = _mm256_setzero_ps();
+                const __m256 one   = _mm256_set1_ps(1.0f);
+                const __m256 scale = _mm256_set1_ps(65535.0f);
+                const __m256 half  = _mm256_set1_ps(0.5f);
+                for (; i + 8 <= count; i += 8)
+                {
+                    const __m256 value   = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(source + i), zero), one);
+                    const __m256i unorm  = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, scale), half));
+                    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(unorm, unorm), 0b1000);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(words + i), _mm256_castsi256_si128(packed));
+                }
+            }
+        #endif
+
+            for (; i < count; i++)
+            {
+                float value = clamp(source[i], 0.0f, 1.0f);
+                value       = layout.is_srgb_channel(i % layout.channels) ? clamp(linear_to_srgb(value), 0.0f, 1.0f) : value;
+                words[i]    = static_cast<uint16_t>(value * 65535.0f + 0.5f);
+            }
+        }
+
+        // filters a decoded row down to half its width, edges are clamped
+        void filter_row(const float* source, const uint32_t width, const uint32_t channels, const kernel& kernel, float* destination, const uint32_t destination_width)
+        {
+            const int32_t taps   = static_cast<int32_t>(kernel.weights.size());
+            const int32_t last   = static_cast<int32_t>(width) - 1;
+            const float* weights = kernel.weights.data();
+
+            auto filter_texel = [&](const uint32_t x)
+            {
+                const int32_t first = static_cast<int32_t>(x) * 2 + kernel.first;
+                for (uint32_t channel = 0; channel < channels; channel++)
+                {
+                    float sum = 0.0f;
+                    for (int32_t tap = 0; tap < taps; tap++)
+                    {
+                        const int32_t index = clamp(first + tap, 0, last);
+                        sum                += weights[tap] * source[index * channels + channel];
+                    }
+                    destination[x * channels + channel] = sum;
+                }
+            };
+
+            uint32_t x = 0;
+
+        #if defined(__AVX2__)
+            // interior texels whose taps are all in range, 8 / channels texels per iteration
+            if (channels != 3)
+            {
+                const uint32_t texels_per_step = 8 / channels;
+                const int32_t last_tap          = kernel.first + taps - 1;
+
+                // first texel with every tap in range
+                const uint32_t x_begin = static_cast<uint32_t>(max(0, (-kernel.first + 1) / 2));
+                for (; x < min(x_begin, destination_width); x++)
+                {
+                    filter_texel(x);
+                }
+
+                // lane i reads channel (i % channels) of the (i / channels)-th texel, which is 2 texels apart from the previous
+                alignas(32) int32_t lanes[8];
+                for (uint32_t lane = 0; lane < 8; lane++)
+                {
+                    lanes[lane] = static_cast<int32_t>((lane / channels) * 2 * channels + lane % channels);
+                }
+                const __m256i index = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes));
+
+                for (; x + texels_per_step <= destination_width && static_cast<int32_t>(x + texels_per_step - 1) * 2 + last_tap <= last; x += texels_per_step)
+                {
+                    const float* base = source + static_cast<ptrdiff_t>(static_cast<int32_t>(x) * 2 + kernel.first) * channels;
+                    __m256 sum        = _mm256_setzero_ps();
+                    for (int32_t tap = 0; tap < taps; tap++)
+                    {
+                        // rgba texels are 16 bytes, two loads beat a gather
+                        const float* texel = base + tap * channels;
+                        const __m256 value = channels == 4 ? _mm256_set_m128(_mm_loadu_ps(texel + 8), _mm_loadu_ps(texel)) : _mm256_i32gather_ps(texel, index, 4);
+                        sum                = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[tap]), value));
+                    }
+                    _mm256_storeu_ps(destination + x * channels, sum);
+                }
+            }
+        #endif
+
+            for (; x < destination_width; x++)
+            {
+                filter_texel(x);
+            }
+        }
+
+        // generates destination rows [row_begin, row_end) of one slice from the level above it
+        void downsample_rows(
+            const byte* source, const size_t source_pitch, const uint32_t width, const uint32_t height,
+            byte* destination, const uint32_t destination_width,
+            const uint32_t row_begin, const uint32_t row_end,
+            const layout& layout, const kernel& kernel)
+        {
+            const uint32_t channels           = layout.channels;
+            const uint32_t row_elements       = width * channels;
+            const uint32_t filtered_elements  = destination_width * channels;
+            const size_t destination_pitch    = static_cast<size_t>(filtered_elements) * layout.bytes_per_channel;
+            const int32_t taps                = static_cast<int32_t>(kernel.weights.size());
+            const int32_t last_row            = static_cast<int32_t>(height) - 1;
+
+            vector<float> decoded(row_elements);
+            vector<float> filtered;
+            vector<float> output(filtered_elements);
+
+            for (uint32_t band_begin = row_begin; band_begin < row_end; band_begin += band_rows)
+            {
+                const uint32_t band_end = min(band_begin + band_rows, row_end);
+
+                // horizontally filter every source row the band touches
+                const int32_t source_begin = clamp(static_cast<int32_t>(band_begin) * 2 + kernel.first, 0, last_row);
+                const int32_t source_end   = clamp(static_cast<int32_t>(band_end - 1) * 2 + kernel.first + taps - 1, 0, last_row);
+                filtered.resize(static_cast<size_t>(source_end - source_begin + 1) * filtered_elements);
+                for (int32_t y = source_begin; y <= source_end; y++)
+                {
+                    decode_row(source + static_cast<size_t>(y) * source_pitch, row_elements, layout, decoded.data());
+                    filter_row(decoded.data(), width, channels, kernel, filtered.data() + static_cast<size_t>(y - source_begin) * filtered_elements, destination_width);
+                }
+
+                // vertically filter and encode
+                for (uint32_t y = band_begin; y < band_end; y++)
+                {
+                    fill(output.begin(), output.end(), 0.0f);
+
+                    const int32_t first = static_cast<int32_t>(y) * 2 + kernel.first;
+                    for (int32_t tap = 0; tap < taps; tap++)
+                    {
+                        const int32_t source_y = clamp(first + tap, 0, last_row);
+                        const float* row       = filtered.data() + static_cast<size_t>(source_y - source_begin) * filtered_elements;
+                        const float weight     = kernel.weights[tap];
+
+                        uint32_t i = 0;
+                    #if defined(__AVX2__)
+                        const __m256 weight_v = _mm256_set1_ps(weight);
+                        for (; i + 8 <= filtered_elements; i += 8)
                         {
-                            sum += to_integer<uint32_t>(input[src_idx_bottom + c]);
-                            count++;
+                            _mm256_storeu_ps(output.data() + i, _mm256_add_ps(_mm256_loadu_ps(output.data() + i), _mm256_mul_ps(weight_v, _mm256_loadu_ps(row + i))));
                         }
-            
-                        // bottom-right pixel
-                        if ((x * 2 + 1 < width) && (y * 2 + 1 < height))
+                    #endif
+                        for (; i < filtered_elements; i++)
                         {
-                            sum += to_integer<uint32_t>(input[src_idx_bottom_right + c]);
-                            count++;
+                            output[i] += weight * row[i];
                         }
-            
-                        // assign the averaged result to the output
-                        output[dst_idx + c] = byte(sum / count);
                     }
+
+                    encode_row(output.data(), filtered_elements, layout, destination + static_cast<size_t>(y) * destination_pitch);
+                }
+            }
+        }
+
+        float get_alpha(const byte* texel, const layout& layout)
+        {
+            const uint32_t offset = (layout.channels - 1) * layout.bytes_per_channel;
+            if (layout.bytes_per_channel == 1)
+                return to_integer<uint8_t>(texel[offset]) / 255.0f;
+
+            if (layout.bytes_per_channel == 2)
+                return *reinterpret_cast<const uint16_t*>(texel + offset) / 65535.0f;
+
+            return *reinterpret_cast<const float*>(texel + offset);
+        }
+
+        void set_alpha(byte* texel, const layout& layout, const float alpha)
+        {
+            const uint32_t offset = (layout.channels - 1) * layout.bytes_per_channel;
+            if (layout.bytes_per_channel == 1)
+            {
+                texel[offset] = static_cast<byte>(static_cast<uint8_t>(clamp(alpha, 0.0f, 1.0f) * 255.0f + 0.5f));
+            }
+            else if (layout.bytes_per_channel == 2)
+            {
+                *reinterpret_cast<uint16_t*>(texel + offset) = static_cast<uint16_t>(clamp(alpha, 0.0f, 1.0f) * 65535.0f + 0.5f);
+            }
+            else
+            {
+                *reinterpret_cast<float*>(texel + offset) = alpha;
+            }
+        }
+
+        // alpha histogram, fine enough to resolve every 8-bit value exactly
+        array<uint32_t, 1024> get_alpha_histogram(const vector<byte>& bytes, const uint32_t texel_count, const layout& layout)
+        {
+            const uint32_t texel_size = layout.channels * layout.bytes_per_channel;
+
+            array<uint32_t, 1024> histogram = {};
+            for (uint32_t i = 0; i < texel_count; i++)
+            {
+                const float alpha = clamp(get_alpha(bytes.data() + static_cast<size_t>(i) * texel_size, layout), 0.0f, 1.0f);
+                histogram[static_cast<uint32_t>(alpha * 1023.0f + 0.5f)]++;
+            }
+
+            return histogram;
+        }
+
+        // fraction of texels that pass the alpha test once alpha is scaled
+        float get_alpha_coverage(const array<uint32_t, 1024>& histogram, const uint32_t texel_count, const float scale)
+        {
+            uint32_t covered = 0;
+            for (uint32_t i = 0; i < histogram.size(); i++)
+            {
+                if ((i / 1023.0f) * scale > alpha_test_threshold)
+                {
+                    covered += histogram[i];
+                }
+            }
+
+            return static_cast<float>(covered) / static_cast<float>(texel_count);
+        }
+
+        // scales the alpha of every mip (after the first) so the alpha tested coverage matches that of the first mip
+        void preserve_alpha_coverage(RHI_Texture_Slice& slice, const uint32_t width, const uint32_t height, const layout& layout)
+        {
+            const uint32_t texel_size  = layout.channels * layout.bytes_per_channel;
+            const uint32_t texel_count = width * height;
+            const float target         = get_alpha_coverage(get_alpha_histogram(slice.mips[0].bytes, texel_count, layout), texel_count, 1.0f);
+
+            // nothing is cut out, or everything is, there is no silhouette to preserve
+            if (target <= 0.0f || target >= 1.0f)
+                return;
+
+            for (uint32_t mip_index = 1; mip_index < slice.mips.size(); mip_index++)
+            {
+                vector<byte>& bytes                   = slice.mips[mip_index].bytes;
+                const uint32_t mip_texel_count        = max(1u, width >> mip_index) * max(1u, height >> mip_index);
+                const array<uint32_t, 1024> histogram = get_alpha_histogram(bytes, mip_texel_count, layout);
+
+                // coverage grows with the scale, so bisect towards the target
+                float scale_min = 0.0f;
+                float scale_max = 4.0f;
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    const float scale = (scale_min + scale_max) * 0.5f;
+                    if (get_alpha_coverage(histogram, mip_texel_count, scale) < target)
+                    {
+                        scale_min = scale;
+                    }
+                    else
+                    {
+                        scale_max = scale;
+                    }
+                }
+
+                const float scale = (scale_min + scale_max) * 0.5f;
+                for (uint32_t i = 0; i < mip_texel_count; i++)
+                {
+                    byte* texel = bytes.data() + static_cast<size_t>(i) * texel_size;
+                    set_alpha(texel, layout, get_alpha(texel, layout) * scale);
+                }
+            }
+        }
+
+        // fills mips [1, mip_count) of every slice from mip 0, one level at a time, rows of all slices in parallel
+        void generate(vector<RHI_Texture_Slice>& slices, const uint32_t width, const uint32_t height, const uint32_t mip_count, const layout& layout, const options& options)
+        {
+            const kernel kernel        = get_kernel(options.filter_type);
+            const uint32_t slice_count = static_cast<uint32_t>(slices.size());
+            const uint32_t texel_size  = layout.channels * layout.bytes_per_channel;
+
+            for (RHI_Texture_Slice& slice : slices)
+            {
+                slice.mips.resize(mip_count);
+            }
+
+            for (uint32_t mip_index = 1; mip_index < mip_count; mip_index++)
+            {
+                const uint32_t source_width       = max(1u, width  >> (mip_index - 1));
+                const uint32_t source_height      = max(1u, height >> (mip_index - 1));
+                const uint32_t destination_width  = max(1u, width  >> mip_index);
+                const uint32_t destination_height = max(1u, height >> mip_index);
+
+                for (RHI_Texture_Slice& slice : slices)
+                {
+                    slice.mips[mip_index].bytes.resize(static_cast<size_t>(destination_width) * destination_height * texel_size);
+                }
+
+                auto downsample = [&](uint32_t row_start, uint32_t row_end)
+                {
+                    // a range can span slices, split it at slice boundaries
+                    while (row_start < row_end)
+                    {
+                        const uint32_t slice_index = row_start / destination_height;
+                        const uint32_t y_begin     = row_start % destination_height;
+                        const uint32_t y_end       = min(destination_height, y_begin + (row_end - row_start));
+
+                        // the first mip can come straight from an importer, with padded rows
+                        const vector<byte>& source = slices[slice_index].mips[mip_index - 1].bytes;
+                        const size_t source_pitch  = source.size() / source_height;
+
+                        downsample_rows(
+                            source.data(), source_pitch, source_width, source_height,
+                            slices[slice_index].mips[mip_index].bytes.data(), destination_width,
+                            y_begin, y_end,
+                            layout, kernel
+                        );
+
+                        row_start += y_end - y_begin;
+                    }
+                };
+
+                // small mips aren't worth the trip to the thread pool
+                const uint32_t row_count = slice_count * destination_height;
+                if (static_cast<uint64_t>(row_count) * destination_width < 64 * 1024)
+                {
+                    downsample(0, row_count);
+                }
+                else
+                {
+                    ThreadPool::ParallelLoop(downsample, row_count);
+                }
+            }
+
+            if (options.preserve_alpha_coverage && layout.channels == 4)
+            {
+                for (RHI_Texture_Slice& slice : slices)
+                {
+                    preserve_alpha_coverage(slice, width, height, layout);
                 }
             }
         }
@@ -213,6 +842,270 @@ namespace spartan
             ifs.read(reinterpret_cast<char*>(data), static_cast<streamsize>(size));
             return ifs.good();
         }
+
+        // v2 starts with a table and stores page aligned mips, smallest first, so that a mapped
+        // file can be streamed from and the mip tail of every slice sits in a few contiguous pages
+        const uint32_t magic     = 0x54545053; // "SPTT", the legacy header starts with the texture type instead
+        const uint32_t version   = 2;
+        const uint32_t alignment = 4096;
+
+        struct header_v2
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t type;
+            uint32_t format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t depth;
+            uint32_t mip_count;
+            uint32_t flags;
+            uint32_t alignment;
+            uint64_t content_hash;
+            char     name[128];
+        };
+
+        struct table_entry
+        {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        bool is_v2(const string& file_path)
+        {
+            ifstream ifs(file_path, ios::binary);
+            uint32_t value = 0;
+            return ifs.is_open() && read_all(ifs, &value, sizeof(value)) && value == magic;
+        }
+
+        shared_ptr<RHI_Texture_Stream> open_stream(const shared_ptr<MappedFile>& file, const string& file_path)
+        {
+            if (file->GetSize() < sizeof(header_v2))
+                return nullptr;
+
+            header_v2 hdr;
+            memcpy(&hdr, file->GetData(), sizeof(hdr));
+            if (hdr.magic != magic || hdr.version != version || hdr.depth == 0 || hdr.mip_count == 0 || hdr.mip_count > rhi_max_mip_count)
+                return nullptr;
+
+            const uint64_t entry_count = static_cast<uint64_t>(hdr.depth) * hdr.mip_count;
+            if (file->GetSize() < sizeof(header_v2) + entry_count * sizeof(table_entry))
+                return nullptr;
+
+            shared_ptr<RHI_Texture_Stream> stream = make_shared<RHI_Texture_Stream>();
+            stream->file         = file;
+            stream->type         = static_cast<RHI_Texture_Type>(hdr.type);
+            stream->format       = static_cast<RHI_Format>(hdr.format);
+            stream->width        = hdr.width;
+            stream->height       = hdr.height;
+            stream->depth        = hdr.depth;
+            stream->mip_count    = hdr.mip_count;
+            stream->flags        = hdr.flags;
+            stream->content_hash = hdr.content_hash;
+            stream->name         = hdr.name[0] ? string(hdr.name, strnlen(hdr.name, sizeof(hdr.name))) : FileSystem::GetFileNameFromFilePath(file_path);
+            stream->file_path    = file_path;
+            stream->offsets.resize(entry_count);
+            stream->sizes.resize(entry_count);
+
+            const uint8_t* table = file->GetData() + sizeof(header_v2);
+            for (uint64_t i = 0; i < entry_count; i++)
+            {
+                table_entry entry;
+                memcpy(&entry, table + i * sizeof(table_entry), sizeof(entry));
+                if (entry.size == 0 || entry.offset > file->GetSize() || entry.size > file->GetSize() - entry.offset)
+                    return nullptr;
+
+                stream->offsets[i] = entry.offset;
+                stream->sizes[i]   = entry.size;
+            }
+
+            return stream;
+        }
+    }
+
+    // compressed mip chains are derived data, they are cached on disk under a key that covers the source
+    // and everything that goes into producing them, so that a warm load only has to read blocks, image
+    // files are keyed by their path and stamp so a hit skips decoding, everything else by content
+    namespace texture_cache
+    {
+        const char* directory  = "texture_cache";
+        const uint32_t magic   = 0x58545053; // "SPTX"
+        const uint32_t version = 2;          // bump when mip generation, compression or the file layout changes
+
+        // flags that change the output but aren't known when a file is looked up, they are stored with the entry
+        const uint32_t derived_flags = RHI_Texture_Srgb | RHI_Texture_Thumbnail;
+        const uint32_t stored_flags  = derived_flags | RHI_Texture_Greyscale | RHI_Texture_Transparent;
+
+        // lookups, for the benchmark
+        atomic<uint32_t> hit_count  = 0;
+        atomic<uint32_t> miss_count = 0;
+
+        struct entry
+        {
+            RHI_Format format  = RHI_Format::Max;
+            uint32_t width     = 0;
+            uint32_t height    = 0;
+            uint32_t mip_count = 0;
+            uint32_t flags     = 0;
+            vector<RHI_Texture_Slice> slices;
+        };
+
+        string get_file_path(const uint64_t key)
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+            return string(directory) + "/" + name;
+        }
+
+        // the content hash covers the pixels, dimensions, format and flags (srgb, transparency, thumbnail)
+        uint64_t get_key(RHI_Texture* texture, const RHI_Format destination_format)
+        {
+            const CMP_CompressOptions options = compressonator::get_options();
+
+            uint64_t key = math::hash_combine(texture->GetContentHash(), static_cast<uint64_t>(destination_format));
+            key          = math::hash_combine(key, static_cast<uint64_t>(bit_cast<uint32_t>(options.fquality)));
+            key          = math::hash_combine(key, static_cast<uint64_t>(options.nEncodeWith));
+            key          = math::hash_combine(key, static_cast<uint64_t>(version));
+
+            return key != 0 ? key : 1;
+        }
+
+        // the stamp changes with the file's size or write time, 0 if the file doesn't exist
+        uint64_t get_source_key(const string& file_path, const RHI_Format destination_format)
+        {
+            const uint64_t stamp = FileSystem::GetFileStamp(file_path);
+            if (stamp == 0)
+                return 0;
+
+            const CMP_CompressOptions options = compressonator::get_options();
+
+            uint64_t key = math::hash_combine(math::hash_bytes(file_path.data(), file_path.size()), stamp);
+            key          = math::hash_combine(key, static_cast<uint64_t>(destination_format));
+            key          = math::hash_combine(key, static_cast<uint64_t>(bit_cast<uint32_t>(options.fquality)));
+            key          = math::hash_combine(key, static_cast<uint64_t>(options.nEncodeWith));
+            key          = math::hash_combine(key, static_cast<uint64_t>(version));
+
+            return key != 0 ? key : 1;
+        }
+
+        // returns false on a miss, or if the entry is stale or malformed
+        bool load(const uint64_t key, const uint32_t slice_count, entry& entry)
+        {
+            const string file_path = get_file_path(key);
+            ifstream file(file_path, ios::binary | ios::ate);
+            if (!file.is_open())
+            {
+                miss_count++;
+                return false;
+            }
+
+            const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+            file.seekg(0);
+
+            uint32_t file_magic   = 0;
+            uint32_t file_version = 0;
+            uint64_t file_key     = 0;
+            uint32_t format       = 0;
+            bool valid            = binary_format::read_all(file, &file_magic, sizeof(file_magic)) &&
+                                    binary_format::read_all(file, &file_version, sizeof(file_version)) &&
+                                    binary_format::read_all(file, &file_key, sizeof(file_key)) &&
+                                    binary_format::read_all(file, &format, sizeof(format)) &&
+                                    binary_format::read_all(file, &entry.width, sizeof(entry.width)) &&
+                                    binary_format::read_all(file, &entry.height, sizeof(entry.height)) &&
+                                    binary_format::read_all(file, &entry.mip_count, sizeof(entry.mip_count)) &&
+                                    binary_format::read_all(file, &entry.flags, sizeof(entry.flags));
+            valid = valid && file_magic == magic && file_version == version && file_key == key;
+            valid = valid && format < static_cast<uint32_t>(RHI_Format::Max) && entry.mip_count > 0 && entry.mip_count <= rhi_max_mip_count;
+
+            if (valid)
+            {
+                entry.format = static_cast<RHI_Format>(format);
+                entry.slices.resize(slice_count);
+                for (RHI_Texture_Slice& slice : entry.slices)
+                {
+                    slice.mips.resize(entry.mip_count);
+                    for (RHI_Texture_Mip& mip : slice.mips)
+                    {
+                        uint64_t size = 0;
+                        valid         = valid && binary_format::read_all(file, &size, sizeof(size));
+                        valid         = valid && size > 0 && size <= file_size - static_cast<uint64_t>(file.tellg());
+                        if (!valid)
+                            break;
+
+                        mip.bytes.resize(static_cast<size_t>(size));
+                        valid = binary_format::read_all(file, mip.bytes.data(), mip.bytes.size());
+                    }
+                }
+                valid = valid && static_cast<uint64_t>(file.tellg()) == file_size;
+            }
+
+            if (!valid)
+            {
+                SP_LOG_WARNING("Ignoring stale or malformed texture cache entry %s", file_path.c_str());
+                miss_count++;
+                return false;
+            }
+
+            hit_count++;
+            return true;
+        }
+
+        // writes to a temporary file first, so that an interrupted write never leaves a valid looking entry behind
+        void save(const uint64_t key, RHI_Texture* texture)
+        {
+            if (!FileSystem::Exists(directory))
+            {
+                FileSystem::CreateDirectory_(directory);
+            }
+
+            // textures are prepared on several threads at once, and identical content means an identical key
+            const string file_path      = get_file_path(key);
+            const string file_path_temp = file_path + "." + to_string(hash<thread::id>{}(this_thread::get_id())) + ".tmp";
+            {
+                ofstream file(file_path_temp, ios::binary | ios::trunc);
+                if (!file.is_open())
+                {
+                    SP_LOG_ERROR("Failed to open file for writing: %s", file_path_temp.c_str());
+                    return;
+                }
+
+                const uint32_t format    = static_cast<uint32_t>(texture->GetFormat());
+                const uint32_t width     = texture->GetWidth();
+                const uint32_t height    = texture->GetHeight();
+                const uint32_t mip_count = texture->GetMipCount();
+                const uint32_t flags     = texture->GetFlags() & stored_flags;
+                bool written             = binary_format::write_all(file, &magic, sizeof(magic)) &&
+                                           binary_format::write_all(file, &version, sizeof(version)) &&
+                                           binary_format::write_all(file, &key, sizeof(key)) &&
+                                           binary_format::write_all(file, &format, sizeof(format)) &&
+                                           binary_format::write_all(file, &width, sizeof(width)) &&
+                                           binary_format::write_all(file, &height, sizeof(height)) &&
+                                           binary_format::write_all(file, &mip_count, sizeof(mip_count)) &&
+                                           binary_format::write_all(file, &flags, sizeof(flags));
+
+                for (uint32_t array_index = 0; array_index < texture->GetDepth() && written; array_index++)
+                {
+                    for (uint32_t mip_index = 0; mip_index < mip_count && written; mip_index++)
+                    {
+                        const vector<byte>& bytes = texture->GetMip(array_index, mip_index).bytes;
+                        const uint64_t size       = bytes.size();
+                        written                   = binary_format::write_all(file, &size, sizeof(size)) && binary_format::write_all(file, bytes.data(), bytes.size());
+                    }
+                }
+
+                if (!written)
+                {
+                    SP_LOG_ERROR("Failed to write %s", file_path_temp.c_str());
+                    return;
+                }
+            }
+
+            if (FileSystem::Exists(file_path))
+            {
+                FileSystem::Delete(file_path);
+            }
+            FileSystem::Rename(file_path_temp, file_path);
+        }
     }
 
     RHI_Texture::RHI_Texture() : IResource(ResourceType::Texture)
@@ -262,13 +1155,30 @@ namespace spartan
 
     RHI_Texture::~RHI_Texture()
     {
+        if (m_stream)
+        {
+            TextureStreaming::Unregister(this);
+        }
+
         RHI_DestroyResource();
     }
 
+    const byte* RHI_Texture_Stream::GetMipData(const uint32_t array_index, const uint32_t mip_index) const
+    {
+        return reinterpret_cast<const byte*>(file->GetData() + offsets[array_index * mip_count + mip_index]);
+    }
+
     void spartan::RHI_Texture::SaveToFile(const string& file_path)
     {
+        // a streamed texture is saved from its file, which already holds the full chain
+        if (m_stream && m_stream->file_path == file_path)
+        {
+            SetResourceFilePath(file_path);
+            return;
+        }
+
         // require cpu nytes
-        if (m_slices.empty() || m_slices[0].mips.empty())
+        if (!m_stream && (m_slices.empty() || m_slices[0].mips.empty()))
         {
             SP_LOG_ERROR("SaveToFile failed for %s because no CPU-side bits are present. Use RHI_Texture_KeepData when preparing or add a readback path.", file_path.c_str());
             return;
@@ -277,18 +1187,44 @@ namespace spartan
         // require compressed native format
         if (!IsCompressedFormat(m_format))
         {
-            SP_LOG_ERROR("SaveToFile expects a compressed native format. Current format is not compressed.");
-            return;
+            SP_LOG_ERROR("SaveToFile expects a compressed native format. Current format is not compressed.");
+            return;
+        }
+
+        // full resolution description, residency only affects what's on the gpu
+        const uint32_t width     = m_stream ? m_stream->width : m_width;
+        const uint32_t height    = m_stream ? m_stream->height : m_height;
+        const uint32_t mip_count = m_stream ? m_stream->mip_count : m_mip_count;
+        auto get_mip = [this](const uint32_t array_index, const uint32_t mip_index) -> pair<const byte*, uint64_t>
+        {
+            if (m_stream)
+                return { m_stream->GetMipData(array_index, mip_index), m_stream->GetMipSize(array_index, mip_index) };
+
+            const RHI_Texture_Mip& mip = m_slices[array_index].mips[mip_index];
+            return { mip.bytes.data(), static_cast<uint64_t>(mip.bytes.size()) };
+        };
+
+        for (uint32_t array_index = 0; !m_stream && array_index < m_depth; array_index++)
+        {
+            if (array_index >= m_slices.size() || m_slices[array_index].mips.size() != m_mip_count)
+            {
+                SP_LOG_ERROR("SaveToFile mip count mismatch on slice %u", array_index);
+                return;
+            }
         }
     
-        binary_format::header hdr = {};
-        hdr.type                  = static_cast<uint32_t>(m_type);
-        hdr.format                = static_cast<uint32_t>(m_format);
-        hdr.width                 = m_width;
-        hdr.height                = m_height;
-        hdr.depth                 = m_depth;
-        hdr.mip_count             = m_mip_count;
-        hdr.flags                 = m_flags;
+        binary_format::header_v2 hdr = {};
+        hdr.magic                    = binary_format::magic;
+        hdr.version                  = binary_format::version;
+        hdr.type                     = static_cast<uint32_t>(m_type);
+        hdr.format                   = static_cast<uint32_t>(m_format);
+        hdr.width                    = width;
+        hdr.height                   = height;
+        hdr.depth                    = m_depth;
+        hdr.mip_count                = mip_count;
+        hdr.flags                    = m_flags;
+        hdr.alignment                = binary_format::alignment;
+        hdr.content_hash             = GetContentHash();
         memset(hdr.name, 0, sizeof(hdr.name));
         {
             string n = m_object_name.empty() ? FileSystem::GetFileNameFromFilePath(file_path) : m_object_name;
@@ -296,6 +1232,21 @@ namespace spartan
             copy_n(n.c_str(), count, hdr.name);
             hdr.name[count] = '\0';
         }
+
+        // lay out the mips, smallest first
+        vector<binary_format::table_entry> table(static_cast<size_t>(m_depth) * mip_count);
+        uint64_t offset = sizeof(hdr) + table.size() * sizeof(binary_format::table_entry);
+        for (int32_t mip_index = static_cast<int32_t>(mip_count) - 1; mip_index >= 0; mip_index--)
+        {
+            for (uint32_t array_index = 0; array_index < m_depth; array_index++)
+            {
+                binary_format::table_entry& entry = table[array_index * mip_count + mip_index];
+                offset                            = (offset + binary_format::alignment - 1) & ~static_cast<uint64_t>(binary_format::alignment - 1);
+                entry.offset                      = offset;
+                entry.size                        = get_mip(array_index, mip_index).second;
+                offset                           += entry.size;
+            }
+        }
     
         ofstream ofs(file_path, ios::binary);
         if (!ofs.is_open())
@@ -304,31 +1255,26 @@ namespace spartan
             return;
         }
     
-        if (!write_all(ofs, &hdr, sizeof(hdr)))
+        if (!binary_format::write_all(ofs, &hdr, sizeof(hdr)) || !binary_format::write_all(ofs, table.data(), table.size() * sizeof(binary_format::table_entry)))
         {
             SP_LOG_ERROR("SaveToFile failed to write header for %s", file_path.c_str());
             return;
         }
-    
-        // write layout: for each slice, for each mip, write uint64 size then bytes
-        for (uint32_t array_index = 0; array_index < m_depth; array_index++)
+
+        uint64_t position = sizeof(hdr) + table.size() * sizeof(binary_format::table_entry);
+        const array<char, binary_format::alignment> padding = {};
+        for (int32_t mip_index = static_cast<int32_t>(mip_count) - 1; mip_index >= 0; mip_index--)
         {
-            const RHI_Texture_Slice& slice = m_slices[array_index];
-            if (slice.mips.size() != m_mip_count)
-            {
-                SP_LOG_ERROR("SaveToFile mip count mismatch on slice %u", array_index);
-                return;
-            }
-    
-            for (uint32_t mip_index = 0; mip_index < m_mip_count; mip_index++)
+            for (uint32_t array_index = 0; array_index < m_depth; array_index++)
             {
-                const auto& mip = slice.mips[mip_index];
-                const uint64_t sz = static_cast<uint64_t>(mip.bytes.size());
-                if (!binary_format::write_all(ofs, &sz, sizeof(sz)) || !binary_format::write_all(ofs, mip.bytes.data(), mip.bytes.size()))
+                const binary_format::table_entry& entry = table[array_index * mip_count + mip_index];
+                const pair<const byte*, uint64_t> mip   = get_mip(array_index, mip_index);
+                if (!binary_format::write_all(ofs, padding.data(), static_cast<size_t>(entry.offset - position)) || !binary_format::write_all(ofs, mip.first, static_cast<size_t>(mip.second)))
                 {
-                    SP_LOG_ERROR("SaveToFile failed while writing slice %u mip %u", array_index, mip_index);
+                    SP_LOG_ERROR("SaveToFile failed while writing slice %u mip %d", array_index, mip_index);
                     return;
                 }
+                position = entry.offset + entry.size;
             }
         }
     
@@ -348,6 +1294,15 @@ namespace spartan
     {
         ProgressTracker::SetGlobalLoadingState(true);
         ClearData();
+        m_source_key          = 0;
+        m_source_cached_flags = 0;
+
+        if (m_stream)
+        {
+            TextureStreaming::Unregister(this);
+            m_stream       = nullptr;
+            m_resident_mip = 0;
+        }
 
         // load foreign format
         if (FileSystem::IsSupportedImageFile(file_path))
@@ -358,9 +1313,73 @@ namespace spartan
             m_object_name     = FileSystem::GetFileNameFromFilePath(file_path);
             m_resource_state  = ResourceState::LoadingFromDrive;
 
-            ImageImporter::Load(file_path, 0, this);
+            // the compressed output only depends on the file, so it's looked up before decoding it
+            texture_cache::entry cached;
+            m_source_key = (m_flags & RHI_Texture_Compress) ? texture_cache::get_source_key(file_path, compressonator::destination_format) : 0;
+            if (m_source_key != 0 && texture_cache::load(m_source_key, 1, cached))
+            {
+                m_format              = cached.format;
+                m_width               = cached.width;
+                m_height              = cached.height;
+                m_mip_count           = cached.mip_count;
+                m_flags               = (m_flags & ~texture_cache::stored_flags) | cached.flags;
+                m_viewport            = RHI_Viewport(0, 0, static_cast<float>(m_width), static_cast<float>(m_height));
+                m_channel_count       = rhi_to_format_channel_count(m_format);
+                m_bits_per_channel    = rhi_format_to_bits_per_channel(m_format);
+                m_slices              = move(cached.slices);
+                m_source_cached_flags = m_flags;
+            }
+            else
+            {
+                ImageImporter::Load(file_path, 0, this);
+            }
+        }
+        // load native, v2 files are mapped and only the mip tail is loaded, the rest is streamed in
+        else if (FileSystem::IsEngineTextureFile(file_path) && binary_format::is_v2(file_path))
+        {
+            shared_ptr<MappedFile> file           = make_shared<MappedFile>(file_path, false); // mips are read on demand
+            shared_ptr<RHI_Texture_Stream> stream = file->IsOpen() ? binary_format::open_stream(file, file_path) : nullptr;
+            if (!stream)
+            {
+                SP_LOG_ERROR("Failed to read native texture %s", file_path.c_str());
+                return;
+            }
+
+            // 3d textures and textures that fit in the tail are fully resident
+            const bool streamable = stream->type != RHI_Texture_Type::Type3D;
+            const uint32_t first  = streamable ? TextureStreaming::GetTailMip(stream->width, stream->height, stream->mip_count) : 0;
+
+            // initialise texture fields
+            m_type             = stream->type;
+            m_format           = stream->format;
+            m_width            = max(1u, stream->width >> first);
+            m_height           = max(1u, stream->height >> first);
+            m_depth            = stream->depth;
+            m_mip_count        = stream->mip_count - first;
+            m_flags            = stream->flags | RHI_Texture_Srv;
+            m_object_name      = stream->name;
+            m_viewport         = RHI_Viewport(0, 0, static_cast<float>(m_width), static_cast<float>(m_height));
+            m_channel_count    = rhi_to_format_channel_count(m_format);
+            m_bits_per_channel = rhi_format_to_bits_per_channel(m_format);
+            m_resident_mip     = first;
+            m_stream           = first > 0 ? stream : nullptr;
+
+            // copy the resident mips out of the mapping
+            m_slices.resize(m_depth);
+            for (uint32_t array_index = 0; array_index < m_depth; array_index++)
+            {
+                RHI_Texture_Slice& slice = m_slices[array_index];
+                slice.mips.resize(m_mip_count);
+                for (uint32_t mip_index = 0; mip_index < m_mip_count; mip_index++)
+                {
+                    const byte* data = stream->GetMipData(array_index, first + mip_index);
+                    slice.mips[mip_index].bytes.assign(data, data + stream->GetMipSize(array_index, first + mip_index));
+                }
+            }
+
+            SP_LOG_INFO("Loaded native texture %s, %u of %u mips resident", file_path.c_str(), m_mip_count, stream->mip_count);
         }
-        // load native compressed bytes
+        // load native compressed bytes (legacy layout, fully resident)
         else if (FileSystem::IsEngineTextureFile(file_path))
         {
             ifstream ifs(file_path, ios::binary);
@@ -435,10 +1454,33 @@ namespace spartan
         ProgressTracker::SetGlobalLoadingState(false);
     }
 
+    void RHI_Texture::DecodeSource()
+    {
+        // only before preparing, after that the data is what's on the gpu
+        if (m_source_cached_flags == 0 || m_resource_state != ResourceState::Max)
+            return;
+
+        // back to where LoadFromFile() is on a miss, keeping the flags that were set since
+        m_slices.clear();
+        m_content_hash        = 0;
+        m_width               = 0; // the importer rescales to preset dimensions
+        m_height              = 0;
+        m_mip_count           = 0;
+        m_format              = RHI_Format::Max;
+        m_flags              &= ~(RHI_Texture_Greyscale | RHI_Texture_Transparent);
+        m_source_cached_flags = 0;
+
+        ImageImporter::Load(GetResourceFilePath(), 0, this);
+        ComputeMemoryUsage();
+    }
+
     RHI_Texture_Mip& RHI_Texture::GetMip(const uint32_t array_index, const uint32_t mip_index)
     {
         static RHI_Texture_Mip empty;
 
+        // once higher mips are streamed in, mip 0 is on the gpu but the cpu side still starts at the tail
+        SP_ASSERT_MSG(!m_stream || array_index >= m_slices.size() || m_slices[array_index].mips.size() == m_mip_count, "The cpu side of a streamed texture only holds the mip tail, read from GetStream() instead");
+
         if (array_index >= m_slices.size())
             return empty;
 
@@ -466,6 +1508,7 @@ namespace spartan
         }
 
         RHI_Texture_Mip& mip = m_slices[0].mips.emplace_back();
+        m_content_hash       = 0;
         m_depth              = static_cast<uint32_t>(m_slices.size());
         m_mip_count          = static_cast<uint32_t>(m_slices[0].mips.size());
         int32_t mip_index    = static_cast<uint32_t>(m_slices[0].mips.size()) - 1;
@@ -528,73 +1571,189 @@ namespace spartan
     {
          m_slices.clear();
          m_slices.shrink_to_fit();
+         m_content_hash = 0;
+    }
+
+    uint64_t RHI_Texture::GetContentHash()
+    {
+        // the resident mips change with the camera, the content doesn't
+        if (m_stream)
+            return m_stream->content_hash;
+
+        // without cpu-side data, the gpu copy came from the source file, so that identifies the content
+        if (!HasData())
+        {
+            const string& file_path = GetResourceFilePath();
+            const uint64_t stamp    = file_path.empty() ? 0 : FileSystem::GetFileStamp(file_path);
+            if (stamp == 0)
+                return 0;
+
+            uint64_t hash = math::hash_combine(math::hash_bytes(file_path.data(), file_path.size()), stamp);
+            hash          = math::hash_combine(hash, static_cast<uint64_t>(m_format));
+            hash          = math::hash_combine(hash, static_cast<uint64_t>(m_flags));
+            return hash != 0 ? hash : 1;
+        }
+
+        if (m_content_hash == 0)
+        {
+            uint64_t hash = math::hash_combine(static_cast<uint64_t>(m_format), (static_cast<uint64_t>(m_width) << 32) | m_height);
+            hash          = math::hash_combine(hash, (static_cast<uint64_t>(m_depth) << 32) | m_mip_count);
+            hash          = math::hash_combine(hash, static_cast<uint64_t>(m_flags));
+            for (const RHI_Texture_Slice& slice : m_slices)
+            {
+                for (const RHI_Texture_Mip& mip : slice.mips)
+                {
+                    hash = math::hash_combine(hash, math::hash_bytes(mip.bytes.data(), mip.bytes.size()));
+                }
+            }
+
+            m_content_hash = hash != 0 ? hash : 1;
+        }
+
+        return m_content_hash;
+    }
+
+    shared_ptr<RHI_Texture> RHI_Texture::CreateFromStream(const RHI_Texture_Stream& stream, const uint32_t first_mip, const uint32_t flags)
+    {
+        SP_ASSERT(first_mip < stream.mip_count);
+
+        vector<RHI_Texture_Slice> slices(stream.depth);
+        for (uint32_t array_index = 0; array_index < stream.depth; array_index++)
+        {
+            slices[array_index].mips.resize(stream.mip_count - first_mip);
+            for (uint32_t mip_index = first_mip; mip_index < stream.mip_count; mip_index++)
+            {
+                const byte* data = stream.GetMipData(array_index, mip_index);
+                slices[array_index].mips[mip_index - first_mip].bytes.assign(data, data + stream.GetMipSize(array_index, mip_index));
+            }
+        }
+
+        // uploads on construction
+        shared_ptr<RHI_Texture> texture = make_shared<RHI_Texture>(
+            stream.type,
+            max(1u, stream.width >> first_mip),
+            max(1u, stream.height >> first_mip),
+            stream.depth,
+            stream.mip_count - first_mip,
+            stream.format,
+            (flags | RHI_Texture_Srv) & ~RHI_Texture_DontPrepareForGpu,
+            stream.name.c_str(),
+            move(slices)
+        );
+
+        // the mapped file is the cpu copy
+        texture->ClearData();
+
+        return texture;
+    }
+
+    void RHI_Texture::SwapResidency(RHI_Texture& texture, const uint32_t first_mip)
+    {
+        SP_ASSERT(m_stream != nullptr);
+
+        // the other texture ends up with the previous gpu resources and releases them through the deletion queue,
+        // the cpu side keeps only the mip tail, the rest is read from the mapped file when needed
+        swap(m_rhi_resource, texture.m_rhi_resource);
+        swap(m_rhi_srv,      texture.m_rhi_srv);
+        swap(m_rhi_srv_mips, texture.m_rhi_srv_mips);
+        swap(m_width,        texture.m_width);
+        swap(m_height,       texture.m_height);
+        swap(m_mip_count,    texture.m_mip_count);
+        swap(m_viewport,     texture.m_viewport);
+        m_resident_mip = first_mip;
+
+        ComputeMemoryUsage();
+        texture.ComputeMemoryUsage();
     }
 
     void RHI_Texture::PrepareForGpu()
     {
         SP_ASSERT_MSG(m_resource_state == ResourceState::Max, "Only unprepared textures can be prepared");
+
+        // cached output was made with the srgb and thumbnail flags of back then, if the owner has changed them since, decode again
+        if (m_source_cached_flags != 0 && ((m_source_cached_flags ^ m_flags) & texture_cache::derived_flags) != 0)
+        {
+            DecodeSource();
+        }
+
         m_resource_state = ResourceState::PreparingForGpu;
 
-        bool is_not_compressed   = !IsCompressedFormat();                      // the bistro world loads pre-compressed textures
-        bool is_material_texture = IsMaterialTexture();                        // render targets or textures which are written to in compute passes, don't need mip and compression
-        bool can_be_prepared     = !(m_flags & RHI_Texture_DontPrepareForGpu); // some textures delay preperation because the material packs their data in a custom way before preparing them
+        bool is_not_compressed   = !IsCompressedFormat();                              // the bistro world loads pre-compressed textures
+        bool is_material_texture = IsMaterialTexture();                                // render targets or textures which are written to in compute passes, don't need mip and compression
+        bool is_image_file       = FileSystem::IsSupportedImageFile(GetResourceFilePath()); // height maps, hdr environments and such, they get mips but no compression
+        bool can_be_prepared     = !(m_flags & RHI_Texture_DontPrepareForGpu);         // some textures delay preperation because the material packs their data in a custom way before preparing them
 
         if (can_be_prepared)
         { 
-            if (is_not_compressed && is_material_texture)
+            if (is_not_compressed && (is_material_texture || is_image_file))
             {
                 SP_ASSERT(!m_slices.empty());
                 SP_ASSERT(!m_slices.front().mips.empty());
 
-                // generate mip chain
-                uint32_t mip_count = mips::compute_count(m_width, m_height);
-                for (uint32_t mip_index = 1; mip_index < mip_count; mip_index++)
+                // compressed output is derived data, look it up by content before doing any work, unless
+                // it came from a file, in which case LoadFromFile() has already looked it up by the file
+                bool compress        = (m_flags & RHI_Texture_Compress) && is_material_texture;
+                bool keyed_by_source = m_source_key != 0;
+                uint64_t cache_key   = !compress ? 0 : (keyed_by_source ? m_source_key : texture_cache::get_key(this, compressonator::destination_format));
+                texture_cache::entry cached;
+                if (compress && !keyed_by_source && texture_cache::load(cache_key, static_cast<uint32_t>(m_slices.size()), cached))
                 {
-                    AllocateMip();
-
-                    mips::downsample_bilinear(
-                        m_slices[0].mips[mip_index - 1].bytes, // larger
-                        m_slices[0].mips[mip_index].bytes,     // smaller
-                        max(1u, m_width  >> (mip_index - 1)),  // larger width
-                        max(1u, m_height >> (mip_index - 1))   // larger height
-                    );
+                    m_format    = cached.format;
+                    m_width     = cached.width;
+                    m_height    = cached.height;
+                    m_mip_count = cached.mip_count;
+                    m_slices    = move(cached.slices);
                 }
-
-                // for thumbnails, find the appropriate mip level close to 128x128 and make it the only mip
-                if (m_flags & RHI_Texture_Thumbnail)
+                else
                 {
-                    uint32_t target_mip = 0;
-                    for (uint32_t i = 0; i < m_slices[0].mips.size(); i++)
+                    // generate mip chain for every slice, unless one was provided (3d textures would also need filtering across depth)
+                    mips::layout layout;
+                    if (m_type != RHI_Texture_Type::Type3D && m_slices[0].mips.size() == 1 && mips::get_layout(m_format, m_flags & RHI_Texture_Srgb, layout))
+                    {
+                        // kaiser for 8-bit color, box for high precision data where ringing would show (heights, hdr)
+                        mips::options options;
+                        options.filter_type             = layout.bytes_per_channel == 1 ? mips::filter::kaiser : mips::filter::box;
+                        options.preserve_alpha_coverage = IsSemiTransparent(); // treated as alpha tested, see Material::IsAlphaTested()
+
+                        m_mip_count = max(1u, mips::compute_count(m_width, m_height));
+                        mips::generate(m_slices, m_width, m_height, m_mip_count, layout, options);
+                    }
+
+                    // for thumbnails, find the appropriate mip level close to 128x128 and make it the only mip
+                    if (m_flags & RHI_Texture_Thumbnail)
                     {
-                        uint32_t mip_width  = max(1u, m_width >> i);
-                        uint32_t mip_height = max(1u, m_height >> i);
+                        uint32_t target_mip = 0;
+                        for (uint32_t i = 0; i < m_slices[0].mips.size(); i++)
+                        {
+                            uint32_t mip_width  = max(1u, m_width >> i);
+                            uint32_t mip_height = max(1u, m_height >> i);
                         
-                        if (mip_width <= 128 && mip_height <= 128)
+                            if (mip_width <= 128 && mip_height <= 128)
+                            {
+                                target_mip = i;
+                                break;
+                            }
+                        }
+
+                        // move the target mip to the top
+                        if (target_mip > 0)
                         {
-                            target_mip = i;
-                            break;
+                            m_slices[0].mips[0] = move(m_slices[0].mips[target_mip]);
+                            m_width             = max(1u, m_width >> target_mip);
+                            m_height            = max(1u, m_height >> target_mip);
                         }
+                    
+                        // clear all other mips
+                        m_slices[0].mips.resize(1);
+                        m_mip_count = static_cast<uint32_t>(m_slices[0].mips.size());
                     }
 
-                    // move the target mip to the top
-                    if (target_mip > 0)
+                    // compress
+                    if (compress)
                     {
-                        m_slices[0].mips[0] = move(m_slices[0].mips[target_mip]);
-                        m_width             = max(1u, m_width >> target_mip);
-                        m_height            = max(1u, m_height >> target_mip);
+                        compressonator::compress(this);
+                        texture_cache::save(cache_key, this);
                     }
-                    
-                    // clear all other mips
-                    m_slices[0].mips.resize(1);
-                    m_mip_count = static_cast<uint32_t>(m_slices[0].mips.size());
-                }
-
-                // compress
-                bool compress       = m_flags & RHI_Texture_Compress;
-                bool not_compressed = !IsCompressedFormat();
-                if (compress && not_compressed)
-                {
-                    compressonator::compress(this);
                 }
             }
             
@@ -603,10 +1762,17 @@ namespace spartan
         }
 
         ComputeMemoryUsage();
+        m_content_hash        = 0; // mips and compression have changed the data
+        m_source_cached_flags = 0;
 
         if (m_rhi_resource)
         {
             m_resource_state = ResourceState::PreparedForGpu;
+
+            if (m_stream)
+            {
+                TextureStreaming::Register(this);
+            }
         }
         else
         {
@@ -665,4 +1831,474 @@ namespace spartan
             return static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * static_cast<size_t>(channel_count) * static_cast<size_t>(bits_per_channel / 8);
         }
     }
+    void RHI_Texture::BenchmarkCompression(const uint32_t size)
+    {
+        // unique content per run, so the first load is guaranteed to miss the cache
+        const uint64_t seed = static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+        vector<RHI_Texture_Slice> data(1);
+        data[0].mips.emplace_back().bytes.resize(static_cast<size_t>(size) * size * 4);
+        vector<byte>& bytes = data[0].mips[0].bytes;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const uint64_t noise = math::hash_combine(seed, (static_cast<uint64_t>(y) << 32) | x);
+                byte* texel          = bytes.data() + (static_cast<size_t>(y) * size + x) * 4;
+                texel[0]             = static_cast<byte>((x * 255) / size);
+                texel[1]             = static_cast<byte>((y * 255) / size);
+                texel[2]             = static_cast<byte>(noise & 0x3F);
+                texel[3]             = static_cast<byte>(255);
+            }
+        }
+
+        auto load = [size](const vector<RHI_Texture_Slice>& data, uint32_t& hits, double& duration_ms)
+        {
+            const uint32_t hit_count = texture_cache::hit_count;
+            Stopwatch timer;
+            RHI_Texture texture(RHI_Texture_Type::Type2D, size, size, 1, 1, RHI_Format::R8G8B8A8_Unorm, RHI_Texture_Srv | RHI_Texture_Compress, "benchmark_compression", data);
+            duration_ms = timer.GetElapsedTimeMs();
+            hits        = texture_cache::hit_count - hit_count;
+        };
+
+        // cold: mips and compression, warm: cache read, invalidated: one texel changed, so the key has to change
+        uint32_t hits_cold        = 0;
+        uint32_t hits_warm        = 0;
+        uint32_t hits_invalidated = 0;
+        double ms_cold            = 0.0;
+        double ms_warm            = 0.0;
+        double ms_invalidated     = 0.0;
+        load(data, hits_cold, ms_cold);
+        load(data, hits_warm, ms_warm);
+        bytes[0] = static_cast<byte>(to_integer<uint8_t>(bytes[0]) ^ 1);
+        load(data, hits_invalidated, ms_invalidated);
+
+        SP_LOG_INFO("Texture compression %ux%u: cold %.1f ms, warm %.1f ms (%.1fx), invalidated %.1f ms",
+            size, size, ms_cold, ms_warm, ms_cold / max(ms_warm, 1e-3), ms_invalidated);
+
+        if (hits_cold != 0 || hits_warm != 1 || hits_invalidated != 0)
+        {
+            SP_LOG_ERROR("Texture cache returned unexpected results: cold hits %u (expected 0), warm hits %u (expected 1), invalidated hits %u (expected 0)",
+                hits_cold, hits_warm, hits_invalidated);
+        }
+    }
+
+    bool RHI_Texture::TestMips()
+    {
+        // non square, with slices that differ, so a chain that only covers the first slice or mixes them up shows
+        const uint32_t width       = 64;
+        const uint32_t height      = 32;
+        const uint32_t slice_count = 3;
+        const uint32_t mip_count   = mips::compute_count(width, height);
+
+        bool passed = true;
+        auto fail = [&passed](const char* name, const uint32_t slice, const uint32_t mip, const float error)
+        {
+            SP_LOG_ERROR("Mips %s: slice %u, mip %u is off by %g", name, slice, mip, error);
+            passed = false;
+        };
+
+        auto create_slices = [&](const uint32_t texel_size, const function<void(byte*, uint32_t, uint32_t, uint32_t)>& write_texel)
+        {
+            vector<RHI_Texture_Slice> slices(slice_count);
+            for (uint32_t slice = 0; slice < slice_count; slice++)
+            {
+                vector<byte>& bytes = slices[slice].mips.emplace_back().bytes;
+                bytes.resize(static_cast<size_t>(width) * height * texel_size);
+                for (uint32_t y = 0; y < height; y++)
+                {
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        write_texel(bytes.data() + (static_cast<size_t>(y) * width + x) * texel_size, slice, x, y);
+                    }
+                }
+            }
+
+            return slices;
+        };
+
+        auto has_chain = [&](const vector<RHI_Texture_Slice>& slices, const uint32_t texel_size)
+        {
+            for (uint32_t slice = 0; slice < slice_count; slice++)
+            {
+                if (slices[slice].mips.size() != mip_count)
+                    return false;
+
+                for (uint32_t mip = 0; mip < mip_count; mip++)
+                {
+                    if (slices[slice].mips[mip].bytes.size() != static_cast<size_t>(max(1u, width >> mip)) * max(1u, height >> mip) * texel_size)
+                        return false;
+                }
+            }
+
+            return true;
+        };
+
+        // 1. box filtered rgba8 and r32 float against a 2x2 average of the level above, for every slice
+        {
+            const uint64_t seed = 11;
+            vector<RHI_Texture_Slice> slices_unorm = create_slices(4, [seed](byte* texel, uint32_t slice, uint32_t x, uint32_t y)
+            {
+                const uint64_t noise = math::hash_combine(seed, (static_cast<uint64_t>(slice) << 48) | (static_cast<uint64_t>(y) << 24) | x);
+                memcpy(texel, &noise, 4);
+            });
+            vector<RHI_Texture_Slice> slices_float = create_slices(4, [seed](byte* texel, uint32_t slice, uint32_t x, uint32_t y)
+            {
+                const uint64_t noise = math::hash_combine(seed + 1, (static_cast<uint64_t>(slice) << 48) | (static_cast<uint64_t>(y) << 24) | x);
+                const float value    = static_cast<float>(noise & 0xFFFF) / 65535.0f * 100.0f - 50.0f;
+                memcpy(texel, &value, sizeof(float));
+            });
+
+            mips::layout layout_unorm;
+            mips::layout layout_float;
+            mips::get_layout(RHI_Format::R8G8B8A8_Unorm, false, layout_unorm);
+            mips::get_layout(RHI_Format::R32_Float, false, layout_float);
+            mips::generate(slices_unorm, width, height, mip_count, layout_unorm, mips::options());
+            mips::generate(slices_float, width, height, mip_count, layout_float, mips::options());
+            if (!has_chain(slices_unorm, 4) || !has_chain(slices_float, 4))
+            {
+                SP_LOG_ERROR("Mips: not every slice has a complete chain");
+                return false;
+            }
+
+            for (uint32_t slice = 0; slice < slice_count; slice++)
+            {
+                for (uint32_t mip = 1; mip < mip_count; mip++)
+                {
+                    const uint32_t source_width = max(1u, width >> (mip - 1));
+                    const uint32_t mip_width    = max(1u, width >> mip);
+                    const uint32_t mip_height   = max(1u, height >> mip);
+                    const uint8_t* source_unorm = reinterpret_cast<const uint8_t*>(slices_unorm[slice].mips[mip - 1].bytes.data());
+                    const uint8_t* mip_unorm    = reinterpret_cast<const uint8_t*>(slices_unorm[slice].mips[mip].bytes.data());
+                    const float* source_float   = reinterpret_cast<const float*>(slices_float[slice].mips[mip - 1].bytes.data());
+                    const float* mip_float      = reinterpret_cast<const float*>(slices_float[slice].mips[mip].bytes.data());
+
+                    float error_unorm = 0.0f;
+                    float error_float = 0.0f;
+                    for (uint32_t y = 0; y < mip_height; y++)
+                    {
+                        for (uint32_t x = 0; x < mip_width; x++)
+                        {
+                            const uint32_t s00 = (y * 2) * source_width + x * 2;
+                            const uint32_t s10 = s00 + 1;
+                            const uint32_t s01 = s00 + source_width;
+                            const uint32_t s11 = s01 + 1;
+                            for (uint32_t channel = 0; channel < 4; channel++)
+                            {
+                                const float average = (source_unorm[s00 * 4 + channel] + source_unorm[s10 * 4 + channel] + source_unorm[s01 * 4 + channel] + source_unorm[s11 * 4 + channel]) * 0.25f;
+                                error_unorm         = max(error_unorm, abs(average - static_cast<float>(mip_unorm[(y * mip_width + x) * 4 + channel])));
+                            }
+
+                            const float average = (source_float[s00] + source_float[s10] + source_float[s01] + source_float[s11]) * 0.25f;
+                            error_float         = max(error_float, abs(average - mip_float[y * mip_width + x]));
+                        }
+                    }
+
+                    // half a step of rounding, plus some slack for the order of the additions
+                    if (error_unorm > 0.5f + 1e-3f)
+                    {
+                        fail("box rgba8", slice, mip, error_unorm);
+                    }
+
+                    if (error_float > 1e-4f)
+                    {
+                        fail("box r32 float", slice, mip, error_float);
+                    }
+                }
+            }
+        }
+
+        // 2. srgb, a black and white checkerboard averages to 50% linear light (188), not to 50% of the encoded value (128)
+        //    while alpha, which is always linear, averages to 128, the kaiser filter keeps a flat color flat, edges included
+        {
+            vector<RHI_Texture_Slice> slices_checker = create_slices(4, [](byte* texel, uint32_t, uint32_t x, uint32_t y)
+            {
+                const uint8_t value = ((x + y) & 1) ? 255 : 0;
+                texel[0] = texel[1] = texel[2] = texel[3] = static_cast<byte>(value);
+            });
+            vector<RHI_Texture_Slice> slices_flat = create_slices(4, [](byte* texel, uint32_t slice, uint32_t, uint32_t)
+            {
+                texel[0] = static_cast<byte>(40 + slice * 70);
+                texel[1] = static_cast<byte>(90);
+                texel[2] = static_cast<byte>(200);
+                texel[3] = static_cast<byte>(255);
+            });
+
+            mips::layout layout;
+            mips::get_layout(RHI_Format::R8G8B8A8_Unorm, true, layout);
+            mips::options options_kaiser;
+            options_kaiser.filter_type = mips::filter::kaiser;
+            mips::generate(slices_checker, width, height, mip_count, layout, mips::options());
+            mips::generate(slices_flat, width, height, mip_count, layout, options_kaiser);
+
+            for (uint32_t slice = 0; slice < slice_count; slice++)
+            {
+                for (uint32_t mip = 1; mip < mip_count; mip++)
+                {
+                    const vector<byte>& checker = slices_checker[slice].mips[mip].bytes;
+                    const vector<byte>& flat    = slices_flat[slice].mips[mip].bytes;
+                    const vector<byte>& flat_0  = slices_flat[slice].mips[0].bytes;
+
+                    float error_checker = 0.0f;
+                    float error_flat    = 0.0f;
+                    for (size_t i = 0; i < checker.size(); i++)
+                    {
+                        const float expected = (i % 4 == 3) ? 127.5f : 188.0f;
+                        error_checker        = max(error_checker, abs(static_cast<float>(to_integer<uint8_t>(checker[i])) - expected));
+                        error_flat           = max(error_flat, abs(static_cast<float>(to_integer<uint8_t>(flat[i])) - static_cast<float>(to_integer<uint8_t>(flat_0[i % 4]))));
+                    }
+
+                    if (error_checker > 1.0f)
+                    {
+                        fail("srgb checkerboard", slice, mip, error_checker);
+                    }
+
+                    if (error_flat > 1.0f)
+                    {
+                        fail("kaiser flat color", slice, mip, error_flat);
+                    }
+                }
+            }
+        }
+
+        // 3. alpha tested textures keep the coverage of the first mip
+        {
+            vector<RHI_Texture_Slice> slices = create_slices(4, [](byte* texel, uint32_t slice, uint32_t x, uint32_t y)
+            {
+                // thin vertical blades, the kind of texture that disappears in the distance
+                const float blade = 0.5f + 0.5f * cos(static_cast<float>(x + slice) * 1.3f);
+                texel[0] = texel[1] = texel[2] = static_cast<byte>(128);
+                texel[3] = static_cast<byte>(static_cast<uint8_t>(blade * blade * blade * 255.0f * (1.0f - static_cast<float>(y) / (2.0f * height))));
+            });
+
+            mips::layout layout;
+            mips::get_layout(RHI_Format::R8G8B8A8_Unorm, true, layout);
+            mips::options options;
+            options.filter_type             = mips::filter::kaiser;
+            options.preserve_alpha_coverage = true;
+            mips::generate(slices, width, height, mip_count, layout, options);
+
+            for (uint32_t slice = 0; slice < slice_count; slice++)
+            {
+                const uint32_t texel_count = width * height;
+                const float coverage       = mips::get_alpha_coverage(mips::get_alpha_histogram(slices[slice].mips[0].bytes, texel_count, layout), texel_count, 1.0f);
+                for (uint32_t mip = 1; mip < mip_count; mip++)
+                {
+                    // a handful of texels can't match a fraction closely
+                    const uint32_t mip_texel_count = max(1u, width >> mip) * max(1u, height >> mip);
+                    if (mip_texel_count < 64)
+                        break;
+
+                    const float coverage_mip = mips::get_alpha_coverage(mips::get_alpha_histogram(slices[slice].mips[mip].bytes, mip_texel_count, layout), mip_texel_count, 1.0f);
+                    if (abs(coverage_mip - coverage) > 0.05f)
+                    {
+                        fail("alpha coverage", slice, mip, coverage_mip - coverage);
+                    }
+                }
+            }
+        }
+
+        return passed;
+    }
+
+    bool RHI_Texture::TestTextureCache()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const uint64_t actual, const uint64_t expected)
+        {
+            if (actual != expected)
+            {
+                SP_LOG_ERROR("Texture cache %s: got %llu, expected %llu", name, static_cast<unsigned long long>(actual), static_cast<unsigned long long>(expected));
+                passed = false;
+            }
+        };
+
+        if (!FileSystem::Exists(texture_cache::directory))
+        {
+            FileSystem::CreateDirectory_(texture_cache::directory);
+        }
+
+        // an uncompressed 32-bit tga, opaque and in color, so it's compressed like a material texture
+        const string file_path = string(texture_cache::directory) + "/test_source.tga";
+        auto write_source = [&file_path](const uint16_t width, const uint16_t height)
+        {
+            uint8_t header[18] = {};
+            header[2]          = 2; // uncompressed true color
+            header[12]         = static_cast<uint8_t>(width & 0xFF);
+            header[13]         = static_cast<uint8_t>(width >> 8);
+            header[14]         = static_cast<uint8_t>(height & 0xFF);
+            header[15]         = static_cast<uint8_t>(height >> 8);
+            header[16]         = 32;
+            header[17]         = 0x28; // 8 alpha bits, top left origin
+
+            vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+            for (uint32_t y = 0; y < height; y++)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    uint8_t* texel = pixels.data() + (static_cast<size_t>(y) * width + x) * 4; // bgra
+                    texel[0]       = static_cast<uint8_t>((x ^ y) * 4);
+                    texel[1]       = static_cast<uint8_t>(y * 4);
+                    texel[2]       = static_cast<uint8_t>(x * 4);
+                    texel[3]       = 255;
+                }
+            }
+
+            ofstream file(file_path, ios::binary | ios::trunc);
+            file.write(reinterpret_cast<const char*>(header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+        };
+
+        // loads the way materials do, a hit is already compressed before it's prepared, so the importer never ran
+        struct load_result
+        {
+            uint32_t hits           = 0;
+            bool compressed_on_load = false;
+            uint32_t width          = 0;
+            uint32_t height         = 0;
+            uint64_t key            = 0;
+        };
+        vector<uint64_t> keys;
+        auto load = [&file_path, &keys]()
+        {
+            const uint32_t hit_count = texture_cache::hit_count;
+
+            RHI_Texture texture;
+            texture.SetFlags(RHI_Texture_Srv | RHI_Texture_Compress | RHI_Texture_DontPrepareForGpu);
+            texture.LoadFromFile(file_path);
+
+            load_result result;
+            result.compressed_on_load = texture.IsCompressedFormat();
+            result.key                = texture.m_source_key;
+            texture.SetFlag(RHI_Texture_DontPrepareForGpu, false);
+            texture.PrepareForGpu();
+            result.hits   = texture_cache::hit_count - hit_count;
+            result.width  = texture.GetWidth();
+            result.height = texture.GetHeight();
+
+            keys.push_back(result.key);
+            return result;
+        };
+
+        // cold, then warm
+        write_source(64, 64);
+        const load_result cold = load();
+        const load_result warm = load();
+        expect("cold hits", cold.hits, 0);
+        expect("cold compressed on load", cold.compressed_on_load, false);
+        expect("cold entry written", FileSystem::Exists(texture_cache::get_file_path(cold.key)), true);
+        expect("warm hits", warm.hits, 1);
+        expect("warm compressed on load", warm.compressed_on_load, true);
+        expect("warm key", warm.key, cold.key);
+        expect("warm width", warm.width, 64);
+        expect("warm height", warm.height, 64);
+
+        // a different size changes the stamp, a stale entry must never be used
+        write_source(64, 32);
+        const load_result resized = load();
+        expect("resized hits", resized.hits, 0);
+        expect("resized compressed on load", resized.compressed_on_load, false);
+        expect("resized key changed", resized.key != cold.key, true);
+        expect("resized height", resized.height, 32);
+
+        // same size, only the write time moves, as when a file is saved over with other pixels
+        error_code ec;
+        filesystem::last_write_time(file_path, filesystem::last_write_time(file_path, ec) + chrono::seconds(2), ec);
+        const load_result touched      = load();
+        const load_result touched_warm = load();
+        expect("touched hits", touched.hits, 0);
+        expect("touched key changed", touched.key != resized.key, true);
+        expect("touched warm hits", touched_warm.hits, 1);
+
+        FileSystem::Delete(file_path);
+        for (const uint64_t key : keys)
+        {
+            const string entry_path = texture_cache::get_file_path(key);
+            if (key != 0 && FileSystem::Exists(entry_path))
+            {
+                FileSystem::Delete(entry_path);
+            }
+        }
+
+        return passed;
+    }
+
+    bool RHI_Texture::TestNativeFormat()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Native texture format %s failed", name);
+                passed = false;
+            }
+        };
+
+        // two slices of made up bc7 blocks, which differ per slice and mip so that a mixed up table shows
+        const uint32_t size        = 1024;
+        const uint32_t slice_count = 2;
+        const uint32_t mip_count   = mips::compute_count(size, size);
+        vector<RHI_Texture_Slice> slices(slice_count);
+        for (uint32_t slice = 0; slice < slice_count; slice++)
+        {
+            for (uint32_t mip = 0; mip < mip_count; mip++)
+            {
+                const uint32_t blocks = max(1u, (max(1u, size >> mip) + 3) / 4);
+                vector<byte>& bytes   = slices[slice].mips.emplace_back().bytes;
+                bytes.resize(static_cast<size_t>(blocks) * blocks * 16);
+                for (size_t i = 0; i < bytes.size(); i++)
+                {
+                    bytes[i] = static_cast<byte>((i * 7 + slice * 13 + mip) & 0xFF);
+                }
+            }
+        }
+
+        // written without a gpu resource, the cpu side is all that's saved
+        const string file_path           = "test_native_format" + string(EXTENSION_TEXTURE);
+        const string file_path_truncated = "test_native_format_truncated" + string(EXTENSION_TEXTURE);
+        RHI_Texture texture(RHI_Texture_Type::Type2DArray, size, size, slice_count, mip_count, RHI_Format::BC7_Unorm, RHI_Texture_Srv | RHI_Texture_DontPrepareForGpu, "test_native_format", slices);
+        texture.SaveToFile(file_path);
+        expect("header", binary_format::is_v2(file_path));
+
+        {
+            shared_ptr<MappedFile> file           = make_shared<MappedFile>(file_path, false);
+            shared_ptr<RHI_Texture_Stream> stream = file->IsOpen() ? binary_format::open_stream(file, file_path) : nullptr;
+            expect("open", stream != nullptr);
+            if (stream)
+            {
+                expect("description", stream->width == size && stream->height == size && stream->depth == slice_count && stream->mip_count == mip_count && stream->format == RHI_Format::BC7_Unorm);
+                expect("name", stream->name == "test_native_format");
+                expect("content hash", stream->content_hash == texture.GetContentHash());
+                expect("smallest mips first", stream->offsets[mip_count - 1] < stream->offsets[0]);
+
+                bool aligned = true;
+                bool equal   = true;
+                for (uint32_t slice = 0; slice < slice_count; slice++)
+                {
+                    for (uint32_t mip = 0; mip < mip_count; mip++)
+                    {
+                        const vector<byte>& bytes = slices[slice].mips[mip].bytes;
+                        aligned                   = aligned && (stream->offsets[slice * mip_count + mip] % binary_format::alignment) == 0;
+                        equal                     = equal && stream->GetMipSize(slice, mip) == bytes.size() && memcmp(stream->GetMipData(slice, mip), bytes.data(), bytes.size()) == 0;
+                    }
+                }
+                expect("alignment", aligned);
+                expect("round trip", equal);
+
+                // a file cut short, as by an interrupted copy, must not be mapped past its end
+                ofstream file_truncated(file_path_truncated, ios::binary | ios::trunc);
+                file_truncated.write(reinterpret_cast<const char*>(file->GetData()), static_cast<streamsize>(file->GetSize() - 100));
+            }
+        }
+
+        {
+            shared_ptr<MappedFile> file = make_shared<MappedFile>(file_path_truncated, false);
+            expect("truncation", file->IsOpen() && binary_format::open_stream(file, file_path_truncated) == nullptr);
+        }
+
+        FileSystem::Delete(file_path);
+        FileSystem::Delete(file_path_truncated);
+
+        return passed;
+    }
 }
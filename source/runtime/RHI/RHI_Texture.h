@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES =====================
 #include <array>
+#include <memory>
 #include "RHI_Viewport.h"
 #include "RHI_Definitions.h"
 #include "../Resource/IResource.h"
@@ -67,6 +68,29 @@ namespace spartan
         uint32_t GetMipCount() { return static_cast<uint32_t>(mips.size()); }
     };
 
+    class MappedFile;
+
+    // the full mip chain of a native texture, it stays in a mapped file and mips are copied out of it as they become resident
+    struct RHI_Texture_Stream
+    {
+        std::shared_ptr<MappedFile> file;
+        std::vector<uint64_t> offsets; // per slice, per mip
+        std::vector<uint64_t> sizes;   // per slice, per mip
+        RHI_Texture_Type type  = RHI_Texture_Type::Max;
+        RHI_Format format      = RHI_Format::Max;
+        uint32_t width         = 0;
+        uint32_t height        = 0;
+        uint32_t depth         = 0;
+        uint32_t mip_count     = 0;
+        uint32_t flags         = 0;
+        uint64_t content_hash  = 0;
+        std::string name;
+        std::string file_path;
+
+        const std::byte* GetMipData(const uint32_t array_index, const uint32_t mip_index) const;
+        uint64_t GetMipSize(const uint32_t array_index, const uint32_t mip_index) const { return sizes[array_index * mip_count + mip_index]; }
+    };
+
     class RHI_Texture : public IResource
     {
     public:
@@ -88,6 +112,7 @@ namespace spartan
         // iresource
         void SaveToFile(const std::string& file_path) override;
         void LoadFromFile(const std::string& file_path) override;
+        uint64_t GetContentHash() override;
 
         uint32_t GetWidth() const           { return m_width; }
         void SetWidth(const uint32_t width) { m_width = width; }
@@ -112,13 +137,30 @@ namespace spartan
         void ClearData();
         void PrepareForGpu();
         static size_t CalculateMipSize(uint32_t width, uint32_t height, uint32_t depth, RHI_Format format, uint32_t bits_per_channel, uint32_t channel_count);
+        static void BenchmarkCompression(uint32_t size = 2048);
+        static bool TestMips();         // mip chains of every slice against reference downsamples, srgb, filter normalization and alpha coverage
+        static bool TestTextureCache(); // an image file hits the cache without being decoded, and misses once it changes
+        static bool TestNativeFormat(); // native files round trip through a mapping with aligned mips, truncated ones are rejected
+
+        // image files with the compress flag can load straight from the texture cache, already compressed,
+        // code that needs their pixels decodes them again, and code that changes the pixels detaches them from the file
+        bool IsCachedFromSource() const { return m_source_cached_flags != 0; }
+        void DecodeSource();
+        void DetachFromSource()         { m_source_key = 0; m_content_hash = 0; }
+
+        // streaming, only for native textures, mips are indexed from the full resolution one
+        bool IsStreamed() const                                      { return m_stream != nullptr; }
+        const std::shared_ptr<RHI_Texture_Stream>& GetStream() const { return m_stream; }
+        uint32_t GetResidentMip() const                              { return m_resident_mip; }
+        static std::shared_ptr<RHI_Texture> CreateFromStream(const RHI_Texture_Stream& stream, const uint32_t first_mip, const uint32_t flags);
+        void SwapResidency(RHI_Texture& texture, const uint32_t first_mip);
 
         // data
         uint32_t GetMipCount() const    { return m_mip_count; }
         uint32_t GetDepth() const       { return m_depth; }
         uint32_t GetArrayLength() const { return (m_type == RHI_Texture_Type::Type3D) ? 1 : m_depth; }
         bool HasData() const            { return !m_slices.empty() && !m_slices[0].mips.empty() && !m_slices[0].mips[0].bytes.empty(); };
-        RHI_Texture_Mip& GetMip(const uint32_t array_index, const uint32_t mip_index);
+        RHI_Texture_Mip& GetMip(const uint32_t array_index, const uint32_t mip_index); // a streamed texture only has its tail here, the full chain is in GetStream()
         RHI_Texture_Slice& GetSlice(const uint32_t array_index);
         void AllocateMip();
 
@@ -190,5 +232,15 @@ namespace spartan
 
     private:
         void ComputeMemoryUsage();
+
+        uint64_t m_content_hash = 0; // cached, reset whenever the cpu-side data changes
+
+        // texture cache, the key of the source file and the flags the cached data was made with (0 once decoded or prepared)
+        uint64_t m_source_key          = 0;
+        uint32_t m_source_cached_flags = 0;
+
+        // streaming, width, height and mip count describe what's on the gpu, the slices only hold the mip tail
+        std::shared_ptr<RHI_Texture_Stream> m_stream;
+        uint32_t m_resident_mip = 0;
     };
 }
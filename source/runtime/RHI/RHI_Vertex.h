@@ -128,9 +128,31 @@ namespace spartan
         float tan[3] = { 0, 0, 0 };
     };
 
+    // what RHI_Vertex_PosTexNorTan is packed into when uploaded to the gpu (24 bytes instead of 44), positions stay
+    // full precision so that no per-draw bounds are needed and ray tracing can build from the same buffer
+    struct RHI_Vertex_PosTexNorTan_Gpu
+    {
+        float pos[3]       = { 0, 0, 0 };
+        uint16_t tex[2]    = { 0, 0 };       // half floats
+        int16_t nor_tan[4] = { 0, 0, 0, 0 }; // snorm16 octahedral, normal in xy, tangent in zw
+    };
+
+    // compact equivalent of RHI_Vertex_PosTexNorTan (20 bytes instead of 44), a storage format for .mesh files,
+    // vertices are expanded to RHI_Vertex_PosTexNorTan on load and packed to RHI_Vertex_PosTexNorTan_Gpu on upload
+    struct RHI_Vertex_PosTexNorTan_Quantized
+    {
+        uint16_t pos[4] = { 0, 0, 0, 0 }; // unorm16 within the bounding box of the lod, w is the tangent handedness (0 = -1, 1 = +1)
+        uint16_t tex[2] = { 0, 0 };       // half floats
+        int16_t nor[2]  = { 0, 0 };       // snorm16 octahedral
+        int16_t tan[2]  = { 0, 0 };       // snorm16 octahedral
+    };
+
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_Pos);
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosTex);
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosCol);
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_Pos2dTexCol8);
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosTexNorTan);
+    SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosTexNorTan_Gpu);
+    SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosTexNorTan_Quantized);
+    static_assert(sizeof(RHI_Vertex_PosTexNorTan_Gpu) == 24);
 }
@@ -37,6 +37,66 @@ namespace
     PFN_vkCreateAccelerationStructureKHR           as_create             = nullptr;
     PFN_vkCmdBuildAccelerationStructuresKHR        as_build              = nullptr;
     PFN_vkGetAccelerationStructureDeviceAddressKHR as_get_device_address = nullptr;
+
+    vector<VkAccelerationStructureGeometryKHR> to_vulkan_geometries(const vector<spartan::RHI_AccelerationStructureGeometry>& geometries)
+    {
+        vector<VkAccelerationStructureGeometryKHR> vk_geometries;
+        vk_geometries.reserve(geometries.size());
+
+        for (const spartan::RHI_AccelerationStructureGeometry& geo : geometries)
+        {
+            VkAccelerationStructureGeometryTrianglesDataKHR triangles_data = {};
+            triangles_data.sType                                           = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+            triangles_data.vertexFormat                                    = vulkan_format[static_cast<uint32_t>(geo.vertex_format)];
+            triangles_data.vertexData.deviceAddress                        = geo.vertex_buffer_address;
+            triangles_data.vertexStride                                    = geo.vertex_stride;
+            triangles_data.maxVertex                                       = geo.max_vertex;
+            triangles_data.indexType                                       = geo.index_format == spartan::RHI_Format::R32_Uint ? VK_INDEX_TYPE_UINT32 : (geo.index_format == spartan::RHI_Format::R16_Uint ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_NONE_KHR);
+            triangles_data.indexData.deviceAddress                         = geo.index_buffer_address;
+            triangles_data.transformData.deviceAddress                     = 0;
+
+            VkAccelerationStructureGeometryKHR geometry = {};
+            geometry.sType                              = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+            geometry.flags                              = geo.transparent ? 0 : VK_GEOMETRY_OPAQUE_BIT_KHR;
+            geometry.geometryType                       = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+            geometry.geometry.triangles                 = triangles_data;
+
+            vk_geometries.emplace_back(geometry);
+        }
+
+        return vk_geometries;
+    }
+
+    // records a bottom level build (or update), followed by a barrier so that it completes before it's used
+    void record_bottom_level_build(spartan::RHI_CommandList* cmd_list, const VkAccelerationStructureBuildGeometryInfoKHR& build_info, const vector<uint32_t>& primitive_counts)
+    {
+        vector<VkAccelerationStructureBuildRangeInfoKHR> range_infos(primitive_counts.size());
+
+        for (uint32_t i = 0; i < static_cast<uint32_t>(primitive_counts.size()); ++i)
+        {
+            range_infos[i].primitiveCount  = primitive_counts[i];
+            range_infos[i].primitiveOffset = 0;
+            range_infos[i].firstVertex     = 0;
+            range_infos[i].transformOffset = 0;
+        }
+
+        vector<VkAccelerationStructureBuildRangeInfoKHR*> p_range_infos;
+
+        for (auto& range : range_infos) { p_range_infos.push_back(&range); }
+
+        as_build(static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()), 1, &build_info, p_range_infos.data());
+
+        // barrier: ensure build completes before use
+        VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        barrier.srcAccessMask   = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+        barrier.dstAccessMask   = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+            static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()),
+            VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+            VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+            0, 1, &barrier, 0, nullptr, 0, nullptr
+        );
+    }
 }
 
 namespace spartan
@@ -89,10 +149,11 @@ namespace spartan
             m_instance_buffer_size = 0;
         }
 
-        m_size = 0;
+        m_size         = 0;
+        m_allow_update = false;
     }
 
-    void RHI_AccelerationStructure::BuildBottomLevel(RHI_CommandList* cmd_list, const vector<RHI_AccelerationStructureGeometry>& geometries, const vector<uint32_t>& primitive_counts)
+    void RHI_AccelerationStructure::BuildBottomLevel(RHI_CommandList* cmd_list, const vector<RHI_AccelerationStructureGeometry>& geometries, const vector<uint32_t>& primitive_counts, const bool allow_update)
     {
         SP_ASSERT(m_type == RHI_AccelerationStructureType::Bottom);
         SP_ASSERT(geometries.size() == primitive_counts.size());
@@ -101,34 +162,12 @@ namespace spartan
         Destroy();
 
         // define geometry
-        vector<VkAccelerationStructureGeometryKHR> vk_geometries;
-        vk_geometries.reserve(geometries.size());
-
-        for (const RHI_AccelerationStructureGeometry& geo : geometries)
-        {
-            VkAccelerationStructureGeometryTrianglesDataKHR triangles_data = {};
-            triangles_data.sType                                           = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-            triangles_data.vertexFormat                                    = vulkan_format[static_cast<uint32_t>(geo.vertex_format)];
-            triangles_data.vertexData.deviceAddress                        = geo.vertex_buffer_address;
-            triangles_data.vertexStride                                    = geo.vertex_stride;
-            triangles_data.maxVertex                                       = geo.max_vertex;
-            triangles_data.indexType                                       = geo.index_format == RHI_Format::R32_Uint ? VK_INDEX_TYPE_UINT32 : (geo.index_format == RHI_Format::R16_Uint ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_NONE_KHR);
-            triangles_data.indexData.deviceAddress                         = geo.index_buffer_address;
-            triangles_data.transformData.deviceAddress                     = 0;
-
-            VkAccelerationStructureGeometryKHR geometry = {};
-            geometry.sType                              = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-            geometry.flags                              = geo.transparent ? 0 : VK_GEOMETRY_OPAQUE_BIT_KHR;
-            geometry.geometryType                       = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-            geometry.geometry.triangles                 = triangles_data;
-
-            vk_geometries.emplace_back(geometry);
-        }
+        vector<VkAccelerationStructureGeometryKHR> vk_geometries = to_vulkan_geometries(geometries);
 
-        // build info
+        // build info, refittable structures trade some trace speed for a fast build
         VkAccelerationStructureBuildGeometryInfoKHR build_info = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
         build_info.type                                        = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-        build_info.flags                                       = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+        build_info.flags                                       = allow_update ? (VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR) : VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
         build_info.mode                                        = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
         build_info.geometryCount                               = static_cast<uint32_t>(vk_geometries.size());
         build_info.pGeometries                                 = vk_geometries.data();
@@ -152,10 +191,14 @@ namespace spartan
         as_create(device, &create_info, nullptr, reinterpret_cast<VkAccelerationStructureKHR*>(&m_rhi_resource));
         RHI_Device::SetResourceName(m_rhi_resource, RHI_Resource_Type::AccelerationStructure, m_object_name.c_str());
 
-        // create scratch buffer
+        m_size         = size_info.accelerationStructureSize;
+        m_allow_update = allow_update;
+
+        // create scratch buffer, refittable structures keep it (sized for either mode) for their updates
         void* scratch_buffer = nullptr;
         const uint64_t alignment = RHI_Device::PropertyGetMinAccelerationBufferOffsetAlignment();
-        uint64_t scratch_size = (size_info.buildScratchSize + alignment - 1) & ~(alignment - 1); // align size
+        uint64_t scratch_size = allow_update ? max(size_info.buildScratchSize, size_info.updateScratchSize) : size_info.buildScratchSize;
+        scratch_size = (scratch_size + alignment - 1) & ~(alignment - 1); // align size
         usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
         properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
         RHI_Device::MemoryBufferCreate(
@@ -172,35 +215,56 @@ namespace spartan
         build_info.scratchData.deviceAddress = RHI_Device::GetBufferDeviceAddress(scratch_buffer);
 
         // build
-        vector<VkAccelerationStructureBuildRangeInfoKHR> range_infos(geometries.size());
+        record_bottom_level_build(cmd_list, build_info, primitive_counts);
 
-        for (uint32_t i = 0; i < static_cast<uint32_t>(geometries.size()); ++i)
+        // keep or destroy temp buffer
+        if (allow_update)
         {
-            range_infos[i].primitiveCount  = primitive_counts[i];
-            range_infos[i].primitiveOffset = 0;
-            range_infos[i].firstVertex     = 0;
-            range_infos[i].transformOffset = 0;
+            m_scratch_buffer      = scratch_buffer;
+            m_scratch_buffer_size = scratch_size;
         }
+        else
+        {
+            RHI_Device::DeletionQueueAdd(RHI_Resource_Type::Buffer, scratch_buffer);
+        }
+    }
 
-        vector<VkAccelerationStructureBuildRangeInfoKHR*> p_range_infos;
-
-        for (auto& range : range_infos) { p_range_infos.push_back(&range); }
+    void RHI_AccelerationStructure::UpdateBottomLevel(RHI_CommandList* cmd_list, const vector<RHI_AccelerationStructureGeometry>& geometries, const vector<uint32_t>& primitive_counts)
+    {
+        SP_ASSERT(m_type == RHI_AccelerationStructureType::Bottom);
+        SP_ASSERT(geometries.size() == primitive_counts.size());
 
-        as_build(static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()), 1, &build_info, p_range_infos.data());
+        // only a structure that was built to allow updates can be refit
+        if (!m_rhi_resource || !m_allow_update)
+        {
+            BuildBottomLevel(cmd_list, geometries, primitive_counts, true);
+            return;
+        }
 
-        // barrier: ensure build completes before use
+        // same topology as the build, so the existing structure and scratch buffer are big enough
+        vector<VkAccelerationStructureGeometryKHR> vk_geometries = to_vulkan_geometries(geometries);
+        VkAccelerationStructureBuildGeometryInfoKHR build_info   = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
+        build_info.type                                          = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+        build_info.flags                                         = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+        build_info.mode                                          = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+        build_info.geometryCount                                 = static_cast<uint32_t>(vk_geometries.size());
+        build_info.pGeometries                                   = vk_geometries.data();
+        build_info.srcAccelerationStructure                      = static_cast<VkAccelerationStructureKHR>(m_rhi_resource);
+        build_info.dstAccelerationStructure                      = static_cast<VkAccelerationStructureKHR>(m_rhi_resource);
+        build_info.scratchData.deviceAddress                     = RHI_Device::GetBufferDeviceAddress(m_scratch_buffer);
+
+        // barrier: the vertices were just copied in, and the previous refit may still be using the scratch buffer
         VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
-        barrier.srcAccessMask   = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
-        barrier.dstAccessMask   = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT;
+        barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+        barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
         vkCmdPipelineBarrier(
             static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()),
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
             VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-            VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
             0, 1, &barrier, 0, nullptr, 0, nullptr
         );
 
-        // destroy temp buffer
-        RHI_Device::DeletionQueueAdd(RHI_Resource_Type::Buffer, scratch_buffer);
+        record_bottom_level_build(cmd_list, build_info, primitive_counts);
     }
 
     void RHI_AccelerationStructure::BuildTopLevel(RHI_CommandList* cmd_list, const vector<RHI_AccelerationStructureInstance>& instances)
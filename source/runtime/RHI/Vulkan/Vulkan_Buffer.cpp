@@ -55,6 +55,7 @@ namespace spartan
         {
             bool vertex                     = m_type == RHI_Buffer_Type::Vertex || m_type == RHI_Buffer_Type::Instance;
             VkBufferUsageFlags flags_usage  = vertex ? VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+            flags_usage                    |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT; // so that the geometry pool can move ranges around
 
              if (m_type == RHI_Buffer_Type::Vertex || m_type == RHI_Buffer_Type::Index)
              {
@@ -72,22 +73,15 @@ namespace spartan
             }
             else
             {
-                // create staging buffer, it's slower but we can copy data in and out of it
-                void* staging_buffer = nullptr;
-                RHI_Device::MemoryBufferCreate(staging_buffer, m_object_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, data, m_object_name.c_str());
-
                 // create destination buffer, it's faster but we can only copy data into it
                 RHI_Device::MemoryBufferCreate(m_rhi_resource, m_object_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | flags_usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, nullptr, m_object_name.c_str());
 
-                // copy staging buffer to destination buffer
-                VkBuffer* buffer_vk         = reinterpret_cast<VkBuffer*>(&m_rhi_resource);
-                VkBuffer* buffer_staging_vk = reinterpret_cast<VkBuffer*>(&staging_buffer);
-                VkBufferCopy copy_region    = {};
-                copy_region.size            = m_object_size;
-                RHI_CommandList* cmd_list   = RHI_CommandList::ImmediateExecutionBegin(RHI_Queue_Type::Copy);
-                vkCmdCopyBuffer(static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()), *buffer_staging_vk, *buffer_vk, 1, &copy_region);
-                RHI_CommandList::ImmediateExecutionEnd(cmd_list);
-                RHI_Device::DeletionQueueAdd(RHI_Resource_Type::Buffer, staging_buffer);
+                // copy the initial data, if any, through a staging buffer
+                if (data)
+                {
+                    SP_ASSERT_MSG(m_rhi_resource != nullptr, "Failed to create buffer");
+                    Upload(data, 0, m_object_size);
+                }
             }
         }
         else if (m_type == RHI_Buffer_Type::Storage)
@@ -182,6 +176,60 @@ namespace spartan
         cmd_list->UpdateBuffer(this, m_offset, size != 0 ? size : m_stride, data_cpu);
     }
 
+    void RHI_Buffer::Upload(const void* data, const uint64_t offset, const uint64_t size)
+    {
+        SP_ASSERT(m_type == RHI_Buffer_Type::Vertex || m_type == RHI_Buffer_Type::Index || m_type == RHI_Buffer_Type::Instance);
+        SP_ASSERT_MSG(data != nullptr,                 "Invalid cpu data");
+        SP_ASSERT_MSG(offset + size <= m_object_size, "Out of bounds");
+
+        if (m_mappable)
+        {
+            memcpy(static_cast<uint8_t*>(m_data_gpu) + offset, data, size);
+            return;
+        }
+
+        // create staging buffer, it's slower but we can copy data in and out of it
+        void* staging_buffer = nullptr;
+        RHI_Device::MemoryBufferCreate(staging_buffer, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, data, m_object_name.c_str());
+
+        // copy staging buffer to destination buffer
+        VkBufferCopy copy_region  = {};
+        copy_region.dstOffset     = offset;
+        copy_region.size          = size;
+        RHI_CommandList* cmd_list = RHI_CommandList::ImmediateExecutionBegin(RHI_Queue_Type::Copy);
+        vkCmdCopyBuffer(static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()), static_cast<VkBuffer>(staging_buffer), static_cast<VkBuffer>(m_rhi_resource), 1, &copy_region);
+        RHI_CommandList::ImmediateExecutionEnd(cmd_list);
+        RHI_Device::DeletionQueueAdd(RHI_Resource_Type::Buffer, staging_buffer);
+    }
+
+    void RHI_Buffer::Copy(RHI_Buffer* source, RHI_Buffer* destination, const RHI_BufferCopyRegion* regions, const uint32_t region_count)
+    {
+        SP_ASSERT(source && destination && source != destination);
+        if (region_count == 0)
+            return;
+
+        vector<VkBufferCopy> copy_regions(region_count);
+        for (uint32_t i = 0; i < region_count; i++)
+        {
+            SP_ASSERT(regions[i].offset_source + regions[i].size      <= source->GetObjectSize());
+            SP_ASSERT(regions[i].offset_destination + regions[i].size <= destination->GetObjectSize());
+
+            copy_regions[i].srcOffset = regions[i].offset_source;
+            copy_regions[i].dstOffset = regions[i].offset_destination;
+            copy_regions[i].size      = regions[i].size;
+        }
+
+        RHI_CommandList* cmd_list = RHI_CommandList::ImmediateExecutionBegin(RHI_Queue_Type::Copy);
+        vkCmdCopyBuffer(
+            static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()),
+            static_cast<VkBuffer>(source->GetRhiResource()),
+            static_cast<VkBuffer>(destination->GetRhiResource()),
+            region_count,
+            copy_regions.data()
+        );
+        RHI_CommandList::ImmediateExecutionEnd(cmd_list);
+    }
+
     RHI_StridedDeviceAddressRegion RHI_Buffer::GetRegion(const RHI_Shader_Type group_type, const uint32_t stride_extra /*= 0*/) const
     {
         uint64_t offset = 0;
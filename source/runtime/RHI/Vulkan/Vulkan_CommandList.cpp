@@ -1812,6 +1812,67 @@ namespace spartan
         }
     }
 
+    void RHI_CommandList::CopyBuffer(RHI_Buffer* source, RHI_Buffer* destination, const RHI_BufferCopyRegion* regions, const uint32_t region_count)
+    {
+        SP_ASSERT(source && destination && source != destination);
+        SP_ASSERT(m_state == RHI_CommandListState::Recording);
+        if (region_count == 0)
+            return;
+
+        vector<VkBufferCopy> copy_regions(region_count);
+        for (uint32_t i = 0; i < region_count; i++)
+        {
+            SP_ASSERT(regions[i].offset_source + regions[i].size      <= source->GetObjectSize());
+            SP_ASSERT(regions[i].offset_destination + regions[i].size <= destination->GetObjectSize());
+
+            copy_regions[i].srcOffset = regions[i].offset_source;
+            copy_regions[i].dstOffset = regions[i].offset_destination;
+            copy_regions[i].size      = regions[i].size;
+        }
+
+        RenderPassEnd();
+
+        // one barrier before all the copies, prior reads of the destination (previous frames included) complete before the writes
+        VkMemoryBarrier2 barrier_before = {};
+        barrier_before.sType            = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        barrier_before.srcStageMask     = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier_before.srcAccessMask    = VK_ACCESS_2_MEMORY_READ_BIT;
+        barrier_before.dstStageMask     = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        barrier_before.dstAccessMask    = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+        VkDependencyInfo dependency_info_before   = {};
+        dependency_info_before.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency_info_before.memoryBarrierCount = 1;
+        dependency_info_before.pMemoryBarriers    = &barrier_before;
+
+        vkCmdPipelineBarrier2(static_cast<VkCommandBuffer>(m_rhi_resource), &dependency_info_before);
+        Profiler::m_rhi_pipeline_barriers++;
+
+        vkCmdCopyBuffer(
+            static_cast<VkCommandBuffer>(m_rhi_resource),
+            static_cast<VkBuffer>(source->GetRhiResource()),
+            static_cast<VkBuffer>(destination->GetRhiResource()),
+            region_count,
+            copy_regions.data()
+        );
+
+        // and one after, the writes are visible to everything that follows
+        VkMemoryBarrier2 barrier_after = {};
+        barrier_after.sType            = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        barrier_after.srcStageMask     = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        barrier_after.srcAccessMask    = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier_after.dstStageMask     = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier_after.dstAccessMask    = VK_ACCESS_2_MEMORY_READ_BIT;
+
+        VkDependencyInfo dependency_info_after   = {};
+        dependency_info_after.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency_info_after.memoryBarrierCount = 1;
+        dependency_info_after.pMemoryBarriers    = &barrier_after;
+
+        vkCmdPipelineBarrier2(static_cast<VkCommandBuffer>(m_rhi_resource), &dependency_info_after);
+        Profiler::m_rhi_pipeline_barriers++;
+    }
+
     void RHI_CommandList::InsertBarrier(
         void* image,
         const RHI_Format format,
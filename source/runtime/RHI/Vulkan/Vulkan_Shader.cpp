@@ -127,6 +127,7 @@ namespace spartan
             {
                 arguments.emplace_back("-fvk-use-dx-layout");     // use DirectX memory layout for Vulkan resources
                 arguments.emplace_back("-fvk-use-dx-position-w"); // reciprocate SV_Position.w after reading from stage input in PS to accommodate the difference between Vulkan and DirectX
+                arguments.emplace_back("-fvk-support-nonzero-base-instance"); // SV_InstanceID excludes the first instance, instances are sub-allocated from a shared buffer
 
                 // negate SV_Position.y before writing to stage output in vs/ds/gs to accommodate vulkan's coordinate system
                 if (m_shader_type == RHI_Shader_Type::Vertex || m_shader_type == RHI_Shader_Type::Domain)
@@ -19,29 +19,319 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+
 //= INCLUDES =========
 #include "pch.h"
 #include "Animation.h"
+#include "Skeleton.h"
 //====================
 
-//= NAMESPACES =====
+//= NAMESPACES ===============
 using namespace std;
-//==================
+using namespace spartan::math;
+//============================
 
 namespace spartan
 {
+    namespace animation_file
+    {
+        constexpr uint32_t magic   = 0x4D494E41; // "ANIM"
+        constexpr uint32_t version = 1;
+
+        struct Header
+        {
+            uint32_t magic         = animation_file::magic;
+            uint32_t version       = animation_file::version;
+            float duration         = 0.0f;
+            float sample_rate      = 0.0f;
+            uint32_t frame_count   = 0;
+            uint32_t bone_count    = 0;
+            uint32_t stride        = 0;
+            uint32_t name_length   = 0;
+            uint64_t skeleton_hash = 0;
+        };
+        static_assert(sizeof(Header) == 40);
+    }
+
+    namespace
+    {
+        const uint32_t channel_count = Pose::channel_count;
+
+        // the keys that surround the time, keys are sorted by time
+        template<typename T>
+        bool find_keys(const vector<T>& keys, const double time, uint32_t& first, uint32_t& second, float& t)
+        {
+            if (keys.empty())
+                return false;
+
+            auto it = upper_bound(keys.begin(), keys.end(), time, [](const double value, const T& key) { return value < key.time; });
+            second  = it == keys.end() ? static_cast<uint32_t>(keys.size()) - 1 : static_cast<uint32_t>(it - keys.begin());
+            first   = second == 0 ? 0 : second - 1;
+
+            const double span = keys[second].time - keys[first].time;
+            t                 = span > 0.0 ? static_cast<float>(clamp((time - keys[first].time) / span, 0.0, 1.0)) : 0.0f;
+            return true;
+        }
+
+        Vector3 sample_keys(const vector<KeyVector>& keys, const double time, const Vector3& fallback)
+        {
+            uint32_t first = 0, second = 0;
+            float t        = 0.0f;
+            if (!find_keys(keys, time, first, second, t))
+                return fallback;
+
+            return keys[first].value + (keys[second].value - keys[first].value) * t;
+        }
+
+        Quaternion sample_keys(const vector<KeyQuaternion>& keys, const double time, const Quaternion& fallback)
+        {
+            uint32_t first = 0, second = 0;
+            float t        = 0.0f;
+            if (!find_keys(keys, time, first, second, t))
+                return fallback;
+
+            return Quaternion::Lerp(keys[first].value, keys[second].value, t);
+        }
+    }
+
     Animation::Animation(): IResource(ResourceType::Animation)
     {
 
     }
 
-    void Animation::LoadFromFile(const string& filePath)
+    void Animation::Build(const Skeleton& skeleton, const vector<AnimationNode>& nodes, const float duration, const float sample_rate)
     {
+        m_bone_count    = skeleton.GetBoneCount();
+        m_stride        = Pose::GetStride(m_bone_count);
+        m_skeleton_hash = skeleton.GetLayoutHash();
+        m_sample_rate   = max(sample_rate, 1.0f);
+        m_duration      = max(duration, 0.0f);
+        m_frame_count   = static_cast<uint32_t>(ceil(m_duration * m_sample_rate)) + 1;
+
+        unordered_map<string, const AnimationNode*> node_by_name;
+        for (const AnimationNode& node : nodes)
+        {
+            node_by_name[node.name] = &node;
+        }
+
+        // resample, bones that aren't animated (and the padding) are constant
+        vector<float> values(static_cast<size_t>(m_frame_count) * channel_count * m_stride, 0.0f);
+        auto value = [this, &values](const uint32_t frame, const PoseChannel channel, const uint32_t bone) -> float&
+        {
+            return values[(static_cast<size_t>(frame) * channel_count + static_cast<uint32_t>(channel)) * m_stride + bone];
+        };
+
+        for (uint32_t bone = 0; bone < m_stride; bone++)
+        {
+            const bool is_padding       = bone >= m_bone_count;
+            const SkeletonBone* bind    = is_padding ? nullptr : &skeleton.GetBone(bone);
+            auto it                     = is_padding ? node_by_name.end() : node_by_name.find(bind->name);
+            const AnimationNode* node   = it != node_by_name.end() ? it->second : nullptr;
+            Quaternion rotation_previous = Quaternion::Identity;
+
+            for (uint32_t frame = 0; frame < m_frame_count; frame++)
+            {
+                const double time   = min(static_cast<double>(frame) / m_sample_rate, static_cast<double>(m_duration));
+                Vector3 position    = is_padding ? Vector3::Zero       : bind->position;
+                Quaternion rotation = is_padding ? Quaternion::Identity : bind->rotation;
+                Vector3 scale       = is_padding ? Vector3::One        : bind->scale;
+
+                if (node)
+                {
+                    position = sample_keys(node->positionFrames, time, position);
+                    rotation = sample_keys(node->rotationFrames, time, rotation);
+                    scale    = sample_keys(node->scaleFrames,    time, scale);
+                }
+
+                // keep consecutive frames in the same hemisphere, so that interpolating them takes the short path
+                rotation.Normalize();
+                if (frame > 0 && Quaternion::Dot(rotation, rotation_previous) < 0.0f)
+                {
+                    rotation = Quaternion(-rotation.x, -rotation.y, -rotation.z, -rotation.w);
+                }
+                rotation_previous = rotation;
+
+                value(frame, PoseChannel::PositionX, bone) = position.x;
+                value(frame, PoseChannel::PositionY, bone) = position.y;
+                value(frame, PoseChannel::PositionZ, bone) = position.z;
+                value(frame, PoseChannel::RotationX, bone) = rotation.x;
+                value(frame, PoseChannel::RotationY, bone) = rotation.y;
+                value(frame, PoseChannel::RotationZ, bone) = rotation.z;
+                value(frame, PoseChannel::RotationW, bone) = rotation.w;
+                value(frame, PoseChannel::ScaleX,    bone) = scale.x;
+                value(frame, PoseChannel::ScaleY,    bone) = scale.y;
+                value(frame, PoseChannel::ScaleZ,    bone) = scale.z;
+            }
+        }
+
+        // quantize every channel of every bone against its own range
+        m_range_min.assign(channel_count * m_stride, 0.0f);
+        m_range_scale.assign(channel_count * m_stride, 0.0f);
+        m_frames.assign(values.size(), 0);
+        for (uint32_t channel = 0; channel < channel_count; channel++)
+        {
+            for (uint32_t bone = 0; bone < m_stride; bone++)
+            {
+                float range_min = numeric_limits<float>::max();
+                float range_max = numeric_limits<float>::lowest();
+                for (uint32_t frame = 0; frame < m_frame_count; frame++)
+                {
+                    const float v = value(frame, static_cast<PoseChannel>(channel), bone);
+                    range_min     = min(range_min, v);
+                    range_max     = max(range_max, v);
+                }
+
+                const float scale                        = (range_max - range_min) / 65535.0f;
+                m_range_min[channel * m_stride + bone]   = range_min;
+                m_range_scale[channel * m_stride + bone] = scale;
+
+                for (uint32_t frame = 0; frame < m_frame_count; frame++)
+                {
+                    const size_t index = (static_cast<size_t>(frame) * channel_count + channel) * m_stride + bone;
+                    const float v      = scale > 0.0f ? (values[index] - range_min) / scale : 0.0f;
+                    m_frames[index]    = static_cast<uint16_t>(clamp(v + 0.5f, 0.0f, 65535.0f));
+                }
+            }
+        }
 
+        UpdateObjectSize();
     }
 
-    void Animation::SaveToFile(const string& filePath)
+    void Animation::Sample(const float time, Pose& pose) const
     {
+        if (m_frame_count == 0)
+            return;
 
+        if (pose.GetBoneCount() != m_bone_count)
+        {
+            pose.Resize(m_bone_count);
+        }
+
+        const float position  = clamp(time, 0.0f, m_duration) * m_sample_rate;
+        const uint32_t frame_a = min(static_cast<uint32_t>(position), m_frame_count - 1);
+        const uint32_t frame_b = min(frame_a + 1, m_frame_count - 1);
+        const float t          = clamp(position - static_cast<float>(frame_a), 0.0f, 1.0f);
+
+        for (uint32_t channel = 0; channel < channel_count; channel++)
+        {
+            const uint16_t* a  = &m_frames[(static_cast<size_t>(frame_a) * channel_count + channel) * m_stride];
+            const uint16_t* b  = &m_frames[(static_cast<size_t>(frame_b) * channel_count + channel) * m_stride];
+            const float* range_min   = &m_range_min[channel * m_stride];
+            const float* range_scale = &m_range_scale[channel * m_stride];
+            float* out               = pose.GetChannel(static_cast<PoseChannel>(channel));
+
+        #if defined(__AVX2__)
+            const __m256 weight = _mm256_set1_ps(t);
+            for (uint32_t i = 0; i < m_stride; i += 8)
+            {
+                const __m256 va = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i))));
+                const __m256 vb = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+                const __m256 v  = _mm256_fmadd_ps(_mm256_sub_ps(vb, va), weight, va);
+                _mm256_storeu_ps(out + i, _mm256_fmadd_ps(v, _mm256_loadu_ps(range_scale + i), _mm256_loadu_ps(range_min + i)));
+            }
+        #else
+            for (uint32_t i = 0; i < m_stride; i++)
+            {
+                const float va = static_cast<float>(a[i]);
+                const float vb = static_cast<float>(b[i]);
+                out[i]         = (va + (vb - va) * t) * range_scale[i] + range_min[i];
+            }
+        #endif
+        }
+
+        // quantization and interpolation shorten the rotations
+        pose.NormalizeRotations();
+    }
+
+    void Animation::LoadFromFile(const string& file_path)
+    {
+        ifstream file(file_path, ios::binary);
+        if (!file)
+        {
+            SP_LOG_ERROR("Failed to open \"%s\"", file_path.c_str());
+            return;
+        }
+
+        animation_file::Header header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != animation_file::magic || header.version != animation_file::version)
+        {
+            SP_LOG_ERROR("Unsupported animation file: %s", file_path.c_str());
+            return;
+        }
+
+        if (header.stride != Pose::GetStride(header.bone_count))
+        {
+            SP_LOG_ERROR("Invalid animation file: %s", file_path.c_str());
+            return;
+        }
+
+        string name(header.name_length, '\0');
+        file.read(name.data(), header.name_length);
+
+        vector<float> range_min(channel_count * header.stride);
+        vector<float> range_scale(range_min.size());
+        vector<uint16_t> frames(static_cast<size_t>(header.frame_count) * channel_count * header.stride);
+        file.read(reinterpret_cast<char*>(range_min.data()),   range_min.size()   * sizeof(float));
+        file.read(reinterpret_cast<char*>(range_scale.data()), range_scale.size() * sizeof(float));
+        file.read(reinterpret_cast<char*>(frames.data()),      frames.size()      * sizeof(uint16_t));
+        if (!file)
+        {
+            SP_LOG_ERROR("Truncated animation file: %s", file_path.c_str());
+            return;
+        }
+
+        SetObjectName(name.empty() ? FileSystem::GetFileNameWithoutExtensionFromFilePath(file_path) : name);
+        m_duration      = header.duration;
+        m_sample_rate   = header.sample_rate;
+        m_frame_count   = header.frame_count;
+        m_bone_count    = header.bone_count;
+        m_stride        = header.stride;
+        m_skeleton_hash = header.skeleton_hash;
+        m_range_min     = move(range_min);
+        m_range_scale   = move(range_scale);
+        m_frames        = move(frames);
+
+        UpdateObjectSize();
+    }
+
+    void Animation::SaveToFile(const string& file_path)
+    {
+        ofstream file(file_path, ios::binary);
+        if (!file)
+        {
+            SP_LOG_ERROR("Failed to open file for writing: %s", file_path.c_str());
+            return;
+        }
+
+        animation_file::Header header;
+        header.duration      = m_duration;
+        header.sample_rate   = m_sample_rate;
+        header.frame_count   = m_frame_count;
+        header.bone_count    = m_bone_count;
+        header.stride        = m_stride;
+        header.name_length   = static_cast<uint32_t>(m_object_name.size());
+        header.skeleton_hash = m_skeleton_hash;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(m_object_name.data(), m_object_name.size());
+        file.write(reinterpret_cast<const char*>(m_range_min.data()),   m_range_min.size()   * sizeof(float));
+        file.write(reinterpret_cast<const char*>(m_range_scale.data()), m_range_scale.size() * sizeof(float));
+        file.write(reinterpret_cast<const char*>(m_frames.data()),      m_frames.size()      * sizeof(uint16_t));
+    }
+
+    uint64_t Animation::GetContentHash()
+    {
+        uint64_t hash = hash_bytes(m_frames.data(), m_frames.size() * sizeof(uint16_t));
+        hash          = hash_combine(hash, hash_bytes(m_range_min.data(), m_range_min.size() * sizeof(float)));
+        hash          = hash_combine(hash, hash_bytes(m_range_scale.data(), m_range_scale.size() * sizeof(float)));
+        hash          = hash_combine(hash, m_skeleton_hash);
+        hash          = hash_combine(hash, hash_bytes(m_object_name.data(), m_object_name.size()));
+        return hash;
+    }
+
+    void Animation::UpdateObjectSize()
+    {
+        m_object_size = m_frames.size() * sizeof(uint16_t) + (m_range_min.size() + m_range_scale.size()) * sizeof(float);
     }
 }
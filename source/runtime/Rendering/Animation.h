@@ -19,6 +19,7 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+
 #pragma once
 
 //= INCLUDES =====================
@@ -28,31 +29,22 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace spartan
 {
-    struct AnimationVertexWeight
-    {
-        uint32_t vertexID;
-        float weight;
-    };
-
-    struct AnimationBone
-    {
-        std::string name;
-        std::vector<AnimationVertexWeight> vertexWeights;
-        math::Matrix offset;
-    };
+    class Skeleton;
+    class Pose;
 
     struct KeyVector
     {
-        double time;
+        double time; // seconds
         math::Vector3 value;
     };
 
     struct KeyQuaternion
     {
-        double time;
+        double time; // seconds
         math::Quaternion value;
     };
 
+    // the source keyframes of a single bone, as they come from an importer
     struct AnimationNode
     {
         std::string name;
@@ -61,6 +53,9 @@ namespace spartan
         std::vector<KeyVector> scaleFrames;
     };
 
+    // a clip which is resampled at a fixed rate and stored as 16-bit values, quantized against the range of each bone and channel
+    // - frames are stored channel by channel with the bones of a channel next to each other, the same layout as a pose
+    // - a frame costs 20 bytes per bone, instead of the 40 bytes of its floats (or the 88 bytes of its timed keys)
     class Animation : public IResource
     {
     public:
@@ -68,19 +63,34 @@ namespace spartan
         ~Animation() = default;
 
         // iresource
-        void LoadFromFile(const std::string& filePath) override;
-        void SaveToFile(const std::string& filePath) override;
+        void LoadFromFile(const std::string& file_path) override;
+        void SaveToFile(const std::string& file_path) override;
+        uint64_t GetContentHash() override;
+
+        // resamples the nodes that match a bone of the skeleton, the rest of the bones keep their bind pose
+        void Build(const Skeleton& skeleton, const std::vector<AnimationNode>& nodes, const float duration, const float sample_rate = 30.0f);
 
-        void SetObjectName(const std::string& name)   { m_object_name = name; }
-        void SetDuration(double duration)       { m_duration = duration; }
-        void SetTicksPerSec(double ticksPerSec) { m_ticksPerSec = ticksPerSec; }
+        // decodes the pose at the given time (in seconds), frames are interpolated and the time is clamped to the duration
+        void Sample(const float time, Pose& pose) const;
+
+        float GetDuration() const         { return m_duration; }
+        float GetSampleRate() const       { return m_sample_rate; }
+        uint32_t GetFrameCount() const    { return m_frame_count; }
+        uint32_t GetBoneCount() const     { return m_bone_count; }
+        uint64_t GetSkeletonHash() const  { return m_skeleton_hash; }
 
     private:
-        std::string m_object_name;
-        double m_duration    = 0;
-        double m_ticksPerSec = 0;
+        void UpdateObjectSize();
+
+        float m_duration         = 0.0f;
+        float m_sample_rate      = 30.0f;
+        uint32_t m_frame_count   = 0;
+        uint32_t m_bone_count    = 0;
+        uint32_t m_stride        = 0; // bones per channel, padded for simd
+        uint64_t m_skeleton_hash = 0;
 
-        // Each channel controls a single node
-        std::vector<AnimationNode> m_channels;
+        std::vector<float> m_range_min;   // per channel and bone
+        std::vector<float> m_range_scale; // per channel and bone, extent / 65535
+        std::vector<uint16_t> m_frames;   // per frame, channel and bone
     };
 }
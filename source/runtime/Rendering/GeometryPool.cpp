@@ -0,0 +1,524 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ================================
+#include "pch.h"
+#include "GeometryPool.h"
+#include "Instance.h"
+#include "../Memory/RangeAllocator.h"
+#include "../RHI/RHI_Buffer.h"
+#include "../RHI/RHI_Vertex.h"
+#include "../Geometry/GeometryProcessing.h"
+//===========================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace spartan
+{
+    namespace
+    {
+        struct Page
+        {
+            unique_ptr<RHI_Buffer> buffer;
+            RangeAllocator allocator;
+            map<uint32_t, GeometryAllocation*> allocations; // offset -> allocation, sorted so that compaction preserves order
+        };
+
+        struct PoolTypeInfo
+        {
+            const char* name;
+            RHI_Buffer_Type buffer_type;
+            uint32_t stride;
+            uint32_t page_capacity; // in elements, bigger allocations get a page of their own size
+        };
+
+        const array<PoolTypeInfo, static_cast<size_t>(GeometryPoolType::Max)> type_infos =
+        {{
+            { "vertex",   RHI_Buffer_Type::Vertex,   sizeof(RHI_Vertex_PosTexNorTan_Gpu), 1u << 20 }, // 24 MB
+            { "index16",  RHI_Buffer_Type::Index,    sizeof(uint16_t),                    1u << 22 }, // 8 MB
+            { "index32",  RHI_Buffer_Type::Index,    sizeof(uint32_t),                    1u << 22 }, // 16 MB
+            { "instance", RHI_Buffer_Type::Instance, sizeof(Instance),                    1u << 20 }  // 10 MB
+        }};
+
+        // a page gets compacted once most of its free space is scattered across many small ranges
+        const float fragmentation_threshold          = 0.5f;
+        const uint32_t fragmentation_min_range_count = 64;
+
+        array<vector<unique_ptr<Page>>, static_cast<size_t>(GeometryPoolType::Max)> pages; // empty slots are reused
+        vector<GeometryAllocation*> allocations_freed;
+        GeometryAllocation* identity_instance = nullptr;
+        bool initialized                      = false;
+        bool defragmentation_requested        = false;
+        uint32_t defragmentation_count        = 0;
+        mutex mutex_pool;
+
+        const PoolTypeInfo& get_info(const GeometryPoolType type)
+        {
+            return type_infos[static_cast<size_t>(type)];
+        }
+
+        unique_ptr<RHI_Buffer> create_page_buffer(const GeometryPoolType type, const uint32_t slot, const uint32_t capacity)
+        {
+            const PoolTypeInfo& info = get_info(type);
+            const string name        = string("geometry_pool_") + info.name + "_" + to_string(slot);
+
+            return make_unique<RHI_Buffer>(info.buffer_type, info.stride, capacity, nullptr, false, name.c_str());
+        }
+
+        void compact(const GeometryPoolType type, const uint32_t slot, Page& page)
+        {
+            const uint32_t stride   = get_info(type).stride;
+            const uint32_t capacity = page.allocator.GetCapacity();
+
+            // pack every live range to the front of a fresh buffer, preserving order
+            unique_ptr<RHI_Buffer> buffer = create_page_buffer(type, slot, capacity);
+            vector<RHI_BufferCopyRegion> regions;
+            map<uint32_t, GeometryAllocation*> allocations;
+            page.allocator.Reset(capacity);
+            for (const auto& [offset, allocation] : page.allocations)
+            {
+                const uint32_t offset_new = page.allocator.Allocate(allocation->count);
+                SP_ASSERT(offset_new != RangeAllocator::invalid_offset);
+
+                // extend the previous region when both source and destination are contiguous
+                const uint64_t source      = static_cast<uint64_t>(offset) * stride;
+                const uint64_t destination = static_cast<uint64_t>(offset_new) * stride;
+                const uint64_t size        = static_cast<uint64_t>(allocation->count) * stride;
+                if (!regions.empty() && regions.back().offset_source + regions.back().size == source && regions.back().offset_destination + regions.back().size == destination)
+                {
+                    regions.back().size += size;
+                }
+                else
+                {
+                    regions.push_back({ source, destination, size });
+                }
+
+                allocation->buffer = buffer.get();
+                allocation->offset = offset_new;
+                allocations[offset_new] = allocation;
+            }
+
+            RHI_Buffer::Copy(page.buffer.get(), buffer.get(), regions.data(), static_cast<uint32_t>(regions.size()));
+
+            // the old buffer goes through the deletion queue
+            page.buffer      = move(buffer);
+            page.allocations = move(allocations);
+            defragmentation_count++;
+        }
+    }
+
+    void GeometryPool::Initialize()
+    {
+        {
+            lock_guard lock(mutex_pool);
+            initialized = true;
+        }
+
+        Instance identity = Instance::GetIdentity();
+        identity_instance = Allocate(GeometryPoolType::Instance, 1, &identity);
+    }
+
+    void GeometryPool::Shutdown()
+    {
+        lock_guard lock(mutex_pool);
+
+        for (vector<unique_ptr<Page>>& type_pages : pages)
+        {
+            for (unique_ptr<Page>& page : type_pages)
+            {
+                if (!page)
+                    continue;
+
+                for (const auto& [offset, allocation] : page->allocations)
+                {
+                    delete allocation;
+                }
+            }
+
+            type_pages.clear();
+        }
+
+        // records freed after this point are deleted on the spot
+        allocations_freed.clear();
+        identity_instance = nullptr;
+        initialized       = false;
+    }
+
+    void GeometryPool::Tick()
+    {
+        lock_guard lock(mutex_pool);
+
+        // release freed ranges
+        for (GeometryAllocation* allocation : allocations_freed)
+        {
+            Page& page = *pages[static_cast<size_t>(allocation->type)][allocation->page];
+            page.allocator.Free(allocation->offset, allocation->count);
+            page.allocations.erase(allocation->offset);
+            delete allocation;
+        }
+        allocations_freed.clear();
+
+        for (uint32_t type_index = 0; type_index < static_cast<uint32_t>(GeometryPoolType::Max); type_index++)
+        {
+            vector<unique_ptr<Page>>& type_pages = pages[type_index];
+            for (uint32_t slot = 0; slot < static_cast<uint32_t>(type_pages.size()); slot++)
+            {
+                unique_ptr<Page>& page = type_pages[slot];
+                if (!page)
+                    continue;
+
+                // release empty pages, but keep the first one around for whatever gets loaded next
+                if (page->allocations.empty())
+                {
+                    if (slot != 0)
+                    {
+                        page = nullptr;
+                    }
+                    continue;
+                }
+
+                bool fragmented = page->allocator.GetFragmentation() > fragmentation_threshold && page->allocator.GetFreeRangeCount() >= fragmentation_min_range_count;
+                if (defragmentation_requested || fragmented)
+                {
+                    compact(static_cast<GeometryPoolType>(type_index), slot, *page);
+                }
+            }
+        }
+
+        defragmentation_requested = false;
+    }
+
+    bool GeometryPool::NeedsTick()
+    {
+        lock_guard lock(mutex_pool);
+        return !allocations_freed.empty() || defragmentation_requested;
+    }
+
+    GeometryAllocation* GeometryPool::Allocate(const GeometryPoolType type, const uint32_t count, const void* data)
+    {
+        SP_ASSERT(type != GeometryPoolType::Max);
+        SP_ASSERT(count != 0);
+
+        // vertices are packed before taking the lock, so that allocations don't serialize on it
+        vector<RHI_Vertex_PosTexNorTan_Gpu> vertices_gpu;
+        if (type == GeometryPoolType::Vertex && data)
+        {
+            vertices_gpu.resize(count);
+            geometry_processing::pack_for_gpu(static_cast<const RHI_Vertex_PosTexNorTan*>(data), count, vertices_gpu.data());
+            data = vertices_gpu.data();
+        }
+
+        // the upload happens under the lock as well, so that a concurrent compaction can't copy stale data
+        lock_guard lock(mutex_pool);
+
+        if (!initialized)
+            return nullptr;
+
+        const PoolTypeInfo& info             = get_info(type);
+        vector<unique_ptr<Page>>& type_pages = pages[static_cast<size_t>(type)];
+
+        // find a page with enough space
+        uint32_t slot   = 0;
+        uint32_t offset = RangeAllocator::invalid_offset;
+        for (; slot < static_cast<uint32_t>(type_pages.size()); slot++)
+        {
+            if (type_pages[slot])
+            {
+                offset = type_pages[slot]->allocator.Allocate(count);
+                if (offset != RangeAllocator::invalid_offset)
+                    break;
+            }
+        }
+
+        // or create one, reusing an empty slot if possible
+        if (offset == RangeAllocator::invalid_offset)
+        {
+            slot = 0;
+            while (slot < static_cast<uint32_t>(type_pages.size()) && type_pages[slot])
+            {
+                slot++;
+            }
+
+            if (slot == type_pages.size())
+            {
+                type_pages.emplace_back();
+            }
+
+            const uint32_t capacity = max(info.page_capacity, count);
+            type_pages[slot]        = make_unique<Page>();
+            type_pages[slot]->allocator.Reset(capacity);
+            type_pages[slot]->buffer = create_page_buffer(type, slot, capacity);
+            offset                   = type_pages[slot]->allocator.Allocate(count);
+        }
+
+        Page& page                     = *type_pages[slot];
+        GeometryAllocation* allocation = new GeometryAllocation();
+        allocation->type               = type;
+        allocation->buffer             = page.buffer.get();
+        allocation->page               = slot;
+        allocation->offset             = offset;
+        allocation->count              = count;
+        page.allocations[offset]       = allocation;
+
+        if (data)
+        {
+            page.buffer->Upload(data, static_cast<uint64_t>(offset) * info.stride, static_cast<uint64_t>(count) * info.stride);
+        }
+
+        return allocation;
+    }
+
+    void GeometryPool::Free(GeometryAllocation* allocation)
+    {
+        if (!allocation)
+            return;
+
+        lock_guard lock(mutex_pool);
+
+        if (!initialized)
+        {
+            delete allocation;
+            return;
+        }
+
+        allocations_freed.emplace_back(allocation);
+    }
+
+    void GeometryPool::RequestDefragmentation()
+    {
+        lock_guard lock(mutex_pool);
+        defragmentation_requested = true;
+    }
+
+    const GeometryAllocation* GeometryPool::GetIdentityInstance()
+    {
+        return identity_instance;
+    }
+
+    uint32_t GeometryPool::GetPageCount(const GeometryPoolType type)
+    {
+        lock_guard lock(mutex_pool);
+
+        uint32_t count = 0;
+        for (const unique_ptr<Page>& page : pages[static_cast<size_t>(type)])
+        {
+            count += page ? 1 : 0;
+        }
+
+        return count;
+    }
+
+    uint32_t GeometryPool::GetAllocationCount(const GeometryPoolType type)
+    {
+        lock_guard lock(mutex_pool);
+
+        uint32_t count = 0;
+        for (const unique_ptr<Page>& page : pages[static_cast<size_t>(type)])
+        {
+            count += page ? page->allocator.GetAllocationCount() : 0;
+        }
+
+        return count;
+    }
+
+    uint64_t GeometryPool::GetMemoryUsed(const GeometryPoolType type)
+    {
+        lock_guard lock(mutex_pool);
+
+        uint64_t elements = 0;
+        for (const unique_ptr<Page>& page : pages[static_cast<size_t>(type)])
+        {
+            elements += page ? page->allocator.GetUsed() : 0;
+        }
+
+        return elements * get_info(type).stride;
+    }
+
+    uint64_t GeometryPool::GetMemoryReserved(const GeometryPoolType type)
+    {
+        lock_guard lock(mutex_pool);
+
+        uint64_t elements = 0;
+        for (const unique_ptr<Page>& page : pages[static_cast<size_t>(type)])
+        {
+            elements += page ? page->allocator.GetCapacity() : 0;
+        }
+
+        return elements * get_info(type).stride;
+    }
+
+    float GeometryPool::GetFragmentation(const GeometryPoolType type)
+    {
+        lock_guard lock(mutex_pool);
+
+        // worst page
+        float fragmentation = 0.0f;
+        for (const unique_ptr<Page>& page : pages[static_cast<size_t>(type)])
+        {
+            if (page)
+            {
+                fragmentation = max(fragmentation, page->allocator.GetFragmentation());
+            }
+        }
+
+        return fragmentation;
+    }
+
+    uint32_t GeometryPool::GetDefragmentationCount()
+    {
+        lock_guard lock(mutex_pool);
+        return defragmentation_count;
+    }
+
+    bool GeometryPool::Test()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Geometry pool %s failed", name);
+                passed = false;
+            }
+        };
+
+        // two records overlap when they share a page and their ranges intersect
+        auto overlaps = [](const GeometryAllocation* a, const GeometryAllocation* b)
+        {
+            return a->page == b->page && a->offset < b->offset + b->count && b->offset < a->offset + a->count;
+        };
+
+        const GeometryPoolType type     = GeometryPoolType::Instance;
+        const uint32_t allocations_base = GetAllocationCount(type);
+        const uint64_t used_base        = GetMemoryUsed(type);
+        const uint32_t stride           = get_info(type).stride;
+
+        // allocate ranges of varying size
+        const uint32_t range_count = 256;
+        vector<Instance> instances(64, Instance::GetIdentity());
+        vector<GeometryAllocation*> allocations;
+        uint64_t used_expected = used_base;
+        for (uint32_t i = 0; i < range_count; i++)
+        {
+            const uint32_t count = 1 + (i * 7) % static_cast<uint32_t>(instances.size());
+            GeometryAllocation* allocation = Allocate(type, count, instances.data());
+            if (!allocation)
+            {
+                expect("allocation", false);
+                return passed;
+            }
+            expect("record", allocation->type == type && allocation->count == count && allocation->buffer != nullptr);
+            allocations.push_back(allocation);
+            used_expected += static_cast<uint64_t>(count) * stride;
+        }
+        expect("used after allocating", GetMemoryUsed(type) == used_expected);
+        expect("count after allocating", GetAllocationCount(type) == allocations_base + range_count);
+
+        bool disjoint = true;
+        for (size_t i = 0; i < allocations.size(); i++)
+        {
+            for (size_t j = i + 1; j < allocations.size(); j++)
+            {
+                disjoint = disjoint && !overlaps(allocations[i], allocations[j]);
+            }
+        }
+        expect("ranges disjoint", disjoint);
+
+        // free every other range, the ranges are only released on the next tick
+        vector<GeometryAllocation*> kept;
+        for (uint32_t i = 0; i < range_count; i++)
+        {
+            if (i % 2 == 0)
+            {
+                used_expected -= static_cast<uint64_t>(allocations[i]->count) * stride;
+                Free(allocations[i]);
+            }
+            else
+            {
+                kept.push_back(allocations[i]);
+            }
+        }
+        expect("frees are deferred", NeedsTick() && GetAllocationCount(type) == allocations_base + range_count);
+        Tick();
+        expect("used after freeing", GetMemoryUsed(type) == used_expected);
+        expect("count after freeing", GetAllocationCount(type) == allocations_base + range_count / 2);
+        expect("fragmented", GetFragmentation(type) > 0.0f);
+
+        // compaction moves the ranges but keeps them in order, without changing what's used
+        map<uint32_t, vector<pair<uint32_t, GeometryAllocation*>>> order_before; // page -> (offset, record)
+        for (GeometryAllocation* allocation : kept)
+        {
+            order_before[allocation->page].emplace_back(allocation->offset, allocation);
+        }
+        const uint32_t defragmentation_count_before = GetDefragmentationCount();
+        RequestDefragmentation();
+        Tick();
+        expect("compacted", GetDefragmentationCount() > defragmentation_count_before);
+        expect("not fragmented", GetFragmentation(type) == 0.0f);
+        expect("used after compacting", GetMemoryUsed(type) == used_expected);
+        expect("count after compacting", GetAllocationCount(type) == allocations_base + range_count / 2);
+
+        bool order_kept = true;
+        for (auto& [page, ranges] : order_before)
+        {
+            sort(ranges.begin(), ranges.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (size_t i = 1; i < ranges.size(); i++)
+            {
+                order_kept = order_kept && ranges[i - 1].second->offset < ranges[i].second->offset;
+            }
+        }
+        expect("order kept", order_kept);
+
+        // every page is packed, its ranges follow each other from offset 0 and its free space is a single range at the end
+        {
+            lock_guard lock(mutex_pool);
+            bool packed = true;
+            for (const unique_ptr<Page>& page : pages[static_cast<size_t>(type)])
+            {
+                if (!page)
+                    continue;
+
+                uint32_t end = 0;
+                for (const auto& [offset, allocation] : page->allocations)
+                {
+                    packed = packed && offset == end && allocation->offset == offset && allocation->buffer == page->buffer.get();
+                    end    = offset + allocation->count;
+                }
+                packed = packed && page->allocator.GetUsed() == end && page->allocator.GetFreeRangeCount() <= 1;
+            }
+            expect("pages packed", packed);
+        }
+
+        // release what's left, the pool is back to where it started
+        for (GeometryAllocation* allocation : kept)
+        {
+            Free(allocation);
+        }
+        Tick();
+        expect("used after releasing", GetMemoryUsed(type) == used_base);
+        expect("count after releasing", GetAllocationCount(type) == allocations_base);
+
+        return passed;
+    }
+}
@@ -0,0 +1,88 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =====
+#include <cstdint>
+//================
+
+namespace spartan
+{
+    class RHI_Buffer;
+
+    enum class GeometryPoolType : uint8_t
+    {
+        Vertex,   // RHI_Vertex_PosTexNorTan in, RHI_Vertex_PosTexNorTan_Gpu on the gpu
+        Index16,  // uint16_t
+        Index32,  // uint32_t
+        Instance, // Instance
+        Max
+    };
+
+    // a range of elements within one of the pool's pages, the record itself never moves so it
+    // can be held on to, but its buffer and offset can change when the pool gets defragmented
+    struct GeometryAllocation
+    {
+        GeometryPoolType type = GeometryPoolType::Max;
+        RHI_Buffer* buffer    = nullptr; // the page the elements live in
+        uint32_t page         = 0;
+        uint32_t offset       = 0;       // in elements
+        uint32_t count        = 0;       // in elements
+    };
+
+    // a few large vertex, index and instance buffers (pages) which meshes and renderables sub-allocate from,
+    // so that consecutive draws share the same buffers and don't have to rebind them
+    class GeometryPool
+    {
+    public:
+        static void Initialize();
+        static void Shutdown();
+
+        // releases freed ranges and defragments, must only be called when the gpu is idle
+        static void Tick();
+        static bool NeedsTick();
+
+        // the data is uploaded immediately (vertices are packed first), returns nullptr if the pool is not initialized
+        static GeometryAllocation* Allocate(const GeometryPoolType type, const uint32_t count, const void* data);
+
+        // the range is released on the next tick, once the gpu is done with it
+        static void Free(GeometryAllocation* allocation);
+
+        // compacts every page on the next tick, pages also compact themselves once they get too fragmented
+        static void RequestDefragmentation();
+
+        // a single identity instance, lets non-instanced draws keep the instance buffer bound
+        static const GeometryAllocation* GetIdentityInstance();
+
+        // stats
+        static uint32_t GetPageCount(const GeometryPoolType type);
+        static uint32_t GetAllocationCount(const GeometryPoolType type);
+        static uint64_t GetMemoryUsed(const GeometryPoolType type);
+        static uint64_t GetMemoryReserved(const GeometryPoolType type);
+        static float GetFragmentation(const GeometryPoolType type);
+        static uint32_t GetDefragmentationCount();
+
+        // allocates, frees every other range and compacts, checking offsets and stats, runs on the live pool so the gpu must be idle
+        static bool Test();
+    };
+}
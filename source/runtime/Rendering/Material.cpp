@@ -334,6 +334,19 @@ namespace spartan
             RHI_Texture* texture_roughness  = material->GetTexture(MaterialTextureType::Roughness, slot);
             RHI_Texture* texture_metalness  = material->GetTexture(MaterialTextureType::Metalness, slot);
             RHI_Texture* texture_height     = material->GetTexture(MaterialTextureType::Height, slot);
+
+            // textures that loaded compressed out of the texture cache need their pixels back if they are read below
+            if (texture_color && (texture_alpha_mask || material->GetProperty(MaterialProperty::NormalFromAlbedo) == 1.0f))
+            {
+                texture_color->DecodeSource();
+            }
+            for (RHI_Texture* texture : { texture_alpha_mask, texture_occlusion, texture_roughness, texture_metalness, texture_height })
+            {
+                if (texture)
+                {
+                    texture->DecodeSource();
+                }
+            }
         
             // check for normal_from_albedo flag
             if (material->GetProperty(MaterialProperty::NormalFromAlbedo) == 1.0f && texture_color && !texture_color->IsCompressedFormat())
@@ -390,7 +403,7 @@ namespace spartan
             uint32_t max_width = 1, max_height = 1;
             auto check_texture_res = [&](RHI_Texture* tex)
              {
-                 if (tex && !tex->IsCompressedFormat())
+                 if (tex && (!tex->IsCompressedFormat() || tex->IsCachedFromSource()))
                  {
                      max_width  = max(max_width, tex->GetWidth());
                      max_height = max(max_height, tex->GetHeight());
@@ -447,6 +460,9 @@ namespace spartan
                             {
                                 texture_processing::merge_alpha_mask_into_color_alpha(texture_color->GetMip(0, 0).bytes, texture_alpha_mask->GetMip(0, 0).bytes);
                             }
+
+                            // the color no longer matches its file, so it can't be cached under it
+                            texture_color->DetachFromSource();
                         }
                     }
                 }
@@ -641,6 +657,26 @@ namespace spartan
         doc.save_file(file_path.c_str());
     }
 
+    uint64_t Material::GetContentHash()
+    {
+        // mirrors what SaveToFile() writes: the properties and the texture references
+        uint64_t hash = math::hash_bytes(m_properties.data(), m_properties.size() * sizeof(float));
+        for (RHI_Texture* texture : m_textures)
+        {
+            if (texture)
+            {
+                const string& path = texture->GetResourceFilePath();
+                hash = math::hash_combine(hash, math::hash_bytes(path.data(), path.size()));
+            }
+            else
+            {
+                hash = math::hash_combine(hash, 0);
+            }
+        }
+
+        return hash != 0 ? hash : 1;
+    }
+
     void Material::SetTexture(const MaterialTextureType texture_type, RHI_Texture* texture, const uint8_t slot, const bool auto_adjust_multipler)
     {
         SP_ASSERT(slot < slots_per_texture);
@@ -762,10 +798,14 @@ namespace spartan
             lock_guard<mutex> lock(m_mutex);
 
             // prepare all textures
-            for (RHI_Texture* texture : m_textures)
+            for (uint32_t i = 0; i < static_cast<uint32_t>(m_textures.size()); i++)
             {
+                RHI_Texture* texture = m_textures[i];
                 if (texture && texture->GetResourceState() == ResourceState::Max)
                 {
+                    // the g-buffer decodes color as srgb, so mips have to be filtered in linear space, everything else is data
+                    const bool is_color = static_cast<MaterialTextureType>(i / slots_per_texture) == MaterialTextureType::Color;
+                    texture->SetFlag(RHI_Texture_Srgb, is_color);
                     texture->SetFlag(RHI_Texture_DontPrepareForGpu, false);
                     texture->PrepareForGpu();
                 }
@@ -37,9 +37,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI/RHI_Buffer.h"
 #include "../RHI/RHI_VendorTechnology.h"
 #include "../RHI/RHI_AccelerationStructure.h"
+#include "GeometryPool.h"
+#include "TextureStreaming.h"
 #include "../World/Entity.h"
 #include "../World/Components/Light.h"
 #include "../World/Components/Camera.h"
+#include "../World/Components/Animator.h"
+#include "../Geometry/GeometryProcessing.h"
 #include "../Core/ProgressTracker.h"
 #include "../Math/Rectangle.h"
 #include "../Resource/Import/ImageImporter.h"
@@ -220,6 +224,9 @@ namespace spartan
 
         // load/create resources
         {
+            // before any mesh gets created
+            GeometryPool::Initialize();
+
             // reduce startup time by doing expensive operations in another thread
             ThreadPool::AddTask([]()
             {
@@ -271,7 +278,12 @@ namespace spartan
 
         // manually destroy everything so that RHI_Device::ParseDeletionQueue() frees memory
         {
+            TextureStreaming::Shutdown();
+            Animator::Shutdown();
             DestroyResources();
+            m_cluster_ranges        = {};
+            m_cluster_ranges_shadow = {};
+            GeometryPool::Shutdown();
             swapchain             = nullptr;
             m_lines_vertex_buffer = nullptr;
             tlas                  = nullptr;
@@ -302,6 +314,9 @@ namespace spartan
 
         // update CPU and GPU resources
         {
+            // upload vertices that were skinned during the world tick
+            Animator::UploadVertices(m_cmd_list_present);
+
             // fill draw call list and determine ideal occluders
             UpdateDrawCalls(m_cmd_list_present);
 
@@ -316,10 +331,13 @@ namespace spartan
                 {
                     m_resource_index = 0;
     
-                    if (RHI_Device::DeletionQueueNeedsToParse())
+                    if (RHI_Device::DeletionQueueNeedsToParse() || GeometryPool::NeedsTick())
                     {
                         RHI_Device::QueueWaitAll();
                         RHI_Device::DeletionQueueParse();
+
+                        // after the parse, so that pages replaced by a defragmentation outlive this frame's commands
+                        GeometryPool::Tick();
                     }
     
                     GetBuffer(Renderer_Buffer::ConstantFrame)->ResetOffset();
@@ -339,8 +357,9 @@ namespace spartan
                     RHI_Device::UpdateBindlessResources(nullptr, nullptr, GetBuffer(Renderer_Buffer::LightParameters), nullptr, nullptr);
                 }
 
-                // materials
-                if (initialize || World::HaveMaterialsChangedThisFrame())
+                // materials, streamed textures that changed residency have new srvs
+                bool residency_changed = TextureStreaming::Tick();
+                if (initialize || World::HaveMaterialsChangedThisFrame() || residency_changed)
                 {
                     UpdateMaterials(m_cmd_list_present);
                     RHI_Device::UpdateBindlessResources(&m_bindless_textures, GetBuffer(Renderer_Buffer::MaterialParameters), nullptr, nullptr, nullptr);
@@ -1088,8 +1107,10 @@ namespace spartan
                     draw_call.lod_index          = renderable->GetLodIndex();
                     draw_call.is_occluder        = false;
                     draw_call.camera_visible     = renderable->IsVisible();
-                    draw_call.instance_index     = 0;
-                    draw_call.instance_count     = renderable->GetInstanceCount();
+                    draw_call.instance_index       = renderable->GetInstanceOffset();
+                    draw_call.instance_count       = renderable->GetInstanceCount();
+                    draw_call.cluster_range_offset = 0;
+                    draw_call.cluster_range_count  = 0;
                 }
             }
 
@@ -1124,6 +1145,37 @@ namespace spartan
             });
         }
 
+        // cull the clusters of large meshes, so that only their visible parts are submitted
+        m_cluster_ranges.clear();
+        if (Camera* camera = World::GetCamera())
+        {
+            const Vector3 camera_position = camera->GetEntity()->GetPosition();
+            const bool is_wireframe       = GetOption<bool>(Renderer_Option::Wireframe);
+
+            for (uint32_t i = 0; i < m_draw_call_count; i++)
+            {
+                Renderer_DrawCall& draw_call        = m_draw_calls[i];
+                Renderable* renderable              = draw_call.renderable;
+                const vector<MeshCluster>& clusters = renderable->GetClusters();
+                if (!draw_call.camera_visible || draw_call.lod_index != 0 || clusters.empty() || renderable->HasInstancing())
+                    continue;
+
+                const RHI_CullMode cull_mode = static_cast<RHI_CullMode>(renderable->GetMaterial()->GetProperty(MaterialProperty::CullMode));
+                const bool cull_back_facing  = cull_mode == RHI_CullMode::Back && !is_wireframe;
+                const uint32_t offset        = static_cast<uint32_t>(m_cluster_ranges.size());
+                const bool ignore_depth      = false;
+
+                if (geometry_processing::cull_clusters(clusters, renderable->GetEntity()->GetMatrix(), camera->GetFrustum(), camera_position, cull_back_facing, ignore_depth, m_cluster_ranges) == 0)
+                {
+                    draw_call.camera_visible = false;
+                    continue;
+                }
+
+                draw_call.cluster_range_offset = offset;
+                draw_call.cluster_range_count  = static_cast<uint32_t>(m_cluster_ranges.size()) - offset;
+            }
+        }
+
         // build prepass calls: opaques only, sorted by alpha test (non-alpha first), then depth front-to-back
         {
             for (uint32_t i = 0; i < m_draw_call_count; ++i)
@@ -1232,7 +1284,7 @@ namespace spartan
 
                 if (Renderable* renderable = entity->GetComponent<Renderable>())
                 {
-                    if (!renderable->HasAccelerationStructure())
+                    if (!renderable->HasAccelerationStructure() || renderable->IsAccelerationStructureStale())
                     {
                         renderable->BuildAccelerationStructure(cmd_list);
                     }
@@ -1259,6 +1311,10 @@ namespace spartan
     
                if (Renderable* renderable = entity->GetComponent<Renderable>())
                 {
+                    // renderables without a blas (e.g. a mesh that is still loading) are left out, skinned ones are refit above
+                    if (!renderable->HasAccelerationStructure())
+                        continue;
+
                     if (Material* material = renderable->GetMaterial())
                     {
                         RHI_CullMode cull_mode = static_cast<RHI_CullMode>(material->GetProperty(MaterialProperty::CullMode));
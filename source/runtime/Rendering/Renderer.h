@@ -209,6 +209,9 @@ namespace spartan
         static uint32_t m_draw_call_count;
         static std::array<Renderer_DrawCall, renderer_max_draw_calls> m_draw_calls_prepass;
         static uint32_t m_draw_calls_prepass_count;
+        static std::vector<MeshClusterRange> m_cluster_ranges;        // visible clusters of the camera's draw calls
+        static std::vector<MeshClusterRange> m_cluster_ranges_shadow; // scratch for the shadow pass, one draw call at a time
+        static void DrawRenderable(RHI_CommandList* cmd_list, const Renderer_DrawCall& draw_call, const uint32_t lod_index, const MeshClusterRange* ranges, const uint32_t range_count);
 
         // bindless
         static std::array<RHI_Texture*, rhi_max_array_size> m_bindless_textures;
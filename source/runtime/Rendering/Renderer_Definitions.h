@@ -322,6 +322,10 @@ namespace spartan
         float distance_squared  = 0.0f;
         bool is_occluder        = false;
         bool camera_visible     = false;
+
+        // visible clusters of lod 0 (a range within Renderer::m_cluster_ranges), zero means the whole lod is drawn
+        uint32_t cluster_range_offset = 0;
+        uint32_t cluster_range_count  = 0;
     };
 
 }
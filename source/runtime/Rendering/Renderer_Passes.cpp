@@ -34,6 +34,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI/RHI_VendorTechnology.h"
 #include "../RHI/RHI_RasterizerState.h"
 #include "../RHI/RHI_Device.h"
+#include "../Geometry/GeometryProcessing.h"
 SP_WARNINGS_OFF
 #include "bend_sss_cpu.h"
 SP_WARNINGS_ON
@@ -50,8 +51,28 @@ namespace spartan
     uint32_t Renderer::m_draw_call_count;
     array<Renderer_DrawCall, renderer_max_draw_calls> Renderer::m_draw_calls_prepass;
     uint32_t Renderer::m_draw_calls_prepass_count;
+    vector<MeshClusterRange> Renderer::m_cluster_ranges;
+    vector<MeshClusterRange> Renderer::m_cluster_ranges_shadow;
     unique_ptr<RHI_Buffer> Renderer::m_std_reflections;
 
+    void Renderer::DrawRenderable(RHI_CommandList* cmd_list, const Renderer_DrawCall& draw_call, const uint32_t lod_index, const MeshClusterRange* ranges, const uint32_t range_count)
+    {
+        Renderable* renderable       = draw_call.renderable;
+        const uint32_t index_offset  = renderable->GetIndexOffset(lod_index);
+        const uint32_t vertex_offset = renderable->GetVertexOffset(lod_index);
+
+        if (range_count == 0)
+        {
+            cmd_list->DrawIndexed(renderable->GetIndexCount(lod_index), index_offset, vertex_offset, draw_call.instance_index, draw_call.instance_count);
+            return;
+        }
+
+        for (uint32_t i = 0; i < range_count; i++)
+        {
+            cmd_list->DrawIndexed(ranges[i].index_count, index_offset + ranges[i].index_offset, vertex_offset, draw_call.instance_index, draw_call.instance_count);
+        }
+    }
+
     void Renderer::SetStandardResources(RHI_CommandList* cmd_list)
     {
         cmd_list->SetConstantBuffer(Renderer_BindingsCb::frame, GetBuffer(Renderer_Buffer::ConstantFrame));
@@ -277,13 +298,19 @@ namespace spartan
                             uint32_t lod_index_shadow = clamp(renderable->GetLodIndex() + lod_index_bias, 0u, renderable->GetLodCount() - 1); // lod index biased towards lower quality lod
                             uint32_t lod_index        = close_to_shadow ? draw_call.lod_index : lod_index_shadow;                             // use normal lod if close to shadow caster, otherwise use light specific lod
 
-                            cmd_list->DrawIndexed(
-                                renderable->GetIndexCount(lod_index),
-                                renderable->GetIndexOffset(lod_index),
-                                renderable->GetVertexOffset(lod_index),
-                                draw_call.instance_index,
-                                draw_call.instance_count
-                            );
+                            // clusters are culled against the light's frustum only, back-facing ones can still cast shadows
+                            vector<MeshClusterRange>& ranges = m_cluster_ranges_shadow;
+                            ranges.clear();
+                            const vector<MeshCluster>& clusters = renderable->GetClusters();
+                            if (lod_index == 0 && !clusters.empty() && !renderable->HasInstancing())
+                            {
+                                const bool cull_back_facing = false;
+                                const bool ignore_depth     = light->GetLightType() == LightType::Directional;
+                                if (geometry_processing::cull_clusters(clusters, renderable->GetEntity()->GetMatrix(), light->GetFrustum(array_index), Vector3::Zero, cull_back_facing, ignore_depth, ranges) == 0)
+                                    continue;
+                            }
+
+                            DrawRenderable(cmd_list, draw_call, lod_index, ranges.data(), static_cast<uint32_t>(ranges.size()));
                         }
                     }
                 }
@@ -561,13 +588,7 @@ namespace spartan
                     cmd_list->SetBufferVertex(renderable->GetVertexBuffer(), renderable->GetInstanceBuffer());
                     cmd_list->SetBufferIndex(renderable->GetIndexBuffer());
 
-                    cmd_list->DrawIndexed(
-                        renderable->GetIndexCount(draw_call.lod_index),
-                        renderable->GetIndexOffset(draw_call.lod_index),
-                        renderable->GetVertexOffset(draw_call.lod_index),
-                        draw_call.instance_index,
-                        draw_call.instance_count
-                    );
+                    DrawRenderable(cmd_list, draw_call, draw_call.lod_index, m_cluster_ranges.data() + draw_call.cluster_range_offset, draw_call.cluster_range_count);
 
                     // at this point, we don't want clear in case another render pass is implicitly started
                     pso.clear_depth = rhi_depth_load;
@@ -659,13 +680,7 @@ namespace spartan
                     cmd_list->SetBufferVertex(renderable->GetVertexBuffer(), renderable->GetInstanceBuffer());
                     cmd_list->SetBufferIndex(renderable->GetIndexBuffer());
     
-                    cmd_list->DrawIndexed(
-                        renderable->GetIndexCount(draw_call.lod_index),
-                        renderable->GetIndexOffset(draw_call.lod_index),
-                        renderable->GetVertexOffset(draw_call.lod_index),
-                        draw_call.instance_index,
-                        draw_call.instance_count
-                    );
+                    DrawRenderable(cmd_list, draw_call, draw_call.lod_index, m_cluster_ranges.data() + draw_call.cluster_range_offset, draw_call.cluster_range_count);
 
                     // at this point, we don't want clear in case another render pass is implicitly started
                     pso.clear_depth = rhi_depth_load;
@@ -1891,9 +1906,10 @@ namespace spartan
         }
 
         cmd_list->SetCullMode(RHI_CullMode::Back);
-        cmd_list->SetBufferVertex(GetStandardMesh(MeshType::Quad)->GetVertexBuffer());
-        cmd_list->SetBufferIndex(GetStandardMesh(MeshType::Quad)->GetIndexBuffer());
-        cmd_list->DrawIndexed(6);
+        Mesh* quad = GetStandardMesh(MeshType::Quad).get();
+        cmd_list->SetBufferVertex(quad->GetVertexBuffer());
+        cmd_list->SetBufferIndex(quad->GetIndexBuffer());
+        cmd_list->DrawIndexed(6, quad->GetIndexBufferOffset(), quad->GetVertexBufferOffset());
 
         cmd_list->EndTimeblock();
     }
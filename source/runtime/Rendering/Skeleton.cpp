@@ -0,0 +1,575 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES =====================
+#include "pch.h"
+#include "Skeleton.h"
+#include "../RHI/RHI_Vertex.h"
+//================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace spartan::math;
+//============================
+
+namespace spartan
+{
+    namespace
+    {
+        template<typename T>
+        void write(vector<uint8_t>& data, const T& value)
+        {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            data.insert(data.end(), bytes, bytes + sizeof(T));
+        }
+
+        template<typename T>
+        bool read(const uint8_t*& data, const uint8_t* end, T& value)
+        {
+            if (data + sizeof(T) > end)
+                return false;
+
+            memcpy(&value, data, sizeof(T));
+            data += sizeof(T);
+            return true;
+        }
+
+        // the rows of an affine matrix (the fourth column is implied), so that a row vector can be transformed with three fmas
+        struct alignas(16) SkinningRows
+        {
+            float rows[4][4];
+        };
+    }
+
+    void Pose::Resize(const uint32_t bone_count)
+    {
+        m_bone_count = bone_count;
+        m_stride     = GetStride(bone_count);
+        m_data.assign(channel_count * m_stride, 0.0f);
+
+        // the padding holds identity transforms, so that it never produces nans
+        fill_n(GetChannel(PoseChannel::RotationW), m_stride, 1.0f);
+        fill_n(GetChannel(PoseChannel::ScaleX),    m_stride, 1.0f);
+        fill_n(GetChannel(PoseChannel::ScaleY),    m_stride, 1.0f);
+        fill_n(GetChannel(PoseChannel::ScaleZ),    m_stride, 1.0f);
+    }
+
+    void Pose::SetBone(const uint32_t index, const Vector3& position, const Quaternion& rotation, const Vector3& scale)
+    {
+        SP_ASSERT(index < m_bone_count);
+
+        GetChannel(PoseChannel::PositionX)[index] = position.x;
+        GetChannel(PoseChannel::PositionY)[index] = position.y;
+        GetChannel(PoseChannel::PositionZ)[index] = position.z;
+        GetChannel(PoseChannel::RotationX)[index] = rotation.x;
+        GetChannel(PoseChannel::RotationY)[index] = rotation.y;
+        GetChannel(PoseChannel::RotationZ)[index] = rotation.z;
+        GetChannel(PoseChannel::RotationW)[index] = rotation.w;
+        GetChannel(PoseChannel::ScaleX)[index]    = scale.x;
+        GetChannel(PoseChannel::ScaleY)[index]    = scale.y;
+        GetChannel(PoseChannel::ScaleZ)[index]    = scale.z;
+    }
+
+    void Pose::NormalizeRotations()
+    {
+        float* x = GetChannel(PoseChannel::RotationX);
+        float* y = GetChannel(PoseChannel::RotationY);
+        float* z = GetChannel(PoseChannel::RotationZ);
+        float* w = GetChannel(PoseChannel::RotationW);
+
+    #if defined(__AVX2__)
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (uint32_t i = 0; i < m_stride; i += 8)
+        {
+            const __m256 qx = _mm256_loadu_ps(x + i), qy = _mm256_loadu_ps(y + i), qz = _mm256_loadu_ps(z + i), qw = _mm256_loadu_ps(w + i);
+
+            __m256 length_squared = _mm256_mul_ps(qx, qx);
+            length_squared        = _mm256_fmadd_ps(qy, qy, length_squared);
+            length_squared        = _mm256_fmadd_ps(qz, qz, length_squared);
+            length_squared        = _mm256_fmadd_ps(qw, qw, length_squared);
+            const __m256 length_inverse = _mm256_div_ps(one, _mm256_sqrt_ps(length_squared));
+
+            _mm256_storeu_ps(x + i, _mm256_mul_ps(qx, length_inverse));
+            _mm256_storeu_ps(y + i, _mm256_mul_ps(qy, length_inverse));
+            _mm256_storeu_ps(z + i, _mm256_mul_ps(qz, length_inverse));
+            _mm256_storeu_ps(w + i, _mm256_mul_ps(qw, length_inverse));
+        }
+    #else
+        for (uint32_t i = 0; i < m_stride; i++)
+        {
+            const float length_inverse = 1.0f / sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i] + w[i] * w[i]);
+            x[i] *= length_inverse;
+            y[i] *= length_inverse;
+            z[i] *= length_inverse;
+            w[i] *= length_inverse;
+        }
+    #endif
+    }
+
+    void Pose::Blend(const Pose& a, const Pose& b, const float weight, Pose& out)
+    {
+        SP_ASSERT(a.m_stride == b.m_stride);
+
+        if (out.m_stride != a.m_stride)
+        {
+            out.Resize(a.m_bone_count);
+        }
+
+        const uint32_t stride = a.m_stride;
+        const PoseChannel linear_channels[] =
+        {
+            PoseChannel::PositionX, PoseChannel::PositionY, PoseChannel::PositionZ,
+            PoseChannel::ScaleX,    PoseChannel::ScaleY,    PoseChannel::ScaleZ
+        };
+
+        const float* ax = a.GetChannel(PoseChannel::RotationX);
+        const float* ay = a.GetChannel(PoseChannel::RotationY);
+        const float* az = a.GetChannel(PoseChannel::RotationZ);
+        const float* aw = a.GetChannel(PoseChannel::RotationW);
+        const float* bx = b.GetChannel(PoseChannel::RotationX);
+        const float* by = b.GetChannel(PoseChannel::RotationY);
+        const float* bz = b.GetChannel(PoseChannel::RotationZ);
+        const float* bw = b.GetChannel(PoseChannel::RotationW);
+        float* ox       = out.GetChannel(PoseChannel::RotationX);
+        float* oy       = out.GetChannel(PoseChannel::RotationY);
+        float* oz       = out.GetChannel(PoseChannel::RotationZ);
+        float* ow       = out.GetChannel(PoseChannel::RotationW);
+
+    #if defined(__AVX2__)
+        const __m256 w = _mm256_set1_ps(weight);
+
+        for (PoseChannel channel : linear_channels)
+        {
+            const float* source_a = a.GetChannel(channel);
+            const float* source_b = b.GetChannel(channel);
+            float* destination    = out.GetChannel(channel);
+            for (uint32_t i = 0; i < stride; i += 8)
+            {
+                const __m256 va = _mm256_loadu_ps(source_a + i);
+                const __m256 vb = _mm256_loadu_ps(source_b + i);
+                _mm256_storeu_ps(destination + i, _mm256_fmadd_ps(_mm256_sub_ps(vb, va), w, va));
+            }
+        }
+
+        const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+        for (uint32_t i = 0; i < stride; i += 8)
+        {
+            const __m256 qax = _mm256_loadu_ps(ax + i), qay = _mm256_loadu_ps(ay + i), qaz = _mm256_loadu_ps(az + i), qaw = _mm256_loadu_ps(aw + i);
+            __m256 qbx       = _mm256_loadu_ps(bx + i), qby = _mm256_loadu_ps(by + i), qbz = _mm256_loadu_ps(bz + i), qbw = _mm256_loadu_ps(bw + i);
+
+            // take the shortest path, q and -q are the same rotation
+            __m256 dot = _mm256_mul_ps(qax, qbx);
+            dot        = _mm256_fmadd_ps(qay, qby, dot);
+            dot        = _mm256_fmadd_ps(qaz, qbz, dot);
+            dot        = _mm256_fmadd_ps(qaw, qbw, dot);
+            const __m256 flip = _mm256_and_ps(dot, sign_bit);
+            qbx = _mm256_xor_ps(qbx, flip);
+            qby = _mm256_xor_ps(qby, flip);
+            qbz = _mm256_xor_ps(qbz, flip);
+            qbw = _mm256_xor_ps(qbw, flip);
+
+            _mm256_storeu_ps(ox + i, _mm256_fmadd_ps(_mm256_sub_ps(qbx, qax), w, qax));
+            _mm256_storeu_ps(oy + i, _mm256_fmadd_ps(_mm256_sub_ps(qby, qay), w, qay));
+            _mm256_storeu_ps(oz + i, _mm256_fmadd_ps(_mm256_sub_ps(qbz, qaz), w, qaz));
+            _mm256_storeu_ps(ow + i, _mm256_fmadd_ps(_mm256_sub_ps(qbw, qaw), w, qaw));
+        }
+    #else
+        for (PoseChannel channel : linear_channels)
+        {
+            const float* source_a = a.GetChannel(channel);
+            const float* source_b = b.GetChannel(channel);
+            float* destination    = out.GetChannel(channel);
+            for (uint32_t i = 0; i < stride; i++)
+            {
+                destination[i] = source_a[i] + (source_b[i] - source_a[i]) * weight;
+            }
+        }
+
+        for (uint32_t i = 0; i < stride; i++)
+        {
+            const float dot  = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i] + aw[i] * bw[i];
+            const float sign = dot < 0.0f ? -1.0f : 1.0f;
+
+            ox[i] = ax[i] + (bx[i] * sign - ax[i]) * weight;
+            oy[i] = ay[i] + (by[i] * sign - ay[i]) * weight;
+            oz[i] = az[i] + (bz[i] * sign - az[i]) * weight;
+            ow[i] = aw[i] + (bw[i] * sign - aw[i]) * weight;
+        }
+    #endif
+
+        out.NormalizeRotations();
+    }
+
+    uint32_t Skeleton::AddBone(const SkeletonBone& bone)
+    {
+        SP_ASSERT_MSG(bone.parent < static_cast<int32_t>(m_bones.size()), "Parents must be added before their children");
+
+        m_bones.emplace_back(bone);
+        return static_cast<uint32_t>(m_bones.size()) - 1;
+    }
+
+    int32_t Skeleton::FindBone(const string& name) const
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_bones.size()); i++)
+        {
+            if (m_bones[i].name == name)
+                return static_cast<int32_t>(i);
+        }
+
+        return -1;
+    }
+
+    void Skeleton::Clear()
+    {
+        m_bones.clear();
+        m_mesh_transform_inverse = Matrix::Identity;
+    }
+
+    uint64_t Skeleton::GetLayoutHash() const
+    {
+        uint64_t hash = m_bones.size();
+        for (const SkeletonBone& bone : m_bones)
+        {
+            hash = hash_combine(hash, hash_bytes(bone.name.data(), bone.name.size()));
+            hash = hash_combine(hash, static_cast<uint64_t>(static_cast<int64_t>(bone.parent)));
+        }
+
+        return hash;
+    }
+
+    void Skeleton::Serialize(vector<uint8_t>& data) const
+    {
+        write(data, static_cast<uint32_t>(m_bones.size()));
+        write(data, m_mesh_transform_inverse);
+
+        for (const SkeletonBone& bone : m_bones)
+        {
+            write(data, static_cast<uint32_t>(bone.name.size()));
+            data.insert(data.end(), bone.name.begin(), bone.name.end());
+            write(data, bone.parent);
+            write(data, bone.inverse_bind);
+            write(data, bone.position);
+            write(data, bone.rotation);
+            write(data, bone.scale);
+        }
+    }
+
+    bool Skeleton::Deserialize(const uint8_t* data, const uint64_t size)
+    {
+        Clear();
+
+        const uint8_t* end = data + size;
+        uint32_t bone_count = 0;
+        if (!read(data, end, bone_count) || !read(data, end, m_mesh_transform_inverse))
+            return false;
+
+        m_bones.resize(bone_count);
+        for (uint32_t i = 0; i < bone_count; i++)
+        {
+            SkeletonBone& bone   = m_bones[i];
+            uint32_t name_length = 0;
+            if (!read(data, end, name_length) || data + name_length > end)
+                return false;
+
+            bone.name.assign(reinterpret_cast<const char*>(data), name_length);
+            data += name_length;
+
+            bool valid = read(data, end, bone.parent) &&
+                         read(data, end, bone.inverse_bind) &&
+                         read(data, end, bone.position) &&
+                         read(data, end, bone.rotation) &&
+                         read(data, end, bone.scale);
+
+            if (!valid || bone.parent >= static_cast<int32_t>(i))
+            {
+                Clear();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void Skeleton::GetBindPose(Pose& pose) const
+    {
+        pose.Resize(GetBoneCount());
+        for (uint32_t i = 0; i < GetBoneCount(); i++)
+        {
+            pose.SetBone(i, m_bones[i].position, m_bones[i].rotation, m_bones[i].scale);
+        }
+    }
+
+    void Skeleton::ComputeModelSpace(const Pose& pose, Matrix* model) const
+    {
+        SP_ASSERT(pose.GetBoneCount() == GetBoneCount());
+
+        const uint32_t bone_count = GetBoneCount();
+        const float* tx = pose.GetChannel(PoseChannel::PositionX);
+        const float* ty = pose.GetChannel(PoseChannel::PositionY);
+        const float* tz = pose.GetChannel(PoseChannel::PositionZ);
+        const float* qx = pose.GetChannel(PoseChannel::RotationX);
+        const float* qy = pose.GetChannel(PoseChannel::RotationY);
+        const float* qz = pose.GetChannel(PoseChannel::RotationZ);
+        const float* qw = pose.GetChannel(PoseChannel::RotationW);
+        const float* sx = pose.GetChannel(PoseChannel::ScaleX);
+        const float* sy = pose.GetChannel(PoseChannel::ScaleY);
+        const float* sz = pose.GetChannel(PoseChannel::ScaleZ);
+
+        // 8 local matrices at a time (scale * rotation, then translation), same layout as Matrix(translation, rotation, scale)
+        alignas(32) float m[12][8];
+        for (uint32_t first = 0; first < bone_count; first += 8)
+        {
+        #if defined(__AVX2__)
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 two = _mm256_set1_ps(2.0f);
+            const __m256 x   = _mm256_loadu_ps(qx + first);
+            const __m256 y   = _mm256_loadu_ps(qy + first);
+            const __m256 z   = _mm256_loadu_ps(qz + first);
+            const __m256 w   = _mm256_loadu_ps(qw + first);
+            const __m256 scale_x = _mm256_loadu_ps(sx + first);
+            const __m256 scale_y = _mm256_loadu_ps(sy + first);
+            const __m256 scale_z = _mm256_loadu_ps(sz + first);
+
+            const __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+            const __m256 xy = _mm256_mul_ps(x, y), zw = _mm256_mul_ps(z, w), xz = _mm256_mul_ps(z, x);
+            const __m256 yw = _mm256_mul_ps(y, w), yz = _mm256_mul_ps(y, z), xw = _mm256_mul_ps(x, w);
+
+            _mm256_store_ps(m[0],  _mm256_mul_ps(scale_x, _mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one)));
+            _mm256_store_ps(m[1],  _mm256_mul_ps(scale_x, _mm256_mul_ps(two, _mm256_add_ps(xy, zw))));
+            _mm256_store_ps(m[2],  _mm256_mul_ps(scale_x, _mm256_mul_ps(two, _mm256_sub_ps(xz, yw))));
+            _mm256_store_ps(m[3],  _mm256_mul_ps(scale_y, _mm256_mul_ps(two, _mm256_sub_ps(xy, zw))));
+            _mm256_store_ps(m[4],  _mm256_mul_ps(scale_y, _mm256_fnmadd_ps(two, _mm256_add_ps(zz, xx), one)));
+            _mm256_store_ps(m[5],  _mm256_mul_ps(scale_y, _mm256_mul_ps(two, _mm256_add_ps(yz, xw))));
+            _mm256_store_ps(m[6],  _mm256_mul_ps(scale_z, _mm256_mul_ps(two, _mm256_add_ps(xz, yw))));
+            _mm256_store_ps(m[7],  _mm256_mul_ps(scale_z, _mm256_mul_ps(two, _mm256_sub_ps(yz, xw))));
+            _mm256_store_ps(m[8],  _mm256_mul_ps(scale_z, _mm256_fnmadd_ps(two, _mm256_add_ps(yy, xx), one)));
+            _mm256_store_ps(m[9],  _mm256_loadu_ps(tx + first));
+            _mm256_store_ps(m[10], _mm256_loadu_ps(ty + first));
+            _mm256_store_ps(m[11], _mm256_loadu_ps(tz + first));
+        #else
+            for (uint32_t j = 0; j < 8; j++)
+            {
+                const uint32_t i = first + j;
+                const float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+
+                m[0][j]  = sx[i] * (1.0f - 2.0f * (y * y + z * z));
+                m[1][j]  = sx[i] * (2.0f * (x * y + z * w));
+                m[2][j]  = sx[i] * (2.0f * (z * x - y * w));
+                m[3][j]  = sy[i] * (2.0f * (x * y - z * w));
+                m[4][j]  = sy[i] * (1.0f - 2.0f * (z * z + x * x));
+                m[5][j]  = sy[i] * (2.0f * (y * z + x * w));
+                m[6][j]  = sz[i] * (2.0f * (z * x + y * w));
+                m[7][j]  = sz[i] * (2.0f * (y * z - x * w));
+                m[8][j]  = sz[i] * (1.0f - 2.0f * (y * y + x * x));
+                m[9][j]  = tx[i];
+                m[10][j] = ty[i];
+                m[11][j] = tz[i];
+            }
+        #endif
+
+            // parents precede children, so they are already resolved
+            const uint32_t last = min(first + 8, bone_count);
+            for (uint32_t i = first; i < last; i++)
+            {
+                const uint32_t j = i - first;
+                const Matrix local
+                (
+                    m[0][j], m[1][j],  m[2][j],  0.0f,
+                    m[3][j], m[4][j],  m[5][j],  0.0f,
+                    m[6][j], m[7][j],  m[8][j],  0.0f,
+                    m[9][j], m[10][j], m[11][j], 1.0f
+                );
+
+                const int32_t parent = m_bones[i].parent;
+                model[i]             = parent < 0 ? local : local * model[parent];
+            }
+        }
+    }
+
+    void Skeleton::ComputeSkinning(const Matrix* model, Matrix* skinning) const
+    {
+        const bool has_mesh_transform = m_mesh_transform_inverse != Matrix::Identity;
+        for (uint32_t i = 0; i < GetBoneCount(); i++)
+        {
+            skinning[i] = m_bones[i].inverse_bind * model[i];
+            if (has_mesh_transform)
+            {
+                skinning[i] = skinning[i] * m_mesh_transform_inverse;
+            }
+        }
+    }
+
+    BoundingBox Skeleton::Skin(
+        const RHI_Vertex_PosTexNorTan* vertices,
+        const BoneWeights* weights,
+        const uint32_t vertex_count,
+        const Matrix* skinning,
+        const uint32_t bone_count,
+        RHI_Vertex_PosTexNorTan* vertices_out
+    )
+    {
+        // transpose once per bone instead of once per influence
+        thread_local vector<SkinningRows> rows;
+        rows.resize(bone_count);
+        for (uint32_t i = 0; i < bone_count; i++)
+        {
+            const Matrix& matrix = skinning[i];
+            rows[i] =
+            {{
+                { matrix.m00, matrix.m01, matrix.m02, 0.0f },
+                { matrix.m10, matrix.m11, matrix.m12, 0.0f },
+                { matrix.m20, matrix.m21, matrix.m22, 0.0f },
+                { matrix.m30, matrix.m31, matrix.m32, 0.0f }
+            }};
+        }
+
+    #if defined(__AVX2__)
+        __m128 box_min = _mm_set1_ps(numeric_limits<float>::max());
+        __m128 box_max = _mm_set1_ps(numeric_limits<float>::lowest());
+        alignas(16) float result[4];
+
+        auto normalize3 = [](const __m128 v)
+        {
+            const __m128 length_squared = _mm_dp_ps(v, v, 0x77);
+            return _mm_mul_ps(v, _mm_rsqrt_ps(_mm_max_ps(length_squared, _mm_set1_ps(FLT_MIN))));
+        };
+
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            const RHI_Vertex_PosTexNorTan& vertex = vertices[v];
+            RHI_Vertex_PosTexNorTan& vertex_out   = vertices_out[v];
+            const BoneWeights& influence          = weights[v];
+            vertex_out                            = vertex;
+
+            if (influence.weight[0] == 0.0f)
+            {
+                const __m128 position = _mm_setr_ps(vertex.pos[0], vertex.pos[1], vertex.pos[2], 0.0f);
+                box_min = _mm_min_ps(box_min, position);
+                box_max = _mm_max_ps(box_max, position);
+                continue;
+            }
+
+            // blend the matrices of all influences
+            __m128 r0 = _mm_setzero_ps(), r1 = _mm_setzero_ps(), r2 = _mm_setzero_ps(), r3 = _mm_setzero_ps();
+            for (uint32_t k = 0; k < 4; k++)
+            {
+                if (influence.weight[k] == 0.0f)
+                    break;
+
+                const SkinningRows& bone = rows[influence.bone[k] < bone_count ? influence.bone[k] : 0];
+                const __m128 weight      = _mm_set1_ps(influence.weight[k]);
+                r0 = _mm_fmadd_ps(_mm_load_ps(bone.rows[0]), weight, r0);
+                r1 = _mm_fmadd_ps(_mm_load_ps(bone.rows[1]), weight, r1);
+                r2 = _mm_fmadd_ps(_mm_load_ps(bone.rows[2]), weight, r2);
+                r3 = _mm_fmadd_ps(_mm_load_ps(bone.rows[3]), weight, r3);
+            }
+
+            __m128 position = _mm_fmadd_ps(_mm_set1_ps(vertex.pos[0]), r0, r3);
+            position        = _mm_fmadd_ps(_mm_set1_ps(vertex.pos[1]), r1, position);
+            position        = _mm_fmadd_ps(_mm_set1_ps(vertex.pos[2]), r2, position);
+
+            __m128 normal = _mm_mul_ps(_mm_set1_ps(vertex.nor[0]), r0);
+            normal        = _mm_fmadd_ps(_mm_set1_ps(vertex.nor[1]), r1, normal);
+            normal        = normalize3(_mm_fmadd_ps(_mm_set1_ps(vertex.nor[2]), r2, normal));
+
+            __m128 tangent = _mm_mul_ps(_mm_set1_ps(vertex.tan[0]), r0);
+            tangent        = _mm_fmadd_ps(_mm_set1_ps(vertex.tan[1]), r1, tangent);
+            tangent        = normalize3(_mm_fmadd_ps(_mm_set1_ps(vertex.tan[2]), r2, tangent));
+
+            box_min = _mm_min_ps(box_min, position);
+            box_max = _mm_max_ps(box_max, position);
+
+            _mm_store_ps(result, position);
+            memcpy(vertex_out.pos, result, sizeof(vertex_out.pos));
+            _mm_store_ps(result, normal);
+            memcpy(vertex_out.nor, result, sizeof(vertex_out.nor));
+            _mm_store_ps(result, tangent);
+            memcpy(vertex_out.tan, result, sizeof(vertex_out.tan));
+        }
+
+        alignas(16) float min_out[4];
+        alignas(16) float max_out[4];
+        _mm_store_ps(min_out, box_min);
+        _mm_store_ps(max_out, box_max);
+        return vertex_count ? BoundingBox(Vector3(min_out[0], min_out[1], min_out[2]), Vector3(max_out[0], max_out[1], max_out[2])) : BoundingBox::Zero;
+    #else
+        Vector3 box_min = Vector3::Infinity;
+        Vector3 box_max = Vector3::InfinityNeg;
+
+        auto transform = [](const float r[4][4], const float* v, const float w, float* out)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                out[c] = v[0] * r[0][c] + v[1] * r[1][c] + v[2] * r[2][c] + w * r[3][c];
+            }
+        };
+
+        auto normalize3 = [](float* v)
+        {
+            const float length = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            if (length > 0.0f)
+            {
+                v[0] /= length;
+                v[1] /= length;
+                v[2] /= length;
+            }
+        };
+
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            const RHI_Vertex_PosTexNorTan& vertex = vertices[v];
+            RHI_Vertex_PosTexNorTan& vertex_out   = vertices_out[v];
+            const BoneWeights& influence          = weights[v];
+            vertex_out                            = vertex;
+
+            if (influence.weight[0] != 0.0f)
+            {
+                // blend the matrices of all influences
+                float r[4][4] = {};
+                for (uint32_t k = 0; k < 4 && influence.weight[k] != 0.0f; k++)
+                {
+                    const SkinningRows& bone = rows[influence.bone[k] < bone_count ? influence.bone[k] : 0];
+                    for (uint32_t row = 0; row < 4; row++)
+                    {
+                        for (uint32_t c = 0; c < 3; c++)
+                        {
+                            r[row][c] += bone.rows[row][c] * influence.weight[k];
+                        }
+                    }
+                }
+
+                transform(r, vertex.pos, 1.0f, vertex_out.pos);
+                transform(r, vertex.nor, 0.0f, vertex_out.nor);
+                transform(r, vertex.tan, 0.0f, vertex_out.tan);
+                normalize3(vertex_out.nor);
+                normalize3(vertex_out.tan);
+            }
+
+            const Vector3 position(vertex_out.pos[0], vertex_out.pos[1], vertex_out.pos[2]);
+            box_min = Vector3::Min(box_min, position);
+            box_max = Vector3::Max(box_max, position);
+        }
+
+        return vertex_count ? BoundingBox(box_min, box_max) : BoundingBox::Zero;
+    #endif
+    }
+}
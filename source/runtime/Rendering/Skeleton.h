@@ -0,0 +1,133 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =====================
+#include <vector>
+#include <string>
+#include "../Math/Matrix.h"
+#include "../Math/BoundingBox.h"
+//================================
+
+namespace spartan
+{
+    struct RHI_Vertex_PosTexNorTan;
+
+    struct SkeletonBone
+    {
+        std::string name;
+        int32_t parent            = -1;                         // always lower than the index of the bone itself, -1 for roots
+        math::Matrix inverse_bind = math::Matrix::Identity;     // model space to bone space, in the bind pose
+        math::Vector3 position    = math::Vector3::Zero;        // local bind pose
+        math::Quaternion rotation = math::Quaternion::Identity;
+        math::Vector3 scale       = math::Vector3::One;
+    };
+
+    // up to four influences per vertex, the weights add up to one (or zero for vertices that aren't skinned)
+    struct BoneWeights
+    {
+        uint16_t bone[4] = {};
+        float weight[4]  = {};
+    };
+
+    enum class PoseChannel : uint32_t
+    {
+        PositionX, PositionY, PositionZ,
+        RotationX, RotationY, RotationZ, RotationW,
+        ScaleX, ScaleY, ScaleZ,
+        Max
+    };
+
+    // local transforms of every bone, stored as one array per channel and padded to a multiple
+    // of 8 bones so that sampling and blending can process 8 bones per instruction
+    class Pose
+    {
+    public:
+        static constexpr uint32_t channel_count = static_cast<uint32_t>(PoseChannel::Max);
+
+        static uint32_t GetStride(const uint32_t bone_count) { return (bone_count + 7) & ~7u; }
+
+        void Resize(const uint32_t bone_count);
+        uint32_t GetBoneCount() const { return m_bone_count; }
+        uint32_t GetStride() const    { return m_stride; }
+
+        float* GetChannel(const PoseChannel channel)             { return m_data.data() + static_cast<uint32_t>(channel) * m_stride; }
+        const float* GetChannel(const PoseChannel channel) const { return m_data.data() + static_cast<uint32_t>(channel) * m_stride; }
+
+        void SetBone(const uint32_t index, const math::Vector3& position, const math::Quaternion& rotation, const math::Vector3& scale);
+
+        // rescales every rotation to unit length
+        void NormalizeRotations();
+
+        // lerp for position and scale, nlerp (shortest path) for rotation, out can alias a or b
+        static void Blend(const Pose& a, const Pose& b, const float weight, Pose& out);
+
+    private:
+        std::vector<float> m_data;
+        uint32_t m_bone_count = 0;
+        uint32_t m_stride     = 0;
+    };
+
+    // a bone hierarchy, parents always precede their children so that a pose can be resolved in a single pass
+    class Skeleton
+    {
+    public:
+        uint32_t AddBone(const SkeletonBone& bone);
+        int32_t FindBone(const std::string& name) const;
+        const SkeletonBone& GetBone(const uint32_t index) const { return m_bones[index]; }
+        const std::vector<SkeletonBone>& GetBones() const       { return m_bones; }
+        uint32_t GetBoneCount() const                           { return static_cast<uint32_t>(m_bones.size()); }
+        bool IsEmpty() const                                    { return m_bones.empty(); }
+        void Clear();
+
+        // the skinned geometry lives in the space of the node that references it, which isn't necessarily the skeleton's model space
+        const math::Matrix& GetMeshTransformInverse() const       { return m_mesh_transform_inverse; }
+        void SetMeshTransformInverse(const math::Matrix& matrix) { m_mesh_transform_inverse = matrix; }
+
+        // identifies the bone layout, animations can only be played on skeletons with the same layout
+        uint64_t GetLayoutHash() const;
+
+        // binary serialization, used by the mesh file
+        void Serialize(std::vector<uint8_t>& data) const;
+        bool Deserialize(const uint8_t* data, const uint64_t size);
+
+        // pose evaluation
+        void GetBindPose(Pose& pose) const;
+        void ComputeModelSpace(const Pose& pose, math::Matrix* model) const;          // local transforms -> model space, one matrix per bone
+        void ComputeSkinning(const math::Matrix* model, math::Matrix* skinning) const; // model space -> inverse bind * model * mesh transform inverse
+
+        // transforms lod 0 vertices by up to four weighted skinning matrices each, returns their bounding box
+        static math::BoundingBox Skin(
+            const RHI_Vertex_PosTexNorTan* vertices,
+            const BoneWeights* weights,
+            const uint32_t vertex_count,
+            const math::Matrix* skinning,
+            const uint32_t bone_count,
+            RHI_Vertex_PosTexNorTan* vertices_out
+        );
+
+    private:
+        std::vector<SkeletonBone> m_bones;
+        math::Matrix m_mesh_transform_inverse = math::Matrix::Identity;
+    };
+}
@@ -0,0 +1,515 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ==========================
+#include "pch.h"
+#include "TextureStreaming.h"
+#include "Renderer.h"
+#include "Material.h"
+#include "../Core/ThreadPool.h"
+#include "../RHI/RHI_Texture.h"
+#include "../World/World.h"
+#include "../World/Entity.h"
+#include "../World/Components/Camera.h"
+#include "../World/Components/Renderable.h"
+//=====================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace spartan::math;
+//============================
+
+namespace spartan
+{
+    namespace
+    {
+        struct Entry
+        {
+            uint64_t id           = 0;    // guards against a new texture at the address of a destroyed one
+            vector<uint64_t> mip_sizes;   // all slices included
+            uint32_t tail_mip     = 0;
+            uint32_t pending_mip  = 0;
+            bool in_flight        = false;
+            float required_texels = 0.0f; // the largest on screen size this frame
+            uint64_t frame_seen   = 0;
+            bool seen             = false;
+        };
+
+        struct Job
+        {
+            RHI_Texture* texture = nullptr;
+            uint64_t id          = 0;
+            uint32_t mip         = 0;
+            shared_ptr<RHI_Texture> staged; // holds the new gpu resources, then the old ones until it's released
+        };
+
+        // the tail is kept resident so that there is always something to sample
+        const uint32_t tail_size              = 256;
+        const uint32_t max_requests_per_tick  = 4;
+        const uint32_t max_requests_in_flight = 8;
+
+        unordered_map<RHI_Texture*, Entry> textures;
+        vector<Job> jobs_completed;
+        atomic<uint32_t> jobs_in_flight = 0;
+        uint64_t budget                 = 1024ull * 1024 * 1024;
+        uint64_t memory_resident        = 0;
+        mutex mutex_streaming;
+
+        uint64_t get_size(const vector<uint64_t>& mip_sizes, const uint32_t first_mip)
+        {
+            uint64_t size = 0;
+            for (uint32_t i = first_mip; i < static_cast<uint32_t>(mip_sizes.size()); i++)
+            {
+                size += mip_sizes[i];
+            }
+
+            return size;
+        }
+
+        // texels the material's textures need along their largest dimension to match the renderable's size on screen
+        float compute_required_texels(Renderable* renderable, Material* material, Camera* camera)
+        {
+            const BoundingBox& bounding_box = renderable->GetBoundingBox();
+            const Vector3 camera_position   = camera->GetEntity()->GetPosition();
+            const float radius              = bounding_box.GetExtents().Length();
+            const float distance            = Vector3::Distance(camera_position, bounding_box.GetClosestPoint(camera_position));
+            const float pixels              = TextureStreaming::ComputeScreenSize(radius, max(distance, camera->GetNearPlane()), camera->GetFovVerticalRad(), Renderer::GetResolutionRender().y);
+
+            // world space uvs repeat with world units instead of the mesh, so they get everything
+            if (material->GetProperty(MaterialProperty::WorldSpaceUv) != 0.0f)
+                return numeric_limits<float>::max();
+
+            // a texture that repeats n times covers n times fewer pixels per repetition, the less tiled axis decides
+            const float tiling = max(1.0f, min(abs(material->GetProperty(MaterialProperty::TextureTilingX)), abs(material->GetProperty(MaterialProperty::TextureTilingY))));
+            return pixels / tiling;
+        }
+    }
+
+    void TextureStreaming::Shutdown()
+    {
+        // jobs hold their streams, let them finish so that nothing outlives the device
+        while (jobs_in_flight.load() != 0)
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        lock_guard<mutex> lock(mutex_streaming);
+        jobs_completed.clear();
+        textures.clear();
+        memory_resident = 0;
+    }
+
+    bool TextureStreaming::Tick()
+    {
+        lock_guard<mutex> lock(mutex_streaming);
+
+        // apply finished residency changes
+        bool residency_changed = false;
+        for (Job& job : jobs_completed)
+        {
+            auto it = textures.find(job.texture);
+            if (it != textures.end() && it->second.id == job.id)
+            {
+                job.texture->SwapResidency(*job.staged, job.mip);
+                it->second.in_flight = false;
+                residency_changed    = true;
+            }
+        }
+        jobs_completed.clear(); // the staged textures release the previous resources through the deletion queue
+
+        if (textures.empty())
+            return residency_changed;
+
+        // find how large every streamed texture is on screen
+        const uint64_t frame = Renderer::GetFrameNumber();
+        if (Camera* camera = World::GetCamera())
+        {
+            for (Entity* entity : World::GetEntities())
+            {
+                Renderable* renderable = entity->GetActive() ? entity->GetComponent<Renderable>() : nullptr;
+                Material* material     = renderable && renderable->IsVisible() ? renderable->GetMaterial() : nullptr;
+                if (!material)
+                    continue;
+
+                float required_texels = -1.0f; // computed once a streamed texture shows up
+                for (RHI_Texture* texture : material->GetTextures())
+                {
+                    auto it = texture ? textures.find(texture) : textures.end();
+                    if (it == textures.end())
+                        continue;
+
+                    if (required_texels < 0.0f)
+                    {
+                        required_texels = compute_required_texels(renderable, material, camera);
+                    }
+
+                    Entry& entry          = it->second;
+                    entry.required_texels = (entry.seen && entry.frame_seen == frame) ? max(entry.required_texels, required_texels) : required_texels;
+                    entry.frame_seen      = frame;
+                    entry.seen            = true;
+                }
+            }
+        }
+
+        // describe them to the planner
+        vector<TextureStreamingState> states;
+        vector<RHI_Texture*> states_textures;
+        states.reserve(textures.size());
+        states_textures.reserve(textures.size());
+        memory_resident = 0;
+        for (auto& [texture, entry] : textures)
+        {
+            const RHI_Texture_Stream& stream = *texture->GetStream();
+            const bool seen_this_frame       = entry.seen && entry.frame_seen == frame;
+
+            TextureStreamingState& state = states.emplace_back();
+            state.mip_sizes              = entry.mip_sizes;
+            state.tail_mip               = entry.tail_mip;
+            state.resident_mip           = entry.in_flight ? min(entry.pending_mip, texture->GetResidentMip()) : texture->GetResidentMip();
+            state.desired_mip            = seen_this_frame ? ComputeDesiredMip(stream.width, stream.height, entry.tail_mip, entry.required_texels) : entry.tail_mip;
+            state.priority               = seen_this_frame ? entry.required_texels : -static_cast<float>(entry.seen ? frame - entry.frame_seen : frame);
+            state.in_flight              = entry.in_flight;
+            states_textures.emplace_back(texture);
+
+            memory_resident += get_size(entry.mip_sizes, texture->GetResidentMip());
+        }
+
+        // issue the requests, the gpu resources are created on the workers and swapped in by a later tick
+        const uint32_t in_flight    = jobs_in_flight.load();
+        const uint32_t max_requests = in_flight < max_requests_in_flight ? min(max_requests_per_tick, max_requests_in_flight - in_flight) : 0;
+        for (const TextureStreamingRequest& request : Plan(states, budget, max_requests))
+        {
+            RHI_Texture* texture = states_textures[request.index];
+            Entry& entry         = textures[texture];
+            entry.in_flight      = true;
+            entry.pending_mip    = request.mip;
+            jobs_in_flight++;
+
+            ThreadPool::AddTask([texture, id = entry.id, mip = request.mip, flags = texture->GetFlags(), stream = texture->GetStream()]()
+            {
+                shared_ptr<RHI_Texture> staged = RHI_Texture::CreateFromStream(*stream, mip, flags);
+
+                {
+                    lock_guard<mutex> lock(mutex_streaming);
+                    jobs_completed.push_back({ texture, id, mip, move(staged) });
+                }
+
+                jobs_in_flight--;
+            });
+        }
+
+        return residency_changed;
+    }
+
+    void TextureStreaming::Register(RHI_Texture* texture)
+    {
+        SP_ASSERT(texture && texture->IsStreamed());
+
+        const RHI_Texture_Stream& stream = *texture->GetStream();
+
+        Entry entry;
+        entry.id       = texture->GetObjectId();
+        entry.tail_mip = GetTailMip(stream.width, stream.height, stream.mip_count);
+        entry.mip_sizes.resize(stream.mip_count, 0);
+        for (uint32_t array_index = 0; array_index < stream.depth; array_index++)
+        {
+            for (uint32_t mip_index = 0; mip_index < stream.mip_count; mip_index++)
+            {
+                entry.mip_sizes[mip_index] += stream.GetMipSize(array_index, mip_index);
+            }
+        }
+
+        lock_guard<mutex> lock(mutex_streaming);
+        textures[texture] = move(entry);
+    }
+
+    void TextureStreaming::Unregister(RHI_Texture* texture)
+    {
+        // a job that is still running completes against an id that no longer exists and is dropped
+        lock_guard<mutex> lock(mutex_streaming);
+        textures.erase(texture);
+    }
+
+    void TextureStreaming::SetBudget(const uint64_t bytes)
+    {
+        lock_guard<mutex> lock(mutex_streaming);
+        budget = bytes;
+    }
+
+    uint64_t TextureStreaming::GetBudget()
+    {
+        lock_guard<mutex> lock(mutex_streaming);
+        return budget;
+    }
+
+    uint64_t TextureStreaming::GetMemoryResident()
+    {
+        lock_guard<mutex> lock(mutex_streaming);
+        return memory_resident;
+    }
+
+    uint32_t TextureStreaming::GetTextureCount()
+    {
+        lock_guard<mutex> lock(mutex_streaming);
+        return static_cast<uint32_t>(textures.size());
+    }
+
+    uint32_t TextureStreaming::GetRequestsInFlight()
+    {
+        return jobs_in_flight.load();
+    }
+
+    uint32_t TextureStreaming::GetTailMip(const uint32_t width, const uint32_t height, const uint32_t mip_count)
+    {
+        uint32_t mip = 0;
+        while (mip + 1 < mip_count && max(width >> mip, height >> mip) > tail_size)
+        {
+            mip++;
+        }
+
+        return mip;
+    }
+
+    uint32_t TextureStreaming::ComputeDesiredMip(const uint32_t width, const uint32_t height, const uint32_t tail_mip, const float required_texels)
+    {
+        if (required_texels <= 0.0f)
+            return tail_mip;
+
+        // the smallest mip that still has at least the required texels
+        const uint32_t size = max(width, height);
+        uint32_t mip        = 0;
+        while (mip < tail_mip && static_cast<float>(size >> (mip + 1)) >= required_texels)
+        {
+            mip++;
+        }
+
+        return mip;
+    }
+
+    float TextureStreaming::ComputeScreenSize(const float radius, const float distance, const float fov_vertical_rad, const float viewport_height)
+    {
+        // projected diameter in pixels of a sphere, accurate enough away from the screen edges
+        const float tan_half_fov = tan(fov_vertical_rad * 0.5f);
+        if (distance <= 0.0f || tan_half_fov <= 0.0f)
+            return numeric_limits<float>::max();
+
+        return (radius / (distance * tan_half_fov)) * viewport_height;
+    }
+
+    uint64_t TextureStreaming::GetResidentSize(const TextureStreamingState& state, const uint32_t first_mip)
+    {
+        return get_size(state.mip_sizes, first_mip);
+    }
+
+    vector<TextureStreamingRequest> TextureStreaming::Plan(const vector<TextureStreamingState>& states, const uint64_t budget, const uint32_t max_requests)
+    {
+        const uint32_t count = static_cast<uint32_t>(states.size());
+
+        // the plan starts from what's resident
+        vector<uint32_t> planned(count);
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            planned[i] = states[i].resident_mip;
+            total     += GetResidentSize(states[i], planned[i]);
+        }
+
+        // lowest priority first, ties by index so that plans are stable
+        vector<uint32_t> by_priority;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (!states[i].in_flight)
+            {
+                by_priority.emplace_back(i);
+            }
+        }
+        stable_sort(by_priority.begin(), by_priority.end(), [&states](uint32_t a, uint32_t b) { return states[a].priority < states[b].priority; });
+
+        vector<bool> lowered(count, false); // evicted by this plan, not upgraded again
+        uint32_t changed_count = 0;
+        auto can_change = [&](const uint32_t i)
+        {
+            return planned[i] != states[i].resident_mip || changed_count < max_requests;
+        };
+        auto set_mip = [&](const uint32_t i, const uint32_t mip)
+        {
+            if (planned[i] == states[i].resident_mip && mip != planned[i])
+            {
+                changed_count++;
+            }
+
+            total      = total - GetResidentSize(states[i], planned[i]) + GetResidentSize(states[i], mip);
+            lowered[i] = lowered[i] || mip > planned[i];
+            planned[i] = mip;
+        };
+
+        // frees memory until it fits, mips nobody needs go first, then needed mips of textures that matter less
+        auto evict = [&](const uint64_t required, const float priority, const uint32_t exclude)
+        {
+            for (uint32_t i : by_priority)
+            {
+                if (total + required <= budget)
+                    return;
+
+                if (i != exclude && planned[i] < states[i].desired_mip && can_change(i))
+                {
+                    set_mip(i, states[i].desired_mip);
+                }
+            }
+
+            for (uint32_t i : by_priority)
+            {
+                if (states[i].priority >= priority)
+                    break;
+
+                while (total + required > budget && i != exclude && planned[i] < states[i].tail_mip && can_change(i))
+                {
+                    set_mip(i, planned[i] + 1);
+                }
+            }
+        };
+
+        // upgrade the textures that matter the most, settling for a coarser mip when the budget is tight
+        for (auto it = by_priority.rbegin(); it != by_priority.rend(); it++)
+        {
+            const uint32_t i                   = *it;
+            const TextureStreamingState& state = states[i];
+            if (lowered[i] || state.desired_mip >= planned[i] || !can_change(i))
+                continue;
+
+            const uint64_t size_current = GetResidentSize(state, planned[i]);
+            const uint64_t size_desired = GetResidentSize(state, state.desired_mip);
+            evict(size_desired - size_current, state.priority, i);
+
+            uint32_t mip = state.desired_mip;
+            while (mip < planned[i] && total - size_current + GetResidentSize(state, mip) > budget)
+            {
+                mip++;
+            }
+
+            if (mip < planned[i])
+            {
+                set_mip(i, mip);
+            }
+        }
+
+        // a budget that was lowered below what's resident
+        if (total > budget)
+        {
+            evict(0, numeric_limits<float>::infinity(), count);
+        }
+
+        vector<TextureStreamingRequest> requests;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (planned[i] != states[i].resident_mip)
+            {
+                requests.push_back({ i, planned[i] });
+            }
+        }
+
+        return requests;
+    }
+
+    bool TextureStreaming::Test()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Texture streaming %s failed", name);
+                passed = false;
+            }
+        };
+
+        // a square texture with a full chain and a made up block size
+        auto create = [](const uint32_t size, const uint32_t resident_mip, const uint32_t desired_mip, const float priority)
+        {
+            TextureStreamingState state;
+            for (uint32_t width = size; width > 0; width >>= 1)
+            {
+                state.mip_sizes.emplace_back(max<uint64_t>(16, static_cast<uint64_t>(width) * width));
+            }
+            state.tail_mip     = GetTailMip(size, size, static_cast<uint32_t>(state.mip_sizes.size()));
+            state.resident_mip = resident_mip;
+            state.desired_mip  = desired_mip;
+            state.priority     = priority;
+            return state;
+        };
+        auto is = [](const vector<TextureStreamingRequest>& requests, const vector<TextureStreamingRequest>& expected)
+        {
+            if (requests.size() != expected.size())
+                return false;
+
+            for (size_t i = 0; i < requests.size(); i++)
+            {
+                if (requests[i].index != expected[i].index || requests[i].mip != expected[i].mip)
+                    return false;
+            }
+
+            return true;
+        };
+
+        // helpers
+        expect("tail of a large texture", GetTailMip(4096, 4096, 13) == 4);
+        expect("tail of a wide texture", GetTailMip(4096, 1024, 13) == 4);
+        expect("tail of a small texture", GetTailMip(128, 128, 8) == 0);
+        expect("tail without mips", GetTailMip(4096, 4096, 1) == 0);
+        expect("desired mip when unseen", ComputeDesiredMip(4096, 4096, 4, 0.0f) == 4);
+        expect("desired mip when close", ComputeDesiredMip(4096, 4096, 4, 5000.0f) == 0);
+        expect("desired mip in between", ComputeDesiredMip(4096, 4096, 4, 1000.0f) == 2);
+        expect("desired mip when far", ComputeDesiredMip(4096, 4096, 4, 10.0f) == 4);
+        const float pixels = ComputeScreenSize(1.0f, 10.0f, math::pi_div_2, 1080.0f);
+        expect("screen size", pixels > 107.0f && pixels < 109.0f);
+
+        const uint64_t tail = GetResidentSize(create(4096, 4, 0, 0.0f), 4);
+
+        // plenty of budget, the most important textures go first and no more than the cap
+        vector<TextureStreamingState> states = { create(4096, 4, 0, 3000.0f), create(4096, 4, 1, 1500.0f), create(4096, 4, 2, 800.0f) };
+        expect("request cap", is(Plan(states, numeric_limits<uint64_t>::max(), 2), { { 0, 0 }, { 1, 1 } }));
+
+        // a tight budget settles for a coarser mip instead of nothing
+        const uint64_t budget_tight = tail * 2 + GetResidentSize(states[0], 2);
+        expect("tight budget", is(Plan(states, budget_tight, 8), { { 0, 2 } }));
+
+        // mips nobody needs make room, but are kept while there is room
+        const uint64_t budget_one = GetResidentSize(states[0], 0) + tail;
+        states = { create(4096, 0, 4, -10.0f), create(4096, 4, 0, 3000.0f) };
+        expect("eviction", is(Plan(states, budget_one, 8), { { 0, 4 }, { 1, 0 } }));
+        expect("unneeded mips kept under budget", Plan({ create(4096, 0, 4, -10.0f) }, numeric_limits<uint64_t>::max(), 8).empty());
+
+        // needed mips go to the texture that matters more, and not the other way around
+        states = { create(4096, 0, 0, 100.0f), create(4096, 4, 0, 3000.0f) };
+        vector<TextureStreamingRequest> requests = Plan(states, budget_one, 8);
+        expect("priority stealing", requests.size() == 2 && requests[0].index == 0 && requests[0].mip > 0 && requests[1].index == 1 && requests[1].mip == 0);
+        states = { create(4096, 0, 0, 3000.0f), create(4096, 4, 0, 100.0f) };
+        expect("no stealing from higher priority", Plan(states, budget_one, 8).empty());
+
+        // a budget lowered below what's resident, textures with a pending change are left alone
+        states = { create(4096, 0, 0, 100.0f), create(4096, 0, 0, 50.0f) };
+        states[0].in_flight = true;
+        expect("lowered budget", is(Plan(states, budget_one, 8), { { 1, 4 } }));
+
+        return passed;
+    }
+}
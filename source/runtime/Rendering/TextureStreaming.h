@@ -0,0 +1,84 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =====
+#include <cstdint>
+#include <vector>
+//================
+
+namespace spartan
+{
+    class RHI_Texture;
+
+    // what the planner knows about a streamed texture, mips are indexed from the full resolution one (0)
+    struct TextureStreamingState
+    {
+        std::vector<uint64_t> mip_sizes;   // bytes of each mip, all slices included
+        uint32_t tail_mip     = 0;         // first mip of the tail, the tail is always resident
+        uint32_t resident_mip = 0;         // first resident mip, or the pending one if that's smaller
+        uint32_t desired_mip  = 0;         // first mip the camera needs
+        float priority        = 0.0f;      // required texels on screen, or minus the frames since it was last seen
+        bool in_flight        = false;     // a residency change is pending, leave it alone
+    };
+
+    struct TextureStreamingRequest
+    {
+        uint32_t index = 0; // into the states
+        uint32_t mip   = 0; // the new first resident mip
+    };
+
+    // native textures keep their mip chain in a mapped file and start with only the mip tail resident, higher
+    // mips are streamed in on worker threads based on their screen size, and streamed out when over budget
+    class TextureStreaming
+    {
+    public:
+        static void Shutdown();
+
+        // applies finished residency changes and issues new ones, returns true if the bindless textures need an update
+        static bool Tick();
+
+        // called by textures that own a stream
+        static void Register(RHI_Texture* texture);
+        static void Unregister(RHI_Texture* texture);
+
+        // gpu memory for streamed mips, tails included
+        static void SetBudget(const uint64_t bytes);
+        static uint64_t GetBudget();
+
+        // stats
+        static uint64_t GetMemoryResident();
+        static uint32_t GetTextureCount();
+        static uint32_t GetRequestsInFlight();
+
+        // the cpu side, no gpu or world needed
+        static uint32_t GetTailMip(const uint32_t width, const uint32_t height, const uint32_t mip_count);
+        static uint32_t ComputeDesiredMip(const uint32_t width, const uint32_t height, const uint32_t tail_mip, const float required_texels);
+        static float ComputeScreenSize(const float radius, const float distance, const float fov_vertical_rad, const float viewport_height);
+        static uint64_t GetResidentSize(const TextureStreamingState& state, const uint32_t first_mip);
+        static std::vector<TextureStreamingRequest> Plan(const std::vector<TextureStreamingState>& states, const uint64_t budget, const uint32_t max_requests);
+
+        // the above against hand made cases, the request cap, tight budgets, eviction, priorities and a lowered budget
+        static bool Test();
+    };
+}
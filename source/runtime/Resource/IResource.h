@@ -93,6 +93,10 @@ namespace spartan
         virtual void SaveToFile(const std::string& file_path)   { }
         virtual void LoadFromFile(const std::string& file_path) { }
 
+        // content hash of the serializable data, incremental world saves skip resources whose hash hasn't changed
+        // 0 means unknown, in which case the resource is always written
+        virtual uint64_t GetContentHash() { return 0; }
+
         // type
         template <typename T>
         static ResourceType TypeToEnum();
@@ -26,10 +26,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../RHI/RHI_Texture.h"
 #include "../../Rendering/Animation.h"
 #include "../../Geometry/Mesh.h"
+#include "../../Geometry/GeometryProcessing.h"
 #include "../../Rendering/Material.h"
 #include "../../World/World.h"
 #include "../../World/Entity.h"
 #include "../../World/Components/Light.h"
+#include "../../World/Components/Animator.h"
 #include "../../Resource/ResourceCache.h"
 SP_WARNINGS_OFF
 #include "assimp/scene.h"
@@ -57,6 +59,17 @@ namespace spartan
         const aiScene* scene     = nullptr;
         mutex mutex_assimp;
 
+        // meshes referenced by many nodes, or identical meshes under different names, share one sub-mesh
+        unordered_map<uint32_t, uint32_t> sub_mesh_by_mesh_index;        // aiMesh index -> sub-mesh index
+        unordered_map<uint64_t, uint32_t> sub_mesh_by_content_hash;      // hash of vertex and index data -> sub-mesh index
+        unordered_map<uint32_t, shared_ptr<Material>> material_by_index; // aiMaterial index -> material
+        uint32_t mesh_reference_count = 0;
+        bool share_sub_meshes         = true; // only turned off by the test, to measure what sharing saves
+
+        // skinning
+        Skeleton skeleton;
+        Animation* animation_default = nullptr; // the first clip, played by the animators of skinned meshes
+
         Matrix to_matrix(const aiMatrix4x4& transform)
         {
             return Matrix
@@ -104,6 +117,70 @@ namespace spartan
             entity->SetScaleLocal(matrix_engine.GetScale());
         }
 
+        // marks the bones and every node between them and the root, returns true if the node was marked
+        bool mark_skeleton_nodes(const aiNode* node, const unordered_map<string, Matrix>& bones, unordered_set<const aiNode*>& nodes)
+        {
+            bool is_needed = bones.find(node->mName.C_Str()) != bones.end();
+            for (uint32_t i = 0; i < node->mNumChildren; i++)
+            {
+                is_needed |= mark_skeleton_nodes(node->mChildren[i], bones, nodes);
+            }
+
+            if (is_needed)
+            {
+                nodes.insert(node);
+            }
+
+            return is_needed;
+        }
+
+        // adds the marked nodes in depth-first order, so that parents always precede their children
+        void add_skeleton_nodes(const aiNode* node, const int32_t parent, const Matrix& parent_transform, const unordered_set<const aiNode*>& nodes, const unordered_map<string, Matrix>& bones, Skeleton& skeleton_out)
+        {
+            if (nodes.find(node) == nodes.end())
+                return;
+
+            const Matrix local     = to_matrix(node->mTransformation);
+            const Matrix transform = local * parent_transform;
+
+            SkeletonBone bone;
+            bone.name   = node->mName.C_Str();
+            bone.parent = parent;
+            local.Decompose(bone.scale, bone.rotation, bone.position);
+
+            // nodes that don't deform vertices have no offset matrix, use the inverse of their bind pose instead
+            auto it           = bones.find(bone.name);
+            bone.inverse_bind = it != bones.end() ? it->second : Matrix::Invert(transform);
+
+            const int32_t index = static_cast<int32_t>(skeleton_out.AddBone(bone));
+            for (uint32_t i = 0; i < node->mNumChildren; i++)
+            {
+                add_skeleton_nodes(node->mChildren[i], index, transform, nodes, bones, skeleton_out);
+            }
+        }
+
+        // model space transform of the first node that references a skinned mesh
+        bool find_skinned_mesh_transform(const aiNode* node, const Matrix& parent_transform, Matrix& transform_out)
+        {
+            const Matrix transform = to_matrix(node->mTransformation) * parent_transform;
+            for (uint32_t i = 0; i < node->mNumMeshes; i++)
+            {
+                if (scene->mMeshes[node->mMeshes[i]]->HasBones())
+                {
+                    transform_out = transform;
+                    return true;
+                }
+            }
+
+            for (uint32_t i = 0; i < node->mNumChildren; i++)
+            {
+                if (find_skinned_mesh_transform(node->mChildren[i], transform, transform_out))
+                    return true;
+            }
+
+            return false;
+        }
+
         void compute_node_count(const aiNode* node, uint32_t* count)
         {
             if (!node)
@@ -450,6 +527,7 @@ namespace spartan
             import_flags |= aiProcess_ValidateDataStructure; // validates the imported scene data structure
             import_flags |= aiProcess_Triangulate;           // triangulates all faces of all meshes
             import_flags |= aiProcess_SortByPType;           // splits meshes with more than one primitive type in homogeneous sub-meshes
+            import_flags |= aiProcess_LimitBoneWeights;      // limits the bones that influence a vertex to four, the most the skinning supports
 
             // switch to engine conventions
             import_flags |= aiProcess_MakeLeftHanded;   // directx style
@@ -457,15 +535,15 @@ namespace spartan
             import_flags |= aiProcess_FlipWindingOrder; // directx style
 
             // generate missing normals or UVs
-            import_flags |= aiProcess_CalcTangentSpace; // calculates  tangents and bitangents
             import_flags |= aiProcess_GenSmoothNormals; // ignored if the mesh already has normals
             import_flags |= aiProcess_GenUVCoords;      // converts non-UV mappings (such as spherical or cylindrical mapping) to proper texture coordinate channels
+            // tangents are computed after parsing (mikktspace, in parallel), see ParseMeshGeometry()
 
-            // combine meshes
+            // combine meshes, the hierarchy is kept (no aiProcess_PreTransformVertices) so that instanced meshes aren't duplicated
             if (mesh->GetFlags() & static_cast<uint32_t>(MeshFlags::ImportCombineMeshes))
             {
-                import_flags |= aiProcess_OptimizeMeshes;
-                import_flags |= aiProcess_PreTransformVertices; // this is incompatible with aiProcess_OptimizeGraph (assert occurs)
+                import_flags |= aiProcess_OptimizeMeshes; // joins small meshes that share a material
+                import_flags |= aiProcess_OptimizeGraph;  // collapses nodes that don't need to be separate, nodes referencing shared meshes are kept
             }
 
             // validate
@@ -491,9 +569,26 @@ namespace spartan
 
             model_has_animation = scene->mNumAnimations != 0;
 
+            // the skeleton and the animations come first, as skinned meshes reference them
+            animation_default = nullptr;
+            ParseSkeleton();
+            if (!skeleton.IsEmpty() && model_has_animation)
+            {
+                ParseAnimations();
+            }
+
             // recursively parse nodes
+            sub_mesh_by_mesh_index.clear();
+            sub_mesh_by_content_hash.clear();
+            material_by_index.clear();
+            mesh_reference_count = 0;
             ParseNode(scene->mRootNode);
 
+            if (mesh_reference_count > mesh->GetSubMeshCount())
+            {
+                SP_LOG_INFO("\"%s\": %u mesh references share %u sub-meshes", model_name.c_str(), mesh_reference_count, mesh->GetSubMeshCount());
+            }
+
             // update model geometry
             {
                 while (ProgressTracker::GetProgress(ProgressType::ModelImporter).GetFraction() != 1.0f)
@@ -505,6 +600,19 @@ namespace spartan
                 mesh->CreateGpuBuffers();
             }
 
+            // one animator on the root evaluates the pose for all of the skinned sub-meshes, it starts out playing the first animation
+            if (animation_default)
+            {
+                for (uint32_t i = 0; i < mesh->GetSubMeshCount(); i++)
+                {
+                    if (mesh->GetSubMesh(i).skinned)
+                    {
+                        mesh->GetRootEntity()->AddComponent<Animator>()->Play(animation_default);
+                        break;
+                    }
+                }
+            }
+
             // make the root entity active since it's now thread-safe
             mesh->GetRootEntity()->SetActive(true);
         }
@@ -515,7 +623,12 @@ namespace spartan
         }
 
         importer.FreeScene();
-        mesh = nullptr;
+        sub_mesh_by_mesh_index.clear();
+        sub_mesh_by_content_hash.clear();
+        material_by_index.clear();
+        skeleton.Clear();
+        animation_default = nullptr;
+        mesh              = nullptr;
     }
 
     void ModelImporter::ParseNode(const aiNode* node, Entity* parent_entity)
@@ -577,8 +690,9 @@ namespace spartan
 
         for (uint32_t i = 0; i < assimp_node->mNumMeshes; i++)
         {
-            Entity* entity     = node_entity;
-            aiMesh* node_mesh = scene->mMeshes[assimp_node->mMeshes[i]];
+            Entity* entity      = node_entity;
+            uint32_t mesh_index = assimp_node->mMeshes[i];
+            aiMesh* node_mesh   = scene->mMeshes[mesh_index];
             string node_name  = assimp_node->mName.C_Str();
 
             // if this node has more than one meshes, create an entity for each mesh, then make that entity a child of node_entity
@@ -598,7 +712,7 @@ namespace spartan
             entity->SetObjectName(node_name);
             
             // load the mesh onto the entity (via a Renderable component)
-            ParseMesh(node_mesh, entity);
+            ParseMesh(node_mesh, mesh_index, entity);
         }
     }
 
@@ -646,11 +760,59 @@ namespace spartan
         }
     }
 
-    void ModelImporter::ParseMesh(aiMesh* assimp_mesh, Entity* entity_parent)
+    void ModelImporter::ParseMesh(aiMesh* assimp_mesh, const uint32_t mesh_index, Entity* entity_parent)
     {
         SP_ASSERT(assimp_mesh != nullptr);
         SP_ASSERT(entity_parent != nullptr);
 
+        mesh_reference_count++;
+
+        // the same mesh referenced again
+        uint32_t sub_mesh_index = 0;
+        auto it_mesh_index      = sub_mesh_by_mesh_index.find(mesh_index);
+        if (share_sub_meshes && it_mesh_index != sub_mesh_by_mesh_index.end())
+        {
+            sub_mesh_index = it_mesh_index->second;
+        }
+        else
+        {
+            sub_mesh_index                     = ParseMeshGeometry(assimp_mesh);
+            sub_mesh_by_mesh_index[mesh_index] = sub_mesh_index;
+        }
+
+        // set the geometry
+        entity_parent->AddComponent<Renderable>()->SetMesh(mesh, sub_mesh_index);
+
+        // material
+        if (scene->HasMaterials())
+        {
+            shared_ptr<Material>& material = material_by_index[assimp_mesh->mMaterialIndex];
+            if (!material)
+            {
+                // get aiMaterial
+                const aiMaterial* assimp_material = scene->mMaterials[assimp_mesh->mMaterialIndex];
+
+                // convert it and add it to the model
+                material = load_material(mesh, model_file_path, assimp_material);
+
+                // generate normal from albedo if no normal map is provided
+                if (!material->HasTextureOfType(MaterialTextureType::Normal))
+                { 
+                    material->SetProperty(MaterialProperty::NormalFromAlbedo, 0.0f); // disable for now (I need to find a way for this to be defined externally (by the user)
+                }
+
+                // create a file path for this material (required for the material to be able to be cached by the resource cache)
+                const string spartan_asset_path = FileSystem::GetDirectoryFromFilePath(model_file_path) + material->GetObjectName() + EXTENSION_MATERIAL;
+                material->SetResourceFilePath(spartan_asset_path);
+            }
+
+            // add a renderable and set the material to it
+            entity_parent->AddComponent<Renderable>()->SetMaterial(material);
+        }
+    }
+
+    uint32_t ModelImporter::ParseMeshGeometry(aiMesh* assimp_mesh)
+    {
         const uint32_t vertex_count = assimp_mesh->mNumVertices;
         const uint32_t index_count  = assimp_mesh->mNumFaces * 3;
 
@@ -676,15 +838,6 @@ namespace spartan
                     vertex.nor[2] = normal.z;
                 }
 
-                // tangent
-                if (assimp_mesh->mTangents)
-                {
-                    const aiVector3D& tangent = assimp_mesh->mTangents[i];
-                    vertex.tan[0] = tangent.x;
-                    vertex.tan[1] = tangent.y;
-                    vertex.tan[2] = tangent.z;
-                }
-
                 // texture coordinates
                 const uint32_t uv_channel = 0;
                 if (assimp_mesh->HasTextureCoords(uv_channel))
@@ -711,127 +864,376 @@ namespace spartan
             }
         }
 
-        // add vertex and index data to the mesh
-        uint32_t sub_mesh_index = 0;
-        mesh->AddGeometry(vertices, indices, true, &sub_mesh_index);
-
-        // set the geometry
-        entity_parent->AddComponent<Renderable>()->SetMesh(mesh, sub_mesh_index);
-
-        // material
-        if (scene->HasMaterials())
+        // bone weights, the strongest four influences of every vertex (aiProcess_LimitBoneWeights should already ensure that)
+        vector<BoneWeights> bone_weights;
+        if (assimp_mesh->HasBones() && !skeleton.IsEmpty())
         {
-            // get aiMaterial
-            const aiMaterial* assimp_material = scene->mMaterials[assimp_mesh->mMaterialIndex];
+            bone_weights.resize(vertex_count);
+            for (uint32_t i = 0; i < assimp_mesh->mNumBones; i++)
+            {
+                const aiBone* assimp_bone = assimp_mesh->mBones[i];
+                const int32_t bone_index  = skeleton.FindBone(assimp_bone->mName.C_Str());
+                if (bone_index < 0)
+                    continue;
+
+                for (uint32_t j = 0; j < assimp_bone->mNumWeights; j++)
+                {
+                    const aiVertexWeight& assimp_weight = assimp_bone->mWeights[j];
+                    BoneWeights& weights                = bone_weights[assimp_weight.mVertexId];
 
-            // convert it and add it to the model
-            shared_ptr<Material> material = load_material(mesh, model_file_path, assimp_material);
+                    // insert while keeping the weights sorted, the weakest one drops off
+                    uint32_t slot = 4;
+                    while (slot > 0 && weights.weight[slot - 1] < assimp_weight.mWeight)
+                    {
+                        if (slot < 4)
+                        {
+                            weights.weight[slot] = weights.weight[slot - 1];
+                            weights.bone[slot]   = weights.bone[slot - 1];
+                        }
+                        slot--;
+                    }
 
-            // generate normal from albedo if no normal map is provided
-            if (!material->HasTextureOfType(MaterialTextureType::Normal))
-            { 
-                material->SetProperty(MaterialProperty::NormalFromAlbedo, 0.0f); // disable for now (I need to find a way for this to be defined externally (by the user)
+                    if (slot < 4)
+                    {
+                        weights.weight[slot] = assimp_weight.mWeight;
+                        weights.bone[slot]   = static_cast<uint16_t>(bone_index);
+                    }
+                }
             }
 
-            // create a file path for this material (required for the material to be able to be cached by the resource cache)
-            const string spartan_asset_path = FileSystem::GetDirectoryFromFilePath(model_file_path) + material->GetObjectName() + EXTENSION_MATERIAL;
-            material->SetResourceFilePath(spartan_asset_path);
+            for (BoneWeights& weights : bone_weights)
+            {
+                const float sum = weights.weight[0] + weights.weight[1] + weights.weight[2] + weights.weight[3];
+                if (sum > 0.0f)
+                {
+                    for (float& weight : weights.weight)
+                    {
+                        weight /= sum;
+                    }
+                }
+            }
+        }
 
-            // add a renderable and set the material to it
-            entity_parent->AddComponent<Renderable>()->SetMaterial(material);
+        // identical data under a different aiMesh, the counts are part of the key to make collisions even less likely,
+        // tangents follow from the rest, so the lookup happens before computing them
+        uint64_t hash = hash_bytes(vertices.data(), vertices.size() * sizeof(RHI_Vertex_PosTexNorTan));
+        hash          = hash_combine(hash, hash_bytes(indices.data(), indices.size() * sizeof(uint32_t)));
+        hash          = hash_combine(hash, hash_bytes(bone_weights.data(), bone_weights.size() * sizeof(BoneWeights)));
+        hash          = hash_combine(hash, (static_cast<uint64_t>(vertex_count) << 32) | index_count);
+        auto it_hash  = sub_mesh_by_content_hash.find(hash);
+        if (share_sub_meshes && it_hash != sub_mesh_by_content_hash.end())
+            return it_hash->second;
+
+        // mikktspace tangents, vertices with mirrored uvs on one side get split and their bone weights go with them
+        vector<uint32_t> split_sources;
+        geometry_processing::compute_normals_and_tangents(vertices, indices, false, &split_sources);
+        if (!bone_weights.empty())
+        {
+            bone_weights.reserve(bone_weights.size() + split_sources.size());
+            for (const uint32_t source : split_sources)
+            {
+                bone_weights.push_back(bone_weights[source]);
+            }
         }
 
-        // Bones
-        ParseNodes(assimp_mesh);
+        // add vertex and index data to the mesh
+        uint32_t sub_mesh_index = 0;
+        mesh->AddGeometry(vertices, indices, true, &sub_mesh_index, bone_weights.empty() ? nullptr : &bone_weights);
+        sub_mesh_by_content_hash[hash] = sub_mesh_index;
+
+        return sub_mesh_index;
     }
 
     void ModelImporter::ParseAnimations()
     {
         for (uint32_t i = 0; i < scene->mNumAnimations; i++)
         {
-            const auto assimp_animation = scene->mAnimations[i];
-            auto animation = make_shared<Animation>();
-
-            // Basic properties
-            animation->SetObjectName(assimp_animation->mName.C_Str());
-            animation->SetDuration(assimp_animation->mDuration);
-            animation->SetTicksPerSec(assimp_animation->mTicksPerSecond != 0.0f ? assimp_animation->mTicksPerSecond : 25.0f);
+            const aiAnimation* assimp_animation = scene->mAnimations[i];
+            const double ticks_per_second       = assimp_animation->mTicksPerSecond != 0.0 ? assimp_animation->mTicksPerSecond : 25.0;
 
-            // Animation channels
-            for (uint32_t j = 0; j < static_cast<uint32_t>(assimp_animation->mNumChannels); j++)
+            // channels, with their key times converted from ticks to seconds
+            vector<AnimationNode> nodes(assimp_animation->mNumChannels);
+            for (uint32_t j = 0; j < assimp_animation->mNumChannels; j++)
             {
                 const aiNodeAnim* assimp_node_anim = assimp_animation->mChannels[j];
-                AnimationNode animation_node;
-
-                animation_node.name = assimp_node_anim->mNodeName.C_Str();
+                AnimationNode& node                = nodes[j];
+                node.name                          = assimp_node_anim->mNodeName.C_Str();
 
-                // Position keys
-                for (uint32_t k = 0; k < static_cast<uint32_t>(assimp_node_anim->mNumPositionKeys); k++)
+                for (uint32_t k = 0; k < assimp_node_anim->mNumPositionKeys; k++)
                 {
-                    const auto time = assimp_node_anim->mPositionKeys[k].mTime;
-                    const auto value = to_vector3(assimp_node_anim->mPositionKeys[k].mValue);
-
-                    animation_node.positionFrames.emplace_back(KeyVector{ time, value });
+                    const aiVectorKey& key = assimp_node_anim->mPositionKeys[k];
+                    node.positionFrames.emplace_back(KeyVector{ key.mTime / ticks_per_second, to_vector3(key.mValue) });
                 }
 
-                // Rotation keys
-                for (uint32_t k = 0; k < static_cast<uint32_t>(assimp_node_anim->mNumRotationKeys); k++)
+                for (uint32_t k = 0; k < assimp_node_anim->mNumRotationKeys; k++)
                 {
-                    const auto time = assimp_node_anim->mPositionKeys[k].mTime;
-                    const auto value = to_quaternion(assimp_node_anim->mRotationKeys[k].mValue);
-
-                    animation_node.rotationFrames.emplace_back(KeyQuaternion{ time, value });
+                    const aiQuatKey& key = assimp_node_anim->mRotationKeys[k];
+                    node.rotationFrames.emplace_back(KeyQuaternion{ key.mTime / ticks_per_second, to_quaternion(key.mValue) });
                 }
 
-                // Scaling keys
-                for (uint32_t k = 0; k < static_cast<uint32_t>(assimp_node_anim->mNumScalingKeys); k++)
+                for (uint32_t k = 0; k < assimp_node_anim->mNumScalingKeys; k++)
                 {
-                    const auto time = assimp_node_anim->mPositionKeys[k].mTime;
-                    const auto value = to_vector3(assimp_node_anim->mScalingKeys[k].mValue);
-
-                    animation_node.scaleFrames.emplace_back(KeyVector{ time, value });
+                    const aiVectorKey& key = assimp_node_anim->mScalingKeys[k];
+                    node.scaleFrames.emplace_back(KeyVector{ key.mTime / ticks_per_second, to_vector3(key.mValue) });
                 }
             }
+
+            // resample against the skeleton
+            shared_ptr<Animation> animation = make_shared<Animation>();
+            animation->Build(skeleton, nodes, static_cast<float>(assimp_animation->mDuration / ticks_per_second));
+
+            // name it after the model, clips are often called the same across models (e.g. "Take 001")
+            const string clip_name = assimp_animation->mName.length != 0 ? assimp_animation->mName.C_Str() : to_string(i);
+            animation->SetObjectName(model_name + "_" + clip_name);
+            animation->SetResourceFilePath(FileSystem::GetDirectoryFromFilePath(model_file_path) + animation->GetObjectName() + EXTENSION_ANIMATION);
+
+            shared_ptr<Animation> animation_cached = ResourceCache::Cache(animation);
+            if (!animation_default)
+            {
+                animation_default = animation_cached.get();
+            }
+        }
+    }
+
+    void ModelImporter::ParseSkeleton()
+    {
+        skeleton.Clear();
+
+        // the bones that deform a vertex, with the transform from mesh space to their space
+        unordered_map<string, Matrix> offset_by_name;
+        for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+        {
+            const aiMesh* assimp_mesh = scene->mMeshes[i];
+            for (uint32_t j = 0; j < assimp_mesh->mNumBones; j++)
+            {
+                offset_by_name.emplace(assimp_mesh->mBones[j]->mName.C_Str(), to_matrix(assimp_mesh->mBones[j]->mOffsetMatrix));
+            }
+        }
+
+        if (offset_by_name.empty())
+            return;
+
+        // the skeleton also contains the ancestors of the bones, so that bones can be evaluated in model space
+        unordered_set<const aiNode*> nodes;
+        mark_skeleton_nodes(scene->mRootNode, offset_by_name, nodes);
+        add_skeleton_nodes(scene->mRootNode, -1, Matrix::Identity, nodes, offset_by_name, skeleton);
+
+        // bones are evaluated in model space but vertices are drawn relative to the node that references them
+        Matrix mesh_transform = Matrix::Identity;
+        if (find_skinned_mesh_transform(scene->mRootNode, Matrix::Identity, mesh_transform))
+        {
+            skeleton.SetMeshTransformInverse(Matrix::Invert(mesh_transform));
+        }
+
+        mesh->SetSkeleton(skeleton);
+    }
+
+    bool ModelImporter::TestSharedSubMeshes()
+    {
+        // a grid, as a gltf with a separate buffer
+        const uint32_t side       = 64; // vertices per side
+        const uint32_t node_count = 128;
+        vector<float> positions;
+        vector<uint32_t> indices;
+        for (uint32_t z = 0; z < side; z++)
+        {
+            for (uint32_t x = 0; x < side; x++)
+            {
+                positions.insert(positions.end(), { static_cast<float>(x), sin(static_cast<float>(x) * 0.2f) * cos(static_cast<float>(z) * 0.3f), static_cast<float>(z) });
+            }
+        }
+        for (uint32_t z = 0; z + 1 < side; z++)
+        {
+            for (uint32_t x = 0; x + 1 < side; x++)
+            {
+                const uint32_t i = z * side + x;
+                indices.insert(indices.end(), { i, i + side, i + 1, i + 1, i + side, i + side + 1 });
+            }
+        }
+
+        const string file_path_base   = FileSystem::GetWorkingDirectory() + "/test_shared_sub_meshes";
+        const uint64_t positions_size = positions.size() * sizeof(float);
+        const uint64_t indices_size   = indices.size() * sizeof(uint32_t);
+        {
+            ofstream file(file_path_base + ".bin", ios::binary);
+            file.write(reinterpret_cast<const char*>(positions.data()), positions_size);
+            file.write(reinterpret_cast<const char*>(indices.data()), indices_size);
+        }
+
+        // two meshes with the same data, each referenced by node_count nodes, which covers a mesh referenced
+        // again as well as identical data under another mesh, the importer has to end up with a single sub-mesh
+        string nodes    = "{ \"children\": [";
+        string children;
+        for (uint32_t i = 0; i < 2 * node_count; i++)
+        {
+            nodes    += (i > 0 ? ", " : "") + to_string(i + 1);
+            children += ", { \"mesh\": " + to_string(i % 2) + ", \"translation\": [" + to_string((i % 32) * side) + ", 0, " + to_string((i / 32) * side) + "] }";
+        }
+        nodes += "] }" + children;
+
+        const string primitive = "{ \"primitives\": [ { \"attributes\": { \"POSITION\": 0 }, \"indices\": 1 } ] }";
+        {
+            ofstream file(file_path_base + ".gltf");
+            file << "{\n"
+                 << "\"asset\": { \"version\": \"2.0\" },\n"
+                 << "\"scene\": 0,\n"
+                 << "\"scenes\": [ { \"nodes\": [0] } ],\n"
+                 << "\"nodes\": [ " << nodes << " ],\n"
+                 << "\"meshes\": [ " << primitive << ", " << primitive << " ],\n"
+                 << "\"buffers\": [ { \"uri\": \"" << FileSystem::GetFileNameFromFilePath(file_path_base) << ".bin\", \"byteLength\": " << positions_size + indices_size << " } ],\n"
+                 << "\"bufferViews\": [ { \"buffer\": 0, \"byteOffset\": 0, \"byteLength\": " << positions_size << ", \"target\": 34962 },"
+                 << " { \"buffer\": 0, \"byteOffset\": " << positions_size << ", \"byteLength\": " << indices_size << ", \"target\": 34963 } ],\n"
+                 << "\"accessors\": [ { \"bufferView\": 0, \"componentType\": 5126, \"count\": " << side * side << ", \"type\": \"VEC3\","
+                 << " \"min\": [0, -1, 0], \"max\": [" << side - 1 << ", 1, " << side - 1 << "] },"
+                 << " { \"bufferView\": 1, \"componentType\": 5125, \"count\": " << indices.size() << ", \"type\": \"SCALAR\" } ]\n"
+                 << "}\n";
         }
+
+        // imports with and without sharing, no post processing so that the parsing is what's timed
+        struct Import
+        {
+            uint32_t sub_mesh_count  = 0;
+            uint32_t reference_count = 0;
+            uint64_t size            = 0;
+            double ms                = 0.0;
+        };
+        const bool playing = Engine::IsFlagSet(EngineMode::Playing);
+        auto import = [&file_path_base](const bool share)
+        {
+            Import result;
+            share_sub_meshes = share;
+            {
+                shared_ptr<Mesh> model = make_shared<Mesh>();
+                model->SetFlags(0);
+                const Stopwatch timer;
+                Load(model.get(), file_path_base + ".gltf");
+                result.ms              = timer.GetElapsedTimeMs();
+                result.sub_mesh_count  = model->GetSubMeshCount();
+                result.reference_count = mesh_reference_count;
+                result.size            = static_cast<uint64_t>(model->GetVertexCount()) * sizeof(RHI_Vertex_PosTexNorTan) + static_cast<uint64_t>(model->GetIndexCount()) * sizeof(uint32_t);
+                World::Shutdown();
+            }
+            share_sub_meshes = true;
+
+            return result;
+        };
+        const Import duplicated = import(false);
+        const Import shared     = import(true);
+        Engine::SetFlag(EngineMode::Playing, playing);
+
+        FileSystem::Delete(file_path_base + ".gltf");
+        FileSystem::Delete(file_path_base + ".bin");
+
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Shared sub-meshes %s failed", name);
+                passed = false;
+            }
+        };
+
+        const uint32_t reference_count = 2 * node_count;
+        expect("references",  shared.reference_count == reference_count && duplicated.reference_count == reference_count);
+        expect("sharing",     shared.sub_mesh_count == 1);
+        expect("duplicating", duplicated.sub_mesh_count == reference_count);
+        expect("memory",      shared.size > 0 && shared.size * reference_count == duplicated.size);
+        expect("import time", shared.ms < duplicated.ms);
+
+        SP_LOG_INFO("Shared sub-meshes, %u references to a %u vertex grid: duplicated %u sub-meshes, %.1f MB, %.1f ms, shared %u sub-mesh, %.2f MB, %.1f ms (%.1fx)",
+            reference_count,
+            side * side,
+            duplicated.sub_mesh_count,
+            static_cast<double>(duplicated.size) / (1024.0 * 1024.0),
+            duplicated.ms,
+            shared.sub_mesh_count,
+            static_cast<double>(shared.size) / (1024.0 * 1024.0),
+            shared.ms,
+            duplicated.ms / max(shared.ms, 1e-6)
+        );
+
+        return passed;
     }
 
-    void ModelImporter::ParseNodes(const aiMesh* assimp_mesh)
+    void ModelImporter::BenchmarkTangents(const uint32_t size)
     {
-        // Maximum number of bones per mesh
-        // Must not be higher than same const in skinning shader
-        constexpr uint8_t MAX_BONES = 64;
-        // Maximum number of bones per vertex
-        constexpr uint8_t MAX_BONES_PER_VERTEX = 4;
-
-        //for (uint32_t i = 0; i < assimp_mesh->mNumBones; i++)
-        //{
-        //    uint32_t index = 0;
-
-        //    assert(assimp_mesh->mNumBones <= MAX_BONES);
-
-        //    string name = assimp_mesh->mBones[i]->mName.data;
-
-        //    if (boneMapping.find(name) == boneMapping.end())
-        //    {
-        //        // Bone not present, add new one
-        //        index = numBones;
-        //        numBones++;
-        //        BoneInfo bone;
-        //        boneInfo.push_back(bone);
-        //        boneInfo[index].offset = pMesh->mBones[i]->mOffsetMatrix;
-        //        boneMapping[name] = index;
-        //    }
-        //    else
-        //    {
-        //        index = boneMapping[name];
-        //    }
-
-        //    for (uint32_t j = 0; j < assimp_mesh->mBones[i]->mNumWeights; j++)
-        //    {
-        //        uint32_t vertexID = vertexOffset + pMesh->mBones[i]->mWeights[j].mVertexId;
-        //        Bones[vertexID].add(index, pMesh->mBones[i]->mWeights[j].mWeight);
-        //    }
-        //}
-        //boneTransforms.resize(numBones);
+        // a wavy grid as an obj, the right half mirrors its uvs so that the middle column has to be split
+        string obj;
+        obj.reserve(static_cast<size_t>(size) * size * 96);
+        for (uint32_t z = 0; z < size; z++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const float height = 2.0f * sin(static_cast<float>(x) * 0.1f) * cos(static_cast<float>(z) * 0.07f);
+                const uint32_t u   = x <= size / 2 ? x : size - 1 - x;
+                obj += "v " + to_string(x) + " " + to_string(height) + " " + to_string(z) + "\n";
+                obj += "vt " + to_string(static_cast<float>(u) / static_cast<float>(size)) + " " + to_string(static_cast<float>(z) / static_cast<float>(size)) + "\n";
+            }
+        }
+        for (uint32_t z = 0; z + 1 < size; z++)
+        {
+            for (uint32_t x = 0; x + 1 < size; x++)
+            {
+                const string i0 = to_string(z * size + x + 1), i1 = to_string(z * size + x + 2);
+                const string i2 = to_string((z + 1) * size + x + 1), i3 = to_string((z + 1) * size + x + 2);
+                obj += "f " + i0 + "/" + i0 + " " + i2 + "/" + i2 + " " + i1 + "/" + i1 + "\n";
+                obj += "f " + i1 + "/" + i1 + " " + i2 + "/" + i2 + " " + i3 + "/" + i3 + "\n";
+            }
+        }
+
+        Importer importer;
+        const aiScene* benchmark_scene = importer.ReadFileFromMemory(obj.data(), obj.size(), aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices, "obj");
+        if (!benchmark_scene || benchmark_scene->mNumMeshes == 0)
+        {
+            SP_LOG_ERROR("Failed to import the benchmark grid: %s", importer.GetErrorString());
+            return;
+        }
+
+        const aiMesh* assimp_mesh = benchmark_scene->mMeshes[0];
+        vector<RHI_Vertex_PosTexNorTan> vertices(assimp_mesh->mNumVertices);
+        for (uint32_t i = 0; i < assimp_mesh->mNumVertices; i++)
+        {
+            const aiVector3D& position = assimp_mesh->mVertices[i];
+            const aiVector3D& normal   = assimp_mesh->mNormals[i];
+            const aiVector3D& uv       = assimp_mesh->mTextureCoords[0][i];
+            vertices[i]                = RHI_Vertex_PosTexNorTan(Vector3(position.x, position.y, position.z), Vector2(uv.x, uv.y), Vector3(normal.x, normal.y, normal.z));
+        }
+        vector<uint32_t> indices;
+        indices.reserve(assimp_mesh->mNumFaces * 3);
+        for (uint32_t face = 0; face < assimp_mesh->mNumFaces; face++)
+        {
+            indices.insert(indices.end(), assimp_mesh->mFaces[face].mIndices, assimp_mesh->mFaces[face].mIndices + 3);
+        }
+
+        // the previous implementation, on the same scene
+        Stopwatch timer;
+        benchmark_scene = importer.ApplyPostProcessing(aiProcess_CalcTangentSpace);
+        const double assimp_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+
+        // the parallel scatter, with the split
+        vector<uint32_t> split_sources;
+        timer.Start();
+        geometry_processing::compute_normals_and_tangents(vertices, indices, false, &split_sources);
+        const double parallel_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+
+        // the tangents agree away from the seam, assimp doesn't split so the mirrored column is where they part
+        float difference_max = 0.0f;
+        if (benchmark_scene && benchmark_scene->mMeshes[0]->mTangents)
+        {
+            const aiVector3D* tangents = benchmark_scene->mMeshes[0]->mTangents;
+            for (uint32_t i = 0; i < assimp_mesh->mNumVertices; i++)
+            {
+                const float u = vertices[i].tex[0] * static_cast<float>(size);
+                if (abs(u - static_cast<float>(size / 2)) < 1.5f)
+                    continue;
+
+                const float d  = vertices[i].tan[0] * tangents[i].x + vertices[i].tan[1] * tangents[i].y + vertices[i].tan[2] * tangents[i].z;
+                difference_max = max(difference_max, acos(clamp(d, -1.0f, 1.0f)) * 57.29578f);
+            }
+        }
+
+        SP_LOG_INFO("Tangents of %u vertices: assimp %.1f ms, parallel %.1f ms (%.1fx), %u vertices split, max difference away from the seam %.3f degrees",
+            assimp_mesh->mNumVertices, assimp_ms, parallel_ms, assimp_ms / parallel_ms, static_cast<uint32_t>(split_sources.size()), difference_max);
     }
 }
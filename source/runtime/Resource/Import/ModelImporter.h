@@ -39,12 +39,20 @@ namespace spartan
         static void Initialize();
         static void Load(Mesh* mesh, const std::string& file_path);
 
+        // times the tangent generation against assimp's aiProcess_CalcTangentSpace on a generated grid
+        // imports a gltf whose nodes reference the same grid through two meshes, with and without sharing, checks that
+        // sharing ends up with a single sub-mesh and that it takes less memory and time, returns false on failure
+        static bool TestSharedSubMeshes();
+
+        static void BenchmarkTangents(uint32_t size = 512);
+
     private:
         static void ParseNode(const aiNode* node, Entity* parent_entity = nullptr);
         static void ParseNodeMeshes(const aiNode* node, Entity* new_entity);
         static void ParseNodeLight(const aiNode* node, Entity* new_entity);
+        static void ParseSkeleton();
         static void ParseAnimations();
-        static void ParseMesh(aiMesh* mesh, Entity* entity_parent);
-        static void ParseNodes(const aiMesh* mesh);
+        static void ParseMesh(aiMesh* mesh, const uint32_t mesh_index, Entity* entity_parent);
+        static uint32_t ParseMeshGeometry(aiMesh* mesh); // returns the index of the sub-mesh holding the geometry, which may already exist
     };
 }
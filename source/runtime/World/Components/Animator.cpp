@@ -0,0 +1,503 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ==========================
+#include "pch.h"
+#include "Animator.h"
+#include "Renderable.h"
+#include "ComponentPool.h"
+#include "../World.h"
+#include "../Entity.h"
+#include "../../Core/ThreadPool.h"
+#include "../../Core/ProgressTracker.h"
+#include "../../Core/Stopwatch.h"
+#include "../../Geometry/GeometryProcessing.h"
+#include "../../Geometry/GeometryGeneration.h"
+#include "../../Profiling/Profiler.h"
+#include "../../Rendering/Animation.h"
+#include "../../Rendering/GeometryPool.h"
+#include "../../Rendering/Renderer.h"
+#include "../../RHI/RHI_CommandList.h"
+#include "../../RHI/RHI_Buffer.h"
+#include "../../Resource/ResourceCache.h"
+SP_WARNINGS_OFF
+#include "../IO/pugixml.hpp"
+SP_WARNINGS_ON
+//=====================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace spartan::math;
+//============================
+
+namespace spartan
+{
+    namespace
+    {
+        float advance_time(const float time, const float delta, const float duration, const bool looping)
+        {
+            if (duration <= 0.0f)
+                return 0.0f;
+
+            const float t = time + delta;
+            if (!looping)
+                return clamp(t, 0.0f, duration);
+
+            const float wrapped = fmod(t, duration);
+            return wrapped < 0.0f ? wrapped + duration : wrapped;
+        }
+
+        // the entity and its descendants, minus the subtrees of descendants that have an animator of their own
+        void gather_entities(Entity* entity, vector<Entity*>& entities)
+        {
+            entities.emplace_back(entity);
+            for (Entity* child : entity->GetChildren())
+            {
+                if (!child->GetComponent<Animator>())
+                {
+                    gather_entities(child, entities);
+                }
+            }
+        }
+
+        // one staging buffer per command list of the graphics queue, a command list waits for its previous
+        // submission before it's reused, so the staging buffer it copied from is free again by then
+        array<shared_ptr<RHI_Buffer>, 2> staging_buffers;
+
+        struct VertexUpload
+        {
+            RHI_Buffer* destination             = nullptr;
+            uint64_t offset                     = 0; // bytes
+            uint64_t size                       = 0; // bytes, once packed
+            const RHI_Vertex_PosTexNorTan* data = nullptr;
+        };
+        vector<VertexUpload> uploads;
+        vector<RHI_BufferCopyRegion> regions;
+    }
+
+    Animator::Animator(Entity* entity) : Component(entity)
+    {
+        SP_REGISTER_ATTRIBUTE_GET_SET(GetAnimation, SetAnimation, Animation*);
+        SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_speed, float);
+        SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_looping, bool);
+    }
+
+    Animator::~Animator()
+    {
+        // the descendants go together with the entity, so their renderables can already be gone
+        for (SkinnedRenderable& skinned : m_renderables)
+        {
+            ReleaseVertices(skinned, false);
+        }
+    }
+
+    void Animator::Remove()
+    {
+        for (SkinnedRenderable& skinned : m_renderables)
+        {
+            ReleaseVertices(skinned, true);
+        }
+        m_renderables.clear();
+    }
+
+    void Animator::Save(pugi::xml_node& node)
+    {
+        node.append_attribute("animation") = m_animation ? m_animation->GetObjectName().c_str() : "";
+        node.append_attribute("time")      = m_time;
+        node.append_attribute("speed")     = m_speed;
+        node.append_attribute("looping")   = m_looping;
+    }
+
+    void Animator::Load(pugi::xml_node& node)
+    {
+        const string animation_name = node.attribute("animation").as_string();
+        m_animation                 = animation_name.empty() ? nullptr : ResourceCache::GetByName<Animation>(animation_name).get();
+        m_animation_previous        = nullptr;
+        m_time                      = node.attribute("time").as_float(0.0f);
+        m_speed                     = node.attribute("speed").as_float(1.0f);
+        m_looping                   = node.attribute("looping").as_bool(true);
+    }
+
+    void Animator::Play(Animation* animation, const float blend_seconds)
+    {
+        if (animation == m_animation)
+            return;
+
+        // cross-fade from the current animation, from where it currently is
+        if (m_animation && animation && blend_seconds > 0.0f)
+        {
+            m_animation_previous = m_animation;
+            m_time_previous      = m_time;
+            m_blend_duration     = blend_seconds;
+            m_blend_elapsed      = 0.0f;
+        }
+        else
+        {
+            m_animation_previous = nullptr;
+        }
+
+        m_animation = animation;
+        m_time      = 0.0f;
+    }
+
+    void Animator::GatherRenderables()
+    {
+        vector<Entity*> entities;
+        gather_entities(GetEntity(), entities);
+
+        vector<SkinnedRenderable> renderables;
+        for (Entity* entity : entities)
+        {
+            Renderable* renderable = entity->GetComponent<Renderable>();
+            Mesh* mesh             = renderable ? renderable->GetMesh() : nullptr;
+            if (!mesh || !mesh->GetSkeleton() || !mesh->GetSubMesh(renderable->GetSubMeshIndex()).skinned)
+                continue;
+
+            // keep the vertices and the allocation of renderables that were already skinned
+            const uint64_t entity_id = entity->GetObjectId();
+            auto it = find_if(m_renderables.begin(), m_renderables.end(), [renderable, entity_id](const SkinnedRenderable& skinned)
+            {
+                return skinned.renderable == renderable && skinned.entity_id == entity_id;
+            });
+
+            if (it != m_renderables.end())
+            {
+                renderables.emplace_back(move(*it));
+                m_renderables.erase(it);
+            }
+            else
+            {
+                SkinnedRenderable& skinned = renderables.emplace_back();
+                skinned.renderable         = renderable;
+                skinned.entity_id          = entity_id;
+            }
+        }
+
+        // what's left was destroyed or moved out of the hierarchy
+        for (SkinnedRenderable& skinned : m_renderables)
+        {
+            ReleaseVertices(skinned, true);
+        }
+        m_renderables = move(renderables);
+    }
+
+    bool Animator::Evaluate(const float delta_time)
+    {
+        if (!m_animation || m_renderables.empty())
+            return false;
+
+        // the sub-meshes of a model share its skeleton
+        const Skeleton* skeleton = m_renderables.front().renderable->GetMesh()->GetSkeleton();
+
+        // animations are built against a bone layout
+        if (m_animation->GetSkeletonHash() != skeleton->GetLayoutHash() ||
+            (m_animation_previous && m_animation_previous->GetSkeletonHash() != skeleton->GetLayoutHash()))
+            return false;
+
+        // advance
+        const float delta = delta_time * m_speed;
+        m_time            = advance_time(m_time, delta, m_animation->GetDuration(), m_looping);
+
+        // sample, cross-fading from the previous animation if needed
+        m_animation->Sample(m_time, m_pose);
+        if (m_animation_previous)
+        {
+            m_time_previous  = advance_time(m_time_previous, delta, m_animation_previous->GetDuration(), m_looping);
+            m_blend_elapsed += delta_time;
+
+            if (m_blend_elapsed < m_blend_duration)
+            {
+                m_animation_previous->Sample(m_time_previous, m_pose_previous);
+                Pose::Blend(m_pose_previous, m_pose, m_blend_elapsed / m_blend_duration, m_pose);
+            }
+            else
+            {
+                m_animation_previous = nullptr;
+            }
+        }
+
+        // bones, once for all the renderables
+        m_bone_matrices.resize(skeleton->GetBoneCount());
+        m_skinning_matrices.resize(skeleton->GetBoneCount());
+        skeleton->ComputeModelSpace(m_pose, m_bone_matrices.data());
+        skeleton->ComputeSkinning(m_bone_matrices.data(), m_skinning_matrices.data());
+
+        // vertices
+        for (SkinnedRenderable& skinned : m_renderables)
+        {
+            Renderable* renderable = skinned.renderable;
+            Mesh* mesh             = renderable->GetMesh();
+            if (!renderable->GetEntity()->GetActive() || mesh->GetSkeleton()->GetLayoutHash() != skeleton->GetLayoutHash())
+                continue;
+
+            const MeshLod& lod = mesh->GetSubMesh(renderable->GetSubMeshIndex()).lods[0];
+            skinned.vertices.resize(lod.vertex_count);
+            const BoundingBox bounding_box = Skeleton::Skin(
+                &mesh->GetVertices()[lod.vertex_offset],
+                &mesh->GetBoneWeights()[lod.vertex_offset],
+                lod.vertex_count,
+                m_skinning_matrices.data(),
+                skeleton->GetBoneCount(),
+                skinned.vertices.data()
+            );
+            renderable->SetBoundingBoxMesh(bounding_box);
+
+            skinned.dirty = true;
+        }
+
+        return true;
+    }
+
+    void Animator::ReleaseVertices(SkinnedRenderable& skinned, const bool detach)
+    {
+        // only detach from renderables that still exist
+        if (detach && skinned.vertex_allocation)
+        {
+            Entity* entity = World::GetEntityById(skinned.entity_id);
+            if (entity && entity->GetComponent<Renderable>() == skinned.renderable)
+            {
+                skinned.renderable->SetVertexOverride(nullptr);
+            }
+        }
+
+        GeometryPool::Free(skinned.vertex_allocation);
+        skinned.vertex_allocation = nullptr;
+        skinned.mesh              = nullptr;
+    }
+
+    void Animator::Tick(const float delta_time)
+    {
+        const vector<Animator*>& animators = ComponentPool<Animator>::Get().GetComponents();
+        if (animators.empty())
+            return;
+
+        SP_PROFILE_CPU();
+
+        // the hierarchy is only walked here, on the main thread
+        for (Animator* animator : animators)
+        {
+            animator->GatherRenderables();
+        }
+
+        // characters are independent of each other, so each worker takes a range of them
+        ThreadPool::ParallelLoop([&animators, delta_time](uint32_t start, uint32_t end)
+        {
+            for (uint32_t i = start; i < end; i++)
+            {
+                if (animators[i]->GetEntity()->GetActive())
+                {
+                    animators[i]->Evaluate(delta_time);
+                }
+            }
+        }, static_cast<uint32_t>(animators.size()));
+    }
+
+    void Animator::UploadVertices(RHI_CommandList* cmd_list)
+    {
+        if (ProgressTracker::IsLoading())
+            return;
+
+        const uint64_t stride = sizeof(RHI_Vertex_PosTexNorTan_Gpu);
+        uint64_t size         = 0;
+        uploads.clear();
+
+        World::ForEach<Animator>([&size, stride](Animator* animator)
+        {
+            for (SkinnedRenderable& skinned : animator->m_renderables)
+            {
+                if (!skinned.dirty || skinned.vertices.empty())
+                    continue;
+
+                skinned.dirty          = false;
+                Renderable* renderable = skinned.renderable;
+
+                // (re)allocate when the renderable changed its geometry, allocating uploads the vertices as well
+                const uint32_t vertex_count = static_cast<uint32_t>(skinned.vertices.size());
+                if (!skinned.vertex_allocation || !renderable->HasVertexOverride() || skinned.mesh != renderable->GetMesh() ||
+                    skinned.sub_mesh_index != renderable->GetSubMeshIndex() || skinned.vertex_allocation->count != vertex_count)
+                {
+                    animator->ReleaseVertices(skinned, true);
+                    skinned.vertex_allocation = GeometryPool::Allocate(GeometryPoolType::Vertex, vertex_count, skinned.vertices.data());
+                    skinned.mesh              = renderable->GetMesh();
+                    skinned.sub_mesh_index    = renderable->GetSubMeshIndex();
+                    renderable->SetVertexOverride(skinned.vertex_allocation);
+                    continue;
+                }
+                renderable->SetVertexOverrideDirty();
+
+                VertexUpload& upload = uploads.emplace_back();
+                upload.destination   = skinned.vertex_allocation->buffer;
+                upload.offset        = static_cast<uint64_t>(skinned.vertex_allocation->offset) * stride;
+                upload.size          = static_cast<uint64_t>(vertex_count) * stride;
+                upload.data          = skinned.vertices.data();
+                size                += upload.size;
+            }
+        });
+
+        if (uploads.empty())
+            return;
+
+        // grow the staging buffer of this frame's command list, the old one is released once the gpu is done with it
+        shared_ptr<RHI_Buffer>& staging = staging_buffers[Renderer::GetFrameNumber() % staging_buffers.size()];
+        if (!staging || staging->GetObjectSize() < size)
+        {
+            const uint32_t vertex_count = static_cast<uint32_t>((size + size / 2) / stride);
+            staging = make_shared<RHI_Buffer>(RHI_Buffer_Type::Vertex, stride, vertex_count, nullptr, true, "animator_staging");
+        }
+
+        // fill it, grouping the copies by the page they go to
+        sort(uploads.begin(), uploads.end(), [](const VertexUpload& a, const VertexUpload& b) { return a.destination < b.destination; });
+        uint8_t* mapped = static_cast<uint8_t*>(staging->GetMappedData());
+        uint64_t offset = 0;
+        for (size_t i = 0; i < uploads.size(); i++)
+        {
+            geometry_processing::pack_for_gpu(uploads[i].data, static_cast<uint32_t>(uploads[i].size / stride), reinterpret_cast<RHI_Vertex_PosTexNorTan_Gpu*>(mapped + offset));
+
+            RHI_BufferCopyRegion& region = regions.emplace_back();
+            region.offset_source         = offset;
+            region.offset_destination    = uploads[i].offset;
+            region.size                  = uploads[i].size;
+            offset                      += uploads[i].size;
+
+            // one copy per page, usually there is only one
+            if (i + 1 == uploads.size() || uploads[i + 1].destination != uploads[i].destination)
+            {
+                cmd_list->CopyBuffer(staging.get(), uploads[i].destination, regions.data(), static_cast<uint32_t>(regions.size()));
+                regions.clear();
+            }
+        }
+    }
+
+    void Animator::Shutdown()
+    {
+        staging_buffers = {};
+    }
+
+    void Animator::Benchmark(const uint32_t character_count, const uint32_t bone_count)
+    {
+        // a root with four limbs hanging off it, each bone a step further along its limb
+        const Vector3 directions[] = { Vector3::Up, Vector3::Down, Vector3::Left, Vector3::Right };
+        const uint32_t limb_length = max((bone_count - 1) / 4, 1u);
+        Skeleton skeleton;
+        vector<Vector3> bind_positions(bone_count, Vector3::Zero); // model space
+        for (uint32_t i = 0; i < bone_count; i++)
+        {
+            SkeletonBone bone;
+            bone.name = "bone_" + to_string(i);
+            if (i > 0)
+            {
+                const bool limb_start = (i - 1) % limb_length == 0;
+                bone.parent           = limb_start ? 0 : static_cast<int32_t>(i - 1);
+                bone.position         = directions[((i - 1) / limb_length) % 4] * 0.1f;
+                bind_positions[i]     = bind_positions[bone.parent] + bone.position;
+            }
+            bone.inverse_bind = Matrix::CreateTranslation(-bind_positions[i]);
+            skeleton.AddBone(bone);
+        }
+
+        // a box per bone, weighted half to it and half to its parent
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        vector<uint32_t> indices;
+        vector<BoneWeights> weights;
+        for (uint32_t i = 0; i < bone_count; i++)
+        {
+            vector<RHI_Vertex_PosTexNorTan> box_vertices;
+            vector<uint32_t> box_indices;
+            geometry_generation::generate_cube(&box_vertices, &box_indices);
+
+            const uint32_t vertex_offset = static_cast<uint32_t>(vertices.size());
+            for (RHI_Vertex_PosTexNorTan& vertex : box_vertices)
+            {
+                vertex.pos[0] = vertex.pos[0] * 0.05f + bind_positions[i].x;
+                vertex.pos[1] = vertex.pos[1] * 0.05f + bind_positions[i].y;
+                vertex.pos[2] = vertex.pos[2] * 0.05f + bind_positions[i].z;
+
+                BoneWeights& weight = weights.emplace_back();
+                weight.bone[0]      = static_cast<uint16_t>(i);
+                weight.bone[1]      = static_cast<uint16_t>(max(skeleton.GetBone(i).parent, 0));
+                weight.weight[0]    = 0.5f;
+                weight.weight[1]    = 0.5f;
+            }
+            vertices.insert(vertices.end(), box_vertices.begin(), box_vertices.end());
+            for (uint32_t index : box_indices)
+            {
+                indices.emplace_back(vertex_offset + index);
+            }
+        }
+        const uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+
+        shared_ptr<Mesh> mesh = make_shared<Mesh>();
+        mesh->SetObjectName("benchmark_animator");
+        mesh->SetSkeleton(skeleton);
+        mesh->AddGeometry(vertices, indices, false, nullptr, &weights);
+
+        // every bone swings back and forth, offset along the limb so that no two bones share a rotation
+        vector<AnimationNode> nodes(bone_count);
+        for (uint32_t i = 0; i < bone_count; i++)
+        {
+            nodes[i].name = skeleton.GetBone(i).name;
+            for (uint32_t key = 0; key <= 4; key++)
+            {
+                const float angle = sin(static_cast<float>(key) * pi * 0.5f + static_cast<float>(i)) * 20.0f * deg_to_rad;
+                nodes[i].rotationFrames.push_back({ key * 0.25, Quaternion::FromAxisAngle(Vector3::Forward, angle) });
+            }
+        }
+        shared_ptr<Animation> animation = make_shared<Animation>();
+        animation->Build(skeleton, nodes, 1.0f);
+
+        // the characters, out of phase so that they don't all sample the same frame
+        const bool playing = Engine::IsFlagSet(EngineMode::Playing);
+        for (uint32_t i = 0; i < character_count; i++)
+        {
+            Entity* entity = World::CreateEntity();
+            entity->SetPosition(Vector3(static_cast<float>(i % 25) * 2.0f, 0.0f, static_cast<float>(i / 25) * 2.0f));
+            entity->AddComponent<Renderable>()->SetMesh(mesh.get(), 0);
+            Animator* animator = entity->AddComponent<Animator>();
+            animator->Play(animation.get());
+            animator->SetTime(static_cast<float>(i) / static_cast<float>(character_count));
+        }
+
+        // the first tick gathers the renderables, it's left out
+        const float delta_time    = 1.0f / 60.0f;
+        const uint32_t tick_count = 60;
+        Tick(delta_time);
+        Stopwatch timer;
+        for (uint32_t i = 0; i < tick_count; i++)
+        {
+            Tick(delta_time);
+        }
+        const double tick_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6) / tick_count;
+
+        World::Shutdown();
+        Engine::SetFlag(EngineMode::Playing, playing);
+
+        const double skinned_vertices = static_cast<double>(character_count) * vertex_count;
+        SP_LOG_INFO("Animator, %u characters x %u bones (%u vertices each) on %u threads: %.2f ms per tick, %.2f us per character, %.1f M vertices/sec",
+            character_count,
+            bone_count,
+            vertex_count,
+            ThreadPool::GetThreadCount(),
+            tick_ms,
+            tick_ms * 1000.0 / static_cast<double>(character_count),
+            skinned_vertices / tick_ms / 1e3);
+    }
+}
@@ -0,0 +1,115 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =======================
+#include "Component.h"
+#include <vector>
+#include "../../Rendering/Skeleton.h"
+#include "../../RHI/RHI_Vertex.h"
+//==================================
+
+namespace spartan
+{
+    class Animation;
+    class Renderable;
+    class Mesh;
+    class RHI_CommandList;
+    struct GeometryAllocation;
+
+    // plays animations on a skeleton, the pose is evaluated once and then every skinned renderable of the entity and
+    // its descendants (the sub-meshes of a model) is skinned with it on the cpu, the renderables then draw those vertices
+    // instead of the mesh's bind pose, descendants which have an animator of their own are skinned by that one instead
+    class Animator : public Component
+    {
+    public:
+        Animator(Entity* entity);
+        ~Animator();
+
+        // icomponent
+        void Remove() override;
+        void Save(pugi::xml_node& node) override;
+        void Load(pugi::xml_node& node) override;
+
+        // playback, a blend time cross-fades from the animation that is currently playing
+        void Play(Animation* animation, const float blend_seconds = 0.0f);
+        Animation* GetAnimation() const         { return m_animation; }
+        void SetAnimation(Animation* animation) { Play(animation); }
+        float GetTime() const                   { return m_time; }
+        void SetTime(const float time)          { m_time = time; }
+        float GetSpeed() const                  { return m_speed; }
+        void SetSpeed(const float speed)        { m_speed = speed; }
+        bool GetLooping() const                 { return m_looping; }
+        void SetLooping(const bool looping)     { m_looping = looping; }
+
+        // model space transform of every bone, as of the last evaluation
+        const std::vector<math::Matrix>& GetBoneMatrices() const { return m_bone_matrices; }
+
+        // samples, blends and skins every animator in the world on the thread pool
+        static void Tick(const float delta_time);
+
+        // copies the vertices which were skinned by the last tick to the gpu, in one batch through a staging buffer
+        static void UploadVertices(RHI_CommandList* cmd_list);
+
+        // releases the staging buffers, before the rhi goes away
+        static void Shutdown();
+
+        // benchmarks, characters with a chain skeleton and a box per bone, timing the cpu side of Tick() (sampling, blending and skinning)
+        static void Benchmark(const uint32_t character_count = 500, const uint32_t bone_count = 80);
+
+    private:
+        struct SkinnedRenderable
+        {
+            Renderable* renderable                = nullptr;
+            uint64_t entity_id                    = 0;
+            std::vector<RHI_Vertex_PosTexNorTan> vertices;
+            GeometryAllocation* vertex_allocation = nullptr;
+            const Mesh* mesh                      = nullptr; // the geometry that the vertices were skinned from
+            uint32_t sub_mesh_index               = 0;
+            bool dirty                            = false;
+        };
+
+        void GatherRenderables();
+        bool Evaluate(const float delta_time);
+        void ReleaseVertices(SkinnedRenderable& skinned, const bool detach);
+
+        // playback
+        Animation* m_animation          = nullptr;
+        Animation* m_animation_previous = nullptr;
+        float m_time                    = 0.0f;
+        float m_time_previous           = 0.0f;
+        float m_speed                   = 1.0f;
+        bool m_looping                  = true;
+        float m_blend_duration          = 0.0f;
+        float m_blend_elapsed           = 0.0f;
+
+        // evaluation, once per animator and shared by all of its renderables
+        Pose m_pose;
+        Pose m_pose_previous;
+        std::vector<math::Matrix> m_bone_matrices;
+        std::vector<math::Matrix> m_skinning_matrices;
+
+        // skinned vertices, they replace lod 0 of each renderable
+        std::vector<SkinnedRenderable> m_renderables;
+    };
+}
@@ -24,8 +24,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "AudioSource.h"
 #include "Camera.h"
 #include "../Entity.h"
+#include "../../Audio/AudioMixer.h"
 SP_WARNINGS_OFF
-#include <SDL3/SDL_audio.h>
 #include "../IO/pugixml.hpp"
 SP_WARNINGS_ON
 //==========================
@@ -35,142 +35,16 @@ using namespace std;
 using namespace spartan::math;
 //============================
 
-#define CHECK_SDL_ERROR(call)           \
-if (!(call)) {                          \
-    SP_LOG_ERROR("%s", SDL_GetError()); \
-    return;                             \
-}
-
-namespace audio_clip_cache
-{
-    struct AudioClip
-    {
-        uint8_t* buffer     = nullptr;
-        uint32_t length     = 0;
-        SDL_AudioSpec* spec = nullptr;
-
-        ~AudioClip()
-        {
-            if (buffer)
-            {
-                SDL_free(buffer);
-                buffer = nullptr;
-            }
-            delete spec;
-            spec = nullptr;
-        }
-    };
-    unordered_map<string, weak_ptr<AudioClip>> cache;
-
-    shared_ptr<AudioClip> Get(const string& file_path)
-    {
-        auto it = cache.find(file_path);
-        shared_ptr<AudioClip> clip;
-        if (it != cache.end())
-        {
-            clip = it->second.lock();
-            if (clip)
-            {
-                return clip;
-            }
-        }
-
-        SDL_AudioSpec wav_spec = {};
-        uint8_t* wav_buffer    = nullptr;
-        uint32_t wav_length    = 0;
-        if (!SDL_LoadWAV(file_path.c_str(), &wav_spec, &wav_buffer, &wav_length))
-        {
-            SP_LOG_ERROR("%s", SDL_GetError());
-            return nullptr;
-        }
-
-        SDL_AudioSpec target_spec = {};
-        target_spec.freq          = wav_spec.freq;
-        target_spec.format        = SDL_AUDIO_F32;
-        target_spec.channels      = 1;
-        uint8_t* target_buffer    = nullptr;
-        int target_length         = 0;
-        if (!SDL_ConvertAudioSamples(&wav_spec, wav_buffer, static_cast<int>(wav_length), &target_spec, &target_buffer, &target_length))
-        {
-            SP_LOG_ERROR("%s", SDL_GetError());
-            SDL_free(wav_buffer);
-            return nullptr;
-        }
-        SDL_free(wav_buffer);
-
-        clip         = make_shared<AudioClip>();
-        clip->buffer = target_buffer;
-        clip->length = static_cast<uint32_t>(target_length);
-        clip->spec   = new SDL_AudioSpec(target_spec);
-
-        cache[file_path] = clip;
-        return clip;
-    }
-
-    void ReleaseAll()
-    {
-        cache.clear();
-    }
-}
-
-namespace audio_device
-{
-    mutex device_mutex;
-    SDL_AudioSpec spec  = {};
-    uint32_t id         = 0;
-    uint32_t references = 0;
-
-    // acquire the shared audio device, open it if it's not already open
-    void acquire()
-    {
-        lock_guard<mutex> lock(device_mutex);
-        if (references == 0)
-        {
-            id = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, nullptr);
-            if (id == 0)
-            {
-                SP_LOG_ERROR("%s", SDL_GetError());
-                return;
-            }
-            if (!SDL_GetAudioDeviceFormat(id, &spec, nullptr))
-            {
-                SP_LOG_ERROR("%s", SDL_GetError());
-            }
-        }
-        ++references;
-    }
-
-    // release the shared audio device, close it when no one is using it
-    void release()
-    {
-        lock_guard<mutex> lock(device_mutex);
-        --references;
-        if (references == 0 && id != 0)
-        {
-            SDL_CloseAudioDevice(id);
-            id = 0;
-        }
-    }
-}
-
 namespace spartan
 {
     AudioSource::AudioSource(Entity* entity) : Component(entity)
     {
-        audio_device::acquire();
+
     }
 
     AudioSource::~AudioSource()
     {
         StopClip();
-
-        if (m_stream)
-        {
-            SDL_DestroyAudioStream(m_stream);
-            m_stream = nullptr;
-        }
-
-        audio_device::release();
     }
 
     void AudioSource::Initialize()
@@ -201,6 +75,13 @@ namespace spartan
         if (!m_is_playing)
             return;
 
+        // clips that don't loop stop by themselves
+        if (!AudioMixer::IsVoicePlaying(m_voice))
+        {
+            StopClip();
+            return;
+        }
+
         if (m_is_3d)
         {
             if (Camera* camera = World::GetCamera())
@@ -238,7 +119,6 @@ namespace spartan
                     target_ratio    = clamp(target_ratio, 0.5f, 2.0f);
                     const float s   = 0.2f; // smoothing factor
                     m_doppler_ratio = lerp(m_doppler_ratio, target_ratio, s);
-                    SetPitch(m_pitch);
                 }
                
                 // update previous positions
@@ -246,8 +126,8 @@ namespace spartan
                 position_previous        = sound_position;
             }
         }
-       
-        FeedAudioChunk();
+
+        UpdateVoice();
     }
 
     void AudioSource::Save(pugi::xml_node& node)
@@ -259,6 +139,7 @@ namespace spartan
         node.append_attribute("play_on_start") = m_play_on_start;
         node.append_attribute("volume")        = m_volume;
         node.append_attribute("pitch")         = m_pitch;
+        node.append_attribute("priority")      = m_priority;
     }
 
     void AudioSource::Load(pugi::xml_node& node)
@@ -270,6 +151,7 @@ namespace spartan
         m_play_on_start = node.attribute("play_on_start").as_bool(true);
         m_volume        = node.attribute("volume").as_float(1.0f);
         m_pitch         = node.attribute("pitch").as_float(1.0f);
+        m_priority      = node.attribute("priority").as_float(1.0f);
 
         SetAudioClip(m_file_path);
     }
@@ -279,7 +161,7 @@ namespace spartan
         // store the filename from the provided path
         m_file_path = file_path;
         m_name      = FileSystem::GetFileNameFromFilePath(file_path);
-        m_clip      = audio_clip_cache::Get(file_path);
+        m_clip      = AudioMixer::LoadClip(file_path);
         if (!m_clip)
         {
             SP_LOG_ERROR("Failed to load audio clip: %s", file_path.c_str());
@@ -288,31 +170,20 @@ namespace spartan
 
     void AudioSource::PlayClip()
     {
-        if (!m_clip || m_clip->length == 0)
+        if (!m_clip || m_clip->frame_count == 0)
         {
             SP_LOG_ERROR("No valid audio clip set");
             return;
         }
 
-        // create stream: source is stereo float32, destination is device spec
-        SDL_AudioSpec src_spec = {};
-        src_spec.freq          = m_clip->spec->freq;
-        src_spec.format        = SDL_AUDIO_F32;
-        src_spec.channels      = 2;
-        m_stream = SDL_CreateAudioStream(&src_spec, &audio_device::spec);
-        if (!m_stream)
-        {
-            SP_LOG_ERROR("%s", SDL_GetError());
-            return;
-        }
+        StopClip();
 
-        CHECK_SDL_ERROR(SDL_BindAudioStream(audio_device::id, m_stream));
+        m_voice = AudioMixer::CreateVoice(m_clip, AudioVoiceParameters());
+        if (m_voice == 0)
+            return;
 
-        // start playing
-        CHECK_SDL_ERROR(SDL_ResumeAudioStreamDevice(m_stream));
-        m_position   = 0;
         m_is_playing = true;
-        SetPitch(m_pitch);
+        UpdateVoice();
     }
 
     void AudioSource::StopClip()
@@ -320,22 +191,14 @@ namespace spartan
         if (!m_is_playing)
             return;
 
-        if (m_stream)
-        {
-            SDL_ClearAudioStream(m_stream);
-            SDL_DestroyAudioStream(m_stream);
-            m_stream = nullptr;
-        }
+        AudioMixer::DestroyVoice(m_voice);
+        m_voice      = 0;
         m_is_playing = false;
-        m_position = 0;
     }
 
     float AudioSource::GetProgress() const
     {
-        if (!m_clip || m_clip->length == 0)
-            return 0.0f;
-
-        return static_cast<float>(m_position) / static_cast<float>(m_clip->length);
+        return m_is_playing ? AudioMixer::GetVoiceProgress(m_voice) : 0.0f;
     }
 
     void AudioSource::SetMute(bool mute)
@@ -354,66 +217,24 @@ namespace spartan
     void AudioSource::SetPitch(const float pitch)
     {
         m_pitch = clamp(pitch, 0.01f, 5.0f);
-   
-        if (m_is_playing && m_stream)
-        {
-            const float effective_pitch = m_pitch * m_doppler_ratio;
-            CHECK_SDL_ERROR(SDL_SetAudioStreamFrequencyRatio(m_stream, effective_pitch));
-        }
     }
 
-    void AudioSource::FeedAudioChunk()
+    void AudioSource::SetPriority(const float priority)
     {
-        if (!m_stream || !m_is_playing)
-            return;
+        m_priority = max(priority, 0.0f);
+    }
 
-        int queued               = SDL_GetAudioStreamQueued(m_stream);
-        const int low_water_mark = 16384;
-        if (queued >= low_water_mark)
+    void AudioSource::UpdateVoice()
+    {
+        if (!m_is_playing)
             return;
 
-        const uint32_t target_mono_samples = 2048;
-        uint32_t bytes_to_add = target_mono_samples * sizeof(float);
-        if (m_position + bytes_to_add > m_clip->length)
-        {
-            bytes_to_add = m_clip->length - m_position;
-        }
-
-        if (bytes_to_add == 0)
-        {
-            if (m_loop)
-            {
-                m_position = 0;
-                bytes_to_add = min<uint32_t>(target_mono_samples * sizeof(float), m_clip->length);
-            }
-            else
-            {
-                StopClip();
-                return;
-            }
-        }
-
-        uint32_t num_samples = bytes_to_add / sizeof(float);
-        float* mono_samples  = reinterpret_cast<float*>(m_clip->buffer + m_position);
-        vector<float> stereo_chunk(num_samples * 2);
-        float gain           = m_volume * m_attenuation * (m_mute ? 0.0f : 1.0f);
-
-        // constant power panning
-        float left_factor    = sqrt(0.5f * (1.0f - m_pan));
-        float right_factor   = sqrt(0.5f * (1.0f + m_pan));
-        float left_gain      = gain * left_factor;
-        float right_gain     = gain * right_factor;
-        for (uint32_t i = 0; i < num_samples; ++i)
-        {
-            float sample = mono_samples[i];
-            stereo_chunk[2 * i] = sample * left_gain;
-            stereo_chunk[2 * i + 1]= sample * right_gain;
-        }
-
-        if (!SDL_PutAudioStreamData(m_stream, stereo_chunk.data(), static_cast<int>(stereo_chunk.size() * sizeof(float))))
-        {
-            SP_LOG_ERROR("%s", SDL_GetError());
-        }
-        m_position += bytes_to_add;
+        AudioVoiceParameters parameters;
+        parameters.gain     = m_mute ? 0.0f : m_volume * (m_is_3d ? m_attenuation : 1.0f);
+        parameters.pan      = m_is_3d ? m_pan : 0.0f;
+        parameters.pitch    = m_pitch * (m_is_3d ? m_doppler_ratio : 1.0f);
+        parameters.priority = m_priority;
+        parameters.loop     = m_loop;
+        AudioMixer::SetVoiceParameters(m_voice, parameters);
     }
 }
@@ -26,15 +26,10 @@ connection with the software or the use or other dealings in the software.
 #include <string>
 //=====================
 
-struct SDL_AudioStream;
-struct SDL_AudioSpec;
-namespace audio_clip_cache
+namespace spartan
 {
     struct AudioClip;
-}
 
-namespace spartan
-{
     class AudioSource : public Component
     {
     public:
@@ -76,8 +71,12 @@ namespace spartan
         float GetPitch() const { return m_pitch; }
         void SetPitch(const float pitch);
 
+        // when there are more voices than the mixer's budget, the ones with a low priority (relative to their loudness) are virtualized
+        float GetPriority() const { return m_priority; }
+        void SetPriority(const float priority);
+
     private:
-        void FeedAudioChunk();
+        void UpdateVoice();
 
         std::string m_name                             = "N/A";
         bool m_is_3d                                   = false;
@@ -88,12 +87,12 @@ namespace spartan
         float m_pitch                                  = 1.0f;
         float m_attenuation                            = 1.0f;
         float m_pan                                    = 0.0f; // -1.0 (left) to 1.0 (right)
+        float m_priority                               = 1.0f;
         bool m_is_playing                              = false;
-        uint32_t m_position                            = 0; // in bytes
-        SDL_AudioStream* m_stream                      = nullptr;
+        uint32_t m_voice                               = 0; // mixer voice, 0 if none
         float m_doppler_ratio                          = 1.0f;
         math::Vector3 position_previous                = math::Vector3::Zero;
-        std::shared_ptr<audio_clip_cache::AudioClip> m_clip = nullptr;
+        std::shared_ptr<AudioClip> m_clip              = nullptr;
         std::string m_file_path;
     };
 }
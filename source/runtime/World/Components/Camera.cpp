@@ -191,53 +191,32 @@ namespace spartan
         Entity* best_entity    = nullptr;
         for (RayHitResult& broad_hit : hits)
         {
-            Renderable* renderable = broad_hit.m_entity->GetComponent<Renderable>();
-            static vector<uint32_t> indices;
-            indices.clear();
-            static vector<RHI_Vertex_PosTexNorTan> vertices;
-            vertices.clear();
-            renderable->GetGeometry(&indices, &vertices);
-            if (indices.empty() || vertices.empty())
+            // traverse the mesh bvh in object space
+            float distance = 0.0f;
+            if (!broad_hit.m_entity->GetComponent<Renderable>()->Raycast(ray, distance))
                 continue;
 
-            const Matrix& transform = broad_hit.m_entity->GetMatrix();
+            Vector3 world_hit = ray.GetStart() + ray.GetDirection() * distance;
 
-            for (uint32_t i = 0; i < indices.size(); i += 3)
-            {
-                Vector3 p1(vertices[indices[i]].pos);
-                Vector3 p2(vertices[indices[i + 1]].pos);
-                Vector3 p3(vertices[indices[i + 2]].pos);
-
-                p1 = p1 * transform;
-                p2 = p2 * transform;
-                p3 = p3 * transform;
-
-                float distance = ray.HitDistance(p1, p2, p3);
-                if (distance == numeric_limits<float>::infinity())
-                    continue;
-
-                Vector3 world_hit = ray.GetStart() + ray.GetDirection() * distance;
-
-                // project to clip space
-                Vector4 clip = Vector4(world_hit, 1.0f) * GetViewProjectionMatrix();
-                if (clip.w == 0.0f)
-                    continue;
+            // project to clip space
+            Vector4 clip = Vector4(world_hit, 1.0f) * GetViewProjectionMatrix();
+            if (clip.w == 0.0f)
+                continue;
 
-                // ndc → screen
-                Vector2 screen_pos(
-                    (clip.x / clip.w * 0.5f + 0.5f) * Renderer::GetViewport().width,
-                    (clip.y / clip.w * 0.5f + 0.5f) * Renderer::GetViewport().height
-                );
+            // ndc → screen
+            Vector2 screen_pos(
+                (clip.x / clip.w * 0.5f + 0.5f) * Renderer::GetViewport().width,
+                (clip.y / clip.w * 0.5f + 0.5f) * Renderer::GetViewport().height
+            );
 
-                float screen_dist = (screen_pos - cursor).Length();
+            float screen_dist = (screen_pos - cursor).Length();
 
-                // prefer smallest screen distance, then depth
-                if (screen_dist < best_screen_dist || (screen_dist == best_screen_dist && distance < best_depth))
-                {
-                    best_screen_dist = screen_dist;
-                    best_depth       = distance;
-                    best_entity      = broad_hit.m_entity;
-                }
+            // prefer smallest screen distance, then depth
+            if (screen_dist < best_screen_dist || (screen_dist == best_screen_dist && distance < best_depth))
+            {
+                best_screen_dist = screen_dist;
+                best_depth       = distance;
+                best_entity      = broad_hit.m_entity;
             }
         }
 
@@ -22,11 +22,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ===========
 #include "pch.h"
 #include "Component.h"
+#include "../Entity.h"
 #include "Light.h"
 #include "Physics.h"
 #include "Camera.h"
 #include "AudioSource.h"
 #include "Terrain.h"
+#include "Animator.h"
 //======================
 
 //= NAMESPACES =====
@@ -41,6 +43,27 @@ namespace spartan
         m_enabled    = true;
     }
 
+    void Component::SetAttributes(const vector<Attribute>& attributes)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_attributes.size()); i++)
+        {
+            m_attributes[i].setter(attributes[i].getter());
+        }
+
+        m_entity_ptr->MarkDirty();
+    }
+
+    void Component::SetAttributeValues(const vector<any>& values)
+    {
+        const uint32_t count = static_cast<uint32_t>(min(values.size(), m_attributes.size()));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            m_attributes[i].setter(values[i]);
+        }
+
+        m_entity_ptr->MarkDirty();
+    }
+
     template <typename T>
     ComponentType Component::TypeToEnum() { return ComponentType::Max; }
 
@@ -56,4 +79,5 @@ namespace spartan
     REGISTER_COMPONENT(Renderable,  ComponentType::Renderable)
     REGISTER_COMPONENT(Physics,     ComponentType::Physics)
     REGISTER_COMPONENT(Terrain,     ComponentType::Terrain)
+    REGISTER_COMPONENT(Animator,    ComponentType::Animator)
 }
@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES ========================
 #include <any>
+#include <algorithm>
 #include <vector>
 #include <functional>
 #include "../../Core/SpartanObject.h"
@@ -46,6 +47,7 @@ namespace spartan
         Physics,
         Renderable,
         Terrain,
+        Animator,
         Max
     };
     // after re-ordering the above, ensure .world save/load works
@@ -99,6 +101,7 @@ namespace spartan
                 case ComponentType::Physics:     return "physics";
                 case ComponentType::Renderable:  return "renderable";
                 case ComponentType::Terrain:     return "terrain";
+                case ComponentType::Animator:    return "animator";
                 default:
                     assert(false && "TypeToString: Unknown ComponentType");
                     return {};
@@ -113,6 +116,7 @@ namespace spartan
             if (name == "physics")      return ComponentType::Physics;
             if (name == "renderable")   return ComponentType::Renderable;
             if (name == "terrain")      return ComponentType::Terrain;
+            if (name == "animator")     return ComponentType::Animator;
         
             assert(false && "StringToType: Unknown component name");
             return ComponentType::Max;
@@ -122,15 +126,16 @@ namespace spartan
         void SetType(ComponentType type)       { m_type = type; }
 
         const auto& GetAttributes() const { return m_attributes; }
-        void SetAttributes(const std::vector<Attribute>& attributes)
-        { 
-            for (uint32_t i = 0; i < static_cast<uint32_t>(m_attributes.size()); i++)
-            {
-                m_attributes[i].setter(attributes[i].getter());
-            }
-        }
+        void SetAttributes(const std::vector<Attribute>& attributes);
+
+        // applies values previously captured from the attribute getters, in registration order
+        void SetAttributeValues(const std::vector<std::any>& values);
 
         Entity* GetEntity() const { return m_entity_ptr; }
+
+        // slot within the pool that stores all components of this type
+        uint32_t GetPoolSlot() const          { return m_pool_slot; }
+        void SetPoolSlot(const uint32_t slot) { m_pool_slot = slot; }
  
     protected:
         #define SP_REGISTER_ATTRIBUTE_GET_SET(getter, setter, type) RegisterAttribute(  \
@@ -164,5 +169,7 @@ namespace spartan
     private:
         // the attributes of the component
         std::vector<Attribute> m_attributes;
+        // the slot of the component within its pool
+        uint32_t m_pool_slot = 0;
     };
 }
@@ -0,0 +1,230 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES =========
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include "Component.h"
+//====================
+
+namespace spartan
+{
+    template <class T>
+    class ComponentPool;
+
+    // non-owning reference to a pooled component, resolves to null once the component is destroyed
+    template <class T>
+    struct ComponentHandle
+    {
+        static constexpr uint32_t invalid = std::numeric_limits<uint32_t>::max();
+
+        uint32_t slot       = invalid;
+        uint32_t generation = 0;
+
+        T* Get() const        { return ComponentPool<T>::Get().Resolve(*this); }
+        bool IsValid() const  { return Get() != nullptr; }
+        T* operator->() const { return Get(); }
+    };
+
+    // contiguous, chunked storage for all components of one type
+    // - addresses are stable, components register attributes which capture this
+    // - live components are also tracked in a dense array so iterating them is linear and free of holes
+    template <class T>
+    class ComponentPool
+    {
+    public:
+        static ComponentPool& Get()
+        {
+            static ComponentPool pool;
+            return pool;
+        }
+
+        // components still alive here are not destroyed, this runs during static destruction when the systems
+        // their destructors use are gone, World::Shutdown() clears the pools while those systems are still up
+        ~ComponentPool() = default;
+
+        template <typename... Args>
+        T* Create(Args&&... args)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // grab a free slot, or grow by one chunk
+            if (m_free_slots.empty())
+            {
+                AddChunk();
+            }
+            const uint32_t slot = m_free_slots.back();
+            m_free_slots.pop_back();
+
+            T* component = new (GetAddress(slot)) T(std::forward<Args>(args)...);
+
+            Slot& info       = m_slots[slot];
+            info.alive       = true;
+            info.dense_index = static_cast<uint32_t>(m_dense.size());
+            m_dense.emplace_back(component);
+            m_dense_slots.emplace_back(slot);
+
+            component->SetPoolSlot(slot);
+            return component;
+        }
+
+        // allocates enough chunks up front so that the next count creations don't have to grow the pool
+        void Reserve(const uint32_t count)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            while (m_free_slots.size() < count)
+            {
+                AddChunk();
+            }
+            m_dense.reserve(m_dense.size() + count);
+            m_dense_slots.reserve(m_dense_slots.size() + count);
+        }
+
+        void Destroy(T* component)
+        {
+            if (!component)
+                return;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            const uint32_t slot = component->GetPoolSlot();
+            Slot& info          = m_slots[slot];
+            if (!info.alive)
+                return;
+
+            // swap-remove from the dense array
+            const uint32_t dense_index = info.dense_index;
+            const uint32_t last_index  = static_cast<uint32_t>(m_dense.size()) - 1;
+            if (dense_index != last_index)
+            {
+                m_dense[dense_index]                          = m_dense[last_index];
+                m_dense_slots[dense_index]                    = m_dense_slots[last_index];
+                m_slots[m_dense_slots[dense_index]].dense_index = dense_index;
+            }
+            m_dense.pop_back();
+            m_dense_slots.pop_back();
+
+            component->~T();
+
+            info.alive = false;
+            info.generation++; // invalidates outstanding handles
+            m_free_slots.emplace_back(slot);
+        }
+
+        // destroys every live component
+        void Clear()
+        {
+            std::vector<T*> components;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                components = m_dense;
+            }
+
+            for (T* component : components)
+            {
+                Destroy(component);
+            }
+        }
+
+        ComponentHandle<T> GetHandle(const T* component) const
+        {
+            ComponentHandle<T> handle;
+            if (component)
+            {
+                handle.slot       = component->GetPoolSlot();
+                handle.generation = m_slots[handle.slot].generation;
+            }
+            return handle;
+        }
+
+        T* Resolve(const ComponentHandle<T>& handle) const
+        {
+            if (handle.slot >= m_slots.size())
+                return nullptr;
+
+            const Slot& info = m_slots[handle.slot];
+            if (!info.alive || info.generation != handle.generation)
+                return nullptr;
+
+            return GetAddress(handle.slot);
+        }
+
+        // iterates every live component, whatever the state of its entity (World::ForEach skips inactive ones)
+        // the function must not create or destroy components of this type
+        template <class Function>
+        void ForEach(Function&& function)
+        {
+            for (T* component : m_dense)
+            {
+                function(component);
+            }
+        }
+
+        const std::vector<T*>& GetComponents() const { return m_dense; }
+        uint32_t GetCount() const                    { return static_cast<uint32_t>(m_dense.size()); }
+        uint64_t GetCapacity() const                 { return static_cast<uint64_t>(m_slots.size()); }
+
+    private:
+        // roughly 64 KB per chunk, but never fewer than 16 components
+        static constexpr uint32_t chunk_capacity = (sizeof(T) * 16 > 65536) ? 16 : static_cast<uint32_t>(65536 / sizeof(T));
+
+        struct Chunk
+        {
+            alignas(T) std::byte storage[sizeof(T) * chunk_capacity];
+        };
+
+        struct Slot
+        {
+            uint32_t generation  = 0;
+            uint32_t dense_index = 0;
+            bool alive           = false;
+        };
+
+        void AddChunk()
+        {
+            const uint32_t slot_start = static_cast<uint32_t>(m_slots.size());
+            m_chunks.emplace_back(std::make_unique<Chunk>());
+            m_slots.resize(slot_start + chunk_capacity);
+            for (uint32_t i = chunk_capacity; i > 0; i--)
+            {
+                m_free_slots.emplace_back(slot_start + i - 1); // lowest slot first, keeps iteration order close to memory order
+            }
+        }
+
+        T* GetAddress(const uint32_t slot) const
+        {
+            return reinterpret_cast<T*>(m_chunks[slot / chunk_capacity]->storage) + (slot % chunk_capacity);
+        }
+
+        std::vector<std::unique_ptr<Chunk>> m_chunks;
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_free_slots;
+        std::vector<T*> m_dense;
+        std::vector<uint32_t> m_dense_slots;
+        std::mutex m_mutex;
+    };
+}
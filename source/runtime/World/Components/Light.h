@@ -117,6 +117,7 @@ namespace spartan
 
         // frustum
         bool IsInViewFrustum(Renderable* renderable, const uint32_t array_index) const;
+        const math::Frustum& GetFrustum(const uint32_t array_index) const { return m_frustums[array_index]; }
 
         // index
         void SetIndex(const uint32_t index) { m_index = index; }
@@ -24,10 +24,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Physics.h"
 #include "Renderable.h"
 #include "Camera.h"
+#include "Terrain.h"
 #include "../Entity.h"
 #include "../../RHI/RHI_Vertex.h"
 #include "../../Physics/PhysicsWorld.h"
 #include "../../Geometry/GeometryProcessing.h"
+#include "../../Math/Noise.h"
 SP_WARNINGS_OFF
 #ifdef DEBUG
     #define _DEBUG 1
@@ -67,6 +69,115 @@ namespace spartan
         const float distance_activate_squared   = distance_activate * distance_activate;
 
         void* controller_manager = nullptr;
+
+        // friction of the terrain surfaces relative to the friction of the body, indexed by TerrainSurface
+        const float terrain_surface_friction[] = { 1.0f, 0.8f, 1.2f, 0.3f };
+        static_assert(size(terrain_surface_friction) == static_cast<size_t>(TerrainSurface::Max));
+
+        PxCookingParams get_cooking_params()
+        {
+            PxTolerancesScale _scale;
+            _scale.length                          = 1.0f;                         // 1 unit = 1 meter
+            Vector3 gravity                        = PhysicsWorld::GetGravity();
+            _scale.speed                           = sqrtf(gravity.x * gravity.x + gravity.y * gravity.y + gravity.z * gravity.z); // magnitude of gravity vector
+            PxCookingParams params(_scale);         
+            params.areaTestEpsilon                 = 0.06f * _scale.length * _scale.length;
+            params.planeTolerance                  = 0.0007f;
+            params.convexMeshCookingType           = PxConvexMeshCookingType::eQUICKHULL;
+            params.suppressTriangleMeshRemapTable  = false;
+            params.buildTriangleAdjacencies        = true;
+            params.buildGPUData                    = false;
+            params.meshPreprocessParams           |= PxMeshPreprocessingFlag::eWELD_VERTICES;
+            params.meshWeldTolerance               = 0.01f;
+            params.meshAreaMinLimit                = 0.0f;
+            params.meshEdgeLengthMaxLimit          = 500.0f;
+            params.gaussMapLimit                   = 32;
+            params.maxWeightRatioInTet             = FLT_MAX;
+
+            return params;
+        }
+
+        void simplify_for_collision(vector<uint32_t>& indices, vector<RHI_Vertex_PosTexNorTan>& vertices, const float volume, const string& name)
+        {
+            const float max_volume    = 100000.0f;
+            const float volume_factor = clamp(volume / max_volume, 0.0f, 1.0f); // aka simplification ratio
+            size_t min_index_count    = min<size_t>(indices.size(), 256);
+            size_t target_index_count = clamp<size_t>(static_cast<size_t>(indices.size() * volume_factor), min_index_count, 16'000);
+            geometry_processing::simplify(indices, vertices, target_index_count, false, false);
+            if (target_index_count > 16000)
+            {
+                SP_LOG_WARNING("Mesh '%s' was simplified to %d indices. It's still complex and may impact physics performance.", name.c_str(), target_index_count);
+            }
+        }
+
+        PxTriangleMeshDesc get_triangle_mesh_desc(const vector<PxVec3>& points, const vector<uint32_t>& indices)
+        {
+            PxTriangleMeshDesc mesh_desc;
+            mesh_desc.points.count     = static_cast<PxU32>(points.size());
+            mesh_desc.points.stride    = sizeof(PxVec3);
+            mesh_desc.points.data      = points.data();
+            mesh_desc.triangles.count  = static_cast<PxU32>(indices.size() / 3);
+            mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+            mesh_desc.triangles.data   = indices.data();
+
+            return mesh_desc;
+        }
+
+        // no cooking involved, the samples are copied as they are, so this is cheap enough to do whenever a tile streams in
+        PxHeightField* create_height_field(const TerrainTileHeights& heights, float& height_scale, float& height_offset)
+        {
+            // heights are stored as 16-bit integers around the middle of the tile's range
+            const auto [height_min, height_max] = minmax_element(heights.heights.begin(), heights.heights.end());
+            height_offset = (*height_min + *height_max) * 0.5f;
+            height_scale  = max((*height_max - *height_min) * 0.5f / 32767.0f, PX_MIN_HEIGHTFIELD_Y_SCALE);
+
+            // physx rows run along x and columns along z
+            vector<PxHeightFieldSample> samples(heights.count_x * heights.count_z);
+            for (uint32_t x = 0; x < heights.count_x; x++)
+            {
+                for (uint32_t z = 0; z < heights.count_z; z++)
+                {
+                    const uint32_t index   = z * heights.count_x + x;
+                    const float quantized  = round((heights.heights[index] - height_offset) / height_scale);
+                    const PxU8 material    = heights.surfaces.empty() ? 0 : static_cast<PxU8>(heights.surfaces[index]);
+
+                    // the tessellation flag stays clear, so cells split from (x + 1, z) to (x, z + 1) like the render surface
+                    PxHeightFieldSample& sample = samples[x * heights.count_z + z];
+                    sample.height               = static_cast<PxI16>(clamp(quantized, -32767.0f, 32767.0f));
+                    sample.materialIndex0       = PxBitAndByte(material, false);
+                    sample.materialIndex1       = PxBitAndByte(material, false);
+                }
+            }
+
+            PxHeightFieldDesc desc;
+            desc.format         = PxHeightFieldFormat::eS16_TM;
+            desc.nbRows         = heights.count_x;
+            desc.nbColumns      = heights.count_z;
+            desc.samples.data   = samples.data();
+            desc.samples.stride = sizeof(PxHeightFieldSample);
+
+            return PxCreateHeightField(desc, *PxGetStandaloneInsertionCallback());
+        }
+
+        // height of the surface that the samples describe, triangulated the same way as the render surface
+        float get_height(const TerrainTileHeights& heights, const float x, const float z)
+        {
+            const float u     = clamp((x - heights.origin.x) / heights.spacing_x, 0.0f, static_cast<float>(heights.count_x - 1));
+            const float v     = clamp((z - heights.origin.z) / heights.spacing_z, 0.0f, static_cast<float>(heights.count_z - 1));
+            const uint32_t i  = min(static_cast<uint32_t>(u), heights.count_x - 2);
+            const uint32_t j  = min(static_cast<uint32_t>(v), heights.count_z - 2);
+            const float fx    = u - static_cast<float>(i);
+            const float fz    = v - static_cast<float>(j);
+            const float h00   = heights.heights[j * heights.count_x + i];
+            const float h10   = heights.heights[j * heights.count_x + i + 1];
+            const float h01   = heights.heights[(j + 1) * heights.count_x + i];
+            const float h11   = heights.heights[(j + 1) * heights.count_x + i + 1];
+
+            if (fx + fz <= 1.0f)
+                return h00 + fx * (h10 - h00) + fz * (h01 - h00);
+
+            return h11 + (1.0f - fx) * (h01 - h11) + (1.0f - fz) * (h10 - h11);
+        }
     }
 
     Physics::Physics(Entity* entity) : Component(entity)
@@ -124,6 +235,12 @@ namespace spartan
             material->release();
             m_material = nullptr;
         }
+
+        if (PxHeightField* height_field = static_cast<PxHeightField*>(m_height_field))
+        {
+            height_field->release();
+            m_height_field = nullptr;
+        }
     }
 
     void Physics::Tick()
@@ -180,7 +297,7 @@ namespace spartan
                     {
                         // sync entity -> physX (kinematic target)
                         math::Matrix transform;
-                        if (renderable->HasInstancing() && i < renderable->GetInstanceCount())
+                        if (renderable && renderable->HasInstancing() && i < renderable->GetInstanceCount())
                         {
                             transform = renderable->GetInstance(i, true);
                         }
@@ -203,7 +320,7 @@ namespace spartan
                         // sync physx -> entity (simulated dynamic)
                         PxTransform pose = actor->getGlobalPose();
                         math::Matrix transform = math::Matrix::CreateTranslation(Vector3(pose.p.x, pose.p.y, pose.p.z)) * math::Matrix::CreateRotation(Quaternion(pose.q.x, pose.q.y, pose.q.z, pose.q.w));
-                        if (renderable->HasInstancing() && i < renderable->GetInstanceCount())
+                        if (renderable && renderable->HasInstancing() && i < renderable->GetInstanceCount())
                         {
                             //renderable->SetInstance(static_cast<uint32_t>(i), transform); // implement if needed
                         }
@@ -218,7 +335,7 @@ namespace spartan
                 {
                     // editor mode: sync entity -> physx, reset velocities only for non-kinematics
                     math::Matrix transform;
-                    if (renderable->HasInstancing() && i < renderable->GetInstanceCount())
+                    if (renderable && renderable->HasInstancing() && i < renderable->GetInstanceCount())
                     {
                         transform = renderable->GetInstance(i, true);
                     }
@@ -252,33 +369,35 @@ namespace spartan
             if (Camera* camera = World::GetCamera())
             {
                 const Vector3 camera_pos = camera->GetEntity()->GetPosition();
-                if (Renderable* renderable = GetEntity()->GetComponent<Renderable>())
+                Renderable* renderable   = GetEntity()->GetComponent<Renderable>();
+                for (uint32_t i = 0; i < static_cast<uint32_t>(m_actors.size()); i++)
                 {
-                    for (uint32_t i = 0; i < static_cast<uint32_t>(m_actors.size()); i++)
+                    if (PxRigidActor* actor = static_cast<PxRigidActor*>(m_actors[i]))
                     {
-                        if (PxRigidActor* actor = static_cast<PxRigidActor*>(m_actors[i]))
+                        Vector3 closest_point = Vector3::Zero;
+                        if (renderable && renderable->HasInstancing())
                         {
-                            Vector3 closest_point = Vector3::Zero;
-                            if (renderable->HasInstancing())
-                            {
-                                closest_point = renderable->GetInstance(i, true).GetTranslation();
-                            }
-                            else
-                            {
-                                closest_point = renderable->GetBoundingBox().GetClosestPoint(camera_pos);
-                            }
-
-                            const float distance_to_camera = Vector3::DistanceSquared(camera_pos, closest_point);
-                            if (distance_to_camera > distance_deactivate_squared)
-                            {
-                                PhysicsWorld::RemoveActor(actor);
-                            }
-                            else if (distance_to_camera <= distance_activate_squared)
-                            {
-                                PhysicsWorld::AddActor(actor);
-                            }
+                            closest_point = renderable->GetInstance(i, true).GetTranslation();
+                        }
+                        else if (renderable)
+                        {
+                            closest_point = renderable->GetBoundingBox().GetClosestPoint(camera_pos);
+                        }
+                        else // terrain tiles have no renderable, use the bounds of the actor instead
+                        {
+                            const PxBounds3 bounds = actor->getWorldBounds();
+                            closest_point          = BoundingBox(Vector3(bounds.minimum.x, bounds.minimum.y, bounds.minimum.z), Vector3(bounds.maximum.x, bounds.maximum.y, bounds.maximum.z)).GetClosestPoint(camera_pos);
                         }
 
+                        const float distance_to_camera = Vector3::DistanceSquared(camera_pos, closest_point);
+                        if (distance_to_camera > distance_deactivate_squared)
+                        {
+                            PhysicsWorld::RemoveActor(actor);
+                        }
+                        else if (distance_to_camera <= distance_activate_squared)
+                        {
+                            PhysicsWorld::AddActor(actor);
+                        }
                     }
                 }
             }
@@ -852,17 +971,25 @@ namespace spartan
             // mesh
             if (m_body_type == BodyType::Mesh)
             {
+                // get geometry, terrain tiles have no renderable since their surface is streamed, so it comes from the terrain
+                vector<uint32_t> indices;
+                vector<RHI_Vertex_PosTexNorTan> vertices;
                 Renderable* renderable = GetEntity()->GetComponent<Renderable>();
-                if (!renderable)
+                Entity* parent         = GetEntity()->GetParent();
+                if (renderable)
+                {
+                    renderable->GetGeometry(&indices, &vertices);
+                }
+                else if (Terrain* terrain = parent ? parent->GetComponent<Terrain>() : nullptr)
+                {
+                    terrain->GetTileGeometry(GetEntity(), &indices, &vertices);
+                }
+                else
                 {
                     SP_LOG_ERROR("No Renderable component found for mesh shape");
                     return;
                 }
 
-                // get geometry
-                vector<uint32_t> indices;
-                vector<RHI_Vertex_PosTexNorTan> vertices;
-                renderable->GetGeometry(&indices, &vertices);
                 if (vertices.empty() || indices.empty())
                 {
                     SP_LOG_ERROR("Empty vertex or index data for mesh shape");
@@ -870,16 +997,8 @@ namespace spartan
                 }
 
                 // simplify geometry
-                const float volume        = renderable->GetBoundingBox().GetVolume();
-                const float max_volume    = 100000.0f;
-                const float volume_factor = clamp(volume / max_volume, 0.0f, 1.0f); // aka simplification ratio
-                size_t min_index_count    = min<size_t>(indices.size(), 256);
-                size_t target_index_count = clamp<size_t>(static_cast<size_t>(indices.size() * volume_factor), min_index_count, 16'000);
-                geometry_processing::simplify(indices, vertices, target_index_count, false, false);
-                if (target_index_count > 16000)
-                {
-                    SP_LOG_WARNING("Mesh '%s' was simplified to %d indices. It's still complex and may impact physics performance.", renderable->GetEntity()->GetObjectName().c_str(), target_index_count);
-                }
+                const float volume = renderable ? renderable->GetBoundingBox().GetVolume() : BoundingBox(vertices.data(), static_cast<uint32_t>(vertices.size())).GetVolume();
+                simplify_for_collision(indices, vertices, volume, GetEntity()->GetObjectName());
 
                 // convert vertices to physx format
                 vector<PxVec3> px_vertices;
@@ -891,34 +1010,12 @@ namespace spartan
                 }
 
                 // cooking parameters
-                PxTolerancesScale _scale;
-                _scale.length                          = 1.0f;                         // 1 unit = 1 meter
-                Vector3 gravity                        = PhysicsWorld::GetGravity();
-                _scale.speed                           = sqrtf(gravity.x * gravity.x + gravity.y * gravity.y + gravity.z * gravity.z); // magnitude of gravity vector
-                PxCookingParams params(_scale);         
-                params.areaTestEpsilon                 = 0.06f * _scale.length * _scale.length;
-                params.planeTolerance                  = 0.0007f;
-                params.convexMeshCookingType           = PxConvexMeshCookingType::eQUICKHULL;
-                params.suppressTriangleMeshRemapTable  = false;
-                params.buildTriangleAdjacencies        = true;
-                params.buildGPUData                    = false;
-                params.meshPreprocessParams           |= PxMeshPreprocessingFlag::eWELD_VERTICES;
-                params.meshWeldTolerance               = 0.01f;
-                params.meshAreaMinLimit                = 0.0f;
-                params.meshEdgeLengthMaxLimit          = 500.0f;
-                params.gaussMapLimit                   = 32;
-                params.maxWeightRatioInTet             = FLT_MAX;
+                PxCookingParams params = get_cooking_params();
 
                 PxInsertionCallback* insertion_callback = PxGetStandaloneInsertionCallback();
                 if (IsStatic() || IsKinematic()) // triangle mesh for exact collision (static or kinematic)
                 {
-                    PxTriangleMeshDesc mesh_desc;
-                    mesh_desc.points.count     = static_cast<PxU32>(px_vertices.size());
-                    mesh_desc.points.stride    = sizeof(PxVec3);
-                    mesh_desc.points.data      = px_vertices.data();
-                    mesh_desc.triangles.count  = static_cast<PxU32>(indices.size() / 3);
-                    mesh_desc.triangles.stride = 3 * sizeof(PxU32);
-                    mesh_desc.triangles.data   = indices.data();
+                    PxTriangleMeshDesc mesh_desc = get_triangle_mesh_desc(px_vertices, indices);
 
                     // create
                     PxTriangleMeshCookingResult::Enum condition;
@@ -957,6 +1054,38 @@ namespace spartan
                     }
                 }
             }
+            // height field, sampled straight from the terrain the tile belongs to
+            else if (m_body_type == BodyType::HeightField)
+            {
+                Entity* parent   = GetEntity()->GetParent();
+                Terrain* terrain = parent ? parent->GetComponent<Terrain>() : nullptr;
+                TerrainTileHeights heights;
+                if (!terrain || !terrain->GetTileHeights(GetEntity(), heights))
+                {
+                    SP_LOG_ERROR("Height field bodies have to be tiles of a generated terrain");
+                    return;
+                }
+
+                if (!IsStatic() && !IsKinematic())
+                {
+                    SP_LOG_ERROR("Height field bodies have to be static or kinematic");
+                    return;
+                }
+
+                float height_scale  = 1.0f;
+                float height_offset = 0.0f;
+                m_height_field      = create_height_field(heights, height_scale, height_offset);
+                if (!m_height_field)
+                {
+                    SP_LOG_ERROR("Failed to create height field");
+                    return;
+                }
+
+                const Vector3 scale     = GetEntity()->GetScale();
+                m_height_field_scale    = Vector3(heights.spacing_x, height_scale, heights.spacing_z) * scale;
+                m_height_field_offset   = Vector3(heights.origin.x, height_offset, heights.origin.z) * scale;
+                m_height_field_surfaces = !heights.surfaces.empty();
+            }
 
             CreateBodies();
         }
@@ -966,18 +1095,14 @@ namespace spartan
     {
         PxPhysics* physics      = static_cast<PxPhysics*>(PhysicsWorld::GetPhysics());
         Renderable* renderable  = GetEntity()->GetComponent<Renderable>();
-        
-        if (!renderable)
-        {
-            SP_LOG_ERROR("No Renderable component found for physics body creation");
-            return;
-        }
+        const bool instancing   = renderable && renderable->HasInstancing();
+        const uint32_t count    = renderable ? renderable->GetInstanceCount() : 1; // without a renderable (e.g. terrain tiles) the entity is the only body
 
         // create bodies and shapes
-        m_actors.resize(renderable->GetInstanceCount(), nullptr);
-        for (uint32_t i = 0; i < renderable->GetInstanceCount(); i++)
+        m_actors.resize(count, nullptr);
+        for (uint32_t i = 0; i < count; i++)
         {
-            math::Matrix transform = renderable->HasInstancing() ? renderable->GetInstance(i, true) : GetEntity()->GetMatrix();
+            math::Matrix transform = instancing ? renderable->GetInstance(i, true) : GetEntity()->GetMatrix();
             PxTransform pose(
                 PxVec3(transform.GetTranslation().x, transform.GetTranslation().y, transform.GetTranslation().z),
                 PxQuat(transform.GetRotation().x, transform.GetRotation().y, transform.GetRotation().z, transform.GetRotation().w)
@@ -1054,7 +1179,7 @@ namespace spartan
                     {
                         if (IsStatic() || IsKinematic())
                         {
-                            Vector3 scale = renderable->HasInstancing() ? renderable->GetInstance(i, false).GetScale() : Vector3::One;
+                            Vector3 scale = instancing ? renderable->GetInstance(i, false).GetScale() : Vector3::One;
                             PxMeshScale mesh_scale(PxVec3(scale.x, scale.y, scale.z)); // this is a runtime transform, cheap for statics but it won't be reflected for the internal baked shape (raycasts etc)
                             PxTriangleMeshGeometry geometry(static_cast<PxTriangleMesh*>(m_mesh), mesh_scale);
                             shape = physics->createShape(geometry, *material);
@@ -1067,6 +1192,36 @@ namespace spartan
                     }
                     break;
                 }
+                case BodyType::HeightField:
+                {
+                    if (m_height_field)
+                    {
+                        PxHeightFieldGeometry geometry(static_cast<PxHeightField*>(m_height_field), PxMeshGeometryFlags(), m_height_field_scale.y, m_height_field_scale.x, m_height_field_scale.z);
+                        if (m_height_field_surfaces)
+                        {
+                            // a material per surface, indexed by the samples
+                            array<PxMaterial*, static_cast<size_t>(TerrainSurface::Max)> materials;
+                            for (size_t surface = 0; surface < materials.size(); surface++)
+                            {
+                                materials[surface] = physics->createMaterial(m_friction * terrain_surface_friction[surface], m_friction_rolling * terrain_surface_friction[surface], m_restitution);
+                            }
+
+                            shape = physics->createShape(geometry, materials.data(), static_cast<PxU16>(materials.size()));
+
+                            for (PxMaterial* surface_material : materials)
+                            {
+                                surface_material->release(); // the shape holds on to them
+                            }
+                        }
+                        else
+                        {
+                            shape = physics->createShape(geometry, *material);
+                        }
+
+                        shape->setLocalPose(PxTransform(PxVec3(m_height_field_offset.x, m_height_field_offset.y, m_height_field_offset.z)));
+                    }
+                    break;
+                }
             }
             
             if (shape)
@@ -1085,4 +1240,260 @@ namespace spartan
             m_actors[i] = actor;
         }
     }
+
+    void Physics::BenchmarkTerrainCollision(const uint32_t tile_count)
+    {
+        // tiles the size of those of the default terrain, cut out of one noise height field
+        const uint32_t samples_per_side = 193;
+        const float spacing             = 2.0f;
+        const uint32_t tiles_per_side   = max(1u, static_cast<uint32_t>(sqrt(static_cast<float>(tile_count))));
+        const uint32_t rays_per_tile    = 4096;
+        mt19937 generator(0); // fixed seed, so runs are comparable
+
+        NoiseParameters noise_parameters;
+        noise_parameters.seed      = 1;
+        noise_parameters.frequency = 0.005f;
+        noise_parameters.octaves   = 6;
+        const Noise noise(noise_parameters);
+
+        struct CollisionStats
+        {
+            float creation_ms = 0.0f;
+            double query_ms   = 0.0;
+            size_t bytes      = 0;
+            double error_sum  = 0.0;
+            float error_max   = 0.0f;
+            uint32_t misses   = 0;
+        };
+        CollisionStats stats_mesh;
+        CollisionStats stats_height_field;
+        uint32_t tiles_done = 0;
+        uint32_t ray_count  = 0;
+
+        PxCookingParams params = get_cooking_params();
+        for (uint32_t tile = 0; tile < tiles_per_side * tiles_per_side; tile++)
+        {
+            // heights relative to a tile centered on its origin, the way terrain tiles are
+            const uint32_t cells = samples_per_side - 1;
+            TerrainTileHeights heights;
+            heights.count_x   = samples_per_side;
+            heights.count_z   = samples_per_side;
+            heights.spacing_x = spacing;
+            heights.spacing_z = spacing;
+            heights.origin    = Vector3(-0.5f * spacing * cells, 0.0f, -0.5f * spacing * cells);
+            heights.heights.resize(samples_per_side * samples_per_side);
+            noise.SampleGrid(heights.heights.data(), samples_per_side, samples_per_side, static_cast<float>((tile % tiles_per_side) * cells), static_cast<float>((tile / tiles_per_side) * cells));
+            for (float& height : heights.heights)
+            {
+                height *= 200.0f;
+            }
+
+            // the same surface as a triangle list, with the triangulation of the terrain
+            vector<RHI_Vertex_PosTexNorTan> vertices(heights.heights.size());
+            vector<uint32_t> indices;
+            indices.reserve(cells * cells * 6);
+            for (uint32_t z = 0; z < samples_per_side; z++)
+            {
+                for (uint32_t x = 0; x < samples_per_side; x++)
+                {
+                    const Vector3 position(heights.origin.x + x * spacing, heights.heights[z * samples_per_side + x], heights.origin.z + z * spacing);
+                    vertices[z * samples_per_side + x] = RHI_Vertex_PosTexNorTan(position, Vector2::Zero);
+
+                    if (x < cells && z < cells)
+                    {
+                        const uint32_t bottom_left  = z * samples_per_side + x;
+                        const uint32_t bottom_right = bottom_left + 1;
+                        const uint32_t top_left     = bottom_left + samples_per_side;
+                        const uint32_t top_right    = top_left + 1;
+                        indices.insert(indices.end(), { bottom_right, bottom_left, top_left, bottom_right, top_left, top_right });
+                    }
+                }
+            }
+
+            // triangle mesh, the way mesh bodies are created
+            Stopwatch timer;
+            simplify_for_collision(indices, vertices, BoundingBox(vertices.data(), static_cast<uint32_t>(vertices.size())).GetVolume(), "benchmark_tile");
+            vector<PxVec3> points;
+            points.reserve(vertices.size());
+            for (const RHI_Vertex_PosTexNorTan& vertex : vertices)
+            {
+                points.emplace_back(vertex.pos[0], vertex.pos[1], vertex.pos[2]);
+            }
+            PxTriangleMeshDesc mesh_desc = get_triangle_mesh_desc(points, indices);
+            PxTriangleMesh* mesh         = PxCreateTriangleMesh(params, mesh_desc, *PxGetStandaloneInsertionCallback());
+            stats_mesh.creation_ms      += timer.GetElapsedTimeMs();
+
+            // the cooked size is what a mesh costs to keep around or stream
+            PxDefaultMemoryOutputStream stream;
+            if (PxCookTriangleMesh(params, mesh_desc, stream))
+            {
+                stats_mesh.bytes += stream.getSize();
+            }
+
+            // height field
+            timer.Start();
+            float height_scale          = 1.0f;
+            float height_offset         = 0.0f;
+            PxHeightField* height_field = create_height_field(heights, height_scale, height_offset);
+            stats_height_field.creation_ms += timer.GetElapsedTimeMs();
+            stats_height_field.bytes       += heights.count_x * heights.count_z * sizeof(PxHeightFieldSample);
+
+            if (!mesh || !height_field)
+            {
+                SP_LOG_ERROR("Failed to create collision for benchmark tile %u", tile);
+                if (mesh)         mesh->release();
+                if (height_field) height_field->release();
+                continue;
+            }
+
+            // vertical rays against both, compared to the surface the samples describe
+            vector<PxVec3> origins(rays_per_tile);
+            vector<float> references(rays_per_tile);
+            const float height_top   = *max_element(heights.heights.begin(), heights.heights.end()) + 1.0f;
+            const float max_distance = height_top - *min_element(heights.heights.begin(), heights.heights.end()) + 1.0f;
+            uniform_real_distribution<float> distribution_x(heights.origin.x, heights.origin.x + heights.spacing_x * (heights.count_x - 1));
+            uniform_real_distribution<float> distribution_z(heights.origin.z, heights.origin.z + heights.spacing_z * (heights.count_z - 1));
+            for (uint32_t i = 0; i < rays_per_tile; i++)
+            {
+                const float x = distribution_x(generator);
+                const float z = distribution_z(generator);
+                origins[i]    = PxVec3(x, height_top, z);
+                references[i] = get_height(heights, x, z);
+            }
+
+            // all the rays of a tile are timed together, so the timer doesn't weigh on them
+            auto cast = [&origins, &references, max_distance](const PxGeometry& geometry, const PxTransform& pose, CollisionStats& stats)
+            {
+                const PxVec3 direction(0.0f, -1.0f, 0.0f);
+                vector<PxGeomRaycastHit> hits(origins.size());
+                vector<uint8_t> hit(origins.size());
+
+                const Stopwatch timer;
+                for (size_t i = 0; i < origins.size(); i++)
+                {
+                    hit[i] = static_cast<uint8_t>(PxGeometryQuery::raycast(origins[i], direction, geometry, pose, max_distance, PxHitFlag::ePOSITION, 1, &hits[i]));
+                }
+                stats.query_ms += timer.GetElapsedTimeMs();
+
+                for (size_t i = 0; i < origins.size(); i++)
+                {
+                    if (!hit[i])
+                    {
+                        stats.misses++;
+                        continue;
+                    }
+
+                    const float error  = abs(hits[i].position.y - references[i]);
+                    stats.error_sum   += error;
+                    stats.error_max    = max(stats.error_max, error);
+                }
+            };
+            cast(PxTriangleMeshGeometry(mesh), PxTransform(PxIdentity), stats_mesh);
+            cast(PxHeightFieldGeometry(height_field, PxMeshGeometryFlags(), height_scale, heights.spacing_x, heights.spacing_z), PxTransform(PxVec3(heights.origin.x, height_offset, heights.origin.z)), stats_height_field);
+
+            mesh->release();
+            height_field->release();
+            tiles_done++;
+            ray_count += rays_per_tile;
+        }
+
+        auto log = [&](const char* name, const CollisionStats& stats)
+        {
+            const uint32_t hits = ray_count - stats.misses;
+            SP_LOG_INFO("%s: created in %.2f ms, %.2f MB, %.3f us per ray, error mean %.4f m, error max %.4f m, %u/%u rays missed",
+                name,
+                stats.creation_ms,
+                static_cast<float>(stats.bytes) / (1024.0f * 1024.0f),
+                ray_count ? stats.query_ms * 1000.0 / ray_count : 0.0,
+                hits ? static_cast<float>(stats.error_sum / hits) : 0.0f,
+                stats.error_max,
+                stats.misses,
+                ray_count
+            );
+        };
+
+        SP_LOG_INFO("Terrain collision benchmark, %u tiles of %ux%u samples", tiles_done, samples_per_side, samples_per_side);
+        log("Triangle mesh", stats_mesh);
+        log("Height field", stats_height_field);
+    }
+
+    bool Physics::TestHeightField()
+    {
+        // a tile with uneven spacing, an offset origin and hills steep enough to show a wrongly split cell
+        TerrainTileHeights heights;
+        heights.count_x   = 65;
+        heights.count_z   = 49;
+        heights.spacing_x = 0.5f;
+        heights.spacing_z = 0.75f;
+        heights.origin    = Vector3(-10.0f, 0.0f, 5.0f);
+        heights.heights.resize(heights.count_x * heights.count_z);
+        heights.surfaces.resize(heights.heights.size());
+        for (uint32_t z = 0; z < heights.count_z; z++)
+        {
+            for (uint32_t x = 0; x < heights.count_x; x++)
+            {
+                const uint32_t index    = z * heights.count_x + x;
+                heights.heights[index]  = 20.0f * sin(static_cast<float>(x) * 0.7f) * cos(static_cast<float>(z) * 0.5f) + 5.0f;
+                heights.surfaces[index] = static_cast<TerrainSurface>((x / 3 + z / 5) % static_cast<uint32_t>(TerrainSurface::Max));
+            }
+        }
+
+        float height_scale          = 1.0f;
+        float height_offset         = 0.0f;
+        PxHeightField* height_field = create_height_field(heights, height_scale, height_offset);
+        if (!height_field)
+        {
+            SP_LOG_ERROR("Failed to create a height field");
+            return false;
+        }
+
+        // vertical rays on a grid which doesn't line up with the samples, so every ray lands inside a cell
+        const PxHeightFieldGeometry geometry(height_field, PxMeshGeometryFlags(), height_scale, heights.spacing_x, heights.spacing_z);
+        const PxTransform pose(PxVec3(heights.origin.x, height_offset, heights.origin.z));
+        const PxVec3 direction(0.0f, -1.0f, 0.0f);
+        const uint32_t ray_count_per_side = 40;
+        const float tolerance             = height_scale + 1e-3f; // quantization to 16 bits
+        uint32_t misses                   = 0;
+        uint32_t wrong_heights            = 0;
+        uint32_t wrong_surfaces           = 0;
+        float error_max                   = 0.0f;
+        for (uint32_t j = 0; j < ray_count_per_side; j++)
+        {
+            for (uint32_t i = 0; i < ray_count_per_side; i++)
+            {
+                const float u = (static_cast<float>(i) + 0.37f) / static_cast<float>(ray_count_per_side) * static_cast<float>(heights.count_x - 1);
+                const float v = (static_cast<float>(j) + 0.61f) / static_cast<float>(ray_count_per_side) * static_cast<float>(heights.count_z - 1);
+                const float x = heights.origin.x + u * heights.spacing_x;
+                const float z = heights.origin.z + v * heights.spacing_z;
+
+                PxGeomRaycastHit hit;
+                if (PxGeometryQuery::raycast(PxVec3(x, 100.0f, z), direction, geometry, pose, 200.0f, PxHitFlag::ePOSITION | PxHitFlag::eFACE_INDEX, 1, &hit) == 0)
+                {
+                    misses++;
+                    continue;
+                }
+
+                const float error = abs(hit.position.y - get_height(heights, x, z));
+                error_max         = max(error_max, error);
+                if (error > tolerance)
+                {
+                    wrong_heights++;
+                }
+
+                // both triangles of a cell take the surface of its first sample
+                const uint32_t sample = static_cast<uint32_t>(v) * heights.count_x + static_cast<uint32_t>(u);
+                if (height_field->getTriangleMaterialIndex(hit.faceIndex) != static_cast<PxMaterialTableIndex>(heights.surfaces[sample]))
+                {
+                    wrong_surfaces++;
+                }
+            }
+        }
+        height_field->release();
+
+        const uint32_t ray_count = ray_count_per_side * ray_count_per_side;
+        SP_LOG_INFO("Height field: %u rays, %u missed, %u off by more than %.4f m (max %.4f m), %u on the wrong surface",
+            ray_count, misses, wrong_heights, tolerance, error_max, wrong_surfaces);
+
+        return misses == 0 && wrong_heights == 0 && wrong_surfaces == 0;
+    }
 }
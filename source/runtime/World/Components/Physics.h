@@ -31,6 +31,7 @@ namespace spartan
 {
     class Entity;
     class PhysicsWorld;
+    class Terrain;
     namespace math { class Quaternion; }
 
     enum class PhysicsForce
@@ -47,6 +48,7 @@ namespace spartan
         Capsule,
         Mesh,
         Controller,
+        HeightField,
         Max
     };
 
@@ -131,6 +133,12 @@ namespace spartan
         void Move(const math::Vector3& offset);
         void Crouch(const bool crouch);
 
+        // compares height field and triangle mesh collision on tiles of a noise terrain, creation time, size, ray cost and accuracy
+        static void BenchmarkTerrainCollision(const uint32_t tile_count = 16);
+
+        // rays against the height field of a synthetic tile, checks heights, triangulation and surfaces against the samples
+        static bool TestHeightField();
+
     private:
         void Create();
         void CreateBodies();
@@ -153,5 +161,11 @@ namespace spartan
         void* m_mesh                   = nullptr;
         std::vector<void*> m_actors    = { nullptr };
         std::vector<PhysicsBodyMeshData> m_mesh_data;
+
+        // height field
+        void* m_height_field                = nullptr;
+        math::Vector3 m_height_field_scale  = math::Vector3::One;  // row spacing, height per unit, column spacing
+        math::Vector3 m_height_field_offset = math::Vector3::Zero; // local offset of the first sample
+        bool m_height_field_surfaces        = false;
     };
 }
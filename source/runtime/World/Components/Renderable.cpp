@@ -27,9 +27,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI/RHI_Buffer.h"
 #include "../RHI/RHI_Device.h"
 #include "../RHI/RHI_AccelerationStructure.h"
+#include "../Geometry/MeshBvh.h"
 #include "../../Resource/ResourceCache.h"
 #include "../../Rendering/Renderer.h"
 #include "../../Rendering/Material.h"
+#include "../../Rendering/GeometryPool.h"
 SP_WARNINGS_OFF
 #include "../IO/pugixml.hpp"
 SP_WARNINGS_ON
@@ -53,7 +55,7 @@ namespace spartan
         SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_sub_mesh_index, uint32_t);
         SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_bounding_box_dirty, bool);
         SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_instances, vector<Instance>);
-        SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_instance_buffer, shared_ptr<RHI_Buffer>);
+        SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_instance_allocation, shared_ptr<GeometryAllocation>);
         SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_transform_previous, Matrix);
         SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_max_distance_render, float);
         SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_max_distance_shadow, float);
@@ -180,6 +182,7 @@ namespace spartan
         {
             m_mesh             = mesh;
             m_sub_mesh_index   = sub_mesh_index;
+            m_vertex_override  = nullptr; // sized for the previous mesh, an animator will provide new vertices
             const MeshLod& lod = mesh->GetSubMesh(sub_mesh_index).lods[0];
             SP_ASSERT(lod.index_count  != 0);
             SP_ASSERT(lod.vertex_count != 0);
@@ -195,6 +198,12 @@ namespace spartan
         Tick(); // update bounding boxes, frustum and distance culling
     }
 
+    void Renderable::SetBoundingBoxMesh(const BoundingBox& bounding_box)
+    {
+        m_bounding_box_mesh  = bounding_box;
+        m_bounding_box_dirty = true;
+    }
+
     void Renderable::SetMesh(const MeshType type)
     {
         SetMesh(Renderer::GetStandardMesh(type).get());
@@ -269,7 +278,7 @@ namespace spartan
 
     uint32_t Renderable::GetIndexOffset(const uint32_t lod) const
     {
-        return m_mesh->GetSubMesh(m_sub_mesh_index).lods[lod].index_offset;
+        return m_mesh->GetIndexBufferOffset() + m_mesh->GetSubMesh(m_sub_mesh_index).lods[lod].index_offset;
     }
 
     uint32_t Renderable::GetIndexCount(const uint32_t lod) const
@@ -279,7 +288,10 @@ namespace spartan
 
     uint32_t Renderable::GetVertexOffset(const uint32_t lod) const
     {
-        return m_mesh->GetSubMesh(m_sub_mesh_index).lods[lod].vertex_offset;
+        if (m_vertex_override)
+            return m_vertex_override->offset;
+
+        return m_mesh->GetVertexBufferOffset() + m_mesh->GetSubMesh(m_sub_mesh_index).lods[lod].vertex_offset;
     }
 
     uint32_t Renderable::GetVertexCount(const uint32_t lod) const
@@ -300,7 +312,7 @@ namespace spartan
         if (!m_mesh)
             return nullptr;
 
-        return m_mesh->GetVertexBuffer();
+        return m_vertex_override ? m_vertex_override->buffer : m_mesh->GetVertexBuffer();
     }
 
     const string& Renderable::GetMeshName() const
@@ -317,7 +329,70 @@ namespace spartan
         if (!m_mesh)
             return;
 
-        m_mesh->BuildAccelerationStructure(cmd_list);
+        if (!m_vertex_override)
+        {
+            m_mesh->BuildAccelerationStructure(cmd_list);
+            return;
+        }
+
+        // the blas of the mesh doesn't describe vertices that are provided by someone else, static ones get their own,
+        // vertices that change every frame (skinning) get one that allows updates and is refit whenever they are re-uploaded
+        if (m_vertex_override_blas && !m_vertex_override_dirty)
+            return;
+
+        SP_ASSERT(RHI_Device::IsSupportedRayTracing());
+
+        const MeshLod& lod        = m_mesh->GetSubMesh(m_sub_mesh_index).lods[0];
+        RHI_Buffer* vertex_buffer = m_vertex_override->buffer;
+        RHI_Buffer* index_buffer  = m_mesh->GetIndexBuffer();
+
+        // the address is resolved every time, defragmentation can move the allocation between refits
+        RHI_AccelerationStructureGeometry geometry;
+        geometry.transparent           = false;
+        geometry.vertex_format         = RHI_Format::R32G32B32_Float; // positions
+        geometry.vertex_buffer_address = RHI_Device::GetBufferDeviceAddress(vertex_buffer->GetRhiResource()) + static_cast<uint64_t>(m_vertex_override->offset) * vertex_buffer->GetStride();
+        geometry.vertex_stride         = vertex_buffer->GetStride();
+        geometry.max_vertex            = m_vertex_override->count - 1;
+        geometry.index_format          = index_buffer->GetStride() == sizeof(uint16_t) ? RHI_Format::R16_Uint : RHI_Format::R32_Uint;
+        geometry.index_buffer_address  = RHI_Device::GetBufferDeviceAddress(index_buffer->GetRhiResource()) + static_cast<uint64_t>(GetIndexOffset()) * index_buffer->GetStride();
+
+        // the blas copies the geometry, so it outlives the allocation being moved or freed
+        vector<RHI_AccelerationStructureGeometry> geometries = { geometry };
+        vector<uint32_t> primitive_counts                    = { lod.index_count / 3 };
+        if (m_vertex_override_blas)
+        {
+            m_vertex_override_blas->UpdateBottomLevel(cmd_list, geometries, primitive_counts);
+        }
+        else
+        {
+            m_vertex_override_blas = make_unique<RHI_AccelerationStructure>(RHI_AccelerationStructureType::Bottom, (GetEntity()->GetObjectName() + "_blas").c_str());
+            m_vertex_override_blas->BuildBottomLevel(cmd_list, geometries, primitive_counts, !m_vertex_override_static);
+        }
+        m_vertex_override_dirty = false;
+    }
+
+    void Renderable::SetVertexOverride(const GeometryAllocation* allocation, shared_ptr<const vector<RHI_Vertex_PosTexNorTan>> vertices_static)
+    {
+        SP_ASSERT(!vertices_static || (allocation && vertices_static->size() == allocation->count));
+
+        m_vertex_override        = allocation;
+        m_vertex_override_static = move(vertices_static);
+        m_vertex_override_bvh    = nullptr;
+        m_vertex_override_blas   = nullptr;
+        m_vertex_override_dirty  = false;
+    }
+
+    RHI_Buffer* Renderable::GetInstanceBuffer() const
+    {
+        // non-instanced renderables point to the pool's identity instance, so that the binding doesn't change between draws
+        const GeometryAllocation* allocation = m_instance_allocation ? m_instance_allocation.get() : GeometryPool::GetIdentityInstance();
+        return allocation ? allocation->buffer : nullptr;
+    }
+
+    uint32_t Renderable::GetInstanceOffset() const
+    {
+        const GeometryAllocation* allocation = m_instance_allocation ? m_instance_allocation.get() : GeometryPool::GetIdentityInstance();
+        return allocation ? allocation->offset : 0;
     }
 
     bool Renderable::HasAccelerationStructure() const
@@ -325,15 +400,15 @@ namespace spartan
         if (!m_mesh)
             return false;
 
-        return m_mesh->GetBlas() != nullptr;
+        return m_vertex_override ? m_vertex_override_blas != nullptr : m_mesh->GetBlas() != nullptr;
     }
 
     uint64_t Renderable::GetAccelerationStructureDeviceAddress() const
     {
-        if (!m_mesh)
+        if (!HasAccelerationStructure())
             return 0;
 
-        return m_mesh->GetBlas()->GetDeviceAddress();
+        return m_vertex_override ? m_vertex_override_blas->GetDeviceAddress() : m_mesh->GetBlas()->GetDeviceAddress();
     }
 
     Matrix Renderable::GetInstance(const uint32_t index, const bool to_world)
@@ -346,20 +421,16 @@ namespace spartan
         if (instances.empty())
         {
             m_instances.clear();
-            m_instance_buffer    = nullptr;
+            m_instance_allocation = nullptr;
             m_bounding_box_dirty = true;
             return;
         }
 
         // store instance data
         m_instances = instances;
-        m_instance_buffer = make_shared<RHI_Buffer>(
-            RHI_Buffer_Type::Instance,
-            sizeof(Instance),
-            static_cast<uint32_t>(instances.size()),
-            static_cast<const void*>(instances.data()),
-            false,
-            ("instance_buffer_" + GetObjectName()).c_str()
+        m_instance_allocation = shared_ptr<GeometryAllocation>(
+            GeometryPool::Allocate(GeometryPoolType::Instance, static_cast<uint32_t>(instances.size()), instances.data()),
+            [](GeometryAllocation* allocation) { GeometryPool::Free(allocation); }
         );
 
         m_bounding_box_dirty = true;
@@ -388,6 +459,69 @@ namespace spartan
         SetInstances(instances);
     }
 
+    const vector<MeshCluster>& Renderable::GetClusters() const
+    {
+        static const vector<MeshCluster> empty;
+        // clusters are bounded in bind pose, so they don't hold for deformed vertices
+        return (m_mesh && !m_vertex_override) ? m_mesh->GetSubMesh(m_sub_mesh_index).clusters : empty;
+    }
+
+    bool Renderable::Raycast(const Ray& ray, float& distance)
+    {
+        const float distance_box = ray.HitDistance(GetBoundingBox());
+        if (!m_mesh || distance_box == numeric_limits<float>::infinity())
+            return false;
+
+        // vertices which only live on the gpu (skinning) can't be tested, so the bounding box is as close as it gets
+        if (m_vertex_override && !m_vertex_override_static)
+        {
+            distance = distance_box;
+            return true;
+        }
+
+        // static vertices are tested against their own bvh, built on the first query (rays only come from the main thread)
+        if (m_vertex_override)
+        {
+            const MeshLod& lod      = m_mesh->GetSubMesh(m_sub_mesh_index).lods[0];
+            const uint32_t* indices = &m_mesh->GetIndices()[lod.index_offset];
+            if (!m_vertex_override_bvh)
+            {
+                m_vertex_override_bvh = make_unique<MeshBvh>();
+                m_vertex_override_bvh->Build(m_vertex_override_static->data(), indices, lod.index_count);
+            }
+
+            // same as below, the ray goes to object space with an unnormalized direction so that the distance stays in world units
+            const Matrix transform_inverse = GetEntity()->GetMatrix().Inverted();
+            Ray ray_object;
+            ray_object.m_origin    = ray.GetStart() * transform_inverse;
+            ray_object.m_direction = (ray.GetStart() + ray.GetDirection()) * transform_inverse - ray_object.m_origin;
+
+            return m_vertex_override_bvh->Intersect(ray_object, m_vertex_override_static->data(), indices, distance);
+        }
+
+        float distance_closest = numeric_limits<float>::infinity();
+        for (uint32_t i = 0; i < GetInstanceCount(); i++)
+        {
+            // bring the ray to object space, the direction isn't normalized so hit distances stay in world units
+            const Matrix transform_inverse = (HasInstancing() ? GetInstance(i, true) : GetEntity()->GetMatrix()).Inverted();
+            Ray ray_object;
+            ray_object.m_origin    = ray.GetStart() * transform_inverse;
+            ray_object.m_direction = (ray.GetStart() + ray.GetDirection()) * transform_inverse - ray_object.m_origin;
+
+            float hit = 0.0f;
+            if (m_mesh->Raycast(m_sub_mesh_index, ray_object, hit) && hit < distance_closest)
+            {
+                distance_closest = hit;
+            }
+        }
+
+        if (distance_closest == numeric_limits<float>::infinity())
+            return false;
+
+        distance = distance_closest;
+        return true;
+    }
+
     uint32_t Renderable::GetLodCount() const
     {
         if (!m_mesh)
@@ -34,7 +34,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 namespace spartan
 {
     class Material;
+    class MeshBvh;
     class RHI_CommandList;
+    class RHI_AccelerationStructure;
+    struct GeometryAllocation;
 
     enum RenderableFlags : uint32_t
     {
@@ -55,6 +58,8 @@ namespace spartan
         // mesh
         void SetMesh(Mesh* mesh, const uint32_t sub_mesh_index = 0);
         void SetMesh(const MeshType type);
+        Mesh* GetMesh() const            { return m_mesh; }
+        uint32_t GetSubMeshIndex() const { return m_sub_mesh_index; }
         void GetGeometry(std::vector<uint32_t>* indices, std::vector<RHI_Vertex_PosTexNorTan>* vertices) const;
         uint32_t GetLodCount() const;
         uint32_t GetLodIndex() const { return m_lod_index; }
@@ -62,6 +67,8 @@ namespace spartan
         uint32_t GetIndexCount(const uint32_t lod = 0) const;
         uint32_t GetVertexOffset(const uint32_t lod = 0) const;
         uint32_t GetVertexCount(const uint32_t lod = 0) const;
+        const std::vector<MeshCluster>& GetClusters() const; // clusters of lod 0, empty if the mesh has none
+        bool Raycast(const math::Ray& ray, float& distance);   // world space ray against lod 0 (and every instance), returns the closest hit
         RHI_Buffer* GetIndexBuffer() const;
         RHI_Buffer* GetVertexBuffer() const;
         const std::string& GetMeshName() const;
@@ -69,8 +76,18 @@ namespace spartan
         bool HasAccelerationStructure() const;
         uint64_t GetAccelerationStructureDeviceAddress() const;
 
+        // vertices that are drawn instead of lod 0 of the mesh (e.g. skinned by an animator), the index buffer stays the mesh's,
+        // static vertices (e.g. terrain chunks) also share a cpu copy, which gets them a blas and triangle accurate raycasts
+        void SetVertexOverride(const GeometryAllocation* allocation, std::shared_ptr<const std::vector<RHI_Vertex_PosTexNorTan>> vertices_static = nullptr);
+        bool HasVertexOverride() const { return m_vertex_override != nullptr; }
+
+        // dynamic vertices flag every re-upload, so that their blas is refit before the tlas is built
+        void SetVertexOverrideDirty()             { m_vertex_override_dirty = true; }
+        bool IsAccelerationStructureStale() const { return m_vertex_override_blas && m_vertex_override_dirty; }
+
         // bounding box
         const math::BoundingBox& GetBoundingBox() const { return m_bounding_box;}
+        void SetBoundingBoxMesh(const math::BoundingBox& bounding_box);
 
         // material
         void SetMaterial(const std::shared_ptr<Material>& material);
@@ -81,7 +98,8 @@ namespace spartan
 
         // instancing
         bool HasInstancing() const            { return !m_instances.empty(); }
-        RHI_Buffer* GetInstanceBuffer() const { return m_instance_buffer.get(); }
+        RHI_Buffer* GetInstanceBuffer() const; // shared with other renderables
+        uint32_t GetInstanceOffset() const;    // where this renderable's instances start within the instance buffer
         uint32_t GetInstanceCount()  const    { return m_instances.empty() ? 1 : static_cast<uint32_t>(m_instances.size()); }
         math::Matrix GetInstance(const uint32_t index, const bool to_world);
         void SetInstances(const std::vector<Instance>& instances);
@@ -120,13 +138,20 @@ namespace spartan
         math::BoundingBox m_bounding_box_mesh = math::BoundingBox::Unit;
         math::BoundingBox m_bounding_box      = math::BoundingBox::Unit;
 
+        // vertex override, the allocation is owned by whoever set it
+        const GeometryAllocation* m_vertex_override = nullptr;
+        std::shared_ptr<const std::vector<RHI_Vertex_PosTexNorTan>> m_vertex_override_static;
+        std::unique_ptr<MeshBvh> m_vertex_override_bvh;
+        std::unique_ptr<RHI_AccelerationStructure> m_vertex_override_blas;
+        bool m_vertex_override_dirty = false;
+
         // material
         bool m_material_default = false;
         Material* m_material    = nullptr;
 
         // instancing
         std::vector<Instance> m_instances;
-        std::shared_ptr<RHI_Buffer> m_instance_buffer;
+        std::shared_ptr<GeometryAllocation> m_instance_allocation; // shared between clones
 
         // misc
         math::Matrix m_transform_previous = math::Matrix::Identity;
@@ -23,14 +23,17 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "pch.h"
 #include "Terrain.h"
 #include "Renderable.h"
+#include "Camera.h"
 #include "../Entity.h"
 #include "../World.h"
+#include "../TerrainQuadtree.h"
 #include "../../RHI/RHI_Texture.h"
-#include "../../Resource/ResourceCache.h"
 #include "../../Geometry/Mesh.h"
 #include "../../Rendering/Material.h"
+#include "../../Rendering/GeometryPool.h"
 #include "../../Geometry/GeometryProcessing.h"
 #include "../../Core/ThreadPool.h"
+#include "../../Math/Noise.h"
 #include "../../Core/ProgressTracker.h"
 //============================================
 
@@ -51,6 +54,33 @@ namespace spartan
         const bool create_border = true;   // adds a natural border to block player exit
     }
 
+    namespace
+    {
+        // counter based random numbers, the same seed, stream and counter always give the same value, no matter
+        // which thread asks for it or in which order, which keeps parallel generation deterministic
+        uint64_t random_counter_bits(const uint32_t seed, const uint32_t stream, const uint32_t counter)
+        {
+            // splitmix64 finalizer
+            uint64_t x = ((static_cast<uint64_t>(seed) << 32) | stream) + (static_cast<uint64_t>(counter) + 1) * 0x9e3779b97f4a7c15ull;
+            x          = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x          = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+
+        float random_counter(const uint32_t seed, const uint32_t stream, const uint32_t counter, const float min, const float max)
+        {
+            // top 24 bits map exactly to a float in [0, 1)
+            const float unit = static_cast<float>(random_counter_bits(seed, stream, counter) >> 40) * (1.0f / 16777216.0f);
+            return min + (max - min) * unit;
+        }
+
+        // an index in [0, count)
+        uint32_t random_counter_index(const uint32_t seed, const uint32_t stream, const uint32_t counter, const uint32_t count)
+        {
+            return static_cast<uint32_t>(((random_counter_bits(seed, stream, counter) >> 32) * count) >> 32);
+        }
+    }
+
     namespace placement
     {
         struct TriangleData
@@ -116,11 +146,16 @@ namespace spartan
             ThreadPool::ParallelLoop(compute_triangle, triangle_count);
         }
 
+        // randomness comes from counter based streams keyed by the seed, one per cluster and instance,
+        // so the transforms only depend on the seed and never on how the parallel loops are split,
+        // worker_count only exists so that the test can show that
         void find_transforms(
             TerrainPropDescription prop_desc,
             const float density_fraction,
             uint32_t tile_index,
-            vector<Matrix>& transforms_out
+            const uint32_t seed,
+            vector<Matrix>& transforms_out,
+            const uint32_t worker_count = 0
         )
         {
             auto it = triangle_data.find(tile_index);
@@ -173,22 +208,20 @@ namespace spartan
                 &clusters,
                 &tile_triangle_data,
                 &acceptable_triangles,
-                &prop_desc
+                &prop_desc,
+                seed
             ]
             (uint32_t start_index, uint32_t end_index)
             {
-                mt19937 generator(random_device{}());
                 const uint32_t tri_count = static_cast<uint32_t>(acceptable_triangles.size());
-                uniform_int_distribution<> triangle_dist(0, tri_count - 1);
-                uniform_real_distribution<float> dist(0.0f, 1.0f);
                 for (uint32_t i = start_index; i < end_index; i++)
                 {
-                    uint32_t tri_idx  = acceptable_triangles[triangle_dist(generator)];
+                    uint32_t tri_idx  = acceptable_triangles[random_counter_index(seed, i, 0, tri_count)];
                     TriangleData& tri = tile_triangle_data[tri_idx];
 
                     // position (xz used as cluster center)
-                    float r1         = dist(generator);
-                    float r2         = dist(generator);
+                    float r1         = random_counter(seed, i, 1, 0.0f, 1.0f);
+                    float r2         = random_counter(seed, i, 2, 0.0f, 1.0f);
                     float sqrt_r1    = sqrtf(r1);
                     float u          = 1.0f - sqrt_r1;
                     float v          = r2 * sqrt_r1;
@@ -196,7 +229,7 @@ namespace spartan
                     clusters[i]      = { position, tri_idx };
                 }
             };
-            ThreadPool::ParallelLoop(place_cluster, cluster_count);
+            ThreadPool::ParallelLoop(place_cluster, cluster_count, worker_count);
 
             // compute nearby acceptable triangles per cluster (for snapping to surface)
             vector<vector<uint32_t>> cluster_nearby_tris(cluster_count);
@@ -209,9 +242,7 @@ namespace spartan
             ]
             (uint32_t start_index, uint32_t end_index)
             {
-                mt19937 generator(random_device{}());
                 const uint32_t tri_count = static_cast<uint32_t>(acceptable_triangles.size());
-                uniform_int_distribution<> triangle_dist(0, tri_count - 1);
                 for (uint32_t c = start_index; c < end_index; c++)
                 {
                     auto& nearby = cluster_nearby_tris[c];
@@ -264,7 +295,7 @@ namespace spartan
                     }
                 }
             };
-            ThreadPool::ParallelLoop(compute_nearby, cluster_count);
+            ThreadPool::ParallelLoop(compute_nearby, cluster_count, worker_count);
 
             // step 4: parallel placement without mutex by direct assignment
             auto place_mesh = [
@@ -273,14 +304,12 @@ namespace spartan
                 &prop_desc,
                 &cluster_nearby_tris,
                 base_instances_per_cluster,
-                remainder_instances
+                remainder_instances,
+                seed
             ]
             (uint32_t start_index, uint32_t end_index)
             {
-                mt19937 generator(random_device{}());
-                uniform_real_distribution<float> dist(0.0f, 1.0f);
-                uniform_real_distribution<float> angle_dist(0.0f, 360.0f);
-                uniform_real_distribution<float> scale_dist(prop_desc.min_scale, prop_desc.max_scale);
+                // counters 0 to 2 of a stream are used by the clusters
                 uint32_t larger_cluster_size = base_instances_per_cluster + 1;
                 for (uint32_t i = start_index; i < end_index; i++)
                 {
@@ -298,15 +327,14 @@ namespace spartan
                     if (nearby.empty())
                         continue;
 
-                    uniform_int_distribution<int> nearby_dist(0, static_cast<int>(nearby.size()) - 1);
-                    uint32_t tri_idx  = nearby[nearby_dist(generator)];
+                    uint32_t tri_idx  = nearby[random_counter_index(seed, i, 3, static_cast<uint32_t>(nearby.size()))];
                     TriangleData& tri = tile_triangle_data[tri_idx];
 
                     // position
                     Vector3 position = Vector3::Zero;
                     {
-                        float r1      = dist(generator);
-                        float r2      = dist(generator);
+                        float r1      = random_counter(seed, i, 4, 0.0f, 1.0f);
+                        float r2      = random_counter(seed, i, 5, 0.0f, 1.0f);
                         float sqrt_r1 = sqrtf(r1);
                         float u       = 1.0f - sqrt_r1;
                         float v       = r2 * sqrt_r1;
@@ -316,19 +344,20 @@ namespace spartan
                     // rotation
                     Quaternion rotation;
                     {
+                        const float angle = random_counter(seed, i, 6, 0.0f, 360.0f);
                         if (prop_desc.align_to_surface_normal)
                         {
-                            Quaternion random_y_rotation = Quaternion::FromEulerAngles(0.0f, angle_dist(generator), 0.0f);
+                            Quaternion random_y_rotation = Quaternion::FromEulerAngles(0.0f, angle, 0.0f);
                             rotation                     = tri.rotation_to_normal * random_y_rotation;
                         }
                         else
                         {
-                            rotation = Quaternion::FromEulerAngles(0.0f, angle_dist(generator), 0.0f);
+                            rotation = Quaternion::FromEulerAngles(0.0f, angle, 0.0f);
                         }
                     }
 
                     // scale
-                    float scale = scale_dist(generator);
+                    float scale = random_counter(seed, i, 7, prop_desc.min_scale, prop_desc.max_scale);
                     if (prop_desc.scale_adjust_by_slope)
                     {
                         float slope_normalized = tri.slope_radians / prop_desc.max_slope_angle_rad;
@@ -339,7 +368,172 @@ namespace spartan
                     transforms_out[i] = Matrix::CreateScale(scale) * Matrix::CreateRotation(rotation) * Matrix::CreateTranslation(position);
                 }
             };
-            ThreadPool::ParallelLoop(place_mesh, adjusted_count);
+            ThreadPool::ParallelLoop(place_mesh, adjusted_count, worker_count);
+        }
+    }
+
+    // generation is split into stages, each stage is cached under a key that covers its inputs and the key
+    // of the stage before it, so changing a parameter only regenerates the stages downstream of it
+    namespace cache
+    {
+        const char* directory  = "terrain_cache";
+        const uint32_t magic   = 0x43545053; // "SPTC"
+        const uint32_t version = 4;          // bump when the output of a stage or the file layout changes
+
+        enum class Stage : uint32_t
+        {
+            Height,    // height map samples, densified
+            Positions, // positions, with noise and erosion applied
+            Surface,   // vertices (with normals and tangents) and indices
+            Placement, // per tile triangle data for prop placement
+            Props,     // prop transforms, one entry per tile, prop type and parameters
+            Max
+        };
+
+        const char* stage_names[] = { "height", "positions", "surface", "placement", "props" };
+        static_assert(size(stage_names) == static_cast<size_t>(Stage::Max));
+
+        // what the stages are generated from, apart from the parameters namespace which is hashed in as well
+        struct Inputs
+        {
+            const vector<byte>* height_map = nullptr; // mip 0 of the seed height map
+            uint32_t width                 = 0;
+            uint32_t height                = 0;
+            uint32_t channel_count         = 0;
+            uint32_t bits_per_channel      = 0;
+            float min_y                    = 0.0f;
+            float max_y                    = 0.0f;
+            uint32_t seed                  = 0;
+            uint32_t tile_count            = 0;
+        };
+
+        // keys of every stage but the props, each key covers the inputs of its stage and the key of the stage before it
+        array<uint64_t, static_cast<size_t>(Stage::Props)> compute_keys(const Inputs& inputs)
+        {
+            uint64_t key_height = hash_bytes(inputs.height_map->data(), inputs.height_map->size());
+            key_height          = hash_combine(key_height, (static_cast<uint64_t>(inputs.width) << 32) | inputs.height);
+            key_height          = hash_combine(key_height, (static_cast<uint64_t>(inputs.channel_count) << 32) | inputs.bits_per_channel);
+            key_height          = hash_combine(key_height, hash_bytes(&inputs.min_y, sizeof(inputs.min_y)));
+            key_height          = hash_combine(key_height, hash_bytes(&inputs.max_y, sizeof(inputs.max_y)));
+            key_height          = hash_combine(key_height, parameters::density);
+            key_height          = hash_combine(key_height, parameters::smoothing);
+            key_height          = hash_combine(key_height, parameters::create_border);
+
+            const uint64_t key_positions = hash_combine(hash_combine(key_height, parameters::scale), inputs.seed);
+            const uint64_t key_surface   = hash_combine(key_positions, static_cast<uint64_t>(Stage::Surface));
+            const uint64_t key_placement = hash_combine(hash_combine(key_surface, inputs.tile_count), static_cast<uint64_t>(Stage::Placement));
+
+            return { key_height, key_positions, key_surface, key_placement };
+        }
+
+        // the transforms of a prop type within a tile
+        uint64_t compute_props_key(const uint64_t key_placement, const uint32_t prop_seed, const float density_fraction, const float scale)
+        {
+            uint64_t key = hash_combine(key_placement, prop_seed);
+            key          = hash_combine(key, hash_bytes(&density_fraction, sizeof(density_fraction)));
+            key          = hash_combine(key, hash_bytes(&scale, sizeof(scale)));
+            return key;
+        }
+
+        string get_file_path(const Stage stage, const uint64_t key)
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "%s_%016llx.bin", stage_names[static_cast<uint32_t>(stage)], static_cast<unsigned long long>(key));
+            return string(directory) + "/" + name;
+        }
+
+        template<typename T>
+        void write_vector(ofstream& file, const vector<T>& data)
+        {
+            static_assert(is_trivially_copyable_v<T>);
+            uint64_t count = data.size();
+            file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            file.write(reinterpret_cast<const char*>(data.data()), count * sizeof(T));
+        }
+
+        // fails if the element count doesn't fit in what's left of the file
+        template<typename T>
+        bool read_vector(ifstream& file, vector<T>& data, const uint64_t file_size)
+        {
+            static_assert(is_trivially_copyable_v<T>);
+            uint64_t count = 0;
+            file.read(reinterpret_cast<char*>(&count), sizeof(count));
+            const uint64_t position = static_cast<uint64_t>(file.tellg());
+            if (!file || count > (file_size - position) / sizeof(T))
+                return false;
+
+            data.resize(count);
+            file.read(reinterpret_cast<char*>(data.data()), count * sizeof(T));
+            return static_cast<bool>(file);
+        }
+
+        // returns false on a miss, or if the entry is stale or malformed, in which case the stage has to run
+        bool load(const Stage stage, const uint64_t key, const function<bool(ifstream&, uint64_t)>& read)
+        {
+            const string file_path = get_file_path(stage, key);
+            ifstream file(file_path, ios::binary | ios::ate);
+            if (!file.is_open())
+                return false;
+
+            const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+            file.seekg(0);
+
+            uint32_t file_magic   = 0;
+            uint32_t file_version = 0;
+            uint32_t file_stage   = 0;
+            uint64_t file_key     = 0;
+            file.read(reinterpret_cast<char*>(&file_magic), sizeof(file_magic));
+            file.read(reinterpret_cast<char*>(&file_version), sizeof(file_version));
+            file.read(reinterpret_cast<char*>(&file_stage), sizeof(file_stage));
+            file.read(reinterpret_cast<char*>(&file_key), sizeof(file_key));
+
+            bool valid = file && file_magic == magic && file_version == version && file_stage == static_cast<uint32_t>(stage) && file_key == key;
+            valid      = valid && read(file, file_size) && static_cast<uint64_t>(file.tellg()) == file_size;
+            if (!valid)
+            {
+                SP_LOG_WARNING("ignoring stale or malformed terrain cache entry %s", file_path.c_str());
+            }
+
+            return valid;
+        }
+
+        // writes to a temporary file first, so that an interrupted write never leaves a valid looking entry behind
+        void save(const Stage stage, const uint64_t key, const function<void(ofstream&)>& write)
+        {
+            if (!FileSystem::Exists(directory))
+            {
+                FileSystem::CreateDirectory_(directory);
+            }
+
+            const string file_path      = get_file_path(stage, key);
+            const string file_path_temp = file_path + ".tmp";
+            {
+                ofstream file(file_path_temp, ios::binary | ios::trunc);
+                if (!file.is_open())
+                {
+                    SP_LOG_ERROR("failed to open file for writing: %s", file_path_temp.c_str());
+                    return;
+                }
+
+                const uint32_t stage_index = static_cast<uint32_t>(stage);
+                file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+                file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+                file.write(reinterpret_cast<const char*>(&stage_index), sizeof(stage_index));
+                file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+                write(file);
+
+                if (!file)
+                {
+                    SP_LOG_ERROR("failed to write %s", file_path_temp.c_str());
+                    return;
+                }
+            }
+
+            if (FileSystem::Exists(file_path))
+            {
+                FileSystem::Delete(file_path);
+            }
+            FileSystem::Rename(file_path_temp, file_path);
         }
     }
 
@@ -510,51 +704,37 @@ namespace spartan
             // create new height map with denser grid
             vector<float> dense_height_data(m_dense_width * m_dense_height);
         
-            // helper function to get height at integer coordinates
-            auto get_height = [&height_data, width, height](uint32_t x, uint32_t y) -> float
-            {
-                x = min(x, width - 1);
-                y = min(y, height - 1);
-                return height_data[y * width + x];
-            };
-        
-            // parallel computation of dense grid
-            auto compute_dense_pixel = [&dense_height_data, &get_height, width, height, m_dense_width, m_dense_height, density](uint32_t start_index, uint32_t end_index)
+            // bilinear interpolation, separated: blend the two source rows once, then interpolate along x
+            auto compute_dense_rows = [&](uint32_t row_start, uint32_t row_end)
             {
-                for (uint32_t index = start_index; index < end_index; index++)
+                vector<float> row(width);
+                for (uint32_t y = row_start; y < row_end; y++)
                 {
-                    uint32_t x = index % m_dense_width;
-                    uint32_t y = index / m_dense_width;
-        
-                    // map to original height map coordinates (0 to width-1, 0 to height-1)
-                    float u = static_cast<float>(x) / static_cast<float>(density);
-                    float v = static_cast<float>(y) / static_cast<float>(density);
-        
-                    // integer and fractional parts for interpolation
-                    uint32_t x0 = static_cast<uint32_t>(floor(u));
-                    uint32_t x1 = min(x0 + 1, width - 1);
-                    uint32_t y0 = static_cast<uint32_t>(floor(v));
-                    uint32_t y1 = min(y0 + 1, height - 1);
-                    float dx    = u - static_cast<float>(x0);
-                    float dy    = v - static_cast<float>(y0);
-        
-                    // get heights at the four corners
-                    float h00 = get_height(x0, y0);
-                    float h10 = get_height(x1, y0);
-                    float h01 = get_height(x0, y1);
-                    float h11 = get_height(x1, y1);
-        
-                    // perform bilinear interpolation
-                    float height = (1.0f - dx) * (1.0f - dy) * h00 +
-                                   dx * (1.0f - dy) * h10 +
-                                   (1.0f - dx) * dy * h01 +
-                                   dx * dy * h11;
-        
-                    dense_height_data[y * m_dense_width + x] = height;
+                    const uint32_t y0    = min(y / density, height - 1);
+                    const uint32_t y1    = min(y0 + 1, height - 1);
+                    const float dy       = static_cast<float>(y - y0 * density) / static_cast<float>(density);
+                    const float* source0 = &height_data[y0 * width];
+                    const float* source1 = &height_data[y1 * width];
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        row[x] = source0[x] + dy * (source1[x] - source0[x]);
+                    }
+
+                    float* destination = &dense_height_data[y * m_dense_width];
+                    for (uint32_t x0 = 0; x0 + 1 < width; x0++)
+                    {
+                        const float h0 = row[x0];
+                        const float h1 = row[x0 + 1];
+                        for (uint32_t step = 0; step < density; step++)
+                        {
+                            destination[x0 * density + step] = h0 + (static_cast<float>(step) / static_cast<float>(density)) * (h1 - h0);
+                        }
+                    }
+                    destination[m_dense_width - 1] = row[width - 1];
                 }
             };
         
-            ThreadPool::ParallelLoop(compute_dense_pixel, m_dense_width * m_dense_height);
+            ThreadPool::ParallelLoop(compute_dense_rows, m_dense_height);
         
             // replace original height data with denser grid
             height_data = move(dense_height_data);
@@ -608,7 +788,7 @@ namespace spartan
             ThreadPool::ParallelLoop(generate_position_range, total_positions);
         }
 
-        void apply_wind_erosion(vector<Vector3>& m_positions, uint32_t width, uint32_t height, float wind_strength = 0.3f)
+        void apply_wind_erosion(vector<Vector3>& m_positions, uint32_t width, uint32_t height, float wind_strength = 0.3f, const uint32_t worker_count = 0)
         {
             // 3x3 gaussian kernel
             const float kernel[3][3] =
@@ -617,49 +797,52 @@ namespace spartan
                 {0.125f,  0.25f,  0.125f},
                 {0.0625f, 0.125f, 0.0625f}
             };
-            const int kernel_size = 3;
-            const int kernel_half = kernel_size / 2;
-        
-            // store original positions for reference
-           vector<Vector3> temp_positions = m_positions;
-           mutex positions_mutex;
-        
-            // sequential wind erosion
-            for (uint32_t z = 0; z < height; ++z)
+            const uint32_t kernel_size = 3;
+            const uint32_t kernel_half = kernel_size / 2;
+
+            if (width < kernel_size || height < kernel_size)
+                return;
+
+            // store original heights for reference
+            vector<float> heights(m_positions.size());
+            auto copy_heights = [&m_positions, &heights](uint32_t start, uint32_t end)
             {
-                for (uint32_t x = 0; x < width; ++x)
+                for (uint32_t i = start; i < end; i++)
                 {
-                    // skip borders to avoid out-of-bounds access
-                    if (x < kernel_half || x >= width - kernel_half || z < kernel_half || z >= height - kernel_half)
-                        continue;
-        
-                    // apply gaussian convolution
-                    float new_height = 0.0f;
-                    for (int kz = -kernel_half; kz <= kernel_half; ++kz)
+                    heights[i] = m_positions[i].y;
+                }
+            };
+            ThreadPool::ParallelLoop(copy_heights, static_cast<uint32_t>(m_positions.size()), worker_count);
+
+            // every row only reads the original heights, so rows can be processed in any order
+            auto erode_rows = [&](uint32_t row_start, uint32_t row_end)
+            {
+                for (uint32_t z = row_start + kernel_half; z < row_end + kernel_half; ++z)
+                {
+                    for (uint32_t x = kernel_half; x < width - kernel_half; ++x)
                     {
-                        for (int kx = -kernel_half; kx <= kernel_half; ++kx)
+                        // apply gaussian convolution
+                        float new_height = 0.0f;
+                        for (uint32_t kz = 0; kz < kernel_size; ++kz)
                         {
-                            uint32_t idx = (x + kx) + (z + kz) * width;
-                            new_height += temp_positions[idx].y * kernel[kz + kernel_half][kx + kernel_half];
+                            for (uint32_t kx = 0; kx < kernel_size; ++kx)
+                            {
+                                new_height += heights[(x + kx - kernel_half) + (z + kz - kernel_half) * width] * kernel[kz][kx];
+                            }
                         }
-                    }
-        
-                    // update height with wind strength (interpolate between original and convolved height)
-                    uint32_t idx = x + z * width;
-                    float original_height = m_positions[idx].y;
-                    float smoothed_height = new_height;
-                    float final_height = original_height + wind_strength * (smoothed_height - original_height);
-        
-                    // update
-                    {
-                        lock_guard<mutex> lock(positions_mutex);
-                        m_positions[idx].y = final_height;
+
+                        // update height with wind strength (interpolate between original and convolved height)
+                        const uint32_t idx          = x + z * width;
+                        const float original_height = heights[idx];
+                        m_positions[idx].y          = original_height + wind_strength * (new_height - original_height);
                     }
                 }
-            }
+            };
+            ThreadPool::ParallelLoop(erode_rows, height - 2 * kernel_half, worker_count);
         }
-        
-        void apply_erosion(vector<Vector3>& m_positions, uint32_t width, uint32_t height, uint32_t iterations = 1'000'000, uint32_t wind_interval = 50'000)
+
+        // worker_count only exists so that the test can show that the result doesn't depend on it
+        void apply_erosion(vector<Vector3>& m_positions, uint32_t width, uint32_t height, const uint32_t seed, uint32_t iterations = 1'000'000, uint32_t wind_interval = 50'000, const uint32_t worker_count = 0)
         {
             // erosion parameters
             const float inertia          = 0.05f;
@@ -672,6 +855,16 @@ namespace spartan
             const uint32_t max_steps     = 30;
             const float wind_strength    = 0.3f;
 
+            // droplets are simulated in parallel over square tiles, using a checkerboard of four phases, a droplet never
+            // leaves the halo around the tile it starts in and moves at most one cell per step, so the cells that
+            // two tiles of the same phase touch never overlap, and the result doesn't depend on the thread count
+            const uint32_t tile_size = 128;
+            const float halo         = static_cast<float>(max_steps + 2);
+            static_assert(tile_size > 2 * (max_steps + 2 + 2), "tiles of the same phase must not touch the same cells");
+
+            if (width < 3 || height < 3)
+                return;
+
             auto get_height = [&m_positions, width, height](float x, float z) -> float
             {
                 int ix   = static_cast<int>(floor(x));
@@ -729,23 +922,10 @@ namespace spartan
 
                 return Vector2(hx, hz);
             };
-        
-            // random number generation
-            mt19937 gen(random_device{}());
-            uniform_real_distribution<float> dist_x(1.0f, static_cast<float>(width) - 2.0f);
-            uniform_real_distribution<float> dist_z(1.0f, static_cast<float>(height) - 2.0f);
-        
-            for (uint32_t i = 0; i < iterations; ++i)
+
+            // hydraulic erosion: simulate a single droplet, confined to the given bounds
+            auto simulate_droplet = [&](float pos_x, float pos_z, const float min_x, const float min_z, const float max_x, const float max_z)
             {
-                // apply wind erosion periodically
-                if (i % wind_interval == 0 && i != 0)
-                {
-                    apply_wind_erosion(m_positions, width, height, wind_strength);
-                }
-        
-                // hydraulic erosion: simulate a single droplet
-                float pos_x    = dist_x(gen);
-                float pos_z    = dist_z(gen);
                 Vector2 dir    = Vector2::Zero;
                 float speed    = 1.0f;
                 float water    = 1.0f;
@@ -769,12 +949,12 @@ namespace spartan
                     dir             = (dir * inertia + new_dir * (1.0f - inertia)).Normalized();
         
                     // proposed new position
-                    float new_x      = pos_x + dir.x;
-                    float new_z      = pos_z + dir.y;
-                    float new_height = get_height(new_x, new_z);
-                    float delta_h    = new_height - height;
+                    float new_x   = pos_x + dir.x;
+                    float new_z   = pos_z + dir.y;
+                    bool escaped  = new_x < min_x || new_x > max_x || new_z < min_z || new_z > max_z;
+                    float delta_h = escaped ? 0.0f : get_height(new_x, new_z) - height;
         
-                    // if moving uphill or stuck, deposit a fraction and stop (reduces spikes)
+                    // if moving uphill, stuck or out of bounds, deposit a fraction and stop (reduces spikes)
                     if (delta_h >= 0.0f || dir.LengthSquared() < 0.0001f)
                     {
                         float deposit_amount = sediment * deposition_rate; // only deposit a fraction, discard rest (reduce spikes)
@@ -812,10 +992,93 @@ namespace spartan
                     // evaporate water
                     water *= (1.0f - evaporation_rate);
                 }
+            };
+
+            // tiles, grouped by phase
+            const uint32_t tile_count_x = (width  + tile_size - 1) / tile_size;
+            const uint32_t tile_count_z = (height + tile_size - 1) / tile_size;
+            const uint32_t tile_count   = tile_count_x * tile_count_z;
+            vector<uint32_t> phase_tiles[4];
+            for (uint32_t tile = 0; tile < tile_count; tile++)
+            {
+                const uint32_t tile_x = tile % tile_count_x;
+                const uint32_t tile_z = tile / tile_count_x;
+                phase_tiles[(tile_x & 1) | ((tile_z & 1) << 1)].push_back(tile);
+            }
+
+            // the droplets of a round, sorted by tile, in ascending droplet order within each tile
+            vector<float> droplet_x(wind_interval);
+            vector<float> droplet_z(wind_interval);
+            vector<uint32_t> droplet_tile(wind_interval);
+            vector<uint32_t> tile_offsets(tile_count + 1);
+            vector<uint32_t> tile_droplets(wind_interval);
+
+            for (uint32_t round_start = 0; round_start < iterations; round_start += wind_interval)
+            {
+                const uint32_t droplet_count = min(wind_interval, iterations - round_start);
+
+                // every droplet draws its start from its own stream
+                auto start_droplets = [&](uint32_t start, uint32_t end)
+                {
+                    for (uint32_t i = start; i < end; i++)
+                    {
+                        droplet_x[i]    = random_counter(seed, round_start + i, 0, 1.0f, static_cast<float>(width)  - 2.0f);
+                        droplet_z[i]    = random_counter(seed, round_start + i, 1, 1.0f, static_cast<float>(height) - 2.0f);
+                        droplet_tile[i] = min(static_cast<uint32_t>(droplet_z[i]) / tile_size, tile_count_z - 1) * tile_count_x +
+                                          min(static_cast<uint32_t>(droplet_x[i]) / tile_size, tile_count_x - 1);
+                    }
+                };
+                ThreadPool::ParallelLoop(start_droplets, droplet_count, worker_count);
+
+                // counting sort by tile
+                fill(tile_offsets.begin(), tile_offsets.end(), 0);
+                for (uint32_t i = 0; i < droplet_count; i++)
+                {
+                    tile_offsets[droplet_tile[i] + 1]++;
+                }
+                for (uint32_t tile = 0; tile < tile_count; tile++)
+                {
+                    tile_offsets[tile + 1] += tile_offsets[tile];
+                }
+                for (uint32_t i = 0; i < droplet_count; i++)
+                {
+                    tile_droplets[tile_offsets[droplet_tile[i]]++] = i;
+                }
+                for (uint32_t tile = tile_count; tile > 0; tile--)
+                {
+                    tile_offsets[tile] = tile_offsets[tile - 1];
+                }
+                tile_offsets[0] = 0;
+
+                // simulate, one phase at a time
+                for (const vector<uint32_t>& tiles : phase_tiles)
+                {
+                    if (tiles.empty())
+                        continue;
+
+                    auto erode_tiles = [&](uint32_t start, uint32_t end)
+                    {
+                        for (uint32_t t = start; t < end; t++)
+                        {
+                            const uint32_t tile = tiles[t];
+                            const float min_x   = static_cast<float>((tile % tile_count_x) * tile_size) - halo;
+                            const float min_z   = static_cast<float>((tile / tile_count_x) * tile_size) - halo;
+                            const float max_x   = min_x + static_cast<float>(tile_size) + 2.0f * halo;
+                            const float max_z   = min_z + static_cast<float>(tile_size) + 2.0f * halo;
+
+                            for (uint32_t i = tile_offsets[tile]; i < tile_offsets[tile + 1]; i++)
+                            {
+                                const uint32_t droplet = tile_droplets[i];
+                                simulate_droplet(droplet_x[droplet], droplet_z[droplet], min_x, min_z, max_x, max_z);
+                            }
+                        }
+                    };
+                    ThreadPool::ParallelLoop(erode_tiles, static_cast<uint32_t>(tiles.size()), worker_count);
+                }
+
+                // apply wind erosion periodically
+                apply_wind_erosion(m_positions, width, height, wind_strength, worker_count);
             }
-        
-            // final wind erosion pass
-            apply_wind_erosion(m_positions, width, height, wind_strength);
         }
 
         void generate_vertices_and_indices(vector<RHI_Vertex_PosTexNorTan>& terrain_vertices, vector<uint32_t>& terrain_indices, const vector<Vector3>& m_positions, const uint32_t width, const uint32_t height)
@@ -876,187 +1139,199 @@ namespace spartan
             }
         }
 
-        void generate_normals(vector<RHI_Vertex_PosTexNorTan>& terrain_vertices, uint32_t width, uint32_t height)
+        void apply_perlin_noise(vector<Vector3>& m_positions, uint32_t width, uint32_t height, const uint32_t seed, float amplitude = 5.0f, float frequency = 0.01f, uint32_t octaves = 4, float persistence = 1.0f)
         {
-            SP_ASSERT_MSG(!terrain_vertices.empty(), "Vertices are empty");
-        
-            auto compute_vertex_data = [&](uint32_t start, uint32_t end)
+            NoiseParameters parameters;
+            parameters.type        = NoiseType::Gradient;
+            parameters.fractal     = NoiseFractal::Fbm;
+            parameters.seed        = seed;
+            parameters.frequency   = frequency;
+            parameters.octaves     = octaves;
+            parameters.persistence = persistence;
+
+            vector<float> noise(width * height);
+            Noise(parameters).SampleGrid(noise.data(), width, height);
+
+            auto apply_noise = [&](uint32_t start_index, uint32_t end_index)
             {
-                for (uint32_t index = start; index < end; index++)
+                for (uint32_t index = start_index; index < end_index; ++index)
                 {
-                    uint32_t i = index % width;
-                    uint32_t j = index / width;
-        
-                    // compute normal using gradients
-                    float h_left, h_right, h_bottom, h_top;
-        
-                    // x-direction gradient
-                    if (i == 0)
-                    {
-                        h_left  = terrain_vertices[j * width + i].pos[1];
-                        h_right = terrain_vertices[j * width + i + 1].pos[1];
-                    }
-                    else if (i == width - 1)
-                    {
-                        h_left  = terrain_vertices[j * width + i - 1].pos[1];
-                        h_right = terrain_vertices[j * width + i].pos[1];
-                    } else
-                    {
-                        h_left  = terrain_vertices[j * width + i - 1].pos[1];
-                        h_right = terrain_vertices[j * width + i + 1].pos[1];
-                    }
-                    float dh_dx = (h_right - h_left) / (i == 0 || i == width - 1 ? 1.0f : 2.0f);
-        
-                    // z-direction gradient
-                    if (j == 0)
-                    {
-                        h_bottom = terrain_vertices[j * width + i].pos[1];
-                        h_top    = terrain_vertices[(j + 1) * width + i].pos[1];
-                    }
-                    else if (j == height - 1)
-                    {
-                        h_bottom = terrain_vertices[(j - 1) * width + i].pos[1];
-                        h_top    = terrain_vertices[j * width + i].pos[1];
-                    }
-                    else
-                    {
-                        h_bottom = terrain_vertices[(j - 1) * width + i].pos[1];
-                        h_top    = terrain_vertices[(j + 1) * width + i].pos[1];
-                    }
-                    float dh_dz = (h_top - h_bottom) / (j == 0 || j == height - 1 ? 1.0f : 2.0f);
-
-                    // normal
-                    Vector3 normal(-dh_dx, 1.0f, -dh_dz);
-                    normal.Normalize();
-                    terrain_vertices[index].nor[0] = normal.x;
-                    terrain_vertices[index].nor[1] = normal.y;
-                    terrain_vertices[index].nor[2] = normal.z;
-        
-                    // tangent
-                    Vector3 tangent(1.0f, 0.0f, 0.0f);
-                    float proj  = Vector3::Dot(normal, tangent);
-                    tangent     -= normal * proj; // Orthogonalize to normal
-                    tangent.Normalize();
-                    terrain_vertices[index].tan[0] = tangent.x;
-                    terrain_vertices[index].tan[1] = tangent.y;
-                    terrain_vertices[index].tan[2] = tangent.z;
+                    m_positions[index].y += noise[index] * amplitude;
                 }
             };
-        
-            ThreadPool::ParallelLoop(compute_vertex_data, static_cast<uint32_t>(terrain_vertices.size()));
+
+            ThreadPool::ParallelLoop(apply_noise, width * height);
         }
+    }
+
+    Terrain::Terrain(Entity* entity) : Component(entity)
+    {
+        m_material = make_shared<Material>();
+        m_material->SetObjectName("terrain");
+        m_quadtree = make_unique<TerrainQuadtree>();
+    }
+
+    Terrain::~Terrain()
+    {
+        // the chunk entities go away with the world, only their vertices have to be returned to the pool
+        m_quadtree->SetChunkCallbacks(nullptr, [](TerrainChunk& chunk) { GeometryPool::Free(chunk.allocation); }, nullptr);
+        m_quadtree->Shutdown();
+        m_height_map_seed = nullptr;
+    }
+
+    void Terrain::Tick()
+    {
+        Camera* camera = World::GetCamera();
+        if (!camera)
+            return;
+
+        // the quadtree is rebuilt while generating
+        unique_lock lock(m_quadtree_mutex, try_to_lock);
+        if (!lock.owns_lock() || m_is_generating)
+            return;
+
+        // the quadtree lives in the space of the terrain, like the positions it streams from
+        m_quadtree->Tick(camera->GetEntity()->GetPosition() * GetEntity()->GetMatrix().Inverted());
+    }
 
-        void apply_perlin_noise(vector<Vector3>& m_positions, uint32_t width, uint32_t height, float amplitude = 5.0f, float frequency = 0.01f, uint32_t octaves = 4, float persistence = 1.0f)
+    bool Terrain::GetTileSampleRange(Entity* tile, uint32_t& x_begin, uint32_t& x_end, uint32_t& z_begin, uint32_t& z_end, Vector3& offset) const
+    {
+        const vector<Entity*>& children = m_entity_ptr->GetChildren();
+        const auto it                   = find(children.begin(), children.end(), tile);
+        const uint32_t tile_index       = static_cast<uint32_t>(it - children.begin());
+        if (it == children.end() || tile_index >= m_tile_offsets.size() || m_positions.empty())
+            return false;
+
+        // tiles split the surface into equal parts, see split_surface_into_tiles()
+        const uint32_t tile_count = static_cast<uint32_t>(sqrt(static_cast<float>(m_tile_offsets.size())) + 0.5f);
+        const Vector3& first      = m_positions.front();
+        const Vector3& last       = m_positions.back();
+        const float spacing_x     = (last.x - first.x) / static_cast<float>(m_dense_width - 1);
+        const float spacing_z     = (last.z - first.z) / static_cast<float>(m_dense_height - 1);
+        const float tile_width    = (last.x - first.x) / static_cast<float>(tile_count);
+        const float tile_depth    = (last.z - first.z) / static_cast<float>(tile_count);
+        offset                    = m_tile_offsets[tile_index];
+
+        // samples that cover the tile, rounded outwards so that neighbouring tiles overlap instead of leaving gaps
+        auto to_sample = [](const float sample, const uint32_t count)
         {
-            auto fade = [](float t) -> float
-            {
-                return t * t * t * (t * (t * 6 - 15) + 10); // 6t^5 - 15t^4 + 10t^3
-            };
-        
-            auto lerp = [](float a, float b, float t) -> float
-            {
-                return a + t * (b - a);
-            };
-        
-            // initialize permutation table and gradients
-            vector<uint8_t> permutation(512);
-            vector<Vector2> gradients(256);
+            return static_cast<uint32_t>(clamp(sample, 0.0f, static_cast<float>(count - 1)));
+        };
+        x_begin = to_sample(floor((offset.x - tile_width * 0.5f - first.x) / spacing_x), m_dense_width);
+        x_end   = to_sample(ceil((offset.x + tile_width * 0.5f - first.x) / spacing_x), m_dense_width);
+        z_begin = to_sample(floor((offset.z - tile_depth * 0.5f - first.z) / spacing_z), m_dense_height);
+        z_end   = to_sample(ceil((offset.z + tile_depth * 0.5f - first.z) / spacing_z), m_dense_height);
+
+        return x_end > x_begin && z_end > z_begin;
+    }
+
+    void Terrain::GetTileGeometry(Entity* tile, vector<uint32_t>* indices, vector<RHI_Vertex_PosTexNorTan>* vertices) const
+    {
+        uint32_t x_begin = 0, x_end = 0, z_begin = 0, z_end = 0;
+        Vector3 offset;
+        if (!GetTileSampleRange(tile, x_begin, x_end, z_begin, z_end, offset))
+            return;
+
+        const uint32_t width  = x_end - x_begin + 1;
+        const uint32_t height = z_end - z_begin + 1;
+
+        if (vertices)
+        {
+            vertices->clear();
+            vertices->reserve(width * height);
+            for (uint32_t z = z_begin; z <= z_end; z++)
             {
-                mt19937 gen(random_device{}());
-                uniform_real_distribution<float> dist(-1.0f, 1.0f);
-        
-                for (uint32_t i = 0; i < 256; ++i)
+                for (uint32_t x = x_begin; x <= x_end; x++)
                 {
-                    permutation[i] = static_cast<uint8_t>(i);
-        
-                    // generate normalized gradient vectors
-                    Vector2 grad(dist(gen), dist(gen));
-                    gradients[i] = grad.Normalized();
+                    const Vector2 uv(static_cast<float>(x) / static_cast<float>(m_dense_width - 1), static_cast<float>(z) / static_cast<float>(m_dense_height - 1));
+                    vertices->emplace_back(m_positions[z * m_dense_width + x] - offset, uv);
                 }
-        
-                for (uint32_t i = 0; i < 256; ++i)
-                {
-                    permutation[256 + i] = permutation[i];
-                }
-        
-                // shuffle
-                for (uint32_t i = 255; i > 0; --i)
+            }
+        }
+
+        if (indices)
+        {
+            indices->clear();
+            indices->reserve((width - 1) * (height - 1) * 6);
+            for (uint32_t z = 0; z < height - 1; z++)
+            {
+                for (uint32_t x = 0; x < width - 1; x++)
                 {
-                    uniform_int_distribution<uint32_t> dist(0, i);
-                    uint32_t j = dist(gen);
-                    swap(permutation[i], permutation[j]);
-                    permutation[256 + i] = permutation[i];
+                    const uint32_t bottom_left  = z * width + x;
+                    const uint32_t bottom_right = bottom_left + 1;
+                    const uint32_t top_left     = bottom_left + width;
+                    const uint32_t top_right    = top_left + 1;
+
+                    indices->insert(indices->end(), { bottom_right, bottom_left, top_left, bottom_right, top_left, top_right });
                 }
             }
-        
-            auto perlin_noise = [&](float x, float z) -> float
+        }
+    }
+
+    bool Terrain::GetTileHeights(Entity* tile, TerrainTileHeights& heights) const
+    {
+        uint32_t x_begin = 0, x_end = 0, z_begin = 0, z_end = 0;
+        Vector3 offset;
+        if (!GetTileSampleRange(tile, x_begin, x_end, z_begin, z_end, offset))
+            return false;
+
+        const Vector3& first = m_positions[z_begin * m_dense_width + x_begin];
+        const Vector3& last  = m_positions[z_end * m_dense_width + x_end];
+        heights.count_x      = x_end - x_begin + 1;
+        heights.count_z      = z_end - z_begin + 1;
+        heights.spacing_x    = (last.x - first.x) / static_cast<float>(heights.count_x - 1);
+        heights.spacing_z    = (last.z - first.z) / static_cast<float>(heights.count_z - 1);
+        heights.origin       = Vector3(first.x - offset.x, 0.0f, first.z - offset.z);
+
+        heights.heights.resize(heights.count_x * heights.count_z);
+        for (uint32_t z = 0; z < heights.count_z; z++)
+        {
+            for (uint32_t x = 0; x < heights.count_x; x++)
             {
-                int X = static_cast<int>(floor(x)) & 255;
-                int Z = static_cast<int>(floor(z)) & 255;
-                x -= floor(x);
-                z -= floor(z);
-        
-                float u = fade(x);
-                float v = fade(z);
-        
-                int aa = permutation[permutation[X] + Z];
-                int ab = permutation[permutation[X] + Z + 1];
-                int ba = permutation[permutation[X + 1] + Z];
-                int bb = permutation[permutation[X + 1] + Z + 1];
-        
-                float grad00 = gradients[aa & 255].x * x + gradients[aa & 255].y * z;
-                float grad10 = gradients[ba & 255].x * (x - 1) + gradients[ba & 255].y * z;
-                float grad01 = gradients[ab & 255].x * x + gradients[ab & 255].y * (z - 1);
-                float grad11 = gradients[bb & 255].x * (x - 1) + gradients[bb & 255].y * (z - 1);
-        
-                float lerp_x0 = lerp(grad00, grad10, u);
-                float lerp_x1 = lerp(grad01, grad11, u);
-                return lerp(lerp_x0, lerp_x1, v); // returns in range ~[-1,1]
-            };
-        
-            auto apply_noise = [&](uint32_t start_index, uint32_t end_index)
+                heights.heights[z * heights.count_x + x] = m_positions[(z_begin + z) * m_dense_width + x_begin + x].y - offset.y;
+            }
+        }
+
+        heights.surfaces.clear();
+        if (m_collision_surfaces)
+        {
+            const float rock_slope = 40.0f * math::deg_to_rad;
+
+            heights.surfaces.resize(heights.heights.size());
+            for (uint32_t z = z_begin; z <= z_end; z++)
             {
-                for (uint32_t index = start_index; index < end_index; ++index)
+                for (uint32_t x = x_begin; x <= x_end; x++)
                 {
-                    uint32_t x = index % width;
-                    uint32_t z = index / width;
-        
-                    float scaled_x = static_cast<float>(x) * frequency;
-                    float scaled_z = static_cast<float>(z) * frequency;
-        
-                    float noise_value       = 0.0f;
-                    float current_amplitude = amplitude;
-                    float current_frequency = 1.0f;
-                    float max_amplitude     = 0.0f;
-        
-                    for (uint32_t octave = 0; octave < octaves; ++octave)
+                    // slope from the neighbouring samples, in world units
+                    const Vector3& left   = m_positions[z * m_dense_width + (x > 0 ? x - 1 : x)];
+                    const Vector3& right  = m_positions[z * m_dense_width + min(x + 1, m_dense_width - 1)];
+                    const Vector3& bottom = m_positions[(z > 0 ? z - 1 : z) * m_dense_width + x];
+                    const Vector3& top    = m_positions[min(z + 1, m_dense_height - 1) * m_dense_width + x];
+                    const float dh_dx     = (right.y - left.y) / max(right.x - left.x, numeric_limits<float>::epsilon());
+                    const float dh_dz     = (top.y - bottom.y) / max(top.z - bottom.z, numeric_limits<float>::epsilon());
+                    const float slope     = atan(sqrt(dh_dx * dh_dx + dh_dz * dh_dz));
+                    const float y         = m_positions[z * m_dense_width + x].y;
+
+                    TerrainSurface surface = TerrainSurface::Grass;
+                    if (y <= parameters::level_sea + 1.0f)
                     {
-                        float n = perlin_noise(scaled_x * current_frequency, scaled_z * current_frequency);
-                        noise_value += n * current_amplitude;
-        
-                        max_amplitude += current_amplitude;
-                        current_amplitude *= persistence;
-                        current_frequency *= 2.0f;
+                        surface = TerrainSurface::Sand;
                     }
-        
-                    noise_value /= max_amplitude; // normalize to [-1,1] range
-                    m_positions[index].y += noise_value * amplitude; // apply final amplitude
+                    else if (slope > rock_slope)
+                    {
+                        surface = TerrainSurface::Rock;
+                    }
+                    else if (y >= parameters::level_snow)
+                    {
+                        surface = TerrainSurface::Snow;
+                    }
+
+                    heights.surfaces[(z - z_begin) * heights.count_x + (x - x_begin)] = surface;
                 }
-            };
-        
-            ThreadPool::ParallelLoop(apply_noise, width * height);
+            }
         }
-    }
-
-    Terrain::Terrain(Entity* entity) : Component(entity)
-    {
-        m_material = make_shared<Material>();
-        m_material->SetObjectName("terrain");
-    }
 
-    Terrain::~Terrain()
-    {
-        m_height_map_seed = nullptr;
+        return true;
     }
 
     void Terrain::FindTransforms(const uint32_t tile_index, const TerrainProp terrain_prop, Entity* entity, const float density_fraction, const float scale, vector<Matrix>& transforms_out)
@@ -1106,12 +1381,31 @@ namespace spartan
             SP_ASSERT_MSG(false, "Unknown terrain prop type for FindTransforms");
         }
 
-        placement::find_transforms(
-            description,
-            density_fraction,
-            tile_index,
-            transforms_out
-        );
+        // the seed of a prop type within a tile, derived from the terrain seed
+        const uint32_t seed = static_cast<uint32_t>(random_counter_bits(m_seed, tile_index, 0x100 + static_cast<uint32_t>(terrain_prop)) >> 32);
+
+        // placement is deterministic, so once generated terrain is cached, the transforms are cached along with it
+        const uint64_t key = cache::compute_props_key(m_cache_key, seed, density_fraction, scale);
+        bool cached        = m_cache_key != 0 && cache::load(cache::Stage::Props, key, [&transforms_out](ifstream& file, uint64_t file_size)
+        {
+            return cache::read_vector(file, transforms_out, file_size);
+        });
+
+        if (!cached)
+        {
+            placement::find_transforms(
+                description,
+                density_fraction,
+                tile_index,
+                seed,
+                transforms_out
+            );
+
+            if (m_cache_key != 0)
+            {
+                cache::save(cache::Stage::Props, key, [&transforms_out](ofstream& file) { cache::write_vector(file, transforms_out); });
+            }
+        }
 
         // counter-act any scaling since it's baked into the instance transforms and can be controled via scale_min and scale_max
         if (entity)
@@ -1127,149 +1421,6 @@ namespace spartan
         }
     }
 
-     void Terrain::SaveToFile(const char* file_path)
-    {
-        ofstream file(file_path, ios::binary);
-        if (!file.is_open())
-        {
-            SP_LOG_ERROR("failed to open file for writing: %s", file_path);
-            return;
-        }
-    
-        uint32_t width               = GetWidth();
-        uint32_t height              = GetHeight();
-        uint32_t height_data_size    = static_cast<uint32_t>(m_height_data.size());
-        uint32_t vertex_count        = static_cast<uint32_t>(m_vertices.size());
-        uint32_t index_count         = static_cast<uint32_t>(m_indices.size());
-        uint32_t tile_count          = static_cast<uint32_t>(m_tile_vertices.size());
-        uint32_t triangle_data_count = static_cast<uint32_t>(placement::triangle_data.size());
-        uint32_t offset_count        = static_cast<uint32_t>(m_tile_offsets.size());
-        uint32_t position_count      = static_cast<uint32_t>(m_positions.size());
-        uint32_t dense_width_value   = m_dense_width;
-        uint32_t dense_height_value  = m_dense_height;
-    
-        // header
-        file.write(reinterpret_cast<const char*>(&width), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&height), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&height_data_size), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&vertex_count), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&index_count), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&tile_count), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&triangle_data_count), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&offset_count), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&position_count), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&dense_width_value), sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(&dense_height_value), sizeof(uint32_t));
-    
-        // main data
-        file.write(reinterpret_cast<const char*>(m_height_data.data()), height_data_size * sizeof(float));
-        file.write(reinterpret_cast<const char*>(m_vertices.data()), vertex_count * sizeof(RHI_Vertex_PosTexNorTan));
-        file.write(reinterpret_cast<const char*>(m_indices.data()), index_count * sizeof(uint32_t));
-        file.write(reinterpret_cast<const char*>(m_tile_offsets.data()), offset_count * sizeof(Vector3));
-        file.write(reinterpret_cast<const char*>(m_positions.data()), position_count * sizeof(Vector3));
-    
-        // triangle data
-        for (const auto& [tile_id, tile_triangles] : placement::triangle_data)
-        {
-            file.write(reinterpret_cast<const char*>(&tile_id), sizeof(uint64_t));
-            uint32_t triangle_count = static_cast<uint32_t>(tile_triangles.size());
-            file.write(reinterpret_cast<const char*>(&triangle_count), sizeof(uint32_t));
-            file.write(reinterpret_cast<const char*>(tile_triangles.data()), triangle_count * sizeof(placement::TriangleData));
-        }
-    
-        // tile data
-        for (uint32_t i = 0; i < tile_count; i++)
-        {
-            uint32_t vertex_size = static_cast<uint32_t>(m_tile_vertices[i].size());
-            uint32_t index_size  = static_cast<uint32_t>(m_tile_indices[i].size());
-            file.write(reinterpret_cast<const char*>(&vertex_size), sizeof(uint32_t));
-            file.write(reinterpret_cast<const char*>(&index_size), sizeof(uint32_t));
-            file.write(reinterpret_cast<const char*>(m_tile_vertices[i].data()), vertex_size * sizeof(RHI_Vertex_PosTexNorTan));
-            file.write(reinterpret_cast<const char*>(m_tile_indices[i].data()), index_size * sizeof(uint32_t));
-        }
-    
-        file.close();
-
-        SP_LOG_INFO("saved terrain to %s: width=%u, height=%u, height_data_size=%u, vertex_count=%u, index_count=%u, tile_count=%u, triangle_data_count=%u, offset_count=%u, position_count=%u, dense_width=%u, dense_height=%u",
-            file_path, width, height, height_data_size, vertex_count, index_count, tile_count, triangle_data_count, offset_count, position_count, dense_width_value, dense_height_value);
-    }
-    
-    void Terrain::LoadFromFile(const char* file_path)
-    {
-        ifstream file(file_path, ios::binary);
-        if (!file.is_open())
-            return;
-    
-        uint32_t height_data_size    = 0;
-        uint32_t vertex_count        = 0;
-        uint32_t index_count         = 0;
-        uint32_t tile_count          = 0;
-        uint32_t triangle_data_count = 0;
-        uint32_t offset_count        = 0;
-        uint32_t position_count      = 0;
-    
-        file.read(reinterpret_cast<char*>(&m_width), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&m_height), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&height_data_size), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&vertex_count), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&index_count), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&tile_count), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&triangle_data_count), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&offset_count), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&position_count), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&m_dense_width), sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(&m_dense_height), sizeof(uint32_t));
-    
-        if (tile_count > 10000 || offset_count > 10000)
-        {
-            SP_LOG_ERROR("invalid tile_count (%u) or offset_count (%u) read from file, aborting load", tile_count, offset_count);
-            file.close();
-            return;
-        }
-    
-        m_height_data.resize(height_data_size);
-        m_vertices.resize(vertex_count);
-        m_indices.resize(index_count);
-        m_tile_vertices.resize(tile_count);
-        m_tile_indices.resize(tile_count);
-        m_tile_offsets.resize(offset_count);
-        m_positions.resize(position_count);
-        placement::triangle_data.clear();
-    
-        file.read(reinterpret_cast<char*>(m_height_data.data()), height_data_size * sizeof(float));
-        file.read(reinterpret_cast<char*>(m_vertices.data()), vertex_count * sizeof(RHI_Vertex_PosTexNorTan));
-        file.read(reinterpret_cast<char*>(m_indices.data()), index_count * sizeof(uint32_t));
-        file.read(reinterpret_cast<char*>(m_tile_offsets.data()), offset_count * sizeof(Vector3));
-        file.read(reinterpret_cast<char*>(m_positions.data()), position_count * sizeof(Vector3));
-    
-        for (uint32_t i = 0; i < triangle_data_count; i++)
-        {
-            uint64_t tile_id;
-            uint32_t triangle_count;
-            file.read(reinterpret_cast<char*>(&tile_id), sizeof(uint64_t));
-            file.read(reinterpret_cast<char*>(&triangle_count), sizeof(uint32_t));
-            vector<placement::TriangleData>& tile_triangles = placement::triangle_data[tile_id];
-            tile_triangles.resize(triangle_count);
-            file.read(reinterpret_cast<char*>(tile_triangles.data()), triangle_count * sizeof(placement::TriangleData));
-        }
-    
-        for (uint32_t i = 0; i < tile_count; i++)
-        {
-            uint32_t vertex_size, index_size;
-            file.read(reinterpret_cast<char*>(&vertex_size), sizeof(uint32_t));
-            file.read(reinterpret_cast<char*>(&index_size), sizeof(uint32_t));
-            m_tile_vertices[i].resize(vertex_size);
-            m_tile_indices[i].resize(index_size);
-            file.read(reinterpret_cast<char*>(m_tile_vertices[i].data()), vertex_size * sizeof(RHI_Vertex_PosTexNorTan));
-            file.read(reinterpret_cast<char*>(m_tile_indices[i].data()), index_size * sizeof(uint32_t));
-        }
-    
-        file.close();
-    
-        SP_LOG_INFO("loaded terrain from %s: width=%u, height=%u, height_data_size=%u, vertex_count=%u, index_count=%u, tile_count=%u, triangle_data_count=%u, offset_count=%u, position_count=%u, dense_width=%u, dense_height=%u",
-            file_path, m_width, m_height, height_data_size, vertex_count, index_count, tile_count, triangle_data_count, offset_count, position_count, m_dense_width, m_dense_height);
-    }
-
     uint32_t Terrain::GetDensity() const
     {
         return parameters::density;
@@ -1297,106 +1448,202 @@ namespace spartan
         }
     
         m_is_generating = true;
+        Clear();
     
         // start progress tracking
         uint32_t job_count = 9;
-        ProgressTracker::GetProgress(ProgressType::Terrain).Start(job_count, "generating terrain...");
-    
-        // define cache file path
-        const string cache_file = "terrain_cache.bin";
-        bool loaded_from_cache  = false;
-    
-        // try to load from cache
+        Progress& progress = ProgressTracker::GetProgress(ProgressType::Terrain);
+        progress.Start(job_count, "generating terrain...");
+
+        const uint32_t tile_count = 16; // per side
+
+        // cache keys
+        cache::Inputs cache_inputs;
+        cache_inputs.height_map       = &m_height_map_seed->GetMip(0, 0).bytes;
+        cache_inputs.width            = m_height_map_seed->GetWidth();
+        cache_inputs.height           = m_height_map_seed->GetHeight();
+        cache_inputs.channel_count    = m_height_map_seed->GetChannelCount();
+        cache_inputs.bits_per_channel = m_height_map_seed->GetBitsPerChannel();
+        cache_inputs.min_y            = m_min_y;
+        cache_inputs.max_y            = m_max_y;
+        cache_inputs.seed             = m_seed;
+        cache_inputs.tile_count       = tile_count;
+        const auto [key_height, key_positions, key_surface, key_placement] = cache::compute_keys(cache_inputs);
+
+        // 1. process height map
         {
-            LoadFromFile(cache_file.c_str());
-            if (!m_vertices.empty())
+            progress.SetText("process height map...");
+            bool cached = cache::load(cache::Stage::Height, key_height, [this](ifstream& file, uint64_t file_size)
             {
-                loaded_from_cache = true;
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("loaded from cache, skipping to mesh creation...");
-                for (uint32_t i = 0; i < job_count - 1; i++)
-                {
-                    ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
-                }
-            }
-        }
-
-        if (!loaded_from_cache)
-        {
-            SP_LOG_INFO("Terrain not found, generating from scratch...");
-    
-            // 1. process height map
+                file.read(reinterpret_cast<char*>(&m_width), sizeof(uint32_t));
+                file.read(reinterpret_cast<char*>(&m_height), sizeof(uint32_t));
+                file.read(reinterpret_cast<char*>(&m_dense_width), sizeof(uint32_t));
+                file.read(reinterpret_cast<char*>(&m_dense_height), sizeof(uint32_t));
+                return cache::read_vector(file, m_height_data, file_size) && m_height_data.size() == static_cast<size_t>(m_dense_width) * m_dense_height;
+            });
+
+            if (!cached)
             {
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("process height map...");
                 get_values_from_height_map(m_height_data, m_height_map_seed, m_min_y, m_max_y);
                 m_width  = m_height_map_seed->GetWidth();
                 m_height = m_height_map_seed->GetHeight();
-    
+
                 // increase grid density
                 densify_height_map(m_height_data, m_width, m_height, parameters::density);
                 m_dense_width  = parameters::density * (m_width - 1) + 1;
                 m_dense_height = parameters::density * (m_height - 1) + 1;
-                ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
+
+                cache::save(cache::Stage::Height, key_height, [this](ofstream& file)
+                {
+                    file.write(reinterpret_cast<const char*>(&m_width), sizeof(uint32_t));
+                    file.write(reinterpret_cast<const char*>(&m_height), sizeof(uint32_t));
+                    file.write(reinterpret_cast<const char*>(&m_dense_width), sizeof(uint32_t));
+                    file.write(reinterpret_cast<const char*>(&m_dense_height), sizeof(uint32_t));
+                    cache::write_vector(file, m_height_data);
+                });
             }
-    
-            // 2. compute positions
+            progress.JobDone();
+        }
+
+        // 2. compute positions, apply perlin noise, apply hydraulic and wind erosion
+        {
+            bool cached = cache::load(cache::Stage::Positions, key_positions, [this](ifstream& file, uint64_t file_size)
+            {
+                return cache::read_vector(file, m_positions, file_size) && m_positions.size() == static_cast<size_t>(m_dense_width) * m_dense_height;
+            });
+
+            if (!cached)
             {
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("generating positions...");
+                SP_LOG_INFO("Terrain positions not found in the cache, generating from scratch...");
+
+                progress.SetText("generating positions...");
                 m_positions.resize(m_dense_width * m_dense_height);
                 generate_positions(m_positions, m_height_data, m_dense_width, m_dense_height);
-                ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
-            }
+                progress.JobDone();
+
+                progress.SetText("applying Perlin noise...");
+                apply_perlin_noise(m_positions, m_dense_width, m_dense_height, m_seed);
+                progress.JobDone();
+
+                progress.SetText("applying hydraulic and wind erosion...");
+                apply_erosion(m_positions, m_dense_width, m_dense_height, m_seed);
+                progress.JobDone();
 
-            // 3. apply perlin noise
+                cache::save(cache::Stage::Positions, key_positions, [this](ofstream& file) { cache::write_vector(file, m_positions); });
+            }
+            else
             {
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("applying Perlin noise...");
-                apply_perlin_noise(m_positions, m_dense_width, m_dense_height);
-                ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
+                progress.JobDone();
+                progress.JobDone();
+                progress.JobDone();
             }
+        }
 
-            // 4. apply hydraulic and wind erosion
+        // 3. compute vertices and indices, normals and tangents
+        {
+            bool cached = cache::load(cache::Stage::Surface, key_surface, [this](ifstream& file, uint64_t file_size)
             {
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("applying hydraulic and wind erosion...");
-                apply_erosion(m_positions, m_dense_width, m_dense_height);
-                ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
-            }
+                return cache::read_vector(file, m_vertices, file_size) && cache::read_vector(file, m_indices, file_size);
+            });
 
-            // 5. compute vertices and indices
+            if (!cached)
             {
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("generating vertices and indices...");
+                progress.SetText("generating vertices and indices...");
                 m_vertices.resize(m_dense_width * m_dense_height);
                 m_indices.resize((m_dense_width - 1) * (m_dense_height - 1) * 6);
                 generate_vertices_and_indices(m_vertices, m_indices, m_positions, m_dense_width, m_dense_height);
-                ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
+                progress.JobDone();
+
+                // the normals measure slopes in height per sample rather than per meter, which is what the terrain shading is tuned for
+                progress.SetText("generating normals...");
+                const float sample_spacing = static_cast<float>(parameters::scale) / static_cast<float>(parameters::density);
+                geometry_processing::compute_grid_normals_and_tangents(m_vertices.data(), m_dense_width, m_dense_height, sample_spacing);
+                progress.JobDone();
+
+                cache::save(cache::Stage::Surface, key_surface, [this](ofstream& file)
+                {
+                    cache::write_vector(file, m_vertices);
+                    cache::write_vector(file, m_indices);
+                });
             }
-    
-            // 6. compute normals and tangents
+            else
             {
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("generating normals...");
-                generate_normals(m_vertices, m_dense_width, m_dense_height);
-                ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
+                progress.JobDone();
+                progress.JobDone();
             }
-    
-            // 7. split into tiles
+        }
+
+        // 4. tile offsets, the centers of equal parts of the surface, the same ones split_surface_into_tiles() computes
+        {
+            progress.SetText("computing tile offsets...");
+            float min_x = numeric_limits<float>::max();
+            float max_x = numeric_limits<float>::lowest();
+            float min_z = numeric_limits<float>::max();
+            float max_z = numeric_limits<float>::lowest();
+            for (const Vector3& position : m_positions)
             {
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("splitting into tiles...");
-                uint32_t tile_count = 16;
-                geometry_processing::split_surface_into_tiles(m_vertices, m_indices, tile_count, m_tile_vertices, m_tile_indices, m_tile_offsets);
-                ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
+                min_x = min(min_x, position.x);
+                max_x = max(max_x, position.x);
+                min_z = min(min_z, position.z);
+                max_z = max(max_z, position.z);
             }
 
-            // 8. compute triangle data for placement
+            const float tile_width = (max_x - min_x) / static_cast<float>(tile_count);
+            const float tile_depth = (max_z - min_z) / static_cast<float>(tile_count);
+            m_tile_offsets.resize(tile_count * tile_count);
+            for (uint32_t tz = 0; tz < tile_count; tz++)
             {
-                ProgressTracker::GetProgress(ProgressType::Terrain).SetText("computing triangle data for placement...");
-                for (uint32_t tile_index = 0; tile_index < m_tile_vertices.size(); tile_index++)
+                for (uint32_t tx = 0; tx < tile_count; tx++)
                 {
-                    placement::compute_triangle_data(m_tile_vertices, m_tile_indices, tile_index);
+                    m_tile_offsets[tz * tile_count + tx] = Vector3(min_x + (tx + 0.5f) * tile_width, 0.0f, min_z + (tz + 0.5f) * tile_depth);
                 }
-                ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
             }
+            progress.JobDone();
+        }
+
+        // 5. compute triangle data for placement, the per tile geometry it's computed from is only needed on a cache miss
+        {
+            progress.SetText("computing triangle data for placement...");
+            placement::triangle_data.clear();
+            const uint32_t tile_total = tile_count * tile_count;
+            bool cached = cache::load(cache::Stage::Placement, key_placement, [tile_total](ifstream& file, uint64_t file_size)
+            {
+                for (uint32_t tile_index = 0; tile_index < tile_total; tile_index++)
+                {
+                    if (!cache::read_vector(file, placement::triangle_data[tile_index], file_size))
+                        return false;
+                }
+
+                return true;
+            });
 
-            SaveToFile(cache_file.c_str());
+            if (!cached)
+            {
+                vector<vector<RHI_Vertex_PosTexNorTan>> tile_vertices;
+                vector<vector<uint32_t>> tile_indices;
+                vector<Vector3> tile_offsets;
+                geometry_processing::split_surface_into_tiles(m_vertices, m_indices, tile_count, tile_vertices, tile_indices, tile_offsets);
+
+                placement::triangle_data.clear();
+                for (uint32_t tile_index = 0; tile_index < tile_total; tile_index++)
+                {
+                    placement::compute_triangle_data(tile_vertices, tile_indices, tile_index);
+                }
+
+                cache::save(cache::Stage::Placement, key_placement, [tile_total](ofstream& file)
+                {
+                    for (uint32_t tile_index = 0; tile_index < tile_total; tile_index++)
+                    {
+                        cache::write_vector(file, placement::triangle_data[tile_index]);
+                    }
+                });
+            }
+            progress.JobDone();
         }
 
+        // prop transforms are cached under the key of the last stage
+        m_cache_key = key_placement;
+
         // bake terrain into a texture
         {
             vector<RHI_Texture_Slice> data(1);
@@ -1434,58 +1681,456 @@ namespace spartan
         m_triangle_count = m_index_count / 3;
         m_area_km2       = compute_surface_area_km2(m_vertices, m_indices);
 
-        // 9. create an entity for each tile and create a single gpu-buffer (for now)
+        // 9. create an entity for each tile and the quadtree that streams the surface
         {
-            ProgressTracker::GetProgress(ProgressType::Terrain).SetText("creating gpu mesh...");
-            m_mesh = make_shared<Mesh>();
-            m_mesh->SetObjectName("terrain_mesh");
-            m_mesh->SetFlag(static_cast<uint32_t>(MeshFlags::PostProcessOptimize), false);            // meshes are build to spec, so don't mesh with them
-            m_mesh->SetFlag(static_cast<uint32_t>(MeshFlags::PostProcessPreserveTerrainEdges), true); // preserve edges when generating lods, to ensure the tiles meet each other
+            progress.SetText("creating terrain quadtree...");
 
-            for (uint32_t tile_index = 0; tile_index < static_cast<uint32_t>(m_tile_vertices.size()); tile_index++)
+            // tiles anchor props and collision, the surface itself is drawn by the chunks of the quadtree
+            for (uint32_t tile_index = 0; tile_index < static_cast<uint32_t>(m_tile_offsets.size()); tile_index++)
             {
-                uint32_t sub_mesh_index = 0;
-                m_mesh->AddGeometry(m_tile_vertices[tile_index], m_tile_indices[tile_index], true, &sub_mesh_index);
                 Entity* entity = World::CreateEntity();
                 entity->SetObjectName("tile_" + to_string(tile_index + 1)); // +1 so it makes more sense in the editor
                 entity->SetParent(GetEntity());
                 entity->SetPosition(m_tile_offsets[tile_index]);
+            }
+
+            // all chunks draw their own vertices with the same indices
+            if (!m_mesh)
+            {
+                vector<RHI_Vertex_PosTexNorTan> vertices(TerrainQuadtree::GetChunkVertexCount());
+                vector<uint32_t> indices;
+                TerrainQuadtree::GetChunkIndices(indices);
+
+                m_mesh = make_shared<Mesh>();
+                m_mesh->SetObjectName("terrain_chunk");
+                m_mesh->SetFlag(static_cast<uint32_t>(MeshFlags::PostProcessOptimize), false);      // the vertex order is what the chunks are written against
+                m_mesh->SetFlag(static_cast<uint32_t>(MeshFlags::PostProcessBuildClusters), false); // chunks are culled as a whole
+                m_mesh->AddGeometry(vertices, indices, false);
+                m_mesh->CreateGpuBuffers();
+            }
 
-                if (Renderable* renderable = entity->AddComponent<Renderable>())
+            // chunks are kept out of the terrain's children, which are expected to be the tiles, and they are
+            // transient since they are rebuilt with the terrain, so they are never saved or streamed out
+            m_chunk_root = World::CreateEntity();
+            m_chunk_root->SetObjectName("terrain_chunks");
+            m_chunk_root->SetTransient(true);
+            m_chunk_root->SetPosition(GetEntity()->GetPosition());
+            m_chunk_root->SetRotation(GetEntity()->GetRotation());
+            m_chunk_root->SetScale(GetEntity()->GetScale());
+
+            lock_guard lock(m_quadtree_mutex);
+            m_quadtree->SetChunkCallbacks(
+                [this](TerrainChunk& chunk, const vector<RHI_Vertex_PosTexNorTan>& vertices)
                 {
-                    renderable->SetMesh(m_mesh.get(), sub_mesh_index);
+                    chunk.allocation = GeometryPool::Allocate(GeometryPoolType::Vertex, static_cast<uint32_t>(vertices.size()), vertices.data());
+                    if (!chunk.allocation)
+                        return;
+
+                    chunk.entity = World::CreateEntity();
+                    chunk.entity->SetObjectName("chunk_" + to_string(chunk.level) + "_" + to_string(chunk.x) + "_" + to_string(chunk.z));
+                    chunk.entity->SetParent(m_chunk_root);
+                    chunk.entity->SetPositionLocal(chunk.origin);
+                    chunk.entity->SetActive(false); // until it's selected
+
+                    Renderable* renderable = chunk.entity->AddComponent<Renderable>();
+                    renderable->SetMesh(m_mesh.get());
+                    renderable->SetVertexOverride(chunk.allocation, shared_ptr<const vector<RHI_Vertex_PosTexNorTan>>(chunk.geometry, &chunk.geometry->vertices)); // chunks never change once placed
+                    renderable->SetBoundingBoxMesh(BoundingBox(chunk.bounding_box.GetMin() - chunk.origin, chunk.bounding_box.GetMax() - chunk.origin));
                     renderable->SetMaterial(m_material);
+                },
+                [](TerrainChunk& chunk)
+                {
+                    if (chunk.entity)
+                    {
+                        World::RemoveEntity(chunk.entity);
+                    }
+                    GeometryPool::Free(chunk.allocation);
+                    chunk.entity     = nullptr;
+                    chunk.allocation = nullptr;
+                },
+                [](TerrainChunk& chunk)
+                {
+                    if (chunk.entity)
+                    {
+                        chunk.entity->SetActive(chunk.selected);
+                    }
                 }
-            }
-    
-            m_mesh->CreateGpuBuffers();
-            ProgressTracker::GetProgress(ProgressType::Terrain).JobDone();
+            );
+            m_quadtree->Initialize(&m_positions, m_dense_width, m_dense_height);
+
+            progress.JobDone();
         }
     
         // clear everything but height and placement data
         m_vertices.clear();
         m_indices.clear();
-        m_tile_vertices.clear();
-        m_tile_indices.clear();
 
         m_is_generating = false;
     }
 
-    void Terrain::Clear()
+    bool Terrain::TestErosion()
     {
-        m_vertices.clear();
-        m_indices.clear();
-        m_tile_vertices.clear();
-        m_tile_indices.clear();
-        ResourceCache::Remove(m_mesh);
-        m_mesh = nullptr;
+        const uint32_t size          = 512;
+        const uint32_t droplet_count = 50'000;
+        const uint32_t wind_interval = 10'000;
+
+        // a noise height field, with slopes for the droplets to run down
+        NoiseParameters noise_parameters;
+        noise_parameters.seed      = 7;
+        noise_parameters.frequency = 0.01f;
+        vector<float> heights(size * size);
+        Noise(noise_parameters).SampleGrid(heights.data(), size, size);
+
+        vector<Vector3> source(size * size);
+        for (uint32_t i = 0; i < size * size; i++)
+        {
+            source[i] = Vector3(static_cast<float>(i % size), heights[i] * 40.0f, static_cast<float>(i / size));
+        }
+
+        auto erode = [&source](const uint32_t seed, const uint32_t worker_count, double* duration_ms) -> uint64_t
+        {
+            vector<Vector3> positions = source;
+            Stopwatch timer;
+            apply_erosion(positions, size, size, seed, droplet_count, wind_interval, worker_count);
+            if (duration_ms)
+            {
+                *duration_ms = timer.GetElapsedTimeMs();
+            }
+
+            return hash_bytes(positions.data(), positions.size() * sizeof(Vector3));
+        };
+
+        bool passed              = true;
+        double duration_serial   = 0.0;
+        double duration_parallel = 0.0;
+        const uint64_t reference = erode(1, 1, &duration_serial);
+        for (const uint32_t worker_count : { 4u, 16u })
+        {
+            if (erode(1, worker_count, nullptr) != reference)
+            {
+                SP_LOG_ERROR("Erosion with %u workers differs from erosion with one", worker_count);
+                passed = false;
+            }
+        }
+
+        if (erode(1, 0, &duration_parallel) != reference)
+        {
+            SP_LOG_ERROR("Erosion with all of the threads differs from erosion with one");
+            passed = false;
+        }
+
+        if (reference == hash_bytes(source.data(), source.size() * sizeof(Vector3)) || erode(2, 0, nullptr) == reference)
+        {
+            SP_LOG_ERROR("Erosion doesn't depend on the seed, or doesn't change the height field");
+            passed = false;
+        }
+
+        // speedup, only meaningful with more than one thread
+        const uint32_t thread_count = ThreadPool::GetThreadCount();
+        const double speedup        = duration_serial / max(duration_parallel, 1e-3);
+        SP_LOG_INFO("Erosion of %ux%u with %u droplets: 1 thread %.1f ms, %u threads %.1f ms (%.1fx)",
+            size, size, droplet_count, duration_serial, thread_count, duration_parallel, speedup);
+        if (thread_count > 1 && speedup < 1.0)
+        {
+            SP_LOG_ERROR("Erosion on %u threads is slower than on one", thread_count);
+            passed = false;
+        }
+
+        return passed;
+    }
+
+    bool Terrain::TestPropPlacement()
+    {
+        const uint32_t size = 128;
+
+        // a tile of noise hills, from below the sea to above the snow, so that the height and slope filters reject some triangles
+        NoiseParameters noise_parameters;
+        noise_parameters.seed      = 11;
+        noise_parameters.frequency = 0.03f;
+        vector<float> heights(size * size);
+        Noise(noise_parameters).SampleGrid(heights.data(), size, size);
+
+        vector<vector<RHI_Vertex_PosTexNorTan>> vertices(1);
+        vector<vector<uint32_t>> indices(1);
+        for (uint32_t i = 0; i < size * size; i++)
+        {
+            const Vector3 position(static_cast<float>(i % size) * 4.0f, heights[i] * 500.0f, static_cast<float>(i / size) * 4.0f);
+            vertices[0].emplace_back(position, Vector2::Zero);
+        }
+        for (uint32_t z = 0; z < size - 1; z++)
+        {
+            for (uint32_t x = 0; x < size - 1; x++)
+            {
+                const uint32_t i = z * size + x;
+                indices[0].insert(indices[0].end(), { i, i + size, i + 1, i + 1, i + size, i + size + 1 });
+            }
+        }
+
+        // the placement data of a loaded world is put aside, so the test tile can be tile 0
+        unordered_map<uint64_t, vector<placement::TriangleData>> triangle_data_world;
+        triangle_data_world.swap(placement::triangle_data);
+        placement::compute_triangle_data(vertices, indices, 0);
+
+        // scattered like trees and grass, clustered like flowers, and scaled by slope like rocks
+        TerrainPropDescription scattered;
+        scattered.max_slope_angle_rad = 45.0f * math::deg_to_rad;
+        scattered.min_spawn_height    = parameters::level_sea + 5.0f;
+        scattered.max_spawn_height    = parameters::level_snow;
+
+        TerrainPropDescription clustered = scattered;
+        clustered.instances_per_cluster  = 100;
+        clustered.cluster_radius         = 30.0f;
+
+        TerrainPropDescription sloped = scattered;
+        sloped.min_spawn_height       = parameters::level_sea - 10.0f;
+        sloped.max_spawn_height       = numeric_limits<float>::max();
+        sloped.min_scale              = 0.1f;
+        sloped.scale_adjust_by_slope  = true;
+
+        auto place = [](const TerrainPropDescription& description, const uint32_t seed, const uint32_t worker_count, size_t* count) -> uint64_t
+        {
+            vector<Matrix> transforms;
+            placement::find_transforms(description, 0.5f, 0, seed, transforms, worker_count);
+            if (count)
+            {
+                *count = transforms.size();
+            }
+
+            return hash_bytes(transforms.data(), transforms.size() * sizeof(Matrix));
+        };
+
+        bool passed = true;
+        for (const auto& [name, description] : { pair{ "scattered", scattered }, pair{ "clustered", clustered }, pair{ "sloped", sloped } })
+        {
+            size_t count             = 0;
+            const uint64_t reference = place(description, 1, 1, &count);
+            if (count == 0)
+            {
+                SP_LOG_ERROR("Placement of %s props found no triangles", name);
+                passed = false;
+                continue;
+            }
+
+            // again on one thread, then on 4, 16 and all of them
+            for (const uint32_t worker_count : { 1u, 4u, 16u, 0u })
+            {
+                if (place(description, 1, worker_count, nullptr) != reference)
+                {
+                    SP_LOG_ERROR("Placement of %s props with %u workers differs from placement with one", name, worker_count);
+                    passed = false;
+                }
+            }
+
+            if (place(description, 2, 0, nullptr) == reference)
+            {
+                SP_LOG_ERROR("Placement of %s props doesn't depend on the seed", name);
+                passed = false;
+            }
+        }
+
+        placement::triangle_data.swap(triangle_data_world);
+
+        return passed;
+    }
 
-        for (Entity* child : m_entity_ptr->GetChildren())
+    bool Terrain::TestCache()
+    {
+        vector<byte> height_map(64 * 64);
+        for (size_t i = 0; i < height_map.size(); i++)
+        {
+            height_map[i] = static_cast<byte>(i * 7);
+        }
+
+        cache::Inputs inputs;
+        inputs.height_map       = &height_map;
+        inputs.width            = 64;
+        inputs.height           = 64;
+        inputs.channel_count    = 1;
+        inputs.bits_per_channel = 8;
+        inputs.min_y            = -64.0f;
+        inputs.max_y            = 256.0f;
+        inputs.seed             = 1;
+        inputs.tile_count       = 16;
+
+        // the props of a single prop type in a single tile
+        struct PropInputs
+        {
+            uint32_t seed          = 5;
+            float density_fraction = 0.5f;
+            float scale            = 1.0f;
+        };
+
+        const size_t stage_count = static_cast<size_t>(cache::Stage::Max);
+        auto compute_keys = [](const cache::Inputs& inputs, const PropInputs& props)
+        {
+            array<uint64_t, stage_count> keys = {};
+            const auto keys_terrain           = cache::compute_keys(inputs);
+            copy(keys_terrain.begin(), keys_terrain.end(), keys.begin());
+            keys[static_cast<size_t>(cache::Stage::Props)] = cache::compute_props_key(keys_terrain.back(), props.seed, props.density_fraction, props.scale);
+            return keys;
+        };
+
+        // an entry for every stage, which holds the stage it belongs to
+        const PropInputs props;
+        const auto keys = compute_keys(inputs, props);
+        for (uint32_t stage = 0; stage < stage_count; stage++)
+        {
+            cache::save(static_cast<cache::Stage>(stage), keys[stage], [stage](ofstream& file) { cache::write_vector(file, vector<uint32_t>{ stage }); });
+        }
+
+        // a change hits the cache for the stages before the one it's an input of, and misses from there on
+        bool passed = true;
+        auto check = [&passed, &compute_keys, &keys](const char* name, const cache::Stage first_stale, const cache::Inputs& inputs, const PropInputs& props)
+        {
+            const auto keys_changed = compute_keys(inputs, props);
+            for (uint32_t stage = 0; stage < stage_count; stage++)
+            {
+                vector<uint32_t> payload;
+                const bool stale = stage >= static_cast<uint32_t>(first_stale);
+                const bool hit   = cache::load(static_cast<cache::Stage>(stage), keys_changed[stage], [&payload](ifstream& file, uint64_t file_size)
+                {
+                    return cache::read_vector(file, payload, file_size);
+                });
+
+                if (hit == stale || (keys_changed[stage] == keys[stage]) == stale || (hit && payload != vector<uint32_t>{ stage }))
+                {
+                    SP_LOG_ERROR("Changing the %s %s the %s stage", name, stale ? "reuses" : "invalidates", cache::stage_names[stage]);
+                    passed = false;
+                }
+            }
+        };
+
+        check("nothing", cache::Stage::Max, inputs, props);
+        {
+            vector<byte> height_map_changed = height_map;
+            height_map_changed[100]        ^= byte{ 1 };
+            cache::Inputs changed           = inputs;
+            changed.height_map              = &height_map_changed;
+            check("height map", cache::Stage::Height, changed, props);
+        }
+        {
+            cache::Inputs changed = inputs;
+            changed.max_y         = 512.0f;
+            check("height range", cache::Stage::Height, changed, props);
+        }
+        {
+            cache::Inputs changed = inputs;
+            changed.seed          = 2;
+            check("seed", cache::Stage::Positions, changed, props);
+        }
+        {
+            cache::Inputs changed = inputs;
+            changed.tile_count    = 8;
+            check("tile count", cache::Stage::Placement, changed, props);
+        }
+        {
+            PropInputs changed       = props;
+            changed.density_fraction = 0.25f;
+            check("prop density", cache::Stage::Props, inputs, changed);
+        }
+
+        for (uint32_t stage = 0; stage < stage_count; stage++)
+        {
+            FileSystem::Delete(cache::get_file_path(static_cast<cache::Stage>(stage), keys[stage]));
+        }
+
+        return passed;
+    }
+
+    void Terrain::BenchmarkNormals(const uint32_t size)
+    {
+        // a unit spaced grid with rolling hills
+        vector<RHI_Vertex_PosTexNorTan> vertices(static_cast<size_t>(size) * size);
+        for (uint32_t z = 0; z < size; z++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const float height = 20.0f * sin(static_cast<float>(x) * 0.05f) * cos(static_cast<float>(z) * 0.03f);
+                const float u      = static_cast<float>(x) / static_cast<float>(size - 1);
+                const float v      = static_cast<float>(z) / static_cast<float>(size - 1);
+                vertices[z * size + x] = RHI_Vertex_PosTexNorTan(Vector3(static_cast<float>(x), height, static_cast<float>(z)), Vector2(u, v));
+            }
+        }
+        vector<RHI_Vertex_PosTexNorTan> reference = vertices;
+
+        // the previous implementation, height gradients per vertex and a tangent projected from +x
+        Stopwatch timer;
+        ThreadPool::ParallelLoop([&reference, size](uint32_t start, uint32_t end)
+        {
+            for (uint32_t index = start; index < end; index++)
+            {
+                const uint32_t i = index % size;
+                const uint32_t j = index / size;
+
+                const float h_left   = reference[j * size + (i == 0 ? i : i - 1)].pos[1];
+                const float h_right  = reference[j * size + (i == size - 1 ? i : i + 1)].pos[1];
+                const float h_bottom = reference[(j == 0 ? j : j - 1) * size + i].pos[1];
+                const float h_top    = reference[(j == size - 1 ? j : j + 1) * size + i].pos[1];
+                const float dh_dx    = (h_right - h_left) / (i == 0 || i == size - 1 ? 1.0f : 2.0f);
+                const float dh_dz    = (h_top - h_bottom) / (j == 0 || j == size - 1 ? 1.0f : 2.0f);
+
+                const Vector3 normal = Vector3(-dh_dx, 1.0f, -dh_dz).Normalized();
+                Vector3 tangent      = Vector3(1.0f, 0.0f, 0.0f);
+                tangent              = (tangent - normal * Vector3::Dot(normal, tangent)).Normalized();
+
+                reference[index].nor[0] = normal.x;
+                reference[index].nor[1] = normal.y;
+                reference[index].nor[2] = normal.z;
+                reference[index].tan[0] = tangent.x;
+                reference[index].tan[1] = tangent.y;
+                reference[index].tan[2] = tangent.z;
+            }
+        }, static_cast<uint32_t>(reference.size()));
+        const double reference_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+
+        // the grid gather
+        timer.Start();
+        geometry_processing::compute_grid_normals_and_tangents(vertices.data(), size, size);
+        const double grid_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+
+        // the triangle list scatter, on the same grid
+        vector<RHI_Vertex_PosTexNorTan> vertices_list = vertices;
+        vector<uint32_t> indices;
+        indices.reserve(static_cast<size_t>(size - 1) * (size - 1) * 6);
+        for (uint32_t z = 0; z + 1 < size; z++)
         {
-            if (Renderable* renderable = child->AddComponent<Renderable>())
+            for (uint32_t x = 0; x + 1 < size; x++)
             {
-                renderable->SetMesh(nullptr);
+                const uint32_t i = z * size + x;
+                indices.insert(indices.end(), { i, i + size, i + 1, i + 1, i + size, i + size + 1 });
             }
         }
+        timer.Start();
+        geometry_processing::compute_normals_and_tangents(vertices_list, indices, true);
+        const double list_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+
+        float difference_grid = 0.0f;
+        float difference_list = 0.0f;
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                difference_grid = max(difference_grid, abs(vertices[i].nor[axis] - reference[i].nor[axis]));
+                difference_list = max(difference_list, abs(vertices_list[i].nor[axis] - vertices[i].nor[axis]));
+            }
+        }
+
+        SP_LOG_INFO("Terrain normals %ux%u: previous %.1f ms, grid gather %.1f ms (%.1fx, max normal difference %g), triangle list %.1f ms (max difference to the grid %g)",
+            size, size, reference_ms, grid_ms, reference_ms / grid_ms, difference_grid, list_ms, difference_list);
+    }
+
+    void Terrain::Clear()
+    {
+        // the chunks read the positions, so they go first
+        lock_guard lock(m_quadtree_mutex);
+        m_quadtree->Shutdown();
+        if (m_chunk_root)
+        {
+            World::RemoveEntity(m_chunk_root);
+            m_chunk_root = nullptr;
+        }
+
+        m_vertices.clear();
+        m_indices.clear();
     }
 }
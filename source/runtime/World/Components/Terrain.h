@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES =========================
 #include "Component.h"
 #include <atomic>
+#include <mutex>
 #include "../../RHI/RHI_Definitions.h"
 //====================================
 
@@ -31,6 +32,7 @@ namespace spartan
 {
     class Mesh;
     class Material;
+    class TerrainQuadtree;
     namespace math
     {
         class Vector3;
@@ -45,6 +47,28 @@ namespace spartan
         Max
     };
 
+    // surfaces that terrain collision can tell apart, each one gets its own physics material
+    enum class TerrainSurface : uint8_t
+    {
+        Grass,
+        Sand,
+        Rock,
+        Snow,
+        Max
+    };
+
+    // height samples of a tile on a regular grid, relative to the tile, this is what height field collision is built from
+    struct TerrainTileHeights
+    {
+        uint32_t count_x = 0;
+        uint32_t count_z = 0;
+        float spacing_x  = 0.0f;
+        float spacing_z  = 0.0f;
+        math::Vector3 origin;                 // position of the first sample on the xz plane
+        std::vector<float> heights;           // count_x * count_z, x varies fastest
+        std::vector<TerrainSurface> surfaces; // one per sample, empty unless the terrain has collision surfaces enabled
+    };
+
     struct TerrainPropDescription
     {
         bool  align_to_surface_normal  = true;                     // if true, aligns the prop rotation to the terrain surface normal
@@ -65,6 +89,9 @@ namespace spartan
         Terrain(Entity* entity);
         ~Terrain();
 
+        // icomponent
+        void Tick() override;
+
         RHI_Texture* GetHeightMapSeed() const          { return m_height_map_seed; }
         void SetHeightMapSeed(RHI_Texture* height_map) { m_height_map_seed = height_map;}
         RHI_Texture* GetHeightMapFinal() const         { return m_height_map_final.get(); }
@@ -78,10 +105,29 @@ namespace spartan
         float GetMaxY() const     { return m_max_y; }
         void SetMaxY(float max_z) { m_max_y = max_z; }
 
+        // seed of the procedural steps, the same seed and height map always generate the same terrain
+        uint32_t GetSeed() const          { return m_seed; }
+        void SetSeed(const uint32_t seed) { m_seed = seed; }
+
         float GetArea() const     { return m_area_km2; }
         uint32_t GetDensity() const;
         uint32_t GetScale() const;
 
+        // erodes a small height field with 1, 4, 16 and all of the worker threads, checks that the results are
+        // bit identical, that another seed gives another result and that more threads are faster, returns false on failure
+        static bool TestErosion();
+
+        // places scattered, clustered and slope scaled props on a small tile, checks that the transforms are bit identical
+        // across runs and with 1, 4, 16 and all of the worker threads, and that another seed places them elsewhere
+        static bool TestPropPlacement();
+
+        // changes the inputs of each generation stage in turn, checks that the stage and the ones after it miss
+        // the cache while the ones before it still hit it, returns false on failure
+        static bool TestCache();
+
+        // times the grid and triangle list normal generation against the previous per vertex gradients
+        static void BenchmarkNormals(uint32_t size = 2049);
+
         // generate
         void Generate();
         void FindTransforms(
@@ -93,26 +139,34 @@ namespace spartan
             std::vector<math::Matrix>& transforms_out
         );
 
-        // io
-        void SaveToFile(const char* file_path);
-        void LoadFromFile(const char* file_path);
-
         uint32_t GetVertexCount() const         { return m_vertex_count; }
         uint32_t GetIndexCount() const          { return m_index_count; }
         uint64_t GetHeightSampleCount() const   { return m_height_samples; }
         float* GetHeightData()                  { return !m_height_data.empty() ? &m_height_data[0] : nullptr; }
         std::shared_ptr<Material> GetMaterial() { return m_material; }
+        TerrainQuadtree* GetQuadtree() const    { return m_quadtree.get(); }
+
+        // full resolution geometry and height samples of a tile, relative to it, tiles have no mesh of their own so this is what collision is built from
+        void GetTileGeometry(Entity* tile, std::vector<uint32_t>* indices, std::vector<RHI_Vertex_PosTexNorTan>* vertices) const;
+        bool GetTileHeights(Entity* tile, TerrainTileHeights& heights) const;
+
+        // per sample surfaces for height field collision, so that snow can be more slippery than grass
+        bool GetCollisionSurfaces() const             { return m_collision_surfaces; }
+        void SetCollisionSurfaces(const bool enabled) { m_collision_surfaces = enabled; }
  
     private:
         void Clear();
+        bool GetTileSampleRange(Entity* tile, uint32_t& x_begin, uint32_t& x_end, uint32_t& z_begin, uint32_t& z_end, math::Vector3& offset) const;
 
         // textures
         RHI_Texture* m_height_map_seed                  = nullptr;
         std::shared_ptr<RHI_Texture> m_height_map_final = nullptr;
 
         // properties
-        float m_min_y = -64.0f;
-        float m_max_y = 256.0;
+        float m_min_y             = -64.0f;
+        float m_max_y             = 256.0;
+        uint32_t m_seed           = 0;
+        bool m_collision_surfaces = false;
 
         // members
         uint32_t m_width                  = 0;
@@ -125,15 +179,17 @@ namespace spartan
         uint32_t m_triangle_count         = 0;
     
         std::vector<float> m_height_data;
-        std::vector<std::vector<RHI_Vertex_PosTexNorTan>> m_tile_vertices;
         std::vector<RHI_Vertex_PosTexNorTan> m_vertices;
         std::vector<uint32_t> m_indices;
-        std::vector<std::vector<uint32_t>> m_tile_indices;
-        std::shared_ptr<Mesh> m_mesh;
+        std::shared_ptr<Mesh> m_mesh; // index topology shared by all chunks of the quadtree
         std::shared_ptr<Material> m_material;
+        std::unique_ptr<TerrainQuadtree> m_quadtree;
+        std::mutex m_quadtree_mutex; // generation runs on a worker thread while the main thread ticks
+        Entity* m_chunk_root = nullptr;
         std::vector<math::Vector3> m_tile_offsets;
         std::vector<math::Vector3> m_positions;
         uint32_t m_dense_width  = 0;
         uint32_t m_dense_height = 0;
+        uint64_t m_cache_key    = 0;
     };
 }
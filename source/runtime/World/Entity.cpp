@@ -22,11 +22,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ======================
 #include "pch.h"
 #include "Entity.h"
+#include "Prefab.h"
 #include "Components/Camera.h"
 #include "Components/Light.h"
 #include "Components/Physics.h"
 #include "Components/AudioSource.h"
 #include "Components/Terrain.h"
+#include "Components/Renderable.h"
+#include "Components/Animator.h"
 SP_WARNINGS_OFF
 #include "../IO/pugixml.hpp"
 SP_WARNINGS_ON
@@ -41,47 +44,21 @@ namespace spartan
 {
     namespace
     {
-        // input is an entity, output is a clone of that entity (descendant entities are not cloned)
-        Entity* clone_entity(Entity* entity)
+        // returns a component to the pool of its type
+        void destroy_component(Component* component)
         {
-            // clone basic properties
-            Entity* clone = World::CreateEntity();
-            clone->SetObjectName(entity->GetObjectName());
-            clone->SetActive(entity->GetActive());
-            clone->SetPosition(entity->GetPositionLocal());
-            clone->SetRotation(entity->GetRotationLocal());
-            clone->SetScale(entity->GetScaleLocal());
-
-            // clone all the components
-            for (shared_ptr<Component> component_original : entity->GetAllComponents())
-            {
-                if (component_original != nullptr)
-                {
-                    // component
-                    Component* component_clone = clone->AddComponent(component_original->GetType());
-
-                    // component's properties
-                    component_clone->SetAttributes(component_original->GetAttributes());
-                }
-            }
-
-            return clone;
-        };
-
-        // input is an entity, output is a clone of that entity (descendant entities are cloned)
-        Entity* clone_entity_and_descendants(Entity* entity)
-        {
-            Entity* clone_self = clone_entity(entity);
-
-            // clone children make them call this lambda
-            for (Entity* child_transform : entity->GetChildren())
+            switch (component->GetType())
             {
-                Entity* clone_child = clone_entity_and_descendants(child_transform);
-                clone_child->SetParent(clone_self);
+                case ComponentType::AudioSource: ComponentPool<AudioSource>::Get().Destroy(static_cast<AudioSource*>(component)); break;
+                case ComponentType::Camera:      ComponentPool<Camera>::Get().Destroy(static_cast<Camera*>(component));           break;
+                case ComponentType::Light:       ComponentPool<Light>::Get().Destroy(static_cast<Light*>(component));             break;
+                case ComponentType::Renderable:  ComponentPool<Renderable>::Get().Destroy(static_cast<Renderable*>(component));   break;
+                case ComponentType::Physics:     ComponentPool<Physics>::Get().Destroy(static_cast<Physics*>(component));         break;
+                case ComponentType::Terrain:     ComponentPool<Terrain>::Get().Destroy(static_cast<Terrain*>(component));         break;
+                case ComponentType::Animator:    ComponentPool<Animator>::Get().Destroy(static_cast<Animator*>(component));       break;
+                default:                         SP_ASSERT_MSG(false, "Unknown component type");                                  break;
             }
-
-            return clone_self;
-        };
+        }
     }
 
     Entity::Entity()
@@ -94,7 +71,7 @@ namespace spartan
 
     Entity::~Entity()
     {
-        m_components.fill(nullptr);
+        RemoveAllComponents();
 
         // if this entity is selected, deselect it
         if (Camera* camera = World::GetCamera())
@@ -111,12 +88,12 @@ namespace spartan
 
     Entity* Entity::Clone()
     {
-        return clone_entity_and_descendants(this);
+        return Prefab(this).Instantiate();
     }
 
     void Entity::Start()
     {
-        for (shared_ptr<Component> component : m_components)
+        for (Component* component : m_components)
         {
             if (component)
             {
@@ -127,7 +104,7 @@ namespace spartan
 
     void Entity::Stop()
     {
-        for (shared_ptr<Component> component : m_components)
+        for (Component* component : m_components)
         {
             if (component)
             {
@@ -138,7 +115,7 @@ namespace spartan
 
     void Entity::PreTick()
     {
-        for (shared_ptr<Component>& component : m_components)
+        for (Component* component : m_components)
         {
             if (component)
             {
@@ -149,7 +126,7 @@ namespace spartan
 
     void Entity::Tick()
     {
-        for (shared_ptr<Component>& component : m_components)
+        for (Component* component : m_components)
         {
             if (component)
             {
@@ -187,7 +164,7 @@ namespace spartan
             }
 
             // components
-            for (shared_ptr<Component>& component : m_components)
+            for (Component* component : m_components)
             {
                 if (component)
                 {
@@ -201,6 +178,9 @@ namespace spartan
         // children
         for (Entity* child : m_children)
         {
+            if (child->IsTransient())
+                continue;
+
             pugi::xml_node child_node = node.append_child("Entity");
             child->Save(child_node);
         }
@@ -277,6 +257,7 @@ namespace spartan
             return;
 
         m_is_active = active;
+        MarkDirty();
     }
     
     Component* Entity::AddComponent(const ComponentType type)
@@ -291,6 +272,7 @@ namespace spartan
             case ComponentType::Renderable:  component = static_cast<Component*>(AddComponent<Renderable>());  break;
             case ComponentType::Physics:     component = static_cast<Component*>(AddComponent<Physics>());     break;
             case ComponentType::Terrain:     component = static_cast<Component*>(AddComponent<Terrain>());     break;
+            case ComponentType::Animator:    component = static_cast<Component*>(AddComponent<Animator>());    break;
             default:                         component = nullptr;                                              break;
         }
 
@@ -301,24 +283,40 @@ namespace spartan
 
     void Entity::RemoveComponentById(const uint64_t id)
     {
-        for (shared_ptr<Component>& component : m_components)
+        for (Component*& component : m_components)
         {
             if (component)
             {
                 if (id == component->GetObjectId())
                 {
                     component->Remove();
+                    destroy_component(component);
                     component = nullptr;
+                    MarkDirty();
                     break;
                 }
             }
         }
+
+        World::Resolve();
+    }
+
+    void Entity::RemoveAllComponents()
+    {
+        for (Component*& component : m_components)
+        {
+            if (component)
+            {
+                destroy_component(component);
+                component = nullptr;
+            }
+        }
     }
 
     uint32_t Entity::GetComponentCount() const
     {
         uint32_t count = 0;
-        for (const shared_ptr<Component>& component : m_components)
+        for (const Component* component : m_components)
         {
             if (component)
             {
@@ -381,6 +379,7 @@ namespace spartan
             return;
 
         m_position_local = position;
+        MarkDirty();
         UpdateTransform();
     }
 
@@ -398,6 +397,7 @@ namespace spartan
             return;
 
         m_rotation_local = rotation;
+        MarkDirty();
         UpdateTransform();
     }
 
@@ -421,6 +421,16 @@ namespace spartan
         m_scale_local.y = (m_scale_local.y == 0.0f) ? numeric_limits<float>::min() : m_scale_local.y;
         m_scale_local.z = (m_scale_local.z == 0.0f) ? numeric_limits<float>::min() : m_scale_local.z;
 
+        MarkDirty();
+        UpdateTransform();
+    }
+
+    void Entity::SetTransformLocal(const Vector3& position, const Quaternion& rotation, const Vector3& scale)
+    {
+        m_position_local = position;
+        m_rotation_local = rotation;
+        m_scale_local    = scale;
+        MarkDirty();
         UpdateTransform();
     }
 
@@ -469,8 +479,6 @@ namespace spartan
 
     void Entity::SetParent(Entity* new_parent)
     {
-        lock_guard lock(m_mutex_parent);
-
         if (new_parent)
         {
             // early exit if the parent is this entity
@@ -508,13 +516,13 @@ namespace spartan
         }
 
         m_parent = new_parent;
+        MarkDirty();
         UpdateTransform();
     }
 
     void Entity::AddChild(Entity* child)
     {
         SP_ASSERT(child != nullptr);
-        lock_guard lock(m_mutex_children);
 
         // ensure that the child is not this transform
         if (child->GetObjectId() == GetObjectId())
@@ -524,6 +532,7 @@ namespace spartan
         if (!(find(m_children.begin(), m_children.end(), child) != m_children.end()))
         {
             m_children.emplace_back(child);
+            MarkDirty();
         }
     }
 
@@ -535,10 +544,9 @@ namespace spartan
         if (child->GetObjectId() == GetObjectId())
             return;
 
-        lock_guard lock(m_mutex_children);
-
         // remove the child
         m_children.erase(remove_if(m_children.begin(), m_children.end(), [child](Entity* vec_transform) { return vec_transform->GetObjectId() == child->GetObjectId(); }), m_children.end());
+        MarkDirty();
 
         // remove the child's parent
         if (update_child_with_null_parent)
@@ -551,7 +559,6 @@ namespace spartan
     // this is a recursive function, the children will also find their own children and so on
     void Entity::AcquireChildren()
     {
-        lock_guard lock(m_mutex_children);
         m_children.clear();
         m_children.shrink_to_fit();
 
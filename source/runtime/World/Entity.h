@@ -24,9 +24,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ====================
 #include <atomic>
 #include <array>
-#include <mutex>
 #include "World.h"
-#include "Components/Component.h"
+#include "Components/ComponentPool.h"
 #include "../Math/Quaternion.h"
 #include "../Math/Matrix.h"
 //===============================
@@ -59,9 +58,23 @@ namespace spartan
         void Load(pugi::xml_node& node);
 
         // active
-        bool GetActive();
+        bool GetActive();                                   // false if the entity or any of its ancestors is inactive
+        bool GetActiveLocal() const { return m_is_active; } // the entity's own flag, as saved
         void SetActive(const bool active);
 
+        // transient entities are rebuilt at runtime by whoever created them, so they are never saved or streamed
+        bool IsTransient() const                { return m_is_transient; }
+        void SetTransient(const bool transient) { m_is_transient = transient; }
+
+        // set by the world once it registers the entity, and cleared as soon as the entity is queued for removal
+        bool IsInWorld() const               { return m_in_world; }
+        void SetInWorld(const bool in_world) { m_in_world = in_world; }
+
+        // bumped by every change to what the entity saves, so streaming can skip re-serializing unchanged entities
+        // note: component setters don't bump it, changes made through component attributes or the editor do
+        uint64_t GetRevision() const { return m_revision; }
+        void MarkDirty()             { m_revision++; }
+
         // adds a component of type T
         template <class T>
         T* AddComponent()
@@ -72,17 +85,18 @@ namespace spartan
             if (T* component = GetComponent<T>())
                 return component;
 
-            // create a new component
-            std::shared_ptr<T> component = std::make_shared<T>(this);
+            // create a new component, the pool of its type owns the memory
+            T* component = ComponentPool<T>::Get().Create(this);
 
             // save new component
-            m_components[static_cast<uint32_t>(type)] = std::static_pointer_cast<Component>(component);
+            m_components[static_cast<uint32_t>(type)] = component;
+            MarkDirty();
 
             // initialize component
             component->SetType(type);
             component->Initialize();
 
-            return component.get();
+            return component;
         }
 
         // adds a component of ComponentType 
@@ -93,7 +107,7 @@ namespace spartan
         T* GetComponent()
         {
             const ComponentType component_type = Component::TypeToEnum<T>();
-            return static_cast<T*>(m_components[static_cast<uint32_t>(component_type)].get());
+            return static_cast<T*>(m_components[static_cast<uint32_t>(component_type)]);
         }
 
         // removes a component
@@ -101,12 +115,19 @@ namespace spartan
         void RemoveComponent()
         {
             const ComponentType component_type = Component::TypeToEnum<T>();
-            m_components[static_cast<uint32_t>(component_type)] = nullptr;
+            if (T* component = GetComponent<T>())
+            {
+                component->Remove();
+                ComponentPool<T>::Get().Destroy(component);
+                m_components[static_cast<uint32_t>(component_type)] = nullptr;
+                MarkDirty();
+            }
 
             World::Resolve();
         }
 
         void RemoveComponentById(uint64_t id);
+        void RemoveAllComponents();
         const auto& GetAllComponents() const { return m_components; }
         uint32_t GetComponentCount() const;
 
@@ -131,6 +152,9 @@ namespace spartan
         void SetScaleLocal(const math::Vector3& scale);
         //========================================================================
 
+        // sets position, rotation and scale with a single transform update
+        void SetTransformLocal(const math::Vector3& position, const math::Quaternion& rotation, const math::Vector3& scale);
+
         //= TRANSLATION/ROTATION ==================
         void Translate(const math::Vector3& delta);
         void Rotate(const math::Quaternion& delta);
@@ -146,6 +170,8 @@ namespace spartan
         //=============================================================
 
         //= HIERARCHY ===================================================================================
+        // note: the hierarchy is not synchronized, entities that are part of the world should be
+        // re-parented on the main thread, other threads can record the change in a WorldCommandBuffer
         void SetParent(Entity* new_parent);
         Entity* GetChildByIndex(uint32_t index);
         Entity* GetChildByName(const std::string& name);
@@ -169,8 +195,11 @@ namespace spartan
         float GetTimeSinceLastTransform() const            { return m_time_since_last_transform_sec; }
 
     private:
-        std::atomic<bool> m_is_active = true;
-        std::array<std::shared_ptr<Component>, static_cast<uint32_t>(ComponentType::Max)> m_components;
+        std::atomic<bool> m_is_active    = true;
+        std::atomic<uint64_t> m_revision = 0;
+        bool m_is_transient              = false;
+        bool m_in_world                  = false;
+        std::array<Component*, static_cast<uint32_t>(ComponentType::Max)> m_components;
 
         void UpdateTransform();
         math::Matrix GetParentTransformMatrix();
@@ -196,8 +225,6 @@ namespace spartan
         std::vector<Entity*> m_children; // the children of this entity
 
         // misc
-        std::mutex m_mutex_children;
-        std::mutex m_mutex_parent;
         float m_time_since_last_transform_sec = 0.0f;
     };
 }
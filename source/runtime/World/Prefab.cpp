@@ -0,0 +1,277 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ======================
+#include "pch.h"
+#include "Prefab.h"
+#include "Entity.h"
+#include "Components/Camera.h"
+#include "Components/Light.h"
+#include "Components/Physics.h"
+#include "Components/AudioSource.h"
+#include "Components/Terrain.h"
+#include "Components/Renderable.h"
+#include "Components/Animator.h"
+#include "../Core/Stopwatch.h"
+//=================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace spartan::math;
+//============================
+
+namespace spartan
+{
+    namespace
+    {
+        // grows the pool of a component type so that a batch doesn't reallocate chunk by chunk
+        void reserve_components(const ComponentType type, const uint32_t count)
+        {
+            switch (type)
+            {
+                case ComponentType::AudioSource: ComponentPool<AudioSource>::Get().Reserve(count); break;
+                case ComponentType::Camera:      ComponentPool<Camera>::Get().Reserve(count);      break;
+                case ComponentType::Light:       ComponentPool<Light>::Get().Reserve(count);       break;
+                case ComponentType::Renderable:  ComponentPool<Renderable>::Get().Reserve(count);  break;
+                case ComponentType::Physics:     ComponentPool<Physics>::Get().Reserve(count);     break;
+                case ComponentType::Terrain:     ComponentPool<Terrain>::Get().Reserve(count);     break;
+                case ComponentType::Animator:    ComponentPool<Animator>::Get().Reserve(count);    break;
+                default:                                                                           break;
+            }
+        }
+
+        // the path prefabs replace, every node and component is created and linked on its own
+        Entity* clone_entity_and_descendants(Entity* entity)
+        {
+            Entity* clone = World::CreateEntity();
+            clone->SetObjectName(entity->GetObjectName());
+            clone->SetActive(entity->GetActiveLocal());
+            clone->SetPosition(entity->GetPositionLocal());
+            clone->SetRotation(entity->GetRotationLocal());
+            clone->SetScale(entity->GetScaleLocal());
+
+            for (Component* component : entity->GetAllComponents())
+            {
+                if (component)
+                {
+                    clone->AddComponent(component->GetType())->SetAttributes(component->GetAttributes());
+                }
+            }
+
+            for (Entity* child : entity->GetChildren())
+            {
+                clone_entity_and_descendants(child)->SetParent(clone);
+            }
+
+            return clone;
+        }
+    }
+
+    void Prefab::Compile(Entity* root)
+    {
+        m_nodes.clear();
+        m_component_counts.fill(0);
+
+        if (!root)
+            return;
+
+        // depth-first, so that every parent is created (and linked) before its children
+        vector<pair<Entity*, int32_t>> stack = { { root, -1 } };
+        while (!stack.empty())
+        {
+            auto [entity, parent] = stack.back();
+            stack.pop_back();
+
+            PrefabNode& node = m_nodes.emplace_back();
+            node.name        = entity->GetObjectName();
+            node.active      = entity->GetActiveLocal();
+            node.parent      = parent;
+            node.position    = entity->GetPositionLocal();
+            node.rotation    = entity->GetRotationLocal();
+            node.scale       = entity->GetScaleLocal();
+
+            for (Component* component : entity->GetAllComponents())
+            {
+                if (!component)
+                    continue;
+
+                PrefabComponent& prefab_component = node.components.emplace_back();
+                prefab_component.type             = component->GetType();
+                prefab_component.attributes.reserve(component->GetAttributes().size());
+                for (const Attribute& attribute : component->GetAttributes())
+                {
+                    prefab_component.attributes.emplace_back(attribute.getter());
+                }
+
+                m_component_counts[static_cast<uint32_t>(prefab_component.type)]++;
+            }
+
+            // push in reverse so children are visited in their original order
+            const int32_t index             = static_cast<int32_t>(m_nodes.size()) - 1;
+            const vector<Entity*>& children = entity->GetChildren();
+            for (auto it = children.rbegin(); it != children.rend(); ++it)
+            {
+                stack.emplace_back(*it, index);
+            }
+        }
+    }
+
+    Entity* Prefab::Instantiate(const Matrix& transform)
+    {
+        vector<Entity*> roots;
+        Instantiate({ transform }, &roots);
+        return roots.empty() ? nullptr : roots.front();
+    }
+
+    void Prefab::Instantiate(const vector<Matrix>& transforms, vector<Entity*>* roots_out)
+    {
+        if (m_nodes.empty() || transforms.empty())
+            return;
+
+        const Stopwatch timer;
+        const uint32_t node_count     = static_cast<uint32_t>(m_nodes.size());
+        const uint32_t instance_count = static_cast<uint32_t>(transforms.size());
+
+        // allocate everything up front
+        vector<Entity*> entities;
+        World::CreateEntities(node_count * instance_count, entities);
+        for (uint32_t type = 0; type < static_cast<uint32_t>(ComponentType::Max); type++)
+        {
+            if (m_component_counts[type] > 0)
+            {
+                reserve_components(static_cast<ComponentType>(type), m_component_counts[type] * instance_count);
+            }
+        }
+
+        if (roots_out)
+        {
+            roots_out->reserve(roots_out->size() + instance_count);
+        }
+
+        for (uint32_t instance = 0; instance < instance_count; instance++)
+        {
+            Entity** instance_entities = &entities[instance * node_count];
+
+            // hierarchy and transforms, parents precede children so each node is linked and transformed once
+            for (uint32_t i = 0; i < node_count; i++)
+            {
+                const PrefabNode& node = m_nodes[i];
+                Entity* entity         = instance_entities[i];
+
+                entity->SetObjectName(node.name);
+                entity->SetActive(node.active);
+
+                if (node.parent < 0)
+                {
+                    const Matrix matrix = Matrix(node.position, node.rotation, node.scale) * transforms[instance];
+                    entity->SetTransformLocal(matrix.GetTranslation(), matrix.GetRotation(), matrix.GetScale());
+
+                    if (roots_out)
+                    {
+                        roots_out->emplace_back(entity);
+                    }
+                }
+                else
+                {
+                    entity->SetParent(instance_entities[node.parent]);
+                    entity->SetTransformLocal(node.position, node.rotation, node.scale);
+                }
+            }
+
+            // components, added after the transforms so that they initialize at their final location
+            for (uint32_t i = 0; i < node_count; i++)
+            {
+                for (const PrefabComponent& prefab_component : m_nodes[i].components)
+                {
+                    Component* component = instance_entities[i]->AddComponent(prefab_component.type);
+                    component->SetAttributeValues(prefab_component.attributes);
+                }
+            }
+        }
+
+        if (instance_count > 1)
+        {
+            SP_LOG_INFO("Instantiated %u copies of a %u node prefab (%u entities) in %.2f ms", instance_count, node_count, node_count * instance_count, timer.GetElapsedTimeMs());
+        }
+    }
+
+    void Prefab::Benchmark(const uint32_t instance_count)
+    {
+        // a tree, three branches of five leaves, and a light under a lamp at the top
+        Entity* root = World::CreateEntity();
+        root->SetObjectName("benchmark_prefab");
+        for (uint32_t branch = 0; branch < 3; branch++)
+        {
+            Entity* branch_entity = World::CreateEntity();
+            branch_entity->SetParent(root);
+            branch_entity->SetPositionLocal(Vector3(static_cast<float>(branch), 1.0f, 0.0f));
+            for (uint32_t leaf = 0; leaf < 5; leaf++)
+            {
+                Entity* leaf_entity = World::CreateEntity();
+                leaf_entity->SetParent(branch_entity);
+                leaf_entity->SetPositionLocal(Vector3(0.0f, static_cast<float>(leaf), 0.0f));
+                leaf_entity->SetActive(leaf != 4); // an inactive node, to carry the local flag
+            }
+        }
+        Entity* lamp  = World::CreateEntity();
+        Entity* light = World::CreateEntity();
+        lamp->SetParent(root);
+        light->SetParent(lamp);
+        light->AddComponent<Light>()->SetLightType(LightType::Point);
+
+        // the prefab and the instance transforms are built once, outside the timings
+        Prefab prefab(root);
+        SP_ASSERT(prefab.GetNodeCount() == 20);
+        vector<Matrix> transforms(instance_count);
+        for (uint32_t i = 0; i < instance_count; i++)
+        {
+            transforms[i] = Matrix::CreateTranslation(Vector3(static_cast<float>(i % 100) * 10.0f, 0.0f, static_cast<float>(i / 100) * 10.0f));
+        }
+
+        // entity by entity, like cloning used to
+        const bool playing = Engine::IsFlagSet(EngineMode::Playing);
+        Stopwatch timer;
+        for (uint32_t i = 0; i < instance_count; i++)
+        {
+            clone_entity_and_descendants(root)->SetPosition(transforms[i].GetTranslation());
+        }
+        const double clone_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+        World::Shutdown();
+
+        // batched
+        timer.Start();
+        prefab.Instantiate(transforms);
+        const double prefab_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6);
+        World::Shutdown();
+        Engine::SetFlag(EngineMode::Playing, playing);
+
+        const double entity_count = static_cast<double>(instance_count) * prefab.GetNodeCount();
+        SP_LOG_INFO("Prefab %u x %u nodes: cloning %.1f ms (%.2f M entities/sec), batched %.1f ms (%.2f M entities/sec), %.1fx",
+            instance_count,
+            prefab.GetNodeCount(),
+            clone_ms,
+            entity_count / clone_ms / 1e3,
+            prefab_ms,
+            entity_count / prefab_ms / 1e3,
+            clone_ms / prefab_ms);
+    }
+}
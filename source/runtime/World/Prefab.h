@@ -0,0 +1,81 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ==========================
+#include <any>
+#include <array>
+#include <vector>
+#include "Components/Component.h"
+#include "../Math/Matrix.h"
+//=====================================
+
+namespace spartan
+{
+    class Entity;
+
+    // a flattened, in-memory template of an entity and its descendants
+    // instantiating it creates entities and components directly, without going through xml
+    class Prefab
+    {
+    public:
+        Prefab() = default;
+        explicit Prefab(Entity* root) { Compile(root); }
+
+        // captures the subtree under root (names, local transforms, components and their attribute values)
+        void Compile(Entity* root);
+
+        // creates one copy, the root's local transform is multiplied by transform
+        Entity* Instantiate(const math::Matrix& transform = math::Matrix::Identity);
+
+        // creates one copy per transform, entities and components are allocated in bulk and registered with the world at once
+        void Instantiate(const std::vector<math::Matrix>& transforms, std::vector<Entity*>* roots_out = nullptr);
+
+        uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_nodes.size()); }
+        bool IsEmpty() const          { return m_nodes.empty(); }
+
+        // spawns copies of a 20 node prefab with lights, entity by entity and batched, and logs both timings
+        static void Benchmark(const uint32_t instance_count = 10000);
+
+    private:
+        struct PrefabComponent
+        {
+            ComponentType type = ComponentType::Max;
+            std::vector<std::any> attributes;
+        };
+
+        struct PrefabNode
+        {
+            std::string name;
+            bool active               = true;
+            int32_t parent            = -1; // index into m_nodes, parents always precede their children
+            math::Vector3 position    = math::Vector3::Zero;
+            math::Quaternion rotation = math::Quaternion::Identity;
+            math::Vector3 scale       = math::Vector3::One;
+            std::vector<PrefabComponent> components;
+        };
+
+        std::vector<PrefabNode> m_nodes;
+        std::array<uint32_t, static_cast<uint32_t>(ComponentType::Max)> m_component_counts = {};
+    };
+}
@@ -0,0 +1,735 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ===================
+#include "pch.h"
+#include "TerrainQuadtree.h"
+#include "../Core/ThreadPool.h"
+#include "../Profiling/Profiler.h"
+#include "../Math/Noise.h"
+//==============================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace spartan::math;
+//============================
+
+namespace spartan
+{
+    namespace
+    {
+        const uint32_t chunk_side            = TerrainQuadtree::chunk_quads + 1; // vertices per side
+        const uint32_t max_pending           = 16;                               // chunks being generated at any time
+        const uint32_t max_finishes_per_tick = 8;                                // bounds the uploads done in a single tick
+
+        // vertex of the grid which lies on the given edge, edges are ordered as bottom, top, left, right
+        uint32_t edge_vertex(const uint32_t edge, const uint32_t k)
+        {
+            const uint32_t n = TerrainQuadtree::chunk_quads;
+            switch (edge)
+            {
+                case 0:  return k;
+                case 1:  return n * chunk_side + k;
+                case 2:  return k * chunk_side;
+                default: return k * chunk_side + n;
+            }
+        }
+
+        void generate_chunk(
+            const vector<Vector3>& positions,
+            const uint32_t width,
+            const uint32_t height,
+            const uint32_t x,
+            const uint32_t z,
+            const uint32_t step,
+            const Vector3& origin,
+            const float skirt_depth,
+            vector<RHI_Vertex_PosTexNorTan>& vertices
+        )
+        {
+            vertices.resize(TerrainQuadtree::GetChunkVertexCount());
+
+            auto height_at = [&positions, width](const uint32_t sample_x, const uint32_t sample_z)
+            {
+                return positions[sample_z * width + sample_x].y;
+            };
+
+            // grid, chunks on the far edges of the height grid clamp to it, which only produces degenerate triangles
+            for (uint32_t j = 0; j < chunk_side; j++)
+            {
+                const uint32_t sample_z = min(z + j * step, height - 1);
+                const uint32_t bottom   = sample_z - min(sample_z, step);
+                const uint32_t top      = min(sample_z + step, height - 1);
+
+                for (uint32_t i = 0; i < chunk_side; i++)
+                {
+                    const uint32_t sample_x = min(x + i * step, width - 1);
+                    const uint32_t left     = sample_x - min(sample_x, step);
+                    const uint32_t right    = min(sample_x + step, width - 1);
+
+                    // gradients in height per sample, the same as the full resolution surface, just measured across the vertices of this level
+                    const float dh_dx = (height_at(right, sample_z) - height_at(left, sample_z)) / static_cast<float>(right - left);
+                    const float dh_dz = (height_at(sample_x, top) - height_at(sample_x, bottom)) / static_cast<float>(top - bottom);
+
+                    Vector3 normal(-dh_dx, 1.0f, -dh_dz);
+                    normal.Normalize();
+
+                    Vector3 tangent(1.0f, 0.0f, 0.0f);
+                    tangent -= normal * Vector3::Dot(normal, tangent);
+                    tangent.Normalize();
+
+                    const Vector2 uv(static_cast<float>(sample_x) / static_cast<float>(width - 1), static_cast<float>(sample_z) / static_cast<float>(height - 1));
+                    vertices[j * chunk_side + i] = RHI_Vertex_PosTexNorTan(positions[sample_z * width + sample_x] - origin, uv, normal, tangent);
+                }
+            }
+
+            // skirts, copies of the edge vertices pushed down
+            uint32_t index = chunk_side * chunk_side;
+            for (uint32_t edge = 0; edge < 4; edge++)
+            {
+                for (uint32_t k = 0; k < chunk_side; k++)
+                {
+                    RHI_Vertex_PosTexNorTan vertex = vertices[edge_vertex(edge, k)];
+                    vertex.pos[1]     -= skirt_depth;
+                    vertices[index++]  = vertex;
+                }
+            }
+        }
+    }
+
+    TerrainQuadtree::~TerrainQuadtree()
+    {
+        Shutdown();
+    }
+
+    uint32_t TerrainQuadtree::GetChunkVertexCount()
+    {
+        return chunk_side * chunk_side + 4 * chunk_side;
+    }
+
+    void TerrainQuadtree::GetChunkIndices(vector<uint32_t>& indices)
+    {
+        indices.clear();
+        indices.reserve(chunk_quads * chunk_quads * 6 + 4 * chunk_quads * 12);
+
+        // grid, same winding as the full resolution surface
+        for (uint32_t j = 0; j < chunk_quads; j++)
+        {
+            for (uint32_t i = 0; i < chunk_quads; i++)
+            {
+                const uint32_t bottom_left  = j * chunk_side + i;
+                const uint32_t bottom_right = bottom_left + 1;
+                const uint32_t top_left     = bottom_left + chunk_side;
+                const uint32_t top_right    = top_left + 1;
+
+                indices.insert(indices.end(), { bottom_right, bottom_left, top_left, bottom_right, top_left, top_right });
+            }
+        }
+
+        // skirts, double sided since they face outwards on two edges and inwards on the other two
+        for (uint32_t edge = 0; edge < 4; edge++)
+        {
+            const uint32_t skirt = chunk_side * chunk_side + edge * chunk_side;
+            for (uint32_t k = 0; k < chunk_quads; k++)
+            {
+                const uint32_t a       = edge_vertex(edge, k);
+                const uint32_t b       = edge_vertex(edge, k + 1);
+                const uint32_t a_skirt = skirt + k;
+                const uint32_t b_skirt = skirt + k + 1;
+
+                indices.insert(indices.end(), { a, b, b_skirt, a, b_skirt, a_skirt });
+                indices.insert(indices.end(), { a, b_skirt, b, a, a_skirt, b_skirt });
+            }
+        }
+    }
+
+    void TerrainQuadtree::Initialize(const vector<Vector3>* positions, const uint32_t width, const uint32_t height)
+    {
+        Shutdown();
+
+        SP_ASSERT(positions && width >= 2 && height >= 2 && positions->size() == static_cast<size_t>(width) * height);
+        m_positions = positions;
+        m_width     = width;
+        m_height    = height;
+
+        // the root is the coarsest level that covers the whole grid with a single chunk
+        uint32_t step = 1;
+        m_level_count = 1;
+        while (chunk_quads * step < max(width, height) - 1)
+        {
+            step *= 2;
+            m_level_count++;
+        }
+        CreateChunk(0, 0, step, m_level_count - 1);
+
+        // bounds of the leaves, from all the samples they cover
+        vector<uint32_t> leaves;
+        for (uint32_t index = 0; index < static_cast<uint32_t>(m_chunks.size()); index++)
+        {
+            if (m_chunks[index].child_count == 0)
+            {
+                leaves.push_back(index);
+            }
+        }
+
+        ThreadPool::ParallelLoop([this, &leaves](uint32_t start, uint32_t end)
+        {
+            for (uint32_t i = start; i < end; i++)
+            {
+                TerrainChunk& chunk   = m_chunks[leaves[i]];
+                const uint32_t x_end  = min(chunk.x + chunk_quads * chunk.step, m_width - 1);
+                const uint32_t z_end  = min(chunk.z + chunk_quads * chunk.step, m_height - 1);
+                Vector3 bound_min     = Vector3::Infinity;
+                Vector3 bound_max     = Vector3::InfinityNeg;
+                for (uint32_t z = chunk.z; z <= z_end; z++)
+                {
+                    for (uint32_t x = chunk.x; x <= x_end; x++)
+                    {
+                        const Vector3& position = (*m_positions)[z * m_width + x];
+                        bound_min               = Vector3::Min(bound_min, position);
+                        bound_max               = Vector3::Max(bound_max, position);
+                    }
+                }
+                chunk.bounding_box = BoundingBox(bound_min, bound_max);
+            }
+        }, static_cast<uint32_t>(leaves.size()));
+
+        // bounds of the parents, children always come after their parent
+        for (uint32_t index = static_cast<uint32_t>(m_chunks.size()); index-- > 0;)
+        {
+            TerrainChunk& chunk = m_chunks[index];
+            if (chunk.child_count == 0)
+                continue;
+
+            chunk.bounding_box = m_chunks[chunk.children[0]].bounding_box;
+            for (uint32_t i = 1; i < chunk.child_count; i++)
+            {
+                chunk.bounding_box.Merge(m_chunks[chunk.children[i]].bounding_box);
+            }
+        }
+
+        // origins and skirts
+        for (TerrainChunk& chunk : m_chunks)
+        {
+            const Vector3& corner = (*m_positions)[chunk.z * m_width + chunk.x];
+            const Vector3 min     = chunk.bounding_box.GetMin();
+            const Vector3 max     = chunk.bounding_box.GetMax();
+            chunk.origin          = Vector3(corner.x, 0.0f, corner.z);
+            chunk.skirt_depth     = max.y - min.y;
+            chunk.bounding_box    = BoundingBox(Vector3(min.x, min.y - chunk.skirt_depth, min.z), max);
+        }
+
+        SP_LOG_INFO("terrain quadtree: %u chunks across %u levels", static_cast<uint32_t>(m_chunks.size()), m_level_count);
+    }
+
+    void TerrainQuadtree::Shutdown()
+    {
+        for (uint32_t index : m_pending)
+        {
+            m_chunks[index].task.wait();
+        }
+
+        for (uint32_t index = 0; index < static_cast<uint32_t>(m_chunks.size()); index++)
+        {
+            if (m_chunks[index].resident)
+            {
+                Evict(index);
+            }
+        }
+
+        m_chunks.clear();
+        m_selected.clear();
+        m_pending.clear();
+        m_positions      = nullptr;
+        m_width          = 0;
+        m_height         = 0;
+        m_level_count    = 0;
+        m_resident_count = 0;
+        m_eviction_count = 0;
+        ResetStats();
+    }
+
+    void TerrainQuadtree::Tick(const Vector3& observer)
+    {
+        if (m_chunks.empty())
+            return;
+
+        SP_PROFILE_CPU();
+
+        m_tick++;
+
+        // finish generated chunks
+        uint32_t finished = 0;
+        for (size_t i = 0; i < m_pending.size() && finished < max_finishes_per_tick;)
+        {
+            if (m_chunks[m_pending[i]].task.wait_for(chrono::seconds(0)) != future_status::ready)
+            {
+                i++;
+                continue;
+            }
+
+            Finish(m_pending[i]);
+            m_pending[i] = m_pending.back();
+            m_pending.pop_back();
+            finished++;
+        }
+
+        // select, a chunk is drawn until all of its children are resident so the surface never has holes
+        vector<uint32_t> selected_previous;
+        swap(selected_previous, m_selected);
+        vector<pair<float, uint32_t>> requests;
+        if (m_chunks[0].resident)
+        {
+            Select(0, observer, requests);
+        }
+        else if (!m_chunks[0].pending)
+        {
+            requests.emplace_back(0.0f, 0);
+        }
+
+        // notify the owner about chunks which started or stopped being drawn
+        for (uint32_t index : selected_previous)
+        {
+            TerrainChunk& chunk = m_chunks[index];
+            if (chunk.selected && chunk.last_selected != m_tick)
+            {
+                chunk.selected = false;
+                if (m_on_selection_changed)
+                {
+                    m_on_selection_changed(chunk);
+                }
+            }
+        }
+        for (uint32_t index : m_selected)
+        {
+            TerrainChunk& chunk = m_chunks[index];
+            if (!chunk.selected)
+            {
+                chunk.selected = true;
+                if (m_on_selection_changed)
+                {
+                    m_on_selection_changed(chunk);
+                }
+            }
+        }
+
+        // request missing chunks, closest first, chunks in flight count against the budget
+        sort(requests.begin(), requests.end());
+        for (const auto& [distance, index] : requests)
+        {
+            if (m_pending.size() >= max_pending)
+                break;
+
+            auto over_budget = [this]()
+            {
+                return (m_resident_count + m_pending.size() + 1) * GetChunkSize() > m_memory_budget;
+            };
+
+            while (over_budget() && EvictLeastRecentlyUsed()) { }
+            if (over_budget())
+                break; // everything resident is in use, coarser chunks keep being drawn instead
+
+            Request(index);
+        }
+
+        // the budget can change at runtime
+        while (GetResidentMemory() > m_memory_budget && EvictLeastRecentlyUsed()) { }
+    }
+
+    void TerrainQuadtree::Flush()
+    {
+        for (uint32_t index : m_pending)
+        {
+            Finish(index);
+        }
+        m_pending.clear();
+    }
+
+    void TerrainQuadtree::SetChunkCallbacks(
+        function<void(TerrainChunk& chunk, const vector<RHI_Vertex_PosTexNorTan>& vertices)>&& on_loaded,
+        function<void(TerrainChunk& chunk)>&& on_evicted,
+        function<void(TerrainChunk& chunk)>&& on_selection_changed
+    )
+    {
+        m_on_loaded            = move(on_loaded);
+        m_on_evicted           = move(on_evicted);
+        m_on_selection_changed = move(on_selection_changed);
+    }
+
+    void TerrainQuadtree::ResetStats()
+    {
+        m_loaded_count        = 0;
+        m_generation_ms_total = 0.0f;
+        m_latency_ms_total    = 0.0f;
+        m_latency_ms_max      = 0.0f;
+    }
+
+    uint32_t TerrainQuadtree::CreateChunk(const uint32_t x, const uint32_t z, const uint32_t step, const uint32_t level)
+    {
+        const uint32_t index = static_cast<uint32_t>(m_chunks.size());
+        m_chunks.emplace_back();
+        m_chunks[index].x     = x;
+        m_chunks[index].z     = z;
+        m_chunks[index].step  = step;
+        m_chunks[index].level = level;
+
+        if (step > 1)
+        {
+            const uint32_t half = step / 2;
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                const uint32_t child_x = x + (i % 2) * chunk_quads * half;
+                const uint32_t child_z = z + (i / 2) * chunk_quads * half;
+                if (child_x >= m_width - 1 || child_z >= m_height - 1)
+                    continue;
+
+                const uint32_t child = CreateChunk(child_x, child_z, half, level - 1);
+                m_chunks[index].children[m_chunks[index].child_count++] = child;
+            }
+        }
+
+        return index;
+    }
+
+    void TerrainQuadtree::Select(const uint32_t index, const Vector3& observer, vector<pair<float, uint32_t>>& requests)
+    {
+        TerrainChunk& chunk = m_chunks[index];
+        chunk.last_used     = m_tick;
+
+        if (chunk.child_count > 0)
+        {
+            const Vector3 size   = chunk.bounding_box.GetSize();
+            const float distance = Vector3::Distance(observer, chunk.bounding_box.GetClosestPoint(observer));
+            if (distance < m_lod_distance * max(size.x, size.z))
+            {
+                bool children_resident = true;
+                for (uint32_t i = 0; i < chunk.child_count; i++)
+                {
+                    TerrainChunk& child = m_chunks[chunk.children[i]];
+                    child.last_used     = m_tick; // needed, so don't evict it
+                    if (!child.resident)
+                    {
+                        children_resident = false;
+                        if (!child.pending)
+                        {
+                            requests.emplace_back(Vector3::Distance(observer, child.bounding_box.GetClosestPoint(observer)), chunk.children[i]);
+                        }
+                    }
+                }
+
+                if (children_resident)
+                {
+                    for (uint32_t i = 0; i < chunk.child_count; i++)
+                    {
+                        Select(chunk.children[i], observer, requests);
+                    }
+                    return;
+                }
+            }
+        }
+
+        chunk.last_selected = m_tick;
+        m_selected.push_back(index);
+    }
+
+    void TerrainQuadtree::Request(const uint32_t index)
+    {
+        TerrainChunk& chunk = m_chunks[index];
+        chunk.pending       = true;
+        chunk.geometry      = make_shared<TerrainChunkGeometry>();
+        chunk.request_time.Start();
+
+        chunk.task = ThreadPool::AddTask([positions = m_positions, width = m_width, height = m_height, x = chunk.x, z = chunk.z, step = chunk.step, origin = chunk.origin, skirt_depth = chunk.skirt_depth, geometry = chunk.geometry]()
+        {
+            const Stopwatch timer;
+            generate_chunk(*positions, width, height, x, z, step, origin, skirt_depth, geometry->vertices);
+            geometry->generation_ms = timer.GetElapsedTimeMs();
+        });
+
+        m_pending.push_back(index);
+    }
+
+    void TerrainQuadtree::Finish(const uint32_t index)
+    {
+        TerrainChunk& chunk = m_chunks[index];
+        chunk.task.wait();
+        chunk.pending  = false;
+        chunk.resident = true;
+        m_resident_count++;
+
+        const float latency_ms = chunk.request_time.GetElapsedTimeMs();
+        m_loaded_count++;
+        m_generation_ms_total += chunk.geometry->generation_ms;
+        m_latency_ms_total    += latency_ms;
+        m_latency_ms_max       = max(m_latency_ms_max, latency_ms);
+
+        if (m_on_loaded)
+        {
+            m_on_loaded(chunk, chunk.geometry->vertices);
+        }
+        chunk.geometry = nullptr;
+    }
+
+    void TerrainQuadtree::Evict(const uint32_t index)
+    {
+        TerrainChunk& chunk = m_chunks[index];
+        if (m_on_evicted)
+        {
+            m_on_evicted(chunk);
+        }
+
+        chunk.resident = false;
+        chunk.selected = false;
+        m_resident_count--;
+        m_eviction_count++;
+    }
+
+    bool TerrainQuadtree::EvictLeastRecentlyUsed()
+    {
+        // the least recently used chunk, finer levels first since they are the cheapest to get back
+        uint32_t victim = numeric_limits<uint32_t>::max();
+        for (uint32_t index = 0; index < static_cast<uint32_t>(m_chunks.size()); index++)
+        {
+            const TerrainChunk& chunk = m_chunks[index];
+            if (!chunk.resident || chunk.last_used == m_tick)
+                continue;
+
+            if (victim == numeric_limits<uint32_t>::max() ||
+                chunk.last_used < m_chunks[victim].last_used ||
+                (chunk.last_used == m_chunks[victim].last_used && chunk.level < m_chunks[victim].level))
+            {
+                victim = index;
+            }
+        }
+
+        if (victim == numeric_limits<uint32_t>::max())
+            return false;
+
+        Evict(victim);
+        return true;
+    }
+
+    bool TerrainQuadtree::Test()
+    {
+        const uint32_t size          = 1025;  // 16x16 chunks at full resolution, 5 levels
+        const uint32_t budget_chunks = 96;
+        const uint32_t tick_sleep_ms = 4;     // stands in for the rest of a frame, so that workers have time to generate
+        const float speed            = 8.0f;  // per tick
+        const float max_tick_ms      = 16.0f; // a tick must never take longer than a frame
+        const float max_latency_ms   = 1000.0f;
+        const float epsilon          = 1e-3f;
+
+        NoiseParameters noise_parameters;
+        noise_parameters.seed      = 3;
+        noise_parameters.frequency = 0.02f; // rough enough for coarse levels to leave real gaps
+        noise_parameters.octaves   = 6;
+        vector<float> heights(size * size);
+        Noise(noise_parameters).SampleGrid(heights.data(), size, size);
+
+        vector<Vector3> positions(size * size);
+        for (uint32_t i = 0; i < size * size; i++)
+        {
+            positions[i] = Vector3(static_cast<float>(i % size), heights[i] * 200.0f, static_cast<float>(i / size));
+        }
+
+        // headless binding which keeps the vertices of resident chunks, so that the surface they form can be checked
+        unordered_map<const TerrainChunk*, vector<RHI_Vertex_PosTexNorTan>> vertices_resident;
+        uint64_t loaded_count  = 0;
+        uint64_t evicted_count = 0;
+        TerrainQuadtree quadtree;
+        quadtree.SetChunkCallbacks(
+            [&vertices_resident, &loaded_count](TerrainChunk& chunk, const vector<RHI_Vertex_PosTexNorTan>& vertices) { vertices_resident[&chunk] = vertices; loaded_count++; },
+            [&vertices_resident, &evicted_count](TerrainChunk& chunk) { vertices_resident.erase(&chunk); evicted_count++; },
+            nullptr
+        );
+        quadtree.Initialize(&positions, size, size);
+        quadtree.SetMemoryBudget(budget_chunks * GetChunkSize());
+
+        // height of an edge (or of its skirt) at a sample offset along it, the way the rasterizer sees it
+        auto edge_height = [&vertices_resident](const TerrainChunk& chunk, const uint32_t edge, const uint32_t offset, const bool skirt)
+        {
+            const vector<RHI_Vertex_PosTexNorTan>& vertices = vertices_resident[&chunk];
+            const uint32_t k                                = min(offset / chunk.step, chunk_quads - 1);
+            const float fraction                            = static_cast<float>(offset - k * chunk.step) / static_cast<float>(chunk.step);
+            auto height = [&vertices, edge, skirt](const uint32_t i)
+            {
+                return vertices[skirt ? chunk_side * chunk_side + edge * chunk_side + i : edge_vertex(edge, i)].pos[1];
+            };
+
+            return chunk.origin.y + lerp(height(k), height(k + 1), fraction);
+        };
+
+        // the owner of every full resolution cell, a selection with holes or overlaps is never right
+        const uint32_t cells = (size - 1) / chunk_quads;
+        vector<uint32_t> owners(cells * cells);
+        uint32_t holes    = 0;
+        uint32_t overlaps = 0;
+        uint32_t cracks   = 0;
+        uint32_t gaps     = 0; // t-junctions which need a skirt, if there are none the crack check proves nothing
+        auto check_surface = [&]()
+        {
+            fill(owners.begin(), owners.end(), numeric_limits<uint32_t>::max());
+            for (uint32_t index : quadtree.GetSelectedChunks())
+            {
+                const TerrainChunk& chunk = quadtree.GetChunk(index);
+                if (!chunk.resident || vertices_resident.find(&chunk) == vertices_resident.end())
+                {
+                    holes++;
+                }
+
+                for (uint32_t z = chunk.z / chunk_quads; z < chunk.z / chunk_quads + chunk.step; z++)
+                {
+                    for (uint32_t x = chunk.x / chunk_quads; x < chunk.x / chunk_quads + chunk.step; x++)
+                    {
+                        overlaps              += owners[z * cells + x] != numeric_limits<uint32_t>::max() ? 1 : 0;
+                        owners[z * cells + x]  = index;
+                    }
+                }
+            }
+            holes += static_cast<uint32_t>(count(owners.begin(), owners.end(), numeric_limits<uint32_t>::max()));
+            if (holes > 0 || overlaps > 0)
+                return;
+
+            // every boundary between two chunks is the top or the right edge of one of them, edges are ordered as bottom, top, left, right,
+            // the last sample of an edge is a corner, which is also the first sample of the next edge along the boundary
+            for (uint32_t index : quadtree.GetSelectedChunks())
+            {
+                const TerrainChunk& chunk = quadtree.GetChunk(index);
+                const uint32_t length     = chunk_quads * chunk.step;
+                for (const uint32_t edge : { 1u, 3u })
+                {
+                    const bool top = edge == 1;
+                    if ((top ? chunk.z : chunk.x) + length >= size - 1)
+                        continue;
+
+                    for (uint32_t offset = 0; offset < length; offset++)
+                    {
+                        const uint32_t x             = top ? chunk.x + offset : chunk.x + length;
+                        const uint32_t z             = top ? chunk.z + length : chunk.z + offset;
+                        const TerrainChunk& neighbor = quadtree.GetChunk(owners[(z / chunk_quads) * cells + x / chunk_quads]);
+                        const uint32_t offset_other  = top ? x - neighbor.x : z - neighbor.z;
+                        const uint32_t edge_other    = edge - 1;
+                        const float height           = edge_height(chunk, edge, offset, false);
+                        const float height_other     = edge_height(neighbor, edge_other, offset_other, false);
+                        if (fabsf(height - height_other) <= epsilon)
+                            continue;
+
+                        // the skirt of the higher edge has to reach the lower one, chunks of the same level can't have a gap at all
+                        gaps++;
+                        const float skirt = height > height_other ? edge_height(chunk, edge, offset, true) : edge_height(neighbor, edge_other, offset_other, true);
+                        if (neighbor.level == chunk.level || skirt > min(height, height_other) + epsilon)
+                        {
+                            cracks++;
+                        }
+                    }
+                }
+            }
+        };
+
+        // the root, then a scripted flight low over the terrain, along both diagonals and one edge
+        const vector<Vector3> waypoints = { Vector3(32.0f, 0.0f, 32.0f), Vector3(992.0f, 0.0f, 992.0f), Vector3(992.0f, 0.0f, 32.0f), Vector3(32.0f, 0.0f, 992.0f) };
+        Vector3 observer                = waypoints[0];
+        auto fly_to_ground              = [&positions, &observer]()
+        {
+            observer.y = positions[static_cast<uint32_t>(observer.z) * size + static_cast<uint32_t>(observer.x)].y + 30.0f;
+        };
+        fly_to_ground();
+        quadtree.Tick(observer);
+        quadtree.Flush();
+        quadtree.ResetStats();
+
+        uint32_t tick_count  = 0;
+        uint32_t over_budget = 0;
+        uint64_t memory_peak = 0;
+        float tick_ms_max    = 0.0f;
+        auto tick = [&]()
+        {
+            fly_to_ground();
+            const Stopwatch timer;
+            quadtree.Tick(observer);
+            tick_ms_max = max(tick_ms_max, timer.GetElapsedTimeMs());
+            tick_count++;
+
+            const uint64_t memory  = (static_cast<uint64_t>(quadtree.GetResidentChunkCount()) + quadtree.GetPendingChunkCount()) * GetChunkSize();
+            memory_peak            = max(memory_peak, memory);
+            over_budget           += memory > quadtree.GetMemoryBudget() ? 1 : 0;
+            check_surface();
+            this_thread::sleep_for(chrono::milliseconds(tick_sleep_ms));
+        };
+
+        for (uint32_t i = 1; i < static_cast<uint32_t>(waypoints.size()); i++)
+        {
+            const Vector3 from   = waypoints[i - 1];
+            const Vector3 to     = waypoints[i];
+            const uint32_t steps = static_cast<uint32_t>(Vector3::Distance(from, to) / speed);
+            for (uint32_t step = 1; step <= steps; step++)
+            {
+                observer = Vector3::Lerp(from, to, static_cast<float>(step) / static_cast<float>(steps));
+                tick();
+            }
+        }
+
+        // hovering at the end, the ground under the observer ends up at full resolution
+        for (uint32_t i = 0; i < 100 && quadtree.GetPendingChunkCount() > 0; i++)
+        {
+            tick();
+        }
+        tick();
+        const TerrainChunk& below = quadtree.GetChunk(owners[(static_cast<uint32_t>(observer.z) / chunk_quads) * cells + static_cast<uint32_t>(observer.x) / chunk_quads]);
+
+        const float latency_ms_max = quadtree.GetLatencyMsMax();
+        const uint64_t evictions   = quadtree.GetEvictionCount();
+        quadtree.Shutdown();
+
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Terrain quadtree %s failed", name);
+                passed = false;
+            }
+        };
+
+        expect("holes",                          holes == 0);
+        expect("overlaps",                       overlaps == 0);
+        expect("cracks",                         cracks == 0);
+        expect("level transitions",              gaps > 0);
+        expect("memory budget",                  over_budget == 0);
+        expect("eviction",                       evictions > 0);
+        expect("stall",                          tick_ms_max <= max_tick_ms);
+        expect("latency",                        latency_ms_max <= max_latency_ms);
+        expect("full resolution under observer", below.level == 0);
+        expect("release",                        vertices_resident.empty() && loaded_count == evicted_count);
+
+        SP_LOG_INFO("Terrain quadtree fly-through: %u ticks, slowest tick %.2f ms, slowest chunk %.1f ms, peak %.1f of %.1f MB, %llu evictions",
+            tick_count,
+            tick_ms_max,
+            latency_ms_max,
+            static_cast<double>(memory_peak) / (1024.0 * 1024.0),
+            static_cast<double>(budget_chunks * GetChunkSize()) / (1024.0 * 1024.0),
+            static_cast<unsigned long long>(evictions)
+        );
+
+        return passed;
+    }
+}
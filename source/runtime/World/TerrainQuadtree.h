@@ -0,0 +1,164 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ==================
+#include <future>
+#include <functional>
+#include "../Math/BoundingBox.h"
+#include "../RHI/RHI_Vertex.h"
+#include "../Core/Stopwatch.h"
+//=============================
+
+namespace spartan
+{
+    class Entity;
+    struct GeometryAllocation;
+
+    // vertices of a chunk, written by the worker thread that generates them
+    struct TerrainChunkGeometry
+    {
+        std::vector<RHI_Vertex_PosTexNorTan> vertices;
+        float generation_ms = 0.0f;
+    };
+
+    // a node of the terrain quadtree, every node is a grid of the same number of quads, so coarser levels cover more ground
+    struct TerrainChunk
+    {
+        uint32_t x           = 0; // first height sample covered by the chunk
+        uint32_t z           = 0;
+        uint32_t step        = 1; // height samples between two vertices, doubles with every level
+        uint32_t level       = 0; // 0 is full resolution
+        uint32_t children[4] = { 0, 0, 0, 0 };
+        uint32_t child_count = 0; // chunks that would start outside of the height grid are not created
+        math::BoundingBox bounding_box; // world space, includes the skirts
+        math::Vector3 origin;           // world position that the vertices are relative to
+        float skirt_depth = 0.0f;       // height range of the chunk, deep enough to cover any crack along its edges
+
+        // residency, only touched on the main thread
+        bool resident          = false;
+        bool pending           = false;
+        bool selected          = false;
+        uint64_t last_selected = 0; // tick in which the chunk was last selected
+        uint64_t last_used     = 0; // tick in which the chunk (or one of its descendants) was last needed, drives eviction
+        Stopwatch request_time;
+
+        // generation
+        std::shared_ptr<TerrainChunkGeometry> geometry;
+        std::future<void> task;
+
+        // bound by the owner while the chunk is resident
+        Entity* entity                 = nullptr;
+        GeometryAllocation* allocation = nullptr;
+    };
+
+    // renders a height grid as a quadtree of chunks which are generated on worker threads when the observer gets close enough to need
+    // them, a node is only refined once all of its children are resident, cracks between levels are hidden with skirts and the least
+    // recently used chunks are evicted once the memory budget is exceeded
+    class TerrainQuadtree
+    {
+    public:
+        TerrainQuadtree() = default;
+        ~TerrainQuadtree();
+
+        // the positions are read by worker threads, so they have to outlive the quadtree (or the next Shutdown())
+        void Initialize(const std::vector<math::Vector3>* positions, const uint32_t width, const uint32_t height);
+        void Shutdown();
+
+        // selects the chunks to draw for the observer, finishes generated chunks, requests missing ones and evicts unused ones
+        void Tick(const math::Vector3& observer);
+        void Flush(); // blocks until all requested chunks are resident, useful for headless runs
+
+        // hooks that bind chunks to the renderer, they run on the main thread, without them the quadtree still streams (headless)
+        void SetChunkCallbacks(
+            std::function<void(TerrainChunk& chunk, const std::vector<RHI_Vertex_PosTexNorTan>& vertices)>&& on_loaded,
+            std::function<void(TerrainChunk& chunk)>&& on_evicted,
+            std::function<void(TerrainChunk& chunk)>&& on_selection_changed
+        );
+
+        // topology shared by all chunks, a (quads + 1)^2 grid followed by a skirt along each edge
+        static constexpr uint32_t chunk_quads = 64;
+        static uint32_t GetChunkVertexCount();
+        static void GetChunkIndices(std::vector<uint32_t>& indices);
+        static uint64_t GetChunkSize() { return GetChunkVertexCount() * sizeof(RHI_Vertex_PosTexNorTan_Gpu); } // in the geometry pool
+
+        // parameters, a chunk is refined when the observer is closer than lod distance times the size of the chunk
+        void SetMemoryBudget(const uint64_t bytes) { m_memory_budget = bytes; }
+        uint64_t GetMemoryBudget() const           { return m_memory_budget; }
+        void SetLodDistance(const float distance)  { m_lod_distance = distance; }
+        float GetLodDistance() const               { return m_lod_distance; }
+
+        // stats
+        uint32_t GetChunkCount() const         { return static_cast<uint32_t>(m_chunks.size()); }
+        uint32_t GetLevelCount() const         { return m_level_count; }
+        uint32_t GetResidentChunkCount() const { return m_resident_count; }
+        uint32_t GetSelectedChunkCount() const { return static_cast<uint32_t>(m_selected.size()); }
+        uint32_t GetPendingChunkCount() const  { return static_cast<uint32_t>(m_pending.size()); }
+        uint64_t GetResidentMemory() const     { return static_cast<uint64_t>(m_resident_count) * GetChunkSize(); }
+        uint64_t GetEvictionCount() const      { return m_eviction_count; }
+        float GetGenerationMsAverage() const   { return m_loaded_count ? m_generation_ms_total / m_loaded_count : 0.0f; }
+        float GetLatencyMsAverage() const      { return m_loaded_count ? m_latency_ms_total / m_loaded_count : 0.0f; }
+        float GetLatencyMsMax() const          { return m_latency_ms_max; }
+        const std::vector<uint32_t>& GetSelectedChunks() const { return m_selected; }
+        const TerrainChunk& GetChunk(const uint32_t index) const { return m_chunks[index]; }
+        void ResetStats();
+
+        // flies an observer over a noise height grid, checks on every tick that the selected chunks are resident and cover the grid
+        // exactly once, that skirts close every crack between levels, that memory stays within budget and that no tick stalls
+        static bool Test();
+
+    private:
+        uint32_t CreateChunk(const uint32_t x, const uint32_t z, const uint32_t step, const uint32_t level);
+        void Select(const uint32_t index, const math::Vector3& observer, std::vector<std::pair<float, uint32_t>>& requests);
+        void Request(const uint32_t index);
+        void Finish(const uint32_t index);
+        void Evict(const uint32_t index);
+        bool EvictLeastRecentlyUsed();
+
+        const std::vector<math::Vector3>* m_positions = nullptr;
+        uint32_t m_width                              = 0;
+        uint32_t m_height                             = 0;
+        uint64_t m_tick                               = 0;
+        std::vector<TerrainChunk> m_chunks;
+        std::vector<uint32_t> m_selected;
+        std::vector<uint32_t> m_pending;
+
+        // parameters
+        uint64_t m_memory_budget = 128ull * 1024 * 1024;
+        float m_lod_distance     = 2.0f;
+
+        // stats
+        uint32_t m_level_count      = 0;
+        uint32_t m_resident_count   = 0;
+        uint32_t m_loaded_count     = 0;
+        uint64_t m_eviction_count   = 0;
+        float m_generation_ms_total = 0.0f;
+        float m_latency_ms_total    = 0.0f;
+        float m_latency_ms_max      = 0.0f;
+
+        // binding
+        std::function<void(TerrainChunk&, const std::vector<RHI_Vertex_PosTexNorTan>&)> m_on_loaded;
+        std::function<void(TerrainChunk&)> m_on_evicted;
+        std::function<void(TerrainChunk&)> m_on_selection_changed;
+    };
+}
@@ -31,7 +31,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Components/Camera.h"
 #include "Components/Light.h"
 #include "Components/AudioSource.h"
+#include "Components/Terrain.h"
+#include "Components/Animator.h"
+#include "Components/Physics.h"
+#include "WorldStreaming.h"
+#include "WorldCommandBuffer.h"
 #include "../Resource/ResourceCache.h"
+#include "../Rendering/Animation.h"
 SP_WARNINGS_OFF
 #include "../IO/pugixml.hpp"
 SP_WARNINGS_ON
@@ -97,22 +103,129 @@ namespace spartan
         {
             bounding_box = BoundingBox::Unit;
 
+            World::ForEach<Renderable>([](Renderable* renderable)
+            {
+                bounding_box.Merge(renderable->GetBoundingBox());
+            });
+        }
+
+        string world_file_path_to_resource_directory(const string& world_file_path)
+        {
+            const string world_name = FileSystem::GetFileNameWithoutExtensionFromFilePath(world_file_path);
+            return FileSystem::GetDirectoryFromFilePath(world_file_path) + "\\" + world_name + "_resources\\";
+        }
+    }
+
+    namespace world_manifest
+    {
+        // the .world file doubles as a manifest, it records the content hash of every resource and root entity that
+        // was written, so the next save only rewrites what has changed since, root entities live in content-addressed
+        // files which means that the previous manifest stays valid until the new one replaces it in a single rename
+        const uint32_t version = 2;
+
+        // entities that everything else depends on are never streamed out
+        bool is_always_resident(Entity* root)
+        {
+            vector<Entity*> entities = { root };
+            root->GetDescendants(&entities);
             for (Entity* entity : entities)
             {
-                if (entity->GetActive())
+                if (entity->GetComponent<Camera>() || entity->GetComponent<Terrain>())
+                    return true;
+
+                if (Light* light = entity->GetComponent<Light>())
                 {
-                    if (Renderable* renderable = entity->GetComponent<Renderable>())
-                    {
-                        bounding_box.Merge(renderable->GetBoundingBox());
-                    }
+                    if (light->GetLightType() == LightType::Directional)
+                        return true;
                 }
             }
+
+            return false;
         }
 
-        string world_file_path_to_resource_directory(const string& world_file_path)
+        struct entry
         {
-            const string world_name = FileSystem::GetFileNameWithoutExtensionFromFilePath(world_file_path);
-            return FileSystem::GetDirectoryFromFilePath(world_file_path) + "\\" + world_name + "_resources\\";
+            uint64_t hash = 0;
+            string file;
+        };
+
+        struct state
+        {
+            unordered_map<string, uint64_t> resources; // resource file name -> content hash
+            unordered_map<uint64_t, entry> entities;   // root entity id -> content hash and file
+        };
+
+        void read(const string& world_file_path, state& manifest)
+        {
+            manifest.resources.clear();
+            manifest.entities.clear();
+
+            pugi::xml_document doc;
+            if (!FileSystem::Exists(world_file_path) || !doc.load_file(world_file_path.c_str()))
+                return;
+
+            pugi::xml_node world_node = doc.child("World");
+            if (world_node.attribute("version").as_uint() != version)
+                return; // older worlds are written in full
+
+            for (pugi::xml_node node = world_node.child("Resources").child("Resource"); node; node = node.next_sibling("Resource"))
+            {
+                manifest.resources[node.attribute("file").as_string()] = node.attribute("hash").as_ullong();
+            }
+
+            for (pugi::xml_node node = world_node.child("Entities").child("Entity"); node; node = node.next_sibling("Entity"))
+            {
+                if (node.attribute("file"))
+                {
+                    entry& e = manifest.entities[node.attribute("id").as_ullong()];
+                    e.hash   = node.attribute("hash").as_ullong();
+                    e.file   = node.attribute("file").as_string();
+                }
+            }
+        }
+
+        bool write_file(const string& file_path, const string& data)
+        {
+            ofstream file(file_path, ios::binary | ios::trunc);
+            if (!file)
+                return false;
+
+            file.write(data.data(), static_cast<streamsize>(data.size()));
+            return file.good();
+        }
+
+        uint64_t get_file_size(const string& file_path)
+        {
+            error_code ec;
+            const uintmax_t size = filesystem::file_size(file_path, ec);
+            return ec ? 0 : static_cast<uint64_t>(size);
+        }
+
+        // writes to a temporary file first and then swaps it in, so a crash never leaves a half-written resource behind
+        bool save_resource(IResource* resource, const string& file_path)
+        {
+            const string path_before = resource->GetResourceFilePath();
+            const string path_temp   = file_path + ".tmp";
+
+            resource->SaveToFile(path_temp);
+            if (!FileSystem::Exists(path_temp))
+                return false;
+
+            // a failed rename leaves the previous file in place, which the manifest must not claim is the new one
+            if (!FileSystem::Rename(path_temp, file_path))
+            {
+                FileSystem::Delete(path_temp);
+                resource->SetResourceFilePath(path_before);
+                return false;
+            }
+
+            // some resources adopt the path they are saved to, point them to the final one
+            if (resource->GetResourceFilePath() != path_before)
+            {
+                resource->SetResourceFilePath(file_path);
+            }
+
+            return true;
         }
     }
 
@@ -175,6 +288,7 @@ namespace spartan
             {
                 // clean up change tracking
                 entity_states.erase(id);
+                WorldStreaming::OnEntityRemoved(id);
                 if (Material* mat = (*it)->GetComponent<Renderable>() ? (*it)->GetComponent<Renderable>()->GetMaterial() : nullptr)
                 {
                     material_state_hashes.erase(mat->GetObjectId());
@@ -198,6 +312,10 @@ namespace spartan
         if (pending_add.empty())
             return;
 
+        for (Entity* entity : pending_add)
+        {
+            entity->SetInWorld(true);
+        }
         entities.insert(entities.end(), pending_add.begin(), pending_add.end());
         pending_add.clear();
     }
@@ -210,6 +328,8 @@ namespace spartan
     void World::Shutdown()
     {
         Engine::SetFlag(EngineMode::Playing, false); // stop simulation
+        WorldStreaming::Clear();                     // wait for in-flight cell loads and forget all cells
+        WorldCommandBuffer::Clear();                 // drop mutations that were never played back
         ResourceCache::Shutdown();                   // release all resources (textures, materials, meshes, etc)
 
         // clear entities
@@ -219,9 +339,22 @@ namespace spartan
         {
             delete entity;
         }
+        for (Entity* entity : pending_add)
+        {
+            delete entity;
+        }
         entities.clear();
         entities_lights.clear();
         pending_add.clear();
+
+        // components that outlived their entities, destroyed while the renderer and geometry pool are still alive
+        ComponentPool<AudioSource>::Get().Clear();
+        ComponentPool<Camera>::Get().Clear();
+        ComponentPool<Light>::Get().Clear();
+        ComponentPool<Renderable>::Get().Clear();
+        ComponentPool<Physics>::Get().Clear();
+        ComponentPool<Terrain>::Get().Clear();
+        ComponentPool<Animator>::Get().Clear();
         camera = nullptr;
         light  = nullptr;
         file_path.clear();
@@ -265,9 +398,14 @@ namespace spartan
             }
         }
 
+        // apply the mutations that were recorded by other threads (or deferred by this one)
+        WorldCommandBuffer::Playback();
+
         ProcessPendingRemovals();
 
-      
+        // stream world cells in and out around the observers
+        WorldStreaming::Tick();
+
         for (Entity* entity : entities)
         {
             if (entity->GetActive())
@@ -276,6 +414,9 @@ namespace spartan
             }
         }
 
+        // sample animations and skin vertices, before renderables update their bounding boxes
+        Animator::Tick(static_cast<float>(Timer::GetDeltaTimeSec()));
+
         // tick
         for (Entity* entity : entities)
         {
@@ -362,30 +503,30 @@ namespace spartan
                 light              = nullptr;
                 audio_source_count = 0;
                 entities_lights.clear();
-                for (Entity* entity : entities)
+
+                // walk the component pools instead of every entity
+                World::ForEach<Camera>([](Camera* camera_comp)
                 {
-                    if (entity->GetActive())
+                    if (!camera)
                     {
-                        if (!camera && entity->GetComponent<Camera>())
-                        {
-                            camera = entity;
-                        }
-
-                        if (Light* light_comp = entity->GetComponent<Light>())
-                        {
-                            if (!light && light_comp->GetLightType() == LightType::Directional)
-                            {
-                                light = entity;
-                            }
-                            entities_lights.push_back(entity);
-                        }
+                        camera = camera_comp->GetEntity();
+                    }
+                });
 
-                        if (entity->GetComponent<AudioSource>())
-                        {
-                            audio_source_count++;
-                        }
+                World::ForEach<Light>([](Light* light_comp)
+                {
+                    Entity* entity = light_comp->GetEntity();
+                    if (!light && light_comp->GetLightType() == LightType::Directional)
+                    {
+                        light = entity;
                     }
-                }
+                    entities_lights.push_back(entity);
+                });
+
+                World::ForEach<AudioSource>([](AudioSource*)
+                {
+                    audio_source_count++;
+                });
             }
 
             compute_bounding_box();
@@ -414,11 +555,30 @@ namespace spartan
         // start timing
         const Stopwatch timer;
 
+        // read what the previous save wrote, so unchanged resources and entities can be skipped
+        world_manifest::state manifest_previous;
+        world_manifest::read(file_path, manifest_previous);
+        world_manifest::state manifest;
+
+        // stats
+        uint32_t resources_written = 0;
+        uint32_t resources_total   = 0;
+        uint32_t entities_written  = 0;
+        uint32_t entities_total    = 0;
+        uint64_t bytes_written     = 0;
+
+        // create document
+        pugi::xml_document doc;
+        pugi::xml_node world_node = doc.append_child("World");
+        world_node.append_attribute("name")    = FileSystem::GetFileNameWithoutExtensionFromFilePath(file_path).c_str();
+        world_node.append_attribute("version") = world_manifest::version;
+
         // serialize the resources before saving the world (XML), as it references them
+        const string directory = world_file_path_to_resource_directory(file_path);
         {
-            string directory = world_file_path_to_resource_directory(file_path);
             FileSystem::CreateDirectory_(directory);
 
+            pugi::xml_node resources_node = world_node.append_child("Resources");
             vector<shared_ptr<IResource>> resources = ResourceCache::GetResources();
 
             // Combined loop for resource saving, filtered by type
@@ -427,52 +587,181 @@ namespace spartan
                 string ext;
                 switch (resource->GetResourceType())
                 {
-                    case ResourceType::Texture:  ext = EXTENSION_TEXTURE;  break;
-                    case ResourceType::Material: ext = EXTENSION_MATERIAL; break;
-                    case ResourceType::Mesh:     ext = EXTENSION_MESH;     break;
+                    case ResourceType::Texture:   ext = EXTENSION_TEXTURE;   break;
+                    case ResourceType::Material:  ext = EXTENSION_MATERIAL;  break;
+                    case ResourceType::Mesh:      ext = EXTENSION_MESH;      break;
+                    case ResourceType::Animation: ext = EXTENSION_ANIMATION; break;
                 default: continue;
                 }
-                resource->SaveToFile(directory + resource->GetObjectName() + ext);
+
+                const string file_name     = resource->GetObjectName() + ext;
+                const string resource_path = directory + file_name;
+                const uint64_t hash        = resource->GetContentHash();
+                resources_total++;
+
+                // skip resources which are identical to what's already on disk
+                auto it = manifest_previous.resources.find(file_name);
+                bool unchanged = hash != 0 && it != manifest_previous.resources.end() && it->second == hash && FileSystem::Exists(resource_path);
+                if (!unchanged)
+                {
+                    if (!world_manifest::save_resource(resource.get(), resource_path))
+                        continue;
+
+                    resources_written++;
+                    bytes_written += world_manifest::get_file_size(resource_path);
+                }
+
+                if (hash != 0)
+                {
+                    manifest.resources[file_name] = hash;
+
+                    pugi::xml_node resource_node = resources_node.append_child("Resource");
+                    resource_node.append_attribute("file") = file_name.c_str();
+                    resource_node.append_attribute("hash") = hash;
+                }
             }
         }
 
-        // create document
-        pugi::xml_document doc;
-        pugi::xml_node world_node = doc.append_child("World");
-        world_node.append_attribute("name") = FileSystem::GetFileNameWithoutExtensionFromFilePath(file_path).c_str();
-
         // entities
+        vector<pair<WorldCellEntity, Entity*>> cell_entities;
         {
             // node
             pugi::xml_node entities_node = world_node.append_child("Entities");
+            entities_node.append_attribute("cell_size") = WorldStreaming::GetCellSize();
+            FileSystem::CreateDirectory_(directory + WorldStreaming::GetEntitiesDirectory());
 
             // get root entities, save them, and they will save their children recursively
             static vector<Entity*> root_entities;
             World::GetRootEntities(root_entities);
+            root_entities.erase(remove_if(root_entities.begin(), root_entities.end(), [](Entity* root) { return root->IsTransient(); }), root_entities.end());
             const uint32_t root_entity_count = static_cast<uint32_t>(root_entities.size());
 
+            // entities of cells which are not resident are carried over from their existing files
+            vector<WorldCellEntity> non_resident_entities;
+            WorldStreaming::GetNonResidentEntities(non_resident_entities);
+            entities_total = root_entity_count + static_cast<uint32_t>(non_resident_entities.size());
+
             // progress tracking
-            ProgressTracker::GetProgress(ProgressType::World).Start(root_entity_count, "Saving world...");
+            ProgressTracker::GetProgress(ProgressType::World).Start(entities_total, "Saving world...");
 
-            // write entities to node
-            for (Entity* root : root_entities)
+            // has_cell partitions the entity on disk, is_streamed hands it back to streaming once the save completes
+            auto add_reference = [&](const WorldCellEntity& record, Entity* root, const bool has_cell, const bool is_streamed)
             {
-                pugi::xml_node entity_node = entities_node.append_child("Entity");
-                root->Save(entity_node);
+                manifest.entities[record.id] = { record.hash, record.file };
+
+                pugi::xml_node reference_node = entities_node.append_child("Entity");
+                reference_node.append_attribute("id")   = record.id;
+                reference_node.append_attribute("hash") = record.hash;
+                reference_node.append_attribute("size") = record.size;
+                reference_node.append_attribute("file") = record.file.c_str();
+                if (has_cell)
+                {
+                    reference_node.append_attribute("cell_x") = record.cell_x;
+                    reference_node.append_attribute("cell_z") = record.cell_z;
+                }
+
+                if (has_cell && is_streamed)
+                {
+                    cell_entities.emplace_back(record, root);
+                }
+
                 ProgressTracker::GetProgress(ProgressType::World).JobDone();
+            };
+
+            // write each root entity to its own file, named after its content, and reference it from the manifest
+            for (Entity* root : root_entities)
+            {
+                WorldCellEntity record;
+                string data;
+                record.id       = root->GetObjectId();
+                record.resident = true;
+                WorldStreaming::SerializeEntity(root, data, record.hash, record.file);
+                record.size     = data.size();
+
+                const string entity_path = directory + record.file;
+                auto it = manifest_previous.entities.find(record.id);
+                bool unchanged = it != manifest_previous.entities.end() && it->second.hash == record.hash && it->second.file == record.file && FileSystem::Exists(entity_path);
+                if (!unchanged)
+                {
+                    if (!world_manifest::write_file(entity_path, data))
+                    {
+                        SP_LOG_ERROR("Failed to write entity \"%s\" to %s", root->GetObjectName().c_str(), entity_path.c_str());
+                        return false;
+                    }
+
+                    entities_written++;
+                    bytes_written += data.size();
+                }
+
+                // entities created or loaded outside of a cell stay resident until the world is loaded again
+                WorldStreaming::GetCell(root->GetPosition(), record.cell_x, record.cell_z);
+                add_reference(record, root, !world_manifest::is_always_resident(root), WorldStreaming::IsRegistered(record.id));
+            }
+
+            for (const WorldCellEntity& record : non_resident_entities)
+            {
+                // saving to a different world, bring the file along
+                const string entity_path = directory + record.file;
+                if (!FileSystem::Exists(entity_path))
+                {
+                    FileSystem::CopyFileFromTo(WorldStreaming::GetDirectory() + record.file, entity_path);
+                    entities_written++;
+                    bytes_written += record.size;
+                }
+
+                add_reference(record, nullptr, true, true);
             }
         }
 
-        // save to file
-        bool saved = doc.save_file(file_path.c_str(), " ", pugi::format_indent);
-        if (!saved)
+        // save the manifest to a temporary file and swap it in, the previous world stays intact until this point
         {
-            SP_LOG_ERROR("Failed to save XML file.");
-            return false;
+            const string file_path_temp = file_path + ".tmp";
+            if (!doc.save_file(file_path_temp.c_str(), " ", pugi::format_indent))
+            {
+                SP_LOG_ERROR("Failed to save XML file.");
+                return false;
+            }
+            const uint64_t manifest_size  = world_manifest::get_file_size(file_path_temp);
+            bytes_written                += manifest_size;
+
+            // until the new manifest is in place the previous one is the world on disk, and it still references
+            // the files that the cleanup below would delete, so a failed swap has to stop here
+            if (!FileSystem::Rename(file_path_temp, file_path) || world_manifest::get_file_size(file_path) != manifest_size)
+            {
+                SP_LOG_ERROR("Failed to replace %s, the previous save has been kept", file_path.c_str());
+                FileSystem::Delete(file_path_temp);
+                return false;
+            }
+        }
+
+        // remove entity files which are no longer referenced, now that nothing on disk points to them
+        {
+            unordered_set<string> referenced;
+            for (const auto& [id, entry] : manifest.entities)
+            {
+                referenced.insert(FileSystem::GetFileNameFromFilePath(entry.file));
+            }
+
+            for (const string& path : FileSystem::GetFilesInDirectory(directory + WorldStreaming::GetEntitiesDirectory()))
+            {
+                if (referenced.find(FileSystem::GetFileNameFromFilePath(path)) == referenced.end())
+                {
+                    FileSystem::Delete(path);
+                }
+            }
+        }
+
+        // the saved world is now the one that's streamed, with the same resident set as before the save
+        WorldStreaming::Clear();
+        WorldStreaming::SetDirectory(directory);
+        for (const auto& [record, root] : cell_entities)
+        {
+            WorldStreaming::RegisterEntity(record, root);
         }
 
         // log
-        SP_LOG_INFO("World \"%s\" has been saved. Duration %.2f ms", file_path.c_str(), timer.GetElapsedTimeMs());
+        SP_LOG_INFO("World \"%s\" has been saved, wrote %u/%u entities and %u/%u resources (%.2f KB). Duration %.2f ms",
+            file_path.c_str(), entities_written, entities_total, resources_written, resources_total, static_cast<double>(bytes_written) / 1024.0, timer.GetElapsedTimeMs());
 
         return true;
     }
@@ -505,6 +794,10 @@ namespace spartan
                 {
                     ResourceCache::Load<Mesh>(path);
                 }
+                else if (FileSystem::IsEngineAnimationFile(path))
+                {
+                    ResourceCache::Load<Animation>(path);
+                }
             }
         }
 
@@ -546,10 +839,47 @@ namespace spartan
             ProgressTracker::GetProgress(ProgressType::World).Start(root_entity_count, "Loading world...");
 
             // load root entities (they will load their descendants recursively)
+            const string directory = world_file_path_to_resource_directory(file_path);
+            WorldStreaming::SetDirectory(directory);
+            if (entities_node.attribute("cell_size"))
+            {
+                WorldStreaming::SetCellSize(entities_node.attribute("cell_size").as_float());
+            }
+
             for (pugi::xml_node entity_node = entities_node.child("Entity"); entity_node; entity_node = entity_node.next_sibling("Entity"))
             {
+                // entities which belong to a cell are created when the cell streams in
+                if (WorldStreaming::IsEnabled() && entity_node.attribute("cell_x") && entity_node.attribute("file"))
+                {
+                    WorldCellEntity record;
+                    record.id   = entity_node.attribute("id").as_ullong();
+                    record.hash = entity_node.attribute("hash").as_ullong();
+                    record.size = entity_node.attribute("size").as_ullong();
+                    record.file   = entity_node.attribute("file").as_string();
+                    record.cell_x = entity_node.attribute("cell_x").as_int();
+                    record.cell_z = entity_node.attribute("cell_z").as_int();
+                    WorldStreaming::RegisterEntity(record);
+                    ProgressTracker::GetProgress(ProgressType::World).JobDone();
+                    continue;
+                }
+
+                // version 2 worlds reference a file per root entity, older worlds store them inline
+                pugi::xml_document entity_doc;
+                pugi::xml_node node = entity_node;
+                if (pugi::xml_attribute file_attribute = entity_node.attribute("file"))
+                {
+                    const string entity_path = directory + file_attribute.as_string();
+                    if (!entity_doc.load_file(entity_path.c_str()))
+                    {
+                        SP_LOG_ERROR("Failed to load entity file %s", entity_path.c_str());
+                        ProgressTracker::GetProgress(ProgressType::World).JobDone();
+                        continue;
+                    }
+                    node = entity_doc.child("Entity");
+                }
+
                 Entity* entity = World::CreateEntity();
-                entity->Load(entity_node);
+                entity->Load(node);
                 ProgressTracker::GetProgress(ProgressType::World).JobDone();
             }
         }
@@ -562,13 +892,37 @@ namespace spartan
 
     Entity* World::CreateEntity()
     {
+        Entity* entity = new Entity();
+        AddEntity(entity);
+
+        return entity;
+    }
+
+    void World::AddEntity(Entity* entity)
+    {
+        SP_ASSERT_MSG(entity != nullptr, "Entity is null");
+
         lock_guard lock(entity_access_mutex);
 
-        Entity* entity = new Entity();
         pending_add.push_back(entity);
         mark_entity_changed(entity->GetObjectId(), EntityChange::Components); // new entity requires resolve
+    }
 
-        return entity;
+    void World::CreateEntities(const uint32_t count, vector<Entity*>& entities_out)
+    {
+        entities_out.reserve(entities_out.size() + count);
+
+        lock_guard lock(entity_access_mutex);
+
+        pending_add.reserve(pending_add.size() + count);
+        entity_states.reserve(entity_states.size() + count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Entity* entity = new Entity();
+            pending_add.push_back(entity);
+            entities_out.push_back(entity);
+            mark_entity_changed(entity->GetObjectId(), EntityChange::Components);
+        }
     }
 
     bool World::EntityExists(Entity* entity)
@@ -602,6 +956,7 @@ namespace spartan
             for (Entity* entity : entities_to_remove)
             {
                 ids_to_remove.insert(entity->GetObjectId());
+                entity->SetInWorld(false);
             }
 
             // defer removal
@@ -655,6 +1010,11 @@ namespace spartan
         return entities_lights;
     }
 
+    void World::Resolve()
+    {
+        resolve = true;
+    }
+
     string World::GetName()
     {
         return FileSystem::GetFileNameFromFilePath(file_path);
@@ -743,4 +1103,340 @@ namespace spartan
     {
         return world_time::get_time_of_day(use_real_world_time);
     }
+
+    bool World::TestIncrementalSave()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("Incremental save %s failed", name);
+                passed = false;
+            }
+        };
+
+        // a handful of root entities, each with a child, so that an entity file holds more than one entity
+        const uint32_t root_count = 16;
+        vector<Entity*> roots;
+        for (uint32_t i = 0; i < root_count; i++)
+        {
+            Entity* root  = CreateEntity();
+            Entity* child = CreateEntity();
+            root->SetObjectName("test_root_" + to_string(i));
+            child->SetObjectName("test_child_" + to_string(i));
+            child->SetParent(root);
+            root->SetPosition(Vector3(static_cast<float>(i) * 10.0f, 0.0f, 0.0f));
+            roots.push_back(root);
+        }
+        ProcessPendingAdditions();
+
+        // every file of the world, with the stamp it has on disk
+        const string world_path = FileSystem::GetWorkingDirectory() + "/test_incremental_save" + EXTENSION_WORLD;
+        const string directory  = world_file_path_to_resource_directory(world_path);
+        auto snapshot = [&]()
+        {
+            map<string, uint64_t> files;
+            for (const string& dir : { directory, directory + WorldStreaming::GetEntitiesDirectory() })
+            {
+                if (FileSystem::IsDirectory(dir))
+                {
+                    for (const string& path : FileSystem::GetFilesInDirectory(dir))
+                    {
+                        files[FileSystem::GetFileNameFromFilePath(path)] = FileSystem::GetFileStamp(path);
+                    }
+                }
+            }
+            return files;
+        };
+        auto read_manifest = [&world_path]()
+        {
+            ifstream file(world_path, ios::binary);
+            return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        };
+
+        expect("first save", SaveToFile(world_path));
+        const map<string, uint64_t> files_before = snapshot();
+        const string manifest_before             = read_manifest();
+
+        // saving again without edits writes nothing but the manifest
+        expect("unchanged save", SaveToFile(world_path));
+        expect("unchanged files", snapshot() == files_before);
+
+        // an edit to one child is one new entity file, one deleted one, and the manifest
+        Entity* edited = roots[root_count / 2];
+        edited->GetChildByIndex(0)->SetPositionLocal(Vector3(0.0f, 5.0f, 0.0f));
+        expect("edited save", SaveToFile(world_path));
+        const map<string, uint64_t> files_after = snapshot();
+
+        uint32_t added     = 0;
+        uint32_t removed   = 0;
+        uint32_t rewritten = 0;
+        for (const auto& [name, stamp] : files_after)
+        {
+            auto it = files_before.find(name);
+            added     += it == files_before.end() ? 1 : 0;
+            rewritten += it != files_before.end() && it->second != stamp ? 1 : 0;
+        }
+        for (const auto& [name, stamp] : files_before)
+        {
+            removed += files_after.find(name) == files_after.end() ? 1 : 0;
+        }
+        expect("one entity file written", added == 1);
+        expect("the stale entity file deleted", removed == 1);
+        expect("nothing else rewritten", rewritten == 0);
+        expect("manifest rewritten", read_manifest() != manifest_before);
+
+        // the edited entity's file is named after its id and content
+        bool named_after_edited = false;
+        const string prefix     = to_string(edited->GetObjectId()) + "_";
+        for (const auto& [name, stamp] : files_after)
+        {
+            named_after_edited = named_after_edited || (files_before.find(name) == files_before.end() && name.rfind(prefix, 0) == 0);
+        }
+        expect("the written file is the edited entity's", named_after_edited);
+
+        // leave the world empty and simulating, like it was before the test
+        const bool playing = Engine::IsFlagSet(EngineMode::Playing);
+        Shutdown();
+        Engine::SetFlag(EngineMode::Playing, playing);
+        FileSystem::Delete(world_path);
+        FileSystem::Delete(directory);
+
+        return passed;
+    }
+
+    bool World::TestStreaming()
+    {
+        bool passed = true;
+        auto expect = [&passed](const char* name, const bool condition)
+        {
+            if (!condition)
+            {
+                SP_LOG_ERROR("World streaming %s failed", name);
+                passed = false;
+            }
+        };
+
+        // the parameters are global, put them back once done
+        const bool playing                    = Engine::IsFlagSet(EngineMode::Playing);
+        const float load_radius_previous      = WorldStreaming::GetLoadRadius();
+        const float unload_radius_previous    = WorldStreaming::GetUnloadRadius();
+        const uint64_t memory_budget_previous = WorldStreaming::GetMemoryBudget();
+        const float frame_budget_previous     = WorldStreaming::GetFrameBudgetMs();
+        const float cell_size_previous        = WorldStreaming::GetCellSize();
+
+        // a grid of root entities, one per cell, each with a child
+        const uint32_t grid   = 32;
+        const float cell_size = 32.0f;
+        WorldStreaming::SetCellSize(cell_size);
+        for (uint32_t z = 0; z < grid; z++)
+        {
+            for (uint32_t x = 0; x < grid; x++)
+            {
+                Entity* root  = CreateEntity();
+                Entity* child = CreateEntity();
+                root->SetObjectName("test_streaming_" + to_string(x) + "_" + to_string(z));
+                child->SetObjectName("test_streaming_child");
+                child->SetParent(root);
+                root->SetPosition(Vector3((static_cast<float>(x) + 0.5f) * cell_size, 0.0f, (static_cast<float>(z) + 0.5f) * cell_size));
+            }
+        }
+        ProcessPendingAdditions();
+
+        // saving and loading again puts every root in a cell, with nothing resident
+        const string world_path = FileSystem::GetWorkingDirectory() + "/test_streaming" + EXTENSION_WORLD;
+        const string directory  = world_file_path_to_resource_directory(world_path);
+        expect("save", SaveToFile(world_path));
+        expect("load", LoadFromFile(world_path));
+        expect("every cell registered", WorldStreaming::GetCellCount() == grid * grid);
+        expect("nothing resident", WorldStreaming::GetResidentCellCount() == 0 && entities.empty());
+
+        // a ceiling of a few dozen cells, below what the unload radius alone would keep resident
+        vector<WorldCellEntity> records;
+        WorldStreaming::GetNonResidentEntities(records);
+        uint64_t cell_size_max = 0;
+        for (const WorldCellEntity& record : records)
+        {
+            cell_size_max = max(cell_size_max, record.size);
+        }
+        const uint64_t memory_ceiling = cell_size_max * 40;
+        const float stall_ceiling_ms  = 16.0f; // a frame at 60 Hz
+        WorldStreaming::SetLoadRadius(64.0f);
+        WorldStreaming::SetUnloadRadius(96.0f);
+        WorldStreaming::SetMemoryBudget(memory_ceiling);
+        WorldStreaming::SetFrameBudgetMs(2.0f);
+        WorldStreaming::SetCameraIsObserver(false);
+
+        // fly diagonally across the grid, ticking like the world does every frame
+        auto tick = []()
+        {
+            WorldStreaming::Tick();
+            ProcessPendingRemovals();
+            ProcessPendingAdditions();
+        };
+        const float extent    = grid * cell_size;
+        uint64_t memory_max   = 0;
+        uint32_t resident_max = 0;
+        WorldStreaming::ResetStats();
+        for (float t = 0.0f; t <= 1.0f; t += 1.0f / 400.0f)
+        {
+            WorldStreaming::SetObserver(0, Vector3(extent * t, 0.0f, extent * t));
+            tick();
+            memory_max   = max(memory_max, WorldStreaming::GetResidentMemory());
+            resident_max = max(resident_max, WorldStreaming::GetResidentCellCount());
+        }
+        const float stall_max_ms = WorldStreaming::GetMaxStallMs();
+        expect("stalls bounded", stall_max_ms <= stall_ceiling_ms);
+        expect("memory bounded", memory_max <= memory_ceiling);
+        expect("cells streamed in", resident_max > 0);
+
+        // once flushed, the cell under the observer is resident and the first cells are not
+        auto find = [](const string& name) -> Entity*
+        {
+            for (Entity* entity : entities)
+            {
+                if (entity->GetObjectName() == name)
+                    return entity;
+            }
+            return nullptr;
+        };
+        WorldStreaming::Flush();
+        ProcessPendingRemovals();
+        ProcessPendingAdditions();
+        expect("nothing pending", WorldStreaming::GetPendingCellCount() == 0);
+        const string last = to_string(grid - 1);
+        Entity* edited    = find("test_streaming_" + last + "_" + last);
+        Entity* untouched = find("test_streaming_" + to_string(grid - 2) + "_" + last);
+        expect("observed cells resident", edited && untouched);
+        expect("distant cells unloaded", !find("test_streaming_0_0"));
+
+        // only the edited entity is written when its cell unloads
+        if (edited && untouched)
+        {
+            // the files that hold both entities as they were loaded
+            auto get_file = [](Entity* entity)
+            {
+                string data;
+                string file;
+                uint64_t hash = 0;
+                WorldStreaming::SerializeEntity(entity, data, hash, file);
+                return file;
+            };
+            auto get_record = [](const uint64_t id)
+            {
+                vector<WorldCellEntity> records;
+                WorldStreaming::GetNonResidentEntities(records);
+                for (const WorldCellEntity& record : records)
+                {
+                    if (record.id == id)
+                        return record;
+                }
+                return WorldCellEntity();
+            };
+            const uint64_t edited_id       = edited->GetObjectId();
+            const uint64_t untouched_id    = untouched->GetObjectId();
+            const string edited_file       = get_file(edited);
+            const string untouched_file    = get_file(untouched);
+            const uint64_t untouched_stamp = FileSystem::GetFileStamp(directory + untouched_file);
+
+            edited->GetChildByIndex(0)->SetPositionLocal(Vector3(0.0f, 5.0f, 0.0f));
+            WorldStreaming::SetObserver(0, Vector3::Zero);
+            WorldStreaming::Flush();
+            ProcessPendingRemovals();
+            ProcessPendingAdditions();
+
+            const WorldCellEntity edited_after    = get_record(edited_id);
+            const WorldCellEntity untouched_after = get_record(untouched_id);
+            expect("edited entity unloaded", edited_after.id == edited_id && !find("test_streaming_" + last + "_" + last));
+            expect("edited entity written", edited_after.file != edited_file && FileSystem::Exists(directory + edited_after.file));
+            expect("untouched entity not written", untouched_after.file == untouched_file && FileSystem::GetFileStamp(directory + untouched_file) == untouched_stamp);
+
+            // and streams back in with the edit
+            WorldStreaming::SetObserver(0, Vector3(extent, 0.0f, extent));
+            WorldStreaming::Flush();
+            ProcessPendingRemovals();
+            ProcessPendingAdditions();
+            Entity* reloaded = find("test_streaming_" + last + "_" + last);
+            expect("edit persisted", reloaded && reloaded->GetChildrenCount() == 1 && reloaded->GetChildByIndex(0)->GetPositionLocal() == Vector3(0.0f, 5.0f, 0.0f));
+        }
+
+        SP_LOG_INFO("World streaming: %u cells, max stall %.2f ms, max resident %u cells (%.1f KB of a %.1f KB ceiling)",
+            grid * grid, stall_max_ms, resident_max, static_cast<double>(memory_max) / 1024.0, static_cast<double>(memory_ceiling) / 1024.0);
+
+        // leave the world empty and simulating, like it was before the test
+        Shutdown();
+        Engine::SetFlag(EngineMode::Playing, playing);
+        WorldStreaming::RemoveObserver(0);
+        WorldStreaming::SetCameraIsObserver(true);
+        WorldStreaming::SetLoadRadius(load_radius_previous);
+        WorldStreaming::SetUnloadRadius(unload_radius_previous);
+        WorldStreaming::SetMemoryBudget(memory_budget_previous);
+        WorldStreaming::SetFrameBudgetMs(frame_budget_previous);
+        WorldStreaming::SetCellSize(cell_size_previous);
+        FileSystem::Delete(world_path);
+        FileSystem::Delete(directory);
+
+        return passed;
+    }
+
+    void World::BenchmarkForEach(const uint32_t renderable_count)
+    {
+        const bool playing = Engine::IsFlagSet(EngineMode::Playing);
+
+        // a renderable on every other entity, and every tenth of those inactive, so both walks have something to skip
+        vector<Entity*> created;
+        CreateEntities(renderable_count * 2, created);
+        for (uint32_t i = 0; i < renderable_count; i++)
+        {
+            Entity* entity = created[i * 2];
+            entity->AddComponent<Renderable>();
+            entity->SetActive(i % 10 != 0);
+        }
+        ProcessPendingAdditions();
+
+        // the same work per renderable, reached through the entity list and through the pool
+        const uint32_t run_count   = 10;
+        uint64_t checksum_entities = 0;
+        uint64_t checksum_pool     = 0;
+        uint32_t visited           = 0;
+        Stopwatch timer;
+        for (uint32_t run = 0; run < run_count; run++)
+        {
+            for (Entity* entity : entities)
+            {
+                if (!entity->GetActive())
+                    continue;
+
+                if (Renderable* renderable = entity->GetComponent<Renderable>())
+                {
+                    checksum_entities += renderable->GetObjectId();
+                }
+            }
+        }
+        const double entities_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6) / run_count;
+
+        timer.Start();
+        for (uint32_t run = 0; run < run_count; run++)
+        {
+            ForEach<Renderable>([&checksum_pool, &visited](Renderable* renderable)
+            {
+                checksum_pool += renderable->GetObjectId();
+                visited++;
+            });
+        }
+        const double pool_ms = max(static_cast<double>(timer.GetElapsedTimeMs()), 1e-6) / run_count;
+
+        SP_LOG_INFO("Component iteration, %u renderables (%u active) among %u entities: entity walk %.3f ms, pool walk %.3f ms, %.1fx%s",
+            renderable_count,
+            visited / run_count,
+            renderable_count * 2,
+            entities_ms,
+            pool_ms,
+            entities_ms / pool_ms,
+            checksum_entities == checksum_pool ? "" : ", the walks disagree");
+
+        Shutdown();
+        Engine::SetFlag(EngineMode::Playing, playing);
+    }
 }
@@ -21,9 +21,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
 
-//= INCLUDES ===================
+//= INCLUDES ===========================
 #include "../Math/BoundingBox.h"
-//==============================
+#include "Components/ComponentPool.h"
+//======================================
 
 namespace spartan
 {
@@ -44,12 +45,30 @@ namespace spartan
 
         // entities
         static Entity* CreateEntity();
+        static void CreateEntities(uint32_t count, std::vector<Entity*>& entities_out); // registers all of them under a single lock
+        static void AddEntity(Entity* entity);                                          // takes ownership of an entity that was allocated elsewhere
         static bool EntityExists(Entity* entity);
         static void RemoveEntity(Entity* entity);
         static void GetRootEntities(std::vector<Entity*>& entities);
         static Entity* GetEntityById(uint64_t id);
         static const std::vector<Entity*>& GetEntities();
         static const std::vector<Entity*>& GetEntitiesLights();
+        static void Resolve();
+
+        // iterates every component of type T whose entity is active and part of the world (not pending addition or removal),
+        // components are stored contiguously per type, the function must not add or remove components of type T
+        template <class T, class Function>
+        static void ForEach(Function&& function)
+        {
+            ComponentPool<T>::Get().ForEach([&function](T* component)
+            {
+                auto* entity = component->GetEntity();
+                if (entity->IsInWorld() && entity->GetActive())
+                {
+                    function(component);
+                }
+            });
+        }
 
         // misc
         static std::string GetName();
@@ -65,6 +84,13 @@ namespace spartan
         // world time: 0.0 = midnight, 0.5 = noon, 1.0 = next midnight
         static float GetTimeOfDay(bool use_real_world_time = false);
 
+        // tests, they use the live world and leave it empty
+        static bool TestIncrementalSave(); // an edit to one entity only rewrites that entity's file and the manifest
+        static bool TestStreaming();       // a camera path keeps stalls and memory bounded, and only edited entities are written back
+
+        // benchmarks
+        static void BenchmarkForEach(const uint32_t renderable_count = 100000); // walking the entities against walking the renderable pool
+
     private:
         static void ProcessPendingRemovals();
         static void ProcessPendingAdditions();
@@ -0,0 +1,400 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ======================
+#include "pch.h"
+#include "WorldCommandBuffer.h"
+#include "Entity.h"
+#include "../Core/Stopwatch.h"
+#include "../Core/ThreadPool.h"
+#include "../Profiling/Profiler.h"
+//=================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace spartan::math;
+//============================
+
+namespace spartan
+{
+    namespace
+    {
+        // one buffer per thread that ever recorded a command, in order of first use
+        mutex buffers_mutex;
+        vector<unique_ptr<WorldCommandBuffer>> buffers;
+
+        // reused across playbacks
+        vector<WorldCommand> commands_gathered;
+
+        uint32_t last_playback_count = 0;
+        float last_playback_ms       = 0.0f;
+
+        void execute(WorldCommand& command)
+        {
+            Entity* entity = command.entity;
+
+            switch (command.type)
+            {
+                case WorldCommandType::CreateEntity:
+                    World::AddEntity(entity);
+                    break;
+
+                case WorldCommandType::RemoveEntity:
+                    World::RemoveEntity(entity);
+                    break;
+
+                case WorldCommandType::SetName:
+                    entity->SetObjectName(command.name);
+                    break;
+
+                case WorldCommandType::SetActive:
+                    entity->SetActive(command.active);
+                    break;
+
+                case WorldCommandType::SetParent:
+                    entity->SetParent(command.parent);
+                    break;
+
+                case WorldCommandType::SetTransformLocal:
+                    entity->SetTransformLocal(command.position, command.rotation, command.scale);
+                    break;
+
+                case WorldCommandType::AddComponent:
+                {
+                    Component* component = entity->AddComponent(command.component_type);
+                    if (!command.attribute_values.empty())
+                    {
+                        component->SetAttributeValues(command.attribute_values);
+                    }
+                    break;
+                }
+
+                case WorldCommandType::RemoveComponent:
+                    for (Component* component : entity->GetAllComponents())
+                    {
+                        if (component && component->GetType() == command.component_type)
+                        {
+                            entity->RemoveComponentById(component->GetObjectId());
+                            break;
+                        }
+                    }
+                    break;
+
+                case WorldCommandType::Execute:
+                    command.function();
+                    break;
+            }
+        }
+    }
+
+    WorldCommandBuffer& WorldCommandBuffer::Get()
+    {
+        thread_local WorldCommandBuffer* buffer = nullptr;
+
+        if (!buffer)
+        {
+            lock_guard lock(buffers_mutex);
+            buffer = buffers.emplace_back(make_unique<WorldCommandBuffer>()).get();
+        }
+
+        return *buffer;
+    }
+
+    void WorldCommandBuffer::Playback()
+    {
+        SP_PROFILE_CPU();
+
+        const Stopwatch timer;
+
+        // gather, buffer by buffer, so that recording order within a buffer is preserved
+        {
+            lock_guard lock(buffers_mutex);
+            for (unique_ptr<WorldCommandBuffer>& buffer : buffers)
+            {
+                lock_guard lock_buffer(buffer->m_mutex);
+                move(buffer->m_commands.begin(), buffer->m_commands.end(), back_inserter(commands_gathered));
+                buffer->m_commands.clear();
+                buffer->m_sequences.clear();
+            }
+        }
+
+        if (commands_gathered.empty())
+        {
+            last_playback_count = 0;
+            last_playback_ms    = 0.0f;
+            return;
+        }
+
+        // key and sequence are a total order as long as every key is recorded by one scope at a time, the gathered
+        // order depends on which thread recorded first, so equal pairs mean the order is up to the scheduler
+        sort(commands_gathered.begin(), commands_gathered.end(), [](const WorldCommand& a, const WorldCommand& b)
+        {
+            if (a.sort_key != b.sort_key)
+                return a.sort_key < b.sort_key;
+
+            return a.sequence < b.sequence;
+        });
+
+        for (size_t i = 1; i < commands_gathered.size(); i++)
+        {
+            if (commands_gathered[i].sort_key == commands_gathered[i - 1].sort_key && commands_gathered[i].sequence == commands_gathered[i - 1].sequence)
+            {
+                SP_LOG_ERROR("Sort key %llu was recorded on more than one thread, the order of its commands is not deterministic", static_cast<unsigned long long>(commands_gathered[i].sort_key));
+                break;
+            }
+        }
+
+        for (WorldCommand& command : commands_gathered)
+        {
+            execute(command);
+        }
+
+        last_playback_count = static_cast<uint32_t>(commands_gathered.size());
+        last_playback_ms    = static_cast<float>(timer.GetElapsedTimeMs());
+        commands_gathered.clear();
+    }
+
+    void WorldCommandBuffer::Clear()
+    {
+        lock_guard lock(buffers_mutex);
+        for (unique_ptr<WorldCommandBuffer>& buffer : buffers)
+        {
+            lock_guard lock_buffer(buffer->m_mutex);
+            for (WorldCommand& command : buffer->m_commands)
+            {
+                if (command.type == WorldCommandType::CreateEntity)
+                {
+                    delete command.entity;
+                }
+            }
+            buffer->m_commands.clear();
+            buffer->m_sequences.clear();
+        }
+    }
+
+    uint32_t WorldCommandBuffer::GetPendingCount()
+    {
+        lock_guard lock(buffers_mutex);
+
+        uint32_t count = 0;
+        for (unique_ptr<WorldCommandBuffer>& buffer : buffers)
+        {
+            lock_guard lock_buffer(buffer->m_mutex);
+            count += static_cast<uint32_t>(buffer->m_commands.size());
+        }
+
+        return count;
+    }
+
+    uint32_t WorldCommandBuffer::GetLastPlaybackCount()
+    {
+        return last_playback_count;
+    }
+
+    float WorldCommandBuffer::GetLastPlaybackMs()
+    {
+        return last_playback_ms;
+    }
+
+    WorldCommandBuffer::Scope::Scope(const uint64_t sort_key) : m_buffer(WorldCommandBuffer::Get())
+    {
+        SP_ASSERT_MSG(!m_buffer.m_in_scope, "Scopes can't be nested");
+
+        lock_guard lock(m_buffer.m_mutex);
+        m_buffer.m_sort_key = sort_key;
+        m_buffer.m_in_scope = true;
+    }
+
+    WorldCommandBuffer::Scope::~Scope()
+    {
+        // the thread goes on to run other jobs, which must not inherit the key
+        lock_guard lock(m_buffer.m_mutex);
+        m_buffer.m_sort_key = 0;
+        m_buffer.m_in_scope = false;
+    }
+
+    WorldCommand& WorldCommandBuffer::Record(const WorldCommandType type, Entity* entity)
+    {
+        SP_ASSERT_MSG(entity != nullptr || type == WorldCommandType::Execute, "Entity is null");
+        SP_ASSERT_MSG(m_in_scope, "Commands are recorded inside a WorldCommandBuffer::Scope, which gives them a sort key");
+
+        WorldCommand& command = m_commands.emplace_back();
+        command.type          = type;
+        command.sort_key      = m_sort_key;
+        command.sequence      = m_sequences[m_sort_key]++;
+        command.entity        = entity;
+
+        return command;
+    }
+
+    Entity* WorldCommandBuffer::CreateEntity()
+    {
+        Entity* entity = new Entity();
+
+        lock_guard lock(m_mutex);
+        Record(WorldCommandType::CreateEntity, entity);
+
+        return entity;
+    }
+
+    void WorldCommandBuffer::RemoveEntity(Entity* entity)
+    {
+        lock_guard lock(m_mutex);
+        Record(WorldCommandType::RemoveEntity, entity);
+    }
+
+    void WorldCommandBuffer::SetName(Entity* entity, const string& name)
+    {
+        lock_guard lock(m_mutex);
+        Record(WorldCommandType::SetName, entity).name = name;
+    }
+
+    void WorldCommandBuffer::SetActive(Entity* entity, const bool active)
+    {
+        lock_guard lock(m_mutex);
+        Record(WorldCommandType::SetActive, entity).active = active;
+    }
+
+    void WorldCommandBuffer::SetParent(Entity* entity, Entity* parent)
+    {
+        lock_guard lock(m_mutex);
+        Record(WorldCommandType::SetParent, entity).parent = parent;
+    }
+
+    void WorldCommandBuffer::SetTransformLocal(Entity* entity, const Vector3& position, const Quaternion& rotation, const Vector3& scale)
+    {
+        lock_guard lock(m_mutex);
+        WorldCommand& command = Record(WorldCommandType::SetTransformLocal, entity);
+        command.position      = position;
+        command.rotation      = rotation;
+        command.scale         = scale;
+    }
+
+    void WorldCommandBuffer::AddComponent(Entity* entity, const ComponentType type, vector<any> attribute_values)
+    {
+        lock_guard lock(m_mutex);
+        WorldCommand& command    = Record(WorldCommandType::AddComponent, entity);
+        command.component_type   = type;
+        command.attribute_values = move(attribute_values);
+    }
+
+    void WorldCommandBuffer::RemoveComponent(Entity* entity, const ComponentType type)
+    {
+        lock_guard lock(m_mutex);
+        Record(WorldCommandType::RemoveComponent, entity).component_type = type;
+    }
+
+    void WorldCommandBuffer::Execute(function<void()>&& function)
+    {
+        lock_guard lock(m_mutex);
+        Record(WorldCommandType::Execute, nullptr).function = move(function);
+    }
+
+    bool WorldCommandBuffer::Test()
+    {
+        const uint32_t job_count    = 67; // doesn't divide evenly, so the jobs land on threads differently per worker count
+        const uint32_t entity_count = 48; // per job
+
+        // every job builds a group under a shared root, half of its entities go straight under the root so that the
+        // root's children interleave across jobs, and some code runs in between, the world is hashed in child order
+        // and with the order the code ran in, ids are left out as they differ per run
+        auto run = [&](const uint32_t worker_count, uint32_t& root_child_count)
+        {
+            Entity* root = World::CreateEntity();
+            vector<uint32_t> executed;
+
+            ThreadPool::ParallelLoop([&](uint32_t job_start, uint32_t job_end)
+            {
+                for (uint32_t job = job_start; job < job_end; job++)
+                {
+                    Scope scope(job);
+                    WorldCommandBuffer& commands = Get();
+
+                    Entity* group = commands.CreateEntity();
+                    commands.SetName(group, "group_" + to_string(job));
+                    commands.SetParent(group, root);
+                    for (uint32_t i = 0; i < entity_count; i++)
+                    {
+                        Entity* entity = commands.CreateEntity();
+                        commands.SetName(entity, "entity_" + to_string(job) + "_" + to_string(i));
+                        commands.SetTransformLocal(entity, Vector3(static_cast<float>(job), static_cast<float>(i), 0.0f), Quaternion::Identity, Vector3::One);
+                        commands.SetParent(entity, (i % 2 == 0) ? root : group);
+                        if (i % 8 == 0)
+                        {
+                            commands.Execute([&executed, job, i, entity_count]() { executed.push_back(job * entity_count + i); });
+                        }
+                    }
+                }
+            }, job_count, worker_count);
+
+            Playback();
+
+            uint64_t hash = 0;
+            function<void(Entity*)> visit = [&](Entity* entity)
+            {
+                const string& name      = entity->GetObjectName();
+                const Vector3& position = entity->GetPositionLocal();
+                hash                    = hash_combine(hash, hash_bytes(name.data(), name.size()));
+                hash                    = hash_combine(hash, hash_bytes(&position, sizeof(position)));
+                for (Entity* child : entity->GetChildren())
+                {
+                    visit(child);
+                }
+            };
+            visit(root);
+            for (const uint32_t value : executed)
+            {
+                hash = hash_combine(hash, static_cast<uint64_t>(value));
+            }
+
+            root_child_count = root->GetChildrenCount();
+            return hash;
+        };
+
+        bool passed = true;
+        uint32_t root_child_count = 0;
+        const uint64_t reference  = run(1, root_child_count); // serial, on this thread
+        if (root_child_count != job_count * (1 + entity_count / 2))
+        {
+            SP_LOG_ERROR("World command buffer playback lost commands, the root has %u children instead of %u", root_child_count, job_count * (1 + entity_count / 2));
+            passed = false;
+        }
+
+        // several runs per worker count, the schedule differs every time
+        for (const uint32_t worker_count : { 2u, 3u, 7u, 0u, 0u, 0u })
+        {
+            const uint64_t hash = run(worker_count, root_child_count);
+            if (hash != reference)
+            {
+                SP_LOG_ERROR("World command buffer playback with %u workers differs from the serial one", worker_count);
+                passed = false;
+            }
+        }
+
+        // leave the world empty and simulating, like it was before the test
+        const bool playing = Engine::IsFlagSet(EngineMode::Playing);
+        World::Shutdown();
+        Engine::SetFlag(EngineMode::Playing, playing);
+
+        return passed;
+    }
+}
@@ -0,0 +1,128 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ==========================
+#include <any>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include "Components/Component.h"
+#include "../Math/Quaternion.h"
+//=====================================
+
+namespace spartan
+{
+    class Entity;
+
+    enum class WorldCommandType : uint8_t
+    {
+        CreateEntity,
+        RemoveEntity,
+        SetName,
+        SetActive,
+        SetParent,
+        SetTransformLocal,
+        AddComponent,
+        RemoveComponent,
+        Execute
+    };
+
+    struct WorldCommand
+    {
+        WorldCommandType type        = WorldCommandType::Execute;
+        uint64_t sort_key            = 0; // the key of the scope it was recorded in
+        uint32_t sequence            = 0; // recording order within the sort key
+        Entity* entity               = nullptr;
+        Entity* parent               = nullptr;
+        ComponentType component_type = ComponentType::Max;
+        bool active                  = true;
+        math::Vector3 position       = math::Vector3::Zero;
+        math::Quaternion rotation    = math::Quaternion::Identity;
+        math::Vector3 scale          = math::Vector3::One;
+        std::string name;
+        std::vector<std::any> attribute_values;
+        std::function<void()> function;
+    };
+
+    // records world mutations from any thread, they are applied on the main thread during World::Tick()
+    // - every thread records into its own buffer, so producers never contend with each other
+    // - commands can only be recorded inside a Scope, which carries an explicit sort key (e.g. a job index)
+    // - commands are played back in ascending sort key order and then in recording order within the key, so as long
+    //   as a key is only recorded by one job at a time the result is the same regardless of thread scheduling
+    class WorldCommandBuffer
+    {
+    public:
+        // keys the commands that the calling thread records while it's alive, ends with the job that opened it
+        class Scope
+        {
+        public:
+            Scope(const uint64_t sort_key);
+            ~Scope();
+
+            Scope(const Scope&)            = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            WorldCommandBuffer& m_buffer;
+        };
+
+        // the buffer of the calling thread
+        static WorldCommandBuffer& Get();
+
+        // applies and discards the commands of all buffers, main thread only
+        static void Playback();
+
+        // discards all recorded commands, deleting entities which were never played back
+        static void Clear();
+
+        // stats
+        static uint32_t GetPendingCount();
+        static uint32_t GetLastPlaybackCount();
+        static float GetLastPlaybackMs();
+
+        // jobs on the thread pool record the same world with their index as the key, and every run and thread count agrees
+        static bool Test();
+
+        // the entity is allocated immediately so that later commands can reference it, it joins the world on playback
+        Entity* CreateEntity();
+        void RemoveEntity(Entity* entity);
+        void SetName(Entity* entity, const std::string& name);
+        void SetActive(Entity* entity, bool active);
+        void SetParent(Entity* entity, Entity* parent);
+        void SetTransformLocal(Entity* entity, const math::Vector3& position, const math::Quaternion& rotation, const math::Vector3& scale);
+        void AddComponent(Entity* entity, ComponentType type, std::vector<std::any> attribute_values = {});
+        void RemoveComponent(Entity* entity, ComponentType type);
+        void Execute(std::function<void()>&& function);
+
+    private:
+        WorldCommand& Record(WorldCommandType type, Entity* entity);
+
+        std::vector<WorldCommand> m_commands;
+        uint64_t m_sort_key = 0;
+        bool m_in_scope     = false;
+        std::unordered_map<uint64_t, uint32_t> m_sequences; // next sequence per sort key, until the next playback
+        std::mutex m_mutex; // only contended while the main thread collects the commands
+    };
+}
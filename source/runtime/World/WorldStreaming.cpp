@@ -0,0 +1,599 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES =========================
+#include "pch.h"
+#include "WorldStreaming.h"
+#include "World.h"
+#include "Entity.h"
+#include "Components/Camera.h"
+#include "../Core/ThreadPool.h"
+#include "../Profiling/Profiler.h"
+SP_WARNINGS_OFF
+#include "../IO/pugixml.hpp"
+SP_WARNINGS_ON
+//====================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace spartan::math;
+//============================
+
+namespace spartan
+{
+    namespace
+    {
+        enum class CellState
+        {
+            Unloaded,
+            Loading, // entity files are being parsed on a worker thread
+            Loaded
+        };
+
+        struct Cell
+        {
+            int32_t x       = 0;
+            int32_t z       = 0;
+            CellState state = CellState::Unloaded;
+            float distance  = numeric_limits<float>::max(); // distance to the closest observer
+            vector<WorldCellEntity> entities;
+
+            // written by the worker, read by the main thread once the task has completed
+            shared_ptr<vector<pugi::xml_document>> documents;
+            future<void> task;
+
+            uint64_t GetSize() const
+            {
+                uint64_t size = 0;
+                for (const WorldCellEntity& entity : entities)
+                {
+                    size += entity.size;
+                }
+                return size;
+            }
+        };
+
+        unordered_map<uint64_t, Cell> cells;
+        unordered_set<uint64_t> registered_ids;
+        unordered_map<uint64_t, Entity*> resident_roots; // streamed root entities which are part of the world, by id
+        const char* entities_directory = "entities/";
+        unordered_map<uint32_t, Vector3> observers;
+        string directory;
+        bool enabled              = true;
+        bool camera_is_observer   = true;
+        float cell_size           = 128.0f;
+        float load_radius         = 256.0f;
+        float unload_radius       = 320.0f;
+        uint64_t memory_budget    = 512ull * 1024 * 1024;
+        float frame_budget_ms     = 2.0f;
+        uint32_t max_loads_flight = 4;
+        float stall_last_ms       = 0.0f;
+        float stall_max_ms        = 0.0f;
+
+        uint64_t cell_key(const int32_t x, const int32_t z)
+        {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+        }
+
+        // distance on the xz plane from the closest observer to the closest point of the cell
+        float compute_distance(const Cell& cell, const vector<Vector3>& positions)
+        {
+            const float min_x = cell.x * cell_size;
+            const float min_z = cell.z * cell_size;
+            const float max_x = min_x + cell_size;
+            const float max_z = min_z + cell_size;
+
+            float distance = numeric_limits<float>::max();
+            for (const Vector3& position : positions)
+            {
+                const float dx = max(max(min_x - position.x, 0.0f), position.x - max_x);
+                const float dz = max(max(min_z - position.z, 0.0f), position.z - max_z);
+                distance       = min(distance, sqrt(dx * dx + dz * dz));
+            }
+
+            return distance;
+        }
+
+        // changes whenever anything that the root or its descendants save changes, without serializing them
+        uint64_t compute_revision(Entity* root)
+        {
+            vector<Entity*> entities = { root };
+            root->GetDescendants(&entities);
+
+            uint64_t revision = 0;
+            for (Entity* entity : entities)
+            {
+                revision = hash_combine(revision, entity->GetObjectId());
+                revision = hash_combine(revision, entity->GetRevision());
+            }
+
+            return revision;
+        }
+
+        uint64_t compute_resident_memory()
+        {
+            uint64_t size = 0;
+            for (const auto& [key, cell] : cells)
+            {
+                if (cell.state != CellState::Unloaded)
+                {
+                    size += cell.GetSize();
+                }
+            }
+            return size;
+        }
+
+        uint32_t count_cells(const CellState state)
+        {
+            uint32_t count = 0;
+            for (const auto& [key, cell] : cells)
+            {
+                count += cell.state == state ? 1 : 0;
+            }
+            return count;
+        }
+
+        void load_begin(Cell& cell)
+        {
+            vector<string> paths;
+            for (const WorldCellEntity& entity : cell.entities)
+            {
+                paths.emplace_back(entity.resident ? string() : directory + entity.file);
+            }
+
+            cell.state     = CellState::Loading;
+            cell.documents = make_shared<vector<pugi::xml_document>>(paths.size());
+            cell.task      = ThreadPool::AddTask([documents = cell.documents, paths = move(paths)]()
+            {
+                for (size_t i = 0; i < paths.size(); i++)
+                {
+                    if (!paths[i].empty() && !(*documents)[i].load_file(paths[i].c_str()))
+                    {
+                        SP_LOG_ERROR("Failed to load entity file %s", paths[i].c_str());
+                    }
+                }
+            });
+        }
+
+        // creates the entities of a cell whose files have been parsed, must run on the main thread
+        void load_end(Cell& cell)
+        {
+            cell.task.get();
+
+            for (size_t i = 0; i < cell.entities.size(); i++)
+            {
+                WorldCellEntity& record = cell.entities[i];
+                if (record.resident)
+                    continue;
+
+                pugi::xml_node node = (*cell.documents)[i].child("Entity");
+                if (node && resident_roots.find(record.id) == resident_roots.end())
+                {
+                    Entity* entity = World::CreateEntity();
+                    entity->Load(node);
+                    resident_roots[record.id] = entity;
+                    record.revision           = compute_revision(entity);
+                }
+
+                record.resident = true;
+            }
+
+            cell.documents = nullptr;
+            cell.state     = CellState::Loaded;
+        }
+
+        void unload(Cell& cell)
+        {
+            for (auto it = cell.entities.begin(); it != cell.entities.end();)
+            {
+                WorldCellEntity& record = *it;
+                if (!record.resident)
+                {
+                    ++it;
+                    continue;
+                }
+
+                // the entity was removed while resident, forget about it so it doesn't come back
+                auto it_root = resident_roots.find(record.id);
+                if (it_root == resident_roots.end())
+                {
+                    registered_ids.erase(record.id);
+                    it = cell.entities.erase(it);
+                    continue;
+                }
+                Entity* entity = it_root->second;
+
+                // persist changes made while resident, otherwise the file on disk is still valid
+                if (compute_revision(entity) != record.revision)
+                {
+                    string data;
+                    uint64_t hash = 0;
+                    string file;
+                    WorldStreaming::SerializeEntity(entity, data, hash, file);
+
+                    ofstream stream(directory + file, ios::binary | ios::trunc);
+                    stream.write(data.data(), static_cast<streamsize>(data.size()));
+                    if (stream.good())
+                    {
+                        record.hash = hash;
+                        record.file = file;
+                        record.size = data.size();
+                    }
+                    else
+                    {
+                        SP_LOG_ERROR("Failed to write entity file %s, keeping the entity resident", (directory + file).c_str());
+                        ++it;
+                        continue;
+                    }
+                }
+
+                resident_roots.erase(it_root);
+                World::RemoveEntity(entity);
+                record.resident = false;
+                ++it;
+            }
+
+            cell.state = CellState::Unloaded;
+            for (const WorldCellEntity& record : cell.entities)
+            {
+                if (record.resident)
+                {
+                    cell.state = CellState::Loaded;
+                }
+            }
+        }
+
+        void update(const bool blocking)
+        {
+            // gather observers
+            vector<Vector3> positions;
+            if (camera_is_observer)
+            {
+                if (Camera* camera = World::GetCamera())
+                {
+                    positions.emplace_back(camera->GetEntity()->GetPosition());
+                }
+            }
+            for (const auto& [index, position] : observers)
+            {
+                positions.emplace_back(position);
+            }
+
+            if (positions.empty())
+                return;
+
+            // prioritize by distance
+            vector<Cell*> sorted;
+            sorted.reserve(cells.size());
+            for (auto& [key, cell] : cells)
+            {
+                cell.distance = compute_distance(cell, positions);
+                sorted.emplace_back(&cell);
+            }
+            sort(sorted.begin(), sorted.end(), [](const Cell* a, const Cell* b) { return a->distance < b->distance; });
+
+            // unload cells that are past the unload radius, the gap between the radii prevents thrashing at the edges
+            for (Cell* cell : sorted)
+            {
+                if (cell->state == CellState::Loaded && cell->distance > unload_radius)
+                {
+                    unload(*cell);
+                }
+            }
+
+            // request the closest cells first, making room within the budget by evicting cells that are further away
+            uint64_t resident_memory = compute_resident_memory();
+            uint32_t loads_in_flight = count_cells(CellState::Loading);
+            for (Cell* cell : sorted)
+            {
+                if (cell->distance > load_radius)
+                    break;
+
+                if (cell->state != CellState::Unloaded)
+                    continue;
+
+                if (!blocking && loads_in_flight >= max_loads_flight)
+                    break;
+
+                const uint64_t size = cell->GetSize();
+                for (auto it = sorted.rbegin(); it != sorted.rend() && resident_memory + size > memory_budget; ++it)
+                {
+                    Cell* farther = *it;
+                    if (farther->distance <= cell->distance)
+                        break;
+
+                    if (farther->state == CellState::Loaded)
+                    {
+                        uint64_t farther_size = farther->GetSize();
+                        unload(*farther);
+                        if (farther->state == CellState::Unloaded)
+                        {
+                            resident_memory -= min(resident_memory, farther_size);
+                        }
+                    }
+                }
+
+                if (resident_memory + size > memory_budget)
+                    break; // nothing further away left to evict
+
+                load_begin(*cell);
+                resident_memory += size;
+                loads_in_flight++;
+            }
+
+            // create entities for parsed cells, closest first, within the frame budget
+            const Stopwatch timer;
+            for (Cell* cell : sorted)
+            {
+                if (cell->state != CellState::Loading)
+                    continue;
+
+                bool ready = cell->task.wait_for(chrono::seconds(0)) == future_status::ready;
+                if (!ready && !blocking)
+                    continue;
+
+                load_end(*cell);
+
+                if (!blocking && timer.GetElapsedTimeMs() >= frame_budget_ms)
+                    break;
+            }
+        }
+
+        void wait_for_tasks()
+        {
+            for (auto& [key, cell] : cells)
+            {
+                if (cell.task.valid())
+                {
+                    cell.task.wait();
+                }
+            }
+        }
+    }
+
+    void WorldStreaming::Tick()
+    {
+        if (!enabled || cells.empty())
+            return;
+
+        SP_PROFILE_CPU();
+
+        const Stopwatch timer;
+        update(false);
+
+        stall_last_ms = static_cast<float>(timer.GetElapsedTimeMs());
+        stall_max_ms  = max(stall_max_ms, stall_last_ms);
+    }
+
+    void WorldStreaming::Clear()
+    {
+        wait_for_tasks();
+        cells.clear();
+        registered_ids.clear();
+        resident_roots.clear();
+        directory.clear();
+    }
+
+    void WorldStreaming::Flush()
+    {
+        if (!enabled || cells.empty())
+            return;
+
+        const Stopwatch timer;
+        update(true);
+
+        stall_last_ms = static_cast<float>(timer.GetElapsedTimeMs());
+        stall_max_ms  = max(stall_max_ms, stall_last_ms);
+    }
+
+    bool WorldStreaming::IsEnabled()
+    {
+        return enabled;
+    }
+
+    void WorldStreaming::SetEnabled(const bool enabled_)
+    {
+        enabled = enabled_;
+    }
+
+    float WorldStreaming::GetCellSize()
+    {
+        return cell_size;
+    }
+
+    void WorldStreaming::SetCellSize(const float size)
+    {
+        SP_ASSERT_MSG(size > 0.0f, "Cell size must be positive");
+        SP_ASSERT_MSG(cells.empty(), "Cell size can't change while cells are registered");
+        cell_size = size;
+    }
+
+    void WorldStreaming::GetCell(const Vector3& position, int32_t& cell_x, int32_t& cell_z)
+    {
+        cell_x = static_cast<int32_t>(floor(position.x / cell_size));
+        cell_z = static_cast<int32_t>(floor(position.z / cell_size));
+    }
+
+    void WorldStreaming::RegisterEntity(const WorldCellEntity& entity, Entity* root)
+    {
+        Cell& cell = cells[cell_key(entity.cell_x, entity.cell_z)];
+        cell.x     = entity.cell_x;
+        cell.z     = entity.cell_z;
+        cell.entities.emplace_back(entity);
+        registered_ids.insert(entity.id);
+
+        if (entity.resident)
+        {
+            SP_ASSERT_MSG(root != nullptr, "A resident record needs its root entity");
+            resident_roots[entity.id]     = root;
+            cell.entities.back().revision = compute_revision(root);
+            cell.state                    = CellState::Loaded;
+        }
+    }
+
+    void WorldStreaming::OnEntityRemoved(const uint64_t id)
+    {
+        resident_roots.erase(id);
+    }
+
+    void WorldStreaming::GetNonResidentEntities(vector<WorldCellEntity>& entities)
+    {
+        entities.clear();
+        for (const auto& [key, cell] : cells)
+        {
+            for (const WorldCellEntity& entity : cell.entities)
+            {
+                if (!entity.resident)
+                {
+                    entities.emplace_back(entity);
+                }
+            }
+        }
+    }
+
+    bool WorldStreaming::IsRegistered(const uint64_t id)
+    {
+        return registered_ids.find(id) != registered_ids.end();
+    }
+
+    void WorldStreaming::SetDirectory(const string& directory_)
+    {
+        directory = directory_;
+    }
+
+    const string& WorldStreaming::GetDirectory()
+    {
+        return directory;
+    }
+
+    const char* WorldStreaming::GetEntitiesDirectory()
+    {
+        return entities_directory;
+    }
+
+    void WorldStreaming::SerializeEntity(Entity* entity, string& data, uint64_t& hash, string& file)
+    {
+        pugi::xml_document doc;
+        pugi::xml_node node = doc.append_child("Entity");
+        entity->Save(node);
+
+        ostringstream stream;
+        doc.save(stream, " ", pugi::format_indent);
+        data = stream.str();
+        hash = hash_bytes(data.data(), data.size());
+
+        char file_name[64];
+        snprintf(file_name, sizeof(file_name), "%llu_%016llx.xml", static_cast<unsigned long long>(entity->GetObjectId()), static_cast<unsigned long long>(hash));
+        file = string(entities_directory) + file_name;
+    }
+
+    float WorldStreaming::GetLoadRadius()
+    {
+        return load_radius;
+    }
+
+    void WorldStreaming::SetLoadRadius(const float radius)
+    {
+        load_radius = radius;
+    }
+
+    float WorldStreaming::GetUnloadRadius()
+    {
+        return unload_radius;
+    }
+
+    void WorldStreaming::SetUnloadRadius(const float radius)
+    {
+        unload_radius = radius;
+    }
+
+    uint64_t WorldStreaming::GetMemoryBudget()
+    {
+        return memory_budget;
+    }
+
+    void WorldStreaming::SetMemoryBudget(const uint64_t bytes)
+    {
+        memory_budget = bytes;
+    }
+
+    float WorldStreaming::GetFrameBudgetMs()
+    {
+        return frame_budget_ms;
+    }
+
+    void WorldStreaming::SetFrameBudgetMs(const float milliseconds)
+    {
+        frame_budget_ms = milliseconds;
+    }
+
+    void WorldStreaming::SetObserver(const uint32_t index, const Vector3& position)
+    {
+        observers[index] = position;
+    }
+
+    void WorldStreaming::RemoveObserver(const uint32_t index)
+    {
+        observers.erase(index);
+    }
+
+    void WorldStreaming::SetCameraIsObserver(const bool is_observer)
+    {
+        camera_is_observer = is_observer;
+    }
+
+    uint32_t WorldStreaming::GetCellCount()
+    {
+        return static_cast<uint32_t>(cells.size());
+    }
+
+    uint32_t WorldStreaming::GetResidentCellCount()
+    {
+        return count_cells(CellState::Loaded);
+    }
+
+    uint32_t WorldStreaming::GetPendingCellCount()
+    {
+        return count_cells(CellState::Loading);
+    }
+
+    uint64_t WorldStreaming::GetResidentMemory()
+    {
+        return compute_resident_memory();
+    }
+
+    float WorldStreaming::GetLastStallMs()
+    {
+        return stall_last_ms;
+    }
+
+    float WorldStreaming::GetMaxStallMs()
+    {
+        return stall_max_ms;
+    }
+
+    void WorldStreaming::ResetStats()
+    {
+        stall_last_ms = 0.0f;
+        stall_max_ms  = 0.0f;
+    }
+}
@@ -0,0 +1,100 @@
+/*
+Copyright(c) 2015-2025 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ===============
+#include "../Math/Vector3.h"
+//==========================
+
+namespace spartan
+{
+    class Entity;
+
+    // a root entity which belongs to a world cell, as recorded in the world manifest
+    struct WorldCellEntity
+    {
+        uint64_t id   = 0;     // object id of the root entity
+        uint64_t hash = 0;     // content hash of its serialized subtree
+        uint64_t size = 0;     // serialized size in bytes, used as a proxy for its memory footprint
+        std::string file;      // file (relative to the world's resource directory) that holds the subtree
+        int32_t cell_x = 0;    // cell coordinates
+        int32_t cell_z = 0;
+        bool resident = false; // true if the entity is currently part of the world
+        uint64_t revision = 0; // revision of the subtree when its file was last known to match it
+    };
+
+    // divides the world into square cells on the xz plane and streams them in and out around a set of observers,
+    // cell files are parsed on worker threads while entity creation happens on the main thread within a time budget
+    class WorldStreaming
+    {
+    public:
+        // system
+        static void Tick();
+        static void Clear();
+        static void Flush(); // blocks until all requested cells are resident, useful for headless runs
+
+        // enabled
+        static bool IsEnabled();
+        static void SetEnabled(const bool enabled);
+
+        // cells
+        static float GetCellSize();
+        static void SetCellSize(const float size);
+        static void GetCell(const math::Vector3& position, int32_t& cell_x, int32_t& cell_z);
+        static void RegisterEntity(const WorldCellEntity& entity, Entity* root = nullptr); // root is the live entity of a resident record
+        static void OnEntityRemoved(const uint64_t id);
+        static void GetNonResidentEntities(std::vector<WorldCellEntity>& entities);
+        static bool IsRegistered(const uint64_t id); // true for root entities that belong to a cell
+        static void SetDirectory(const std::string& directory);
+        static const std::string& GetDirectory();
+        static const char* GetEntitiesDirectory();   // where entity files live, relative to the directory
+
+        // serializes a root entity and its descendants, the file name is derived from the content so that files
+        // referenced by a previous manifest are never overwritten
+        static void SerializeEntity(Entity* entity, std::string& data, uint64_t& hash, std::string& file);
+
+        // streaming parameters, cells load within the load radius and unload beyond the unload radius (hysteresis)
+        static float GetLoadRadius();
+        static void SetLoadRadius(const float radius);
+        static float GetUnloadRadius();
+        static void SetUnloadRadius(const float radius);
+        static uint64_t GetMemoryBudget();
+        static void SetMemoryBudget(const uint64_t bytes);
+        static float GetFrameBudgetMs();
+        static void SetFrameBudgetMs(const float milliseconds);
+
+        // observers, the active camera is an implicit observer
+        static void SetObserver(const uint32_t index, const math::Vector3& position);
+        static void RemoveObserver(const uint32_t index);
+        static void SetCameraIsObserver(const bool is_observer);
+
+        // stats
+        static uint32_t GetCellCount();
+        static uint32_t GetResidentCellCount();
+        static uint32_t GetPendingCellCount();
+        static uint64_t GetResidentMemory();
+        static float GetLastStallMs();
+        static float GetMaxStallMs();
+        static void ResetStats();
+    };
+}